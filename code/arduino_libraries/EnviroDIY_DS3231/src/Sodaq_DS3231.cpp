@@ -429,4 +429,15 @@ float Sodaq_DS3231::getTemperature()
 
 }
 
+//The aging offset register holds a two's complement number
+int8_t Sodaq_DS3231::getAgingOffset()
+{
+    return (int8_t)readRegister(DS3231_AGING_OFFSET_REG);
+}
+
+void Sodaq_DS3231::setAgingOffset(int8_t offset)
+{
+    writeRegister(DS3231_AGING_OFFSET_REG, (uint8_t)offset);
+}
+
 Sodaq_DS3231 rtc;
@@ -83,6 +83,11 @@ public:
 
     void convertTemperature(bool waitToFinish=true);
     float getTemperature();
+
+    //Gets and sets the aging offset, which trims the oscillator's rate. Each step
+    //slows the clock by about 0.1 ppm, from the next temperature conversion on.
+    int8_t getAgingOffset();
+    void setAgingOffset(int8_t offset);
 private:
     uint8_t readRegister(uint8_t regaddress);
     void writeRegister(uint8_t regaddress, uint8_t value);
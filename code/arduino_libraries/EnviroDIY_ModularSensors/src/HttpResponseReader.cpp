@@ -0,0 +1,184 @@
+/**
+ * @file HttpResponseReader.cpp
+ * @copyright 2017-2022 Stroud Water Research Center
+ * Part of the EnviroDIY ModularSensors library for Arduino
+ *
+ * @brief Implements the HttpResponseReader class.
+ */
+
+#include "HttpResponseReader.h"
+
+
+// Constructor
+HttpResponseReader::HttpResponseReader() {
+    begin();
+}
+// Destructor
+HttpResponseReader::~HttpResponseReader() {}
+
+
+void HttpResponseReader::begin(char* body, uint16_t bodySize) {
+    _state           = stateStatusLine;
+    _statusCode      = 0;
+    _contentLength   = -1;
+    _bodyLeft        = 0;
+    _http11          = false;
+    _closeHeader     = false;
+    _keepAliveHeader = false;
+    _chunked         = false;
+    _lineLength      = 0;
+    _body            = body;
+    _bodySize        = bodySize;
+    _bodyLength      = 0;
+    if (_body != nullptr && _bodySize > 0) _body[0] = '\0';
+}
+
+
+bool HttpResponseReader::parse(char c) {
+    switch (_state) {
+        case stateStatusLine:
+            if (addToLine(c)) endStatusLine();
+            break;
+        case stateHeaderLine:
+            if (addToLine(c)) endHeaderLine();
+            break;
+        case stateBody:
+            keepBody(c);
+            if (--_bodyLeft == 0) _state = stateDone;
+            break;
+        case stateBodyUntilClose: keepBody(c); break;
+        case stateChunkSize:
+            if (addToLine(c)) endChunkSize();
+            break;
+        case stateChunkData:
+            keepBody(c);
+            if (--_bodyLeft == 0) _state = stateChunkEnd;
+            break;
+        case stateChunkEnd:
+            // The line break after a chunk's data
+            if (c == '\n') _state = stateChunkSize;
+            break;
+        case stateTrailer:
+            // Any trailing headers are skipped; an empty line ends them
+            if (addToLine(c)) {
+                if (_lineLength == 0) _state = stateDone;
+                _lineLength = 0;
+            }
+            break;
+        case stateDone: break;
+    }
+    return _state == stateDone;
+}
+
+
+int16_t HttpResponseReader::read(Client* client, uint32_t timeout_ms) {
+    MS_START_DEBUG_TIMER;
+    uint32_t start = millis();
+    while (!isComplete() && millis() - start < timeout_ms) {
+        int available = client->available();
+        if (available > 0) {
+            while (available-- > 0 && !isComplete()) {
+                int c = client->read();
+                if (c < 0) break;
+                parse(static_cast<char>(c));
+            }
+        } else if (!client->connected()) {
+            // The server closed the connection, which is how a body with no
+            // length ends
+            if (_state == stateBodyUntilClose) _state = stateDone;
+            break;
+        } else {
+            delay(10);
+        }
+    }
+    MS_DBG(F("Response"), isComplete() ? F("complete") : F("incomplete"),
+           F("after"), MS_PRINT_DEBUG_TIMER, F("ms"));
+    // An interim (1xx) status isn't the response's
+    return _statusCode >= 200 ? _statusCode : 504;
+}
+
+
+bool HttpResponseReader::keepAlive(void) const {
+    return isComplete() && !_closeHeader && (_http11 || _keepAliveHeader);
+}
+
+
+// Adds a character to the line being read, returning true at the end of it
+bool HttpResponseReader::addToLine(char c) {
+    if (c == '\n') {
+        _line[_lineLength] = '\0';
+        return true;
+    }
+    if (c == '\r') return false;
+    if (_lineLength < MS_HTTP_HEADER_LINE_SIZE - 1) {
+        _line[_lineLength++] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+    return false;
+}
+
+
+void HttpResponseReader::endStatusLine(void) {
+    // Skip anything before the status line, like blank lines
+    if (strncmp(_line, "http/1.", 7) == 0 && _lineLength >= 12) {
+        _http11     = _line[7] != '0';
+        _statusCode = atoi(_line + 9);
+        _state      = stateHeaderLine;
+        MS_DBG(F("Status code"), _statusCode);
+    }
+    _lineLength = 0;
+}
+
+
+void HttpResponseReader::endHeaderLine(void) {
+    if (_lineLength == 0) {
+        endHeaders();
+        return;
+    }
+    if (strncmp(_line, "content-length:", 15) == 0) {
+        _contentLength = atol(_line + 15);
+    } else if (strncmp(_line, "transfer-encoding:", 18) == 0) {
+        _chunked = strstr(_line + 18, "chunked") != nullptr;
+    } else if (strncmp(_line, "connection:", 11) == 0) {
+        _closeHeader     = strstr(_line + 11, "close") != nullptr;
+        _keepAliveHeader = strstr(_line + 11, "keep-alive") != nullptr;
+    }
+    _lineLength = 0;
+}
+
+
+void HttpResponseReader::endHeaders(void) {
+    _lineLength = 0;
+    if (_statusCode >= 100 && _statusCode < 200) {
+        // An interim response; the real one follows
+        begin(_body, _bodySize);
+    } else if (_statusCode == 204 || _statusCode == 304) {
+        _state = stateDone;
+    } else if (_chunked) {
+        _state = stateChunkSize;
+    } else if (_contentLength == 0) {
+        _state = stateDone;
+    } else if (_contentLength > 0) {
+        _bodyLeft = _contentLength;
+        _state    = stateBody;
+    } else {
+        _state = stateBodyUntilClose;
+        // The connection has to close to end the body
+        _closeHeader = true;
+    }
+}
+
+
+void HttpResponseReader::endChunkSize(void) {
+    // The size is in hex, maybe followed by ";" and extensions
+    _bodyLeft   = strtoul(_line, nullptr, 16);
+    _lineLength = 0;
+    _state      = _bodyLeft == 0 ? stateTrailer : stateChunkData;
+}
+
+
+void HttpResponseReader::keepBody(char c) {
+    if (_body != nullptr && _bodyLength + 1 < _bodySize) {
+        _body[_bodyLength++] = c;
+        _body[_bodyLength]   = '\0';
+    }
+}
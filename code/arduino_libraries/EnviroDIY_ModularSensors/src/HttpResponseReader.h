@@ -0,0 +1,203 @@
+/**
+ * @file HttpResponseReader.h
+ * @copyright 2017-2022 Stroud Water Research Center
+ * Part of the EnviroDIY ModularSensors library for Arduino
+ *
+ * @brief Contains the HttpResponseReader class, which reads an HTTP/1.1
+ * response off a client as it arrives.
+ *
+ * @copydetails HttpResponseReader
+ */
+
+// Header Guards
+#ifndef SRC_HTTPRESPONSEREADER_H_
+#define SRC_HTTPRESPONSEREADER_H_
+
+// Debugging Statement
+// #define MS_HTTPRESPONSEREADER_DEBUG
+
+#ifdef MS_HTTPRESPONSEREADER_DEBUG
+#define MS_DEBUGGING_STD "HttpResponseReader"
+#endif
+
+/**
+ * @def MS_HTTP_RESPONSE_TIMEOUT_MS
+ * @brief The default milliseconds to wait for a whole response
+ *
+ * This is only the longest the reader will wait; it returns as soon as the
+ * response is in.
+ *
+ * This can be changed by setting the build flag MS_HTTP_RESPONSE_TIMEOUT_MS
+ * when compiling.
+ */
+#ifndef MS_HTTP_RESPONSE_TIMEOUT_MS
+#define MS_HTTP_RESPONSE_TIMEOUT_MS 10000L
+#endif
+
+/**
+ * @def MS_HTTP_HEADER_LINE_SIZE
+ * @brief The characters of each status or header line kept to be looked at
+ *
+ * Anything past this in a line is skipped; only the status code and the
+ * Content-Length, Transfer-Encoding and Connection headers are used, and they
+ * all fit well within it.
+ */
+#ifndef MS_HTTP_HEADER_LINE_SIZE
+#define MS_HTTP_HEADER_LINE_SIZE 48
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+#include "Client.h"
+
+/**
+ * @brief The HttpResponseReader class reads an HTTP/1.1 response off a client
+ * as it arrives, and stops as soon as the whole response is in.
+ *
+ * The status line and headers are parsed one character at a time, and the body
+ * is read to the end given by its Content-Length or its chunks, so the reader
+ * knows exactly when the response is over without waiting for a set time or
+ * for the server to close the connection.  Because the whole response has been
+ * read off the connection, another request can be sent on it straight away if
+ * keepAlive() says the server will keep it open.
+ *
+ * Interim (1xx) responses are skipped.  A body with neither a length nor
+ * chunks runs until the server closes the connection, and then the connection
+ * can't be used again.
+ *
+ * The reader doesn't need a client; parse() can be handed the characters of a
+ * response from anywhere.
+ *
+ * @ingroup base_classes
+ */
+class HttpResponseReader {
+ public:
+    /**
+     * @brief Construct a new HttpResponseReader, ready for a response.
+     */
+    HttpResponseReader();
+    /**
+     * @brief Destroy the HttpResponseReader object - no action needed.
+     */
+    ~HttpResponseReader();
+
+    /**
+     * @brief Start over for a new response.
+     *
+     * @param body Where to keep the start of the body, with a terminator;
+     * nullptr (the default) to keep none of it
+     * @param bodySize The room in body
+     */
+    void begin(char* body = nullptr, uint16_t bodySize = 0);
+
+    /**
+     * @brief Take the next character of the response.
+     *
+     * @param c The character
+     * @return **bool** True once the whole response is in
+     */
+    bool parse(char c);
+
+    /**
+     * @brief Read a response off a client, returning as soon as all of it is
+     * in.
+     *
+     * The reader must have been started with begin() first.
+     *
+     * @param client The client the request was sent on
+     * @param timeout_ms The most milliseconds to wait for the whole response.
+     * Optional with a default value of #MS_HTTP_RESPONSE_TIMEOUT_MS.
+     * @return **int16_t** The response's status code, or 504 if its status
+     * line didn't come before the deadline or the connection closed; an
+     * interim (1xx) response doesn't count
+     */
+    int16_t read(Client*  client,
+                 uint32_t timeout_ms = MS_HTTP_RESPONSE_TIMEOUT_MS);
+
+    /**
+     * @brief Check whether the whole response has been read.
+     *
+     * @return **bool** True if the response is complete
+     */
+    bool isComplete(void) const {
+        return _state == stateDone;
+    }
+    /**
+     * @brief Get the response's status code.
+     *
+     * @return **int16_t** The status code; 0 until the status line is in
+     */
+    int16_t getStatusCode(void) const {
+        return _statusCode;
+    }
+    /**
+     * @brief Get the length the server gave for the body.
+     *
+     * @return **int32_t** The Content-Length; -1 if there wasn't one
+     */
+    int32_t getContentLength(void) const {
+        return _contentLength;
+    }
+    /**
+     * @brief Get the number of characters of the body kept in the buffer
+     * given to begin().
+     *
+     * @return **uint16_t** The number of characters kept
+     */
+    uint16_t getBodyLength(void) const {
+        return _bodyLength;
+    }
+    /**
+     * @brief Check whether the connection can be used for another request.
+     *
+     * @return **bool** True if the whole response was read and the server
+     * didn't say it would close the connection
+     */
+    bool keepAlive(void) const;
+
+ private:
+    /**
+     * @brief The parts of a response the reader can be in the middle of
+     */
+    enum parseState : uint8_t {
+        stateStatusLine,
+        stateHeaderLine,
+        stateBody,
+        stateBodyUntilClose,
+        stateChunkSize,
+        stateChunkData,
+        stateChunkEnd,
+        stateTrailer,
+        stateDone
+    };
+
+    bool addToLine(char c);
+    void endStatusLine(void);
+    void endHeaderLine(void);
+    void endHeaders(void);
+    void endChunkSize(void);
+    void keepBody(char c);
+
+    parseState _state;
+    int16_t    _statusCode;
+    int32_t    _contentLength;
+    /**
+     * @brief The characters of the body, or of the current chunk, still to come
+     */
+    uint32_t _bodyLeft;
+    bool     _http11;
+    bool     _closeHeader;
+    bool     _keepAliveHeader;
+    bool     _chunked;
+    /**
+     * @brief The line being read, in lower case
+     */
+    char     _line[MS_HTTP_HEADER_LINE_SIZE];
+    uint8_t  _lineLength;
+    char*    _body;
+    uint16_t _bodySize;
+    uint16_t _bodyLength;
+};
+
+#endif  // SRC_HTTPRESPONSEREADER_H_
@@ -0,0 +1,283 @@
+/**
+ * @file LogSession.cpp
+ * @copyright 2017-2022 Stroud Water Research Center
+ * Part of the EnviroDIY ModularSensors library for Arduino
+ *
+ * @brief Implements the LogSession class.
+ */
+
+#include "LogSession.h"
+
+
+// Constructor
+LogSession::LogSession(Logger& baseLogger, uint32_t extentBytes,
+                       uint16_t syncInterval_s)
+    : _baseLogger(&baseLogger),
+      _extentBytes(extentBytes),
+      _syncInterval_s(syncInterval_s),
+      _lastSync(0),
+      _recordCount(0),
+      _isOpen(false),
+      _preAllocated(false) {
+    _baseLogger->setLogSession(this);  // attach self to the logger
+}
+// Destructor
+LogSession::~LogSession() {}
+
+
+bool LogSession::begin(void) {
+    if (_isOpen) return true;
+
+    // skip everything else if there's no SD card, otherwise it might hang
+    _baseLogger->turnOnSDcard(true);
+    if (!_baseLogger->initializeSDCard()) return false;
+
+    // Get a new file name if the name is blank
+    if (_baseLogger->_fileName == "") _baseLogger->generateAutoFileName();
+    const char* fileName = _baseLogger->_fileName.c_str();
+    File&       file     = _baseLogger->logFile;
+
+    _preAllocated = false;
+    if (file.open(fileName, O_RDWR)) {
+        MS_DBG(F("Opened existing file:"), fileName);
+        // Cut off anything a power cut left behind
+        if (!recoverLogFile()) {
+            file.close();
+            PRINTOUT(F("Unable to write to SD card!"));
+            return false;
+        }
+        _baseLogger->setFileTimestamp(file, T_ACCESS);
+    } else if (!createLogFile(fileName)) {
+        PRINTOUT(F("Unable to create a file to save data to!"));
+        return false;
+    }
+
+    _buffer.begin(&file);
+    _lastSync    = Logger::markedLocalEpochTime;
+    _recordCount = 0;
+    _isOpen      = true;
+    PRINTOUT(F("Keeping"), fileName, F("open to save data to"));
+    return true;
+}
+
+
+bool LogSession::logRecord(void) {
+    if (!_isOpen) return false;
+    bool success = true;
+
+    // Stage the record
+    _baseLogger->printSensorDataCSV(&_buffer);
+    if (_buffer.getWriteError()) {
+        PRINTOUT(F("The record is too long for MS_LOG_SESSION_BUFFER_SIZE!"));
+        _buffer.clearWriteError();
+        success = false;
+    } else {
+        _recordCount++;
+    }
+// Echo the line to the serial port
+#if defined(STANDARD_SERIAL_OUTPUT)
+    PRINTOUT(F("\n \\/---- Line Staged for SD Card ----\\/"));
+    _baseLogger->printSensorDataCSV(&STANDARD_SERIAL_OUTPUT);
+    PRINTOUT('\n');
+#endif
+
+    success &= writeSectors();
+    if (Logger::markedLocalEpochTime - _lastSync >= _syncInterval_s) {
+        success &= sync();
+    }
+    return success;
+}
+
+
+bool LogSession::sync(void) {
+    if (!_isOpen) return false;
+    File& file = _baseLogger->logFile;
+
+    MS_DBG(F("Syncing"), _buffer.bytesUsed(), F("staged bytes to"),
+           _baseLogger->_fileName);
+    if (!_buffer.sync()) {
+        PRINTOUT(F("Unable to write to SD card!"));
+        return false;
+    }
+    // Set write/modification date time
+    _baseLogger->setFileTimestamp(file, T_WRITE);
+    if (!file.sync()) {
+        PRINTOUT(F("Unable to write to SD card!"));
+        return false;
+    }
+    _lastSync = Logger::markedLocalEpochTime;
+    return true;
+}
+
+
+bool LogSession::end(void) {
+    if (!_isOpen) return true;
+    File& file    = _baseLogger->logFile;
+    bool  success = sync();
+
+    // Give back the part of the extent that was never used
+    if (_preAllocated) success &= file.truncate();
+    // Set access date time
+    _baseLogger->setFileTimestamp(file, T_ACCESS);
+    success &= file.close();
+
+    _isOpen       = false;
+    _preAllocated = false;
+    MS_DBG(F("Closed"), _baseLogger->_fileName, F("after"), _recordCount,
+           F("records"));
+    return success;
+}
+
+
+// Creates the file and starts it
+bool LogSession::createLogFile(const char* fileName) {
+    File& file = _baseLogger->logFile;
+    if (!file.open(fileName, O_RDWR | O_CREAT | O_EXCL)) return false;
+    MS_DBG(F("Created new file:"), fileName);
+    // Set creation date time
+    _baseLogger->setFileTimestamp(file, T_CREATE);
+    return startLogFile();
+}
+
+
+// Gives the empty, open file an erased, contiguous extent and writes the header
+bool LogSession::startLogFile(void) {
+    File& file    = _baseLogger->logFile;
+    _preAllocated = file.preAllocate(_extentBytes);
+    if (_preAllocated && !eraseExtent()) {
+        // Without a known erased tail, there'd be no telling the records from
+        // old data after a power cut, so let the file grow the ordinary way
+        MS_DBG(F("The SD card could not erase the extent"));
+        file.truncate(0);
+        _preAllocated = false;
+    }
+    MS_DBG(_preAllocated ? F("Set aside") : F("Could not set aside"),
+           _extentBytes, F("bytes for"), _baseLogger->_fileName);
+
+    // Add header information
+    _baseLogger->printFileHeader(&file);
+    // Set write/modification date time
+    _baseLogger->setFileTimestamp(file, T_WRITE);
+    return file.sync();
+}
+
+
+bool LogSession::eraseExtent(void) {
+    uint32_t firstSector;
+    uint32_t lastSector;
+    if (!_baseLogger->logFile.contiguousRange(&firstSector, &lastSector)) {
+        return false;
+    }
+    return _baseLogger->sd.card()->erase(firstSector, lastSector);
+}
+
+
+// If a power cut left a file still holding its whole extent, the records end
+// where the erased part begins.  Records never hold 0x00 or 0xFF, which is
+// what erased sectors read as, so the start of the erased part can be found
+// with a binary search.  Anything after the last whole record is cut off, and
+// the file is left where the next record goes.
+bool LogSession::recoverLogFile(void) {
+    File&    file = _baseLogger->logFile;
+    uint32_t size = file.fileSize();
+    // A power cut while the file was being started can leave it empty, or
+    // holding its extent with whatever was on the card before the erase
+    if (size == 0 || (size == _extentBytes && !startsWithHeader())) {
+        PRINTOUT(F("Starting"), _baseLogger->_fileName,
+                 F("over, its header never reached the card"));
+        return file.truncate(0) && startLogFile();
+    }
+    // A file that was closed or synced properly ends with a whole record
+    if (!file.seekSet(size - 1)) return false;
+    if (file.read() == '\n') return file.seekEnd();
+
+    uint32_t low  = 0;
+    uint32_t high = size;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (!file.seekSet(middle)) return false;
+        int c = file.read();
+        if (c == 0x00 || c == 0xFF) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    uint32_t end = low;
+    while (end > 0) {
+        if (!file.seekSet(end - 1)) return false;
+        if (file.read() == '\n') break;
+        end--;
+    }
+
+    PRINTOUT(F("Recovered"), _baseLogger->_fileName, F("after a power cut,"),
+             F("keeping"), end, F("of"), size, F("bytes"));
+    return file.truncate(end) && file.sync() && file.seekEnd();
+}
+
+
+// Reads the file along as a header is printed to it, up to the end of the
+// header's first line
+class HeaderCheck : public Stream {
+ public:
+    explicit HeaderCheck(File& file)
+        : _file(file), _matches(true), _done(false) {}
+    size_t write(uint8_t c) override {
+        if (_done) return 1;
+        if (_file.read() != c) _matches = false;
+        _done = !_matches || c == '\n';
+        return 1;
+    }
+    int available() override {
+        return 0;
+    }
+    int read() override {
+        return -1;
+    }
+    int peek() override {
+        return -1;
+    }
+    bool matches(void) {
+        return _matches;
+    }
+
+ private:
+    File& _file;
+    bool  _matches;
+    bool  _done;
+};
+
+bool LogSession::startsWithHeader(void) {
+    File& file = _baseLogger->logFile;
+    if (!file.seekSet(0)) return false;
+    HeaderCheck check(file);
+    _baseLogger->printFileHeader(&check);
+    return check.matches();
+}
+
+
+// Writes out whatever whole sectors are staged, starting with whatever fills
+// out the sector the file ends in
+bool LogSession::writeSectors(void) {
+    File&    file       = _baseLogger->logFile;
+    uint16_t toBoundary = sectorSize - (file.curPosition() % sectorSize);
+    while (_buffer.bytesUsed() >= toBoundary) {
+        if (_buffer.writeOut(toBoundary) != toBoundary) {
+            PRINTOUT(F("Unable to write to SD card!"));
+            return false;
+        }
+        // SdFat writes a sector that arrives in pieces, like the one the file
+        // ends in or one split where the buffer wraps, through its cache, but
+        // whole sectors straight to the card.  The cached one has to reach the
+        // card first, or a power cut could leave erased bytes before records
+        // that were written out, and recovery would cut back to them.  Past
+        // the extent, the directory entry only grows at a sync anyway.
+        if (_preAllocated && file.curPosition() <= _extentBytes &&
+            !file.sync()) {
+            PRINTOUT(F("Unable to write to SD card!"));
+            return false;
+        }
+        toBoundary = sectorSize;
+    }
+    return true;
+}
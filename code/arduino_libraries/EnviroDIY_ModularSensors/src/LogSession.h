@@ -0,0 +1,197 @@
+/**
+ * @file LogSession.h
+ * @copyright 2017-2022 Stroud Water Research Center
+ * Part of the EnviroDIY ModularSensors library for Arduino
+ *
+ * @brief Contains the LogSession class, which keeps the log file open and
+ * buffers records between intervals.
+ *
+ * @copydetails LogSession
+ */
+
+// Header Guards
+#ifndef SRC_LOGSESSION_H_
+#define SRC_LOGSESSION_H_
+
+// Debugging Statement
+// #define MS_LOGSESSION_DEBUG
+
+#ifdef MS_LOGSESSION_DEBUG
+#define MS_DEBUGGING_STD "LogSession"
+#endif
+
+/**
+ * @def MS_LOG_SESSION_BUFFER_SIZE
+ * @brief The bytes of records held in RAM before they are written to the card
+ *
+ * Records are only written out a whole 512 byte sector at a time, so this must
+ * be at least two sectors, and a single record must never be longer than one.
+ *
+ * This can be changed by setting the build flag MS_LOG_SESSION_BUFFER_SIZE
+ * when compiling.
+ */
+#ifndef MS_LOG_SESSION_BUFFER_SIZE
+#define MS_LOG_SESSION_BUFFER_SIZE 1024
+#endif
+
+/**
+ * @def MS_LOG_SESSION_EXTENT
+ * @brief The default bytes set aside, in one contiguous piece, for a new log
+ * file
+ *
+ * Files that outgrow this keep growing the ordinary way.
+ */
+#ifndef MS_LOG_SESSION_EXTENT
+#define MS_LOG_SESSION_EXTENT 1048576L
+#endif
+
+/**
+ * @def MS_LOG_SESSION_SYNC_INTERVAL
+ * @brief The default seconds of logger time between syncs of the log file
+ *
+ * A power cut loses at most the records taken since the last sync.
+ */
+#ifndef MS_LOG_SESSION_SYNC_INTERVAL
+#define MS_LOG_SESSION_SYNC_INTERVAL 900
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+#include "LoggerBase.h"
+#include <RingBuf.h>
+
+/**
+ * @brief The "LogSession" class keeps the logger's file open between logging
+ * intervals and buffers the records in RAM.
+ *
+ * Without a session, Logger::logToSD() opens the file, writes one line, stamps
+ * it and closes it again every interval, and the SD card is powered down in
+ * between.  Each of those records costs several directory and FAT updates.  A
+ * session instead opens the file once, in begin(), and keeps the card powered
+ * until end().  Records are staged in a RingBuf and only written to the card
+ * a whole sector at a time, lined up with the card's own sectors.  The file is
+ * synced every #MS_LOG_SESSION_SYNC_INTERVAL seconds, so the directory is only
+ * updated that often.
+ *
+ * A new file is given a contiguous extent with SdFat's preAllocate(), and the
+ * extent is erased.  If the power is cut, everything written out up to the
+ * cut can be recovered: the next begin() finds where the erased part of the
+ * extent starts and cuts the file back to the last whole record before it.
+ * Records still in RAM are lost, so at most one sync interval is at risk.  A
+ * file cut off before its header reached the card is started over.
+ * When the card can't erase the extent, the file grows the ordinary way and
+ * everything up to the last sync is kept.
+ *
+ * Creating a session attaches it to the logger; while it is open the logger
+ * writes its records to it and leaves the SD card powered.
+ *
+ * @ingroup base_classes
+ */
+class LogSession {
+ public:
+    /**
+     * @brief Construct a new LogSession and attach it to a logger.
+     *
+     * @param baseLogger The logger whose file to keep open
+     * @param extentBytes The bytes to set aside for a new log file.  Optional
+     * with a default value of #MS_LOG_SESSION_EXTENT.
+     * @param syncInterval_s The seconds of logger time between syncs.
+     * Optional with a default value of #MS_LOG_SESSION_SYNC_INTERVAL.
+     */
+    explicit LogSession(Logger&  baseLogger,
+                        uint32_t extentBytes    = MS_LOG_SESSION_EXTENT,
+                        uint16_t syncInterval_s = MS_LOG_SESSION_SYNC_INTERVAL);
+    /**
+     * @brief Destroy the LogSession object - no action needed.
+     */
+    ~LogSession();
+
+    /**
+     * @brief Power the SD card and open the logger's file for the session.
+     *
+     * A missing file is created with a preallocated extent and the header.  An
+     * existing file left behind by a power cut is first cut back to its last
+     * whole record.
+     *
+     * @return **bool** True if the file is open
+     */
+    bool begin(void);
+    /**
+     * @brief Stage the logger's current record and write out any whole
+     * sectors.
+     *
+     * Syncs the file if the sync interval has passed.
+     *
+     * @return **bool** True if the record was staged and anything due was
+     * written out
+     */
+    bool logRecord(void);
+    /**
+     * @brief Write out everything staged and update the file's directory
+     * entry.
+     *
+     * @return **bool** True if the file was synced
+     */
+    bool sync(void);
+    /**
+     * @brief Sync the file, give back the unused part of its extent, and close
+     * it.
+     *
+     * The SD card is left powered; call Logger::turnOffSDcard() afterwards to
+     * cut it.
+     *
+     * @return **bool** True if everything was saved
+     */
+    bool end(void);
+
+    /**
+     * @brief Check whether the session has the file open.
+     *
+     * @return **bool** True between a successful begin() and end()
+     */
+    bool isOpen(void) {
+        return _isOpen;
+    }
+    /**
+     * @brief Get the number of records staged since begin().
+     *
+     * @return **uint32_t** The number of records
+     */
+    uint32_t getRecordCount(void) {
+        return _recordCount;
+    }
+
+ private:
+    bool createLogFile(const char* fileName);
+    bool startLogFile(void);
+    bool eraseExtent(void);
+    bool recoverLogFile(void);
+    bool startsWithHeader(void);
+    bool writeSectors(void);
+
+    /**
+     * @brief The bytes in an SD card sector
+     */
+    static const uint16_t sectorSize = 512;
+
+    Logger* _baseLogger;
+    /**
+     * @brief The records waiting to be written to the card
+     */
+    RingBuf<File, MS_LOG_SESSION_BUFFER_SIZE> _buffer;
+    uint32_t _extentBytes;
+    uint16_t _syncInterval_s;
+    /**
+     * @brief The logger time of the last sync
+     */
+    uint32_t _lastSync;
+    uint32_t _recordCount;
+    bool     _isOpen;
+    /**
+     * @brief Whether the file still has an erased, preallocated extent
+     */
+    bool _preAllocated;
+};
+
+#endif  // SRC_LOGSESSION_H_
@@ -8,6 +8,7 @@
  */
 
 #include "LoggerBase.h"
+#include "LogSession.h"
 #include "dataPublisherBase.h"
 
 /**
@@ -21,6 +22,14 @@
 // For all i2c communication, including with the real time clock
 #include <Wire.h>
 
+// How far the modem has gotten with waking and connecting while the sensors
+// update in logDataAndPublish()
+#define LOGGER_MODEM_OFF 0
+#define LOGGER_MODEM_POWERED 1
+#define LOGGER_MODEM_AWAKE 2
+#define LOGGER_MODEM_CONNECTED 3
+#define LOGGER_MODEM_FAILED 4
+
 
 // Initialize the static timezone
 int8_t Logger::_loggerTimeZone = 0;
@@ -134,7 +143,16 @@ void Logger::turnOnSDcard(bool waitToSettle) {
         if (waitToSettle) { delay(6); }
     }
 }
+bool Logger::beginSDCard(void) {
+    turnOnSDcard(true);
+    return initializeSDCard();
+}
 void Logger::turnOffSDcard(bool waitForHousekeeping) {
+    // Never cut the power under an open log session
+    if (logSessionOpen()) {
+        MS_DBG(F("Leaving the SD card on for the open log session"));
+        return;
+    }
     if (_SDCardPowerPin >= 0) {
         // TODO(SRGDamia1): set All SPI pins to INPUT?
         // TODO(SRGDamia1): set ALL SPI pins HIGH (~30k pull-up)
@@ -230,7 +248,8 @@ void Logger::setLoggerPins(int8_t mcuWakePin, int8_t SDCardSSPin,
 
 // Assigns the variable array object
 void Logger::setVariableArray(VariableArray* inputArray) {
-    _internalArray = inputArray;
+    _internalArray   = inputArray;
+    _valueCacheCount = 0;
 }
 
 
@@ -262,14 +281,74 @@ String Logger::getVarUnitAtI(uint8_t position_i) {
 String Logger::getVarCodeAtI(uint8_t position_i) {
     return _internalArray->arrayOfVars[position_i]->getVarCode();
 }
+const char* Logger::getVarCodeCharAtI(uint8_t position_i) {
+    return _internalArray->arrayOfVars[position_i]->getVarCodeChar();
+}
 // This returns the variable UUID, if one has been assigned
 String Logger::getVarUUIDAtI(uint8_t position_i) {
     return _internalArray->arrayOfVars[position_i]->getVarUUID();
 }
+const char* Logger::getVarUUIDCharAtI(uint8_t position_i) {
+    return _internalArray->arrayOfVars[position_i]->getVarUUIDChar();
+}
 // This returns the current value of the variable as a string with the
 // correct number of significant figures
 String Logger::getValueStringAtI(uint8_t position_i) {
-    return _internalArray->arrayOfVars[position_i]->getValueString();
+    return String(getValueCharAtI(position_i));
+}
+// This returns the current value of the variable as text, from the cache if
+// it's there
+const char* Logger::getValueCharAtI(uint8_t position_i) {
+    if (_valueCacheCount == 0 ||
+        _valueCacheUpdate != _internalArray->getUpdateCount()) {
+        cacheValueStrings();
+    }
+    if (position_i < _valueCacheCount) {
+        return _valueText + _valueStarts[position_i];
+    }
+    Variable::formatValue(getValueAtI(position_i),
+                          getVarResolutionAtI(position_i), _valueScratch);
+    return _valueScratch;
+}
+// This returns the length of the value's text
+uint8_t Logger::getValueLengthAtI(uint8_t position_i) {
+    const char* text = getValueCharAtI(position_i);
+    if (position_i < _valueCacheCount) return _valueLengths[position_i];
+    return strlen(text);
+}
+// This writes out every value once, for all the writers to share
+void Logger::cacheValueStrings(void) {
+    uint8_t  varCount = getArrayVarCount();
+    uint16_t used     = 0;
+    char     text[MS_VALUE_TEXT_SIZE];
+    _valueCacheCount  = 0;
+    _valueCacheUpdate = _internalArray->getUpdateCount();
+    while (_valueCacheCount < varCount &&
+           _valueCacheCount < MS_LOGGER_VALUE_CACHE_VARIABLES) {
+        uint8_t i      = _valueCacheCount;
+        uint8_t length = Variable::formatValue(getValueAtI(i),
+                                               getVarResolutionAtI(i), text);
+        if (used + length + 1 > MS_LOGGER_VALUE_CACHE_SIZE) break;
+        memcpy(_valueText + used, text, length + 1);
+        _valueStarts[i]  = used;
+        _valueLengths[i] = length;
+        used += length + 1;
+        _valueCacheCount++;
+    }
+    if (_valueCacheCount < varCount) {
+        PRINTOUT(F("Only"), _valueCacheCount, F("of"), varCount,
+                 F("values fit in the value cache!  Raise "
+                   "MS_LOGGER_VALUE_CACHE_SIZE or "
+                   "MS_LOGGER_VALUE_CACHE_VARIABLES."));
+    }
+}
+// This returns the current value of the variable as a number
+float Logger::getValueAtI(uint8_t position_i) {
+    return _internalArray->arrayOfVars[position_i]->getValue();
+}
+// This returns the number of decimal places of the variable
+uint8_t Logger::getVarResolutionAtI(uint8_t position_i) {
+    return _internalArray->arrayOfVars[position_i]->getResolution();
 }
 
 
@@ -346,6 +425,24 @@ void Logger::registerDataPublisher(dataPublisher* publisher) {
 }
 
 
+void Logger::cacheDataForRemotes(void) {
+    for (uint8_t i = 0; i < MAX_NUMBER_SENDERS; i++) {
+        if (dataPublishers[i] != nullptr) dataPublishers[i]->cacheData();
+    }
+}
+
+
+bool Logger::isRemoteSendDue(uint8_t adding) {
+    for (uint8_t i = 0; i < MAX_NUMBER_SENDERS; i++) {
+        if (dataPublishers[i] != nullptr &&
+            dataPublishers[i]->isDueToSend(adding)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
 void Logger::publishDataToRemotes(void) {
     MS_DBG(F("Sending out remote data."));
 
@@ -697,7 +794,7 @@ void Logger::wakeISR(void) {
 
 // Puts the system to sleep to conserve battery life.
 // This DOES NOT sleep or wake the sensors!!
-void Logger::systemSleep(void) {
+void Logger::systemSleep(int8_t wakeSecond) {
     // Don't go to sleep unless there's a wake pin!
     if (_mcuWakePin < 0) {
         MS_DBG(F("Use a non-negative wake pin to request sleep!"));
@@ -712,8 +809,13 @@ void Logger::systemSleep(void) {
     // the hour, but not every 5 minutes.  This is why we set the alarm for
     // every minute and use the checkInterval function.  This is a hardware
     // limitation of the DS3231; it is not due to the libraries or software.
-    MS_DBG(F("Setting alarm on DS3231 RTC for every minute."));
-    rtc.enableInterrupts(EveryMinute);
+    if (wakeSecond >= 0) {
+        MS_DBG(F("Setting alarm on DS3231 RTC for second"), wakeSecond);
+        rtc.enableInterrupts(MATCH_SECONDS, 0, 0, 0, wakeSecond);
+    } else {
+        MS_DBG(F("Setting alarm on DS3231 RTC for every minute."));
+        rtc.enableInterrupts(EveryMinute);
+    }
 
     // Clear the last interrupt flag in the RTC status register
     // The next timed interrupt will not be sent until this is cleared
@@ -736,7 +838,7 @@ void Logger::systemSleep(void) {
     // because there seems to be a bit of a wake-up delay
     MS_DBG(F("Setting alarm on SAMD built-in RTC for every minute."));
     zero_sleep_rtc.attachInterrupt(wakeISR);
-    zero_sleep_rtc.setAlarmSeconds(59);
+    zero_sleep_rtc.setAlarmSeconds(wakeSecond >= 0 ? wakeSecond : 59);
     zero_sleep_rtc.enableAlarm(zero_sleep_rtc.MATCH_SS);
 
 #endif
@@ -1016,13 +1118,13 @@ void Logger::printFileHeader(Stream* stream) {
 
 // This prints a comma separated list of volues of sensor data - including the
 // time -  out over an Arduino stream
-void Logger::printSensorDataCSV(Stream* stream) {
+void Logger::printSensorDataCSV(Print* stream) {
     String csvString = "";
     dtFromEpoch(Logger::markedLocalEpochTime).addToString(csvString);
     csvString += ',';
     stream->print(csvString);
     for (uint8_t i = 0; i < getArrayVarCount(); i++) {
-        stream->print(getValueStringAtI(i));
+        stream->print(getValueCharAtI(i));
         if (i + 1 != getArrayVarCount()) { stream->print(','); }
     }
     stream->println();
@@ -1030,6 +1132,9 @@ void Logger::printSensorDataCSV(Stream* stream) {
 
 // Protected helper function - This checks if the SD card is available and ready
 bool Logger::initializeSDCard(void) {
+    // An open log session already has the card, and starting it again would
+    // throw away what the session has cached
+    if (logSessionOpen()) return true;
     // If we don't know the slave select of the sd card, we can't use it
     if (_SDCardSSPin < 0) {
         PRINTOUT(F("Slave/Chip select pin for SD card has not been set."));
@@ -1186,6 +1291,9 @@ bool Logger::logToSD(String& rec) {
 // NOTE:  This is structured differently than the version with a string input
 // record.  This is to avoid the creation/passing of very long strings.
 bool Logger::logToSD(void) {
+    // Stage the record in the open log session, if there is one
+    if (logSessionOpen()) return _logSession->logRecord();
+
     // Get a new file name if the name is blank
     if (_fileName == "") generateAutoFileName();
 
@@ -1220,6 +1328,15 @@ bool Logger::logToSD(void) {
 }
 
 
+// Attaches a session to keep the log file open
+void Logger::setLogSession(LogSession* session) {
+    _logSession = session;
+}
+bool Logger::logSessionOpen(void) {
+    return _logSession != nullptr && _logSession->isOpen();
+}
+
+
 // ===================================================================== //
 // Public functions for a "sensor testing" mode
 // ===================================================================== //
@@ -1442,6 +1559,7 @@ void Logger::logData(void) {
         MS_DBG(F("    Running a complete sensor update..."));
         watchDogTimer.resetWatchDog();
         _internalArray->completeUpdate();
+        cacheValueStrings();
         watchDogTimer.resetWatchDog();
 
         // Create a csv data record and save it to the log file
@@ -1464,6 +1582,43 @@ void Logger::logData(void) {
     // Sleep
     systemSleep();
 }
+// Moves the modem one step closer to being connected while the sensors update
+void Logger::connectModemStep(void* logger) {
+    Logger*      self  = static_cast<Logger*>(logger);
+    loggerModem* modem = self->_logModem;
+    switch (self->_modemProgress) {
+        case LOGGER_MODEM_POWERED:
+            // Wake it as soon as it's been powered long enough, which doesn't
+            // have to wait on any of the sensors
+            if (modem->isWarmedUp()) {
+                MS_DBG(F("Waking up"), modem->getModemName(),
+                       F("while the sensors update..."));
+                self->_modemProgress = modem->modemWake()
+                    ? LOGGER_MODEM_AWAKE
+                    : LOGGER_MODEM_FAILED;
+                self->_modemLastPoll = millis();
+                self->watchDogTimer.resetWatchDog();
+            }
+            break;
+        case LOGGER_MODEM_AWAKE:
+            // The modem looks for the network on its own once it's awake; every
+            // so often, take a single look at whether it's registered and
+            // connect to the internet right away if it is
+            if (millis() - self->_modemLastPoll >= MS_LOGGER_ATTACH_POLL_MS) {
+                if (modem->connectInternet(1)) {
+                    MS_DBG(F("Connected to the internet while the sensors "
+                             "update"));
+                    self->_modemProgress = LOGGER_MODEM_CONNECTED;
+                }
+                self->_modemLastPoll = millis();
+                self->watchDogTimer.resetWatchDog();
+            }
+            break;
+        default: break;
+    }
+}
+
+
 // This is a one-and-done to log data
 void Logger::logDataAndPublish(void) {
     // Reset the watchdog
@@ -1486,14 +1641,34 @@ void Logger::logDataAndPublish(void) {
         // the card and writing to it.  Could we turn it on just before writing?
         turnOnSDcard(false);
 
+        // Work out now whether the modem will be needed: only if a publisher
+        // is due to send (counting the interval about to be measured), or for
+        // the daily clock sync
+        bool syncDue = (Logger::markedLocalEpochTime != 0 &&
+                        Logger::markedLocalEpochTime % 86400 == 43200) ||
+            !isRTCSane(Logger::markedLocalEpochTime);
+        bool modemNeeded = _logModem != nullptr &&
+            (isRemoteSendDue(1) || syncDue);
+
         // Do a complete update on the variable array.
         // This this includes powering all of the sensors, getting updated
         // values, and turing them back off.
         // NOTE:  The wake function for each sensor should force sensor setup to
         // run if the sensor was not previously set up.
+        // If the modem is needed, it's powered first and woken and connected a
+        // step at a time between passes over the sensors, so finding the
+        // network takes place while the sensors warm up and measure instead of
+        // after them.
         MS_DBG(F("Running a complete sensor update..."));
         watchDogTimer.resetWatchDog();
-        _internalArray->completeUpdate();
+        if (modemNeeded) {
+            _logModem->modemPowerUp();
+            _modemProgress = LOGGER_MODEM_POWERED;
+            _internalArray->completeUpdate(connectModemStep, this);
+        } else {
+            _internalArray->completeUpdate();
+        }
+        cacheValueStrings();
         watchDogTimer.resetWatchDog();
 
 // Print out the sensor data
@@ -1506,41 +1681,51 @@ void Logger::logDataAndPublish(void) {
         // Create a csv data record and save it to the log file
         logToSD();
 
-        if (_logModem != nullptr) {
-            MS_DBG(F("Waking up"), _logModem->getModemName(), F("..."));
-            if (_logModem->modemWake()) {
+        // Let the publishers keep this interval
+        cacheDataForRemotes();
+
+        if (modemNeeded) {
+            // Finish whatever the modem didn't get to during the update
+            if (_modemProgress == LOGGER_MODEM_POWERED) {
+                MS_DBG(F("Waking up"), _logModem->getModemName(), F("..."));
+                _modemProgress = _logModem->modemWake() ? LOGGER_MODEM_AWAKE
+                                                        : LOGGER_MODEM_FAILED;
+            }
+            if (_modemProgress == LOGGER_MODEM_AWAKE) {
                 // Connect to the network
                 watchDogTimer.resetWatchDog();
                 MS_DBG(F("Connecting to the Internet..."));
                 if (_logModem->connectInternet()) {
-                    // Publish data to remotes
-                    watchDogTimer.resetWatchDog();
-                    publishDataToRemotes();
-                    watchDogTimer.resetWatchDog();
-
-                    if ((Logger::markedLocalEpochTime != 0 &&
-                         Logger::markedLocalEpochTime % 86400 == 43200) ||
-                        !isRTCSane(Logger::markedLocalEpochTime)) {
-                        // Sync the clock at noon
-                        MS_DBG(F("Running a daily clock sync..."));
-                        setRTClock(_logModem->getNISTTime());
-                        watchDogTimer.resetWatchDog();
-                    }
-
-                    // Update the modem metadata
-                    MS_DBG(F("Updating modem metadata..."));
-                    _logModem->updateModemMetadata();
-
-                    // Disconnect from the network
-                    MS_DBG(F("Disconnecting from the Internet..."));
-                    _logModem->disconnectInternet();
+                    _modemProgress = LOGGER_MODEM_CONNECTED;
                 } else {
                     MS_DBG(F("Could not connect to the internet!"));
                     watchDogTimer.resetWatchDog();
                 }
             }
+            if (_modemProgress == LOGGER_MODEM_CONNECTED) {
+                // Publish data to remotes
+                watchDogTimer.resetWatchDog();
+                publishDataToRemotes();
+                watchDogTimer.resetWatchDog();
+
+                if (syncDue) {
+                    // Sync the clock at noon
+                    MS_DBG(F("Running a daily clock sync..."));
+                    setRTClock(_logModem->getNISTTime());
+                    watchDogTimer.resetWatchDog();
+                }
+
+                // Update the modem metadata
+                MS_DBG(F("Updating modem metadata..."));
+                _logModem->updateModemMetadata();
+
+                // Disconnect from the network
+                MS_DBG(F("Disconnecting from the Internet..."));
+                _logModem->disconnectInternet();
+            }
             // Turn the modem off
             _logModem->modemSleepPowerDown();
+            _modemProgress = LOGGER_MODEM_OFF;
         }
 
 
@@ -63,8 +63,49 @@
  */
 #define MAX_NUMBER_SENDERS 4
 
+/**
+ * @def MS_LOGGER_VALUE_CACHE_SIZE
+ * @brief The bytes set aside to keep every value of an interval written out as
+ * text
+ *
+ * Each value takes its length plus one.  Values that don't fit are written out
+ * again each time they are asked for.
+ *
+ * This can be changed by setting the build flag MS_LOGGER_VALUE_CACHE_SIZE
+ * when compiling.
+ */
+#ifndef MS_LOGGER_VALUE_CACHE_SIZE
+#define MS_LOGGER_VALUE_CACHE_SIZE 256
+#endif
+
+/**
+ * @def MS_LOGGER_VALUE_CACHE_VARIABLES
+ * @brief The most variables whose values are kept written out as text
+ *
+ * This can be changed by setting the build flag
+ * MS_LOGGER_VALUE_CACHE_VARIABLES when compiling.
+ */
+#ifndef MS_LOGGER_VALUE_CACHE_VARIABLES
+#define MS_LOGGER_VALUE_CACHE_VARIABLES 32
+#endif
+
+/**
+ * @def MS_LOGGER_ATTACH_POLL_MS
+ * @brief How often (in milliseconds) to ask the modem if it has found the
+ * network while the sensors are being updated in logDataAndPublish()
+ *
+ * Each check holds up the sensors for a moment, so don't make this too short.
+ *
+ * This can be changed by setting the build flag MS_LOGGER_ATTACH_POLL_MS when
+ * compiling.
+ */
+#ifndef MS_LOGGER_ATTACH_POLL_MS
+#define MS_LOGGER_ATTACH_POLL_MS 2000L
+#endif
+
 
 class dataPublisher;  // Forward declaration
+class LogSession;     // Forward declaration
 
 
 /**
@@ -90,6 +131,11 @@ class Logger {
      * proper formats for sending it.
      */
     friend class dataPublisher;
+    /**
+     * @brief The LogSession class keeps the log file open between intervals,
+     * so it works with the SD card and file directly.
+     */
+    friend class LogSession;
 
  public:
     /**
@@ -229,6 +275,16 @@ class Logger {
      * any on-chip writing to complete before cutting power.  Defaults to true.
      */
     void turnOffSDcard(bool waitForHousekeeping = true);
+    /**
+     * @brief Power up and initialize the SD card so a program can keep its
+     * own files on it alongside the log file.
+     *
+     * Any files opened after this are on this card.  Call turnOffSDcard() when
+     * done with them.
+     *
+     * @return **bool** True if the SD card is ready
+     */
+    bool beginSDCard(void);
 
     /**
      * @brief Set a digital pin number for the slave select (chip select) of the
@@ -501,6 +557,14 @@ class Logger {
      * @return **String** The variable code
      */
     String getVarCodeAtI(uint8_t position_i);
+    /**
+     * @brief Get the customized code of the variable at the given position in
+     * the internal variable array object without copying it into a String.
+     *
+     * @param position_i The position of the variable in the array.
+     * @return **const char*** The variable code
+     */
+    const char* getVarCodeCharAtI(uint8_t position_i);
     /**
      * @brief Get the UUID of the variable at the given position in the internal
      * variable array object.
@@ -509,6 +573,15 @@ class Logger {
      * @return **String** The variable UUID
      */
     String getVarUUIDAtI(uint8_t position_i);
+    /**
+     * @brief Get the UUID of the variable at the given position in the
+     * internal variable array object without copying it into a String.
+     *
+     * @param position_i The position of the variable in the array.
+     * @return **const char*** The variable UUID, or an empty string if none has
+     * been assigned
+     */
+    const char* getVarUUIDCharAtI(uint8_t position_i);
     /**
      * @brief Get the most recent value of the variable at the given position in
      * the internal variable array object.
@@ -518,12 +591,84 @@ class Logger {
      * number of significant figures.
      */
     String getValueStringAtI(uint8_t position_i);
+    /**
+     * @brief Get the most recent value of the variable at the given position in
+     * the internal variable array object, written out as text, without making
+     * a String.
+     *
+     * The text is the same as getValueStringAtI() gives.  Every value is
+     * written out once per update, by cacheValueStrings(), and kept until the
+     * next update, so the SD card, the publishers and the radio all share it.
+     *
+     * @param position_i The position of the variable in the array.
+     * @return **const char*** The value as text.  This stays good until the
+     * next update; for a value that didn't fit in the cache, only until the
+     * next call.
+     */
+    const char* getValueCharAtI(uint8_t position_i);
+    /**
+     * @brief Get the length of the text getValueCharAtI() gives for the
+     * variable at the given position.
+     *
+     * @param position_i The position of the variable in the array.
+     * @return **uint8_t** The number of characters in the value's text
+     */
+    uint8_t getValueLengthAtI(uint8_t position_i);
+    /**
+     * @brief Write out every value of the internal variable array as text and
+     * keep it until the next update.
+     *
+     * The logging functions call this right after each complete update.  If
+     * the array is updated some other way, the values are written out again
+     * the first time one is asked for.
+     */
+    void cacheValueStrings(void);
+    /**
+     * @brief Get the most recent value of the variable at the given position in
+     * the internal variable array object as a number.
+     *
+     * @param position_i The position of the variable in the array.
+     * @return **float** The value of the variable
+     */
+    float getValueAtI(uint8_t position_i);
+    /**
+     * @brief Get the number of decimal places the variable at the given
+     * position in the internal variable array object is reported with.
+     *
+     * @param position_i The position of the variable in the array.
+     * @return **uint8_t** The variable's resolution
+     */
+    uint8_t getVarResolutionAtI(uint8_t position_i);
 
  protected:
     /**
      * @brief A pointer to the internal variable array instance
      */
     VariableArray* _internalArray;
+    /**
+     * @brief Every cached value written out as text, each ending with a null
+     */
+    char _valueText[MS_LOGGER_VALUE_CACHE_SIZE];
+    /**
+     * @brief Where each cached value starts in #_valueText
+     */
+    uint16_t _valueStarts[MS_LOGGER_VALUE_CACHE_VARIABLES];
+    /**
+     * @brief The length of each cached value
+     */
+    uint8_t _valueLengths[MS_LOGGER_VALUE_CACHE_VARIABLES];
+    /**
+     * @brief The number of values in the cache; 0 if it hasn't been filled
+     */
+    uint8_t _valueCacheCount = 0;
+    /**
+     * @brief The variable array update the cached values came from
+     */
+    uint8_t _valueCacheUpdate = 0;
+    /**
+     * @brief Room to write out a value that didn't fit in the cache
+     */
+    char _valueScratch[MS_VALUE_TEXT_SIZE];
     /**@}*/
 
     // ===================================================================== //
@@ -562,8 +707,24 @@ class Logger {
      * @param publisher A dataPublisher object
      */
     void registerDataPublisher(dataPublisher* publisher);
+    /**
+     * @brief Let every registered data publisher keep the current values to
+     * send later.
+     */
+    void cacheDataForRemotes(void);
+    /**
+     * @brief Check whether any registered data publisher is due to send.
+     *
+     * @param adding The number of intervals about to be added with
+     * cacheDataForRemotes()
+     * @return **bool** True if any publisher is due (see
+     * dataPublisher::isDueToSend())
+     */
+    bool isRemoteSendDue(uint8_t adding = 0);
     /**
      * @brief Publish data to all registered data publishers.
+     *
+     * Publishers holding more than one interval send everything they hold.
      */
     void publishDataToRemotes(void);
     /**
@@ -585,6 +746,28 @@ class Logger {
     loggerModem* _logModem = nullptr;
     // ^^ Start with no modem attached
 
+    /**
+     * @brief How far the modem has gotten with waking and connecting while
+     * the sensors are updated in logDataAndPublish()
+     */
+    uint8_t _modemProgress = 0;
+    /**
+     * @brief The last time (from millis()) the modem was asked if it had found
+     * the network
+     */
+    uint32_t _modemLastPoll = 0;
+    /**
+     * @brief Take the modem one step closer to being connected to the
+     * internet.
+     *
+     * This is called between each pass over the sensors in
+     * logDataAndPublish(), so the modem can wake up and find the network while
+     * the sensors warm up and measure.
+     *
+     * @param logger The logger whose modem it is
+     */
+    static void connectModemStep(void* logger);
+
     /**
      * @brief An array of all of the attached data publishers
      */
@@ -866,8 +1049,12 @@ class Logger {
      * post-interrupt wake actions
      *
      * @note This DOES NOT sleep or wake the sensors!!
+     *
+     * @param wakeSecond The second of the minute (by the RTC) to wake up at,
+     * for sleeping until something that doesn't start on the minute; -1 (the
+     * default) wakes at the start of the next minute.
      */
-    void systemSleep(void);
+    void systemSleep(int8_t wakeSecond = -1);
 
 #if defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_SAMD_ZERO)
     /**
@@ -941,10 +1128,11 @@ class Logger {
      * @brief Print a comma separated list of volues of sensor data -
      * including the time in the logging timezone -  out over an Arduino stream
      *
-     * @param stream An Arduino stream instance - expected to be an SdFat file -
-     * but could also be the "main" Serial port for debugging.
+     * @param stream An Arduino stream instance - expected to be an SdFat file
+     * or the RingBuf of a LogSession - but could also be the "main" Serial port
+     * for debugging.
      */
-    void printSensorDataCSV(Stream* stream);
+    void printSensorDataCSV(Print* stream);
 
     /**
      * @brief Create a file on the SD card and set the created, modified, and
@@ -1017,6 +1205,17 @@ class Logger {
      */
     bool logToSD(void);
 
+    /**
+     * @brief Attach a LogSession to keep the log file open between intervals.
+     *
+     * This is done by the LogSession constructor.  While the session is open,
+     * logToSD() stages records in it, and the SD card is never powered down
+     * or re-initialized.
+     *
+     * @param session The session; nullptr to detach one.
+     */
+    void setLogSession(LogSession* session);
+
  protected:
     // The SD card and file
     /**
@@ -1032,6 +1231,16 @@ class Logger {
      */
     String _fileName = "";
     // ^^ Initialize with no file name
+    /**
+     * @brief The attached log session, if any
+     */
+    LogSession* _logSession = nullptr;
+    /**
+     * @brief Check whether an attached log session has the file open.
+     *
+     * @return **bool** True if a session is open
+     */
+    bool logSessionOpen(void);
 
     /**
      * @brief Check if the SD card is available and ready to write to.
@@ -87,6 +87,11 @@ void loggerModem::modemPowerUp(void) {
     }
 }
 
+bool loggerModem::isWarmedUp(void) {
+    return _millisPowerOn != 0 &&
+        millis() - _millisPowerOn >= _wakeDelayTime_ms;
+}
+
 void loggerModem::modemPowerDown(void) {
     if (_powerPin >= 0) {
         MS_DBG(F("Turning off power to"), getModemName(), F("with pin"),
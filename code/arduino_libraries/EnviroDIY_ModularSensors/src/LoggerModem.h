@@ -397,6 +397,16 @@ class loggerModem {
      * @brief Power the modem by setting the modem power pin high.
      */
     virtual void modemPowerUp(void);
+    /**
+     * @brief Check whether the modem has been powered for long enough that
+     * modemWake() can start on it without waiting.
+     *
+     * This lets other work go on between modemPowerUp() and modemWake().
+     *
+     * @return **bool** True if the modem is powered and its wake delay has
+     * passed
+     */
+    bool isWarmedUp(void);
     /**
      * @brief Cut power to the modem by setting the modem power pin low.
      *
@@ -0,0 +1,96 @@
+/**
+ * @file ResultReducer.cpp
+ * @copyright 2017-2022 Stroud Water Research Center
+ * Part of the EnviroDIY ModularSensors library for Arduino
+ *
+ * @brief Implements the ResultReducer class.
+ */
+
+#include "ResultReducer.h"
+
+
+// The constructor
+ResultReducer::ResultReducer(reducerType type, float* samples,
+                             uint8_t capacity, uint8_t trimPercent)
+    : _type(type),
+      _samples(samples),
+      _capacity(samples == nullptr ? 0 : capacity),
+      _trimPercent(trimPercent),
+      _count(0),
+      _next(0),
+      _running(0) {}
+
+
+void ResultReducer::clear(void) {
+    _count   = 0;
+    _next    = 0;
+    _running = 0;
+}
+
+
+void ResultReducer::add(float value) {
+    bool first = _count == 0;
+    if (_count < 255) _count++;
+
+    switch (_type) {
+        case MS_REDUCE_MIN:
+            if (first || value < _running) _running = value;
+            break;
+        case MS_REDUCE_MAX:
+            if (first || value > _running) _running = value;
+            break;
+        case MS_REDUCE_LAST: _running = value; break;
+        default:
+            // The mean, and what the median and trimmed mean fall back to
+            // without a buffer
+            _running += value;
+            if (_capacity > 0) {
+                _samples[_next] = value;
+                _next           = (_next + 1) % _capacity;
+            }
+            break;
+    }
+}
+
+
+float ResultReducer::reduce(void) {
+    if (_count == 0) return -9999;
+
+    switch (_type) {
+        case MS_REDUCE_MIN:
+        case MS_REDUCE_MAX:
+        case MS_REDUCE_LAST: return _running;
+        case MS_REDUCE_MEDIAN:
+        case MS_REDUCE_TRIMMED_MEAN: {
+            if (_capacity == 0) break;
+            uint8_t n = _count < _capacity ? _count : _capacity;
+            sortSamples(n);
+            if (_type == MS_REDUCE_MEDIAN) {
+                if (n % 2) return _samples[n / 2];
+                return (_samples[n / 2 - 1] + _samples[n / 2]) / 2;
+            }
+            uint8_t drop = static_cast<uint16_t>(n) * _trimPercent / 100;
+            if (2 * drop >= n) drop = (n - 1) / 2;
+            float sum = 0;
+            for (uint8_t i = drop; i < n - drop; i++) { sum += _samples[i]; }
+            MS_DBG(F("Trimmed"), drop, F("measurements from each end of"), n);
+            return sum / (n - 2 * drop);
+        }
+        default: break;
+    }
+    return _running / _count;
+}
+
+
+// An insertion sort; the buffers only hold a few measurements
+void ResultReducer::sortSamples(uint8_t n) {
+    for (uint8_t i = 1; i < n; i++) {
+        float   value = _samples[i];
+        uint8_t j     = i;
+        while (j > 0 && _samples[j - 1] > value) {
+            _samples[j] = _samples[j - 1];
+            j--;
+        }
+        _samples[j] = value;
+    }
+}
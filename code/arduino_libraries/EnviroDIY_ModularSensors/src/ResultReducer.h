@@ -0,0 +1,143 @@
+/**
+ * @file ResultReducer.h
+ * @copyright 2017-2022 Stroud Water Research Center
+ * Part of the EnviroDIY ModularSensors library for Arduino
+ *
+ * @brief Contains the ResultReducer class and the SampleReducer template.
+ *
+ * @copydetails ResultReducer
+ */
+
+// Header Guards
+#ifndef SRC_RESULTREDUCER_H_
+#define SRC_RESULTREDUCER_H_
+
+// Debugging Statement
+// #define MS_RESULTREDUCER_DEBUG
+
+#ifdef MS_RESULTREDUCER_DEBUG
+#define MS_DEBUGGING_STD "ResultReducer"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+
+/**
+ * @brief The ways the good measurements of a result can be reduced to a single
+ * value.
+ */
+typedef enum : uint8_t {
+    MS_REDUCE_MEAN = 0,     ///< The average of the good measurements
+    MS_REDUCE_MEDIAN,       ///< The middle good measurement
+    MS_REDUCE_TRIMMED_MEAN, ///< The average with the extremes dropped
+    MS_REDUCE_MIN,          ///< The lowest good measurement
+    MS_REDUCE_MAX,          ///< The highest good measurement
+    MS_REDUCE_LAST          ///< The most recent good measurement
+} reducerType;
+
+/**
+ * @brief The "ResultReducer" class combines the good measurements a sensor
+ * takes for one of its results into the value that is reported.
+ *
+ * By default a sensor averages the measurements it takes for each result.  A
+ * reducer can be given to Sensor::setReducer() for any result to report
+ * something else instead.  The mean, minimum, maximum and last good
+ * measurement are kept as running values and need no storage.  The median and
+ * trimmed mean need every measurement, so they are kept in a fixed buffer; use
+ * the SampleReducer template to declare a reducer with its own buffer.  If more
+ * measurements are taken than the buffer holds, the oldest are replaced.
+ *
+ * Nothing is allocated; a reducer is normally declared as a global in the
+ * sketch, next to the sensor it belongs to.
+ *
+ * @ingroup base_classes
+ */
+class ResultReducer {
+ public:
+    /**
+     * @brief Construct a new ResultReducer.
+     *
+     * @param type How to reduce the measurements.
+     * @param samples A buffer for the measurements; only needed for the median
+     * and trimmed mean.  Optional with a default value of nullptr.
+     * @param capacity The number of measurements the buffer holds.  Optional
+     * with a default value of 0.
+     * @param trimPercent For the trimmed mean, the percent of the measurements
+     * to drop from each end.  Optional with a default value of 20.
+     */
+    explicit ResultReducer(reducerType type, float* samples = nullptr,
+                           uint8_t capacity = 0, uint8_t trimPercent = 20);
+
+    /**
+     * @brief Forget every measurement, to start a new update cycle.
+     */
+    void clear(void);
+    /**
+     * @brief Add a good measurement.
+     *
+     * @param value The measurement; -9999 should not be passed.
+     */
+    void add(float value);
+    /**
+     * @brief Get the reduced value of the measurements added since the last
+     * clear().
+     *
+     * For the median and trimmed mean this sorts the buffer in place.
+     *
+     * @return **float** The reduced value, or -9999 if there were no good
+     * measurements.
+     */
+    float reduce(void);
+
+    /**
+     * @brief Get the number of good measurements added since the last
+     * clear().
+     *
+     * @return **uint8_t** The number of good measurements
+     */
+    uint8_t getCount(void) {
+        return _count;
+    }
+
+ private:
+    void sortSamples(uint8_t n);
+
+    reducerType _type;
+    float*      _samples;
+    uint8_t     _capacity;
+    uint8_t     _trimPercent;
+    uint8_t     _count;
+    /// The next buffer slot to fill; wraps once the buffer is full
+    uint8_t _next;
+    /// The running sum, minimum, maximum or last value, depending on the type
+    float _running;
+};
+
+
+/**
+ * @brief A ResultReducer with its own buffer for up to N measurements.
+ *
+ * @tparam N The most measurements kept for the median or trimmed mean; this
+ * should be at least the number of measurements the sensor averages.
+ *
+ * @ingroup base_classes
+ */
+template <uint8_t N>
+class SampleReducer : public ResultReducer {
+ public:
+    /**
+     * @brief Construct a new SampleReducer.
+     *
+     * @param type How to reduce the measurements.
+     * @param trimPercent For the trimmed mean, the percent of the measurements
+     * to drop from each end.  Optional with a default value of 20.
+     */
+    explicit SampleReducer(reducerType type, uint8_t trimPercent = 20)
+        : ResultReducer(type, _buffer, N, trimPercent) {}
+
+ private:
+    float _buffer[N];
+};
+
+#endif  // SRC_RESULTREDUCER_H_
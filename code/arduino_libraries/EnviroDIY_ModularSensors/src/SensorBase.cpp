@@ -33,6 +33,7 @@ Sensor::Sensor(const char* sensorName, const uint8_t totalReturnedValues,
         variables[i]                  = nullptr;
         sensorValues[i]               = -9999;
         numberGoodMeasurementsMade[i] = 0;
+        _reducers[i]                  = nullptr;
     }
 }
 // Destructor
@@ -75,6 +76,11 @@ uint8_t Sensor::getNumberMeasurementsToAverage(void) {
 }
 
 
+void Sensor::setReducer(uint8_t resultNumber, ResultReducer* reducer) {
+    if (resultNumber < MAX_NUMBER_VARS) _reducers[resultNumber] = reducer;
+}
+
+
 // This returns the 8-bit code for the current status of the sensor.
 // Bit 0 - 0=Has NOT been set up, 1=Has been setup
 // Bit 1 - 0=No attempt made to power sensor, 1=Attempt made to power sensor
@@ -268,6 +274,7 @@ void Sensor::clearValues(void) {
     for (uint8_t i = 0; i < _numReturnedValues; i++) {
         sensorValues[i]               = -9999;
         numberGoodMeasurementsMade[i] = 0;
+        if (_reducers[i] != nullptr) _reducers[i]->clear();
     }
 }
 
@@ -276,6 +283,10 @@ void Sensor::clearValues(void) {
 // averaged
 void Sensor::verifyAndAddMeasurementResult(uint8_t resultNumber,
                                            float   resultValue) {
+    // Results with a reducer also keep their good measurements there
+    if (resultValue != -9999 && _reducers[resultNumber] != nullptr) {
+        _reducers[resultNumber]->add(resultValue);
+    }
     // If the new result is good and there was were only bad results, set the
     // result value as the new result and add 1 to the good result total
     if (sensorValues[resultNumber] == -9999 && resultValue != -9999) {
@@ -320,7 +331,9 @@ void Sensor::averageMeasurements(void) {
     MS_DBG(F("Averaging results from"), getSensorNameAndLocation(), F("over"),
            _measurementsToAverage, F("reading[s]"));
     for (uint8_t i = 0; i < _numReturnedValues; i++) {
-        if (numberGoodMeasurementsMade[i] > 0)
+        if (_reducers[i] != nullptr)
+            sensorValues[i] = _reducers[i]->reduce();
+        else if (numberGoodMeasurementsMade[i] > 0)
             sensorValues[i] /= numberGoodMeasurementsMade[i];
         MS_DBG(F("    ->Result #"), i, ':', sensorValues[i]);
     }
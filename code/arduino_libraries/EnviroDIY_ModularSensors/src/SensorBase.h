@@ -34,6 +34,7 @@
 #include "ModSensorDebugger.h"
 #undef MS_DEBUGGING_STD
 #include <pins_arduino.h>
+#include "ResultReducer.h"
 
 /**
  * @brief The largest number of variables from a single sensor
@@ -165,6 +166,20 @@ class Sensor {
      */
     uint8_t getNumberMeasurementsToAverage(void);
 
+    /**
+     * @brief Set how the measurements for one result are combined.
+     *
+     * By default the good measurements for each result are averaged.  A
+     * reducer can report the median, a trimmed mean, the minimum, the maximum
+     * or the last good measurement instead.  The reducer must outlive the
+     * sensor; it is normally a global in the sketch.
+     *
+     * @param resultNumber The position of the result within the result array.
+     * @param reducer The reducer for the result, or nullptr to go back to
+     * averaging.
+     */
+    void setReducer(uint8_t resultNumber, ResultReducer* reducer);
+
     /**
      * @brief Get the 8-bit code for the current status of the sensor.
      *
@@ -353,6 +368,8 @@ class Sensor {
     /**
      * @brief Average the results of all measurements by dividing the sum of
      * all measurements by the number of measurements taken.
+     *
+     * Results with a reducer (see setReducer()) report its value instead.
      */
     void averageMeasurements(void);
 
@@ -487,6 +504,11 @@ class Sensor {
      * sensor in the current update cycle.
      */
     uint8_t numberGoodMeasurementsMade[MAX_NUMBER_VARS];
+    /**
+     * @brief Array with the reducer for each result, or nullptr for results
+     * that are averaged.
+     */
+    ResultReducer* _reducers[MAX_NUMBER_VARS];
 
     /**
      * @brief The time needed from the when a sensor has power until it's ready
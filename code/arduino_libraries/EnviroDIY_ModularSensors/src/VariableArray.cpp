@@ -11,19 +11,27 @@
 
 
 // Constructors
-VariableArray::VariableArray() {}
+VariableArray::VariableArray()
+    : _variableCount(0),
+      _sensorCount(0),
+      _calculatedCount(0),
+      _updateCount(0) {}
 VariableArray::VariableArray(uint8_t variableCount, Variable* variableList[])
     : arrayOfVars(variableList),
-      _variableCount(variableCount) {
+      _variableCount(variableCount),
+      _updateCount(0) {
+    buildSensorList();
+    buildCalculationPlan();
     _maxSamplestoAverage = countMaxToAverage();
-    _sensorCount         = getSensorCount();
 }
 VariableArray::VariableArray(uint8_t variableCount, Variable* variableList[],
                              const char* uuids[])
     : arrayOfVars(variableList),
-      _variableCount(variableCount) {
+      _variableCount(variableCount),
+      _updateCount(0) {
+    buildSensorList();
+    buildCalculationPlan();
     _maxSamplestoAverage = countMaxToAverage();
-    _sensorCount         = getSensorCount();
     matchUUIDs(uuids);
 }
 
@@ -35,8 +43,9 @@ void VariableArray::begin(uint8_t variableCount, Variable* variableList[],
     _variableCount = variableCount;
     arrayOfVars    = variableList;
 
+    buildSensorList();
+    buildCalculationPlan();
     _maxSamplestoAverage = countMaxToAverage();
-    _sensorCount         = getSensorCount();
     matchUUIDs(uuids);
     checkVariableUUIDs();
 }
@@ -44,13 +53,15 @@ void VariableArray::begin(uint8_t variableCount, Variable* variableList[]) {
     _variableCount = variableCount;
     arrayOfVars    = variableList;
 
+    buildSensorList();
+    buildCalculationPlan();
     _maxSamplestoAverage = countMaxToAverage();
-    _sensorCount         = getSensorCount();
     checkVariableUUIDs();
 }
 void VariableArray::begin() {
+    buildSensorList();
+    buildCalculationPlan();
     _maxSamplestoAverage = countMaxToAverage();
-    _sensorCount         = getSensorCount();
     checkVariableUUIDs();
 }
 
@@ -66,16 +77,6 @@ uint8_t VariableArray::getCalculatedVariableCount(void) {
 }
 
 
-// This counts and returns the number of sensors
-uint8_t VariableArray::getSensorCount(void) {
-    uint8_t numSensors = 0;
-    // Check for unique sensors
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (isLastVarFromSensor(i)) numSensors++;
-    }
-    return numSensors;
-}
-
 // This matches UUID's from an array of pointers to the variable array
 void VariableArray::matchUUIDs(const char* uuids[]) {
     for (uint8_t i = 0; i < _variableCount; i++) {
@@ -86,8 +87,7 @@ void VariableArray::matchUUIDs(const char* uuids[]) {
 // Public functions for interfacing with a list of sensors
 // This sets up all of the sensors in the list
 // NOTE:  Calculated variables will always be skipped in this process because
-// a calculated variable will never be marked as the last variable from a
-// sensor.
+// they are not in the sensor list.
 bool VariableArray::setupSensors(void) {
     bool success = true;
 
@@ -105,12 +105,9 @@ bool VariableArray::setupSensors(void) {
     // Check for any sensors that have been set up outside of this (ie, the
     // modem)
     uint8_t nSensorsSetup = 0;
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (isLastVarFromSensor(i)  // Skip non-unique sensors
-            && bitRead(arrayOfVars[i]->parentSensor->getStatus(), 0) ==
-                1  // already set up
-        ) {
-            MS_DBG(F("   "), arrayOfVars[i]->getParentSensorNameAndLocation(),
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        if (bitRead(_sensorList[i]->getStatus(), 0) == 1) {  // already set up
+            MS_DBG(F("   "), _sensorList[i]->getSensorNameAndLocation(),
                    F("was already set up!"));
 
             nSensorsSetup++;
@@ -122,17 +119,13 @@ bool VariableArray::setupSensors(void) {
     // up and increment the counter marking that's been done.
     // We keep looping until they've all been done.
     while (nSensorsSetup < _sensorCount) {
-        for (uint8_t i = 0; i < _variableCount; i++) {
-            if (isLastVarFromSensor(i)  // Skip non-unique sensors
-                && bitRead(arrayOfVars[i]->parentSensor->getStatus(), 0) ==
-                    0  // only set up if it has not yet been set up
-            ) {
+        for (uint8_t i = 0; i < _sensorCount; i++) {
+            // only set up if it has not yet been set up
+            if (bitRead(_sensorList[i]->getStatus(), 0) == 0) {
                 MS_DBG(F("    Set up of"),
-                       arrayOfVars[i]->getParentSensorNameAndLocation(),
-                       F("..."));
+                       _sensorList[i]->getSensorNameAndLocation(), F("..."));
 
-                bool sensorSuccess =
-                    arrayOfVars[i]->parentSensor->setup();  // set it up
+                bool sensorSuccess = _sensorList[i]->setup();  // set it up
                 success &= sensorSuccess;
                 nSensorsSetup++;
 
@@ -154,17 +147,14 @@ bool VariableArray::setupSensors(void) {
 // This powers up the sensors
 // There's no checking or waiting here, just turning on pins
 // NOTE:  Calculated variables will always be skipped in this process because
-// a calculated variable will never be marked as the last variable from a
-// sensor.
+// they are not in the sensor list.
 void VariableArray::sensorsPowerUp(void) {
     MS_DBG(F("Powering up sensors..."));
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (isLastVarFromSensor(i)) {  // Skip non-unique sensors
-            MS_DBG(F("    Powering up"),
-                   arrayOfVars[i]->getParentSensorNameAndLocation());
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        MS_DBG(F("    Powering up"),
+               _sensorList[i]->getSensorNameAndLocation());
 
-            arrayOfVars[i]->parentSensor->powerUp();
-        }
+        _sensorList[i]->powerUp();
     }
 }
 
@@ -172,8 +162,7 @@ void VariableArray::sensorsPowerUp(void) {
 // This wakes/activates the sensors
 // Before a sensor is "awoken" we have to make sure it's had time to warm up
 // NOTE:  Calculated variables will always be skipped in this process because
-// a calculated variable will never be marked as the last variable from a
-// sensor.
+// they are not in the sensor list.
 bool VariableArray::sensorsWake(void) {
     MS_DBG(F("Waking sensors..."));
     bool    success       = true;
@@ -187,13 +176,11 @@ bool VariableArray::sensorsWake(void) {
 
     // Check for any sensors that are awake outside of being sent a "wake"
     // command
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (isLastVarFromSensor(i)  // Skip non-unique sensors
-            && bitRead(arrayOfVars[i]->parentSensor->getStatus(), 3) ==
-                1  // already attempted to wake
-        ) {
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        // already attempted to wake
+        if (bitRead(_sensorList[i]->getStatus(), 3) == 1) {
             MS_DBG(F("    Wake up of"),
-                   arrayOfVars[i]->getParentSensorNameAndLocation(),
+                   _sensorList[i]->getSensorNameAndLocation(),
                    F("has already been attempted."));
             nSensorsAwake++;
         }
@@ -204,20 +191,18 @@ bool VariableArray::sensorsWake(void) {
     // up and increment the counter marking that's been done.
     // We keep looping until they've all been done.
     while (nSensorsAwake < _sensorCount) {
-        for (uint8_t i = 0; i < _variableCount; i++) {
-            if (isLastVarFromSensor(i)  // Skip non-unique sensors
-                && bitRead(arrayOfVars[i]->parentSensor->getStatus(), 3) ==
+        for (uint8_t i = 0; i < _sensorCount; i++) {
+            if (bitRead(_sensorList[i]->getStatus(), 3) ==
                     0  // If no attempts yet made to wake the sensor up
-                && arrayOfVars[i]->parentSensor->isWarmedUp(
+                && _sensorList[i]->isWarmedUp(
                        deepDebugTiming)  // and if it is already warmed up
             ) {
                 MS_DBG(F("    Wake up of"),
-                       arrayOfVars[i]->getParentSensorNameAndLocation(),
-                       F("..."));
+                       _sensorList[i]->getSensorNameAndLocation(), F("..."));
 
                 // Make a single attempt to wake the sensor after it is
                 // warmed up
-                bool sensorSuccess = arrayOfVars[i]->parentSensor->wake();
+                bool sensorSuccess = _sensorList[i]->wake();
                 success &= sensorSuccess;
                 // We increment up the number of sensors awake/active,
                 // even if the wake up command failed!
@@ -239,24 +224,20 @@ bool VariableArray::sensorsWake(void) {
 // We're not waiting for anything to be ready, we're just sending the command
 // to put it to sleep no matter what its current state is.
 // NOTE:  Calculated variables will always be skipped in this process because
-// a calculated variable will never be marked as the last variable from a
-// sensor.
+// they are not in the sensor list.
 bool VariableArray::sensorsSleep(void) {
     MS_DBG(F("Putting sensors to sleep..."));
     bool success = true;
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (isLastVarFromSensor(i)) {  // Skip non-unique sensors
-            MS_DBG(F("    "), arrayOfVars[i]->getParentSensorNameAndLocation(),
-                   F("..."));
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        MS_DBG(F("    "), _sensorList[i]->getSensorNameAndLocation(), F("..."));
 
-            bool sensorSuccess = arrayOfVars[i]->parentSensor->sleep();
-            success &= sensorSuccess;
+        bool sensorSuccess = _sensorList[i]->sleep();
+        success &= sensorSuccess;
 
-            if (sensorSuccess) {
-                MS_DBG(F("        ... successfully put to sleep."));
-            } else {
-                MS_DBG(F("        ... failed to sleep!"));
-            }
+        if (sensorSuccess) {
+            MS_DBG(F("        ... successfully put to sleep."));
+        } else {
+            MS_DBG(F("        ... failed to sleep!"));
         }
     }
     return success;
@@ -266,17 +247,14 @@ bool VariableArray::sensorsSleep(void) {
 // This cuts power to the sensors
 // We're not waiting for anything to be ready, we're just cutting power.
 // NOTE:  Calculated variables will always be skipped in this process because
-// a calculated variable will never be marked as the last variable from a
-// sensor.
+// they are not in the sensor list.
 void VariableArray::sensorsPowerDown(void) {
     MS_DBG(F("Powering down sensors..."));
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (isLastVarFromSensor(i)) {  // Skip non-unique sensors
-            MS_DBG(F("    Powering down"),
-                   arrayOfVars[i]->getParentSensorNameAndLocation());
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        MS_DBG(F("    Powering down"),
+               _sensorList[i]->getSensorNameAndLocation());
 
-            arrayOfVars[i]->parentSensor->powerDown();
-        }
+        _sensorList[i]->powerDown();
     }
 }
 
@@ -286,8 +264,7 @@ void VariableArray::sensorsPowerDown(void) {
 // the startSingleMeasurement and addSingleMeasurementResult functions to
 // take advantage of the ability of sensors to be measuring concurrently.
 // NOTE:  Calculated variables will always be skipped in this process because
-// a calculated variable will never be marked as the last variable from a
-// sensor.
+// they are not in the sensor list.
 bool VariableArray::updateAllSensors(void) {
     bool    success           = true;
     uint8_t nSensorsCompleted = 0;
@@ -298,56 +275,41 @@ bool VariableArray::updateAllSensors(void) {
     bool deepDebugTiming = false;
 #endif
 
-    // Create an array with the unique-ness value (so we can skip the function
-    // calls later)
-    MS_DBG(F("Creating a mask array with the uniqueness for each sensor.."));
-    bool lastSensorVariable[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        lastSensorVariable[i] = isLastVarFromSensor(i);
-    }
-
     // Create an array for the number of measurements already completed and set
     // all to zero
     MS_DBG(F("Creating an array for the number of completed measurements.."));
-    uint8_t nMeasurementsCompleted[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
+    uint8_t nMeasurementsCompleted[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) {
         nMeasurementsCompleted[i] = 0;
     }
 
     // Create an array for the number of measurements to average (another short
     // cut)
     MS_DBG(F("Creating an array with the number of measurements to average.."));
-    uint8_t nMeasurementsToAverage[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (lastSensorVariable[i]) {
-            nMeasurementsToAverage[i] =
-                arrayOfVars[i]->parentSensor->getNumberMeasurementsToAverage();
-        } else {
-            nMeasurementsToAverage[i] = 0;
-        }
+    uint8_t nMeasurementsToAverage[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        nMeasurementsToAverage[i] =
+            _sensorList[i]->getNumberMeasurementsToAverage();
     }
 
     // Clear the initial variable arrays
     MS_DBG(F("----->> Clearing all results arrays before taking new "
              "measurements. ..."));
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (lastSensorVariable[i]) {
-            arrayOfVars[i]->parentSensor->clearValues();
-        }
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        _sensorList[i]->clearValues();
     }
     MS_DBG(F("    ... Complete. <<-----"));
 
     // Check for any sensors that didn't wake up and mark them as "complete" so
     // they will be skipped in further looping.
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (lastSensorVariable[i]  // Skip non-unique sensors
-            && (bitRead(arrayOfVars[i]->parentSensor->getStatus(), 3) ==
-                    0  // No attempt made to wake the sensor up
-                || bitRead(arrayOfVars[i]->parentSensor->getStatus(), 4) ==
-                    0  // OR Wake up failed
-                )) {
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        if (bitRead(_sensorList[i]->getStatus(), 3) ==
+                0  // No attempt made to wake the sensor up
+            || bitRead(_sensorList[i]->getStatus(), 4) ==
+                0  // OR Wake up failed
+        ) {
             MS_DBG(i, F("--->>"),
-                   arrayOfVars[i]->getParentSensorNameAndLocation(),
+                   _sensorList[i]->getSensorNameAndLocation(),
                    F("isn't awake/active!  No measurements will be taken! "
                      "<<---"),
                    i);
@@ -362,48 +324,45 @@ bool VariableArray::updateAllSensors(void) {
     }
 
     while (nSensorsCompleted < _sensorCount) {
-        for (uint8_t i = 0; i < _variableCount; i++) {
+        for (uint8_t i = 0; i < _sensorCount; i++) {
             /***
             // THIS IS PURELY FOR DEEP DEBUGGING OF THE TIMING!
             // Leave this whole section commented out unless you want excessive
             // printouts (ie, thousands of lines) of the timing information!!
-            if (lastSensorVariable[i] and
-                nMeasurementsToAverage[i] > nMeasurementsCompleted[i])
+            if (nMeasurementsToAverage[i] > nMeasurementsCompleted[i])
             {
                 MS_DEEP_DBG(i), '-',
-            arrayOfVars[i]->getParentSensorNameAndLocation(), F("- millis:"),
+            _sensorList[i]->getSensorNameAndLocation(), F("- millis:"),
             millis(), F("- status: 0b"),
-                           bitRead(arrayOfVars[i]->parentSensor->getStatus(),
-            7), bitRead(arrayOfVars[i]->parentSensor->getStatus(), 6),
-                           bitRead(arrayOfVars[i]->parentSensor->getStatus(),
-            5), bitRead(arrayOfVars[i]->parentSensor->getStatus(), 4),
-                           bitRead(arrayOfVars[i]->parentSensor->getStatus(),
-            3), bitRead(arrayOfVars[i]->parentSensor->getStatus(), 2),
-                           bitRead(arrayOfVars[i]->parentSensor->getStatus(),
-            1), bitRead(arrayOfVars[i]->parentSensor->getStatus(), 0), F("-
+                           bitRead(_sensorList[i]->getStatus(),
+            7), bitRead(_sensorList[i]->getStatus(), 6),
+                           bitRead(_sensorList[i]->getStatus(),
+            5), bitRead(_sensorList[i]->getStatus(), 4),
+                           bitRead(_sensorList[i]->getStatus(),
+            3), bitRead(_sensorList[i]->getStatus(), 2),
+                           bitRead(_sensorList[i]->getStatus(),
+            1), bitRead(_sensorList[i]->getStatus(), 0), F("-
             measurement #"), (nMeasurementsCompleted[i] + 1);
             }
             // END CHUNK FOR DEBUGGING!
             ***/
 
             // Only do checks on sensors that still have measurements to finish
-            if (lastSensorVariable[i] &&
-                nMeasurementsToAverage[i] > nMeasurementsCompleted[i]) {
+            if (nMeasurementsToAverage[i] > nMeasurementsCompleted[i]) {
                 // first, make sure the sensor is stable
-                if (arrayOfVars[i]->parentSensor->isStable(deepDebugTiming)) {
+                if (_sensorList[i]->isStable(deepDebugTiming)) {
                     // now, if the sensor is not currently measuring...
-                    if (bitRead(arrayOfVars[i]->parentSensor->getStatus(), 5) ==
+                    if (bitRead(_sensorList[i]->getStatus(), 5) ==
                         0) {  // NO attempt yet to start a measurement
                         // Start a reading
                         MS_DBG(i, '.', nMeasurementsCompleted[i] + 1,
                                F("--->> Starting reading"),
                                nMeasurementsCompleted[i] + 1, F("on"),
-                               arrayOfVars[i]->getParentSensorNameAndLocation(),
+                               _sensorList[i]->getSensorNameAndLocation(),
                                '-');
 
                         bool sensorSuccess_start =
-                            arrayOfVars[i]
-                                ->parentSensor->startSingleMeasurement();
+                            _sensorList[i]->startSingleMeasurement();
                         success &= sensorSuccess_start;
 
                         if (sensorSuccess_start) {
@@ -423,18 +382,17 @@ bool VariableArray::updateAllSensors(void) {
                     // measurement failed (bit 6 not set).  In that case, the
                     // addSingleMeasurementResult() will be "adding" -9999
                     // values.
-                    if (arrayOfVars[i]->parentSensor->isMeasurementComplete(
+                    if (_sensorList[i]->isMeasurementComplete(
                             deepDebugTiming)) {
                         // Get the value
                         MS_DBG(i, '.', nMeasurementsCompleted[i] + 1,
                                F("--->> Collected result of reading"),
                                nMeasurementsCompleted[i] + 1, F("from"),
-                               arrayOfVars[i]->getParentSensorNameAndLocation(),
+                               _sensorList[i]->getSensorNameAndLocation(),
                                F("..."));
 
                         bool sensorSuccess_result =
-                            arrayOfVars[i]
-                                ->parentSensor->addSingleMeasurementResult();
+                            _sensorList[i]->addSingleMeasurementResult();
                         success &= sensorSuccess_result;
                         nMeasurementsCompleted[i] +=
                             1;  // increment the number of measurements that
@@ -455,7 +413,7 @@ bool VariableArray::updateAllSensors(void) {
                 // done
                 if (nMeasurementsCompleted[i] == nMeasurementsToAverage[i]) {
                     MS_DBG(F("--- Finished all measurements from"),
-                           arrayOfVars[i]->getParentSensorNameAndLocation(),
+                           _sensorList[i]->getSensorNameAndLocation(),
                            F("---"));
 
                     nSensorsCompleted++;
@@ -468,18 +426,16 @@ bool VariableArray::updateAllSensors(void) {
 
     // Average measurements and notify varibles of the updates
     MS_DBG(F("----->> Averaging results and notifying all variables. ..."));
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (lastSensorVariable[i]) {
-            MS_DEEP_DBG(F("--- Averaging results from"),
-                        arrayOfVars[i]->getParentSensorNameAndLocation(),
-                        F("---"));
-            arrayOfVars[i]->parentSensor->averageMeasurements();
-            MS_DEEP_DBG(F("--- Notifying variables from"),
-                        arrayOfVars[i]->getParentSensorNameAndLocation(),
-                        F("---"));
-            arrayOfVars[i]->parentSensor->notifyVariables();
-        }
-    }
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        MS_DEEP_DBG(F("--- Averaging results from"),
+                    _sensorList[i]->getSensorNameAndLocation(), F("---"));
+        _sensorList[i]->averageMeasurements();
+        MS_DEEP_DBG(F("--- Notifying variables from"),
+                    _sensorList[i]->getSensorNameAndLocation(), F("---"));
+        _sensorList[i]->notifyVariables();
+    }
+    calculateVariables();
+    _updateCount++;
     MS_DBG(F("... Complete. <<-----"));
 
     return success;
@@ -489,6 +445,10 @@ bool VariableArray::updateAllSensors(void) {
 // This function is an even more complete version of the updateAllSensors
 // function - it handles power up/down and wake/sleep.
 bool VariableArray::completeUpdate(void) {
+    return completeUpdate(nullptr, nullptr);
+}
+bool VariableArray::completeUpdate(void (*whileWaiting)(void*),
+                                   void* context) {
     bool    success           = true;
     uint8_t nSensorsCompleted = 0;
 
@@ -498,76 +458,58 @@ bool VariableArray::completeUpdate(void) {
     bool deepDebugTiming = false;
 #endif
 
-    // Create an array with the unique-ness value (so we can skip the function
-    // calls later)
-    MS_DBG(F("Creating a mask array with the uniqueness for each sensor.."));
-    bool lastSensorVariable[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        lastSensorVariable[i] = isLastVarFromSensor(i);
-    }
-
     // Create an array for the number of measurements already completed and set
     // all to zero
     MS_DBG(F("Creating an array for the number of completed measurements.."));
-    uint8_t nMeasurementsCompleted[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
+    uint8_t nMeasurementsCompleted[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) {
         nMeasurementsCompleted[i] = 0;
     }
 
     // Create an array for the number of measurements to average (another short
     // cut)
     MS_DBG(F("Creating an array with the number of measurements to average.."));
-    uint8_t nMeasurementsToAverage[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (lastSensorVariable[i]) {
-            nMeasurementsToAverage[i] =
-                arrayOfVars[i]->parentSensor->getNumberMeasurementsToAverage();
-        } else {
-            nMeasurementsToAverage[i] = 0;
-        }
+    uint8_t nMeasurementsToAverage[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        nMeasurementsToAverage[i] =
+            _sensorList[i]->getNumberMeasurementsToAverage();
     }
 
     // Create an array of the power pins
     MS_DBG(F("Creating an array of the power pins.."));
-    int8_t powerPins[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (lastSensorVariable[i]) {
-            powerPins[i] = arrayOfVars[i]->parentSensor->getPowerPin();
-        } else {
-            powerPins[i] = 0;
-        }
+    int8_t powerPins[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        powerPins[i] = _sensorList[i]->getPowerPin();
     }
 
     // Create an array of the last variable on each power pin
     MS_DBG(F("Creating arrays of the power pin locations.."));
-    bool lastPinVariable[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) { lastPinVariable[i] = true; }
+    bool lastPinVariable[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) { lastPinVariable[i] = true; }
     // Create an array containing the index of the power pin in the powerPins
     // array
-    int8_t powerPinIndex[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) { powerPinIndex[i] = 0; }
+    int8_t powerPinIndex[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) { powerPinIndex[i] = 0; }
     // Create an array to tell us how many measurements must be taken
     // before all the sensors attached to a power pin are done
-    uint8_t nMeasurementsOnPin[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
+    uint8_t nMeasurementsOnPin[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) {
         nMeasurementsOnPin[i] = nMeasurementsToAverage[i];
     }
     // Now correctly populate the previous three arrays
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        for (uint8_t j = i + 1; j < _variableCount; j++) {
-            if (!lastSensorVariable[i]) {
-                lastPinVariable[i] = false;
-            } else if (powerPins[i] == powerPins[j]) {
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        for (uint8_t j = i + 1; j < _sensorCount; j++) {
+            if (powerPins[i] == powerPins[j]) {
                 lastPinVariable[i] = false;
+                break;
             }
-            i++;
         }
     }
-    for (uint8_t i = 0; i < _variableCount; i++) {
+    for (uint8_t i = 0; i < _sensorCount; i++) {
         if (lastPinVariable[i]) {
             powerPinIndex[i]      = i;
             nMeasurementsOnPin[i] = nMeasurementsToAverage[i];
-            for (uint8_t j = 0; j < _variableCount; j++) {
+            for (uint8_t j = 0; j < _sensorCount; j++) {
                 if (powerPins[j] == powerPins[i] && i != j) {
                     powerPinIndex[j] = i;
                     nMeasurementsOnPin[i] += nMeasurementsToAverage[j];
@@ -579,48 +521,44 @@ bool VariableArray::completeUpdate(void) {
 
 // This is just for debugging
 #ifdef MS_VARIABLEARRAY_DEBUG_DEEP
-    uint8_t arrayPositions[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) { arrayPositions[i] = i; }
-    String nameLocation[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        // nameLocation[i] = arrayOfVars[i]->getParentSensorNameAndLocation();
-        nameLocation[i] = arrayOfVars[i]->getParentSensorName();
+    uint8_t arrayPositions[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) { arrayPositions[i] = i; }
+    String nameLocation[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        // nameLocation[i] = _sensorList[i]->getSensorNameAndLocation();
+        nameLocation[i] = _sensorList[i]->getSensorName();
     }
     MS_DEEP_DBG(F("----------------------------------"));
     MS_DEEP_DBG(F("arrayPositions:\t\t\t"));
-    prettyPrintArray(arrayPositions);
+    prettyPrintArray(arrayPositions, _sensorCount);
     MS_DEEP_DBG(F("sensor:\t\t\t"));
-    prettyPrintArray(nameLocation);
-    MS_DEEP_DBG(F("lastSensorVariable:\t\t"));
-    prettyPrintArray(lastSensorVariable);
+    prettyPrintArray(nameLocation, _sensorCount);
     MS_DEEP_DBG(F("nMeasurementsToAverage:\t\t"));
-    prettyPrintArray(nMeasurementsToAverage);
+    prettyPrintArray(nMeasurementsToAverage, _sensorCount);
     MS_DEEP_DBG(F("nMeasurementsCompleted:\t\t"));
-    prettyPrintArray(nMeasurementsCompleted);
+    prettyPrintArray(nMeasurementsCompleted, _sensorCount);
     MS_DEEP_DBG(F("powerPins:\t\t\t"));
-    prettyPrintArray(powerPins);
+    prettyPrintArray(powerPins, _sensorCount);
     MS_DEEP_DBG(F("lastPinVariable:\t\t"));
-    prettyPrintArray(lastPinVariable);
+    prettyPrintArray(lastPinVariable, _sensorCount);
     MS_DEEP_DBG(F("powerPinIndex:\t\t\t"));
-    prettyPrintArray(powerPinIndex);
+    prettyPrintArray(powerPinIndex, _sensorCount);
     MS_DEEP_DBG(F("nMeasurementsOnPin:\t\t"));
-    prettyPrintArray(nMeasurementsOnPin);
+    prettyPrintArray(nMeasurementsOnPin, _sensorCount);
     MS_DEEP_DBG(F("powerPinIndex:\t\t\t"));
-    prettyPrintArray(powerPinIndex);
+    prettyPrintArray(powerPinIndex, _sensorCount);
 #endif
 
     // Another array for the number of measurements already completed per power
     // pin
-    uint8_t nCompletedOnPin[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++) { nCompletedOnPin[i] = 0; }
+    uint8_t nCompletedOnPin[_sensorCount];
+    for (uint8_t i = 0; i < _sensorCount; i++) { nCompletedOnPin[i] = 0; }
 
     // Clear the initial variable arrays
     MS_DBG(F("----->> Clearing all results arrays before taking new "
              "measurements. ..."));
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (lastSensorVariable[i]) {
-            arrayOfVars[i]->parentSensor->clearValues();
-        }
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        _sensorList[i]->clearValues();
     }
     MS_DBG(F("   ... Complete. <<-----"));
 
@@ -630,54 +568,52 @@ bool VariableArray::completeUpdate(void) {
     MS_DBG(F("   ... Complete. <<-----"));
 
     while (nSensorsCompleted < _sensorCount) {
-        for (uint8_t i = 0; i < _variableCount; i++) {
+        for (uint8_t i = 0; i < _sensorCount; i++) {
             /***
             // THIS IS PURELY FOR DEEP DEBUGGING OF THE TIMING!
             // Leave this whole section commented out unless you want excessive
             // printouts (ie, thousands of lines) of the timing information!!
-            if (lastSensorVariable[i] and
-                nMeasurementsToAverage[i] > nMeasurementsCompleted[i]) {
+            if (nMeasurementsToAverage[i] > nMeasurementsCompleted[i]) {
                 MS_DEEP_DBG(
-                    i, '-', arrayOfVars[i]->getParentSensorNameAndLocation(),
+                    i, '-', _sensorList[i]->getSensorNameAndLocation(),
                     F("- millis:"), millis(), F("- status: 0b"),
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 7),
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 6),
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 5),
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 4),
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 3),
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 2),
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 1),
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 0),
+                    bitRead(_sensorList[i]->getStatus(), 7),
+                    bitRead(_sensorList[i]->getStatus(), 6),
+                    bitRead(_sensorList[i]->getStatus(), 5),
+                    bitRead(_sensorList[i]->getStatus(), 4),
+                    bitRead(_sensorList[i]->getStatus(), 3),
+                    bitRead(_sensorList[i]->getStatus(), 2),
+                    bitRead(_sensorList[i]->getStatus(), 1),
+                    bitRead(_sensorList[i]->getStatus(), 0),
                     F("- measurement #"), (nMeasurementsCompleted[i] + 1));
             }
             MS_DEEP_DBG(F("----------------------------------"));
             MS_DEEP_DBG(F("nMeasurementsToAverage:\t\t"));
-            prettyPrintArray(nMeasurementsToAverage);
+            prettyPrintArray(nMeasurementsToAverage, _sensorCount);
             MS_DEEP_DBG(F("nMeasurementsCompleted:\t\t"));
-            prettyPrintArray(nMeasurementsCompleted);
+            prettyPrintArray(nMeasurementsCompleted, _sensorCount);
             MS_DEEP_DBG(F("nMeasurementsOnPin:\t\t"));
-            prettyPrintArray(nMeasurementsOnPin);
+            prettyPrintArray(nMeasurementsOnPin, _sensorCount);
             MS_DEEP_DBG(F("nCompletedOnPin:\t\t\t"));
-            prettyPrintArray(nCompletedOnPin);
+            prettyPrintArray(nCompletedOnPin, _sensorCount);
             // END CHUNK FOR DEBUGGING!
             ***/
 
             // Only do checks on sensors that still have measurements to finish
-            if (lastSensorVariable[i] &&
-                nMeasurementsToAverage[i] > nMeasurementsCompleted[i]) {
-                if (bitRead(arrayOfVars[i]->parentSensor->getStatus(), 3) ==
+            if (nMeasurementsToAverage[i] > nMeasurementsCompleted[i]) {
+                if (bitRead(_sensorList[i]->getStatus(), 3) ==
                         0  // If no attempts yet made to wake the sensor up
-                    && arrayOfVars[i]->parentSensor->isWarmedUp(
+                    && _sensorList[i]->isWarmedUp(
                            deepDebugTiming)  // and if it is already warmed up
                 ) {
                     MS_DBG(i, F("--->> Waking"),
-                           arrayOfVars[i]->getParentSensorNameAndLocation(),
+                           _sensorList[i]->getSensorNameAndLocation(),
                            F("..."));
 
                     // Make a single attempt to wake the sensor after it is
                     // warmed up
                     bool sensorSuccess_wake =
-                        arrayOfVars[i]->parentSensor->wake();
+                        _sensorList[i]->wake();
                     success &= sensorSuccess_wake;
 
                     if (sensorSuccess_wake) {
@@ -690,12 +626,12 @@ bool VariableArray::completeUpdate(void) {
                 // If attempts were made to wake the sensor, but they failed
                 // then we're just bumping up the number of measurements to
                 // completion
-                if (bitRead(arrayOfVars[i]->parentSensor->getStatus(), 3) ==
+                if (bitRead(_sensorList[i]->getStatus(), 3) ==
                         1 &&
-                    bitRead(arrayOfVars[i]->parentSensor->getStatus(), 4) ==
+                    bitRead(_sensorList[i]->getStatus(), 4) ==
                         0) {
                     MS_DBG(i, F("--->>"),
-                           arrayOfVars[i]->getParentSensorNameAndLocation(),
+                           _sensorList[i]->getSensorNameAndLocation(),
                            F("did not wake up! No measurements will be taken! "
                              "<<---"),
                            i);
@@ -711,23 +647,22 @@ bool VariableArray::completeUpdate(void) {
 
                 // If the sensor was successfully awoken/activated...
                 // .. make sure the sensor is stable
-                if (bitRead(arrayOfVars[i]->parentSensor->getStatus(), 4) ==
+                if (bitRead(_sensorList[i]->getStatus(), 4) ==
                         1 &&
-                    arrayOfVars[i]->parentSensor->isStable(deepDebugTiming)) {
+                    _sensorList[i]->isStable(deepDebugTiming)) {
                     // If no attempt has yet been made to start a measurement,
                     // start one
-                    if (bitRead(arrayOfVars[i]->parentSensor->getStatus(), 5) ==
+                    if (bitRead(_sensorList[i]->getStatus(), 5) ==
                         0) {
                         // Start a reading
                         MS_DBG(i, '.', nMeasurementsCompleted[i] + 1,
                                F("--->> Starting reading"),
                                nMeasurementsCompleted[i] + 1, F("on"),
-                               arrayOfVars[i]->getParentSensorNameAndLocation(),
+                               _sensorList[i]->getSensorNameAndLocation(),
                                F("..."));
 
                         bool sensorSuccess_start =
-                            arrayOfVars[i]
-                                ->parentSensor->startSingleMeasurement();
+                            _sensorList[i]->startSingleMeasurement();
                         success &= sensorSuccess_start;
 
                         if (sensorSuccess_start) {
@@ -745,18 +680,17 @@ bool VariableArray::completeUpdate(void) {
                     // isMeasurementComplete(deepDebugTiming) will do that and
                     // we stil want the addSingleMeasurementResult() function to
                     // fill in the -9999 results for a failed measurement.
-                    if (arrayOfVars[i]->parentSensor->isMeasurementComplete(
+                    if (_sensorList[i]->isMeasurementComplete(
                             deepDebugTiming)) {
                         // Get the value
                         MS_DBG(i, '.', nMeasurementsCompleted[i] + 1,
                                F("--->> Collected result of reading"),
                                nMeasurementsCompleted[i] + 1, F("from"),
-                               arrayOfVars[i]->getParentSensorNameAndLocation(),
+                               _sensorList[i]->getSensorNameAndLocation(),
                                F("..."));
 
                         bool sensorSuccess_result =
-                            arrayOfVars[i]
-                                ->parentSensor->addSingleMeasurementResult();
+                            _sensorList[i]->addSingleMeasurementResult();
                         success &= sensorSuccess_result;
                         nMeasurementsCompleted[i] +=
                             1;  // increment the number of measurements that
@@ -779,12 +713,12 @@ bool VariableArray::completeUpdate(void) {
                 // If all the measurements are done
                 if (nMeasurementsCompleted[i] == nMeasurementsToAverage[i]) {
                     MS_DBG(i, F("--->> Finished all measurements from"),
-                           arrayOfVars[i]->getParentSensorNameAndLocation(),
+                           _sensorList[i]->getSensorNameAndLocation(),
                            F(", putting it to sleep. ..."));
 
                     // Put the completed sensor to sleep
                     bool sensorSuccess_sleep =
-                        arrayOfVars[i]->parentSensor->sleep();
+                        _sensorList[i]->sleep();
                     success &= sensorSuccess_sleep;
 
                     if (sensorSuccess_sleep) {
@@ -799,13 +733,12 @@ bool VariableArray::completeUpdate(void) {
                     // share the pin
                     if (nCompletedOnPin[powerPinIndex[i]] ==
                         nMeasurementsOnPin[powerPinIndex[i]]) {
-                        for (uint8_t k = 0; k < _variableCount; k++) {
-                            if (powerPinIndex[k] == powerPinIndex[i] &&
-                                lastSensorVariable[k]) {
-                                arrayOfVars[k]->parentSensor->powerDown();
+                        for (uint8_t k = 0; k < _sensorCount; k++) {
+                            if (powerPinIndex[k] == powerPinIndex[i]) {
+                                _sensorList[k]->powerDown();
                                 MS_DBG(k, F("--->>"),
-                                       arrayOfVars[k]
-                                           ->getParentSensorNameAndLocation(),
+                                       _sensorList[k]
+                                           ->getSensorNameAndLocation(),
                                        F("powered down. <<---"), k);
                             }
                         }
@@ -817,20 +750,25 @@ bool VariableArray::completeUpdate(void) {
                 }
             }
         }
+
+        // Let anything else that's waiting on this update have a turn
+        if (whileWaiting != nullptr && nSensorsCompleted < _sensorCount) {
+            whileWaiting(context);
+        }
     }
 
     // Average measurements and notify varibles of the updates
     MS_DBG(F("----->> Averaging results and notifying all variables. ..."));
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (lastSensorVariable[i]) {
-            MS_DBG(F("--- Averaging results from"),
-                   arrayOfVars[i]->getParentSensorNameAndLocation(), F("---"));
-            arrayOfVars[i]->parentSensor->averageMeasurements();
-            MS_DBG(F("--- Notifying variables from"),
-                   arrayOfVars[i]->getParentSensorNameAndLocation(), F("---"));
-            arrayOfVars[i]->parentSensor->notifyVariables();
-        }
-    }
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        MS_DBG(F("--- Averaging results from"),
+               _sensorList[i]->getSensorNameAndLocation(), F("---"));
+        _sensorList[i]->averageMeasurements();
+        MS_DBG(F("--- Notifying variables from"),
+               _sensorList[i]->getSensorNameAndLocation(), F("---"));
+        _sensorList[i]->notifyVariables();
+    }
+    calculateVariables();
+    _updateCount++;
     MS_DBG(F("... Complete. <<-----"));
 
     return success;
@@ -879,38 +817,91 @@ void VariableArray::printSensorData(Stream* stream) {
 }
 
 
-// Check for unique sensors
-bool VariableArray::isLastVarFromSensor(int arrayIndex) {
-    // Calculated Variables are never the last variable from a sensor, simply
-    // because the don't come from a sensor at all.
-    if (arrayOfVars[arrayIndex]->isCalculated) {
-        return false;
-    } else {
-        String sensNameLoc =
-            arrayOfVars[arrayIndex]->getParentSensorNameAndLocation();
+// Build the list of unique sensors, in the order of the last variable from
+// each sensor
+void VariableArray::buildSensorList(void) {
+    _sensorCount = 0;
+    // Work back from the end so each sensor is found at its last variable
+    for (int i = _variableCount - 1; i >= 0; i--) {
+        // Calculated Variables don't come from a sensor at all.
+        if (arrayOfVars[i]->isCalculated) continue;
+        Sensor* sensor = arrayOfVars[i]->parentSensor;
+        if (sensor == nullptr) continue;
         bool unique = true;
-        for (int j = arrayIndex + 1; j < _variableCount; j++) {
-            if (sensNameLoc ==
-                arrayOfVars[j]->getParentSensorNameAndLocation()) {
+        for (uint8_t j = 0; j < _sensorCount; j++) {
+            if (_sensorList[j] == sensor) {
                 unique = false;
                 break;
             }
         }
-        return unique;
+        if (!unique) continue;
+        if (_sensorCount >= MS_VARIABLEARRAY_MAX_SENSORS) {
+            PRINTOUT(F("Too many sensors!"), sensor->getSensorNameAndLocation(),
+                     F("will not be used.  Raise MS_VARIABLEARRAY_MAX_SENSORS."));
+            continue;
+        }
+        _sensorList[_sensorCount++] = sensor;
+    }
+    // Put them back in the order of the array
+    for (uint8_t j = 0; j < _sensorCount / 2; j++) {
+        Sensor* swap                        = _sensorList[j];
+        _sensorList[j]                      = _sensorList[_sensorCount - 1 - j];
+        _sensorList[_sensorCount - 1 - j] = swap;
     }
 }
 
 
+// Work out every calculated variable in the plan; inputs always come first
+void VariableArray::calculateVariables(void) {
+    for (uint8_t i = 0; i < _calculatedCount; i++) {
+        _calculationPlan[i]->calculate();
+    }
+}
+
+
+// Order the calculated variables so each one comes after the calculated
+// variables it takes as inputs
+void VariableArray::buildCalculationPlan(void) {
+    _calculatedCount = 0;
+    for (uint8_t i = 0; i < _variableCount; i++) {
+        addToCalculationPlan(arrayOfVars[i], 0);
+    }
+}
+
+
+// Adds a variable's calculated inputs to the plan, then the variable itself.
+// Going deeper than the plan can hold means the inputs loop back on themselves.
+bool VariableArray::addToCalculationPlan(Variable* var, uint8_t depth) {
+    if (var == nullptr || !var->isCalculated) return true;
+    for (uint8_t i = 0; i < _calculatedCount; i++) {
+        if (_calculationPlan[i] == var) return true;
+    }
+    if (depth >= MS_VARIABLEARRAY_MAX_CALCULATED) {
+        PRINTOUT(F("The inputs of"), var->getVarCode(),
+                 F("depend on themselves!  It will not be calculated ahead."));
+        return false;
+    }
+    for (uint8_t i = 0; i < var->getInputCount(); i++) {
+        if (!addToCalculationPlan(var->getInput(i), depth + 1)) return false;
+    }
+    if (_calculatedCount >= MS_VARIABLEARRAY_MAX_CALCULATED) {
+        PRINTOUT(F("Too many calculated variables!"), var->getVarCode(),
+                 F("will not be calculated ahead.  Raise "
+                   "MS_VARIABLEARRAY_MAX_CALCULATED."));
+        return false;
+    }
+    _calculationPlan[_calculatedCount++] = var;
+    return true;
+}
+
+
 // Count the maximum number of measurements needed from a single sensor for the
 // requested averaging
 uint8_t VariableArray::countMaxToAverage(void) {
     uint8_t numReps = 0;
-    for (uint8_t i = 0; i < _variableCount; i++) {
-        if (isLastVarFromSensor(i)) {  // Skip non-unique sensors
-            numReps = max(
-                numReps,
-                arrayOfVars[i]->parentSensor->getNumberMeasurementsToAverage());
-        }
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        numReps = max(numReps,
+                      _sensorList[i]->getNumberMeasurementsToAverage());
     }
     return numReps;
 }
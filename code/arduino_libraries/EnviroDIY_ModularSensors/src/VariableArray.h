@@ -32,6 +32,36 @@
 #include "VariableBase.h"
 #include "SensorBase.h"
 
+/**
+ * @def MS_VARIABLEARRAY_MAX_SENSORS
+ * @brief The most unique sensors a variable array can hold
+ *
+ * Each sensor takes one pointer in the sensor table.  Sensors beyond this
+ * number are not set up, woken, or measured.
+ *
+ * This can be changed by setting the build flag MS_VARIABLEARRAY_MAX_SENSORS
+ * when compiling.
+ */
+#ifndef MS_VARIABLEARRAY_MAX_SENSORS
+#define MS_VARIABLEARRAY_MAX_SENSORS 24
+#endif
+
+/**
+ * @def MS_VARIABLEARRAY_MAX_CALCULATED
+ * @brief The most calculated variables a variable array can work out
+ *
+ * This counts the calculated variables in the array and any calculated
+ * variables they take as inputs.  Calculated variables beyond this number are
+ * worked out each time their values are asked for, rather than once per
+ * update.
+ *
+ * This can be changed by setting the build flag
+ * MS_VARIABLEARRAY_MAX_CALCULATED when compiling.
+ */
+#ifndef MS_VARIABLEARRAY_MAX_CALCULATED
+#define MS_VARIABLEARRAY_MAX_CALCULATED 8
+#endif
+
 
 /**
  * @brief The variable array class defines the logic for iterating through many
@@ -58,7 +88,9 @@
  * That is, the first sensor to be warmed up will be set up or activated first;
  * the first sensor to stabilize will be asked for values first.
  * All calculations for any calculated variables happen after all the sensor
- * updating has finished.
+ * updating has finished.  Each calculated variable is worked out once per
+ * update, after any calculated variables it takes as inputs, and its value is
+ * kept until the next update no matter how many times it is read.
  * The order of the variables within the array should not matter, though for
  * code readability, I strongly suggest putting all the variables attached to a
  * single sensor next to each other in the array.
@@ -161,7 +193,6 @@ class VariableArray {
      */
     uint8_t getCalculatedVariableCount(void);
 
-    // This counts and returns the number of sensors
     /**
      * @brief Get the number of sensors associated with the variables in the
      * array.
@@ -171,7 +202,9 @@ class VariableArray {
      *
      * @return **uint8_t** The number of sensors
      */
-    uint8_t getSensorCount(void);
+    uint8_t getSensorCount(void) {
+        return _sensorCount;
+    }
 
     /**
      * @brief Match UUID's from the given variables in the variable array.
@@ -254,6 +287,40 @@ class VariableArray {
      * @return **bool** True if all steps of the update succeeded.
      */
     bool completeUpdate(void);
+    /**
+     * @brief Update the values for all connected sensors including powering
+     * them and waking and putting them to sleep, giving other work a turn
+     * while they warm up, stabilize and measure.
+     *
+     * This is the same as completeUpdate(void), but calls a function after
+     * each pass over the sensors.  The sensors aren't checked again until the
+     * function returns, so it should do a little at a time.
+     *
+     * @param whileWaiting The function to call between passes
+     * @param context Handed to the function each time it is called
+     * @return **bool** True if all steps of the update succeeded.
+     */
+    bool completeUpdate(void (*whileWaiting)(void*), void* context);
+
+    /**
+     * @brief Work out every calculated variable, each after its inputs.
+     *
+     * This is called at the end of updateAllSensors() and completeUpdate().
+     */
+    void calculateVariables(void);
+
+    /**
+     * @brief Get the number of updates the array has finished.
+     *
+     * This goes up by one each time updateAllSensors() or completeUpdate()
+     * finishes, wrapping around at 255, so anything that keeps values from the
+     * array can tell when they have changed.
+     *
+     * @return **uint8_t** The number of finished updates
+     */
+    uint8_t getUpdateCount(void) {
+        return _updateCount;
+    }
 
     /**
      * @brief Print out the results for all connected sensors to a stream
@@ -281,9 +348,33 @@ class VariableArray {
      * @brief The maximum number of samples to average of an single sensor.
      */
     uint8_t _maxSamplestoAverage;
+    /**
+     * @brief The unique sensors tied to variables in the array, in the order
+     * of the last variable from each sensor.
+     *
+     * This is built once by begin() so the sensor loops don't have to compare
+     * every variable's parent sensor against every other variable's.
+     */
+    Sensor* _sensorList[MS_VARIABLEARRAY_MAX_SENSORS];
+    /**
+     * @brief The count of calculated variables in the calculation plan
+     */
+    uint8_t _calculatedCount;
+    /**
+     * @brief The calculated variables, ordered so each comes after its inputs
+     *
+     * This is built once by begin().
+     */
+    Variable* _calculationPlan[MS_VARIABLEARRAY_MAX_CALCULATED];
+    /**
+     * @brief The number of updates finished, wrapping around at 255
+     */
+    uint8_t _updateCount;
 
  private:
-    bool    isLastVarFromSensor(int arrayIndex);
+    void    buildSensorList(void);
+    void    buildCalculationPlan(void);
+    bool    addToCalculationPlan(Variable* var, uint8_t depth);
     uint8_t countMaxToAverage(void);
     bool    checkVariableUUIDs(void);
 
@@ -294,11 +385,12 @@ class VariableArray {
      *
      * @tparam T Any printable type
      * @param arrayToPrint The array of values to print.
+     * @param count The number of values in the array.
      */
     template <typename T>
-    void prettyPrintArray(T arrayToPrint[]) {
+    void prettyPrintArray(T arrayToPrint[], uint8_t count) {
         DEEP_DEBUGGING_SERIAL_OUTPUT.print("[,\t");
-        for (uint8_t i = 0; i < _variableCount; i++) {
+        for (uint8_t i = 0; i < count; i++) {
             DEEP_DEBUGGING_SERIAL_OUTPUT.print(arrayToPrint[i]);
             DEEP_DEBUGGING_SERIAL_OUTPUT.print(",\t");
         }
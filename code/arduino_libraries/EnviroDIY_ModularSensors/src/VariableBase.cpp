@@ -65,6 +65,32 @@ Variable::Variable(float (*calcFxn)(), uint8_t decimalResolution,
     setCalculation(calcFxn);
 }
 
+Variable::Variable(float (*calcFxn)(const float* inputs),
+                   Variable* const inputs[], uint8_t inputCount,
+                   uint8_t decimalResolution, const char* varName,
+                   const char* varUnit, const char* varCode, const char* uuid)
+    : isCalculated(true) {
+    setVarUUID(uuid);
+    setVarCode(varCode);
+    setVarUnit(varUnit);
+    setVarName(varName);
+    setResolution(decimalResolution);
+
+    setCalculation(calcFxn, inputs, inputCount);
+}
+Variable::Variable(float (*calcFxn)(const float* inputs),
+                   Variable* const inputs[], uint8_t inputCount,
+                   uint8_t decimalResolution, const char* varName,
+                   const char* varUnit, const char* varCode)
+    : isCalculated(true) {
+    setVarCode(varCode);
+    setVarUnit(varUnit);
+    setVarName(varName);
+    setResolution(decimalResolution);
+
+    setCalculation(calcFxn, inputs, inputCount);
+}
+
 // constructor with no arguments
 Variable::Variable() : isCalculated(true) {}
 // Destructor
@@ -158,7 +184,52 @@ String Variable::getParentSensorNameAndLocation(void) {
 
 // This ties a calculated variable to its calculation function
 void Variable::setCalculation(float (*calcFxn)()) {
-    if (isCalculated) { _calcFxn = calcFxn; }
+    if (isCalculated) {
+        _calcFxn       = calcFxn;
+        _calcInputsFxn = nullptr;
+        _inputCount    = 0;
+    }
+}
+
+
+// This ties a calculated variable to a calculation function and the variables
+// whose values are handed to it
+void Variable::setCalculation(float (*calcFxn)(const float* inputs),
+                              Variable* const inputs[], uint8_t inputCount) {
+    if (!isCalculated) return;
+    if (inputCount > MS_MAX_CALCULATION_INPUTS) {
+        PRINTOUT(F("Too many inputs for"), _varCode,
+                 F("!  Raise MS_MAX_CALCULATION_INPUTS."));
+        inputCount = MS_MAX_CALCULATION_INPUTS;
+    }
+    _calcFxn       = nullptr;
+    _calcInputsFxn = calcFxn;
+    _inputs        = inputs;
+    _inputCount    = inputCount;
+}
+
+
+// This works out a calculated variable's value and keeps it for getValue()
+float Variable::calculate(void) {
+    if (!isCalculated) return _currentValue;
+    _currentValue    = calculateNow();
+    _calculationKept = true;
+    MS_DBG(F("Calculated"), _varCode, F("as"), _currentValue);
+    return _currentValue;
+}
+
+
+// This runs whichever calculation function the variable has
+float Variable::calculateNow(void) {
+    if (_calcInputsFxn != nullptr) {
+        float inputValues[MS_MAX_CALCULATION_INPUTS];
+        for (uint8_t i = 0; i < _inputCount; i++) {
+            inputValues[i] = _inputs[i]->getValue();
+        }
+        return _calcInputsFxn(inputValues);
+    }
+    if (_calcFxn != nullptr) return _calcFxn();
+    return -9999;
 }
 
 
@@ -191,6 +262,9 @@ void Variable::setVarUnit(const char* varUnit) {
 String Variable::getVarCode(void) {
     return _varCode;
 }
+const char* Variable::getVarCodeChar(void) {
+    return _varCode == nullptr ? "" : _varCode;
+}
 // This sets the variable code to a new custom value
 void Variable::setVarCode(const char* varCode) {
     _varCode = varCode;
@@ -200,6 +274,9 @@ void Variable::setVarCode(const char* varCode) {
 String Variable::getVarUUID(void) {
     return _uuid;
 }
+const char* Variable::getVarUUIDChar(void) {
+    return _uuid == nullptr ? "" : _uuid;
+}
 // This sets the UUID
 void Variable::setVarUUID(const char* uuid) {
     _uuid = uuid;
@@ -242,7 +319,8 @@ float Variable::getValue(bool updateValue) {
         // the calculation because we don't know which sensors those are.
         // Make sure you update the parent sensors manually for a calculated
         // variable!!
-        return _calcFxn();
+        if (_calculationKept) return _currentValue;
+        return calculateNow();
     } else {
         if (updateValue) parentSensor->update();
         return _currentValue;
@@ -253,11 +331,20 @@ float Variable::getValue(bool updateValue) {
 // This returns the current value of the variable as a string
 // with the correct number of significant figures
 String Variable::getValueString(bool updateValue) {
+    char text[MS_VALUE_TEXT_SIZE];
+    formatValue(getValue(updateValue), _decimalResolution, text);
+    return String(text);
+}
+
+
+// This writes a value out as text, the same way String(int16_t) and
+// String(float, decimals) would
+uint8_t Variable::formatValue(float value, uint8_t resolution, char* out) {
     // Need this because otherwise get extra spaces in strings from int
-    if (_decimalResolution == 0) {
-        auto val = static_cast<int16_t>(getValue(updateValue));
-        return String(val);
+    if (resolution == 0) {
+        itoa(static_cast<int16_t>(value), out, 10);
     } else {
-        return String(getValue(updateValue), _decimalResolution);
+        dtostrf(value, resolution + 2, resolution, out);
     }
+    return strlen(out);
 }
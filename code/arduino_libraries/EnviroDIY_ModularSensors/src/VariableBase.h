@@ -27,6 +27,27 @@ class Sensor;
 #include "ModSensorDebugger.h"
 #undef MS_DEBUGGING_STD
 
+/**
+ * @def MS_MAX_CALCULATION_INPUTS
+ * @brief The most input variables a calculated variable can declare
+ *
+ * This can be changed by setting the build flag MS_MAX_CALCULATION_INPUTS when
+ * compiling.
+ */
+#ifndef MS_MAX_CALCULATION_INPUTS
+#define MS_MAX_CALCULATION_INPUTS 4
+#endif
+
+/**
+ * @def MS_VALUE_TEXT_SIZE
+ * @brief The room needed to write out any value, including its terminating
+ * null
+ *
+ * A float can have 39 digits before the decimal point; this leaves room for
+ * those, a sign, the point, and up to six decimal places.
+ */
+#define MS_VALUE_TEXT_SIZE 48
+
 /**
  * @brief The variable class for a value and related metadata.
  *
@@ -130,6 +151,54 @@ class Variable {
      */
     Variable(float (*calcFxn)(), uint8_t decimalResolution, const char* varName,
              const char* varUnit, const char* varCode);
+    /**
+     * @brief Construct a new Variable object for a calculated variable whose
+     * inputs are other variables.
+     *
+     * The values of the inputs are handed to the calcFxn, in order.  A
+     * variable array works out its calculated variables after their inputs,
+     * once per update, so inputs may themselves be calculated.
+     *
+     * @param calcFxn Any function taking the input values and returning a
+     * float value
+     * @param inputs An array of the input variables; it must outlive the
+     * variable.
+     * @param inputCount The number of inputs, up to
+     * #MS_MAX_CALCULATION_INPUTS.
+     * @param decimalResolution The resolution (in decimal places) of the value.
+     * @param varName The name of the variable per the [ODM2 variable name
+     * controlled vocabulary](http://vocabulary.odm2.org/variablename/)
+     * @param varUnit The unit of the variable per the [ODM2 unit controlled
+     * vocabulary](http://vocabulary.odm2.org/units/)
+     * @param varCode A custom code for the variable.  This can be any short
+     * text helping to identify the variable in files.
+     * @param uuid A universally unique identifier for the variable.
+     */
+    Variable(float (*calcFxn)(const float* inputs), Variable* const inputs[],
+             uint8_t inputCount, uint8_t decimalResolution,
+             const char* varName, const char* varUnit, const char* varCode,
+             const char* uuid);
+    /**
+     * @brief Construct a new Variable object for a calculated variable whose
+     * inputs are other variables.
+     *
+     * @param calcFxn Any function taking the input values and returning a
+     * float value
+     * @param inputs An array of the input variables; it must outlive the
+     * variable.
+     * @param inputCount The number of inputs, up to
+     * #MS_MAX_CALCULATION_INPUTS.
+     * @param decimalResolution The resolution (in decimal places) of the value.
+     * @param varName The name of the variable per the [ODM2 variable name
+     * controlled vocabulary](http://vocabulary.odm2.org/variablename/)
+     * @param varUnit The unit of the variable per the [ODM2 unit controlled
+     * vocabulary](http://vocabulary.odm2.org/units/)
+     * @param varCode A custom code for the variable.  This can be any short
+     * text helping to identify the variable in files.
+     */
+    Variable(float (*calcFxn)(const float* inputs), Variable* const inputs[],
+             uint8_t inputCount, uint8_t decimalResolution,
+             const char* varName, const char* varUnit, const char* varCode);
     /**
      * @brief Construct a new Variable object
      */
@@ -256,6 +325,47 @@ class Variable {
      * @param calcFxn Any function returning a float value.
      */
     void setCalculation(float (*calcFxn)());
+    /**
+     * @brief Set the calculation function and its input variables for a
+     * calculated variable
+     *
+     * @param calcFxn Any function taking the input values and returning a
+     * float value.
+     * @param inputs An array of the input variables; it must outlive the
+     * variable.
+     * @param inputCount The number of inputs, up to
+     * #MS_MAX_CALCULATION_INPUTS.
+     */
+    void setCalculation(float (*calcFxn)(const float* inputs),
+                        Variable* const inputs[], uint8_t inputCount);
+    /**
+     * @brief Get the number of variables a calculated variable depends on.
+     *
+     * @return **uint8_t** The number of declared inputs; 0 for a measured
+     * variable or a calculation without declared inputs.
+     */
+    uint8_t getInputCount(void) {
+        return _inputCount;
+    }
+    /**
+     * @brief Get one of the variables a calculated variable depends on.
+     *
+     * @param inputNumber The position of the input
+     * @return **Variable\*** The input variable
+     */
+    Variable* getInput(uint8_t inputNumber) {
+        return _inputs[inputNumber];
+    }
+    /**
+     * @brief Work out a calculated variable's value and keep it.
+     *
+     * Once this has been called, getValue() gives back the kept value rather
+     * than calculating it again; a variable array calls this for each of its
+     * calculated variables after every update.
+     *
+     * @return **float** The calculated value
+     */
+    float calculate(void);
 
     // This gets/sets the variable's resolution for value strings
     /**
@@ -308,6 +418,14 @@ class Variable {
      * @return **String** The customized code for the variable
      */
     String getVarCode(void);
+    /**
+     * @brief Get the customized code for the variable without copying it into
+     * a String
+     *
+     * @return **const char*** The customized code, or an empty string if none
+     * has been given
+     */
+    const char* getVarCodeChar(void);
     /**
      * @brief Set a customized code for the variable
      *
@@ -322,6 +440,13 @@ class Variable {
      * @return **String** The customized code for the variable
      */
     String getVarUUID(void);
+    /**
+     * @brief Get the UUID for the variable without copying it into a String
+     *
+     * @return **const char*** The UUID, or an empty string if none has been
+     * assigned
+     */
+    const char* getVarUUIDChar(void);
     /**
      * @brief Set a customized code for the variable
      *
@@ -341,6 +466,9 @@ class Variable {
     /**
      * @brief Get current value of the variable as a float
      *
+     * A calculated variable is calculated on every call until calculate() has
+     * been called for it; after that the calculated value is kept.
+     *
      * @param updateValue True to ask the parent sensor to measure and return a
      * new value.  Default is false.
      * @return **float** The current value of the variable
@@ -355,6 +483,21 @@ class Variable {
      * @return **String** The current value of the variable
      */
     String getValueString(bool updateValue = false);
+    /**
+     * @brief Write a value out as text exactly the way getValueString() does,
+     * without making a String.
+     *
+     * Values with a resolution of 0 are written as whole numbers; others with
+     * that many decimal places.
+     *
+     * @param value The value to write out
+     * @param resolution The number of decimal places
+     * @param out Where to write the value; this must hold at least
+     * #MS_VALUE_TEXT_SIZE characters.
+     * @return **uint8_t** The number of characters written, not counting the
+     * terminating null
+     */
+    static uint8_t formatValue(float value, uint8_t resolution, char* out);
 
     /**
      * @brief Pointer to the parent sensor
@@ -376,7 +519,14 @@ class Variable {
 
 
  private:
+    float calculateNow(void);
+
     float (*_calcFxn)(void) = nullptr;
+    float (*_calcInputsFxn)(const float* inputs) = nullptr;
+    Variable* const* _inputs     = nullptr;
+    uint8_t          _inputCount = 0;
+    /// True once calculate() has kept a calculated value
+    bool _calculationKept = false;
 
     const uint8_t _sensorVarNum      = 0;
     uint8_t       _decimalResolution = 0;
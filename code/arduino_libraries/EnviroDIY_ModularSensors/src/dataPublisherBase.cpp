@@ -10,7 +10,9 @@
  */
 #include "dataPublisherBase.h"
 
-char dataPublisher::txBuffer[MS_SEND_BUFFER_SIZE] = {'\0'};
+char     dataPublisher::txBuffer[MS_SEND_BUFFER_SIZE] = {'\0'};
+uint16_t dataPublisher::txBufferLen                   = 0;
+Stream*  dataPublisher::txBufferOutStream             = nullptr;
 
 // Basic chunks of HTTP
 const char* dataPublisher::getHeader  = "GET ";
@@ -54,13 +56,26 @@ void dataPublisher::attachToLogger(Logger& baseLogger) {
 
 
 // Sets the parameters for frequency of sending and any offset, if needed
-// NOTE:  These parameters are not currently used!!
 void dataPublisher::setSendFrequency(uint8_t sendEveryX, uint8_t sendOffset) {
     _sendEveryX = sendEveryX;
     _sendOffset = sendOffset;
 }
 
 
+// Checks if this interval is one the publisher sends on
+bool dataPublisher::isDueToSend(uint8_t adding) {
+    // A publisher that can't keep any more has to send now, whatever the
+    // schedule says
+    if (_sendEveryX <= 1 || cacheRoom() <= adding) return true;
+    if (_baseLogger == nullptr || _baseLogger->getLoggingInterval() == 0) {
+        return true;
+    }
+    uint32_t interval = Logger::markedLocalEpochTime /
+        (static_cast<uint32_t>(_baseLogger->getLoggingInterval()) * 60);
+    return interval % _sendEveryX == _sendOffset % _sendEveryX;
+}
+
+
 // "Begins" the publisher - attaches client and logger
 void dataPublisher::begin(Logger& baseLogger, Client* inClient) {
     setClient(inClient);
@@ -75,6 +90,7 @@ void dataPublisher::begin(Logger& baseLogger) {
 void dataPublisher::emptyTxBuffer(void) {
     MS_DBG(F("Dumping the TX Buffer"));
     for (int i = 0; i < MS_SEND_BUFFER_SIZE; i++) { txBuffer[i] = '\0'; }
+    txBufferLen = 0;
 }
 
 
@@ -104,6 +120,53 @@ void dataPublisher::printTxBuffer(Stream* stream, bool addNewLine) {
 }
 
 
+// Starts filling the tx buffer by keeping track of its length
+void dataPublisher::txBufferInit(Stream* stream) {
+    txBufferOutStream = stream;
+    txBufferLen       = 0;
+}
+
+
+// Adds text to the tx buffer, sending it out each time it fills up
+void dataPublisher::txBufferAppend(const char* text) {
+    while (*text != '\0') {
+        if (txBufferLen == MS_SEND_BUFFER_SIZE) txBufferFlush();
+        txBuffer[txBufferLen++] = *text++;
+    }
+}
+void dataPublisher::txBufferAppend(const char* text, uint16_t length) {
+    while (length > 0) {
+        if (txBufferLen == MS_SEND_BUFFER_SIZE) txBufferFlush();
+        uint16_t room  = MS_SEND_BUFFER_SIZE - txBufferLen;
+        uint16_t piece = length < room ? length : room;
+        memcpy(txBuffer + txBufferLen, text, piece);
+        txBufferLen += piece;
+        text += piece;
+        length -= piece;
+    }
+}
+void dataPublisher::txBufferAppend(char c) {
+    if (txBufferLen == MS_SEND_BUFFER_SIZE) txBufferFlush();
+    txBuffer[txBufferLen++] = c;
+}
+
+
+// Sends the filled part of the tx buffer to the stream and starts it over
+void dataPublisher::txBufferFlush(bool addNewLine) {
+#if defined(STANDARD_SERIAL_OUTPUT)
+    STANDARD_SERIAL_OUTPUT.write(txBuffer, txBufferLen);
+    if (addNewLine) { PRINTOUT('\n'); }
+    STANDARD_SERIAL_OUTPUT.flush();
+#endif
+    if (txBufferOutStream != nullptr) {
+        txBufferOutStream->write(txBuffer, txBufferLen);
+        if (addNewLine) { txBufferOutStream->print("\r\n"); }
+        txBufferOutStream->flush();
+    }
+    txBufferLen = 0;
+}
+
+
 // This sends data on the "default" client of the modem
 int16_t dataPublisher::publishData() {
     if (_inClient == nullptr) {
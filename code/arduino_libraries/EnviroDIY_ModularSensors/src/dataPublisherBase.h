@@ -86,11 +86,10 @@ class dataPublisher {
      * logger.
      *
      * @param baseLogger The logger supplying the data to be published
-     * @param sendEveryX Currently unimplemented, intended for future use to
-     * enable caching and bulk publishing
-     * @param sendOffset Currently unimplemented, intended for future use to
-     * enable publishing data at a time slightly delayed from when it is
-     * collected
+     * @param sendEveryX The number of logging intervals between sends, for
+     * publishers that can hold on to data; see isDueToSend()
+     * @param sendOffset The interval, counting from 0, within each group of
+     * sendEveryX intervals that the data is sent on
      *
      * @note It is possible (though very unlikey) that using this constructor
      * could cause errors if the compiler attempts to initialize the publisher
@@ -107,11 +106,10 @@ class dataPublisher {
      * @param inClient An Arduino client instance to use to print data to.
      * Allows the use of any type of client and multiple clients tied to a
      * single TinyGSM modem instance
-     * @param sendEveryX Currently unimplemented, intended for future use to
-     * enable caching and bulk publishing
-     * @param sendOffset Currently unimplemented, intended for future use to
-     * enable publishing data at a time slightly delayed from when it is
-     * collected
+     * @param sendEveryX The number of logging intervals between sends, for
+     * publishers that can hold on to data; see isDueToSend()
+     * @param sendOffset The interval, counting from 0, within each group of
+     * sendEveryX intervals that the data is sent on
      *
      * @note It is possible (though very unlikey) that using this constructor
      * could cause errors if the compiler attempts to initialize the publisher
@@ -148,13 +146,10 @@ class dataPublisher {
      * @brief Set the parameters for frequency of sending and any offset, if
      * needed.
      *
-     * @param sendEveryX Currently unimplemented, intended for future use to
-     * enable caching and bulk publishing
-     * @param sendOffset Currently unimplemented, intended for future use to
-     * enable publishing data at a time slightly delayed from when it is
-     * collected
-     *
-     * @note These parameters are not currently used!
+     * @param sendEveryX The number of logging intervals between sends, for
+     * publishers that can hold on to data; see isDueToSend()
+     * @param sendOffset The interval, counting from 0, within each group of
+     * sendEveryX intervals that the data is sent on
      */
     void setSendFrequency(uint8_t sendEveryX, uint8_t sendOffset);
 
@@ -268,6 +263,41 @@ class dataPublisher {
      */
     String parseMQTTState(int state);
 
+    /**
+     * @brief Keep the logger's current values so they can be sent later.
+     *
+     * Publishers that can hold on to more than one interval override this.
+     * The default keeps nothing, and those publishers send every interval.
+     */
+    virtual void cacheData(void) {}
+    /**
+     * @brief Get the number of intervals the publisher can still keep before
+     * it has to start dropping the oldest.
+     *
+     * @return **uint8_t** The room left; always 0 for publishers that keep
+     * nothing between sends
+     */
+    virtual uint8_t cacheRoom(void) {
+        return 0;
+    }
+    /**
+     * @brief Check whether the publisher should send its data at the logger's
+     * current marked time.
+     *
+     * The intervals are counted from midnight, January 1, 1970 in the logger's
+     * time zone, so the sends land on the same intervals after a restart.  A
+     * publisher is due on every sendEveryX'th interval, starting with the one
+     * numbered sendOffset.  A publisher that has no room left for another
+     * interval is due whatever the schedule says, so nothing is dropped as
+     * long as the send goes through.
+     *
+     * @param adding The number of intervals about to be added with
+     * cacheData(); lets the logger decide before the sensors are updated
+     * @return **bool** True if the modem should be woken to send this
+     * publisher's data
+     */
+    bool isDueToSend(uint8_t adding = 0);
+
 
  protected:
     /**
@@ -305,13 +335,64 @@ class dataPublisher {
     static void printTxBuffer(Stream* stream, bool addNewLine = false);
 
     /**
-     * @brief Unimplemented; intended for future use to enable caching and bulk
-     * publishing.
+     * @brief The number of characters in the TX buffer when it is being
+     * filled with txBufferAppend().
+     */
+    static uint16_t txBufferLen;
+    /**
+     * @brief The stream the TX buffer is written out to when it fills up
+     * while being filled with txBufferAppend().
+     */
+    static Stream* txBufferOutStream;
+    /**
+     * @brief Start filling the TX buffer with txBufferAppend().
+     *
+     * The buffer keeps track of how full it is rather than being read with
+     * strlen(), and is written out to the stream whenever it fills up, so a
+     * request of any length can be built up one piece at a time without
+     * checking for room first.
+     *
+     * @param stream A pointer to an Arduino Stream instance to write the
+     * buffer out to
+     */
+    static void txBufferInit(Stream* stream);
+    /**
+     * @brief Add text to the TX buffer, writing the buffer out whenever it
+     * fills up.
+     *
+     * @param text The null-terminated text to add
+     */
+    static void txBufferAppend(const char* text);
+    /**
+     * @brief Add a number of characters to the TX buffer, writing the buffer
+     * out whenever it fills up.
+     *
+     * @param text The characters to add
+     * @param length The number of characters to add
+     */
+    static void txBufferAppend(const char* text, uint16_t length);
+    /**
+     * @brief Add a single character to the TX buffer, writing the buffer out
+     * if it is full.
+     *
+     * @param c The character to add
+     */
+    static void txBufferAppend(char c);
+    /**
+     * @brief Write whatever is in the TX buffer out to the stream given to
+     * txBufferInit() and to the debugging port, then start it over.
+     *
+     * @param addNewLine True to add a new line character ("\n") at the end of
+     * the print
+     */
+    static void txBufferFlush(bool addNewLine = false);
+
+    /**
+     * @brief The number of logging intervals between sends
      */
     uint8_t _sendEveryX = 1;
     /**
-     * @brief Unimplemented; intended for future use to enable publishing data
-     * at a time slightly delayed from when it is collected.
+     * @brief The interval within each group of _sendEveryX that is sent on
      */
     uint8_t _sendOffset = 0;
 
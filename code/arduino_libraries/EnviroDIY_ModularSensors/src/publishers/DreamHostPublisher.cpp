@@ -63,9 +63,9 @@ void DreamHostPublisher::printSensorDataDreamHost(Stream* stream) {
 
     for (uint8_t i = 0; i < _baseLogger->getArrayVarCount(); i++) {
         stream->print('&');
-        stream->print(_baseLogger->getVarCodeAtI(i));
+        stream->print(_baseLogger->getVarCodeCharAtI(i));
         stream->print('=');
-        stream->print(_baseLogger->getValueStringAtI(i));
+        stream->print(_baseLogger->getValueCharAtI(i));
     }
 }
 
@@ -140,13 +140,13 @@ int16_t DreamHostPublisher::publishData(Client* outClient) {
             if (bufferFree() < 47) printTxBuffer(outClient);
 
             txBuffer[strlen(txBuffer)] = '&';
-            _baseLogger->getVarCodeAtI(i).toCharArray(tempBuffer, 37);
             snprintf(txBuffer + strlen(txBuffer),
-                     sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+                     sizeof(txBuffer) - strlen(txBuffer), "%s",
+                     _baseLogger->getVarCodeCharAtI(i));
             txBuffer[strlen(txBuffer)] = '=';
-            _baseLogger->getValueStringAtI(i).toCharArray(tempBuffer, 37);
             snprintf(txBuffer + strlen(txBuffer),
-                     sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+                     sizeof(txBuffer) - strlen(txBuffer), "%s",
+                     _baseLogger->getValueCharAtI(i));
         }
 
         // add the rest of the HTTP GET headers to the outgoing buffer
@@ -73,7 +73,7 @@ uint16_t EnviroDIYPublisher::calculateJsonSize() {
         jsonLength += 1;   //  "
         jsonLength += 36;  // variable UUID
         jsonLength += 2;   //  ":
-        jsonLength += _baseLogger->getValueStringAtI(i).length();
+        jsonLength += _baseLogger->getValueLengthAtI(i);
         if (i + 1 != _baseLogger->getArrayVarCount()) {
             jsonLength += 1;  // ,
         }
@@ -93,9 +93,9 @@ void EnviroDIYPublisher::printSensorDataJSON(Stream* stream) {
 
     for (uint8_t i = 0; i < _baseLogger->getArrayVarCount(); i++) {
         stream->print('"');
-        stream->print(_baseLogger->getVarUUIDAtI(i));
+        stream->print(_baseLogger->getVarUUIDCharAtI(i));
         stream->print(F("\":"));
-        stream->print(_baseLogger->getValueStringAtI(i));
+        stream->print(_baseLogger->getValueCharAtI(i));
         if (i + 1 != _baseLogger->getArrayVarCount()) { stream->print(','); }
     }
 
@@ -217,14 +217,14 @@ int16_t EnviroDIYPublisher::publishData(Client* outClient) {
             if (bufferFree() < 47) printTxBuffer(outClient);
 
             txBuffer[strlen(txBuffer)] = '"';
-            _baseLogger->getVarUUIDAtI(i).toCharArray(tempBuffer, 37);
             snprintf(txBuffer + strlen(txBuffer),
-                     sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+                     sizeof(txBuffer) - strlen(txBuffer), "%s",
+                     _baseLogger->getVarUUIDCharAtI(i));
             txBuffer[strlen(txBuffer)] = '"';
             txBuffer[strlen(txBuffer)] = ':';
-            _baseLogger->getValueStringAtI(i).toCharArray(tempBuffer, 37);
             snprintf(txBuffer + strlen(txBuffer),
-                     sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+                     sizeof(txBuffer) - strlen(txBuffer), "%s",
+                     _baseLogger->getValueCharAtI(i));
             if (i + 1 != _baseLogger->getArrayVarCount()) {
                 txBuffer[strlen(txBuffer)] = ',';
             } else {
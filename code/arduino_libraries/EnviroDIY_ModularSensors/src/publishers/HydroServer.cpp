@@ -62,28 +62,126 @@ void HydroServerPublisher::setAuthorization(const char* base64Authorization) {
 }
 
 
-// Calculates how long the JSON will be
-uint16_t HydroServerPublisher::calculateJsonSize() {
-    uint16_t jsonLength = 1;   // [
-    for (uint8_t i = 0; i < _baseLogger->getArrayVarCount(); i++) {
-        jsonLength += 15;          // {"Datastream":{
-        jsonLength += 10;          // "@iot.id":
-        jsonLength += 1;           // "
-        jsonLength += 36;          // *Datastream ID*
-        jsonLength += 3;           // "},
-        jsonLength += 41;          // "components":["phenomenonTime","result"],
-        jsonLength += 13;          // "dataArray":[
-        jsonLength += 29;          // ["*phenomenonTime*",
-        jsonLength += _baseLogger->getValueStringAtI(i).length(); // *result*
-        if (i == _baseLogger->getArrayVarCount() - 1) {
-            jsonLength += 3;       // ]]}
+// The room for each formatted timestamp, like "2025-01-01T00:00:00-07:00"
+#define HYDROSERVER_TIMESTAMP_SIZE 26
+
+
+// Adds this interval's values to those waiting to be sent
+void HydroServerPublisher::cacheRow(void) {
+    uint8_t varCount = cachedVarCount();
+    if (varCount < _baseLogger->getArrayVarCount()) {
+        PRINTOUT(F("MS_HYDROSERVER_CACHE_SIZE is too small to hold every "
+                   "variable!"));
+    }
+    if (varCount == 0) return;
+
+    // Make room by dropping the oldest intervals
+    uint8_t capacity = rowCapacity();
+    if (_rowCount >= capacity) {
+        uint8_t drop = _rowCount - capacity + 1;
+        _rowCount -= drop;
+        memmove(_rowTimes, _rowTimes + drop, _rowCount * sizeof(_rowTimes[0]));
+        memmove(_rowValues, _rowValues + drop * varCount,
+                _rowCount * varCount * sizeof(_rowValues[0]));
+        for (uint8_t i = 0; i < varCount; i++) {
+            _sentRows[i] = _sentRows[i] > drop ? _sentRows[i] - drop : 0;
         }
-        else {
-            jsonLength += 4;       // ]]},
+        PRINTOUT(drop, F("unsent interval(s) dropped for HydroServer"));
+    }
+
+    _rowTimes[_rowCount] = Logger::markedLocalEpochTime;
+    float* row           = _rowValues + _rowCount * varCount;
+    for (uint8_t i = 0; i < varCount; i++) {
+        row[i] = _baseLogger->getValueAtI(i);
+    }
+    _rowCount++;
+}
+
+
+void HydroServerPublisher::cacheData(void) {
+    // Only once for each interval, however many times it's asked
+    if (_rowCount > 0 &&
+        _rowTimes[_rowCount - 1] == Logger::markedLocalEpochTime) {
+        return;
+    }
+    cacheRow();
+    if (!isDueToSend()) {
+        PRINTOUT(F("Holding interval"), _rowCount, F("for HydroServer"));
+    }
+}
+
+
+uint8_t HydroServerPublisher::cacheRoom(void) {
+    if (cachedVarCount() == 0) return 0;
+    uint8_t capacity = rowCapacity();
+    return _rowCount < capacity ? capacity - _rowCount : 0;
+}
+
+
+uint8_t HydroServerPublisher::cachedVarCount(void) {
+    uint8_t varCount = _baseLogger->getArrayVarCount();
+    return varCount < MS_HYDROSERVER_CACHE_SIZE ? varCount
+                                                : MS_HYDROSERVER_CACHE_SIZE;
+}
+
+
+uint8_t HydroServerPublisher::rowCapacity(void) {
+    uint16_t rows = MS_HYDROSERVER_CACHE_SIZE / cachedVarCount();
+    return rows < MS_HYDROSERVER_MAX_ROWS ? rows : MS_HYDROSERVER_MAX_ROWS;
+}
+
+
+// Measures a variable's object, keeping as many of the formatted values as
+// will fit so they don't have to be formatted again to be sent
+uint16_t HydroServerPublisher::measureDatastream(
+    uint8_t i, uint8_t timestampLength, char* values, uint16_t size,
+    uint16_t& used, uint16_t& kept, uint16_t& counted) {
+    // Everything in the object other than the UUID and the rows:
+    // {"Datastream":{"@iot.id":"*UUID*"},"components":["phenomenonTime",
+    // "result"],"dataArray":[*rows*]}
+    uint16_t length = strlen(datastreamTag) + strlen(iotTag) +
+        strlen(componentsTag) + strlen(dataArrayTag) + 9;
+    length += strlen(_baseLogger->getVarUUIDCharAtI(i));
+    length += _rowCount - _sentRows[i] - 1;  // the commas between rows
+
+    uint8_t resolution = _baseLogger->getVarResolutionAtI(i);
+    char    scratch[MS_VALUE_TEXT_SIZE];
+    for (uint8_t r = _sentRows[i]; r < _rowCount; r++) {
+        // ["*timestamp*",*value*]
+        uint8_t valueLength =
+            Variable::formatValue(rowValue(r, i), resolution, scratch);
+        length += 5 + timestampLength + valueLength;
+
+        // Keep the values in order until one doesn't fit
+        if (kept == counted && used + 1 + valueLength <= size) {
+            values[used] = valueLength;
+            memcpy(values + used + 1, scratch, valueLength);
+            used += 1 + valueLength;
+            kept++;
         }
+        counted++;
     }
-    jsonLength += 1;               // ]
+    return length;
+}
+
 
+// Calculates how long the JSON will be
+uint16_t HydroServerPublisher::calculateJsonSize() {
+    uint8_t timestampLength = 0;
+    if (_rowCount > 0) {
+        timestampLength =
+            Logger::formatDateTime_ISO8601(_rowTimes[0]).length();
+    }
+    uint16_t used = 0, kept = 0, counted = 0;
+    uint16_t jsonLength = 2;  // [ and ]
+    bool     any        = false;
+    for (uint8_t i = 0; i < cachedVarCount(); i++) {
+        if (!unsent(i)) continue;
+        if (any) jsonLength++;  // the comma between
+        jsonLength += measureDatastream(i, timestampLength, nullptr, 0, used,
+                                        kept, counted);
+        any = true;
+    }
     return jsonLength;
 }
 
@@ -95,7 +193,8 @@ void HydroServerPublisher::printSensorDataJSON(Stream* stream) {
         stream->print(datastreamTag);
         stream->print('{');
         stream->print(iotTag);
-        stream->print(_baseLogger->getVarUUIDAtI(i));
+        stream->print('"');
+        stream->print(_baseLogger->getVarUUIDCharAtI(i));
         stream->print('"');
         stream->print("},");
         stream->print(componentsTag);
@@ -103,7 +202,7 @@ void HydroServerPublisher::printSensorDataJSON(Stream* stream) {
         stream->print("[[\"");
         stream->print(Logger::formatDateTime_ISO8601(Logger::markedLocalEpochTime));
         stream->print("\",");
-        stream->print(_baseLogger->getValueStringAtI(i));
+        stream->print(_baseLogger->getValueCharAtI(i));
         if (i == _baseLogger->getArrayVarCount() - 1) {
             stream->print("]]}");
         }
@@ -152,193 +251,189 @@ void HydroServerPublisher::begin(Logger&     baseLogger,
 // The return is the http status code of the response.
 // int16_t EnviroDIYPublisher::postDataEnviroDIY(void)
 int16_t HydroServerPublisher::publishData(Client* outClient) {
-    // Create a buffer for the temporary portions of the request and response
-    char     tempBuffer[37] = "";
-    char     jsonSizeBuffer[5] = "";
-    char     rxBuffer[3000];
-    uint16_t did_respond    = 0;
-
-    MS_DBG(F("Outgoing JSON size:"), calculateJsonSize());
-
-    // Open a TCP/IP connection to HydroServer
-    MS_DBG(F("Connecting client"));
-    MS_START_DEBUG_TIMER;
-    if (outClient->connect(hydroServerHost, hydroServerPort)) {
-        MS_DBG(F("Client connected after"), MS_PRINT_DEBUG_TIMER, F("ms\n"));
+    // Send this interval's values along with any still being held
+    cacheData();
+
+    // Format each interval's timestamp once; they're all the same length
+    char    times[MS_HYDROSERVER_MAX_ROWS * HYDROSERVER_TIMESTAMP_SIZE];
+    uint8_t timestampLength = 0;
+    for (uint8_t r = 0; r < _rowCount; r++) {
+        String timestamp = Logger::formatDateTime_ISO8601(_rowTimes[r]);
+        timestamp.toCharArray(times + r * HYDROSERVER_TIMESTAMP_SIZE,
+                              HYDROSERVER_TIMESTAMP_SIZE);
+        timestampLength = timestamp.length();
+    }
 
-        // copy the initial post header into the tx buffer
-        snprintf(txBuffer, sizeof(txBuffer), "%s", postHeader);
-        snprintf(txBuffer + strlen(txBuffer),
-                sizeof(txBuffer) - strlen(txBuffer), "%s", postEndpoint);
-        snprintf(txBuffer + strlen(txBuffer),
-                sizeof(txBuffer) - strlen(txBuffer), "%s", HTTPtag);
-
-        // add the rest of the HTTP POST headers to the outgoing buffer
-        // before adding each line/chunk to the outgoing buffer, we make sure
-        // there is space for that line, sending out buffer if not
-        if (bufferFree() < 37) printTxBuffer(outClient);
-        snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", hostHeader);
-        snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", hydroServerHost);
-
-        if (bufferFree() < 47) printTxBuffer(outClient);
-        snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", acceptHeader);
-
-        if (bufferFree() < 26) printTxBuffer(outClient);
-        snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", authorizationHeader);
-        snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", _base64Authorization);
-
-        if (bufferFree() < 25) printTxBuffer(outClient);
-        snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", contentLengthHeader);
-        
-        if (bufferFree() < 5) printTxBuffer(outClient);
-        itoa(calculateJsonSize(), jsonSizeBuffer, 10);
-        snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", jsonSizeBuffer);
-
-        if (bufferFree() < 42) printTxBuffer(outClient);
-        snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", contentTypeHeader);
-
-        // put the start of the JSON into the outgoing response_buffer
-        if (bufferFree() < 1) printTxBuffer(outClient);
-        txBuffer[strlen(txBuffer)] = '[';
-        for (uint8_t y = 0; y < _baseLogger->getArrayVarCount(); y++) {
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '{';
-
-            if (bufferFree() < 13) printTxBuffer(outClient);
-            snprintf(txBuffer + strlen(txBuffer),
-                    sizeof(txBuffer) - strlen(txBuffer), "%s", datastreamTag);
-
-            if (bufferFree() < 10) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '{';
-            snprintf(txBuffer + strlen(txBuffer),
-                sizeof(txBuffer) - strlen(txBuffer), "%s", iotTag);
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '"';
-
-            if (bufferFree() < 37) printTxBuffer(outClient);
-            _baseLogger->getVarUUIDAtI(y).toCharArray(tempBuffer, 37);
-            snprintf(txBuffer + strlen(txBuffer),
-                sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '"';
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '}';
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = ',';
-
-            if (bufferFree() < 42) printTxBuffer(outClient);
-            snprintf(txBuffer + strlen(txBuffer),
-                sizeof(txBuffer) - strlen(txBuffer), "%s", componentsTag);
-
-            if (bufferFree() < 12) printTxBuffer(outClient);
-            snprintf(txBuffer + strlen(txBuffer),
-                sizeof(txBuffer) - strlen(txBuffer), "%s", dataArrayTag);
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '[';
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '[';
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '"';
-
-            if (bufferFree() < 37) printTxBuffer(outClient);
-            Logger::formatDateTime_ISO8601(Logger::markedLocalEpochTime).toCharArray(tempBuffer, 37);
-            snprintf(txBuffer + strlen(txBuffer),
-                sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '"';
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = ',';
-
-            if (bufferFree() < 37) printTxBuffer(outClient);
-            _baseLogger->getValueStringAtI(y).toCharArray(tempBuffer, 37);
-            snprintf(txBuffer + strlen(txBuffer),
-                sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
-            
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = ']';
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = ']';
-
-            if (bufferFree() < 1) printTxBuffer(outClient);
-            txBuffer[strlen(txBuffer)] = '}';
-
-            // If this is not the last variable
-            if (y != _baseLogger->getArrayVarCount() - 1) {
-                if (bufferFree() < 1) printTxBuffer(outClient);
-                txBuffer[strlen(txBuffer)] = ',';
+    // Send the variables in as few requests as the maximum body size allows,
+    // formatting the values once and working out the length of each request
+    // as we go
+    uint8_t  varCount     = cachedVarCount();
+    int16_t  responseCode = 0;
+    uint8_t  first        = 0;
+    char     values[MS_HYDROSERVER_VALUES_SIZE];
+    while (first < varCount) {
+        // Skip the variables an earlier request already went through for
+        if (!unsent(first)) {
+            first++;
+            continue;
+        }
+        uint16_t used = 0, kept = 0, counted = 0;
+        uint16_t jsonLength = 2 +  // [ and ]
+            measureDatastream(first, timestampLength, values, sizeof(values),
+                              used, kept, counted);
+        uint8_t last = first + 1;
+        while (last < varCount) {
+            if (!unsent(last)) {
+                last++;
+                continue;
             }
+            uint16_t usedBefore    = used;
+            uint16_t keptBefore    = kept;
+            uint16_t countedBefore = counted;
+            uint16_t length        = 1 +  // the comma before it
+                measureDatastream(last, timestampLength, values,
+                                  sizeof(values), used, kept, counted);
+            if (jsonLength + length > MS_HYDROSERVER_MAX_BODY_SIZE) {
+                used    = usedBefore;
+                kept    = keptBefore;
+                counted = countedBefore;
+                break;
+            }
+            jsonLength += length;
+            last++;
         }
-        //if (bufferFree() < 1) printTxBuffer(outClient);
-        //txBuffer[strlen(txBuffer)] = ',';
 
-        if (bufferFree() < 1) printTxBuffer(outClient);
-        txBuffer[strlen(txBuffer)] = ']';
+        responseCode = postDatastreams(outClient, first, last, jsonLength,
+                                       times, timestampLength, values, kept);
+        // Keep the intervals to try again next time if this didn't go through
+        if (responseCode < 200 || responseCode > 299) break;
+        // The server has these variables' intervals now, so they aren't sent
+        // again if a later request fails
+        for (uint8_t y = first; y < last; y++) _sentRows[y] = _rowCount;
+        first = last;
+    }
 
-        // Send out the finished request (or the last unsent section of it)
-        printTxBuffer(outClient, true);
+    // Close the connection the requests shared, if it's still open
+    if (outClient->connected()) outClient->stop();
 
-        // Wait 10 seconds for a response from the server
-        uint32_t start = millis();
-        while ((millis() - start) < 10000L) {
-                delay(10);
-            }
-        //while ((millis() - start) < 10000L && outClient->available() < 50) {  // 50 was 12
-        //    delay(10);
-        //}
-
-        // Read only the first 12 characters of the response
-        // We're only reading as far as the http code, anything beyond that
-        // we don't care about.
-        did_respond = outClient->readBytes(rxBuffer, 3000);
-
-        // Close the TCP/IP connection
-        MS_DBG(F("Stopping client"));
-        MS_RESET_DEBUG_TIMER;
-        outClient->stop();
-        MS_DBG(F("Client stopped after"), MS_PRINT_DEBUG_TIMER, F("ms"));
+    // Everything went through
+    if (first >= varCount) {
+        _rowCount = 0;
+        memset(_sentRows, 0, sizeof(_sentRows));
+    }
+    return responseCode;
+}
+
+
+// Sends one request with the objects of a group of variables
+int16_t HydroServerPublisher::postDatastreams(
+    Client* outClient, uint8_t first, uint8_t last, uint16_t jsonLength,
+    const char* times, uint8_t timestampLength, const char* values,
+    uint16_t kept) {
+    // Create a buffer for the temporary portions of the request and response
+    char    jsonSizeBuffer[6] = "";
+    char    responseBody[MS_HYDROSERVER_RESPONSE_SIZE];
+    int16_t responseCode = 504;
+    HttpResponseReader response;
+    response.begin(responseBody, sizeof(responseBody));
+
+    MS_DBG(F("Outgoing JSON size:"), jsonLength);
+
+    // Open a TCP/IP connection to HydroServer, unless the last request left
+    // one open
+    bool connected = outClient->connected();
+    if (!connected) {
+        MS_DBG(F("Connecting client"));
+        MS_START_DEBUG_TIMER;
+        connected = outClient->connect(hydroServerHost, hydroServerPort);
+        MS_DBG(F("Client connected after"), MS_PRINT_DEBUG_TIMER, F("ms\n"));
     } else {
-        PRINTOUT(F("\n -- Unable to Establish Connection to HydroServer Data "
-                   "Portal --"));
+        MS_DBG(F("Reusing the open connection"));
     }
+    if (connected) {
+        // The buffer keeps track of its own length and is sent out to the
+        // client whenever it fills, so there's no need to check for room
+        txBufferInit(outClient);
+        txBufferAppend(postHeader);
+        txBufferAppend(postEndpoint);
+        txBufferAppend(HTTPtag);
+        txBufferAppend(hostHeader);
+        txBufferAppend(hydroServerHost);
+        txBufferAppend(acceptHeader);
+        txBufferAppend(authorizationHeader);
+        txBufferAppend(_base64Authorization);
+        txBufferAppend(contentLengthHeader);
+        itoa(jsonLength, jsonSizeBuffer, 10);
+        txBufferAppend(jsonSizeBuffer);
+        txBufferAppend(contentTypeHeader);
+
+        // Add the JSON, one object for each variable with a row for each
+        // interval
+        const char* value = values;
+        uint16_t    index = 0;
+        char        scratch[MS_VALUE_TEXT_SIZE];
+        txBufferAppend('[');
+        for (uint8_t y = first; y < last; y++) {
+            if (!unsent(y)) continue;  // The server already has this one's
+            if (y != first) txBufferAppend(',');
+            txBufferAppend('{');
+            txBufferAppend(datastreamTag);
+            txBufferAppend('{');
+            txBufferAppend(iotTag);
+            txBufferAppend('"');
+            txBufferAppend(_baseLogger->getVarUUIDCharAtI(y));
+            txBufferAppend("\"},");
+            txBufferAppend(componentsTag);
+            txBufferAppend(dataArrayTag);
+            txBufferAppend('[');
+            for (uint8_t r = _sentRows[y]; r < _rowCount; r++) {
+                if (r != _sentRows[y]) txBufferAppend(',');
+                txBufferAppend("[\"");
+                txBufferAppend(times + r * HYDROSERVER_TIMESTAMP_SIZE,
+                               timestampLength);
+                txBufferAppend("\",");
+                if (index < kept) {
+                    uint8_t length = static_cast<uint8_t>(*value);
+                    txBufferAppend(value + 1, length);
+                    value += 1 + length;
+                } else {
+                    // This one didn't fit with the others, so format it again
+                    uint8_t length = Variable::formatValue(
+                        rowValue(r, y), _baseLogger->getVarResolutionAtI(y),
+                        scratch);
+                    txBufferAppend(scratch, length);
+                }
+                index++;
+                txBufferAppend(']');
+            }
+            txBufferAppend("]}");
+        }
+        txBufferAppend(']');
 
-    // Process the HTTP response
-    int16_t responseCode = 0;
-    if (did_respond > 0) {
-        char responseCode_char[4];
-        for (uint8_t i = 0; i < 3; i++) {
-            responseCode_char[i] = rxBuffer[i + 9];
+        // Send out the finished request (or the last unsent section of it)
+        txBufferFlush();
+
+        // Read the response as it comes in, stopping as soon as all of it is
+        // there
+        responseCode = response.read(outClient, MS_HTTP_RESPONSE_TIMEOUT_MS);
+
+        // Only leave the connection open if the server will take another
+        // request on it
+        if (!response.keepAlive()) {
+            MS_DBG(F("Stopping client"));
+            MS_START_DEBUG_TIMER;
+            outClient->stop();
+            MS_DBG(F("Client stopped after"), MS_PRINT_DEBUG_TIMER, F("ms"));
         }
-        responseCode = atoi(responseCode_char);
     } else {
-        responseCode = 504;
+        PRINTOUT(F("\n -- Unable to Establish Connection to HydroServer Data "
+                   "Portal --"));
     }
 
-
-
     PRINTOUT(F("-- Response Code --"));
     PRINTOUT(responseCode);
-    PRINTOUT(F("-- Full response --"));
-    bool rxMessageComplete = false;
-    PRINTOUT(rxBuffer);
-
+    PRINTOUT(F("-- Response body --"));
+    PRINTOUT(responseBody);
 
     return responseCode;
 }
@@ -40,7 +40,73 @@
 #include "ModSensorDebugger.h"
 #undef MS_DEBUGGING_STD
 #include "dataPublisherBase.h"
+#include "HttpResponseReader.h"
 
+/**
+ * @def MS_HYDROSERVER_VALUES_SIZE
+ * @brief The room set aside (on the stack) for the formatted values while a
+ * request is being built
+ *
+ * Each value is formatted once, measured for the Content-Length header, and
+ * then sent from here.  It takes one more byte than the value's text.  Any
+ * values that don't fit are formatted a second time when they are sent.
+ *
+ * This can be changed by setting the build flag MS_HYDROSERVER_VALUES_SIZE
+ * when compiling.
+ */
+#ifndef MS_HYDROSERVER_VALUES_SIZE
+#define MS_HYDROSERVER_VALUES_SIZE 400
+#endif
+
+/**
+ * @def MS_HYDROSERVER_CACHE_SIZE
+ * @brief The number of values (variables times intervals) the publisher can
+ * hold while it gathers intervals to send together
+ *
+ * This must be at least the number of variables.  Each value takes 4 bytes.
+ *
+ * This can be changed by setting the build flag MS_HYDROSERVER_CACHE_SIZE
+ * when compiling.
+ */
+#ifndef MS_HYDROSERVER_CACHE_SIZE
+#define MS_HYDROSERVER_CACHE_SIZE 160
+#endif
+
+/**
+ * @def MS_HYDROSERVER_MAX_ROWS
+ * @brief The most intervals the publisher will hold, however few variables
+ * there are
+ */
+#ifndef MS_HYDROSERVER_MAX_ROWS
+#define MS_HYDROSERVER_MAX_ROWS 16
+#endif
+
+/**
+ * @def MS_HYDROSERVER_MAX_BODY_SIZE
+ * @brief The most characters the JSON body of one request may hold
+ *
+ * If the variables' objects need more than this, they are split across more
+ * than one request.  A single variable's object that is bigger than this is
+ * sent on its own.
+ *
+ * This can be changed by setting the build flag MS_HYDROSERVER_MAX_BODY_SIZE
+ * when compiling.
+ */
+#ifndef MS_HYDROSERVER_MAX_BODY_SIZE
+#define MS_HYDROSERVER_MAX_BODY_SIZE 6000
+#endif
+
+
+/**
+ * @def MS_HYDROSERVER_RESPONSE_SIZE
+ * @brief The characters of each response's body kept to be printed out
+ *
+ * This can be changed by setting the build flag MS_HYDROSERVER_RESPONSE_SIZE
+ * when compiling.
+ */
+#ifndef MS_HYDROSERVER_RESPONSE_SIZE
+#define MS_HYDROSERVER_RESPONSE_SIZE 200
+#endif
 
 // ============================================================================
 //  Functions for the HydroServer data portal receivers.
@@ -67,11 +133,10 @@ class HydroServerPublisher : public dataPublisher {
      * logger.
      *
      * @param baseLogger The logger supplying the data to be published
-     * @param sendEveryX Currently unimplemented, intended for future use to
-     * enable caching and bulk publishing
-     * @param sendOffset Currently unimplemented, intended for future use to
-     * enable publishing data at a time slightly delayed from when it is
-     * collected
+     * @param sendEveryX The number of logging intervals to gather and send
+     * together, with a row for each interval, in one request
+     * @param sendOffset The interval, counting from 0, within each group of
+     * sendEveryX intervals that the rows are sent on
      *
      * @note It is possible (though very unlikey) that using this constructor
      * could cause errors if the compiler attempts to initialize the publisher
@@ -88,11 +153,10 @@ class HydroServerPublisher : public dataPublisher {
      * @param inClient An Arduino client instance to use to print data to.
      * Allows the use of any type of client and multiple clients tied to a
      * single TinyGSM modem instance
-     * @param sendEveryX Currently unimplemented, intended for future use to
-     * enable caching and bulk publishing
-     * @param sendOffset Currently unimplemented, intended for future use to
-     * enable publishing data at a time slightly delayed from when it is
-     * collected
+     * @param sendEveryX The number of logging intervals to gather and send
+     * together, with a row for each interval, in one request
+     * @param sendOffset The interval, counting from 0, within each group of
+     * sendEveryX intervals that the rows are sent on
      *
      * @note It is possible (though very unlikey) that using this constructor
      * could cause errors if the compiler attempts to initialize the publisher
@@ -108,11 +172,10 @@ class HydroServerPublisher : public dataPublisher {
      * @param baseLogger The logger supplying the data to be published
      * @param base64Authorization The <username:password> encoded as base64 for
      * the site on the HydroServer data portal.
-     * @param sendEveryX Currently unimplemented, intended for future use to
-     * enable caching and bulk publishing
-     * @param sendOffset Currently unimplemented, intended for future use to
-     * enable publishing data at a time slightly delayed from when it is
-     * collected
+     * @param sendEveryX The number of logging intervals to gather and send
+     * together, with a row for each interval, in one request
+     * @param sendOffset The interval, counting from 0, within each group of
+     * sendEveryX intervals that the rows are sent on
      */
     HydroServerPublisher(Logger& baseLogger, const char* base64Authorization,
                          uint8_t sendEveryX = 1, uint8_t sendOffset = 0);
@@ -125,11 +188,10 @@ class HydroServerPublisher : public dataPublisher {
      * single TinyGSM modem instance
      * @param base64Authorization The <username:password> encoded as base64 for
      * the site on the HydroServer data portal.
-     * @param sendEveryX Currently unimplemented, intended for future use to
-     * enable caching and bulk publishing
-     * @param sendOffset Currently unimplemented, intended for future use to
-     * enable publishing data at a time slightly delayed from when it is
-     * collected
+     * @param sendEveryX The number of logging intervals to gather and send
+     * together, with a row for each interval, in one request
+     * @param sendOffset The interval, counting from 0, within each group of
+     * sendEveryX intervals that the rows are sent on
      */
     HydroServerPublisher(Logger& baseLogger, Client* inClient,
                        const char* base64Authorization,
@@ -154,7 +216,8 @@ class HydroServerPublisher : public dataPublisher {
     void setAuthorization(const char* base64Authorization);
 
     /**
-     * @brief Calculates how long the outgoing JSON will be
+     * @brief Calculates how long the outgoing JSON will be for the intervals
+     * gathered so far, if it is all sent in one request
      *
      * @return uint16_t The number of characters in the JSON object.
      */
@@ -208,16 +271,40 @@ class HydroServerPublisher : public dataPublisher {
      * EnviroDIY/ODM2DataSharingPortal and then stream out a post request over
      * that connection.
      *
+     * Every interval gathered so far is sent, with the current values added
+     * if cacheData() hasn't already added them.  Each variable's object holds
+     * a row for every interval, and the variables are split across as few
+     * requests as MS_HYDROSERVER_MAX_BODY_SIZE allows.  If a request fails,
+     * the intervals are kept to be sent again next time, except to the
+     * variables the earlier requests already went through for.
+     *
+     * Each response is read with an HttpResponseReader, so the next request
+     * goes out as soon as the last response is in, on the same connection if
+     * the server keeps it open.
+     *
      * This depends on an internet connection already having been made and a
      * client being available.
      *
      * @param outClient An Arduino client instance to use to print data to.
      * Allows the use of any type of client and multiple clients tied to a
      * single TinyGSM modem instance
-     * @return **int16_t** The http status code of the response.
+     * @return **int16_t** The http status code of the last response.
      */
     int16_t publishData(Client* outClient) override;
 
+    /**
+     * @brief Add the current values to the intervals being gathered
+     *
+     * The logger calls this every interval, and only wakes the modem to send
+     * the intervals on the ones picked by sendEveryX and sendOffset, or once
+     * there's no room for more.
+     */
+    void cacheData(void) override;
+    /**
+     * @copydoc dataPublisher::cacheRoom()
+     */
+    uint8_t cacheRoom(void) override;
+
  protected:
     /**
      * @anchor hydroserver_post_vars
@@ -239,8 +326,86 @@ class HydroServerPublisher : public dataPublisher {
     /**@}*/
 
  private:
+    /**
+     * @brief Add the current value of every variable to the intervals being
+     * gathered, dropping the oldest interval if there's no room
+     */
+    void cacheRow(void);
+    /**
+     * @brief Get the number of variables whose values are gathered
+     */
+    uint8_t cachedVarCount(void);
+    /**
+     * @brief Get the number of intervals that can be gathered
+     */
+    uint8_t rowCapacity(void);
+    /**
+     * @brief Get a gathered value
+     *
+     * @param row The interval
+     * @param i The position of the variable in the array
+     */
+    float rowValue(uint8_t row, uint8_t i) {
+        return _rowValues[row * cachedVarCount() + i];
+    }
+    /**
+     * @brief Check whether the server is still missing any gathered intervals
+     * of a variable
+     *
+     * @param i The position of the variable in the array
+     */
+    bool unsent(uint8_t i) {
+        return _sentRows[i] < _rowCount;
+    }
+    /**
+     * @brief Works out the length of a variable's object in the JSON, keeping
+     * each value's text as it goes
+     *
+     * @param i The position of the variable in the array
+     * @param timestampLength The length of the formatted timestamps
+     * @param values Where to keep the values' text, each one after its
+     * length; nullptr to keep none
+     * @param size The room in values
+     * @param used The bytes of values used so far; updated
+     * @param kept The number of values (from the first) kept in values;
+     * updated
+     * @param counted The number of values measured so far; updated
+     * @return **uint16_t** The number of characters in the object.
+     */
+    uint16_t measureDatastream(uint8_t i, uint8_t timestampLength,
+                               char* values, uint16_t size, uint16_t& used,
+                               uint16_t& kept, uint16_t& counted);
+    /**
+     * @brief Send one request holding a group of variables' objects
+     *
+     * @param outClient The client to send the request on
+     * @param first The position of the first variable in the request
+     * @param last The position after the last variable in the request
+     * @param jsonLength The number of characters in the JSON
+     * @param times The formatted timestamps, one for each interval
+     * @param timestampLength The length of each timestamp
+     * @param values The values kept by measureDatastream()
+     * @param kept The number of values kept in values
+     * @return **int16_t** The http status code of the response.
+     */
+    int16_t postDatastreams(Client* outClient, uint8_t first, uint8_t last,
+                            uint16_t jsonLength, const char* times,
+                            uint8_t timestampLength, const char* values,
+                            uint16_t kept);
+
     // Tokens and UUID's for EnviroDIY
     const char* _base64Authorization = nullptr;
+
+    // The intervals gathered so far
+    uint32_t _rowTimes[MS_HYDROSERVER_MAX_ROWS];
+    float    _rowValues[MS_HYDROSERVER_CACHE_SIZE];
+    uint8_t  _rowCount = 0;
+    /**
+     * @brief For each variable, the number of intervals (from the first) the
+     * server already has, so a request that fails after earlier ones went
+     * through doesn't send theirs again
+     */
+    uint8_t _sentRows[MS_HYDROSERVER_CACHE_SIZE] = {};
 };
 
 #endif  // SRC_PUBLISHERS_HYDROSERVERPUBLISHER_H_
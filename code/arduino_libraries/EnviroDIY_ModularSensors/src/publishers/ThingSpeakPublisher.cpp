@@ -146,9 +146,9 @@ int16_t ThingSpeakPublisher::publishData(Client* outClient) {
         snprintf(txBuffer + strlen(txBuffer),
                  sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
         txBuffer[strlen(txBuffer)] = '=';
-        _baseLogger->getValueStringAtI(i).toCharArray(tempBuffer, 26);
         snprintf(txBuffer + strlen(txBuffer),
-                 sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+                 sizeof(txBuffer) - strlen(txBuffer), "%s",
+                 _baseLogger->getValueCharAtI(i));
         if (i + 1 != numChannels) { txBuffer[strlen(txBuffer)] = '&'; }
     }
     MS_DBG(F("Message ["), strlen(txBuffer), F("]:"), String(txBuffer));
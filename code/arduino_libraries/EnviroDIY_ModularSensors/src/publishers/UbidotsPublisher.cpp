@@ -77,10 +77,10 @@ uint16_t UbidotsPublisher::calculateJsonSize() {
     // jsonLength += 2;           //  ",
     for (uint8_t i = 0; i < _baseLogger->getArrayVarCount(); i++) {
         jsonLength += 1;  //  "
-        jsonLength +=
-            _baseLogger->getVarUUIDAtI(i).length();  // parameter ID length
-        jsonLength += 11;                            //  ":{"value":
-        jsonLength += _baseLogger->getValueStringAtI(i).length();
+        // parameter ID length
+        jsonLength += strlen(_baseLogger->getVarUUIDCharAtI(i));
+        jsonLength += 11;  //  ":{"value":
+        jsonLength += _baseLogger->getValueLengthAtI(i);
         jsonLength += 13;  // ,"timestamp":
         jsonLength += 13;  // epoch time in milliseconds
         if (i + 1 != _baseLogger->getArrayVarCount()) {
@@ -99,9 +99,9 @@ void UbidotsPublisher::printSensorDataJSON(Stream* stream) {
 
     for (uint8_t i = 0; i < _baseLogger->getArrayVarCount(); i++) {
         stream->print('"');
-        stream->print(_baseLogger->getVarUUIDAtI(i));
+        stream->print(_baseLogger->getVarUUIDCharAtI(i));
         stream->print(F("\":{'value':"));
-        stream->print(_baseLogger->getValueStringAtI(i));
+        stream->print(_baseLogger->getValueCharAtI(i));
         stream->print(",'timestamp':");
         stream->print(Logger::markedUTCEpochTime);
         stream->print(
@@ -218,9 +218,9 @@ int16_t UbidotsPublisher::publishData(Client* outClient) {
             if (bufferFree() < 47) printTxBuffer(outClient);
 
             txBuffer[strlen(txBuffer)] = '"';
-            _baseLogger->getVarUUIDAtI(i).toCharArray(tempBuffer, 37);
             snprintf(txBuffer + strlen(txBuffer),
-                     sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+                     sizeof(txBuffer) - strlen(txBuffer), "%s",
+                     _baseLogger->getVarUUIDCharAtI(i));
             txBuffer[strlen(txBuffer)] = '"';
             snprintf(txBuffer + strlen(txBuffer),
                      sizeof(txBuffer) - strlen(txBuffer), "%s", ":{");
@@ -229,9 +229,9 @@ int16_t UbidotsPublisher::publishData(Client* outClient) {
                      sizeof(txBuffer) - strlen(txBuffer), "%s", "value");
             txBuffer[strlen(txBuffer)] = '"';
             txBuffer[strlen(txBuffer)] = ':';
-            _baseLogger->getValueStringAtI(i).toCharArray(tempBuffer, 37);
             snprintf(txBuffer + strlen(txBuffer),
-                     sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+                     sizeof(txBuffer) - strlen(txBuffer), "%s",
+                     _baseLogger->getValueCharAtI(i));
             txBuffer[strlen(txBuffer)] = ',';
             txBuffer[strlen(txBuffer)] = '"';
             snprintf(txBuffer + strlen(txBuffer),
@@ -0,0 +1,308 @@
+/**
+ * @file ADS1x15Manager.cpp
+ * @copyright 2017-2022 Stroud Water Research Center
+ * Part of the EnviroDIY ModularSensors library for Arduino
+ *
+ * @brief Implements the ADS1x15Manager class.
+ */
+
+
+#include "ADS1x15Manager.h"
+
+// The config register bits that are the same for every conversion: single
+// shot, with the comparator off
+#define ADS1X15_CONFIG_BASE                                          \
+    (ADS1X15_REG_CONFIG_CQUE_NONE | ADS1X15_REG_CONFIG_CLAT_NONLAT | \
+     ADS1X15_REG_CONFIG_CPOL_ACTVLOW | ADS1X15_REG_CONFIG_CMODE_TRAD | \
+     ADS1X15_REG_CONFIG_MODE_SINGLE)
+
+// How long to keep waiting on a conversion past when it should have finished
+#define ADS1X15_CONVERSION_TIMEOUT_US 20000L
+
+// The samples per second for each data rate setting
+#ifndef MS_USE_ADS1015
+static const uint16_t samplesPerSecond[8] = {8,   16,  32,  64,
+                                             128, 250, 475, 860};
+#else
+static const uint16_t samplesPerSecond[8] = {128,  250,  490,  920,
+                                             1600, 2400, 3300, 3300};
+#endif
+// The full scale range in mV for each gain setting
+static const uint16_t fullScale_mV[8] = {6144, 4096, 2048, 1024,
+                                         512,  256,  256,  256};
+
+
+ADS1x15Manager ADS1x15Manager::shared;
+
+
+// The constructor
+ADS1x15Manager::ADS1x15Manager(TwoWire* theI2C)
+    : _i2c(theI2C),
+      _channelCount(0),
+      _fresh(0),
+      _updatedAt(0) {}
+
+
+void ADS1x15Manager::begin(void) {
+    _i2c->begin();  // Start the wire library (sensor power not required)
+}
+
+
+uint8_t ADS1x15Manager::addSingleEnded(uint8_t i2cAddress, uint8_t channel,
+                                       adsGain_t gain, adsSPS_t rate) {
+    if (channel > 3) return ADS1X15_NO_CHANNEL;
+    return addChannel(i2cAddress, ADS1X15_REG_CONFIG_MUX_SINGLE_0 |
+                          (static_cast<uint16_t>(channel) << 12) | gain | rate);
+}
+
+
+uint8_t ADS1x15Manager::addDifferential(uint8_t i2cAddress, adsDiffMux_t pair,
+                                        adsGain_t gain, adsSPS_t rate) {
+    return addChannel(i2cAddress, pair | gain | rate);
+}
+
+
+uint8_t ADS1x15Manager::addChannel(uint8_t i2cAddress, uint16_t config) {
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        if (_address[i] == i2cAddress && _config[i] == config) return i;
+    }
+    if (_channelCount >= MS_ADS1X15_MAX_CHANNELS) {
+        PRINTOUT(F("No room for another ADS1x15 channel!  Raise "
+                   "MS_ADS1X15_MAX_CHANNELS."));
+        return ADS1X15_NO_CHANNEL;
+    }
+    MS_DBG(F("ADS1x15 channel"), _channelCount, F("is 0x"),
+           String(config, HEX), F("on 0x"), String(i2cAddress, HEX));
+    _address[_channelCount] = i2cAddress;
+    _config[_channelCount]  = config;
+    return _channelCount++;
+}
+
+
+// Runs through every registered conversion.  Each chip does its own channels
+// one after another, in the order they were registered, while the other chips
+// do theirs.
+bool ADS1x15Manager::update(void) {
+    bool     success = true;
+    uint16_t all     = (1UL << _channelCount) - 1;
+    uint16_t done    = 0;  // converted, or given up on
+    uint16_t busy    = 0;  // converting now
+    uint32_t started[MS_ADS1X15_MAX_CHANNELS];
+    _fresh = 0;
+
+    while (done != all) {
+        // Start the next conversion on each chip that isn't busy
+        for (uint8_t i = 0; i < _channelCount; i++) {
+            if ((done | busy) & (1 << i)) continue;
+            bool chipBusy = false;
+            for (uint8_t j = 0; j < _channelCount; j++) {
+                if ((busy & (1 << j)) && _address[j] == _address[i]) {
+                    chipBusy = true;
+                }
+            }
+            if (chipBusy) continue;
+            if (!writeRegister(_address[i], ADS1X15_REG_POINTER_CONFIG,
+                               ADS1X15_CONFIG_BASE | ADS1X15_REG_CONFIG_OS_SINGLE |
+                                   _config[i])) {
+                MS_DBG(F("Couldn't start ADS1x15 channel"), i);
+                done |= 1 << i;
+                success = false;
+                continue;
+            }
+            started[i] = micros();
+            busy |= 1 << i;
+        }
+
+        // Wait until the first of them should be finished
+        uint32_t wait_us = ADS1X15_CONVERSION_TIMEOUT_US;
+        for (uint8_t i = 0; i < _channelCount; i++) {
+            if (!(busy & (1 << i))) continue;
+            uint32_t elapsed = micros() - started[i];
+            uint32_t needed  = conversionTime_us(_config[i]);
+            wait_us = min(wait_us, elapsed >= needed ? 0 : needed - elapsed);
+        }
+        if (wait_us >= 1000) delay(wait_us / 1000);
+        delayMicroseconds(wait_us % 1000);
+
+        // Collect every conversion that has finished
+        for (uint8_t i = 0; i < _channelCount; i++) {
+            if (!(busy & (1 << i))) continue;
+            uint32_t elapsed = micros() - started[i];
+            uint32_t needed  = conversionTime_us(_config[i]);
+            if (elapsed < needed) continue;
+
+            uint16_t config;
+            uint16_t result;
+            bool     readOK = readRegister(_address[i],
+                                           ADS1X15_REG_POINTER_CONFIG, config);
+            if (readOK && (config & ADS1X15_REG_CONFIG_OS_MASK) ==
+                              ADS1X15_REG_CONFIG_OS_BUSY) {
+                // Still converting; try again unless it's been far too long
+                if (elapsed < needed + ADS1X15_CONVERSION_TIMEOUT_US) continue;
+                readOK = false;
+            }
+            if (readOK) {
+                readOK = readRegister(_address[i], ADS1X15_REG_POINTER_CONVERT,
+                                      result);
+            }
+            busy &= ~(1 << i);
+            done |= 1 << i;
+            if (!readOK) {
+                MS_DBG(F("Couldn't read ADS1x15 channel"), i);
+                success = false;
+                continue;
+            }
+            _result[i] = toCounts(result);
+            _fresh |= 1 << i;
+        }
+    }
+    _updatedAt = millis();
+    return success;
+}
+
+
+float ADS1x15Manager::readVoltage(uint8_t channel) {
+    if (channel >= _channelCount) return -9999;
+    if (!(_fresh & (1 << channel)) ||
+        millis() - _updatedAt > ADS1X15_MAX_READING_AGE_MS) {
+        update();
+    }
+    if (!(_fresh & (1 << channel))) return -9999;
+    _fresh &= ~(1 << channel);  // Each reading is only handed out once
+    return _result[channel] * voltsPerBit(_config[channel]);
+}
+
+
+// Samples one channel in continuous conversion mode.  The conversion register
+// is read once per conversion period; the period is stretched for the ADS1x15's
+// clock running as much as 10% slow so the same conversion is never read twice.
+bool ADS1x15Manager::burst(uint8_t channel, uint16_t window_ms,
+                           ADS1x15Stats& stats) {
+    stats.count  = 0;
+    stats.mean   = -9999;
+    stats.min    = -9999;
+    stats.max    = -9999;
+    stats.stdDev = -9999;
+    if (channel >= _channelCount) return false;
+
+    uint8_t  address  = _address[channel];
+    uint16_t config   = _config[channel];
+    uint32_t period   = conversionTime_us(config);
+    float    mean     = 0;  // running mean and sum of squared differences
+    float    sumSq    = 0;  // from it, in counts (Welford's method)
+    int16_t  low      = 0;
+    int16_t  high     = 0;
+    uint16_t failures = 0;
+
+    if (!writeRegister(address, ADS1X15_REG_POINTER_CONFIG,
+                       (ADS1X15_CONFIG_BASE & ~ADS1X15_REG_CONFIG_MODE_SINGLE) |
+                           ADS1X15_REG_CONFIG_MODE_CONTIN | config)) {
+        MS_DBG(F("Couldn't start a burst on ADS1x15 channel"), channel);
+        return false;
+    }
+    // Leave the register pointer on the conversion register so each sample
+    // only needs a read
+    _i2c->beginTransmission(address);
+    _i2c->write(ADS1X15_REG_POINTER_CONVERT);
+    bool pointed = _i2c->endTransmission() == 0;
+
+    uint32_t start   = millis();
+    uint32_t started = micros();
+    uint32_t next    = period;  // when the next sample is due after started
+    while (pointed && millis() - start < window_ms) {
+        uint32_t elapsed = micros() - started;
+        if (elapsed < next) {
+            uint32_t wait_us = next - elapsed;
+            if (wait_us >= 1000) delay(wait_us / 1000);
+            delayMicroseconds(wait_us % 1000);
+        }
+        next += period;
+
+        uint16_t raw;
+        if (!readPointed(address, raw)) {
+            if (++failures > 10) break;
+            continue;
+        }
+        int16_t counts = toCounts(raw);
+        if (stats.count == 0 || counts < low) low = counts;
+        if (stats.count == 0 || counts > high) high = counts;
+        stats.count++;
+        float delta = counts - mean;
+        mean += delta / stats.count;
+        sumSq += delta * (counts - mean);
+    }
+
+    // Back to single-shot mode, which powers the chip down
+    writeRegister(address, ADS1X15_REG_POINTER_CONFIG,
+                  ADS1X15_CONFIG_BASE | config);
+
+    MS_DBG(F("Burst on ADS1x15 channel"), channel, F("read"), stats.count,
+           F("conversions with"), failures, F("failures"));
+    if (stats.count == 0) return false;
+    float volts  = voltsPerBit(config);
+    stats.mean   = mean * volts;
+    stats.min    = low * volts;
+    stats.max    = high * volts;
+    stats.stdDev = stats.count > 1 ? sqrt(sumSq / (stats.count - 1)) * volts
+                                   : 0;
+    return true;
+}
+
+
+// The time a conversion takes at its data rate, with a little for the chip to
+// power up.  The ADS1x15's internal clock can be up to 10% slow, which makes a
+// conversion take up to a ninth longer than the data rate says.
+uint32_t ADS1x15Manager::conversionTime_us(uint16_t config) {
+    uint32_t period = 1000000L / samplesPerSecond[(config >> 5) & 0x07];
+    return period + period / 9 + 50;
+}
+
+
+float ADS1x15Manager::voltsPerBit(uint16_t config) {
+#ifndef MS_USE_ADS1015
+    const float counts = 32768;
+#else
+    const float counts = 2048;
+#endif
+    return fullScale_mV[(config >> 9) & 0x07] / 1000.0 / counts;
+}
+
+
+bool ADS1x15Manager::writeRegister(uint8_t i2cAddress, uint8_t reg,
+                                   uint16_t value) {
+    _i2c->beginTransmission(i2cAddress);
+    _i2c->write(reg);
+    _i2c->write(static_cast<uint8_t>(value >> 8));
+    _i2c->write(static_cast<uint8_t>(value & 0xFF));
+    return _i2c->endTransmission() == 0;
+}
+
+
+bool ADS1x15Manager::readRegister(uint8_t i2cAddress, uint8_t reg,
+                                  uint16_t& value) {
+    _i2c->beginTransmission(i2cAddress);
+    _i2c->write(reg);
+    if (_i2c->endTransmission() != 0) return false;
+    return readPointed(i2cAddress, value);
+}
+
+
+// Reads whichever register the chip's pointer was last set to
+bool ADS1x15Manager::readPointed(uint8_t i2cAddress, uint16_t& value) {
+    if (_i2c->requestFrom(i2cAddress, static_cast<uint8_t>(2)) != 2) {
+        return false;
+    }
+    value = static_cast<uint16_t>(_i2c->read()) << 8;
+    value |= static_cast<uint8_t>(_i2c->read());
+    return true;
+}
+
+
+int16_t ADS1x15Manager::toCounts(uint16_t value) {
+#ifndef MS_USE_ADS1015
+    return static_cast<int16_t>(value);
+#else
+    // The 12 bits are at the top of the register; keep the sign
+    return static_cast<int16_t>(value) >> 4;
+#endif
+}
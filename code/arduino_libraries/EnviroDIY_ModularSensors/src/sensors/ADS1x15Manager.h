@@ -0,0 +1,238 @@
+/**
+ * @file ADS1x15Manager.h
+ * @copyright 2017-2022 Stroud Water Research Center
+ * Part of the EnviroDIY ModularSensors library for Arduino
+ *
+ * @brief Contains the ADS1x15Manager class, which takes the readings for every
+ * sensor sharing TI ADS1x15 analog-to-digital converters.
+ *
+ * This depends on the soligen2010 fork of the Adafruit ADS1015 library.
+ */
+/* clang-format off */
+/**
+ * @defgroup ads1x15_manager ADS1x15 Manager
+ * One owner for every ADS1x15 on the I2C bus.
+ *
+ * @ingroup analog_group
+ *
+ * @tableofcontents
+ * @m_footernavigation
+ *
+ * @section ads1x15_manager_intro Introduction
+ * Sensors that share the ADS1x15's register the conversions they need (a
+ * single-ended channel or a differential pair, with its own gain and data
+ * rate) with the shared manager once, when they are set up.  When any of them
+ * asks for a reading the manager converts every registered channel in one
+ * sweep.  Each chip works through its own channels in the order they were
+ * registered, and the chips convert at the same time, so a sweep takes about
+ * as long as the busiest chip's conversions rather than the sum of all of
+ * them.  The config register is only read once a conversion should be
+ * finished, rather than being polled for the whole conversion.
+ *
+ * Each reading is handed out once.  Asking for a channel again starts a new
+ * sweep, so sensors averaging several measurements still get a new conversion
+ * for each one.
+ *
+ * A channel can also be sampled in a burst: its chip is put in continuous
+ * conversion mode at the channel's data rate and every conversion for a fixed
+ * window is read and reduced as it arrives to a mean, minimum, maximum,
+ * standard deviation and count.  Nothing is buffered, so a burst of several
+ * hundred samples costs no more RAM than a single reading.  The chip is put
+ * back to sleep (single-shot mode) once the window is over.
+ *
+ * @section ads1x15_manager_flags Build flags
+ * - ```-D MS_USE_ADS1015```
+ *      - switches from the 16-bit ADS1115 to the 12 bit ADS1015
+ * - ```-D MS_ADS1X15_MAX_CHANNELS=x```
+ *      - changes the most conversions that can be registered from 8 to x
+ */
+/* clang-format on */
+
+// Header Guards
+#ifndef SRC_SENSORS_ADS1X15MANAGER_H_
+#define SRC_SENSORS_ADS1X15MANAGER_H_
+
+// Debugging Statement
+// #define MS_ADS1X15MANAGER_DEBUG
+
+#ifdef MS_ADS1X15MANAGER_DEBUG
+#define MS_DEBUGGING_STD "ADS1x15Manager"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+#include <Wire.h>
+#include <Adafruit_ADS1015.h>
+
+/** @ingroup ads1x15_manager */
+/**@{*/
+
+/**
+ * @def MS_ADS1X15_MAX_CHANNELS
+ * @brief The most conversions that can be registered with the manager
+ *
+ * This can be changed by setting the build flag MS_ADS1X15_MAX_CHANNELS when
+ * compiling.
+ */
+#ifndef MS_ADS1X15_MAX_CHANNELS
+#define MS_ADS1X15_MAX_CHANNELS 8
+#endif
+
+#if MS_ADS1X15_MAX_CHANNELS > 16
+#error "The ADS1x15 manager can't hold more than 16 channels"
+#endif
+
+/**
+ * @brief How long a reading is kept for, in milliseconds.  A reading older
+ * than this is not handed out; a new sweep is started instead.
+ */
+#define ADS1X15_MAX_READING_AGE_MS 1000
+
+/// @brief The fastest data rate, for sampling a channel in a burst.
+#ifndef MS_USE_ADS1015
+#define ADS1X15_BURST_RATE ADS1115_DR_860SPS
+#else
+#define ADS1X15_BURST_RATE ADS1015_DR_3300SPS
+#endif
+
+/// @brief The value given back for a channel that could not be registered.
+#define ADS1X15_NO_CHANNEL 0xFF
+
+/**
+ * @brief The statistics of a burst of conversions on one channel, in volts.
+ *
+ * @ingroup ads1x15_manager
+ */
+struct ADS1x15Stats {
+    /// The number of conversions read in the burst
+    uint16_t count;
+    /// The mean of the conversions
+    float mean;
+    /// The lowest conversion
+    float min;
+    /// The highest conversion
+    float max;
+    /// The sample standard deviation of the conversions; 0 for fewer than two
+    float stdDev;
+};
+
+/**
+ * @brief Takes the readings for every sensor sharing TI ADS1x15's.
+ *
+ * @ingroup ads1x15_manager
+ */
+class ADS1x15Manager {
+ public:
+    /**
+     * @brief Construct a new ADS1x15 manager
+     *
+     * @param theI2C The I2C bus the ADS1x15's are on; optional with the
+     * primary hardware I2C instance as the default.
+     */
+    explicit ADS1x15Manager(TwoWire* theI2C = &Wire);
+
+    /**
+     * @brief The manager shared by the sensors in this library.
+     */
+    static ADS1x15Manager shared;
+
+    /**
+     * @brief Start the I2C bus the ADS1x15's are on
+     */
+    void begin(void);
+
+    /**
+     * @brief Register a single-ended conversion
+     *
+     * Registering the same conversion more than once gives back the same
+     * channel, so sensors sharing a signal share its readings.
+     *
+     * @param i2cAddress The I2C address of the ADS1x15
+     * @param channel The input (0-3) to convert
+     * @param gain The gain (input range) for the conversion
+     * @param rate The data rate for the conversion; optional with the chip's
+     * default (128 samples per second for the ADS1115) as the default.
+     * @return **uint8_t** The channel to ask for readings with, or
+     * #ADS1X15_NO_CHANNEL if there was no room for it.
+     */
+    uint8_t addSingleEnded(uint8_t i2cAddress, uint8_t channel, adsGain_t gain,
+                           adsSPS_t rate = DR_DEFAULT_SPS);
+    /**
+     * @brief Register a differential conversion
+     *
+     * @param i2cAddress The I2C address of the ADS1x15
+     * @param pair The pair of inputs to convert
+     * @param gain The gain (input range) for the conversion
+     * @param rate The data rate for the conversion; optional with the chip's
+     * default (128 samples per second for the ADS1115) as the default.
+     * @return **uint8_t** The channel to ask for readings with, or
+     * #ADS1X15_NO_CHANNEL if there was no room for it.
+     */
+    uint8_t addDifferential(uint8_t i2cAddress, adsDiffMux_t pair,
+                            adsGain_t gain, adsSPS_t rate = DR_DEFAULT_SPS);
+
+    /**
+     * @brief Convert every registered channel
+     *
+     * @return **bool** True if every conversion succeeded.
+     */
+    bool update(void);
+
+    /**
+     * @brief Get the reading for a channel in volts
+     *
+     * If the channel's reading has already been handed out, or is too old,
+     * every channel is converted again first.
+     *
+     * @param channel A channel given back when registering
+     * @return **float** The voltage, or -9999 if it couldn't be read.
+     */
+    float readVoltage(uint8_t channel);
+
+    /**
+     * @brief Sample a channel continuously for a fixed window
+     *
+     * The channel's chip converts continuously at the channel's data rate and
+     * every conversion in the window is folded into the statistics.  Register
+     * the channel with a fast data rate to get many samples; at 860 samples
+     * per second a 500 ms window gives about 430.  The other channels on the
+     * chip are not converted during the burst.
+     *
+     * @param channel A channel given back when registering
+     * @param window_ms How long to sample for, in milliseconds
+     * @param stats The statistics of the burst, in volts
+     * @return **bool** True if at least one conversion was read.
+     */
+    bool burst(uint8_t channel, uint16_t window_ms, ADS1x15Stats& stats);
+
+    /**
+     * @brief Get the number of conversions registered
+     *
+     * @return **uint8_t** The number of channels
+     */
+    uint8_t getChannelCount(void) {
+        return _channelCount;
+    }
+
+ private:
+    uint8_t  addChannel(uint8_t i2cAddress, uint16_t config);
+    uint32_t conversionTime_us(uint16_t config);
+    float    voltsPerBit(uint16_t config);
+    bool     writeRegister(uint8_t i2cAddress, uint8_t reg, uint16_t value);
+    bool     readRegister(uint8_t i2cAddress, uint8_t reg, uint16_t& value);
+    bool     readPointed(uint8_t i2cAddress, uint16_t& value);
+    int16_t  toCounts(uint16_t value);
+
+    TwoWire* _i2c;
+    uint8_t  _channelCount;
+    uint8_t  _address[MS_ADS1X15_MAX_CHANNELS];
+    /// The mux, gain and data rate bits of each channel's config register
+    uint16_t _config[MS_ADS1X15_MAX_CHANNELS];
+    int16_t  _result[MS_ADS1X15_MAX_CHANNELS];
+    /// Bits for the channels whose reading is good and not handed out yet
+    uint16_t _fresh;
+    uint32_t _updatedAt;
+};
+/**@}*/
+#endif  // SRC_SENSORS_ADS1X15MANAGER_H_
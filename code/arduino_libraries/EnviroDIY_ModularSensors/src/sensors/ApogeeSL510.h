@@ -83,14 +83,16 @@
 #undef MS_DEBUGGING_STD
 #include "VariableBase.h"
 #include "SensorBase.h"
+#include "ADS1x15Manager.h"
 
 /** @ingroup sensor_sl510 */
 /**@{*/
 
 // Sensor Specific Defines
-/// @brief Sensor::_numReturnedValues; the SL510 can report 3 values, raw
-/// voltage for thermistor, raw voltage for thermopile, and calculated incoming longwave radiation.
-#define SL510_NUM_VARIABLES 3
+/// @brief Sensor::_numReturnedValues; the SL510 can report 7 values, raw
+/// voltage for thermistor, raw voltage for thermopile, calculated incoming longwave radiation, and the minimum,
+/// maximum, standard deviation and count of a thermopile burst.
+#define SL510_NUM_VARIABLES 7
 /// @brief Sensor::_incCalcValues; ILWR is calculated from the raw voltage.
 #define SL510_INC_CALC_VARIABLES 1
 
@@ -237,6 +239,70 @@
 #endif
 /**@}*/
 
+/**
+ * @anchor sensor_sl510_burst
+ * @name Burst Statistics
+ * The statistics of the thermopile voltage from an Apogee SL-510 sampled in a
+ * burst; see ApogeeSL510::setBurst().  The mean of the burst is reported as the
+ * [thermopile voltage](@ref sensor_sl510_thermopile_voltage).  These are -9999
+ * unless bursts are on.
+ *
+ * {{ @ref ApogeeSL510_Thermopile_Voltage_Min }}
+ * {{ @ref ApogeeSL510_Thermopile_Voltage_Max }}
+ * {{ @ref ApogeeSL510_Thermopile_Voltage_StdDev }}
+ * {{ @ref ApogeeSL510_Thermopile_Voltage_Count }}
+ */
+/**@{*/
+/// Variable number; the lowest voltage is stored in
+/// sensorValues[3].
+#define SL510_THERMOPILE_VOLTAGE_MIN_VAR_NUM 3
+/// @brief Variable name; "thermopileVoltageMinimum"
+#define SL510_THERMOPILE_VOLTAGE_MIN_VAR_NAME "thermopileVoltageMinimum"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/); "volt" (V)
+#define SL510_THERMOPILE_VOLTAGE_MIN_UNIT_NAME "volt"
+/// @brief Default variable short code; "sl510thermopileVoltMin"
+#define SL510_THERMOPILE_VOLTAGE_MIN_DEFAULT_CODE "sl510thermopileVoltMin"
+/// @brief Decimals places in string representation
+#define SL510_THERMOPILE_VOLTAGE_MIN_RESOLUTION SL510_THERMOPILE_VOLTAGE_RESOLUTION
+/// Variable number; the highest voltage is stored in
+/// sensorValues[4].
+#define SL510_THERMOPILE_VOLTAGE_MAX_VAR_NUM 4
+/// @brief Variable name; "thermopileVoltageMaximum"
+#define SL510_THERMOPILE_VOLTAGE_MAX_VAR_NAME "thermopileVoltageMaximum"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/); "volt" (V)
+#define SL510_THERMOPILE_VOLTAGE_MAX_UNIT_NAME "volt"
+/// @brief Default variable short code; "sl510thermopileVoltMax"
+#define SL510_THERMOPILE_VOLTAGE_MAX_DEFAULT_CODE "sl510thermopileVoltMax"
+/// @brief Decimals places in string representation
+#define SL510_THERMOPILE_VOLTAGE_MAX_RESOLUTION SL510_THERMOPILE_VOLTAGE_RESOLUTION
+/// Variable number; the standard deviation is stored in
+/// sensorValues[5].
+#define SL510_THERMOPILE_VOLTAGE_STDDEV_VAR_NUM 5
+/// @brief Variable name; "thermopileVoltageStandardDeviation"
+#define SL510_THERMOPILE_VOLTAGE_STDDEV_VAR_NAME "thermopileVoltageStandardDeviation"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/); "volt" (V)
+#define SL510_THERMOPILE_VOLTAGE_STDDEV_UNIT_NAME "volt"
+/// @brief Default variable short code; "sl510thermopileVoltStdDev"
+#define SL510_THERMOPILE_VOLTAGE_STDDEV_DEFAULT_CODE "sl510thermopileVoltStdDev"
+/// @brief Decimals places in string representation
+#define SL510_THERMOPILE_VOLTAGE_STDDEV_RESOLUTION (SL510_THERMOPILE_VOLTAGE_RESOLUTION + 1)
+/// Variable number; the number of conversions is stored in
+/// sensorValues[6].
+#define SL510_THERMOPILE_VOLTAGE_COUNT_VAR_NUM 6
+/// @brief Variable name; "thermopileVoltageSampleCount"
+#define SL510_THERMOPILE_VOLTAGE_COUNT_VAR_NAME "thermopileVoltageSampleCount"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/); "count"
+#define SL510_THERMOPILE_VOLTAGE_COUNT_UNIT_NAME "count"
+/// @brief Default variable short code; "sl510thermopileVoltCount"
+#define SL510_THERMOPILE_VOLTAGE_COUNT_DEFAULT_CODE "sl510thermopileVoltCount"
+/// @brief Decimals places in string representation
+#define SL510_THERMOPILE_VOLTAGE_COUNT_RESOLUTION 0
+/**@}*/
+
 /**
  * @brief The calibration factors
  */
@@ -327,17 +393,46 @@ class ApogeeSL510 : public Sensor {
      */
     String getSensorLocation(void) override;
 
+    /**
+     * @brief Register the sensor's conversions with the shared ADS1x15
+     * manager.
+     *
+     * @return **bool** True if the setup was successful.
+     */
+    bool setup(void) override;
+
+    /**
+     * @brief Sample the thermopile in a burst for each measurement
+     *
+     * Rather than a single conversion, the thermopile is converted
+     * continuously at the given data rate for the whole window, and the mean,
+     * minimum, maximum, standard deviation and number of the conversions are
+     * reported.  The mean is used for the radiation.  Each burst is one
+     * measurement, so measurementsToAverage can be left at 1.  This must be
+     * called before setup().
+     *
+     * @param window_ms How long each burst lasts, in milliseconds; 0 turns
+     * bursts back off.
+     * @param rate The data rate to convert at; optional with the fastest rate
+     * (#ADS1X15_BURST_RATE) as the default.
+     */
+    void setBurst(uint16_t window_ms, adsSPS_t rate = ADS1X15_BURST_RATE);
+
     /**
      * @copydoc Sensor::addSingleMeasurementResult()
      */
     bool addSingleMeasurementResult(void) override;
 
  private:
-    float   _k1calib;
-    float   _k2calib;
-    uint8_t _thermistorChannel;
-    uint8_t _thermistori2cAddress;
-    uint8_t _thermopilei2cAddress;
+    float    _k1calib;
+    float    _k2calib;
+    uint8_t  _thermistorChannel;
+    uint8_t  _thermistori2cAddress;
+    uint8_t  _thermopilei2cAddress;
+    uint8_t  _thermistorADCChannel;
+    uint8_t  _thermopileADCChannel;
+    uint16_t _burstWindow_ms;
+    adsSPS_t _burstRate;
 };
 
 
@@ -471,5 +566,176 @@ class ApogeeSL510_Thermopile_Voltage : public Variable {
      */
     ~ApogeeSL510_Thermopile_Voltage() {}
 };
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for
+ * the lowest thermopile voltage in the burst
+ * ([burst statistics](@ref sensor_sl510_burst)) from an
+ * [Apogee SL-510](@ref sensor_sl510).
+ *
+ * @ingroup sensor_sl510
+ */
+/* clang-format on */
+class ApogeeSL510_Thermopile_Voltage_Min : public Variable {
+ public:
+    /**
+     * @brief Construct a new ApogeeSL510_Thermopile_Voltage_Min object.
+     *
+     * @param parentSense The parent ApogeeSL510 providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sl510thermopileVoltMin".
+     */
+    explicit ApogeeSL510_Thermopile_Voltage_Min(
+        ApogeeSL510* parentSense, const char* uuid = "",
+        const char* varCode = SL510_THERMOPILE_VOLTAGE_MIN_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)SL510_THERMOPILE_VOLTAGE_MIN_VAR_NUM,
+                   (uint8_t)SL510_THERMOPILE_VOLTAGE_MIN_RESOLUTION, SL510_THERMOPILE_VOLTAGE_MIN_VAR_NAME,
+                   SL510_THERMOPILE_VOLTAGE_MIN_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new ApogeeSL510_Thermopile_Voltage_Min object.
+     *
+     * @note This must be tied with a parent ApogeeSL510 before it can be used.
+     */
+    ApogeeSL510_Thermopile_Voltage_Min()
+        : Variable((const uint8_t)SL510_THERMOPILE_VOLTAGE_MIN_VAR_NUM,
+                   (uint8_t)SL510_THERMOPILE_VOLTAGE_MIN_RESOLUTION, SL510_THERMOPILE_VOLTAGE_MIN_VAR_NAME,
+                   SL510_THERMOPILE_VOLTAGE_MIN_UNIT_NAME, SL510_THERMOPILE_VOLTAGE_MIN_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the ApogeeSL510_Thermopile_Voltage_Min object - no action needed.
+     */
+    ~ApogeeSL510_Thermopile_Voltage_Min() {}
+};
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for
+ * the highest thermopile voltage in the burst
+ * ([burst statistics](@ref sensor_sl510_burst)) from an
+ * [Apogee SL-510](@ref sensor_sl510).
+ *
+ * @ingroup sensor_sl510
+ */
+/* clang-format on */
+class ApogeeSL510_Thermopile_Voltage_Max : public Variable {
+ public:
+    /**
+     * @brief Construct a new ApogeeSL510_Thermopile_Voltage_Max object.
+     *
+     * @param parentSense The parent ApogeeSL510 providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sl510thermopileVoltMax".
+     */
+    explicit ApogeeSL510_Thermopile_Voltage_Max(
+        ApogeeSL510* parentSense, const char* uuid = "",
+        const char* varCode = SL510_THERMOPILE_VOLTAGE_MAX_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)SL510_THERMOPILE_VOLTAGE_MAX_VAR_NUM,
+                   (uint8_t)SL510_THERMOPILE_VOLTAGE_MAX_RESOLUTION, SL510_THERMOPILE_VOLTAGE_MAX_VAR_NAME,
+                   SL510_THERMOPILE_VOLTAGE_MAX_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new ApogeeSL510_Thermopile_Voltage_Max object.
+     *
+     * @note This must be tied with a parent ApogeeSL510 before it can be used.
+     */
+    ApogeeSL510_Thermopile_Voltage_Max()
+        : Variable((const uint8_t)SL510_THERMOPILE_VOLTAGE_MAX_VAR_NUM,
+                   (uint8_t)SL510_THERMOPILE_VOLTAGE_MAX_RESOLUTION, SL510_THERMOPILE_VOLTAGE_MAX_VAR_NAME,
+                   SL510_THERMOPILE_VOLTAGE_MAX_UNIT_NAME, SL510_THERMOPILE_VOLTAGE_MAX_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the ApogeeSL510_Thermopile_Voltage_Max object - no action needed.
+     */
+    ~ApogeeSL510_Thermopile_Voltage_Max() {}
+};
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for
+ * the standard deviation of the thermopile voltage in the burst
+ * ([burst statistics](@ref sensor_sl510_burst)) from an
+ * [Apogee SL-510](@ref sensor_sl510).
+ *
+ * @ingroup sensor_sl510
+ */
+/* clang-format on */
+class ApogeeSL510_Thermopile_Voltage_StdDev : public Variable {
+ public:
+    /**
+     * @brief Construct a new ApogeeSL510_Thermopile_Voltage_StdDev object.
+     *
+     * @param parentSense The parent ApogeeSL510 providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sl510thermopileVoltStdDev".
+     */
+    explicit ApogeeSL510_Thermopile_Voltage_StdDev(
+        ApogeeSL510* parentSense, const char* uuid = "",
+        const char* varCode = SL510_THERMOPILE_VOLTAGE_STDDEV_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)SL510_THERMOPILE_VOLTAGE_STDDEV_VAR_NUM,
+                   (uint8_t)SL510_THERMOPILE_VOLTAGE_STDDEV_RESOLUTION, SL510_THERMOPILE_VOLTAGE_STDDEV_VAR_NAME,
+                   SL510_THERMOPILE_VOLTAGE_STDDEV_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new ApogeeSL510_Thermopile_Voltage_StdDev object.
+     *
+     * @note This must be tied with a parent ApogeeSL510 before it can be used.
+     */
+    ApogeeSL510_Thermopile_Voltage_StdDev()
+        : Variable((const uint8_t)SL510_THERMOPILE_VOLTAGE_STDDEV_VAR_NUM,
+                   (uint8_t)SL510_THERMOPILE_VOLTAGE_STDDEV_RESOLUTION, SL510_THERMOPILE_VOLTAGE_STDDEV_VAR_NAME,
+                   SL510_THERMOPILE_VOLTAGE_STDDEV_UNIT_NAME, SL510_THERMOPILE_VOLTAGE_STDDEV_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the ApogeeSL510_Thermopile_Voltage_StdDev object - no action needed.
+     */
+    ~ApogeeSL510_Thermopile_Voltage_StdDev() {}
+};
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for the number of conversions in the burst
+ * ([burst statistics](@ref sensor_sl510_burst)) from an
+ * [Apogee SL-510](@ref sensor_sl510).
+ *
+ * @ingroup sensor_sl510
+ */
+/* clang-format on */
+class ApogeeSL510_Thermopile_Voltage_Count : public Variable {
+ public:
+    /**
+     * @brief Construct a new ApogeeSL510_Thermopile_Voltage_Count object.
+     *
+     * @param parentSense The parent ApogeeSL510 providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sl510thermopileVoltCount".
+     */
+    explicit ApogeeSL510_Thermopile_Voltage_Count(
+        ApogeeSL510* parentSense, const char* uuid = "",
+        const char* varCode = SL510_THERMOPILE_VOLTAGE_COUNT_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)SL510_THERMOPILE_VOLTAGE_COUNT_VAR_NUM,
+                   (uint8_t)SL510_THERMOPILE_VOLTAGE_COUNT_RESOLUTION, SL510_THERMOPILE_VOLTAGE_COUNT_VAR_NAME,
+                   SL510_THERMOPILE_VOLTAGE_COUNT_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new ApogeeSL510_Thermopile_Voltage_Count object.
+     *
+     * @note This must be tied with a parent ApogeeSL510 before it can be used.
+     */
+    ApogeeSL510_Thermopile_Voltage_Count()
+        : Variable((const uint8_t)SL510_THERMOPILE_VOLTAGE_COUNT_VAR_NUM,
+                   (uint8_t)SL510_THERMOPILE_VOLTAGE_COUNT_RESOLUTION, SL510_THERMOPILE_VOLTAGE_COUNT_VAR_NAME,
+                   SL510_THERMOPILE_VOLTAGE_COUNT_UNIT_NAME, SL510_THERMOPILE_VOLTAGE_COUNT_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the ApogeeSL510_Thermopile_Voltage_Count object - no action needed.
+     */
+    ~ApogeeSL510_Thermopile_Voltage_Count() {}
+};
 /**@}*/
 #endif  // SRC_SENSORS_APOGEESL510_H_
@@ -12,7 +12,6 @@
 
 
 #include "ApogeeSL610.h"
-#include <Adafruit_ADS1015.h>
 
 
 // The constructor - need the power pin and address pin of thermistor
@@ -27,12 +26,36 @@ ApogeeSL610::ApogeeSL610(int8_t powerPin, float k1calib, float k2calib,
       _k2calib(k2calib),
       _thermistorChannel(thermistorChannel),  
       _thermistori2cAddress(thermistori2cAddress),
-      _thermopilei2cAddress(thermopilei2cAddress) {}
+      _thermopilei2cAddress(thermopilei2cAddress),
+      _thermistorADCChannel(ADS1X15_NO_CHANNEL),
+      _thermopileADCChannel(ADS1X15_NO_CHANNEL),
+      _burstWindow_ms(0),
+      _burstRate(ADS1X15_BURST_RATE) {}
 
 // Destructor
 ApogeeSL610::~ApogeeSL610() {}
 
 
+bool ApogeeSL610::setup(void) {
+    ADS1x15Manager::shared.begin();
+    // The thermistor's range depends on its 3.3V excitation, so use a gain of
+    // 1x = +/- 4.096V range.  The thermopile only gives +/- 23.5 mV, so use
+    // 16x = +/- 0.256V range.
+    _thermistorADCChannel = ADS1x15Manager::shared.addSingleEnded(
+        _thermistori2cAddress, _thermistorChannel, GAIN_ONE);
+    _thermopileADCChannel = ADS1x15Manager::shared.addDifferential(
+        _thermopilei2cAddress, DIFF_MUX_2_3, GAIN_SIXTEEN,
+        _burstWindow_ms > 0 ? _burstRate : DR_DEFAULT_SPS);
+    return Sensor::setup();
+}
+
+
+void ApogeeSL610::setBurst(uint16_t window_ms, adsSPS_t rate) {
+    _burstWindow_ms = window_ms;
+    _burstRate      = rate;
+}
+
+
 String ApogeeSL610::getSensorLocation(void) {
 #ifndef MS_USE_ADS1015
     String sensorLocation = F("ADS1115_0x");
@@ -49,6 +72,8 @@ bool ApogeeSL610::addSingleMeasurementResult(void) {
     // Variables to store the results in
     float thermistorVoltage = -9999;
     float thermopileVoltage = -9999;
+    // The statistics of the thermopile burst, if taking one
+    ADS1x15Stats burst = {0, -9999, -9999, -9999, -9999};
     float calibResult = -9999;
 
     // Rt variable for determining if temperature is above or below 0 deg C
@@ -62,48 +87,24 @@ bool ApogeeSL610::addSingleMeasurementResult(void) {
     if (bitRead(_sensorStatus, 6)) {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
 
-// Create an Auxillary ADD object
-// We create and set up the ADC object here so that each sensor using
-// the ADC may set the gain appropriately without effecting others.
-#ifndef MS_USE_ADS1015
-        Adafruit_ADS1115 thermistor_ads(_thermistori2cAddress);  // Use this for the 16-bit version
-        Adafruit_ADS1115 thermopile_ads(_thermopilei2cAddress);
-#else
-        Adafruit_ADS1015 thermistor_ads(_thermistori2cAddress);  // Use this for the 12-bit version
-        Adafruit_ADS1015 thermopile_ads(_thermopilei2cAddress);
-#endif
-        // ADS Library default settings:
-        //  - TI1115 (16 bit)
-        //    - single-shot mode (powers down between conversions)
-        //    - 128 samples per second (8ms conversion time)
-        //    - 2/3 gain +/- 6.144V range (limited to VDD +0.3V max)
-        //  - TI1015 (12 bit)
-        //    - single-shot mode (powers down between conversions)
-        //    - 1600 samples per second (625µs conversion time)
-        //    - 2/3 gain +/- 6.144V range (limited to VDD +0.3V max)
-
-        // Bump the gain up to 1x = +/- 4.096V range for thermistor
-        // Thermistor return range is dependent on the excitation voltage supplied
-        // Using 3.3 switched votls, GAIN_ONE is appropriate
-        thermistor_ads.setGain(GAIN_ONE);
-
-        // Bump the gain up to 16x = +/- 0.256V range for thermopile
-        // Thermopile can return +/- 23.5 mV (0.023V)
-        thermopile_ads.setGain(GAIN_SIXTEEN);
-        // Begin ADCs
-        thermistor_ads.begin();
-        thermopile_ads.begin();
-
-        // Read Analog to Digital Converter (ADC)
-        // Taking this reading includes the 8ms conversion delay.
-        // We're allowing the ADS1115 library to do the bit-to-volts conversion
-        // for us
+        // Get the readings from the shared ADC manager.  The first sensor to
+        // ask converts every registered channel, on every chip at once.
         thermistorVoltage =
-            thermistor_ads.readADC_SingleEnded_V(_thermistorChannel);  // Getting the reading
-        MS_DBG(F("  thermistor_ads.readADC_SingleEnded_V("), _thermistorChannel, F("):"),
-               thermistorVoltage);
-        thermopileVoltage = thermopile_ads.readADC_Differential_2_3_V();  // Getting the reading
-        MS_DBG(F("  thermopile_ads.readADC_Differential_2_3_V():"), thermopileVoltage);
+            ADS1x15Manager::shared.readVoltage(_thermistorADCChannel);
+        MS_DBG(F("  Thermistor voltage:"), thermistorVoltage);
+        if (_burstWindow_ms > 0) {
+            // Sample the thermopile for the whole window; its mean stands in
+            // for a single reading
+            ADS1x15Manager::shared.burst(_thermopileADCChannel, _burstWindow_ms,
+                                         burst);
+            thermopileVoltage = burst.mean;
+            MS_DBG(F("  Thermopile burst of"), burst.count,
+                   F("conversions, standard deviation:"), burst.stdDev);
+        } else {
+            thermopileVoltage =
+                ADS1x15Manager::shared.readVoltage(_thermopileADCChannel);
+        }
+        MS_DBG(F("  Thermopile voltage:"), thermopileVoltage);
 
         if ((thermistorVoltage < 3.6 && thermistorVoltage > -0.3) && (thermopileVoltage * 1000 > -23.5 && thermopileVoltage * 1000 < 23.5)) {
             // Skip results out of range
@@ -120,6 +121,7 @@ bool ApogeeSL610::addSingleMeasurementResult(void) {
             // set invalid voltages back to -9999
             thermistorVoltage = -9999;
             thermopileVoltage = -9999;
+            burst = {0, -9999, -9999, -9999, -9999};
         }
     } else {
         MS_DBG(getSensorNameAndLocation(), F("is not currently measuring!"));
@@ -128,6 +130,14 @@ bool ApogeeSL610::addSingleMeasurementResult(void) {
     verifyAndAddMeasurementResult(SL610_OLWR_VAR_NUM, calibResult);
     verifyAndAddMeasurementResult(SL610_THERMISTOR_VOLTAGE_VAR_NUM, thermistorVoltage);
     verifyAndAddMeasurementResult(SL610_THERMOPILE_VOLTAGE_VAR_NUM, thermopileVoltage);
+    verifyAndAddMeasurementResult(SL610_THERMOPILE_VOLTAGE_MIN_VAR_NUM,
+                                  burst.min);
+    verifyAndAddMeasurementResult(SL610_THERMOPILE_VOLTAGE_MAX_VAR_NUM,
+                                  burst.max);
+    verifyAndAddMeasurementResult(SL610_THERMOPILE_VOLTAGE_STDDEV_VAR_NUM,
+                                  burst.stdDev);
+    verifyAndAddMeasurementResult(SL610_THERMOPILE_VOLTAGE_COUNT_VAR_NUM,
+                                  burst.count > 0 ? burst.count : -9999);
 
     // Unset the time stamp for the beginning of this measurement
     _millisMeasurementRequested = 0;
@@ -12,7 +12,6 @@
 
 
 #include "ApogeeSP510.h"
-#include <Adafruit_ADS1015.h>
 
 
 // The constructor - need the power pin
@@ -22,12 +21,32 @@ ApogeeSP510::ApogeeSP510(int8_t powerPin, float calibrationFactor,
              SP510_STABILIZATION_TIME_MS, SP510_MEASUREMENT_TIME_MS, powerPin,
              -1, measurementsToAverage, SP510_INC_CALC_VARIABLES),
       _calibrationFactor(calibrationFactor),
-      _i2cAddress(i2cAddress) {}
+      _i2cAddress(i2cAddress),
+      _adcChannel(ADS1X15_NO_CHANNEL),
+      _burstWindow_ms(0),
+      _burstRate(ADS1X15_BURST_RATE) {}
 
 // Destructor
 ApogeeSP510::~ApogeeSP510() {}
 
 
+bool ApogeeSP510::setup(void) {
+    ADS1x15Manager::shared.begin();
+    // The thermopile's output is at most a few tens of mV, so use a gain of
+    // 16x = +/- 0.256V range
+    _adcChannel = ADS1x15Manager::shared.addDifferential(
+        _i2cAddress, DIFF_MUX_2_3, GAIN_SIXTEEN,
+        _burstWindow_ms > 0 ? _burstRate : DR_DEFAULT_SPS);
+    return Sensor::setup();
+}
+
+
+void ApogeeSP510::setBurst(uint16_t window_ms, adsSPS_t rate) {
+    _burstWindow_ms = window_ms;
+    _burstRate      = rate;
+}
+
+
 String ApogeeSP510::getSensorLocation(void) {
 #ifndef MS_USE_ADS1015
     String sensorLocation = F("ADS1115_0x");
@@ -43,6 +62,8 @@ String ApogeeSP510::getSensorLocation(void) {
 bool ApogeeSP510::addSingleMeasurementResult(void) {
     // Variables to store the results in
     float adcVoltage  = -9999;
+    // The statistics of the thermopile burst, if taking one
+    ADS1x15Stats burst = {0, -9999, -9999, -9999, -9999};
     float calibResult = -9999;
 
     // Check a measurement was *successfully* started (status bit 6 set)
@@ -50,39 +71,20 @@ bool ApogeeSP510::addSingleMeasurementResult(void) {
     if (bitRead(_sensorStatus, 6)) {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
 
-// Create an Auxillary ADD object
-// We create and set up the ADC object here so that each sensor using
-// the ADC may set the gain appropriately without effecting others.
-#ifndef MS_USE_ADS1015
-        Adafruit_ADS1115 ads(_i2cAddress);  // Use this for the 16-bit version
-#else
-        Adafruit_ADS1015 ads(_i2cAddress);  // Use this for the 12-bit version
-#endif
-        // ADS Library default settings:
-        //  - TI1115 (16 bit)
-        //    - single-shot mode (powers down between conversions)
-        //    - 128 samples per second (8ms conversion time)
-        //    - 2/3 gain +/- 6.144V range (limited to VDD +0.3V max)
-        //  - TI1015 (12 bit)
-        //    - single-shot mode (powers down between conversions)
-        //    - 1600 samples per second (625µs conversion time)
-        //    - 2/3 gain +/- 6.144V range (limited to VDD +0.3V max)
-
-        // Bump the gain up to 1x = +/- 4.096V range
-        // Sensor return range is 0-2.5V, but the next gain option is 2x which
-        // only allows up to 2.048V
-        ads.setGain(GAIN_SIXTEEN);
-        // Begin ADC
-        ads.begin();
-
-        // Read Analog to Digital Converter (ADC)
-        // Taking this reading includes the 8ms conversion delay.
-        // We're allowing the ADS1115 library to do the bit-to-volts conversion
-        // for us
-        adcVoltage =
-            ads.readADC_Differential_2_3_V();  // Getting the reading
-        MS_DBG(F("  ads.readADC_Differential_2_3_V():"),
-               adcVoltage);
+        // Get the reading from the shared ADC manager.  The first sensor to
+        // ask converts every registered channel, on every chip at once.
+        if (_burstWindow_ms > 0) {
+            // Sample the thermopile for the whole window; its mean stands in
+            // for a single reading
+            ADS1x15Manager::shared.burst(_adcChannel, _burstWindow_ms,
+                                         burst);
+            adcVoltage = burst.mean;
+            MS_DBG(F("  Thermopile burst of"), burst.count,
+                   F("conversions, standard deviation:"), burst.stdDev);
+        } else {
+            adcVoltage = ADS1x15Manager::shared.readVoltage(_adcChannel);
+        }
+        MS_DBG(F("  Thermopile voltage:"), adcVoltage);
 
         if (adcVoltage * 1000 < 90 && adcVoltage * 1000 > -5) {
             // Skip results out of range
@@ -92,6 +94,7 @@ bool ApogeeSP510::addSingleMeasurementResult(void) {
         } else {
             // set invalid voltages back to -9999
             adcVoltage = -9999;
+            burst = {0, -9999, -9999, -9999, -9999};
         }
     } else {
         MS_DBG(getSensorNameAndLocation(), F("is not currently measuring!"));
@@ -99,6 +102,11 @@ bool ApogeeSP510::addSingleMeasurementResult(void) {
 
     verifyAndAddMeasurementResult(SP510_ISWR_VAR_NUM, calibResult);
     verifyAndAddMeasurementResult(SP510_VOLTAGE_VAR_NUM, adcVoltage);
+    verifyAndAddMeasurementResult(SP510_VOLTAGE_MIN_VAR_NUM, burst.min);
+    verifyAndAddMeasurementResult(SP510_VOLTAGE_MAX_VAR_NUM, burst.max);
+    verifyAndAddMeasurementResult(SP510_VOLTAGE_STDDEV_VAR_NUM, burst.stdDev);
+    verifyAndAddMeasurementResult(SP510_VOLTAGE_COUNT_VAR_NUM,
+                                  burst.count > 0 ? burst.count : -9999);
 
     // Unset the time stamp for the beginning of this measurement
     _millisMeasurementRequested = 0;
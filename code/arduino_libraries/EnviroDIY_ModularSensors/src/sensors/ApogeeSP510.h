@@ -82,14 +82,16 @@
 #undef MS_DEBUGGING_STD
 #include "VariableBase.h"
 #include "SensorBase.h"
+#include "ADS1x15Manager.h"
 
 /** @ingroup sensor_sp510 */
 /**@{*/
 
 // Sensor Specific Defines
-/// @brief Sensor::_numReturnedValues; the SP510 can report 2 values, raw
-/// voltage and calculated incoming shortwave radiation.
-#define SP510_NUM_VARIABLES 2
+/// @brief Sensor::_numReturnedValues; the SP510 can report 6 values, raw
+/// voltage, calculated incoming shortwave radiation, and the minimum, maximum,
+/// standard deviation and count of a thermopile burst.
+#define SP510_NUM_VARIABLES 6
 /// @brief Sensor::_incCalcValues; ISWR is calculated from the raw voltage.
 #define SP510_INC_CALC_VARIABLES 1
 
@@ -195,6 +197,70 @@
 #endif
 /**@}*/
 
+/**
+ * @anchor sensor_sp510_burst
+ * @name Burst Statistics
+ * The statistics of the thermopile voltage from an Apogee SP-510 sampled in a
+ * burst; see ApogeeSP510::setBurst().  The mean of the burst is reported as the
+ * [thermopile voltage](@ref sensor_sp510_voltage).  These are -9999 unless
+ * bursts are on.
+ *
+ * {{ @ref ApogeeSP510_Voltage_Min }}
+ * {{ @ref ApogeeSP510_Voltage_Max }}
+ * {{ @ref ApogeeSP510_Voltage_StdDev }}
+ * {{ @ref ApogeeSP510_Voltage_Count }}
+ */
+/**@{*/
+/// Variable number; the lowest voltage is stored in
+/// sensorValues[2].
+#define SP510_VOLTAGE_MIN_VAR_NUM 2
+/// @brief Variable name; "thermopileVoltageMinimum"
+#define SP510_VOLTAGE_MIN_VAR_NAME "thermopileVoltageMinimum"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/); "volt" (V)
+#define SP510_VOLTAGE_MIN_UNIT_NAME "volt"
+/// @brief Default variable short code; "sp510thermopileVoltMin"
+#define SP510_VOLTAGE_MIN_DEFAULT_CODE "sp510thermopileVoltMin"
+/// @brief Decimals places in string representation
+#define SP510_VOLTAGE_MIN_RESOLUTION SP510_VOLTAGE_RESOLUTION
+/// Variable number; the highest voltage is stored in
+/// sensorValues[3].
+#define SP510_VOLTAGE_MAX_VAR_NUM 3
+/// @brief Variable name; "thermopileVoltageMaximum"
+#define SP510_VOLTAGE_MAX_VAR_NAME "thermopileVoltageMaximum"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/); "volt" (V)
+#define SP510_VOLTAGE_MAX_UNIT_NAME "volt"
+/// @brief Default variable short code; "sp510thermopileVoltMax"
+#define SP510_VOLTAGE_MAX_DEFAULT_CODE "sp510thermopileVoltMax"
+/// @brief Decimals places in string representation
+#define SP510_VOLTAGE_MAX_RESOLUTION SP510_VOLTAGE_RESOLUTION
+/// Variable number; the standard deviation is stored in
+/// sensorValues[4].
+#define SP510_VOLTAGE_STDDEV_VAR_NUM 4
+/// @brief Variable name; "thermopileVoltageStandardDeviation"
+#define SP510_VOLTAGE_STDDEV_VAR_NAME "thermopileVoltageStandardDeviation"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/); "volt" (V)
+#define SP510_VOLTAGE_STDDEV_UNIT_NAME "volt"
+/// @brief Default variable short code; "sp510thermopileVoltStdDev"
+#define SP510_VOLTAGE_STDDEV_DEFAULT_CODE "sp510thermopileVoltStdDev"
+/// @brief Decimals places in string representation
+#define SP510_VOLTAGE_STDDEV_RESOLUTION (SP510_VOLTAGE_RESOLUTION + 1)
+/// Variable number; the number of conversions is stored in
+/// sensorValues[5].
+#define SP510_VOLTAGE_COUNT_VAR_NUM 5
+/// @brief Variable name; "thermopileVoltageSampleCount"
+#define SP510_VOLTAGE_COUNT_VAR_NAME "thermopileVoltageSampleCount"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/); "count"
+#define SP510_VOLTAGE_COUNT_UNIT_NAME "count"
+/// @brief Default variable short code; "sp510thermopileVoltCount"
+#define SP510_VOLTAGE_COUNT_DEFAULT_CODE "sp510thermopileVoltCount"
+/// @brief Decimals places in string representation
+#define SP510_VOLTAGE_COUNT_RESOLUTION 0
+/**@}*/
+
 /**
  * @brief The calibration factor between output in volts and W m-2
  * (wattspermetersquared)
@@ -251,14 +317,42 @@ class ApogeeSP510 : public Sensor {
      */
     String getSensorLocation(void) override;
 
+    /**
+     * @brief Register the sensor's conversions with the shared ADS1x15
+     * manager.
+     *
+     * @return **bool** True if the setup was successful.
+     */
+    bool setup(void) override;
+
+    /**
+     * @brief Sample the thermopile in a burst for each measurement
+     *
+     * Rather than a single conversion, the thermopile is converted
+     * continuously at the given data rate for the whole window, and the mean,
+     * minimum, maximum, standard deviation and number of the conversions are
+     * reported.  The mean is used for the radiation.  Each burst is one
+     * measurement, so measurementsToAverage can be left at 1.  This must be
+     * called before setup().
+     *
+     * @param window_ms How long each burst lasts, in milliseconds; 0 turns
+     * bursts back off.
+     * @param rate The data rate to convert at; optional with the fastest rate
+     * (#ADS1X15_BURST_RATE) as the default.
+     */
+    void setBurst(uint16_t window_ms, adsSPS_t rate = ADS1X15_BURST_RATE);
+
     /**
      * @copydoc Sensor::addSingleMeasurementResult()
      */
     bool addSingleMeasurementResult(void) override;
 
  private:
-    float   _calibrationFactor;
-    uint8_t _i2cAddress;
+    float    _calibrationFactor;
+    uint8_t  _i2cAddress;
+    uint8_t  _adcChannel;
+    uint16_t _burstWindow_ms;
+    adsSPS_t _burstRate;
 };
 
 
@@ -345,5 +439,176 @@ class ApogeeSP510_Voltage : public Variable {
      */
     ~ApogeeSP510_Voltage() {}
 };
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for
+ * the lowest thermopile voltage in the burst
+ * ([burst statistics](@ref sensor_sp510_burst)) from an
+ * [Apogee SP-510](@ref sensor_sp510).
+ *
+ * @ingroup sensor_sp510
+ */
+/* clang-format on */
+class ApogeeSP510_Voltage_Min : public Variable {
+ public:
+    /**
+     * @brief Construct a new ApogeeSP510_Voltage_Min object.
+     *
+     * @param parentSense The parent ApogeeSP510 providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sp510thermopileVoltMin".
+     */
+    explicit ApogeeSP510_Voltage_Min(
+        ApogeeSP510* parentSense, const char* uuid = "",
+        const char* varCode = SP510_VOLTAGE_MIN_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)SP510_VOLTAGE_MIN_VAR_NUM,
+                   (uint8_t)SP510_VOLTAGE_MIN_RESOLUTION, SP510_VOLTAGE_MIN_VAR_NAME,
+                   SP510_VOLTAGE_MIN_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new ApogeeSP510_Voltage_Min object.
+     *
+     * @note This must be tied with a parent ApogeeSP510 before it can be used.
+     */
+    ApogeeSP510_Voltage_Min()
+        : Variable((const uint8_t)SP510_VOLTAGE_MIN_VAR_NUM,
+                   (uint8_t)SP510_VOLTAGE_MIN_RESOLUTION, SP510_VOLTAGE_MIN_VAR_NAME,
+                   SP510_VOLTAGE_MIN_UNIT_NAME, SP510_VOLTAGE_MIN_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the ApogeeSP510_Voltage_Min object - no action needed.
+     */
+    ~ApogeeSP510_Voltage_Min() {}
+};
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for
+ * the highest thermopile voltage in the burst
+ * ([burst statistics](@ref sensor_sp510_burst)) from an
+ * [Apogee SP-510](@ref sensor_sp510).
+ *
+ * @ingroup sensor_sp510
+ */
+/* clang-format on */
+class ApogeeSP510_Voltage_Max : public Variable {
+ public:
+    /**
+     * @brief Construct a new ApogeeSP510_Voltage_Max object.
+     *
+     * @param parentSense The parent ApogeeSP510 providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sp510thermopileVoltMax".
+     */
+    explicit ApogeeSP510_Voltage_Max(
+        ApogeeSP510* parentSense, const char* uuid = "",
+        const char* varCode = SP510_VOLTAGE_MAX_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)SP510_VOLTAGE_MAX_VAR_NUM,
+                   (uint8_t)SP510_VOLTAGE_MAX_RESOLUTION, SP510_VOLTAGE_MAX_VAR_NAME,
+                   SP510_VOLTAGE_MAX_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new ApogeeSP510_Voltage_Max object.
+     *
+     * @note This must be tied with a parent ApogeeSP510 before it can be used.
+     */
+    ApogeeSP510_Voltage_Max()
+        : Variable((const uint8_t)SP510_VOLTAGE_MAX_VAR_NUM,
+                   (uint8_t)SP510_VOLTAGE_MAX_RESOLUTION, SP510_VOLTAGE_MAX_VAR_NAME,
+                   SP510_VOLTAGE_MAX_UNIT_NAME, SP510_VOLTAGE_MAX_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the ApogeeSP510_Voltage_Max object - no action needed.
+     */
+    ~ApogeeSP510_Voltage_Max() {}
+};
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for
+ * the standard deviation of the thermopile voltage in the burst
+ * ([burst statistics](@ref sensor_sp510_burst)) from an
+ * [Apogee SP-510](@ref sensor_sp510).
+ *
+ * @ingroup sensor_sp510
+ */
+/* clang-format on */
+class ApogeeSP510_Voltage_StdDev : public Variable {
+ public:
+    /**
+     * @brief Construct a new ApogeeSP510_Voltage_StdDev object.
+     *
+     * @param parentSense The parent ApogeeSP510 providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sp510thermopileVoltStdDev".
+     */
+    explicit ApogeeSP510_Voltage_StdDev(
+        ApogeeSP510* parentSense, const char* uuid = "",
+        const char* varCode = SP510_VOLTAGE_STDDEV_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)SP510_VOLTAGE_STDDEV_VAR_NUM,
+                   (uint8_t)SP510_VOLTAGE_STDDEV_RESOLUTION, SP510_VOLTAGE_STDDEV_VAR_NAME,
+                   SP510_VOLTAGE_STDDEV_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new ApogeeSP510_Voltage_StdDev object.
+     *
+     * @note This must be tied with a parent ApogeeSP510 before it can be used.
+     */
+    ApogeeSP510_Voltage_StdDev()
+        : Variable((const uint8_t)SP510_VOLTAGE_STDDEV_VAR_NUM,
+                   (uint8_t)SP510_VOLTAGE_STDDEV_RESOLUTION, SP510_VOLTAGE_STDDEV_VAR_NAME,
+                   SP510_VOLTAGE_STDDEV_UNIT_NAME, SP510_VOLTAGE_STDDEV_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the ApogeeSP510_Voltage_StdDev object - no action needed.
+     */
+    ~ApogeeSP510_Voltage_StdDev() {}
+};
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for the number of conversions in the burst
+ * ([burst statistics](@ref sensor_sp510_burst)) from an
+ * [Apogee SP-510](@ref sensor_sp510).
+ *
+ * @ingroup sensor_sp510
+ */
+/* clang-format on */
+class ApogeeSP510_Voltage_Count : public Variable {
+ public:
+    /**
+     * @brief Construct a new ApogeeSP510_Voltage_Count object.
+     *
+     * @param parentSense The parent ApogeeSP510 providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sp510thermopileVoltCount".
+     */
+    explicit ApogeeSP510_Voltage_Count(
+        ApogeeSP510* parentSense, const char* uuid = "",
+        const char* varCode = SP510_VOLTAGE_COUNT_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)SP510_VOLTAGE_COUNT_VAR_NUM,
+                   (uint8_t)SP510_VOLTAGE_COUNT_RESOLUTION, SP510_VOLTAGE_COUNT_VAR_NAME,
+                   SP510_VOLTAGE_COUNT_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new ApogeeSP510_Voltage_Count object.
+     *
+     * @note This must be tied with a parent ApogeeSP510 before it can be used.
+     */
+    ApogeeSP510_Voltage_Count()
+        : Variable((const uint8_t)SP510_VOLTAGE_COUNT_VAR_NUM,
+                   (uint8_t)SP510_VOLTAGE_COUNT_RESOLUTION, SP510_VOLTAGE_COUNT_VAR_NAME,
+                   SP510_VOLTAGE_COUNT_UNIT_NAME, SP510_VOLTAGE_COUNT_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the ApogeeSP510_Voltage_Count object - no action needed.
+     */
+    ~ApogeeSP510_Voltage_Count() {}
+};
 /**@}*/
 #endif  // SRC_SENSORS_APOGEESP510_H_
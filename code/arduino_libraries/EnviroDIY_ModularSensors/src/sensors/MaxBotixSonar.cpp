@@ -17,7 +17,12 @@ MaxBotixSonar::MaxBotixSonar(Stream* stream, int32_t sonarHeight, int8_t powerPi
              measurementsToAverage),
       _sonarHeight(sonarHeight),
       _triggerPin(triggerPin),
-      _stream(stream) {}
+      _stream(stream),
+      _frameValue(0),
+      _frameDigits(-1),
+      _goodRanges(0),
+      _badRanges(0),
+      _rangesAgree(false) {}
 MaxBotixSonar::MaxBotixSonar(Stream& stream, int32_t sonarHeight, int8_t powerPin, int8_t triggerPin,
                              uint8_t measurementsToAverage)
     : Sensor("MaxBotixMaxSonar", HRXL_NUM_VARIABLES, HRXL_WARM_UP_TIME_MS,
@@ -25,7 +30,12 @@ MaxBotixSonar::MaxBotixSonar(Stream& stream, int32_t sonarHeight, int8_t powerPi
              measurementsToAverage, HRXL_INC_CALC_VARIABLES),
       _sonarHeight(sonarHeight),
       _triggerPin(triggerPin),
-      _stream(&stream) {}
+      _stream(&stream),
+      _frameValue(0),
+      _frameDigits(-1),
+      _goodRanges(0),
+      _badRanges(0),
+      _rangesAgree(false) {}
 // Destructor
 MaxBotixSonar::~MaxBotixSonar() {}
 
@@ -69,12 +79,8 @@ bool MaxBotixSonar::wake(void) {
 
     // NOTE ALSO:  Depending on what type of serial stream you are using, there
     // may also be a bunch of junk in the buffer that this will clear out.
-    MS_DBG(F("Dumping Header Lines from MaxBotix on"), getSensorLocation());
-    for (int i = 0; i < 6; i++) {
-        String headerLine = _stream->readStringUntil('\r');
-        MS_DBG(i, '-', headerLine);
-    }
-    // Clear anything else out of the stream buffer
+    // Anything of the header still to come isn't a range frame, so it's
+    // skipped when the ranges are read.
     auto junkChars = static_cast<uint8_t>(_stream->available());
     if (junkChars) {
         MS_DBG(F("Dumping"), junkChars,
@@ -95,12 +101,14 @@ bool MaxBotixSonar::wake(void) {
 }
 
 
-bool MaxBotixSonar::addSingleMeasurementResult(void) {
-    // Initialize values
-    bool    success = false;
-    int16_t result  = -9999;
+bool MaxBotixSonar::startSingleMeasurement(void) {
+    // Sensor::startSingleMeasurement() checks that if it's awake/active and
+    // sets the timestamp and status bits.  If it returns false, there's no
+    // reason to go on.
+    if (!Sensor::startSingleMeasurement()) return false;
 
-    // Clear anything out of the stream buffer
+    // Clear anything out of the stream buffer; only ranges sent from now on
+    // belong to this measurement
     auto junkChars = static_cast<uint8_t>(_stream->available());
     if (junkChars) {
         MS_DBG(F("Dumping"), junkChars,
@@ -117,68 +125,66 @@ bool MaxBotixSonar::addSingleMeasurementResult(void) {
 #endif
     }
 
+    _frameDigits = -1;
+    _goodRanges  = 0;
+    _badRanges   = 0;
+    _rangesAgree = false;
+    trigger();
+    return true;
+}
+
+
+bool MaxBotixSonar::isMeasurementComplete(bool debug) {
+    // Without a measurement running there are no ranges to wait for
+    if (!bitRead(_sensorStatus, 6)) {
+        return Sensor::isMeasurementComplete(debug);
+    }
+
+    readRanges();
+    if (_rangesAgree || _goodRanges >= HRXL_MAX_RANGES) {
+        if (debug) {
+            MS_DBG(F("Measurement by"), getSensorNameAndLocation(),
+                   F("is complete after"), _goodRanges, F("good ranges"));
+        }
+        return true;
+    }
+    if (millis() - _millisMeasurementRequested > HRXL_ACQUISITION_TIMEOUT_MS) {
+        if (debug) {
+            MS_DBG(F("Measurement by"), getSensorNameAndLocation(),
+                   F("timed out with"), _goodRanges, F("good ranges"));
+        }
+        return true;
+    }
+    return false;
+}
+
+
+bool MaxBotixSonar::addSingleMeasurementResult(void) {
+    // Initialize values
+    int16_t result          = -9999;
+    float   acquisitionTime = -9999;
+
     // Check a measurement was *successfully* started (status bit 6 set)
     // Only go on to get a result if it was
     if (bitRead(_sensorStatus, 6)) {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
 
-        uint8_t rangeAttempts = 0;
-        while (success == false && rangeAttempts < 25) {
-            // If the sonar is running on a trigger, activating the trigger
-            // should in theory happen within the startSingleMeasurement
-            // function.  Because we're really taking up to 25 measurements
-            // for each "single measurement" until a valid value is returned
-            // and the measurement time is <166ms, we'll actually activate
-            // the trigger here.
-            if (_triggerPin >= 0) {
-                MS_DBG(F("  Triggering Sonar with"), _triggerPin);
-                digitalWrite(_triggerPin, HIGH);
-                delayMicroseconds(30);  // Trigger must be held high for >20 µs
-                digitalWrite(_triggerPin, LOW);
-            }
-
-            delay(1000);
-
-            // Get through a bunch of readings as the sensor tends to get more precise the more readings it takes
-            for (int y = 0; y < 50; y++) {
-                if (_stream->available() > 3) {
-                    String trash = _stream->readStringUntil('\r');
-                }
-                
-                //_stream->read();
-                //_stream->parseInt();
-            }
-
-            // Immediately ask for a result and let the stream timeout be our
-            // "wait" for the measurement.
-            result = static_cast<uint16_t>(_stream->parseInt());
-            _stream->read();  // To throw away the carriage return
-            MS_DBG(F("  Sonar Range:"), result);
-            rangeAttempts++;
-
-            // If it cannot obtain a result , the sonar is supposed to send a
-            // value just above it's max range.  For 10m models, this is 9999,
-            // for 5m models it's 4999.  The sonar might also send readings of
-            // 300 or 500 (the blanking distance) if there are too many acoustic
-            // echos. If the result becomes garbled or the sonar is
-            // disconnected, the parseInt function returns 0.  Luckily, these
-            // sensors are not capable of reading 0, so we also know the 0 value
-            // is bad.
-            if (result <= 300 || result == 500 || result == 5000 ||
-                result == 9999 || result == 0 || result > _sonarHeight) {
-                MS_DBG(F("  Bad or Suspicious Result, Retry Attempt #"),
-                       rangeAttempts);
-                result = -9999;
-            } else {
-                MS_DBG(F("  Good result found"));
-                success = true;
-            }
+        readRanges();
+        acquisitionTime = millis() - _millisMeasurementRequested;
+        result          = medianRange();
+        MS_DBG(F("  Median Range:"), result, F("from"), _goodRanges,
+               F("good and"), _badRanges, F("bad ranges in"), acquisitionTime,
+               F("ms"));
+        if (result != -9999 && !_rangesAgree) {
+            MS_DBG(F("  The last ranges did not agree"));
         }
     } else {
         MS_DBG(getSensorNameAndLocation(), F("is not currently measuring!"));
     }
 
     verifyAndAddMeasurementResult(HRXL_VAR_NUM, result);
+    verifyAndAddMeasurementResult(HRXL_ACQUISITION_TIME_VAR_NUM,
+                                  acquisitionTime);
 
     // Unset the time stamp for the beginning of this measurement
     _millisMeasurementRequested = 0;
@@ -186,5 +192,98 @@ bool MaxBotixSonar::addSingleMeasurementResult(void) {
     _sensorStatus &= 0b10011111;
 
     // Return values shows if we got a not-obviously-bad reading
-    return success;
+    return result != -9999;
+}
+
+
+// Picks the 'R####\r' range frames out of the stream a character at a time.
+// The header lines and anything garbled are skipped.
+void MaxBotixSonar::readRanges(void) {
+    while (!_rangesAgree && _goodRanges < HRXL_MAX_RANGES &&
+           _stream->available()) {
+        char c = _stream->read();
+        if (c == 'R') {
+            _frameValue  = 0;
+            _frameDigits = 0;
+            continue;
+        }
+        if (_frameDigits >= 0 && _frameDigits < 4 && c >= '0' && c <= '9') {
+            _frameValue = _frameValue * 10 + (c - '0');
+            _frameDigits++;
+            continue;
+        }
+        bool framed  = _frameDigits == 4 && c == '\r';
+        _frameDigits = -1;
+        if (!framed) continue;
+
+        MS_DBG(F("  Sonar Range:"), _frameValue);
+        // Ask for the next range before looking at this one
+        trigger();
+        if (!isGoodRange(_frameValue)) {
+            MS_DBG(F("  Bad or Suspicious Result"));
+            if (_badRanges < 255) _badRanges++;
+            continue;
+        }
+
+        // Keep the latest good ranges, dropping the oldest once full
+        if (_goodRanges >= HRXL_RANGES_TO_AGREE) {
+            for (uint8_t i = 1; i < HRXL_RANGES_TO_AGREE; i++) {
+                _ranges[i - 1] = _ranges[i];
+            }
+            _ranges[HRXL_RANGES_TO_AGREE - 1] = _frameValue;
+        } else {
+            _ranges[_goodRanges] = _frameValue;
+        }
+        _goodRanges++;
+
+        if (_goodRanges >= HRXL_RANGES_TO_AGREE) {
+            uint16_t low  = _ranges[0];
+            uint16_t high = _ranges[0];
+            for (uint8_t i = 1; i < HRXL_RANGES_TO_AGREE; i++) {
+                if (_ranges[i] < low) low = _ranges[i];
+                if (_ranges[i] > high) high = _ranges[i];
+            }
+            _rangesAgree = high - low <= HRXL_AGREEMENT_MM;
+        }
+    }
+}
+
+
+bool MaxBotixSonar::isGoodRange(uint16_t range) {
+    // If it cannot obtain a result , the sonar is supposed to send a value
+    // just above it's max range.  For 10m models, this is 9999, for 5m models
+    // it's 4999.  The sonar might also send readings of 300 or 500 (the
+    // blanking distance) if there are too many acoustic echos.  These sensors
+    // are not capable of reading 0, so we also know the 0 value is bad.
+    return !(range <= 300 || range == 500 || range == 5000 || range == 9999 ||
+             range > _sonarHeight);
+}
+
+
+int16_t MaxBotixSonar::medianRange(void) {
+    uint8_t n = _goodRanges < HRXL_RANGES_TO_AGREE ? _goodRanges
+                                                   : HRXL_RANGES_TO_AGREE;
+    if (n == 0) return -9999;
+
+    uint16_t sorted[HRXL_RANGES_TO_AGREE];
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > _ranges[i]) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = _ranges[i];
+    }
+    if (n % 2) return sorted[n / 2];
+    return (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+
+void MaxBotixSonar::trigger(void) {
+    // In free-ranging mode the MaxSonar sends ranges on its own
+    if (_triggerPin < 0) return;
+    MS_DBG(F("  Triggering Sonar with"), _triggerPin);
+    digitalWrite(_triggerPin, HIGH);
+    delayMicroseconds(30);  // Trigger must be held high for >20 µs
+    digitalWrite(_triggerPin, LOW);
 }
@@ -5,7 +5,7 @@
  * @author Sara Geleskie Damiano <sdamiano@stroudcenter.org>
  *
  * @brief Contains the MaxBotixSonar sensor subclass and the MaxBotixSonar_Range
- * variable subclass.
+ * and MaxBotixSonar_AcquisitionTime variable subclasses.
  *
  * These are for the MaxBotix HRXL-MaxSonar ultrasonic range finders.
  */
@@ -55,6 +55,15 @@
  * effective.  In this case, you may save a very small amount of power by
  * setting up a trigger pin and manually trigger individual readings.
  *
+ * Each range arrives as a frame of an 'R', four digits and a carriage return.
+ * The frames are picked out of the stream a character at a time as they arrive,
+ * so the logger can look after its other sensors while the sonar ranges.  A
+ * measurement is finished as soon as #HRXL_RANGES_TO_AGREE good ranges in a row
+ * agree to within #HRXL_AGREEMENT_MM, and their median is reported.  Otherwise
+ * it ends after #HRXL_MAX_RANGES good ranges or #HRXL_ACQUISITION_TIMEOUT_MS,
+ * with the median of the last good ranges.  How long each measurement took is
+ * reported as well.
+ *
  * Please see the section
  * "[Notes on Arduino Streams and Software Serial](@ref page_arduino_streams)"
  * for more information about what streams can be used along with this library.
@@ -116,8 +125,9 @@
 /**@{*/
 
 // Sensor Specific Defines
-/// @brief Sensor::_numReturnedValues; the HRXL can report 1 value.
-#define HRXL_NUM_VARIABLES 1
+/// @brief Sensor::_numReturnedValues; the HRXL can report 2 values, the range
+/// and how long it took to get it.
+#define HRXL_NUM_VARIABLES 2
 /// @brief Sensor::_incCalcValues; we don't calculate any additional values.
 #define HRXL_INC_CALC_VARIABLES 0
 
@@ -137,6 +147,44 @@
 #define HRXL_MEASUREMENT_TIME_MS 166
 /**@}*/
 
+/**
+ * @anchor sensor_maxbotix_acquisition
+ * @name Range Acquisition
+ * When a measurement is finished.  Each of these can be changed with a build
+ * flag of the same name.
+ */
+/**@{*/
+/**
+ * @def HRXL_RANGES_TO_AGREE
+ * @brief The number of good ranges in a row that must agree to finish a
+ * measurement early.
+ */
+#ifndef HRXL_RANGES_TO_AGREE
+#define HRXL_RANGES_TO_AGREE 3
+#endif
+/**
+ * @def HRXL_AGREEMENT_MM
+ * @brief The most the agreeing ranges may differ by, in millimeters.
+ */
+#ifndef HRXL_AGREEMENT_MM
+#define HRXL_AGREEMENT_MM 10
+#endif
+/**
+ * @def HRXL_MAX_RANGES
+ * @brief The most good ranges to read for one measurement.
+ */
+#ifndef HRXL_MAX_RANGES
+#define HRXL_MAX_RANGES 25
+#endif
+/**
+ * @def HRXL_ACQUISITION_TIMEOUT_MS
+ * @brief The longest a measurement may take, in milliseconds.
+ */
+#ifndef HRXL_ACQUISITION_TIMEOUT_MS
+#define HRXL_ACQUISITION_TIMEOUT_MS 5000L
+#endif
+/**@}*/
+
 /**
  * @anchor sensor_maxbotix_range
  * @name Range
@@ -164,6 +212,31 @@
 #define HRXL_DEFAULT_CODE "sonarRange"
 /**@}*/
 
+/**
+ * @anchor sensor_maxbotix_acquisition_time
+ * @name Acquisition Time
+ * How long a MaxBotix HRXL took to give a range, from the start of the
+ * measurement until its ranges agreed or it gave up; a diagnostic.
+ *
+ * {{ @ref MaxBotixSonar_AcquisitionTime::MaxBotixSonar_AcquisitionTime }}
+ */
+/**@{*/
+/// @brief Decimals places in string representation; acquisition time should
+/// have 0 - resolution is 1ms.
+#define HRXL_ACQUISITION_TIME_RESOLUTION 0
+/// @brief Sensor variable number; acquisition time is stored in
+/// sensorValues[1].
+#define HRXL_ACQUISITION_TIME_VAR_NUM 1
+/// @brief Variable name; "acquisitionTime"
+#define HRXL_ACQUISITION_TIME_VAR_NAME "acquisitionTime"
+/// @brief Variable unit name in
+/// [ODM2 controlled vocabulary](http://vocabulary.odm2.org/units/);
+/// "millisecond"
+#define HRXL_ACQUISITION_TIME_UNIT_NAME "millisecond"
+/// @brief Default variable short code; "sonarAcqTime"
+#define HRXL_ACQUISITION_TIME_DEFAULT_CODE "sonarAcqTime"
+/**@}*/
+
 
 /* clang-format off */
 /**
@@ -225,8 +298,8 @@ class MaxBotixSonar : public Sensor {
      * Verifies that the power is on and updates the #_sensorStatus.  This also
      * sets the #_millisSensorActivated timestamp.
      *
-     * For the MaxSonar, this also reads and dumps any returned "header" lines
-     * from the sensor.
+     * For the MaxSonar, this also dumps any returned "header" lines from the
+     * sensor.
      *
      * @note This does NOT include any wait for sensor readiness.
      *
@@ -234,15 +307,70 @@ class MaxBotixSonar : public Sensor {
      */
     bool wake(void) override;
 
+    /**
+     * @brief Start a new range measurement.
+     *
+     * This dumps any stale ranges waiting in the stream and triggers the
+     * MaxSonar if it has a trigger pin.
+     *
+     * @return **bool** True if the measurement was started.
+     */
+    bool startSingleMeasurement(void) override;
+    /**
+     * @brief Check whether the current measurement is finished.
+     *
+     * This reads any ranges that have arrived.  The measurement is finished
+     * once enough good ranges agree, or after #HRXL_MAX_RANGES good ranges or
+     * #HRXL_ACQUISITION_TIMEOUT_MS.
+     *
+     * @param debug True to output the result to the debugging Serial
+     * @return **bool** True if the measurement is finished.
+     */
+    bool isMeasurementComplete(bool debug = false) override;
+
     /**
      * @copydoc Sensor::addSingleMeasurementResult()
      */
     bool addSingleMeasurementResult(void) override;
 
  private:
+    /**
+     * @brief Read whatever has arrived on the stream, keeping any good
+     * ranges.
+     */
+    void readRanges(void);
+    /**
+     * @brief Check a range against the values the MaxSonar sends when it
+     * can't get a good one.
+     *
+     * @param range The range in millimeters
+     * @return **bool** True if the range is believable.
+     */
+    bool isGoodRange(uint16_t range);
+    /**
+     * @brief Get the median of the latest good ranges.
+     *
+     * @return **int16_t** The median, or -9999 if there were none.
+     */
+    int16_t medianRange(void);
+    void    trigger(void);
+
     int32_t _sonarHeight;
     int8_t  _triggerPin;
     Stream* _stream;
+
+    /// The digits of the range frame being read
+    uint16_t _frameValue;
+    /// The number of digits read in the frame, or -1 outside a frame
+    int8_t _frameDigits;
+    /// The latest good ranges, oldest first once it's full
+    uint16_t _ranges[HRXL_RANGES_TO_AGREE];
+    /// The number of good ranges read in this measurement
+    uint8_t _goodRanges;
+    /// The number of bad ranges read in this measurement
+    uint8_t _badRanges;
+    /// True once the latest good ranges agree
+    bool _rangesAgree;
 };
 
 
@@ -287,5 +415,53 @@ class MaxBotixSonar_Range : public Variable {
      */
     ~MaxBotixSonar_Range() {}
 };
+
+
+/* clang-format off */
+/**
+ * @brief The Variable sub-class used for the
+ * [acquisition time](@ref sensor_maxbotix_acquisition_time) from a
+ * [MaxBotix HRXL-MaxSonar ultrasonic range finder](@ref sensor_maxbotix).
+ *
+ * @ingroup sensor_maxbotix
+ */
+/* clang-format on */
+class MaxBotixSonar_AcquisitionTime : public Variable {
+ public:
+    /**
+     * @brief Construct a new MaxBotixSonar_AcquisitionTime object.
+     *
+     * @param parentSense The parent MaxBotixSonar providing the result
+     * values.
+     * @param uuid A universally unique identifier (UUID or GUID) for the
+     * variable; optional with the default value of an empty string.
+     * @param varCode A short code to help identify the variable in files;
+     * optional with a default value of "sonarAcqTime".
+     */
+    explicit MaxBotixSonar_AcquisitionTime(
+        MaxBotixSonar* parentSense, const char* uuid = "",
+        const char* varCode = HRXL_ACQUISITION_TIME_DEFAULT_CODE)
+        : Variable(parentSense, (const uint8_t)HRXL_ACQUISITION_TIME_VAR_NUM,
+                   (uint8_t)HRXL_ACQUISITION_TIME_RESOLUTION,
+                   HRXL_ACQUISITION_TIME_VAR_NAME,
+                   HRXL_ACQUISITION_TIME_UNIT_NAME, varCode, uuid) {}
+    /**
+     * @brief Construct a new MaxBotixSonar_AcquisitionTime object.
+     *
+     * @note This must be tied with a parent MaxBotixSonar before it can be
+     * used.
+     */
+    MaxBotixSonar_AcquisitionTime()
+        : Variable((const uint8_t)HRXL_ACQUISITION_TIME_VAR_NUM,
+                   (uint8_t)HRXL_ACQUISITION_TIME_RESOLUTION,
+                   HRXL_ACQUISITION_TIME_VAR_NAME,
+                   HRXL_ACQUISITION_TIME_UNIT_NAME,
+                   HRXL_ACQUISITION_TIME_DEFAULT_CODE) {}
+    /**
+     * @brief Destroy the MaxBotixSonar_AcquisitionTime object - no action
+     * needed.
+     */
+    ~MaxBotixSonar_AcquisitionTime() {}
+};
 /**@}*/
 #endif  // SRC_SENSORS_MAXBOTIXSONAR_H_
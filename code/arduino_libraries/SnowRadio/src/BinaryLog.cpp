@@ -0,0 +1,383 @@
+/**
+ * @file BinaryLog.cpp
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Implements the BinaryLog class.
+ */
+
+#include "BinaryLog.h"
+
+#include <string.h>
+
+// Marks the start of the file and of each block
+static const uint8_t fileMagic[4]  = {'S', 'N', 'B', 'L'};
+static const uint8_t blockMagic[2] = {'B', 'K'};
+// Where the fields are in a block
+#define BLOCK_NUMBER 2
+#define BLOCK_FIRST 6
+#define BLOCK_LAST 10
+#define BLOCK_RECORDS 14
+#define BLOCK_CRC (BINARY_LOG_BLOCK_SIZE - 2)
+// What readHeader() found
+#define HEADER_MISSING -1
+#define HEADER_BAD 0
+#define HEADER_GOOD 1
+
+
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putUint32(uint8_t* out, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) out[i] = (value >> (8 * i)) & 0xFF;
+}
+
+static uint16_t getUint16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0]) | (static_cast<uint16_t>(in[1]) << 8);
+}
+
+static uint32_t getUint32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+static uint16_t crcOf(uint16_t crc, const uint8_t* data, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) crc = crc16Add(crc, data[i]);
+    return crc;
+}
+
+// The number of blocks a header with this much schema text takes
+static uint16_t headerBlocksFor(uint16_t schemaLength) {
+    uint32_t bytes = BINARY_LOG_HEADER_SIZE +
+        static_cast<uint32_t>(schemaLength) + 2;
+    return (bytes + BINARY_LOG_BLOCK_SIZE - 1) / BINARY_LOG_BLOCK_SIZE;
+}
+
+
+BinaryLog::BinaryLog(RecordStore& store)
+    : _store(store),
+      _schemaId(0),
+      _varCount(0),
+      _timeZone(0),
+      _recordSize(0),
+      _schemaLength(0),
+      _headerBlocks(1),
+      _block(0),
+      _position(BINARY_LOG_BLOCK_HEADER_SIZE),
+      _valuesLeft(0),
+      _recordStarted(false) {}
+
+
+bool BinaryLog::begin(uint16_t schemaId, const char* schemaText,
+                      uint16_t schemaLength, uint8_t varCount,
+                      int8_t timeZone) {
+    uint16_t recordSize = BINARY_LOG_TIMESTAMP_SIZE +
+        static_cast<uint16_t>(varCount) * BINARY_LOG_VALUE_SIZE;
+    _recordSize    = 0;  // Not ready to write until everything checks out
+    _valuesLeft    = 0;
+    _recordStarted = false;
+    if (recordSize > BINARY_LOG_BLOCK_ROOM) return false;
+    if (headerBlocksFor(schemaLength) > 255) return false;
+
+    int8_t header = readHeader();
+    if (header == HEADER_GOOD) {
+        // Only add to a file that was written with the same schema
+        if (_schemaId != schemaId || _varCount != varCount ||
+            _recordSize != recordSize || _schemaLength != schemaLength) {
+            _recordSize = 0;
+            return false;
+        }
+        // Carry on in the last block written, unless it is full or torn
+        uint32_t blocks = blockCount();
+        if (blocks > 0 && readBlock(blocks - 1, _data) &&
+            BINARY_LOG_BLOCK_HEADER_SIZE +
+                    (blockRecords(_data) + 1) * _recordSize <=
+                BLOCK_CRC) {
+            _block    = blocks - 1;
+            _position = BINARY_LOG_BLOCK_HEADER_SIZE +
+                blockRecords(_data) * _recordSize;
+        } else {
+            startBlock(blocks);
+        }
+        return true;
+    }
+    // Never write over a file that isn't a binary log this can read
+    if (header == HEADER_BAD) return false;
+
+    _schemaId     = schemaId;
+    _varCount     = varCount;
+    _timeZone     = timeZone;
+    _schemaLength = schemaLength;
+    _headerBlocks = static_cast<uint8_t>(headerBlocksFor(schemaLength));
+    if (!writeHeader(schemaText, schemaLength)) return false;
+    _recordSize = recordSize;
+    startBlock(0);
+    return true;
+}
+
+
+bool BinaryLog::beginRecord(uint32_t timestamp) {
+    if (_recordSize == 0) return false;
+    // Start the next block if this one has no room left
+    if (_position + _recordSize > BLOCK_CRC) {
+        startBlock(_block + 1);
+    }
+    putUint32(_data + _position, timestamp);
+    _position += BINARY_LOG_TIMESTAMP_SIZE;
+    _valuesLeft    = _varCount;
+    _recordStarted = true;
+    return true;
+}
+
+
+void BinaryLog::addValue(float value) {
+    if (!_recordStarted || _valuesLeft == 0) return;
+    _position += recordPutValue(_data + _position, value,
+                                recordFormat(RECORD_FLOAT32, 0));
+    _valuesLeft--;
+}
+
+
+bool BinaryLog::endRecord(void) {
+    if (!_recordStarted) return false;
+    _recordStarted = false;
+    uint16_t start = _position - _recordSize +
+        static_cast<uint16_t>(_valuesLeft) * BINARY_LOG_VALUE_SIZE;
+    if (_valuesLeft != 0) {
+        // Leave out a record that is missing values
+        memset(_data + start, 0, _position - start);
+        _position   = start;
+        _valuesLeft = 0;
+        return false;
+    }
+
+    uint16_t records   = blockRecords(_data);
+    uint32_t timestamp = getUint32(_data + start);
+    if (records == 0) putUint32(_data + BLOCK_FIRST, timestamp);
+    putUint32(_data + BLOCK_LAST, timestamp);
+    putUint16(_data + BLOCK_RECORDS, records + 1);
+    putUint16(_data + BLOCK_CRC, crcOf(0xFFFF, _data, BLOCK_CRC));
+    // If this fails the record is still in the block, and goes out with the
+    // next one
+    return _store.write(blockPosition(_block), _data, BINARY_LOG_BLOCK_SIZE);
+}
+
+
+bool BinaryLog::open(void) {
+    _recordSize    = 0;
+    _valuesLeft    = 0;
+    _recordStarted = false;
+    if (readHeader() != HEADER_GOOD) {
+        _recordSize = 0;
+        return false;
+    }
+    return true;
+}
+
+
+uint16_t BinaryLog::readSchema(char* text, uint16_t textSize) {
+    if (_schemaLength == 0 || _schemaLength + 1 > textSize) return 0;
+    if (!_store.read(BINARY_LOG_HEADER_SIZE, reinterpret_cast<uint8_t*>(text),
+                     _schemaLength)) {
+        return 0;
+    }
+    text[_schemaLength] = '\0';
+    return _schemaLength;
+}
+
+
+uint32_t BinaryLog::blockCount(void) {
+    if (!blockWritten(0)) return 0;
+    // Double the step until it passes the end, then narrow it down: the
+    // blocks from low up have been written, and high hasn't
+    uint32_t low  = 0;
+    uint32_t high = 1;
+    while (blockWritten(high)) {
+        low = high;
+        if (high >= 0x40000000UL) return high + 1;
+        high *= 2;
+    }
+    while (high - low > 1) {
+        uint32_t middle = low + (high - low) / 2;
+        if (blockWritten(middle)) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low + 1;
+}
+
+
+bool BinaryLog::readBlock(uint32_t block, uint8_t* data) {
+    if (!_store.read(blockPosition(block), data, BINARY_LOG_BLOCK_SIZE)) {
+        return false;
+    }
+    if (memcmp(data, blockMagic, sizeof(blockMagic)) != 0) return false;
+    if (getUint32(data + BLOCK_NUMBER) != block) return false;
+    if (crcOf(0xFFFF, data, BLOCK_CRC) != getUint16(data + BLOCK_CRC)) {
+        return false;
+    }
+    // Don't hand back more records than the block can hold
+    return _recordSize == 0 ||
+        BINARY_LOG_BLOCK_HEADER_SIZE +
+            static_cast<uint32_t>(blockRecords(data)) * _recordSize <=
+        BLOCK_CRC;
+}
+
+
+uint32_t BinaryLog::findBlock(uint32_t timestamp, uint32_t blocks) {
+    // Find the first block whose last record isn't from before the time.  A
+    // block that can't be read is taken to be from before it, so a torn
+    // block can only make the search start early.
+    uint32_t low  = 0;
+    uint32_t high = blocks;
+    uint8_t  head[BINARY_LOG_BLOCK_HEADER_SIZE];
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        bool     before = true;
+        if (_store.read(blockPosition(middle), head, sizeof(head)) &&
+            getUint32(head + BLOCK_NUMBER) == middle &&
+            blockRecords(head) > 0) {
+            before = blockLast(head) < timestamp;
+        }
+        if (before) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+uint16_t BinaryLog::blockRecords(const uint8_t* data) {
+    return getUint16(data + BLOCK_RECORDS);
+}
+
+
+uint32_t BinaryLog::blockFirst(const uint8_t* data) {
+    return getUint32(data + BLOCK_FIRST);
+}
+
+
+uint32_t BinaryLog::blockLast(const uint8_t* data) {
+    return getUint32(data + BLOCK_LAST);
+}
+
+
+uint32_t BinaryLog::recordTimestamp(const uint8_t* record) {
+    return getUint32(record);
+}
+
+
+int8_t BinaryLog::readHeader(void) {
+    uint8_t* head = _data;
+    if (!_store.read(0, head, BINARY_LOG_HEADER_SIZE)) return HEADER_MISSING;
+    if (memcmp(head, fileMagic, sizeof(fileMagic)) != 0) return HEADER_BAD;
+    if (head[4] != BINARY_LOG_VERSION) return HEADER_BAD;
+
+    uint8_t  headerBlocks = head[5];
+    uint16_t schemaId     = getUint16(head + 6);
+    int8_t   timeZone     = static_cast<int8_t>(head[8]);
+    uint8_t  varCount     = head[9];
+    uint16_t recordSize   = getUint16(head + 10);
+    uint16_t schemaLength = getUint16(head + 12);
+    if (headerBlocks != headerBlocksFor(schemaLength)) return HEADER_BAD;
+    if (recordSize != BINARY_LOG_TIMESTAMP_SIZE +
+            static_cast<uint16_t>(varCount) * BINARY_LOG_VALUE_SIZE) {
+        return HEADER_BAD;
+    }
+
+    // Check the CRC, reading the schema text a block at a time
+    uint16_t crc      = crcOf(0xFFFF, head, BINARY_LOG_HEADER_SIZE);
+    uint32_t position = BINARY_LOG_HEADER_SIZE;
+    uint16_t left     = schemaLength;
+    while (left > 0) {
+        uint16_t chunk = left < BINARY_LOG_BLOCK_SIZE ? left
+                                                      : BINARY_LOG_BLOCK_SIZE;
+        if (!_store.read(position, _data, chunk)) return HEADER_BAD;
+        crc = crcOf(crc, _data, chunk);
+        position += chunk;
+        left -= chunk;
+    }
+    uint8_t stored[2];
+    if (!_store.read(position, stored, 2) || getUint16(stored) != crc) {
+        return HEADER_BAD;
+    }
+
+    _schemaId     = schemaId;
+    _varCount     = varCount;
+    _timeZone     = timeZone;
+    _recordSize   = recordSize;
+    _schemaLength = schemaLength;
+    _headerBlocks = headerBlocks;
+    return HEADER_GOOD;
+}
+
+
+bool BinaryLog::writeHeader(const char* schemaText, uint16_t schemaLength) {
+    uint8_t fields[BINARY_LOG_HEADER_SIZE];
+    memcpy(fields, fileMagic, sizeof(fileMagic));
+    fields[4] = BINARY_LOG_VERSION;
+    fields[5] = _headerBlocks;
+    putUint16(fields + 6, _schemaId);
+    fields[8] = static_cast<uint8_t>(_timeZone);
+    fields[9] = _varCount;
+    putUint16(fields + 10, BINARY_LOG_TIMESTAMP_SIZE +
+                  static_cast<uint16_t>(_varCount) * BINARY_LOG_VALUE_SIZE);
+    putUint16(fields + 12, schemaLength);
+
+    const uint8_t* text = reinterpret_cast<const uint8_t*>(schemaText);
+    uint16_t       crc  = crcOf(0xFFFF, fields, BINARY_LOG_HEADER_SIZE);
+    crc                 = crcOf(crc, text, schemaLength);
+
+    // Lay the header out a block at a time, filling out the last block with
+    // zeros so the first data block starts on a block boundary
+    uint32_t textEnd = BINARY_LOG_HEADER_SIZE +
+        static_cast<uint32_t>(schemaLength);
+    for (uint8_t block = 0; block < _headerBlocks; block++) {
+        uint32_t start = static_cast<uint32_t>(block) * BINARY_LOG_BLOCK_SIZE;
+        for (uint16_t i = 0; i < BINARY_LOG_BLOCK_SIZE; i++) {
+            uint32_t at    = start + i;
+            uint8_t  value = 0;
+            if (at < BINARY_LOG_HEADER_SIZE) {
+                value = fields[at];
+            } else if (at < textEnd) {
+                value = text[at - BINARY_LOG_HEADER_SIZE];
+            } else if (at == textEnd) {
+                value = crc & 0xFF;
+            } else if (at == textEnd + 1) {
+                value = crc >> 8;
+            }
+            _data[i] = value;
+        }
+        if (!_store.write(start, _data, BINARY_LOG_BLOCK_SIZE)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Checks the start of a block, without reading the whole thing
+bool BinaryLog::blockWritten(uint32_t block) {
+    uint8_t head[BLOCK_FIRST];
+    return _store.read(blockPosition(block), head, sizeof(head)) &&
+        memcmp(head, blockMagic, sizeof(blockMagic)) == 0 &&
+        getUint32(head + BLOCK_NUMBER) == block;
+}
+
+
+void BinaryLog::startBlock(uint32_t block) {
+    memset(_data, 0, BINARY_LOG_BLOCK_SIZE);
+    memcpy(_data, blockMagic, sizeof(blockMagic));
+    putUint32(_data + BLOCK_NUMBER, block);
+    _block    = block;
+    _position = BINARY_LOG_BLOCK_HEADER_SIZE;
+}
@@ -0,0 +1,289 @@
+/**
+ * @file BinaryLog.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the BinaryLog class, which keeps a station's measurements
+ * on its SD card as fixed-width binary records instead of CSV text.
+ *
+ * The file is cut into BINARY_LOG_BLOCK_SIZE byte blocks, lined up with the
+ * card's own sectors.  It starts with a header, taking as many blocks as the
+ * schema needs:
+ *
+ * | Bytes | Contents                                              |
+ * |-------|-------------------------------------------------------|
+ * | 4     | "SNBL"                                                |
+ * | 1     | Format version (BINARY_LOG_VERSION)                   |
+ * | 1     | The number of blocks the header takes                 |
+ * | 2     | Schema ID (little endian)                             |
+ * | 1     | The logger's time zone, in hours from UTC             |
+ * | 1     | Variable count                                        |
+ * | 2     | Bytes in each record (little endian)                  |
+ * | 2     | Bytes of schema text (little endian)                  |
+ * | ...   | The schema text, "schemaID;varCount;code;format;...;" |
+ * | 2     | CRC-16 of everything above                            |
+ *
+ * Each block after the header holds as many whole records as fit:
+ *
+ * | Bytes | Contents                                              |
+ * |-------|-------------------------------------------------------|
+ * | 2     | "BK"                                                  |
+ * | 4     | The block's number, counting from 0 after the header  |
+ * | 4     | Timestamp of the first record in the block            |
+ * | 4     | Timestamp of the last record in the block             |
+ * | 2     | The number of records in the block                    |
+ * | ...   | The records                                           |
+ * | 2     | CRC-16 of the rest of the block, in its last 2 bytes  |
+ *
+ * A record is the marked local epoch time (4 bytes, little endian) followed
+ * by one float32 per variable, packed with recordPutValue() the same way the
+ * compact radio record packs them.  Every value is a float32, so every
+ * record is the same size and nothing has to be scaled to fit.
+ *
+ * Because the blocks are all the same size and their timestamps only go up,
+ * the block headers are an index of the file: the block holding a given time
+ * can be found with a binary search, reading only a handful of blocks.
+ */
+
+// Header Guards
+#ifndef SRC_BINARYLOG_H_
+#define SRC_BINARYLOG_H_
+
+// Included Dependencies
+#include <stddef.h>
+#include <stdint.h>
+#include "MeasurementRecord.h"
+#include "RecordQueue.h"
+
+
+/// The number of bytes in each block of the file; one SD card sector
+#define BINARY_LOG_BLOCK_SIZE 512
+/// The version of the file format written by this library
+#define BINARY_LOG_VERSION 1
+/// The number of bytes in the file header before the schema text
+#define BINARY_LOG_HEADER_SIZE 14
+/// The number of bytes at the start of each block before the first record
+#define BINARY_LOG_BLOCK_HEADER_SIZE 16
+/// The number of bytes each block can hold records in
+#define BINARY_LOG_BLOCK_ROOM \
+    (BINARY_LOG_BLOCK_SIZE - BINARY_LOG_BLOCK_HEADER_SIZE - 2)
+/// The number of bytes in a record before the first value
+#define BINARY_LOG_TIMESTAMP_SIZE 4
+/// The number of bytes each value takes in a record
+#define BINARY_LOG_VALUE_SIZE 4
+
+
+/**
+ * @brief Pick the format a binary log keeps a variable's values in
+ *
+ * @param decimals The number of decimal places the variable is reported with
+ * (Variable::getResolution())
+ * @return **uint8_t** The format byte; always a float32 with the decimals
+ */
+inline uint8_t binaryLogFormat(uint8_t decimals) {
+    return recordFormat(RECORD_FLOAT32, decimals);
+}
+
+
+/**
+ * @brief Writes measurements to a binary log file, or reads them back.
+ *
+ * On the station, begin() opens the file and each logging interval's values
+ * are added with beginRecord(), addValue() and endRecord().  The block being
+ * filled is kept in RAM and written out whole at each endRecord(), so each
+ * interval costs one sector write instead of a line of text and the
+ * directory updates that come with it.  A block is only ever written to its
+ * own place in the file, so a power cut partway through a write can cost at
+ * most the records in that one block.
+ *
+ * Anywhere else (like the binlog_to_csv utility), open() reads the header
+ * back and readBlock() and findBlock() read the records.
+ */
+class BinaryLog {
+ public:
+    /**
+     * @brief Construct a new binary log
+     *
+     * @param store Where the log's file is kept
+     */
+    explicit BinaryLog(RecordStore& store);
+
+    /**
+     * @brief Start writing to the log
+     *
+     * A file with no header yet gets one.  A file that already has one is
+     * added to, starting from the last block that was written, as long as it
+     * was written with the same schema.
+     *
+     * @param schemaId The ID of the schema the values follow
+     * @param schemaText The schema as text, "schemaID;varCount;code;format;
+     * ...;", with each format from binaryLogFormat()
+     * @param schemaLength The number of characters in the schema text
+     * @param varCount The number of values in each record
+     * @param timeZone The logger's time zone, in hours from UTC
+     * @return **bool** True if the log is ready to be written to; false if
+     * the file couldn't be written or holds a different schema
+     */
+    bool begin(uint16_t schemaId, const char* schemaText,
+               uint16_t schemaLength, uint8_t varCount, int8_t timeZone);
+
+    /**
+     * @brief Start a new record, starting a new block first if the current
+     * one is full
+     *
+     * @param timestamp The marked local epoch time of the measurements
+     * @return **bool** True if the record was started
+     */
+    bool beginRecord(uint32_t timestamp);
+    /**
+     * @brief Add the next value to the record
+     *
+     * @param value The value; -9999 is kept as missing
+     */
+    void addValue(float value);
+    /**
+     * @brief Finish the record and write its block out
+     *
+     * @return **bool** True if the record had every value and is saved
+     */
+    bool endRecord(void);
+
+    /**
+     * @brief Read and check the header of an existing log
+     *
+     * @return **bool** True if the file has a good header
+     */
+    bool open(void);
+    /**
+     * @brief Read the schema text back out of the header
+     *
+     * @param text Where to put the text, with a terminator
+     * @param textSize The room in text
+     * @return **uint16_t** The number of characters in the text, or 0 if it
+     * couldn't be read (or didn't fit)
+     */
+    uint16_t readSchema(char* text, uint16_t textSize);
+    /**
+     * @brief Count the blocks that have been written after the header
+     *
+     * The last block written is found with a search, so this only reads a few
+     * dozen blocks even in a large file.
+     *
+     * @return **uint32_t** The number of blocks
+     */
+    uint32_t blockCount(void);
+    /**
+     * @brief Read a block and check it
+     *
+     * @param block The block's number, counting from 0 after the header
+     * @param data Where to put the block; needs BINARY_LOG_BLOCK_SIZE bytes
+     * @return **bool** True if the block was read and its CRC is good
+     */
+    bool readBlock(uint32_t block, uint8_t* data);
+    /**
+     * @brief Find the first block that might hold records from a given time
+     * or later
+     *
+     * @param timestamp The time to look for
+     * @param blocks The number of blocks in the file, from blockCount()
+     * @return **uint32_t** The block's number; blocks if every record is from
+     * before the time
+     */
+    uint32_t findBlock(uint32_t timestamp, uint32_t blocks);
+
+    /**
+     * @brief Get the ID of the schema the values follow
+     */
+    uint16_t schemaId(void) const {
+        return _schemaId;
+    }
+    /**
+     * @brief Get the number of values in each record
+     */
+    uint8_t varCount(void) const {
+        return _varCount;
+    }
+    /**
+     * @brief Get the logger's time zone, in hours from UTC
+     */
+    int8_t timeZone(void) const {
+        return _timeZone;
+    }
+    /**
+     * @brief Get the number of bytes in each record
+     */
+    uint16_t recordSize(void) const {
+        return _recordSize;
+    }
+
+    /**
+     * @brief Get the number of records in a block read with readBlock()
+     */
+    static uint16_t blockRecords(const uint8_t* data);
+    /**
+     * @brief Get the timestamp of the first record in a block
+     */
+    static uint32_t blockFirst(const uint8_t* data);
+    /**
+     * @brief Get the timestamp of the last record in a block
+     */
+    static uint32_t blockLast(const uint8_t* data);
+    /**
+     * @brief Get the timestamp of a record
+     */
+    static uint32_t recordTimestamp(const uint8_t* record);
+    /**
+     * @brief Get a record out of a block read with readBlock()
+     *
+     * The values can be read with a RecordReader started at
+     * BINARY_LOG_TIMESTAMP_SIZE, each with its format from the schema.
+     *
+     * @param data The block
+     * @param i The record's place in the block
+     * @return **const uint8_t\*** The record
+     */
+    const uint8_t* blockRecord(const uint8_t* data, uint16_t i) const {
+        return data + BINARY_LOG_BLOCK_HEADER_SIZE +
+            static_cast<uint32_t>(i) * _recordSize;
+    }
+
+ private:
+    uint32_t blockPosition(uint32_t block) const {
+        return static_cast<uint32_t>(_headerBlocks + block) *
+            BINARY_LOG_BLOCK_SIZE;
+    }
+    int8_t   readHeader(void);
+    bool     writeHeader(const char* schemaText, uint16_t schemaLength);
+    bool     blockWritten(uint32_t block);
+    void     startBlock(uint32_t block);
+
+    RecordStore& _store;
+    uint16_t     _schemaId;
+    uint8_t      _varCount;
+    int8_t       _timeZone;
+    uint16_t     _recordSize;
+    uint16_t     _schemaLength;
+    uint8_t      _headerBlocks;
+    /**
+     * @brief The number of the block being filled
+     */
+    uint32_t _block;
+    /**
+     * @brief Where the next byte of the record being built goes in the block
+     */
+    uint16_t _position;
+    /**
+     * @brief The values still to come in the record being built
+     */
+    uint8_t _valuesLeft;
+    /**
+     * @brief Whether beginRecord() has started a record that hasn't ended
+     */
+    bool _recordStarted;
+    /**
+     * @brief The block being filled
+     */
+    uint8_t _data[BINARY_LOG_BLOCK_SIZE];
+};
+
+#endif  // SRC_BINARYLOG_H_
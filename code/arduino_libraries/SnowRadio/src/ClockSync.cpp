@@ -0,0 +1,151 @@
+/**
+ * @file ClockSync.cpp
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Implements the clock time functions and the ClockSync class.
+ */
+
+#include "ClockSync.h"
+
+/**
+ * @brief How much one step of a DS3231's aging offset slows it down, in parts
+ * per million.  It is about this at 25 C and a little more in the cold, which
+ * the next trim takes care of.
+ */
+#define CLOCK_PPM_PER_TRIM 0.1f
+
+
+uint8_t clockPutTime(uint8_t* out, uint16_t baseMs, uint16_t roundTripMs) {
+    // Little endian, like the slot schedule
+    out[0] = baseMs & 0xFF;
+    out[1] = baseMs >> 8;
+    out[2] = roundTripMs & 0xFF;
+    out[3] = roundTripMs >> 8;
+    return CLOCK_SYNC_SIZE;
+}
+
+
+bool clockGetTime(const uint8_t* in, uint8_t length, uint16_t* baseMs,
+                  uint16_t* roundTripMs) {
+    if (length < CLOCK_SYNC_SIZE) return false;
+    *baseMs      = in[0] | (static_cast<uint16_t>(in[1]) << 8);
+    *roundTripMs = in[2] | (static_cast<uint16_t>(in[3]) << 8);
+    return *baseMs < 1000;
+}
+
+
+ClockSync::ClockSync(uint32_t cycleS, uint16_t stepMs, uint16_t maxStepS,
+                     uint32_t trimAfterS, uint8_t maxTrim)
+    : _cycleMs(static_cast<int32_t>(cycleS > 0 ? cycleS : 1) * 1000L),
+      _stepMs(stepMs),
+      _maxStepS(maxStepS),
+      _trimAfterS(trimAfterS),
+      _maxTrim(maxTrim > 127 ? 127 : maxTrim) {
+    begin();
+}
+
+
+void ClockSync::begin(int8_t trim) {
+    _trim        = trim;
+    _offsetMs    = 0;
+    _pending     = false;
+    _pendingMs   = 0;
+    _hasAnchor   = false;
+    _anchorLocal = 0;
+    _anchorMs    = 0;
+    _driftPpm    = 0;
+    _steps       = 0;
+}
+
+
+uint8_t ClockSync::measured(uint32_t baseS, uint16_t baseMs,
+                            uint16_t roundTripMs, uint32_t localS,
+                            uint16_t localMs) {
+    // The 'R' took about half the round trip to get here
+    _offsetMs = wrapOffset(baseS, baseMs, localS, localMs) + roundTripMs / 2;
+    uint8_t action = clockKeep;
+
+    int32_t size = _offsetMs < 0 ? -_offsetMs : _offsetMs;
+    if (size > static_cast<int32_t>(_maxStepS) * 1000L) {
+        // Too big to trust from one measurement, so wait for the next to agree
+        int32_t change = _offsetMs - _pendingMs;
+        if (change < 0) change = -change;
+        if (_pending && change <= 1000) {
+            _pending = false;
+            return clockStep;
+        }
+        _pending   = true;
+        _pendingMs = _offsetMs;
+        return clockKeep;
+    }
+    _pending = false;
+    if (size >= _stepMs) action |= clockStep;
+
+    if (!_hasAnchor) {
+        _hasAnchor   = true;
+        _anchorLocal = localS;
+        _anchorMs    = _offsetMs;
+        _driftPpm    = 0;
+    } else {
+        int32_t baseline = static_cast<int32_t>(localS - _anchorLocal);
+        if (baseline > 0) {
+            // Milliseconds per second are thousandths, so ppm is 1000 times
+            _driftPpm = (_offsetMs - _anchorMs) * 1000.0f / baseline;
+            if (static_cast<uint32_t>(baseline) >= _trimAfterS) {
+                action |= trimRate(localS);
+            }
+        }
+    }
+    return action;
+}
+
+
+void ClockSync::stepped(void) {
+    if (_steps < 65535) _steps++;
+    if (_offsetMs > 1000 || _offsetMs < -1000) {
+        // A step this big means a clock was set, not that it drifted, so the
+        // drift is measured over again from here
+        _hasAnchor = false;
+        _driftPpm  = 0;
+    } else {
+        // Carry on measuring the drift across the step
+        _anchorMs -= _offsetMs;
+    }
+}
+
+
+// Sets the aging offset to take out the drift measured since the last time,
+// returning clockTrim if it changed
+uint8_t ClockSync::trimRate(uint32_t localS) {
+    // A positive aging offset slows the clock down, and a negative drift
+    // means ours is running fast.  The offset left over is slewed out over
+    // the next trimAfterS seconds as well, rather than left until it needs a
+    // step.
+    float slewPpm = _offsetMs * 1000.0f / _trimAfterS;
+    float change  = -(_driftPpm + slewPpm) / CLOCK_PPM_PER_TRIM;
+    int16_t trim  = _trim + static_cast<int16_t>(change < 0 ? change - 0.5f
+                                                            : change + 0.5f);
+    if (trim > _maxTrim) trim = _maxTrim;
+    if (trim < -_maxTrim) trim = -_maxTrim;
+    if (trim == _trim) return clockKeep;
+    _trim = static_cast<int8_t>(trim);
+    // The rate is different from here on
+    _anchorLocal = localS;
+    _anchorMs    = _offsetMs;
+    _driftPpm    = 0;
+    return clockTrim;
+}
+
+
+// The offset is only used to within half a cycle either way, like the slot
+// timer's
+int32_t ClockSync::wrapOffset(uint32_t baseS, uint16_t baseMs, uint32_t localS,
+                              uint16_t localMs) const {
+    int32_t cycleS  = _cycleMs / 1000;
+    int32_t seconds = static_cast<int32_t>(baseS - localS) % cycleS;
+    int32_t offset  = seconds * 1000L + baseMs - localMs;
+    if (offset > _cycleMs / 2) offset -= _cycleMs;
+    if (offset < -(_cycleMs / 2)) offset += _cycleMs;
+    return offset;
+}
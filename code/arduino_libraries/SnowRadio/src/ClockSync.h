@@ -0,0 +1,201 @@
+/**
+ * @file ClockSync.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the ClockSync class, which keeps a satellite station's
+ * clock set to the base station's over the radio.
+ *
+ * The base station sends the time on its clock to the millisecond with each
+ * 'R', after the slot schedule (see SlotSchedule.h):
+ *
+ * | Bytes | Contents                                                        |
+ * |-------|-----------------------------------------------------------------|
+ * | 2     | Milliseconds past the epoch time in the schedule (little end.)  |
+ * | 2     | The last round trip to this station in milliseconds; 0 if not known |
+ *
+ * The satellite answers the 'R' with how many milliseconds it held on to it
+ * before replying, so the base station can take that out of the time between
+ * sending the 'R' and hearing back, leaving the round trip over the air.
+ *
+ * Like the rest of the library, nothing here reads or sets a clock.  The times
+ * are passed in, and the sketch sets the clock when it is told to, so a
+ * season of drifting clocks can be simulated on a desktop (see the clock_sim
+ * utility).
+ */
+
+// Header Guards
+#ifndef SRC_CLOCKSYNC_H_
+#define SRC_CLOCKSYNC_H_
+
+// Included Dependencies
+#include <stdint.h>
+
+
+/// The number of bytes of time that follow the slot schedule in an 'R'
+#define CLOCK_SYNC_SIZE 4
+
+
+/**
+ * @brief Write the milliseconds of the base station's time and the last round
+ * trip to a station
+ *
+ * @param out Where to write it; needs CLOCK_SYNC_SIZE bytes
+ * @param baseMs Milliseconds past the epoch time in the schedule
+ * @param roundTripMs The last round trip to the station; 0 if not known
+ * @return **uint8_t** The number of bytes written
+ */
+uint8_t clockPutTime(uint8_t* out, uint16_t baseMs, uint16_t roundTripMs);
+
+/**
+ * @brief Read the milliseconds of the base station's time and the last round
+ * trip
+ *
+ * @param in The bytes after the slot schedule
+ * @param length The number of bytes after the slot schedule
+ * @param baseMs Milliseconds past the epoch time in the schedule
+ * @param roundTripMs The last round trip to this station; 0 if not known
+ * @return **bool** True if they were there; base station sketches from before
+ * the clocks were synced don't send them
+ */
+bool clockGetTime(const uint8_t* in, uint8_t length, uint16_t* baseMs,
+                  uint16_t* roundTripMs);
+
+
+/**
+ * @brief Keeps a satellite station's clock set to the base station's.
+ *
+ * Each time the base station is heard, measured() works out how far the
+ * satellite's clock is from it: the base station's time when it sent the 'R',
+ * plus half the round trip, less the satellite's time when it came in.  Only
+ * the part of the offset within half a cycle either way is used, so the
+ * clocks can be kept in different time zones.
+ *
+ * Once the clock is stepMs or more off, measured() says to step it.  A step of
+ * more than maxStepS seconds is only made once the same offset has been
+ * measured twice in a row, so one bad time from the base station can't throw
+ * the clock out.  Smaller offsets are left alone and used to measure the drift
+ * between the clocks.  Once it has been measured across trimAfterS seconds,
+ * the clock's rate is trimmed (with a DS3231's aging offset, up to maxTrim
+ * steps either way) to take out the drift and to slew out what's left of the
+ * offset over the next trimAfterS seconds, so the clock needs stepping less
+ * and less often.
+ */
+class ClockSync {
+ public:
+    /**
+     * @brief What measured() says to do with the clock
+     */
+    enum clockAction : uint8_t {
+        clockKeep = 0,  ///< Leave it
+        clockStep = 1,  ///< Step it by stepMs()
+        clockTrim = 2   ///< Set the aging offset to trim()
+    };
+
+    /**
+     * @brief Construct a new clock sync
+     *
+     * @param cycleS The length of a cycle (the logging interval) in seconds
+     * @param stepMs The least offset the clock is stepped for, in milliseconds
+     * @param maxStepS The biggest step made on one measurement, in seconds
+     * @param trimAfterS The least time the drift is measured across before
+     * the rate is trimmed, in seconds
+     * @param maxTrim The most the aging offset is set to either way
+     */
+    ClockSync(uint32_t cycleS, uint16_t stepMs = 250, uint16_t maxStepS = 60,
+              uint32_t trimAfterS = 86400, uint8_t maxTrim = 50);
+
+    /**
+     * @brief Start over, with the aging offset the clock already has
+     *
+     * @param trim The clock's aging offset
+     */
+    void begin(int8_t trim = 0);
+
+    /**
+     * @brief Compare the clocks when the base station is heard
+     *
+     * @param baseS The base station's epoch time when it sent the 'R'
+     * @param baseMs Milliseconds past baseS
+     * @param roundTripMs The last round trip to this station; 0 if not known
+     * @param localS The satellite's epoch time when the 'R' came in
+     * @param localMs Milliseconds past localS
+     * @return **uint8_t** What to do, the clockAction values or'd together
+     */
+    uint8_t measured(uint32_t baseS, uint16_t baseMs, uint16_t roundTripMs,
+                     uint32_t localS, uint16_t localMs);
+    /**
+     * @brief Record that the clock was stepped by stepMs()
+     */
+    void stepped(void);
+
+    /**
+     * @brief Get the last offset measured
+     *
+     * @return **int32_t** How far the base station's clock was ahead of the
+     * satellite's, in milliseconds
+     */
+    int32_t offsetMs(void) const {
+        return _offsetMs;
+    }
+    /**
+     * @brief Get the step to make when measured() says to
+     *
+     * @return **int32_t** The milliseconds to move the clock forward by
+     */
+    int32_t stepMs(void) const {
+        return _offsetMs;
+    }
+    /**
+     * @brief Get the aging offset to set when measured() says to
+     */
+    int8_t trim(void) const {
+        return _trim;
+    }
+    /**
+     * @brief Get the drift between the clocks
+     *
+     * @return **float** How fast the base station's clock gains on the
+     * satellite's, in parts per million, since the rate was last trimmed; 0
+     * until it has been measured
+     */
+    float driftPpm(void) const {
+        return _driftPpm;
+    }
+    /**
+     * @brief Get the number of times the clock has been stepped
+     */
+    uint16_t steps(void) const {
+        return _steps;
+    }
+
+ private:
+    int32_t wrapOffset(uint32_t baseS, uint16_t baseMs, uint32_t localS,
+                       uint16_t localMs) const;
+    uint8_t trimRate(uint32_t localS);
+
+    int32_t  _cycleMs;
+    uint16_t _stepMs;
+    uint16_t _maxStepS;
+    uint32_t _trimAfterS;
+    uint8_t  _maxTrim;
+
+    int8_t  _trim;
+    int32_t _offsetMs;
+    /**
+     * @brief A big offset waiting to be measured again before stepping
+     */
+    bool    _pending;
+    int32_t _pendingMs;
+    /**
+     * @brief The first comparison since the rate was last trimmed, which the
+     * drift is measured from
+     */
+    bool     _hasAnchor;
+    uint32_t _anchorLocal;
+    int32_t  _anchorMs;
+    float    _driftPpm;
+    uint16_t _steps;
+};
+
+#endif  // SRC_CLOCKSYNC_H_
@@ -0,0 +1,432 @@
+/**
+ * @file MeasurementRecord.cpp
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Implements the compact measurement record functions and the
+ * RecordReader and RecordSchema classes.
+ */
+
+#include "MeasurementRecord.h"
+
+#include <string.h>
+
+// The int16 markers; neither is a value any sensor here reports once scaled
+#define RECORD_INT16_MISSING -32768
+#define RECORD_INT16_AS_FLOAT32 -32767
+// The float markers are NaN bit patterns, which a measurement never is
+#define RECORD_FLOAT16_MISSING 0xFFFF
+#define RECORD_FLOAT32_MISSING 0xFFFFFFFFUL
+
+
+// Powers of ten for scaling, as far as a 32-bit integer goes
+static const int32_t powersOfTen[] = {1,      10,      100,      1000,
+                                      10000,  100000,  1000000,  10000000,
+                                      100000000, 1000000000};
+
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putUint32(uint8_t* out, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) out[i] = (value >> (8 * i)) & 0xFF;
+}
+
+static uint16_t getUint16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0]) | (static_cast<uint16_t>(in[1]) << 8);
+}
+
+static uint32_t getUint32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+static uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Round half away from zero, the way dtostrf() and String(float, n) do it
+static int32_t roundToInt32(float value) {
+    return static_cast<int32_t>(value < 0 ? value - 0.5f : value + 0.5f);
+}
+
+static bool isMissing(float value) {
+    return value != value || value == RECORD_MISSING_VALUE;
+}
+
+// IEEE 754 single to half precision, rounding to nearest
+static uint16_t floatToHalf(float value) {
+    uint32_t bits     = floatBits(value);
+    uint16_t sign     = (bits >> 16) & 0x8000;
+    int16_t  exponent = static_cast<int16_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x007FFFFF;
+
+    if (exponent >= 31) return sign | 0x7C00;  // Too big; infinity
+    if (exponent <= 0) {                       // Subnormal or zero
+        if (exponent < -10) return sign;
+        mantissa |= 0x00800000;
+        uint8_t  shift = static_cast<uint8_t>(14 - exponent);
+        uint16_t half  = static_cast<uint16_t>(mantissa >> shift);
+        if ((mantissa >> (shift - 1)) & 1) half++;
+        return sign | half;
+    }
+    uint16_t half = sign | (static_cast<uint16_t>(exponent) << 10) |
+        static_cast<uint16_t>(mantissa >> 13);
+    if (mantissa & 0x00001000) half++;  // Rounding may carry into the exponent
+    return half;
+}
+
+static float halfToFloat(uint16_t half) {
+    uint32_t sign     = static_cast<uint32_t>(half & 0x8000) << 16;
+    int16_t  exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x03FF;
+
+    if (exponent == 0) {
+        if (mantissa == 0) return bitsFloat(sign);
+        // Subnormal; shift it up until it is normal
+        exponent = 1;
+        while (!(mantissa & 0x0400)) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        mantissa &= 0x03FF;
+        return bitsFloat(sign |
+                         (static_cast<uint32_t>(exponent + 127 - 15) << 23) |
+                         (mantissa << 13));
+    }
+    if (exponent == 31) return bitsFloat(sign | 0x7F800000 | (mantissa << 13));
+    return bitsFloat(sign | (static_cast<uint32_t>(exponent + 127 - 15) << 23) |
+                     (mantissa << 13));
+}
+
+// Write an integer that was scaled by 10^decimals with its decimal point
+static bool writeScaled(int32_t scaled, uint8_t decimals, char* text,
+                        uint8_t textSize) {
+    char    digits[20];
+    uint8_t count     = 0;
+    bool    negative  = scaled < 0;
+    uint32_t magnitude = negative ? 0UL - static_cast<uint32_t>(scaled)
+                                  : static_cast<uint32_t>(scaled);
+    do {
+        digits[count++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0 || count <= decimals);
+
+    uint8_t needed = count + (negative ? 1 : 0) + (decimals > 0 ? 1 : 0) + 1;
+    if (needed > textSize) return false;
+
+    uint8_t used = 0;
+    if (negative) text[used++] = '-';
+    while (count > 0) {
+        if (count == decimals) text[used++] = '.';
+        text[used++] = digits[--count];
+    }
+    text[used] = '\0';
+    return true;
+}
+
+static bool writeMissing(uint8_t decimals, char* text, uint8_t textSize) {
+    if (textSize < 6 + (decimals > 0 ? decimals + 1 : 0)) return false;
+    strcpy(text, "-9999");
+    if (decimals > 0) {
+        text[5] = '.';
+        memset(text + 6, '0', decimals);
+        text[6 + decimals] = '\0';
+    }
+    return true;
+}
+
+// Write a float the way Variable::getValueString() does
+static bool writeFloat(float value, uint8_t decimals, char* text,
+                       uint8_t textSize) {
+    if (isMissing(value)) return writeMissing(decimals, text, textSize);
+    if (decimals == 0) {
+        return writeScaled(static_cast<int16_t>(value), 0, text, textSize);
+    }
+    // Drop decimal places that would overflow; no sensor here gets near this
+    while (decimals > 0 &&
+           (decimals > 9 ||
+            value * powersOfTen[decimals] > 2147483000.0f ||
+            value * powersOfTen[decimals] < -2147483000.0f)) {
+        decimals--;
+    }
+    int32_t scaled = roundToInt32(value * powersOfTen[decimals]);
+    if (scaled == 0 && value < 0 && decimals > 0) {
+        // dtostrf() keeps the sign of a small negative value: -0.00
+        if (textSize < 2) return false;
+        text[0] = '-';
+        return writeScaled(0, decimals, text + 1, textSize - 1);
+    }
+    return writeScaled(scaled, decimals, text, textSize);
+}
+
+
+uint8_t recordFormat(uint8_t decimals) {
+    return recordFormat(decimals <= 4 ? RECORD_INT16 : RECORD_FLOAT32,
+                        decimals);
+}
+
+
+uint8_t recordPutHeader(uint8_t* out, uint16_t schemaId, uint32_t timestamp,
+                        uint8_t varCount) {
+    putUint16(out, schemaId);
+    putUint32(out + 2, timestamp);
+    out[6] = varCount;
+    return RECORD_HEADER_SIZE;
+}
+
+
+uint8_t recordPutValue(uint8_t* out, float value, uint8_t format) {
+    uint8_t decimals = format & 0x0F;
+    switch (format & 0xF0) {
+        case RECORD_INT16: {
+            if (isMissing(value)) {
+                putUint16(out, static_cast<uint16_t>(RECORD_INT16_MISSING));
+                return 2;
+            }
+            float scaled = decimals < 10 ? value * powersOfTen[decimals]
+                                         : 40000.0f;
+            int16_t packed = 0;
+            if (scaled > -32766.0f && scaled < 32767.0f) {
+                packed = decimals == 0
+                    ? static_cast<int16_t>(value)
+                    : static_cast<int16_t>(roundToInt32(scaled));
+            }
+            // A small negative value is sent whole too, since it is written
+            // out as -0.0 and a scaled 0 can't say that
+            if (scaled > -32766.0f && scaled < 32767.0f &&
+                (packed != 0 || value >= 0 || decimals == 0)) {
+                putUint16(out, static_cast<uint16_t>(packed));
+                return 2;
+            }
+            // Too big once scaled, so send it whole
+            putUint16(out, static_cast<uint16_t>(RECORD_INT16_AS_FLOAT32));
+            putUint32(out + 2, floatBits(value));
+            return 6;
+        }
+        case RECORD_FLOAT16:
+            putUint16(out, isMissing(value) ? RECORD_FLOAT16_MISSING
+                                            : floatToHalf(value));
+            return 2;
+        default:
+            putUint32(out, isMissing(value) ? RECORD_FLOAT32_MISSING
+                                            : floatBits(value));
+            return 4;
+    }
+}
+
+
+uint8_t recordPutValue(uint8_t* out, float value, uint8_t format,
+                       const char* text) {
+    uint8_t decimals = format & 0x0F;
+    if ((format & 0xF0) != RECORD_INT16 || decimals == 0 || isMissing(value) ||
+        text == NULL) {
+        return recordPutValue(out, value, format);
+    }
+    // Read the digits as a whole number, checking the decimal places
+    while (*text == ' ') text++;
+    bool negative = *text == '-';
+    if (negative) text++;
+    int32_t scaled = 0;
+    int8_t  places = -1;
+    for (; *text != '\0'; text++) {
+        if (*text == '.' && places < 0) {
+            places = 0;
+        } else if (*text >= '0' && *text <= '9' && scaled < 1000000L) {
+            scaled = scaled * 10 + (*text - '0');
+            if (places >= 0) places++;
+        } else {
+            return recordPutValue(out, value, format);
+        }
+    }
+    if (negative) scaled = -scaled;
+    if (places != decimals || (negative && scaled == 0)) {
+        return recordPutValue(out, value, format);
+    }
+    if (scaled > -32766L && scaled < 32767L) {
+        putUint16(out, static_cast<uint16_t>(static_cast<int16_t>(scaled)));
+        return 2;
+    }
+    // Too big once scaled, so send the float nearest the text.  Dividing a
+    // whole number this small by a power of ten rounds to it, and scaling it
+    // back up in RecordReader comes back to the same digits.
+    float nearest = scaled / static_cast<float>(powersOfTen[decimals]);
+    return recordPutValue(out, nearest, format);
+}
+
+
+uint16_t crc16Add(uint16_t crc, uint8_t value) {
+    crc ^= static_cast<uint16_t>(value) << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+
+void SchemaHash::add(uint8_t value) {
+    _crc = crc16Add(_crc, value);
+}
+
+
+void SchemaHash::add(const char* text) {
+    while (*text != '\0') add(static_cast<uint8_t>(*text++));
+    add(static_cast<uint8_t>(0));
+}
+
+
+RecordReader::RecordReader(const uint8_t* data, uint16_t length,
+                           uint16_t start)
+    : _data(data),
+      _length(length),
+      _position(start) {}
+
+
+uint16_t RecordReader::schemaId(void) const {
+    return isValid() ? getUint16(_data) : 0;
+}
+
+
+uint32_t RecordReader::timestamp(void) const {
+    return isValid() ? getUint32(_data + 2) : 0;
+}
+
+
+uint8_t RecordReader::varCount(void) const {
+    return isValid() ? _data[6] : 0;
+}
+
+
+bool RecordReader::nextValue(uint8_t format, char* text, uint8_t textSize) {
+    uint8_t decimals = format & 0x0F;
+    switch (format & 0xF0) {
+        case RECORD_INT16: {
+            if (_position + 2 > _length) return false;
+            int16_t packed = static_cast<int16_t>(getUint16(_data + _position));
+            _position += 2;
+            if (packed == RECORD_INT16_MISSING) {
+                return writeMissing(decimals, text, textSize);
+            }
+            if (packed == RECORD_INT16_AS_FLOAT32) {
+                if (_position + 4 > _length) return false;
+                float value = bitsFloat(getUint32(_data + _position));
+                _position += 4;
+                return writeFloat(value, decimals, text, textSize);
+            }
+            return writeScaled(packed, decimals, text, textSize);
+        }
+        case RECORD_FLOAT16: {
+            if (_position + 2 > _length) return false;
+            uint16_t packed = getUint16(_data + _position);
+            _position += 2;
+            if (packed == RECORD_FLOAT16_MISSING) {
+                return writeMissing(decimals, text, textSize);
+            }
+            return writeFloat(halfToFloat(packed), decimals, text, textSize);
+        }
+        default: {
+            if (_position + 4 > _length) return false;
+            uint32_t packed = getUint32(_data + _position);
+            _position += 4;
+            if (packed == RECORD_FLOAT32_MISSING) {
+                return writeMissing(decimals, text, textSize);
+            }
+            return writeFloat(bitsFloat(packed), decimals, text, textSize);
+        }
+    }
+}
+
+
+RecordSchema::RecordSchema() : _codes(NULL), _codesSize(0) {
+    clear();
+}
+
+
+void RecordSchema::begin(char* codes, uint16_t codesSize) {
+    _codes     = codes;
+    _codesSize = codesSize;
+    clear();
+}
+
+
+void RecordSchema::clear(void) {
+    _loaded   = false;
+    _id       = 0;
+    _varCount = 0;
+}
+
+
+bool RecordSchema::load(const char* text, uint16_t length) {
+    clear();
+    if (!parse(text, length)) {
+        clear();
+        return false;
+    }
+    _loaded = true;
+    return true;
+}
+
+
+bool RecordSchema::parse(const char* text, uint16_t length) {
+    uint16_t position = 0;
+    uint16_t used     = 0;
+    int16_t  count    = -1;  // The variable count, once it has been read
+    uint8_t  field    = 0;
+
+    while (position < length) {
+        uint16_t start = position;
+        while (position < length && text[position] != ';') position++;
+        if (position == length) return false;  // The last field wasn't ended
+        uint16_t fieldLength = position - start;
+        position++;
+
+        // Fields 0 and 1 are numbers, then a code and a format per variable
+        if (field < 2 || field % 2 == 1) {
+            if (fieldLength == 0) return false;
+            uint32_t number = 0;
+            for (uint16_t c = start; c < start + fieldLength; c++) {
+                if (text[c] < '0' || text[c] > '9') return false;
+                number = number * 10 + (text[c] - '0');
+            }
+            if (field == 0) {
+                _id = static_cast<uint16_t>(number);
+            } else if (field == 1) {
+                if (number > RECORD_SCHEMA_MAX_VARIABLES) return false;
+                count = static_cast<int16_t>(number);
+            } else {
+                _formats[_varCount++] = static_cast<uint8_t>(number);
+            }
+        } else {
+            if (_varCount >= count) return false;
+            if (used + fieldLength + 1 > _codesSize) return false;
+            _codeStart[_varCount] = used;
+            memcpy(_codes + used, text + start, fieldLength);
+            used += fieldLength;
+            _codes[used++] = '\0';
+        }
+        field++;
+    }
+    return count >= 0 && _varCount == count && field % 2 == 0;
+}
+
+
+uint8_t RecordSchema::format(uint8_t i) const {
+    return i < _varCount ? _formats[i] : 0;
+}
+
+
+const char* RecordSchema::code(uint8_t i) const {
+    return i < _varCount ? _codes + _codeStart[i] : "";
+}
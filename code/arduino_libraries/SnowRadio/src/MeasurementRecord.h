@@ -0,0 +1,331 @@
+/**
+ * @file MeasurementRecord.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the functions and classes for the compact binary
+ * measurement record sent over the radio, and the RecordSchema that gives
+ * its values their names back.
+ *
+ * A record is a small header followed by one packed value per variable:
+ *
+ * | Bytes | Contents                                         |
+ * |-------|--------------------------------------------------|
+ * | 2     | Schema ID (little endian)                        |
+ * | 4     | Marked local epoch time in seconds (little end.) |
+ * | 1     | Variable count                                   |
+ * | ...   | One value per variable, packed by its format     |
+ *
+ * The names of the variables are not in the record.  They are sent
+ * separately as a schema, and only when the receiving end doesn't already
+ * have the schema with that ID.  The ID is a SchemaHash of everything in the
+ * schema, so it changes on its own whenever the variables do.
+ */
+
+// Header Guards
+#ifndef SRC_MEASUREMENTRECORD_H_
+#define SRC_MEASUREMENTRECORD_H_
+
+// Included Dependencies
+#include <stddef.h>
+#include <stdint.h>
+
+
+/// The number of bytes in a record before the first value
+#define RECORD_HEADER_SIZE 7
+/// The most bytes one value can take in a record
+#define RECORD_MAX_VALUE_SIZE 6
+/// The value the sensor libraries use for a missing or failed measurement
+#define RECORD_MISSING_VALUE -9999
+/// The most characters a value can take as text, including the terminator
+#define RECORD_VALUE_TEXT_SIZE 16
+
+/**
+ * @brief The most variables a RecordSchema can hold
+ */
+#ifndef RECORD_SCHEMA_MAX_VARIABLES
+#define RECORD_SCHEMA_MAX_VARIABLES 40
+#endif
+
+
+
+/**
+ * @brief How a value is packed in a record.
+ *
+ * A format byte holds the type in its upper four bits and the number of
+ * decimal places the value is reported with in its lower four.
+ */
+typedef enum : uint8_t {
+    /// A 16-bit integer, the value times 10 to the number of decimals
+    RECORD_INT16 = 0x00,
+    /// An IEEE 754 half precision float
+    RECORD_FLOAT16 = 0x10,
+    /// An IEEE 754 single precision float
+    RECORD_FLOAT32 = 0x20,
+} recordValueType;
+
+/**
+ * @brief Pick the format to send a variable's values with
+ *
+ * Values with up to four decimal places are scaled to 16-bit integers.  A
+ * value that doesn't fit once it is scaled is sent as a float32 instead, so
+ * nothing is lost.  Anything with more decimal places is always a float32.
+ *
+ * @param decimals The number of decimal places the variable is reported with
+ * (Variable::getResolution())
+ * @return **uint8_t** The format byte
+ */
+uint8_t recordFormat(uint8_t decimals);
+
+/**
+ * @brief Build a format byte from a type and a number of decimal places
+ */
+inline uint8_t recordFormat(recordValueType type, uint8_t decimals) {
+    return static_cast<uint8_t>(type) | (decimals & 0x0F);
+}
+
+/**
+ * @brief Write the header of a record
+ *
+ * @param out Where to write it; needs RECORD_HEADER_SIZE bytes
+ * @param schemaId The ID of the schema the values follow
+ * @param timestamp The marked local epoch time of the measurements
+ * @param varCount The number of values that will follow
+ * @return **uint8_t** The number of bytes written
+ */
+uint8_t recordPutHeader(uint8_t* out, uint16_t schemaId, uint32_t timestamp,
+                        uint8_t varCount);
+
+/**
+ * @brief Pack one value into a record
+ *
+ * A value of -9999 is written as the type's missing marker rather than as a
+ * number.  Values with no decimal places are cut off (not rounded) the same
+ * way Variable::getValueString() does it, so the text on the other end
+ * matches what would have been sent before.
+ *
+ * @param out Where to write it; needs RECORD_MAX_VALUE_SIZE bytes
+ * @param value The value
+ * @param format The format byte from recordFormat()
+ * @return **uint8_t** The number of bytes written
+ */
+uint8_t recordPutValue(uint8_t* out, float value, uint8_t format);
+/**
+ * @brief Pack one value into a record from the text it was written out as
+ *
+ * Scaling a float in float arithmetic can round the last decimal place the
+ * other way from dtostrf() when the value is within a rounding error of a
+ * half, so the base station would print 299.195 from the record where the
+ * bulk dump and the SD card say 299.194.  Packing from the digits of the
+ * text instead keeps them the same.  Text that doesn't have exactly the
+ * format's decimal places, or more than 7 digits, is packed from the value.
+ *
+ * @param out Where to write it; needs RECORD_MAX_VALUE_SIZE bytes
+ * @param value The value
+ * @param format The format byte from recordFormat()
+ * @param text The value written out with the format's decimal places
+ * @return **uint8_t** The number of bytes written
+ */
+uint8_t recordPutValue(uint8_t* out, float value, uint8_t format,
+                       const char* text);
+
+
+/**
+ * @brief Add a byte to a CRC-16 (CCITT, polynomial 0x1021)
+ *
+ * @param crc The CRC so far; start from 0xFFFF
+ * @param value The byte to add
+ * @return **uint16_t** The CRC with the byte added
+ */
+uint16_t crc16Add(uint16_t crc, uint8_t value);
+
+
+/**
+ * @brief Builds a schema ID out of everything that describes a station's
+ * variables.
+ *
+ * This is a CRC-16 (CCITT, starting from 0xFFFF).  Each piece of text is
+ * added along with its terminator, so "ab" then "c" doesn't hash the same as
+ * "a" then "bc".
+ */
+class SchemaHash {
+ public:
+    /**
+     * @brief Construct a new schema hash
+     */
+    SchemaHash() : _crc(0xFFFF) {}
+
+    /**
+     * @brief Add a piece of text, such as a variable code or unit
+     */
+    void add(const char* text);
+    /**
+     * @brief Add a number, such as a resolution or format byte
+     */
+    void add(uint8_t value);
+    /**
+     * @brief Get the hash of everything added so far
+     */
+    uint16_t value(void) const {
+        return _crc;
+    }
+
+ private:
+    uint16_t _crc;
+};
+
+
+/**
+ * @brief Reads the values back out of a record as text.
+ *
+ * The text is written the same way Variable::getValueString() writes it on
+ * the satellite station, so a base station can rebuild exactly the strings it
+ * used to receive.
+ */
+class RecordReader {
+ public:
+    /**
+     * @brief Construct a new record reader
+     *
+     * @param data The whole record
+     * @param length The number of bytes in the record
+     * @param start Where the first value is.  Optional with a default of
+     * RECORD_HEADER_SIZE; anything else is for values packed the same way
+     * somewhere other than a record, like a BinaryLog, and leaves the header
+     * functions meaningless.
+     */
+    RecordReader(const uint8_t* data, uint16_t length,
+                 uint16_t start = RECORD_HEADER_SIZE);
+
+    /**
+     * @brief Check that the record is at least long enough for its header
+     */
+    bool isValid(void) const {
+        return _length >= RECORD_HEADER_SIZE;
+    }
+    /**
+     * @brief Get the ID of the schema the values follow
+     */
+    uint16_t schemaId(void) const;
+    /**
+     * @brief Get the marked local epoch time of the measurements
+     */
+    uint32_t timestamp(void) const;
+    /**
+     * @brief Get the number of values in the record
+     */
+    uint8_t varCount(void) const;
+
+    /**
+     * @brief Read the next value as text
+     *
+     * @param format The value's format byte from the schema
+     * @param text Where to write the text
+     * @param textSize The room in text; RECORD_VALUE_TEXT_SIZE is always
+     * enough
+     * @return **bool** True if there was a whole value left to read.
+     */
+    bool nextValue(uint8_t format, char* text, uint8_t textSize);
+    /**
+     * @brief Check whether every byte of the record has been read
+     */
+    bool atEnd(void) const {
+        return _position >= _length;
+    }
+
+ private:
+    const uint8_t* _data;
+    uint16_t       _length;
+    uint16_t       _position;
+};
+
+
+/**
+ * @brief Holds the variable codes and value formats for a station's records.
+ *
+ * A schema goes over the radio as text, the same way the text bulk dump does:
+ * "schemaID;varCount;code;format;code;format;...;" with the format byte
+ * written as a decimal number.  It is only sent when the other end asks for
+ * it, so the text size doesn't matter much.
+ *
+ * The codes are kept in a buffer supplied with begin(), sized by the sketch
+ * for the station with the most (or longest) codes; UUIDs take far more room
+ * than variable codes.
+ */
+class RecordSchema {
+ public:
+    /**
+     * @brief Construct a new, empty record schema
+     */
+    RecordSchema();
+
+    /**
+     * @brief Give the schema somewhere to keep its variable codes
+     *
+     * @param codes The buffer; each code takes its length plus one
+     * @param codesSize The number of bytes in the buffer
+     */
+    void begin(char* codes, uint16_t codesSize);
+    /**
+     * @brief Forget the schema
+     */
+    void clear(void);
+    /**
+     * @brief Read a schema from its text
+     *
+     * @param text The schema text
+     * @param length The number of characters in the text
+     * @return **bool** True if the whole schema was read and fit.  The schema
+     * is cleared if it wasn't.
+     */
+    bool load(const char* text, uint16_t length);
+
+    /**
+     * @brief Check whether a schema has been loaded
+     */
+    bool isLoaded(void) const {
+        return _loaded;
+    }
+    /**
+     * @brief Check whether this is the schema with a given ID
+     */
+    bool matches(uint16_t schemaId) const {
+        return _loaded && _id == schemaId;
+    }
+    /**
+     * @brief Get the schema's ID
+     */
+    uint16_t id(void) const {
+        return _id;
+    }
+    /**
+     * @brief Get the number of variables in the schema
+     */
+    uint8_t varCount(void) const {
+        return _varCount;
+    }
+    /**
+     * @brief Get the format byte of a variable
+     */
+    uint8_t format(uint8_t i) const;
+    /**
+     * @brief Get the code of a variable
+     *
+     * @return **const char\*** The code, or an empty string if there is no
+     * such variable
+     */
+    const char* code(uint8_t i) const;
+
+ private:
+    bool parse(const char* text, uint16_t length);
+
+    bool     _loaded;
+    uint16_t _id;
+    uint8_t  _varCount;
+    uint8_t  _formats[RECORD_SCHEMA_MAX_VARIABLES];
+    uint16_t _codeStart[RECORD_SCHEMA_MAX_VARIABLES];
+    char*    _codes;
+    uint16_t _codesSize;
+};
+
+#endif  // SRC_MEASUREMENTRECORD_H_
@@ -0,0 +1,274 @@
+/**
+ * @file RecordQueue.cpp
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Implements the RecordQueue class.
+ */
+
+#include "RecordQueue.h"
+#include "MeasurementRecord.h"
+
+#include <string.h>
+
+// Marks a header copy as belonging to a record queue
+#define QUEUE_MAGIC 0x51
+// The bytes a header copy actually uses: the magic byte, the slot count, the
+// generation, the next sequence number, the pending bits, and the CRC
+#define QUEUE_HEADER_BYTES (11 + (RECORD_QUEUE_MAX_SLOTS + 7) / 8 + 2)
+// The bytes at the start of a slot: the sequence number and the length
+#define QUEUE_SLOT_HEAD 5
+
+#if QUEUE_HEADER_BYTES > RECORD_QUEUE_HEADER_SIZE
+#error "RECORD_QUEUE_MAX_SLOTS is too big for the queue header"
+#endif
+
+
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putUint32(uint8_t* out, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++) out[i] = (value >> (8 * i)) & 0xFF;
+}
+
+static uint16_t getUint16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0]) | (static_cast<uint16_t>(in[1]) << 8);
+}
+
+static uint32_t getUint32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+static uint16_t crcOf(uint16_t crc, const uint8_t* data, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) crc = crc16Add(crc, data[i]);
+    return crc;
+}
+
+
+RecordQueue::RecordQueue(RecordStore& store, uint16_t slotCount)
+    : dropped(0),
+      _store(store),
+      _slotCount(slotCount),
+      _nextSeq(1),
+      _generation(0) {
+    if (_slotCount == 0) _slotCount = 1;
+    if (_slotCount > RECORD_QUEUE_MAX_SLOTS) {
+        _slotCount = RECORD_QUEUE_MAX_SLOTS;
+    }
+    memset(_pending, 0, sizeof(_pending));
+}
+
+
+bool RecordQueue::begin(void) {
+    _nextSeq    = 1;
+    _generation = 0;
+    dropped     = 0;
+    memset(_pending, 0, sizeof(_pending));
+
+    // Use whichever header copy is good and newest. If neither is, the queue
+    // starts out with nothing waiting.
+    uint32_t generation;
+    readHeader(0, generation);
+    readHeader(1, generation);
+
+    // Find the newest record, and stop waiting on any slot that doesn't hold
+    // a good one.  The header's sequence number covers a record whose slot
+    // was torn, so the numbers never go back even with a single slot.
+    bool changed = false;
+    for (uint16_t slot = 0; slot < _slotCount; slot++) {
+        uint32_t seq = checkSlot(slot);
+        if (seq == 0 || slotOf(seq) != slot) {
+            if (getBit(slot)) {
+                setBit(slot, false);
+                changed = true;
+            }
+            continue;
+        }
+        if (seq >= _nextSeq) _nextSeq = seq + 1;
+    }
+    return changed ? writeHeader() : true;
+}
+
+
+uint32_t RecordQueue::push(const uint8_t* data, uint8_t length) {
+    if (length > RECORD_QUEUE_MAX_RECORD) return 0;
+    uint32_t seq     = _nextSeq;
+    uint16_t slot    = slotOf(seq);
+    bool     waiting = getBit(slot);
+
+    // Mark the slot first, so a record is never left marked as sent
+    setBit(slot, true);
+    if (!writeHeader()) {
+        setBit(slot, waiting);
+        return 0;
+    }
+
+    uint8_t bytes[RECORD_QUEUE_SLOT_SIZE];
+    putUint32(bytes, seq);
+    bytes[4] = length;
+    memcpy(bytes + QUEUE_SLOT_HEAD, data, length);
+    uint16_t crc = crcOf(0xFFFF, bytes, QUEUE_SLOT_HEAD + length);
+    putUint16(bytes + QUEUE_SLOT_HEAD + length, crc);
+    if (!_store.write(slotPosition(slot), bytes,
+                      QUEUE_SLOT_HEAD + length + 2)) {
+        return 0;
+    }
+
+    if (waiting) dropped++;  // The oldest record waiting was written over
+    _nextSeq++;
+    return seq;
+}
+
+
+bool RecordQueue::ack(uint32_t seq) {
+    if (!isPending(seq)) return false;
+    setBit(slotOf(seq), false);
+    if (!writeHeader()) {
+        setBit(slotOf(seq), true);
+        return false;
+    }
+    return true;
+}
+
+
+uint32_t RecordQueue::nextPending(uint32_t after) const {
+    uint32_t seq = oldestKept();
+    if (after >= seq) seq = after + 1;
+    for (; seq < _nextSeq; seq++) {
+        if (getBit(slotOf(seq))) return seq;
+    }
+    return 0;
+}
+
+
+uint8_t RecordQueue::read(uint32_t seq, uint8_t* data, uint8_t size) {
+    if (seq < oldestKept() || seq >= _nextSeq) return 0;
+    uint32_t position = slotPosition(slotOf(seq));
+
+    uint8_t head[QUEUE_SLOT_HEAD];
+    if (!_store.read(position, head, sizeof(head))) return 0;
+    uint8_t length = head[4];
+    if (getUint32(head) != seq || length > RECORD_QUEUE_MAX_RECORD ||
+        length > size) {
+        return 0;
+    }
+
+    uint8_t crc[2];
+    if (!_store.read(position + QUEUE_SLOT_HEAD, data, length)) return 0;
+    if (!_store.read(position + QUEUE_SLOT_HEAD + length, crc, 2)) return 0;
+    if (crcOf(crcOf(0xFFFF, head, sizeof(head)), data, length) !=
+        getUint16(crc)) {
+        return 0;
+    }
+    return length;
+}
+
+
+bool RecordQueue::isPending(uint32_t seq) const {
+    return seq >= oldestKept() && seq < _nextSeq && getBit(slotOf(seq));
+}
+
+
+uint16_t RecordQueue::pending(void) const {
+    uint16_t count = 0;
+    for (uint16_t slot = 0; slot < _slotCount; slot++) {
+        if (getBit(slot)) count++;
+    }
+    return count;
+}
+
+
+uint32_t RecordQueue::oldestKept(void) const {
+    return _nextSeq > _slotCount ? _nextSeq - _slotCount : 1;
+}
+
+
+uint32_t RecordQueue::slotPosition(uint16_t slot) const {
+    return 2UL * RECORD_QUEUE_HEADER_SIZE +
+        static_cast<uint32_t>(slot) * RECORD_QUEUE_SLOT_SIZE;
+}
+
+
+bool RecordQueue::getBit(uint16_t slot) const {
+    return _pending[slot / 8] & (1 << (slot % 8));
+}
+
+
+void RecordQueue::setBit(uint16_t slot, bool value) {
+    if (value) {
+        _pending[slot / 8] |= 1 << (slot % 8);
+    } else {
+        _pending[slot / 8] &= ~(1 << (slot % 8));
+    }
+}
+
+
+// Reads one header copy, checking it. The copy's bits are kept if its
+// generation is newer than what we have.
+bool RecordQueue::readHeader(uint8_t copy, uint32_t& generation) {
+    uint8_t header[QUEUE_HEADER_BYTES];
+    if (!_store.read(copy * RECORD_QUEUE_HEADER_SIZE, header, sizeof(header))) {
+        return false;
+    }
+    if (header[0] != QUEUE_MAGIC || getUint16(header + 1) != _slotCount) {
+        return false;
+    }
+    if (crcOf(0xFFFF, header, sizeof(header) - 2) !=
+        getUint16(header + sizeof(header) - 2)) {
+        return false;
+    }
+    generation = getUint32(header + 3);
+    if (generation >= _generation) {
+        _generation = generation;
+        _nextSeq    = getUint32(header + 7);
+        memcpy(_pending, header + 11, sizeof(_pending));
+    }
+    return true;
+}
+
+
+// Writes the header to the copy that wasn't written last, so there is always
+// one good copy even if the power goes out partway through
+bool RecordQueue::writeHeader(void) {
+    uint8_t header[QUEUE_HEADER_BYTES];
+    _generation++;
+    header[0] = QUEUE_MAGIC;
+    putUint16(header + 1, _slotCount);
+    putUint32(header + 3, _generation);
+    putUint32(header + 7, _nextSeq);
+    memcpy(header + 11, _pending, sizeof(_pending));
+    putUint16(header + sizeof(header) - 2,
+              crcOf(0xFFFF, header, sizeof(header) - 2));
+    return _store.write((_generation & 1) * RECORD_QUEUE_HEADER_SIZE, header,
+                        sizeof(header));
+}
+
+
+// Checks a slot's CRC a piece at a time, returning its sequence number if it
+// holds a good record and 0 if it doesn't
+uint32_t RecordQueue::checkSlot(uint16_t slot) {
+    uint32_t position = slotPosition(slot);
+    uint8_t  piece[16];
+    if (!_store.read(position, piece, QUEUE_SLOT_HEAD)) return 0;
+    uint32_t seq    = getUint32(piece);
+    uint8_t  length = piece[4];
+    if (seq == 0 || length > RECORD_QUEUE_MAX_RECORD) return 0;
+
+    uint16_t crc = crcOf(0xFFFF, piece, QUEUE_SLOT_HEAD);
+    position += QUEUE_SLOT_HEAD;
+    while (length > 0) {
+        uint8_t size = length < sizeof(piece) ? length : sizeof(piece);
+        if (!_store.read(position, piece, size)) return 0;
+        crc = crcOf(crc, piece, size);
+        position += size;
+        length -= size;
+    }
+    if (!_store.read(position, piece, 2)) return 0;
+    return crc == getUint16(piece) ? seq : 0;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file RecordQueue.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the RecordQueue class, which keeps a satellite station's
+ * compact records on its SD card until the base station says it has them.
+ *
+ * The queue lives in one fixed-size file:
+ *
+ * | Bytes                  | Contents                                  |
+ * |------------------------|-------------------------------------------|
+ * | 64                     | Header, first copy                        |
+ * | 64                     | Header, second copy                       |
+ * | RECORD_QUEUE_SLOT_SIZE | Slot 0                                    |
+ * | ...                    | Slot 1 to slotCount - 1                   |
+ *
+ * Each record goes in the slot for its sequence number (sequence number
+ * modulo the slot count), so the file is a ring and the oldest record is
+ * written over once it is full.  A slot holds the sequence number, the
+ * record's length, the record, and a CRC of all three.  The header holds a
+ * bit for each slot saying whether its record is still waiting to be sent
+ * and the next sequence number, and is written to the two copies in turn,
+ * each with its own CRC.
+ *
+ * Nothing is ever half-trusted after the power goes out partway through a
+ * write: a torn header copy fails its CRC and the other copy is used, and a
+ * torn slot fails its CRC and is skipped.  The header is always written
+ * before the slot, so the worst that can happen is a record being sent
+ * twice, never one being marked as sent when it wasn't.
+ */
+
+// Header Guards
+#ifndef SRC_RECORDQUEUE_H_
+#define SRC_RECORDQUEUE_H_
+
+// Included Dependencies
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief The most slots a RecordQueue can have; a week of hourly records
+ */
+#ifndef RECORD_QUEUE_MAX_SLOTS
+#define RECORD_QUEUE_MAX_SLOTS 168
+#endif
+
+/**
+ * @brief The number of bytes each slot takes in the file
+ *
+ * This is 7 bytes of bookkeeping plus the longest record a slot can hold.
+ */
+#ifndef RECORD_QUEUE_SLOT_SIZE
+#define RECORD_QUEUE_SLOT_SIZE 160
+#endif
+
+/// The longest record a slot can hold
+#define RECORD_QUEUE_MAX_RECORD (RECORD_QUEUE_SLOT_SIZE - 7)
+/// The number of bytes set aside for each copy of the header
+#define RECORD_QUEUE_HEADER_SIZE 64
+
+
+/**
+ * @brief Somewhere a RecordQueue can keep its file.
+ *
+ * The queue only ever reads and writes whole pieces at a given position, so
+ * anything from an SD card file to an array in memory can hold it.  The
+ * store should make sure a write has actually reached the card before it
+ * returns.
+ */
+class RecordStore {
+ public:
+    virtual ~RecordStore() {}
+
+    /**
+     * @brief Read bytes from the file
+     *
+     * @param position Where to start reading
+     * @param data Where to put the bytes
+     * @param length The number of bytes to read
+     * @return **bool** True if every byte was read
+     */
+    virtual bool read(uint32_t position, uint8_t* data, uint16_t length) = 0;
+    /**
+     * @brief Write bytes to the file
+     *
+     * @param position Where to start writing
+     * @param data The bytes to write
+     * @param length The number of bytes to write
+     * @return **bool** True if every byte was written and saved
+     */
+    virtual bool write(uint32_t position, const uint8_t* data,
+                       uint16_t length) = 0;
+};
+
+
+/**
+ * @brief Keeps a satellite station's compact records until the base station
+ * acknowledges them by their sequence numbers.
+ *
+ * Sequence numbers start at 1 and only go up, including across restarts.
+ * The station pushes each logging interval's record as it is made.  The
+ * base station acknowledges it along with that interval's dump, and any
+ * records it missed stay in the queue to be sent later.
+ */
+class RecordQueue {
+ public:
+    /**
+     * @brief Construct a new record queue
+     *
+     * @param store Where the queue's file is kept
+     * @param slotCount The number of records the queue can hold, up to
+     * RECORD_QUEUE_MAX_SLOTS
+     */
+    RecordQueue(RecordStore& store, uint16_t slotCount);
+
+    /**
+     * @brief Get the size the queue's file needs to be
+     */
+    uint32_t fileSize(void) const {
+        return 2UL * RECORD_QUEUE_HEADER_SIZE +
+            static_cast<uint32_t>(_slotCount) * RECORD_QUEUE_SLOT_SIZE;
+    }
+
+    /**
+     * @brief Read the queue back from its file
+     *
+     * Every slot is checked, so this reads the whole file; it is meant to be
+     * called once at startup.  A file that was never written (or was written
+     * with a different slot count) starts the queue out empty.
+     *
+     * @return **bool** True if the file could be read
+     */
+    bool begin(void);
+
+    /**
+     * @brief Add a record to the queue
+     *
+     * If the queue is full, the oldest record still waiting is written over
+     * and counted in dropped.
+     *
+     * @param data The record
+     * @param length The number of bytes in the record, up to
+     * RECORD_QUEUE_MAX_RECORD
+     * @return **uint32_t** The record's sequence number, or 0 if it couldn't
+     * be saved
+     */
+    uint32_t push(const uint8_t* data, uint8_t length);
+    /**
+     * @brief Mark a record as received by the base station
+     *
+     * @param seq The record's sequence number
+     * @return **bool** True if the record was waiting and is now marked
+     */
+    bool ack(uint32_t seq);
+
+    /**
+     * @brief Find the oldest record still waiting after a given one
+     *
+     * @param after The sequence number to start after; 0 for the oldest of
+     * all
+     * @return **uint32_t** The record's sequence number, or 0 if there are
+     * none
+     */
+    uint32_t nextPending(uint32_t after = 0) const;
+    /**
+     * @brief Read a record back out of the queue
+     *
+     * @param seq The record's sequence number
+     * @param data Where to put the record; RECORD_QUEUE_MAX_RECORD bytes is
+     * always enough
+     * @param size The room in data
+     * @return **uint8_t** The number of bytes in the record, or 0 if it isn't
+     * in the queue (or didn't fit in data)
+     */
+    uint8_t read(uint32_t seq, uint8_t* data, uint8_t size);
+
+    /**
+     * @brief Check whether a record is still waiting to be sent
+     */
+    bool isPending(uint32_t seq) const;
+    /**
+     * @brief Get the number of records still waiting to be sent
+     */
+    uint16_t pending(void) const;
+    /**
+     * @brief Get the sequence number of the newest record, or 0 if there
+     * has never been one
+     */
+    uint32_t newest(void) const {
+        return _nextSeq - 1;
+    }
+
+    /**
+     * @brief The number of records written over before they were sent since
+     * the queue was started
+     */
+    uint16_t dropped;
+
+ private:
+    uint16_t slotOf(uint32_t seq) const {
+        return seq % _slotCount;
+    }
+    uint32_t oldestKept(void) const;
+    uint32_t slotPosition(uint16_t slot) const;
+    bool     getBit(uint16_t slot) const;
+    void     setBit(uint16_t slot, bool value);
+    bool     readHeader(uint8_t copy, uint32_t& generation);
+    bool     writeHeader(void);
+    uint32_t checkSlot(uint16_t slot);
+
+    RecordStore& _store;
+    uint16_t     _slotCount;
+    uint32_t     _nextSeq;
+    uint32_t     _generation;
+    uint8_t      _pending[(RECORD_QUEUE_MAX_SLOTS + 7) / 8];
+};
+
+#endif  // SRC_RECORDQUEUE_H_
@@ -0,0 +1,81 @@
+/**
+ * @file SdRecordStore.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the SdRecordStore class, which keeps a RecordQueue or a
+ * BinaryLog in a file on the SD card.
+ *
+ * This is kept out of SnowRadio.h so that only the sketches that use it need
+ * SdFat.  The file is opened and closed around every read and write, so the
+ * store keeps working when the card is powered down and set up again between
+ * logging intervals.
+ */
+
+// Header Guards
+#ifndef SRC_SDRECORDSTORE_H_
+#define SRC_SDRECORDSTORE_H_
+
+// Included Dependencies
+#include <SdFat.h>
+#include "RecordQueue.h"
+
+
+/**
+ * @brief Keeps a RecordQueue or a BinaryLog in a file on the SD card, using
+ * whichever SD card was set up (begun) last.
+ */
+class SdRecordStore : public RecordStore {
+ public:
+    /**
+     * @brief Construct a new SD record store
+     *
+     * @param fileName The name of the file, which must stay valid
+     */
+    explicit SdRecordStore(const char* fileName) : _fileName(fileName) {}
+
+    /**
+     * @brief Make sure the file exists and is at least a given size
+     *
+     * The whole file is written out ahead of time so a record never has to
+     * grow the file (and change its directory entry) when it is written.
+     *
+     * @param size The size the file needs to be (RecordQueue::fileSize()), or
+     * 0 for a BinaryLog, which grows the file a block at a time
+     * @return **bool** True if the file is ready
+     */
+    bool begin(uint32_t size) {
+        File file;
+        if (!file.open(_fileName, O_RDWR | O_CREAT)) return false;
+        bool ok = file.seekEnd();
+        while (ok && file.fileSize() < size) {
+            ok = file.write(static_cast<uint8_t>(0)) == 1;
+        }
+        ok = file.sync() && ok;
+        file.close();
+        return ok;
+    }
+
+    bool read(uint32_t position, uint8_t* data, uint16_t length) override {
+        File file;
+        if (!file.open(_fileName, O_RDONLY)) return false;
+        bool ok = file.seekSet(position) && file.read(data, length) == length;
+        file.close();
+        return ok;
+    }
+
+    bool write(uint32_t position, const uint8_t* data,
+               uint16_t length) override {
+        File file;
+        if (!file.open(_fileName, O_RDWR)) return false;
+        bool ok = file.seekSet(position) && file.write(data, length) == length;
+        ok      = file.sync() && ok;  // Make sure it is on the card
+        file.close();
+        return ok;
+    }
+
+ private:
+    const char* _fileName;
+};
+
+#endif  // SRC_SDRECORDSTORE_H_
@@ -0,0 +1,222 @@
+/**
+ * @file SlotSchedule.cpp
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Implements the slot schedule functions and the SlotTimer class.
+ */
+
+#include "SlotSchedule.h"
+
+/**
+ * @brief The least the drift is ever taken to be known to, in parts per
+ * million.  A DS3231's rate wanders by about this much with the temperature,
+ * however long the drift has been measured over.
+ */
+#define SLOT_MIN_DRIFT_PPM 2
+
+
+// Little endian, like the compact record
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putUint32(uint8_t* out, uint32_t value) {
+    for (uint8_t b = 0; b < 4; b++) out[b] = (value >> (8 * b)) & 0xFF;
+}
+
+static uint16_t getUint16(const uint8_t* in) {
+    return in[0] | (static_cast<uint16_t>(in[1]) << 8);
+}
+
+static uint32_t getUint32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (uint8_t b = 0; b < 4; b++) {
+        value |= static_cast<uint32_t>(in[b]) << (8 * b);
+    }
+    return value;
+}
+
+
+uint8_t slotPutSchedule(uint8_t* out, uint32_t baseEpoch, uint16_t openS,
+                        uint16_t closeS) {
+    putUint32(out, baseEpoch);
+    putUint16(out + 4, openS);
+    putUint16(out + 6, closeS);
+    return SLOT_SCHEDULE_SIZE;
+}
+
+
+bool slotGetSchedule(const uint8_t* in, uint8_t length, uint32_t* baseEpoch,
+                     uint16_t* openS, uint16_t* closeS) {
+    if (length < SLOT_SCHEDULE_SIZE) return false;
+    *baseEpoch = getUint32(in);
+    *openS     = getUint16(in + 4);
+    *closeS    = getUint16(in + 6);
+    return *closeS > *openS;
+}
+
+
+SlotTimer::SlotTimer(uint32_t cycleS, uint16_t fallbackOpenS,
+                     uint16_t fallbackCloseS, uint8_t minGuardS,
+                     uint16_t maxDriftPpm, uint8_t maxMissed)
+    : _cycleS(cycleS > 0 ? cycleS : 1),
+      _fallbackOpenS(fallbackOpenS),
+      _fallbackCloseS(fallbackCloseS),
+      _minGuardS(minGuardS),
+      _maxDriftPpm(maxDriftPpm),
+      _maxMissed(maxMissed > 0 ? maxMissed : 1) {
+    forget();
+}
+
+
+void SlotTimer::forget(void) {
+    _hasSlot      = false;
+    _openS        = 0;
+    _closeS       = 0;
+    _missed       = 0;
+    _hasOffset    = false;
+    _anchorLocal  = 0;
+    _anchorOffset = 0;
+    _lastLocal    = 0;
+    _lastOffset   = 0;
+    _driftPpm     = 0;
+}
+
+
+bool SlotTimer::heard(const uint8_t* in, uint8_t length, uint32_t localEpoch) {
+    uint32_t baseEpoch;
+    uint16_t openS;
+    uint16_t closeS;
+    if (!slotGetSchedule(in, length, &baseEpoch, &openS, &closeS)) {
+        return false;
+    }
+    setSlot(openS, closeS);
+    synced(baseEpoch, localEpoch);
+    return true;
+}
+
+
+void SlotTimer::setSlot(uint16_t openS, uint16_t closeS) {
+    _openS   = openS;
+    _closeS  = closeS;
+    _hasSlot = closeS > openS;
+}
+
+
+void SlotTimer::synced(uint32_t baseEpoch, uint32_t localEpoch) {
+    int32_t offset = wrapOffset(baseEpoch, localEpoch);
+
+    // An offset far from the one predicted means one of the clocks was set,
+    // so the drift is measured over again from here
+    bool anchor = !_hasOffset;
+    if (!anchor) {
+        int32_t error = offset - offsetAt(localEpoch);
+        if (error < 0) error = -error;
+        anchor = error > guardAt(localEpoch) + 1;
+    }
+
+    if (anchor) {
+        _anchorLocal  = localEpoch;
+        _anchorOffset = offset;
+        _driftPpm     = 0;
+    } else {
+        int32_t baseline = static_cast<int32_t>(localEpoch - _anchorLocal);
+        if (baseline > 0) {
+            _driftPpm = (offset - _anchorOffset) * 1e6f / baseline;
+            // Over a short baseline, the one second the clocks count in is
+            // more than any real drift
+            if (_driftPpm > _maxDriftPpm) _driftPpm = _maxDriftPpm;
+            if (_driftPpm < -_maxDriftPpm) _driftPpm = -_maxDriftPpm;
+        }
+    }
+
+    _lastLocal  = localEpoch;
+    _lastOffset = offset;
+    _hasOffset  = true;
+    _missed     = 0;
+}
+
+
+void SlotTimer::clockStepped(int32_t stepS) {
+    if (!_hasOffset) return;
+    _anchorLocal += stepS;
+    _lastLocal += stepS;
+    _anchorOffset -= stepS;
+    _lastOffset -= stepS;
+}
+
+
+void SlotTimer::missed(void) {
+    if (_missed < 255) _missed++;
+}
+
+
+void SlotTimer::window(uint32_t cycleStart, uint32_t nowEpoch,
+                       uint32_t* openEpoch, uint32_t* closeEpoch) const {
+    uint16_t openS  = isSynced() ? _openS : _fallbackOpenS;
+    uint16_t closeS = isSynced() ? _closeS : _fallbackCloseS;
+    if (_hasOffset) {
+        // The slot is by the base station's clock.  The fallback window is
+        // moved by what's known of the clocks too, so a station whose clock
+        // is a little behind doesn't keep missing the first slot.
+        uint32_t open  = cycleStart + openS - offsetAt(cycleStart + openS);
+        uint32_t close = cycleStart + closeS - offsetAt(cycleStart + closeS);
+        *openEpoch     = open - guardAt(open);
+        *closeEpoch    = close + guardAt(close);
+    } else {
+        *openEpoch  = cycleStart + openS;
+        *closeEpoch = cycleStart + closeS;
+    }
+    while (static_cast<int32_t>(*closeEpoch - nowEpoch) <= 0) {
+        *openEpoch += _cycleS;
+        *closeEpoch += _cycleS;
+    }
+}
+
+
+bool SlotTimer::isSynced(void) const {
+    return _hasSlot && _hasOffset && _missed < _maxMissed;
+}
+
+
+int32_t SlotTimer::offsetAt(uint32_t localEpoch) const {
+    if (!_hasOffset) return 0;
+    int32_t elapsed = static_cast<int32_t>(localEpoch - _lastLocal);
+    float   offset  = _lastOffset + _driftPpm * elapsed / 1e6f;
+    return static_cast<int32_t>(offset < 0 ? offset - 0.5f : offset + 0.5f);
+}
+
+
+uint16_t SlotTimer::guardAt(uint32_t localEpoch) const {
+    int32_t elapsed = static_cast<int32_t>(localEpoch - _lastLocal);
+    if (elapsed < 0) elapsed = -elapsed;
+    float guard = _minGuardS + driftUncertaintyPpm() * elapsed / 1e6f;
+    if (guard > 65535.0f) return 65535;
+    // Round up, so the guard is never short
+    uint16_t seconds = static_cast<uint16_t>(guard);
+    return seconds < guard ? seconds + 1 : seconds;
+}
+
+
+float SlotTimer::driftUncertaintyPpm(void) const {
+    int32_t baseline = static_cast<int32_t>(_lastLocal - _anchorLocal);
+    if (!_hasOffset || baseline <= 0) return _maxDriftPpm;
+    // Each offset is measured to within a second, at both ends
+    float uncertainty = 2e6f / baseline;
+    if (uncertainty > _maxDriftPpm) return _maxDriftPpm;
+    if (uncertainty < SLOT_MIN_DRIFT_PPM) return SLOT_MIN_DRIFT_PPM;
+    return uncertainty;
+}
+
+
+// The offset is only known to within a cycle, so it is kept to within half a
+// cycle either way
+int32_t SlotTimer::wrapOffset(uint32_t baseEpoch, uint32_t localEpoch) const {
+    int32_t cycle  = static_cast<int32_t>(_cycleS);
+    int32_t offset = static_cast<int32_t>(baseEpoch - localEpoch) % cycle;
+    if (offset > cycle / 2) offset -= cycle;
+    if (offset < -(cycle / 2)) offset += cycle;
+    return offset;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file SlotSchedule.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the radio slot schedule the base station hands out, and
+ * the SlotTimer that works out when a satellite station's radio should be on.
+ *
+ * Every logging interval (a cycle), the base station contacts each satellite
+ * station in a slot of its own, a set number of seconds after the start of
+ * the cycle by the base station's clock.  It tells each station its slot, and
+ * the time on its own clock, along with every 'R':
+ *
+ * | Bytes | Contents                                              |
+ * |-------|-------------------------------------------------------|
+ * | 4     | The base station's epoch time in seconds (little end.) |
+ * | 2     | When the slot opens, in seconds into the cycle        |
+ * | 2     | When the slot closes, in seconds into the cycle       |
+ *
+ * Like the rest of the library, nothing here reads a clock.  The times are
+ * passed in, so a whole network can be simulated on a desktop (see the
+ * slot_sim utility).
+ */
+
+// Header Guards
+#ifndef SRC_SLOTSCHEDULE_H_
+#define SRC_SLOTSCHEDULE_H_
+
+// Included Dependencies
+#include <stdint.h>
+
+
+/// The number of bytes of schedule that follow the 'R'
+#define SLOT_SCHEDULE_SIZE 8
+
+
+/**
+ * @brief Write a station's slot and the base station's time
+ *
+ * @param out Where to write it; needs SLOT_SCHEDULE_SIZE bytes
+ * @param baseEpoch The base station's time, in seconds
+ * @param openS When the slot opens, in seconds into the cycle
+ * @param closeS When the slot closes, in seconds into the cycle
+ * @return **uint8_t** The number of bytes written
+ */
+uint8_t slotPutSchedule(uint8_t* out, uint32_t baseEpoch, uint16_t openS,
+                        uint16_t closeS);
+
+/**
+ * @brief Read a station's slot and the base station's time
+ *
+ * @param in The bytes after the 'R'
+ * @param length The number of bytes after the 'R'
+ * @param baseEpoch The base station's time, in seconds
+ * @param openS When the slot opens, in seconds into the cycle
+ * @param closeS When the slot closes, in seconds into the cycle
+ * @return **bool** True if there was a schedule; older base station sketches
+ * send a plain 'R'
+ */
+bool slotGetSchedule(const uint8_t* in, uint8_t length, uint32_t* baseEpoch,
+                     uint16_t* openS, uint16_t* closeS);
+
+
+/**
+ * @brief Works out when a satellite station's radio should be on to hear the
+ * base station in its slot.
+ *
+ * The base station's slot times are by its own clock, so the timer keeps
+ * track of how far the satellite's clock is from it.  Each time the base
+ * station is heard, synced() measures the offset between the clocks, and the
+ * change in the offset since the first time gives the drift between them.
+ * The window the radio is on for is the slot, moved by the offset the drift
+ * predicts, with a guard time on either side.  The guard is minGuardS plus as
+ * far as the clocks could have drifted since they were last compared.  The
+ * drift is only known to within the one second the clocks count in, over the
+ * time it was measured across, so the guard starts out wide (maxDriftPpm) and
+ * narrows as the timer learns the drift over the days.
+ *
+ * Until the base station has been heard (after a restart, or after missing
+ * it maxMissed cycles in a row, in case its schedule changed), the radio is
+ * on for the fallback window, which should cover every slot.  Once the
+ * clocks have been compared, the fallback window is moved by the offset and
+ * given guard times too.
+ *
+ * The offset is only worked out to within a cycle, so the base and satellite
+ * clocks can be in different time zones as long as they are a whole number
+ * of cycles apart.
+ */
+class SlotTimer {
+ public:
+    /**
+     * @brief Construct a new slot timer
+     *
+     * @param cycleS The length of a cycle (the logging interval) in seconds
+     * @param fallbackOpenS When to turn the radio on while the slot isn't
+     * known, in seconds into the cycle by the satellite's clock
+     * @param fallbackCloseS When to turn it off again
+     * @param minGuardS The least guard time on either side of the slot, which
+     * covers the one second the clocks count in and the radio waking up
+     * @param maxDriftPpm The most the clocks could drift apart, in parts per
+     * million, used until the drift has been measured
+     * @param maxMissed The most cycles in a row the base station can be
+     * missed before going back to the fallback window
+     */
+    SlotTimer(uint32_t cycleS, uint16_t fallbackOpenS, uint16_t fallbackCloseS,
+              uint8_t minGuardS = 2, uint16_t maxDriftPpm = 100,
+              uint8_t maxMissed = 3);
+
+    /**
+     * @brief Take the schedule that came with an 'R' from the base station
+     *
+     * @param in The bytes after the 'R'
+     * @param length The number of bytes after the 'R'
+     * @param localEpoch The time on the satellite's clock when it came in
+     * @return **bool** True if there was a schedule in it
+     */
+    bool heard(const uint8_t* in, uint8_t length, uint32_t localEpoch);
+    /**
+     * @brief Set the slot the base station gave this station
+     *
+     * @param openS When the slot opens, in seconds into the cycle
+     * @param closeS When the slot closes, in seconds into the cycle
+     */
+    void setSlot(uint16_t openS, uint16_t closeS);
+    /**
+     * @brief Compare the clocks when the base station is heard
+     *
+     * @param baseEpoch The time the base station sent
+     * @param localEpoch The time on the satellite's clock when it came in
+     */
+    void synced(uint32_t baseEpoch, uint32_t localEpoch);
+    /**
+     * @brief Record that the base station wasn't heard in the window
+     */
+    void missed(void);
+    /**
+     * @brief Forget the slot and everything learned about the clocks, going
+     * back to the fallback window.  Call this if the satellite's clock is
+     * set by hand.
+     */
+    void forget(void);
+    /**
+     * @brief Move what's known of the clocks along with the satellite's clock
+     * when it is stepped, so the drift measured so far is kept
+     *
+     * @param stepS The seconds the satellite's clock was moved forward by
+     */
+    void clockStepped(int32_t stepS);
+
+    /**
+     * @brief Work out when to turn the radio on and off for a cycle
+     *
+     * If the window for the cycle is already over (the satellite's clock is
+     * far enough behind the base station's), the window in the next cycle is
+     * given instead.
+     *
+     * @param cycleStart The start of the cycle by the satellite's clock (the
+     * marked time of the cycle's reading)
+     * @param nowEpoch The time on the satellite's clock now
+     * @param openEpoch When to turn the radio on
+     * @param closeEpoch When to turn it off if the base station isn't heard
+     */
+    void window(uint32_t cycleStart, uint32_t nowEpoch, uint32_t* openEpoch,
+                uint32_t* closeEpoch) const;
+
+    /**
+     * @brief Check whether the slot and the clock offset are known
+     */
+    bool isSynced(void) const;
+    /**
+     * @brief Get how far the base station's clock is ahead of the
+     * satellite's
+     *
+     * @param localEpoch The time on the satellite's clock
+     * @return **int32_t** The offset the drift predicts, in seconds
+     */
+    int32_t offsetAt(uint32_t localEpoch) const;
+    /**
+     * @brief Get the guard time on either side of the slot
+     *
+     * @param localEpoch The time on the satellite's clock
+     * @return **uint16_t** The guard time in seconds
+     */
+    uint16_t guardAt(uint32_t localEpoch) const;
+    /**
+     * @brief Get the drift between the clocks
+     *
+     * @return **float** How fast the base station's clock gains on the
+     * satellite's, in parts per million; 0 until it has been measured
+     */
+    float driftPpm(void) const {
+        return _driftPpm;
+    }
+    /**
+     * @brief Get how well the drift is known
+     *
+     * @return **float** The most the drift could be off by, in parts per
+     * million
+     */
+    float driftUncertaintyPpm(void) const;
+    /**
+     * @brief Get when the slot opens, in seconds into the cycle
+     */
+    uint16_t openS(void) const {
+        return _openS;
+    }
+    /**
+     * @brief Get when the slot closes, in seconds into the cycle
+     */
+    uint16_t closeS(void) const {
+        return _closeS;
+    }
+    /**
+     * @brief Get the number of cycles in a row the base station was missed
+     */
+    uint8_t missedCount(void) const {
+        return _missed;
+    }
+
+ private:
+    int32_t wrapOffset(uint32_t baseEpoch, uint32_t localEpoch) const;
+
+    uint32_t _cycleS;
+    uint16_t _fallbackOpenS;
+    uint16_t _fallbackCloseS;
+    uint8_t  _minGuardS;
+    uint16_t _maxDriftPpm;
+    uint8_t  _maxMissed;
+
+    bool     _hasSlot;
+    uint16_t _openS;
+    uint16_t _closeS;
+    uint8_t  _missed;
+    /**
+     * @brief Whether the clocks have been compared
+     */
+    bool _hasOffset;
+    /**
+     * @brief The first comparison the drift is measured from
+     */
+    uint32_t _anchorLocal;
+    int32_t  _anchorOffset;
+    /**
+     * @brief The latest comparison
+     */
+    uint32_t _lastLocal;
+    int32_t  _lastOffset;
+    float    _driftPpm;
+};
+
+#endif  // SRC_SLOTSCHEDULE_H_
@@ -0,0 +1,22 @@
+/**
+ * @file SnowRadio.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief A single include for everything in the SnowRadio library.
+ */
+
+// Header Guards
+#ifndef SRC_SNOWRADIO_H_
+#define SRC_SNOWRADIO_H_
+
+#include "XBeeFrame.h"
+#include "XBeeReceiver.h"
+#include "StationScheduler.h"
+#include "MeasurementRecord.h"
+#include "RecordQueue.h"
+#include "BinaryLog.h"
+#include "SlotSchedule.h"
+#include "ClockSync.h"
+
+#endif  // SRC_SNOWRADIO_H_
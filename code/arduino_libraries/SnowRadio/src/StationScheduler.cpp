@@ -0,0 +1,242 @@
+/**
+ * @file StationScheduler.cpp
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Implements the StationScheduler class.
+ */
+
+#include "StationScheduler.h"
+
+
+StationScheduler::StationScheduler(stationSlot* slots, uint8_t stationCount,
+                                   uint8_t maxInFlight, uint32_t firstBackoffMs,
+                                   uint32_t maxBackoffMs)
+    : lastLatencyMs(0),
+      maxLatencyMs(0),
+      totalLatencyMs(0),
+      exchanges(0),
+      timeouts(0),
+      _slots(slots),
+      _stationCount(stationCount),
+      _maxInFlight(maxInFlight > 0 ? maxInFlight : 1),
+      _firstBackoffMs(firstBackoffMs),
+      _maxBackoffMs(maxBackoffMs),
+      _lastFrameId(0) {
+    for (uint8_t i = 0; i < _stationCount; i++) {
+        _slots[i].address64 = NULL;
+        _slots[i].inOrder   = false;
+        _slots[i].status    = stationFinished;
+    }
+}
+
+
+void StationScheduler::setAddress(uint8_t station, const uint8_t* address64) {
+    if (station < _stationCount) _slots[station].address64 = address64;
+}
+
+
+void StationScheduler::setInOrder(uint8_t station, bool inOrder) {
+    if (station < _stationCount) _slots[station].inOrder = inOrder;
+}
+
+
+void StationScheduler::begin(uint32_t nowMs) {
+    for (uint8_t i = 0; i < _stationCount; i++) {
+        _slots[i].status    = stationDue;
+        _slots[i].frameId   = 0;
+        _slots[i].tries     = 0;
+        _slots[i].sentMs    = nowMs;
+        _slots[i].dueMs     = nowMs;
+        _slots[i].backoffMs = _firstBackoffMs;
+    }
+    lastLatencyMs  = 0;
+    maxLatencyMs   = 0;
+    totalLatencyMs = 0;
+    exchanges      = 0;
+    timeouts       = 0;
+}
+
+
+void StationScheduler::startAt(uint8_t station, uint32_t dueMs) {
+    if (station < _stationCount && _slots[station].status == stationDue) {
+        _slots[station].dueMs = dueMs;
+    }
+}
+
+
+// Comparing the difference keeps this right when millis() rolls over
+bool StationScheduler::isDue(uint32_t dueMs, uint32_t nowMs) {
+    return static_cast<int32_t>(nowMs - dueMs) >= 0;
+}
+
+
+int8_t StationScheduler::nextDue(uint32_t nowMs) const {
+    if (inFlight() >= _maxInFlight) return -1;
+    for (uint8_t i = 0; i < _stationCount; i++) {
+        if (_slots[i].status != stationDue) continue;
+        if (!isDue(_slots[i].dueMs, nowMs)) continue;
+        if (_slots[i].inOrder && !canRelease(i)) continue;
+        return i;
+    }
+    return -1;
+}
+
+
+uint8_t StationScheduler::sent(uint8_t station, uint32_t nowMs,
+                               uint32_t timeoutMs) {
+    if (station >= _stationCount) return 0;
+    // Hand out frame IDs 1 to 255 in turn; 0 would stop the transmit status
+    _lastFrameId++;
+    if (_lastFrameId == 0) _lastFrameId = 1;
+
+    stationSlot& slot = _slots[station];
+    slot.frameId      = _lastFrameId;
+    slot.status       = stationWaiting;
+    slot.sentMs       = nowMs;
+    slot.dueMs        = nowMs + timeoutMs;
+    return slot.frameId;
+}
+
+
+int8_t StationScheduler::stationFor(const XBeeFrameDecoder& decoder) const {
+    for (uint8_t i = 0; i < _stationCount; i++) {
+        if (decoder.isReceivePacket()) {
+            if (_slots[i].address64 != NULL &&
+                decoder.isFrom(_slots[i].address64)) {
+                return i;
+            }
+        } else if (decoder.isTransmitStatus()) {
+            if (_slots[i].status == stationWaiting &&
+                _slots[i].frameId == decoder.statusFrameId()) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+
+bool StationScheduler::deliveryFailed(uint8_t                 station,
+                                      const XBeeFrameDecoder& decoder) const {
+    return station < _stationCount && decoder.isTransmitStatus() &&
+        _slots[station].status == stationWaiting &&
+        decoder.statusFrameId() == _slots[station].frameId &&
+        decoder.deliveryStatus() != 0x00;
+}
+
+
+void StationScheduler::answered(uint8_t station, uint32_t nowMs) {
+    if (station >= _stationCount) return;
+    stationSlot& slot = _slots[station];
+    if (slot.status == stationWaiting) {
+        lastLatencyMs = nowMs - slot.sentMs;
+        if (lastLatencyMs > maxLatencyMs) maxLatencyMs = lastLatencyMs;
+        totalLatencyMs += lastLatencyMs;
+        exchanges++;
+    }
+    slot.status    = stationDue;
+    slot.dueMs     = nowMs;
+    slot.tries     = 0;
+    slot.backoffMs = _firstBackoffMs;
+}
+
+
+void StationScheduler::extend(uint8_t station, uint32_t nowMs,
+                              uint32_t timeoutMs) {
+    if (station < _stationCount && _slots[station].status == stationWaiting) {
+        _slots[station].dueMs = nowMs + timeoutMs;
+    }
+}
+
+
+int8_t StationScheduler::nextExpired(uint32_t nowMs) const {
+    for (uint8_t i = 0; i < _stationCount; i++) {
+        if (_slots[i].status == stationWaiting &&
+            isDue(_slots[i].dueMs, nowMs)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+bool StationScheduler::retry(uint8_t station, uint32_t nowMs,
+                             uint8_t maxTries) {
+    if (station >= _stationCount) return false;
+    stationSlot& slot = _slots[station];
+    // The backoff never puts the retry later than the request would have
+    // timed out, so a station that never answers takes no longer than
+    // maxTries timeouts back to back
+    uint32_t latestMs = nowMs;
+    if (slot.status == stationWaiting) {
+        timeouts++;
+        if (!isDue(slot.dueMs, nowMs)) latestMs = slot.dueMs;
+    }
+    slot.status = stationDue;
+
+    if (++slot.tries < maxTries) {
+        slot.dueMs = isDue(nowMs + slot.backoffMs, latestMs)
+            ? nowMs + slot.backoffMs
+            : latestMs;
+        slot.backoffMs = slot.backoffMs * 2 > _maxBackoffMs
+            ? _maxBackoffMs
+            : slot.backoffMs * 2;
+        return true;
+    }
+    slot.dueMs     = nowMs;
+    slot.tries     = 0;
+    slot.backoffMs = _firstBackoffMs;
+    return false;
+}
+
+
+void StationScheduler::failed(uint8_t station, uint32_t nowMs) {
+    if (station >= _stationCount) return;
+    stationSlot& slot = _slots[station];
+    if (slot.status == stationWaiting) timeouts++;
+    slot.status    = stationDue;
+    slot.dueMs     = nowMs;
+    slot.tries     = 0;
+    slot.backoffMs = _firstBackoffMs;
+}
+
+
+void StationScheduler::hold(uint8_t station) {
+    if (station < _stationCount) _slots[station].status = stationHeld;
+}
+
+
+bool StationScheduler::canRelease(uint8_t station) const {
+    for (uint8_t i = 0; i < station && i < _stationCount; i++) {
+        if (_slots[i].status != stationFinished) return false;
+    }
+    return true;
+}
+
+
+void StationScheduler::finish(uint8_t station) {
+    if (station < _stationCount) _slots[station].status = stationFinished;
+}
+
+
+bool StationScheduler::allFinished(void) const {
+    for (uint8_t i = 0; i < _stationCount; i++) {
+        if (_slots[i].status != stationFinished) return false;
+    }
+    return true;
+}
+
+
+uint8_t StationScheduler::inFlight(void) const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _stationCount; i++) {
+        if (_slots[i].status == stationWaiting) count++;
+    }
+    return count;
+}
+
+
+uint32_t StationScheduler::averageLatencyMs(void) const {
+    return exchanges > 0 ? totalLatencyMs / exchanges : 0;
+}
@@ -0,0 +1,298 @@
+/**
+ * @file StationScheduler.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the StationScheduler class, which keeps requests in flight
+ * to several satellite stations at once.
+ *
+ * Like the XBeeReceiver, the scheduler never reads a clock or a serial port
+ * itself.  The time in milliseconds is passed in with every call, so a whole
+ * collection cycle can be run on a desktop against simulated stations.
+ */
+
+// Header Guards
+#ifndef SRC_STATIONSCHEDULER_H_
+#define SRC_STATIONSCHEDULER_H_
+
+// Included Dependencies
+#include "XBeeFrame.h"
+
+
+/**
+ * @brief Everything the scheduler tracks for one satellite station.
+ *
+ * The sketch supplies an array of these, one per station, in the order the
+ * stations should be finished in (farthest first).
+ */
+typedef struct {
+    /// The 8 byte address of the station's XBee
+    const uint8_t* address64;
+    /// Where the station stands; one of StationScheduler::stationStatus
+    uint8_t status;
+    /// Whether requests to this station wait until every station before it is
+    /// finished
+    bool inOrder;
+    /// The frame ID of the request in flight, if any
+    uint8_t frameId;
+    /// The number of times the current request has failed
+    uint8_t tries;
+    /// When the request in flight was sent
+    uint32_t sentMs;
+    /// When the next request is due, or when the one in flight times out
+    uint32_t dueMs;
+    /// How long to wait before the next retry
+    uint32_t backoffMs;
+} stationSlot;
+
+
+/**
+ * @brief Keeps requests in flight to several satellite stations at once and
+ * matches the answers back up with the station they came from.
+ *
+ * The scheduler only handles the timing; the sketch decides what each request
+ * is and what to do with each answer.  A collection cycle looks like this:
+ *
+ * - nextDue() gives a station that needs a request sent.  The sketch sends it
+ * with the frame ID returned from sent().
+ * - stationFor() tells which station an incoming frame belongs to, by the
+ * source address of a receive packet or by the frame ID of a transmit status.
+ * The sketch calls answered() when it is ready for the next request, or
+ * extend() if more of the same answer is on the way.
+ * - nextExpired() gives a station whose request timed out.  The sketch calls
+ * retry(), which sends the request again.  A request the XBee reports it
+ * couldn't deliver is retried after an exponential backoff instead, but never
+ * later than it would have timed out.
+ * - When a station has everything, the sketch calls hold().  canRelease()
+ * says when every station before it is finished, so a station that may be
+ * relaying for stations farther out is only let go after them.  finish()
+ * marks it done.
+ *
+ * Stations marked inOrder are not sent anything until every station before
+ * them is finished, for stations that need a whole exchange done in one go.
+ */
+class StationScheduler {
+ public:
+    /**
+     * @brief Where each station stands
+     */
+    typedef enum : uint8_t {
+        stationDue = 0,  ///< A request needs to be sent
+        stationWaiting,  ///< A request is in flight
+        stationHeld,     ///< Everything is in, waiting on stations before it
+        stationFinished  ///< Done for this cycle
+    } stationStatus;
+
+    /**
+     * @brief Construct a new station scheduler
+     *
+     * @param slots One slot per station, in the order they should finish
+     * @param stationCount The number of stations
+     * @param maxInFlight The most requests to have outstanding at once
+     * @param firstBackoffMs How long to wait before the first retry; it
+     * doubles with each retry after that.  A retry is never due later than
+     * the request it repeats would have timed out.
+     * @param maxBackoffMs The longest to ever wait between retries
+     */
+    StationScheduler(stationSlot* slots, uint8_t stationCount,
+                     uint8_t maxInFlight = 3, uint32_t firstBackoffMs = 2000,
+                     uint32_t maxBackoffMs = 60000);
+
+    /**
+     * @brief Set the address of a station's XBee
+     *
+     * @param station The station's index
+     * @param address64 The 8 byte address, which must stay valid
+     */
+    void setAddress(uint8_t station, const uint8_t* address64);
+    /**
+     * @brief Set whether requests to a station wait until every station
+     * before it is finished
+     *
+     * @param station The station's index
+     * @param inOrder True to wait for its turn
+     */
+    void setInOrder(uint8_t station, bool inOrder);
+
+    /**
+     * @brief Start a new collection cycle with every station due right away
+     *
+     * @param nowMs The current time in milliseconds
+     */
+    void begin(uint32_t nowMs);
+    /**
+     * @brief Hold off the first request to a station until its slot opens
+     *
+     * Call this right after begin().  Stations that aren't given a time are
+     * due right away.
+     *
+     * @param station The station's index
+     * @param dueMs When the first request is due, in milliseconds
+     */
+    void startAt(uint8_t station, uint32_t dueMs);
+
+    /**
+     * @brief Find the next station that needs a request sent
+     *
+     * Stations are taken in order, so the farthest station is always asked
+     * first, and nothing is returned while maxInFlight requests are out.
+     *
+     * @param nowMs The current time in milliseconds
+     * @return **int8_t** The station's index, or -1 if none are due
+     */
+    int8_t nextDue(uint32_t nowMs) const;
+    /**
+     * @brief Record that a request went out to a station
+     *
+     * @param station The station's index
+     * @param nowMs The current time in milliseconds
+     * @param timeoutMs How long to wait for the answer
+     * @return **uint8_t** The frame ID to send the request with; it is never 0
+     * so the XBee always reports back whether the request was delivered
+     */
+    uint8_t sent(uint8_t station, uint32_t nowMs, uint32_t timeoutMs);
+
+    /**
+     * @brief Work out which station a frame belongs to
+     *
+     * @param decoder The decoder holding the frame
+     * @return **int8_t** The station's index, or -1 if it isn't from any of
+     * them
+     */
+    int8_t stationFor(const XBeeFrameDecoder& decoder) const;
+    /**
+     * @brief Check whether a frame is a transmit status saying a station's
+     * request never got there
+     *
+     * @param station The station's index
+     * @param decoder The decoder holding the frame
+     */
+    bool deliveryFailed(uint8_t station,
+                        const XBeeFrameDecoder& decoder) const;
+
+    /**
+     * @brief Record that a station answered and the next request is due
+     *
+     * @param station The station's index
+     * @param nowMs The current time in milliseconds
+     */
+    void answered(uint8_t station, uint32_t nowMs);
+    /**
+     * @brief Keep waiting on a station that is partway through answering
+     *
+     * @param station The station's index
+     * @param nowMs The current time in milliseconds
+     * @param timeoutMs How much longer to wait
+     */
+    void extend(uint8_t station, uint32_t nowMs, uint32_t timeoutMs);
+
+    /**
+     * @brief Find a station whose request has run out of time
+     *
+     * @param nowMs The current time in milliseconds
+     * @return **int8_t** The station's index, or -1 if none have
+     */
+    int8_t nextExpired(uint32_t nowMs) const;
+    /**
+     * @brief Schedule the same request again after a backoff
+     *
+     * The backoff is cut short where it would run past the time the request
+     * in flight times out, so a request that timed out is due again right
+     * away.  Trying a station maxTries times never takes longer than maxTries
+     * timeouts.
+     *
+     * @param station The station's index
+     * @param nowMs The current time in milliseconds
+     * @param maxTries The most times this request may be tried
+     * @return **bool** True if it will be tried again.  False if it has been
+     * tried maxTries times; the station is then due right away with its tries
+     * and backoff cleared, ready for whatever the sketch does next.
+     */
+    bool retry(uint8_t station, uint32_t nowMs, uint8_t maxTries);
+    /**
+     * @brief Record that a station's request timed out or was not delivered
+     * when it will not be tried again.  The sketch should follow this with
+     * hold() or another request.
+     *
+     * @param station The station's index
+     * @param nowMs The current time in milliseconds
+     */
+    void failed(uint8_t station, uint32_t nowMs);
+
+    /**
+     * @brief Mark a station as having everything, waiting to be let go
+     *
+     * @param station The station's index
+     */
+    void hold(uint8_t station);
+    /**
+     * @brief Check whether every station before this one is finished
+     *
+     * @param station The station's index
+     */
+    bool canRelease(uint8_t station) const;
+    /**
+     * @brief Mark a station as done for this cycle
+     *
+     * @param station The station's index
+     */
+    void finish(uint8_t station);
+
+    /**
+     * @brief Get where a station stands
+     *
+     * @param station The station's index
+     */
+    stationStatus status(uint8_t station) const {
+        return static_cast<stationStatus>(_slots[station].status);
+    }
+    /**
+     * @brief Check whether every station is done for this cycle
+     */
+    bool allFinished(void) const;
+    /**
+     * @brief Get the number of requests currently in flight
+     */
+    uint8_t inFlight(void) const;
+
+    /**
+     * @brief The time the last answered request took, in milliseconds
+     */
+    uint32_t lastLatencyMs;
+    /**
+     * @brief The longest an answered request took, in milliseconds
+     */
+    uint32_t maxLatencyMs;
+    /**
+     * @brief The total time of all answered requests, in milliseconds
+     */
+    uint32_t totalLatencyMs;
+    /**
+     * @brief The number of answered requests
+     */
+    uint16_t exchanges;
+    /**
+     * @brief The number of requests that timed out or were not delivered
+     */
+    uint16_t timeouts;
+
+    /**
+     * @brief Get the average time of the answered requests
+     *
+     * @return **uint32_t** The average latency in milliseconds, or 0 if there
+     * have been none.
+     */
+    uint32_t averageLatencyMs(void) const;
+
+ private:
+    static bool isDue(uint32_t dueMs, uint32_t nowMs);
+
+    stationSlot* _slots;
+    uint8_t      _stationCount;
+    uint8_t      _maxInFlight;
+    uint32_t     _firstBackoffMs;
+    uint32_t     _maxBackoffMs;
+    uint8_t      _lastFrameId;
+};
+
+#endif  // SRC_STATIONSCHEDULER_H_
@@ -0,0 +1,261 @@
+/**
+ * @file XBeeFrame.cpp
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Implements the XBeeFrameEncoder and XBeeFrameDecoder classes.
+ */
+
+#include "XBeeFrame.h"
+
+// In API mode 2 these bytes have to be escaped anywhere after the start
+// delimiter, including the length and the checksum.
+static bool needsEscape(uint8_t data) {
+    return data == XBEE_START_DELIMITER || data == XBEE_ESCAPE ||
+        data == 0x11 || data == 0x13;
+}
+
+
+// ============================================================================
+//  XBeeFrameEncoder
+// ============================================================================
+
+XBeeFrameEncoder::XBeeFrameEncoder(uint8_t* buffer, uint16_t bufferSize,
+                                   bool escaped)
+    : _buffer(buffer),
+      _bufferSize(bufferSize),
+      _escaped(escaped),
+      _length(0),
+      _remaining(0),
+      _sum(0),
+      _error(false),
+      _complete(false) {}
+
+
+bool XBeeFrameEncoder::put(uint8_t data) {
+    if (_escaped && _length > 0 && needsEscape(data)) {
+        if (_length + 2 > _bufferSize) {
+            _error = true;
+            return false;
+        }
+        _buffer[_length++] = XBEE_ESCAPE;
+        _buffer[_length++] = data ^ 0x20;
+        return true;
+    }
+    if (_length + 1 > _bufferSize) {
+        _error = true;
+        return false;
+    }
+    _buffer[_length++] = data;
+    return true;
+}
+
+
+bool XBeeFrameEncoder::beginFrame(uint8_t frameType, uint16_t dataLength) {
+    _length   = 0;
+    _sum      = 0;
+    _error    = false;
+    _complete = false;
+
+    // The length field counts the frame type along with the frame data
+    uint16_t frameLength = dataLength + 1;
+    // An unescaped frame is the delimiter, two length bytes, the frame type,
+    // the data, and the checksum.  Catch frames that can never fit up front
+    // rather than half building them.
+    if (_buffer == NULL || frameLength < dataLength ||
+        static_cast<uint32_t>(frameLength) + 4 > _bufferSize) {
+        _error = true;
+        return false;
+    }
+
+    put(XBEE_START_DELIMITER);
+    put(static_cast<uint8_t>(frameLength >> 8));
+    put(static_cast<uint8_t>(frameLength & 0xFF));
+    _remaining = frameLength;
+    return append(frameType);
+}
+
+
+bool XBeeFrameEncoder::beginTransmitRequest(const uint8_t* address64,
+                                            const uint8_t* address16,
+                                            uint16_t       payloadLength,
+                                            uint8_t        frameId,
+                                            uint8_t        broadcastRadius,
+                                            uint8_t        options) {
+    if (!beginFrame(XBEE_TRANSMIT_REQUEST,
+                    XBEE_TRANSMIT_HEADER_SIZE - 1 + payloadLength)) {
+        return false;
+    }
+    append(frameId);
+    append(address64, 8);
+    append(address16, 2);
+    append(broadcastRadius);
+    return append(options);
+}
+
+
+uint16_t XBeeFrameEncoder::transmitRequest(
+    const uint8_t* address64, const uint8_t* address16, const uint8_t* payload,
+    uint16_t payloadLength, uint8_t frameId, uint8_t broadcastRadius,
+    uint8_t options) {
+    if (!beginTransmitRequest(address64, address16, payloadLength, frameId,
+                              broadcastRadius, options)) {
+        return 0;
+    }
+    append(payload, payloadLength);
+    return endFrame();
+}
+
+
+bool XBeeFrameEncoder::append(uint8_t data) {
+    if (_error || _complete || _remaining == 0) {
+        _error = true;
+        return false;
+    }
+    if (!put(data)) return false;
+    _sum += data;
+    _remaining--;
+    return true;
+}
+
+
+bool XBeeFrameEncoder::append(const uint8_t* data, uint16_t count) {
+    if (data == NULL && count > 0) {
+        _error = true;
+        return false;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        if (!append(data[i])) return false;
+    }
+    return true;
+}
+
+
+uint16_t XBeeFrameEncoder::endFrame(void) {
+    if (_error || _complete || _remaining != 0) {
+        _error = true;
+        return 0;
+    }
+    if (!put(0xFF - _sum)) return 0;
+    _complete = true;
+    return _length;
+}
+
+
+// ============================================================================
+//  XBeeFrameDecoder
+// ============================================================================
+
+XBeeFrameDecoder::XBeeFrameDecoder(uint8_t* buffer, uint16_t bufferSize,
+                                   bool escaped)
+    : framesDecoded(0),
+      checksumErrors(0),
+      overflows(0),
+      _buffer(buffer),
+      _bufferSize(bufferSize),
+      _escaped(escaped),
+      _unescapeNext(false),
+      _state(waitForStart),
+      _expected(0),
+      _received(0),
+      _length(0),
+      _sum(0) {}
+
+
+void XBeeFrameDecoder::reset(void) {
+    _state        = waitForStart;
+    _unescapeNext = false;
+    _expected     = 0;
+    _received     = 0;
+    _length       = 0;
+    _sum          = 0;
+}
+
+
+XBeeFrameDecoder::decodeStatus XBeeFrameDecoder::feed(uint8_t incoming) {
+    // A completed frame is only valid until the next byte arrives
+    _length = 0;
+
+    if (incoming == XBEE_START_DELIMITER && (_escaped || _state == waitForStart)) {
+        // In escaped mode a bare delimiter can only ever start a frame, so use
+        // it to resynchronize even in the middle of a broken frame.
+        reset();
+        _state = lengthHigh;
+        return incomplete;
+    }
+    if (_state == waitForStart) return incomplete;
+
+    if (_escaped) {
+        if (incoming == XBEE_ESCAPE) {
+            _unescapeNext = true;
+            return incomplete;
+        }
+        if (_unescapeNext) {
+            incoming ^= 0x20;
+            _unescapeNext = false;
+        }
+    }
+
+    switch (_state) {
+        case lengthHigh:
+            _expected = static_cast<uint16_t>(incoming) << 8;
+            _state    = lengthLow;
+            break;
+        case lengthLow:
+            _expected |= incoming;
+            _received = 0;
+            _sum      = 0;
+            if (_expected == 0) {
+                // Nothing a radio sends is this short, so it was noise
+                _state = waitForStart;
+            } else if (_expected > _bufferSize) {
+                overflows++;
+                _state = waitForStart;
+                return frameOverflow;
+            } else {
+                _state = frameBody;
+            }
+            break;
+        case frameBody:
+            _buffer[_received++] = incoming;
+            _sum += incoming;
+            if (_received == _expected) _state = checksum;
+            break;
+        case checksum:
+            _state = waitForStart;
+            if (static_cast<uint8_t>(_sum + incoming) != 0xFF) {
+                checksumErrors++;
+                return checksumError;
+            }
+            _length = _received;
+            framesDecoded++;
+            return frameReady;
+        default: _state = waitForStart; break;
+    }
+    return incomplete;
+}
+
+
+bool XBeeFrameDecoder::isReceivePacket(void) const {
+    return _length >= XBEE_RECEIVE_HEADER_SIZE &&
+        _buffer[0] == XBEE_RECEIVE_PACKET;
+}
+
+
+bool XBeeFrameDecoder::isFrom(const uint8_t* address64) const {
+    if (!isReceivePacket() || address64 == NULL) return false;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (_buffer[1 + i] != address64[i]) return false;
+    }
+    return true;
+}
+
+
+uint16_t XBeeFrameDecoder::rfDataLength(void) const {
+    return isReceivePacket() ? _length - XBEE_RECEIVE_HEADER_SIZE : 0;
+}
+
+
+bool XBeeFrameDecoder::isTransmitStatus(void) const {
+    return _length >= 7 && _buffer[0] == XBEE_TRANSMIT_STATUS;
+}
@@ -0,0 +1,335 @@
+/**
+ * @file XBeeFrame.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the XBeeFrameEncoder and XBeeFrameDecoder classes for
+ * building and parsing XBee API frames without any dynamic allocation.
+ *
+ * Both classes work on a buffer supplied by the caller and never touch a
+ * serial port themselves, so the same code runs on the Mayfly and on a
+ * desktop computer fed with recorded byte streams.
+ */
+
+// Header Guards
+#ifndef SRC_XBEEFRAME_H_
+#define SRC_XBEEFRAME_H_
+
+// Included Dependencies
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * @brief The API frame types used by the snow sensing radio network.
+ */
+typedef enum : uint8_t {
+    /// A message from the Mayfly to be sent over the air (0x10)
+    XBEE_TRANSMIT_REQUEST = 0x10,
+    /// The local XBee's report on whether a transmit request arrived (0x8B)
+    XBEE_TRANSMIT_STATUS = 0x8B,
+    /// A message that arrived over the air from another XBee (0x90)
+    XBEE_RECEIVE_PACKET = 0x90,
+} xbeeFrameType;
+
+/// The byte that starts every API frame
+#define XBEE_START_DELIMITER 0x7E
+/// The byte that marks an escaped byte in API mode 2 (AP=2)
+#define XBEE_ESCAPE 0x7D
+/// The number of frame data bytes in a transmit request before the payload
+#define XBEE_TRANSMIT_HEADER_SIZE 14
+/// The number of frame data bytes in a receive packet before the payload
+#define XBEE_RECEIVE_HEADER_SIZE 12
+/// The broadcast address for the 64-bit address field
+#define XBEE_BROADCAST_ADDRESS \
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF }
+
+
+/**
+ * @brief Builds XBee API frames directly into a caller supplied buffer.
+ *
+ * A frame is started with beginFrame() (or one of the transmit request
+ * helpers), filled with append(), and closed with endFrame(), which adds the
+ * checksum.  The length field is written from the size given up front, so
+ * there is no need to stage the payload anywhere else first.  When the radio
+ * is in API mode 2 (AP=2) every byte after the start delimiter that needs it is
+ * escaped as it is written.
+ *
+ * The finished frame is available from frame() and length() until the next
+ * frame is started.
+ */
+class XBeeFrameEncoder {
+ public:
+    /**
+     * @brief Construct a new XBee frame encoder
+     *
+     * @param buffer Where frames are built
+     * @param bufferSize The number of bytes in the buffer
+     * @param escaped True if the radio is in API mode 2 (AP=2)
+     */
+    XBeeFrameEncoder(uint8_t* buffer, uint16_t bufferSize,
+                     bool escaped = false);
+
+    /**
+     * @brief Start a new frame of any type
+     *
+     * @param frameType The API frame type
+     * @param dataLength The number of frame data bytes that will follow the
+     * frame type
+     * @return **bool** True if the frame has room in the buffer.
+     */
+    bool beginFrame(uint8_t frameType, uint16_t dataLength);
+
+    /**
+     * @brief Start a transmit request (0x10) frame.  The payload itself must
+     * follow with append().
+     *
+     * @param address64 The 8 byte destination address
+     * @param address16 The 2 byte network address, usually FF FE
+     * @param payloadLength The number of payload bytes that will follow
+     * @param frameId The frame ID; use 0 to stop the XBee from sending back a
+     * transmit status frame
+     * @param broadcastRadius The maximum number of hops, 0 for the maximum
+     * @param options The transmit options, normally 0
+     * @return **bool** True if the frame has room in the buffer.
+     */
+    bool beginTransmitRequest(const uint8_t* address64,
+                              const uint8_t* address16,
+                              uint16_t payloadLength, uint8_t frameId = 0,
+                              uint8_t broadcastRadius = 0,
+                              uint8_t options = 0);
+
+    /**
+     * @brief Build a complete transmit request (0x10) frame in one call.
+     *
+     * @param address64 The 8 byte destination address
+     * @param address16 The 2 byte network address, usually FF FE
+     * @param payload The bytes to send over the air
+     * @param payloadLength The number of payload bytes
+     * @param frameId The frame ID; use 0 to stop the XBee from sending back a
+     * transmit status frame
+     * @param broadcastRadius The maximum number of hops, 0 for the maximum
+     * @param options The transmit options, normally 0
+     * @return **uint16_t** The total number of bytes in the finished frame, or
+     * 0 if it did not fit in the buffer.
+     */
+    uint16_t transmitRequest(const uint8_t* address64, const uint8_t* address16,
+                             const uint8_t* payload, uint16_t payloadLength,
+                             uint8_t frameId = 0, uint8_t broadcastRadius = 0,
+                             uint8_t options = 0);
+
+    /**
+     * @brief Add one byte to the frame data
+     *
+     * @param data The byte to add
+     * @return **bool** True if it was added.
+     */
+    bool append(uint8_t data);
+    /**
+     * @brief Add a run of bytes to the frame data
+     *
+     * @param data The bytes to add
+     * @param count The number of bytes to add
+     * @return **bool** True if they were all added.
+     */
+    bool append(const uint8_t* data, uint16_t count);
+
+    /**
+     * @brief Finish the frame by adding the checksum
+     *
+     * @return **uint16_t** The total number of bytes in the finished frame, or
+     * 0 if the frame overflowed the buffer or was not given exactly the number
+     * of bytes promised in beginFrame().
+     */
+    uint16_t endFrame(void);
+
+    /**
+     * @brief Get the finished frame
+     *
+     * @return **const uint8_t*** The frame, starting with the delimiter
+     */
+    const uint8_t* frame(void) const {
+        return _buffer;
+    }
+    /**
+     * @brief Get the size of the finished frame
+     *
+     * @return **uint16_t** The number of bytes to write to the radio, or 0 if
+     * there is no finished frame.
+     */
+    uint16_t length(void) const {
+        return _complete ? _length : 0;
+    }
+
+ private:
+    bool put(uint8_t data);
+
+    uint8_t* _buffer;
+    uint16_t _bufferSize;
+    bool     _escaped;
+    uint16_t _length;
+    uint16_t _remaining;
+    uint8_t  _sum;
+    bool     _error;
+    bool     _complete;
+};
+
+
+/**
+ * @brief Reassembles XBee API frames one byte at a time.
+ *
+ * Feed every byte read from the radio's serial port to feed().  It returns
+ * frameReady once a whole frame has arrived and its checksum is good; the
+ * frame data (the frame type followed by everything up to the checksum) is
+ * then available from the accessors until the next byte is fed.  Bytes before
+ * a start delimiter are skipped, and frames with a bad checksum or that do not
+ * fit in the buffer are dropped and counted.
+ */
+class XBeeFrameDecoder {
+ public:
+    /**
+     * @brief What happened with the byte just fed to the decoder
+     */
+    typedef enum : uint8_t {
+        incomplete = 0,  ///< Still waiting for the rest of a frame
+        frameReady,      ///< A whole, checksum-valid frame is available
+        checksumError,   ///< A whole frame arrived but its checksum was bad
+        frameOverflow,   ///< The frame was too big for the buffer
+    } decodeStatus;
+
+    /**
+     * @brief Construct a new XBee frame decoder
+     *
+     * @param buffer Where the frame data is reassembled
+     * @param bufferSize The number of bytes in the buffer; this limits the
+     * largest frame that can be received
+     * @param escaped True if the radio is in API mode 2 (AP=2)
+     */
+    XBeeFrameDecoder(uint8_t* buffer, uint16_t bufferSize,
+                     bool escaped = false);
+
+    /**
+     * @brief Throw away any partly received frame and wait for the next start
+     * delimiter.
+     */
+    void reset(void);
+
+    /**
+     * @brief Feed the decoder the next byte from the radio
+     *
+     * @param incoming The byte
+     * @return **decodeStatus** What the byte completed, if anything.
+     */
+    decodeStatus feed(uint8_t incoming);
+
+    /**
+     * @brief Get the type of the last completed frame
+     *
+     * @return **uint8_t** The API frame type, or 0 if there is none
+     */
+    uint8_t frameType(void) const {
+        return _length > 0 ? _buffer[0] : 0;
+    }
+    /**
+     * @brief Get the data of the last completed frame
+     *
+     * @return **const uint8_t*** The frame type followed by the frame data
+     */
+    const uint8_t* frameData(void) const {
+        return _buffer;
+    }
+    /**
+     * @brief Get the size of the last completed frame
+     *
+     * @return **uint16_t** The number of bytes from the frame type up to, but
+     * not including, the checksum
+     */
+    uint16_t frameLength(void) const {
+        return _length;
+    }
+
+    /**
+     * @brief Check if the last completed frame is a receive packet (0x90)
+     */
+    bool isReceivePacket(void) const;
+    /**
+     * @brief Get the 8 byte address of the XBee that sent a receive packet
+     */
+    const uint8_t* sourceAddress64(void) const {
+        return _buffer + 1;
+    }
+    /**
+     * @brief Check if a receive packet came from the given 8 byte address
+     *
+     * @param address64 The address to compare against
+     */
+    bool isFrom(const uint8_t* address64) const;
+    /**
+     * @brief Get the payload of a receive packet
+     */
+    const uint8_t* rfData(void) const {
+        return _buffer + XBEE_RECEIVE_HEADER_SIZE;
+    }
+    /**
+     * @brief Get the number of payload bytes in a receive packet
+     */
+    uint16_t rfDataLength(void) const;
+
+    /**
+     * @brief Check if the last completed frame is a transmit status (0x8B)
+     */
+    bool isTransmitStatus(void) const;
+    /**
+     * @brief Get the frame ID of the transmit request a transmit status is
+     * reporting on
+     */
+    uint8_t statusFrameId(void) const {
+        return _buffer[1];
+    }
+    /**
+     * @brief Get the number of retries the XBee needed for a transmit request
+     */
+    uint8_t transmitRetryCount(void) const {
+        return _buffer[4];
+    }
+    /**
+     * @brief Get the delivery status of a transmit request; 0 means success
+     */
+    uint8_t deliveryStatus(void) const {
+        return _buffer[5];
+    }
+
+    /**
+     * @brief The number of checksum-valid frames decoded
+     */
+    uint16_t framesDecoded;
+    /**
+     * @brief The number of frames dropped for a bad checksum
+     */
+    uint16_t checksumErrors;
+    /**
+     * @brief The number of frames dropped for being too big for the buffer
+     */
+    uint16_t overflows;
+
+ private:
+    typedef enum : uint8_t {
+        waitForStart = 0,
+        lengthHigh,
+        lengthLow,
+        frameBody,
+        checksum,
+    } decodeState;
+
+    uint8_t*    _buffer;
+    uint16_t    _bufferSize;
+    bool        _escaped;
+    bool        _unescapeNext;
+    decodeState _state;
+    uint16_t    _expected;
+    uint16_t    _received;
+    uint16_t    _length;
+    uint8_t     _sum;
+};
+
+#endif  // SRC_XBEEFRAME_H_
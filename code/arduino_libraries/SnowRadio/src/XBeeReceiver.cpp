@@ -0,0 +1,82 @@
+/**
+ * @file XBeeReceiver.cpp
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Implements the XBeeReceiver class.
+ */
+
+#include "XBeeReceiver.h"
+
+
+XBeeReceiver::XBeeReceiver(XBeeFrameDecoder& decoder)
+    : _decoder(decoder),
+      _address64(NULL),
+      _frameId(0),
+      _startMs(0),
+      _timeoutMs(0),
+      _status(idle) {
+    resetStats();
+}
+
+
+void XBeeReceiver::expect(const uint8_t* address64, uint8_t frameId,
+                          uint32_t timeoutMs, uint32_t nowMs) {
+    _address64 = address64;
+    _frameId   = frameId;
+    _startMs   = nowMs;
+    _timeoutMs = timeoutMs;
+    _status    = waiting;
+}
+
+
+void XBeeReceiver::cancel(void) {
+    _status = idle;
+}
+
+
+XBeeReceiver::receiveStatus XBeeReceiver::checkFrame(uint32_t nowMs) {
+    if (_decoder.isReceivePacket() && _decoder.rfDataLength() > 0 &&
+        (_address64 == NULL || _decoder.isFrom(_address64))) {
+        // Subtracting start times keeps this right when millis() rolls over
+        lastLatencyMs = nowMs - _startMs;
+        if (exchanges == 0 || lastLatencyMs < minLatencyMs) {
+            minLatencyMs = lastLatencyMs;
+        }
+        if (lastLatencyMs > maxLatencyMs) maxLatencyMs = lastLatencyMs;
+        totalLatencyMs += lastLatencyMs;
+        exchanges++;
+        _status = received;
+    } else if (_frameId != 0 && _decoder.isTransmitStatus() &&
+               _decoder.statusFrameId() == _frameId &&
+               _decoder.deliveryStatus() != 0x00) {
+        deliveryFailures++;
+        _status = deliveryFailed;
+    }
+    return _status;
+}
+
+
+XBeeReceiver::receiveStatus XBeeReceiver::checkDeadline(uint32_t nowMs) {
+    if (_status == waiting && nowMs - _startMs >= _timeoutMs) {
+        timeouts++;
+        _status = timedOut;
+    }
+    return _status;
+}
+
+
+uint32_t XBeeReceiver::averageLatencyMs(void) const {
+    return exchanges > 0 ? totalLatencyMs / exchanges : 0;
+}
+
+
+void XBeeReceiver::resetStats(void) {
+    lastLatencyMs    = 0;
+    minLatencyMs     = 0;
+    maxLatencyMs     = 0;
+    totalLatencyMs   = 0;
+    exchanges        = 0;
+    timeouts         = 0;
+    deliveryFailures = 0;
+}
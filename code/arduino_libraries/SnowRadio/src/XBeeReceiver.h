@@ -0,0 +1,163 @@
+/**
+ * @file XBeeReceiver.h
+ * @copyright 2025 Utah State University
+ * Part of the SnowRadio library for the CIROH snow sensing stations
+ *
+ * @brief Contains the XBeeReceiver class, a non-blocking engine for waiting on
+ * the answer to a radio message.
+ *
+ * The receiver never reads a clock itself; the time in milliseconds is passed
+ * in with every call.  On the Mayfly that is millis(), and on a desktop it can
+ * be any simulated clock, so the timing can be checked against a recorded or
+ * made up stream of bytes.
+ */
+
+// Header Guards
+#ifndef SRC_XBEERECEIVER_H_
+#define SRC_XBEERECEIVER_H_
+
+// Included Dependencies
+#include "XBeeFrame.h"
+
+
+/**
+ * @brief Waits on one radio exchange at a time without blocking.
+ *
+ * Start an exchange with expect() right after sending a message, then call
+ * poll() as often as you like with the serial port the XBee is attached to.
+ * Each call hands whatever bytes are waiting to the XBeeFrameDecoder and
+ * returns straight away.  The exchange finishes when a whole, checksum-valid
+ * receive packet arrives (from the expected address, if one was given), when
+ * the XBee reports that the message being answered was never delivered, or
+ * when the deadline passes.
+ *
+ * The time each successful exchange took is kept in a set of latency counters
+ * so the radio link can be checked in the field.
+ */
+class XBeeReceiver {
+ public:
+    /**
+     * @brief Where the current exchange stands
+     */
+    typedef enum : uint8_t {
+        idle = 0,        ///< No exchange has been started
+        waiting,         ///< Still waiting for an answer
+        received,        ///< A receive packet is ready in the decoder
+        deliveryFailed,  ///< The XBee could not deliver the message
+        timedOut,        ///< The deadline passed with no answer
+    } receiveStatus;
+
+    /**
+     * @brief Construct a new XBee receiver
+     *
+     * @param decoder The decoder that puts the incoming frames back together
+     */
+    explicit XBeeReceiver(XBeeFrameDecoder& decoder);
+
+    /**
+     * @brief Start waiting for an answer
+     *
+     * @param address64 The 8 byte address the answer must come from, or NULL
+     * to accept a receive packet from anyone
+     * @param frameId The frame ID of the transmit request being answered, so a
+     * failed transmit status can end the exchange early; 0 to ignore transmit
+     * status frames
+     * @param timeoutMs How long to wait, in milliseconds
+     * @param nowMs The current time in milliseconds
+     */
+    void expect(const uint8_t* address64, uint8_t frameId, uint32_t timeoutMs,
+                uint32_t nowMs);
+
+    /**
+     * @brief Read whatever the serial port has waiting and check the deadline.
+     *
+     * Bytes are only read up to the end of the frame that finishes the
+     * exchange; anything after that is left in the port for the next one.
+     *
+     * @tparam PortType Anything with int available() and int read(), such as
+     * a HardwareSerial or a simulated port on a desktop
+     * @param port The serial port the XBee is attached to
+     * @param nowMs The current time in milliseconds
+     * @return **receiveStatus** Where the exchange stands
+     */
+    template <typename PortType>
+    receiveStatus poll(PortType& port, uint32_t nowMs) {
+        if (_status != waiting) return _status;
+        while (port.available() > 0) {
+            int incoming = port.read();
+            if (incoming < 0) break;
+            if (_decoder.feed(static_cast<uint8_t>(incoming)) ==
+                XBeeFrameDecoder::frameReady) {
+                if (checkFrame(nowMs) != waiting) return _status;
+            }
+        }
+        return checkDeadline(nowMs);
+    }
+
+    /**
+     * @brief Get where the current exchange stands without reading anything
+     */
+    receiveStatus status(void) const {
+        return _status;
+    }
+
+    /**
+     * @brief Give up on the current exchange
+     */
+    void cancel(void);
+
+    /**
+     * @brief The time the last successful exchange took, in milliseconds
+     */
+    uint32_t lastLatencyMs;
+    /**
+     * @brief The shortest successful exchange, in milliseconds
+     */
+    uint32_t minLatencyMs;
+    /**
+     * @brief The longest successful exchange, in milliseconds
+     */
+    uint32_t maxLatencyMs;
+    /**
+     * @brief The total time of all successful exchanges, in milliseconds
+     */
+    uint32_t totalLatencyMs;
+    /**
+     * @brief The number of successful exchanges
+     */
+    uint16_t exchanges;
+    /**
+     * @brief The number of exchanges that ran out of time
+     */
+    uint16_t timeouts;
+    /**
+     * @brief The number of exchanges ended by a failed transmit status
+     */
+    uint16_t deliveryFailures;
+
+    /**
+     * @brief Get the average time of the successful exchanges
+     *
+     * @return **uint32_t** The average latency in milliseconds, or 0 if there
+     * have been none.
+     */
+    uint32_t averageLatencyMs(void) const;
+
+    /**
+     * @brief Set all of the latency counters back to zero
+     */
+    void resetStats(void);
+
+ private:
+    receiveStatus checkFrame(uint32_t nowMs);
+    receiveStatus checkDeadline(uint32_t nowMs);
+
+    XBeeFrameDecoder& _decoder;
+    const uint8_t*    _address64;
+    uint8_t           _frameId;
+    uint32_t          _startMs;
+    uint32_t          _timeoutMs;
+    receiveStatus     _status;
+};
+
+#endif  // SRC_XBEERECEIVER_H_
@@ -40,12 +40,20 @@
 
 // Include the main header for ModularSensors
 #include <ModularSensors.h>
+// Reads HydroServer's responses as they come in
+#include <HttpResponseReader.h>
 
 // This helps manage I2C functionality
 #include <Wire.h>
 
 #include <AltSoftSerial.h>
 
+// Keeps the observations waiting to be published on the SD card (found in the SnowRadio library folder)
+#include <SdFat.h>
+#include <MeasurementRecord.h>
+#include <RecordQueue.h>
+#include <SdRecordStore.h>
+
 AltSoftSerial mySerial(6, -1);
 
 
@@ -63,6 +71,8 @@ const int8_t  redLED     = 9;
 const int8_t  buttonPin  = 21;
 // MCU interrupt/alarm pin to wake from sleep (don't change)
 const int8_t  wakePin    = 31;
+// MCU SPI pin for the SD card's chip select (don't change)
+const int8_t  sdCardPin  = 12;
 
 
 // ==========================================================================
@@ -105,13 +115,44 @@ const char delimeter = ';';
 
 const int txBufferLTEsize = 750;
 char txBufferLTE[txBufferLTEsize];
+int txBufferLTELength = 0;  // The number of characters in txBufferLTE
 
 // Prints the transmit buffer for the LTE modem over a Stream
 void printLTEBuffer(Stream* stream) {
-  Serial.println(txBufferLTE);
-  stream->write(txBufferLTE, strlen(txBufferLTE));
+  Serial.write(txBufferLTE, txBufferLTELength);
+  Serial.println();
+  stream->write(txBufferLTE, txBufferLTELength);
   stream->flush();
-  for (int i = 0; i < txBufferLTEsize; i++) { txBufferLTE[i] = '\0'; }
+  txBufferLTELength = 0;
+}
+
+/*
+These add to the transmit buffer, sending it to the server whenever it fills up.
+The buffer's length is kept in txBufferLTELength, so nothing has to count the
+characters already in it.
+*/
+void addToLTEBuffer(const char* text, int length) {
+  while (length > 0) {
+    if (txBufferLTELength == txBufferLTEsize) printLTEBuffer(&modem.gsmClient);
+    int room = txBufferLTEsize - txBufferLTELength;
+    int piece = length < room ? length : room;
+    memcpy(txBufferLTE + txBufferLTELength, text, piece);
+    txBufferLTELength += piece;
+    text += piece;
+    length -= piece;
+  }
+}
+
+void addToLTEBuffer(const char* text) {
+  while (*text != '\0') {
+    if (txBufferLTELength == txBufferLTEsize) printLTEBuffer(&modem.gsmClient);
+    txBufferLTE[txBufferLTELength++] = *text++;
+  }
+}
+
+void addToLTEBuffer(char c) {
+  if (txBufferLTELength == txBufferLTEsize) printLTEBuffer(&modem.gsmClient);
+  txBufferLTE[txBufferLTELength++] = c;
 }
 
 
@@ -136,17 +177,89 @@ const char* authorizationHeader      = "\r\nAuthorization: Basic ";
 const char* contentLengthHeader      = "\r\nContent-Length: ";
 const char* contentTypeHeader        = "\r\nContent-Type: application/json\r\n\r\n";
 
+// The longest to wait for HydroServer to answer a request (ms). The response is read as it comes in,
+// so this is only how long to give up after; a quick answer is done with as soon as it's in.
+const uint32_t responseTimeout = 10000;
+// Reads each response, and tells whether the server will keep the connection open for the next request
+HttpResponseReader response;
+
 // JSON tags
 const char* datastreamTag = "\"Datastream\":";
 const char* iotTag        = "\"@iot.id\":";
 const char* componentsTag = "\"components\":[\"phenomenonTime\",\"result\"],";
 const char* dataArrayTag  = "\"dataArray\":";
 
+// ==========================================================================
+// Gathering observations to publish together
+// ==========================================================================
+// How many radio cycles' worth of station strings to gather before publishing
+// them all at once. Each session with the modem (waking it, attaching to the
+// network, and connecting) costs far more time and energy than the data, so
+// raising this saves power at the cost of the data showing up later.
+const int cyclesPerPost = 1;
+// How long the Base Mayfly has to be quiet after a station string before the
+// radio cycle is considered over (ms)
+const uint32_t cycleQuietTime = 30000;
+// The most characters the JSON body of a single request may hold. If the
+// gathered observations need more, they are split by datastream across more
+// than one request in the same session.
+const uint16_t maxBodySize = 6000;
+
+// The observations are kept by datastream, and each one points at its
+// datastream UUID and timestamp rather than holding its own copy of them
+const int maxDatastreams = 40;
+const int maxTimestamps = 8;
+const int maxObservations = 80;
+String datastreams[maxDatastreams];  // The UUIDs of the datastreams seen so far
+int datastreamCount = 0;
+String timestamps[maxTimestamps];  // The timestamps seen so far
+int timestampCount = 0;
+uint8_t obsDatastream[maxObservations];  // Which datastream each observation is for
+uint8_t obsTimestamp[maxObservations];  // Which timestamp each observation is for
+String obsValue[maxObservations];  // The result of each observation
+uint32_t obsSeq[maxObservations];  // Where each observation is in the outbox (0 if it isn't)
+bool obsDone[maxObservations];  // Whether each observation has been dealt with and can be forgotten
+int observationCount = 0;
+
+
+// ==========================================================================
+// The outbox of observations waiting to be published
+// ==========================================================================
+// At the end of each radio cycle, the observations gathered are saved to a queue file on the SD card
+// (the outbox). They are only let go of once HydroServer has answered a request holding them with a
+// 2xx response code, so anything that can't be published (no signal, the server being down, an error
+// response) is tried again later instead of being lost. If the SD card can't be used, the observations
+// are kept in memory instead, which holds far fewer of them.
+const uint16_t outboxSlots = 168;  // The number of observations the outbox holds; once it is full, the oldest is written over
+// The most observations sent in one session with the modem. A long backlog after an outage is worked
+// off over a few sessions rather than keeping the modem on for one very long one.
+const int maxReplayPerSession = 240;
+// How long to wait before trying again after publishing fails (ms)
+const uint32_t retryInterval = 300000;
+
+SdFat sd;
+SdRecordStore outboxFile("outbox.bin");  // The outbox's file on the SD card
+RecordQueue outbox(outboxFile, outboxSlots);
+bool outboxReady = false;  // Whether the outbox's file could be set up
+// A hash of the datastream and timestamp of the observation in each slot of the outbox (the slot for a
+// sequence number is the sequence number modulo outboxSlots), for spotting duplicates without reading
+// the card
+uint16_t outboxKeys[outboxSlots];
+
+uint32_t observationsQueued = 0;  // Observations saved to be published
+uint32_t observationsSent = 0;  // Observations HydroServer accepted
+uint32_t observationsDuplicate = 0;  // Observations ignored because they were already waiting
+uint32_t observationsDropped = 0;  // Observations lost for lack of room (not counting those written over in the outbox)
+bool retrying = false;  // Whether the last try at publishing failed
+uint32_t lastPublishAttempt = 0;  // When publishing was last tried (ms)
+
+int stationsThisCycle = 0;  // Station strings received since the radio went quiet
+int cyclesGathered = 0;  // Radio cycles gathered since the last publish
+uint32_t lastStationTime = 0;  // When the last station string came in (ms)
+
 String timestamp = "";
 String StringVarCount = "";
 int varCount;
-const int maxVarCount = 40;
-String table[maxVarCount][2];
 String data = "";
 
 bool timeToPublish;
@@ -177,6 +290,365 @@ String getValue(String data, String variableName) {
   return data.substring(startIndex, endIndex);
 }
 
+/*
+This function looks for an item in a list, adding it to the end if it isn't there.
+It gives back where the item is, or -1 if it wasn't there and the list is full.
+*/
+int findOrAdd(String list[], int& count, int maxCount, const String& item) {
+  for (int i = 0; i < count; i++) {
+    if (list[i] == item) return i;
+  }
+  if (count >= maxCount) return -1;
+  list[count] = item;
+  return count++;
+}
+
+/*
+This function adds an observation to those in memory, giving back false if there's no room for it. If
+the datastream already has an observation at that timestamp, it is kept instead.
+*/
+bool addObservation(const String& uuid, int timestampIndex, const String& value, uint32_t seq) {
+  if (timestampIndex < 0) return false;
+  int datastreamIndex = findOrAdd(datastreams, datastreamCount, maxDatastreams, uuid);
+  if (datastreamIndex < 0) return false;
+  for (int i = 0; i < observationCount; i++) {
+    if (obsDatastream[i] == datastreamIndex && obsTimestamp[i] == timestampIndex) {
+      observationsDuplicate++;
+      return true;
+    }
+  }
+  if (observationCount >= maxObservations) return false;
+  obsDatastream[observationCount] = datastreamIndex;
+  obsTimestamp[observationCount] = timestampIndex;
+  obsValue[observationCount] = value;
+  obsSeq[observationCount] = seq;
+  obsDone[observationCount] = false;
+  observationCount++;
+  return true;
+}
+
+// Forgets every observation in memory
+void clearObservations() {
+  for (int i = 0; i < observationCount; i++) obsValue[i] = "";
+  for (int i = 0; i < datastreamCount; i++) datastreams[i] = "";
+  for (int i = 0; i < timestampCount; i++) timestamps[i] = "";
+  observationCount = 0;
+  datastreamCount = 0;
+  timestampCount = 0;
+}
+
+// Forgets the observations in memory that have been dealt with, keeping the rest in order
+void removeDoneObservations() {
+  int kept = 0;
+  for (int i = 0; i < observationCount; i++) {
+    if (obsDone[i]) continue;
+    obsDatastream[kept] = obsDatastream[i];
+    obsTimestamp[kept] = obsTimestamp[i];
+    obsValue[kept] = obsValue[i];
+    obsSeq[kept] = obsSeq[i];
+    obsDone[kept] = false;
+    kept++;
+  }
+  for (int i = kept; i < observationCount; i++) obsValue[i] = "";
+  observationCount = kept;
+  if (observationCount == 0) clearObservations();  // Nothing refers to the datastreams or timestamps any more
+}
+
+// Gives back the key used to spot a repeat of an observation: a hash of its datastream and timestamp
+uint16_t observationKey(const char* uuid, const char* observationTime) {
+  SchemaHash hash;
+  hash.add(uuid);
+  hash.add(observationTime);
+  return hash.value();
+}
+
+/*
+This function splits an observation saved in the outbox ("uuid;timestamp;value") into its parts,
+giving back false if the record isn't one.
+*/
+bool parseOutboxRecord(char* text, char*& uuid, char*& observationTime, char*& value) {
+  uuid = text;
+  observationTime = strchr(uuid, delimeter);
+  if (observationTime == NULL) return false;
+  *observationTime++ = '\0';
+  value = strchr(observationTime, delimeter);
+  if (value == NULL) return false;
+  *value++ = '\0';
+  return true;
+}
+
+// Reads an observation back out of the outbox as text, giving back false if it can't be
+bool readOutboxRecord(uint32_t seq, char* text) {
+  uint8_t length = outbox.read(seq, (uint8_t*)text, RECORD_QUEUE_MAX_RECORD);
+  text[length] = '\0';
+  return length > 0;
+}
+
+/*
+This function sets up the outbox on the SD card, picking up where we left off. The key for each
+observation still waiting is worked out again so repeats can be spotted.
+*/
+void beginOutbox() {
+  outboxReady = sd.begin(sdCardPin, SPI_FULL_SPEED) && outboxFile.begin(outbox.fileSize()) && outbox.begin();
+  if (!outboxReady) {
+    Serial.println("The outbox on the SD card couldn't be set up! Observations will only be kept in memory.");
+    return;
+  }
+  char text[RECORD_QUEUE_MAX_RECORD + 1];
+  char* uuid;
+  char* observationTime;
+  char* value;
+  for (uint32_t seq = outbox.nextPending(); seq != 0; seq = outbox.nextPending(seq)) {
+    if (readOutboxRecord(seq, text) && parseOutboxRecord(text, uuid, observationTime, value)) {
+      outboxKeys[seq % outboxSlots] = observationKey(uuid, observationTime);
+    } else {
+      outbox.ack(seq);  // Nothing can be done with a record that can't be read
+    }
+  }
+  Serial.print("Observations waiting in the outbox: ");
+  Serial.println(outbox.pending());
+}
+
+/*
+This function saves an observation in the outbox, unless the same datastream and timestamp is already
+waiting there. It gives back false if the observation couldn't be saved.
+*/
+bool queueObservation(const String& uuid, const String& observationTime, const String& value) {
+  uint16_t key = observationKey(uuid.c_str(), observationTime.c_str());
+  char text[RECORD_QUEUE_MAX_RECORD + 1];
+  char* otherUuid;
+  char* otherTime;
+  char* otherValue;
+  for (uint32_t seq = outbox.nextPending(); seq != 0; seq = outbox.nextPending(seq)) {
+    if (outboxKeys[seq % outboxSlots] != key) continue;
+    if (readOutboxRecord(seq, text) && parseOutboxRecord(text, otherUuid, otherTime, otherValue) &&
+        uuid == otherUuid && observationTime == otherTime) {
+      observationsDuplicate++;
+      return true;  // It's already waiting
+    }
+  }
+
+  String record = uuid + delimeter + observationTime + delimeter + value;
+  if (record.length() > RECORD_QUEUE_MAX_RECORD) {  // Too long to ever be saved, so don't hold things up over it
+    observationsDropped++;
+    return true;
+  }
+  uint32_t seq = outbox.push((const uint8_t*)record.c_str(), record.length());
+  if (seq == 0) return false;
+  outboxKeys[seq % outboxSlots] = key;
+  observationsQueued++;
+  return true;
+}
+
+/*
+This function moves the observations gathered in memory into the outbox at the end of a radio cycle.
+If the SD card stops working partway through, the rest are kept in memory and the outbox isn't used
+again until the sketch restarts.
+*/
+void saveToOutbox() {
+  for (int i = 0; i < observationCount; i++) {
+    if (!queueObservation(datastreams[obsDatastream[i]], timestamps[obsTimestamp[i]], obsValue[i])) {
+      Serial.println("Couldn't save to the outbox! Keeping the observations in memory.");
+      outboxReady = false;
+      break;
+    }
+    obsDone[i] = true;
+  }
+  removeDoneObservations();
+}
+
+/*
+This function reads observations still waiting in the outbox (those after the given sequence number)
+into memory to be published, as many as there is room for up to the limit given. It gives back the
+sequence number of the last one read.
+*/
+uint32_t stageFromOutbox(uint32_t after, int limit) {
+  char text[RECORD_QUEUE_MAX_RECORD + 1];
+  char* uuid;
+  char* observationTime;
+  char* value;
+  for (uint32_t seq = outbox.nextPending(after); seq != 0 && limit > 0; seq = outbox.nextPending(seq)) {
+    if (!readOutboxRecord(seq, text) || !parseOutboxRecord(text, uuid, observationTime, value)) {
+      outbox.ack(seq);  // Nothing can be done with a record that can't be read
+      continue;
+    }
+    int timestampIndex = findOrAdd(timestamps, timestampCount, maxTimestamps, observationTime);
+    if (!addObservation(uuid, timestampIndex, value, seq)) break;  // No more room this time
+    after = seq;
+    limit--;
+  }
+  return after;
+}
+
+// Prints how many observations have gone through the outbox
+void printOutboxStats() {
+  Serial.print("Observations queued: ");
+  Serial.print(observationsQueued);
+  Serial.print(", sent: ");
+  Serial.print(observationsSent);
+  Serial.print(", waiting: ");
+  Serial.print(outboxReady ? outbox.pending() : observationCount);
+  Serial.print(", duplicates ignored: ");
+  Serial.print(observationsDuplicate);
+  Serial.print(", dropped: ");
+  Serial.println(observationsDropped + outbox.dropped);
+}
+
+/*
+This function works out how many characters a datastream's object takes in the JSON:
+{"Datastream":{"@iot.id":"*UUID*"},"components":["phenomenonTime","result"],"dataArray":[["*timestamp*",*value*],...]}
+*/
+uint16_t datastreamJsonLength(int d) {
+  uint16_t length = strlen(datastreamTag) + strlen(iotTag) + strlen(componentsTag) + strlen(dataArrayTag) + 9;
+  length += datastreams[d].length();
+  int rows = 0;
+  for (int i = 0; i < observationCount; i++) {
+    if (obsDatastream[i] != d) continue;
+    length += 5 + timestamps[obsTimestamp[i]].length() + obsValue[i].length();  // ["*timestamp*",*value*]
+    rows++;
+  }
+  if (rows > 1) length += rows - 1;  // the commas between rows
+  return length;
+}
+
+// Adds a datastream's object, with a row for each of its observations, to the transmit buffer
+void addDatastreamJson(int d) {
+  addToLTEBuffer('{');
+  addToLTEBuffer(datastreamTag);
+  addToLTEBuffer('{');
+  addToLTEBuffer(iotTag);
+  addToLTEBuffer('"');
+  addToLTEBuffer(datastreams[d].c_str(), datastreams[d].length());
+  addToLTEBuffer("\"},");
+  addToLTEBuffer(componentsTag);
+  addToLTEBuffer(dataArrayTag);
+  addToLTEBuffer('[');
+  bool firstRow = true;
+  for (int i = 0; i < observationCount; i++) {
+    if (obsDatastream[i] != d) continue;
+    if (!firstRow) addToLTEBuffer(',');
+    firstRow = false;
+    const String& rowTime = timestamps[obsTimestamp[i]];
+    addToLTEBuffer("[\"");
+    addToLTEBuffer(rowTime.c_str(), rowTime.length());
+    addToLTEBuffer("\",");
+    addToLTEBuffer(obsValue[i].c_str(), obsValue[i].length());
+    addToLTEBuffer(']');
+  }
+  addToLTEBuffer("]}");
+}
+
+/*
+This function sends one CreateObservations request holding the datastreams from first up to (not
+including) last, with every row gathered for each of them. It gives back the response code.
+*/
+int16_t postDatastreams(int first, int last, uint16_t jsonLength) {
+  // The connection is kept open between the requests in a session if the server allows it
+  if (!modem.gsmClient.connected()) {
+    if (!modem.gsmClient.connect(serverHost, serverPort)) {  // Connect to the desired server
+      Serial.println("Unable to connect to the server");
+      return 504;
+    }
+    Serial.println("Connected to server!");
+  }
+  char jsonSizeBuffer[6] = "";
+
+  /*
+  In this section, a POST request is constructed within a buffer piece by piece.
+  The buffer is sent whenever it fills up, so we can just keep adding to it.
+  */
+  Serial.println("Building the JSON!");
+  txBufferLTELength = 0;
+  addToLTEBuffer(postHeader);
+  addToLTEBuffer(hostHeader);
+  addToLTEBuffer(acceptHeader);
+  addToLTEBuffer(authorizationHeader);
+  addToLTEBuffer(base64Authorization);
+  addToLTEBuffer(contentLengthHeader);
+  itoa(jsonLength, jsonSizeBuffer, 10);
+  addToLTEBuffer(jsonSizeBuffer);
+  addToLTEBuffer(contentTypeHeader);
+
+  // Construct the JSON body
+  addToLTEBuffer('[');
+  for (int d = first; d < last; d++) {
+    if (d != first) addToLTEBuffer(',');
+    addDatastreamJson(d);
+  }
+  addToLTEBuffer(']');
+
+  printLTEBuffer(&modem.gsmClient);
+  Serial.println("Sent the JSON");
+  // Read the response as it comes in, keeping its body to print
+  response.begin(rxBufferRadio, rxBufferRadioSize);
+  int16_t responseCode = response.read(&modem.gsmClient, responseTimeout);
+  if (!response.keepAlive()) modem.gsmClient.stop();
+
+  Serial.print("Response Code: ");
+  Serial.println(responseCode);
+  Serial.println("Response Body");
+  Serial.write(rxBufferRadio, response.getBodyLength());
+  Serial.println();
+  return responseCode;
+}
+
+/*
+This function publishes the observations in memory, splitting the datastreams across as few requests
+as maxBodySize allows. A datastream that is too big for maxBodySize on its own is sent by itself.
+Anything other than a 2xx response code counts as a failure, and no more requests are sent after one.
+Each observation that went through is marked as done (and let go of in the outbox).
+*/
+void publishObservations() {
+  int first = 0;
+  while (first < datastreamCount) {
+    uint16_t jsonLength = 2 + datastreamJsonLength(first);  // [ and ] around the first datastream
+    int last = first + 1;
+    while (last < datastreamCount) {
+      uint16_t nextLength = 1 + datastreamJsonLength(last);  // with the comma before it
+      if (jsonLength + nextLength > maxBodySize) break;
+      jsonLength += nextLength;
+      last++;
+    }
+    int16_t responseCode = postDatastreams(first, last, jsonLength);
+    if (responseCode < 200 || responseCode > 299) return;  // The rest wait for the next try
+    for (int i = 0; i < observationCount; i++) {
+      if (obsDatastream[i] < first || obsDatastream[i] >= last) continue;
+      if (obsSeq[i] != 0) outbox.ack(obsSeq[i]);
+      obsDone[i] = true;
+      observationsSent++;
+    }
+    first = last;
+  }
+}
+
+/*
+This function publishes everything waiting, all in one session with the modem. Observations are read
+out of the outbox a batch at a time, up to maxReplayPerSession of them. It gives back false if
+something couldn't be published.
+*/
+bool publishWaiting() {
+  if (!outboxReady) {  // Everything is in memory
+    publishObservations();
+    removeDoneObservations();
+    return observationCount == 0;
+  }
+
+  uint32_t after = 0;
+  int replayed = 0;
+  while (replayed < maxReplayPerSession) {
+    clearObservations();
+    after = stageFromOutbox(after, maxReplayPerSession - replayed);
+    if (observationCount == 0) return true;  // Nothing more is waiting
+    replayed += observationCount;
+    publishObservations();
+    removeDoneObservations();
+    bool published = observationCount == 0;
+    clearObservations();  // Anything left is still in the outbox
+    if (!published) return false;
+  }
+  return true;
+}
+
 String targetString = "@endofstation=1;";
 char incomingChar;
 char potentialChar;
@@ -219,6 +691,10 @@ void setup() {
                                        // 3 CAT-M and NB-IoT
   
   modem.modemSleep();
+
+  // Set up the outbox, picking up any observations that were waiting before a restart
+  beginOutbox();
+  if (outboxReady && outbox.pending() > 0) timeToPublish = true;
 }
 
 
@@ -272,13 +748,14 @@ void loop() {
     timestamp = getValue(data, "timestamp");
     String StringVarCount = getValue(data, "varCount");
     varCount = StringVarCount.toInt();
-    if (varCount >= 1) timeToPublish = true;
 
     Serial.print("\r\nTimestamp: ");
     Serial.println(timestamp);
     Serial.print("varCount: ");
     Serial.println(varCount);
 
+    // Keep the station's observations with any others waiting to be published
+    int timestampIndex = findOrAdd(timestamps, timestampCount, maxTimestamps, timestamp);
     int rowIndex = 0;
     int start = 0;
 
@@ -295,246 +772,70 @@ void loop() {
       String varName = data.substring(varStart + 1, eqIndex);
       String varValue = data.substring(eqIndex + 1, endIndex);
 
-      //Serial.print("varName: ");
-      //Serial.println(varName);
-      //Serial.print("varValue: ");
-      //Serial.println(varValue);
-
       if (varName != "timestamp" && varName != "varCount" && varName != "endofstation") {
-        Serial.println("\r\nAdding data to table!");
-        table[rowIndex][0] = varName;
-        table[rowIndex][1] = varValue;
-        Serial.print("table[" + String(rowIndex) + "][0]: ");
-        Serial.println(table[rowIndex][0]);
-        Serial.print("table[" + String(rowIndex) + "][1]: ");
-        Serial.println(table[rowIndex][1]);
+        Serial.print("Adding observation: ");
+        Serial.print(varName);
+        Serial.print(" = ");
+        Serial.println(varValue);
+        if (!addObservation(varName, timestampIndex, varValue, 0)) observationsDropped++;
         rowIndex++;
       }
       
       start = endIndex + 1;
     }
+    if (varCount >= 1) {
+      stationsThisCycle++;
+      lastStationTime = millis();
+    }
+    if (observationsDropped > 0) {
+      Serial.print("Observations dropped for lack of room: ");
+      Serial.println(observationsDropped);
+    }
+  }
+
+  // Once the Base Mayfly has gone quiet, the radio cycle is over, and what it sent is saved in the outbox
+  if (stationsThisCycle > 0 && millis() - lastStationTime >= cycleQuietTime) {
+    stationsThisCycle = 0;
+    if (outboxReady) saveToOutbox();
+    cyclesGathered++;
+    Serial.print("Radio cycles gathered: ");
+    Serial.println(cyclesGathered);
+    if (cyclesGathered >= cyclesPerPost) timeToPublish = true;
+  }
+  // Don't wait for the rest of the cycles if there's no room left
+  if (stationsThisCycle == 0) {
+    if (observationCount >= maxObservations || timestampCount >= maxTimestamps) timeToPublish = true;
+    if (outboxReady && outbox.pending() >= outboxSlots * 3 / 4) timeToPublish = true;
   }
 
-  // Try and connect to the appropriate server if it's time to publish data
-  if (timeToPublish) {
+  // Try and connect to the appropriate server if it's time to publish data, waiting a while between
+  // tries if the last one failed. Nothing is published while the Base Mayfly is in the middle of a cycle.
+  if (timeToPublish && stationsThisCycle == 0 && (!retrying || millis() - lastPublishAttempt >= retryInterval)) {
+    lastPublishAttempt = millis();
     connectSuccess = false;
     Serial.println("Time to publish!");
     if (modem.modemWake()) {  // Wake the LTE modem
       if (modem.connectInternet()) {  // Connect the modem to the internet
         Serial.println("Connected to the internet!");
-        if (modem.gsmClient.connect(serverHost, serverPort)) {  // Connect to the desired server
-          connectSuccess = true;
-          Serial.println("Connected to server!");
-          timeToPublish = false;  // Set this back to false so we don't try and connect again if there isn't still something in the serial buffer
-        }
+        connectSuccess = true;
       }
     }
+    if (!connectSuccess) {
+      Serial.println("Unable to connect to the internet; trying again later");
+      retrying = true;
+      modem.modemSleep();
+    }
   }
 
   if (connectSuccess) {
     connectSuccess = false;  // set this back to false so we don't do this again unless we flag that it's time to publish again
-    Serial.print("rxBufferRadio: ");
-    Serial.println(rxBufferRadio);
-    char jsonSizeBuffer[5] = "";
-    char tempBuffer[37] = "";
-    
-    /*
-    In this section, a POST request is constructed within a buffer piece by piece.
-    Before a new section is added to the buffer, we check to see if the buffer has room.
-    If there is not enough room, we send what we have so far before adding it and moving on.
-    */
-
-    Serial.println("Building the JSON!");
-    // Add the post header to the buffer
-    snprintf(txBufferLTE, sizeof(txBufferLTE), "%s", postHeader);
-    
-    // Add the host header
-    if (txBufferLTEsize - strlen(txBufferLTE) < 29) printLTEBuffer(&modem.gsmClient);
-    snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", hostHeader);
-
-    // Add the accept header
-    if (txBufferLTEsize - strlen(txBufferLTE) < 25) printLTEBuffer(&modem.gsmClient);        
-    snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", acceptHeader);
-
-    // Add the beginning of the authorization header
-    if (txBufferLTEsize - strlen(txBufferLTE) < 21) printLTEBuffer(&modem.gsmClient);
-    snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", authorizationHeader);
-
-    // Add the basic64 authorization
-    if (txBufferLTEsize - strlen(txBufferLTE) < 16) printLTEBuffer(&modem.gsmClient);
-    snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", base64Authorization);
-
-    // Add the content length header
-    if (txBufferLTEsize - strlen(txBufferLTE) < 33) printLTEBuffer(&modem.gsmClient);
-    snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", contentLengthHeader);
-
-    // Calculate content length
-    uint16_t jsonLength = 1;   // [
-    //Serial.print("JSON Length: ");
-    //Serial.println(jsonLength);
-    //Serial.print("varCount: ");
-    //Serial.println(varCount);
-    for (int i = 0; i < varCount; i++) {
-      //Serial.print("i: ");
-      //Serial.println(i);
-      jsonLength += 15;          // {"Datastream":{
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      jsonLength += 10;          // "@iot.id":
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      jsonLength += 1;           // "
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      jsonLength += 36;          // *Datastream ID*
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      jsonLength += 3;           // "},
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      jsonLength += 41;          // "components":["phenomenonTime","result"],
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      jsonLength += 13;          // "dataArray":[
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      jsonLength += 29;          // ["*phenomenonTime*",
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      jsonLength += table[i][1].length(); // *result*
-      //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      if (i == varCount - 1) {
-          jsonLength += 3;       // ]]}
-          //Serial.print("JSON Length: ");
-      //Serial.println(jsonLength);
-      }
-      else {
-        jsonLength += 4;       // ]]},
-        //Serial.print("JSON Length: ");
-        //Serial.println(jsonLength);
-      }
-    }
-    jsonLength += 1;               // ]
-
-    //Serial.print("JSON length: ");
-    //Serial.println(jsonLength);
-
-    // Add the content length
-    if (txBufferLTEsize - strlen(txBufferLTE) < 5) printLTEBuffer(&modem.gsmClient);
-    itoa(jsonLength, jsonSizeBuffer, 10);
-    snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", jsonSizeBuffer);
-    
-    // Add the content-type header
-    if (txBufferLTEsize - strlen(txBufferLTE) < 33) printLTEBuffer(&modem.gsmClient);
-    snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", contentTypeHeader);
-
-    // Construct the JSON body
-    if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-    txBufferLTE[strlen(txBufferLTE)] = '[';
-
-    for (int y = 0; y < varCount; y++) {
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '{';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 13) printLTEBuffer(&modem.gsmClient);
-      snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", datastreamTag);
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 10) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '{';
-      snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", iotTag);
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '"';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 37) printLTEBuffer(&modem.gsmClient);
-      table[y][0].toCharArray(tempBuffer, 37);
-      snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", tempBuffer);
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '"';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '}';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = ',';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 42) printLTEBuffer(&modem.gsmClient);
-      snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", componentsTag);
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 12) printLTEBuffer(&modem.gsmClient);
-      snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", dataArrayTag);
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '[';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '[';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '"';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 37) printLTEBuffer(&modem.gsmClient);
-      timestamp.toCharArray(tempBuffer, 37);
-      snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", tempBuffer);
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '"';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = ',';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 37) printLTEBuffer(&modem.gsmClient);
-      table[y][1].toCharArray(tempBuffer, 37);
-      snprintf(txBufferLTE + strlen(txBufferLTE), sizeof(txBufferLTE) - strlen(txBufferLTE), "%s", tempBuffer);
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = ']';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = ']';
-
-      if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-      txBufferLTE[strlen(txBufferLTE)] = '}';
-
-      if (y != varCount - 1) {
-        if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-        txBufferLTE[strlen(txBufferLTE)] = ',';
-      }
-    }
-    if (txBufferLTEsize - strlen(txBufferLTE) < 1) printLTEBuffer(&modem.gsmClient);
-    txBufferLTE[strlen(txBufferLTE)] = ']';
-
-    printLTEBuffer(&modem.gsmClient);
-    Serial.println("Sent the JSON");
-    // Wait 10 seconds for a response code
-    uint32_t start = millis();
-    while ((millis() - start) < 10000L) {
-      delay(10);
-    }
-
-    uint16_t did_respond = 0;
-    did_respond = modem.gsmClient.readBytes(rxBufferRadio, 3000);
-    modem.gsmClient.stop();
+    // Everything waiting goes out in this one session with the modem
+    bool published = publishWaiting();
+    if (modem.gsmClient.connected()) modem.gsmClient.stop();
     modem.modemSleep();
-
-    int16_t responseCode = 0;
-    if (did_respond > 0) {
-      char responseCode_char[4];
-      for (uint8_t i = 0; i < 3; i++) {
-        responseCode_char[i] = rxBufferRadio[i + 9];
-      }
-      responseCode = atoi(responseCode_char);
-    } else {
-      responseCode = 504;
-    }
-
-    Serial.print("Response Code: ");
-    Serial.println(responseCode);
-    Serial.println("Full Response");
-    Serial.println(rxBufferRadio);
-  } else {
-    //Serial.println("Unable to establish connection to data portal");
+    cyclesGathered = 0;
+    retrying = !published;
+    timeToPublish = !published;  // If it didn't all go through, try again after retryInterval
+    printOutboxStats();
   }
 }
@@ -48,6 +48,13 @@
 // Real-time clock (RTC)
 #include "Sodaq_DS3231.h"
 
+// Builds and reads the XBee API frames (found in the SnowRadio library folder)
+#include <XBeeFrame.h>
+#include <StationScheduler.h>
+#include <MeasurementRecord.h>
+#include <SlotSchedule.h>
+#include <ClockSync.h>
+
 // Pin numbers for useful LEDs on the Mayfly that sometimes help to troubleshoot
 const int8_t redLED = 9;
 const int8_t greenLED = 8;
@@ -116,27 +123,80 @@ byte satellites[numStations][sizeAddress] = {{0x00, 0x13, 0xA2, 0x00, 0x42, 0x2B
 // Each slot in the array corresponds to the stations listed in the stationNames array
 bool dataSent[numStations];
 
-// The final String that will be sent to the CR800 data logger over serial communication
-String stringToSend;
+// The Strings that will be sent to the CR800 over serial communication, one for each station.
+// Each station's String is put together as its data comes in and sent once the station is finished.
+String stationData[numStations];
 
 // The time to delay between transmiting a message and waiting for a response (in seconds).
 // Having this delay helps make sure a message comes through in its entirety.
 uint32_t wait = 10;
 
 // This variable helps track when measurements were last requested so the central station's
-// radio is not perpetually requesting data
-int prevLogHour;
+// radio is not perpetually requesting data. It is the start of the last cycle we collected in.
+uint32_t prevCycle = 0;
 
 // This boolean variable helps signal that not only are we in a timing interval that's appropriate to log
 // but also that we've met other conditions needed
 bool timeToLog;
 
-// Variable used in the checksum function
-int sum;
-
 // The number of times you want to try and make contact with a station before giving up
 int totalTries = 7;
 
+// Whether to ask each station for all of its data in a single bulk dump before falling back
+// to the step-by-step handshake (asking for the timestamp, variable count, and then each
+// variable one at a time). Make sure the order matches the stationNames array. Set a
+// station's entry to false if it is still running a satellite sketch that doesn't know how
+// to answer a bulk dump request.
+bool useBulk[numStations] = {true, true, true, true, true};
+
+// Whether to ask each station for a compact dump first, which sends the values as packed numbers rather
+// than text, and only sends the variable names when the base station doesn't already have them. Make
+// sure the order matches the stationNames array. Set a station's entry to false if it is still running
+// a satellite sketch that doesn't know how to answer a compact dump request.
+bool useCompact[numStations] = {true, true, true, true, true};
+
+// The number of times to ask for a dump before falling back to the next way of asking
+// (compact, then bulk, then step-by-step)
+int bulkAttempts = 2;
+
+// The most bytes a station's compact dump can take. That is 7 bytes plus 2 for each variable, and
+// 4 more for each value that is too big to be sent as a scaled 16-bit number.
+const uint8_t maxRecordSize = 160;
+
+// The room to keep each station's variable codes in once we have its schema (each code takes its
+// length plus one). Make sure it's enough for the station with the most variables.
+const int schemaCodesSize = 400;
+
+// The most stations to have a request out to at once. While one station is slow to answer (or
+// isn't answering at all), the others keep going instead of waiting their turn behind it.
+const uint8_t maxInFlight = 3;
+
+// When the XBee says it couldn't get a message to a station, wait this long before asking it again. The
+// wait doubles each time, up to maxBackoff, so a station that is down doesn't hog the radio. A message
+// that just wasn't answered has already waited out its timeout, so it is sent again right away; either
+// way a station that is down takes no longer than totalTries timeouts, as when they were asked in turn.
+const uint32_t firstBackoff = 2000;  // milliseconds
+const uint32_t maxBackoff = 60000;  // milliseconds
+
+/*
+Each satellite station only turns its radio on for its own slot each logging interval (a cycle), instead
+of listening for minutes until its turn comes. The slots start firstSlot seconds into each cycle by the
+Base Mayfly's clock and follow one another in the order of the stationNames array, slotWidth seconds
+each. Every 'R' tells the station its slot and the time on the Base Mayfly's clock. The station works out
+how far its clock is from ours (and how fast they drift apart) from that, so it knows when to listen,
+and changing these here is all it takes to change the schedule. A station that can't be reached in its
+slot goes back to listening from minute 1 for ten minutes after missing a few in a row, so keep every
+slot within that. The first slot starts half a minute after that, so a station whose clock is a little
+behind ours still hears it before it knows its slot.
+*/
+const uint32_t cycleLength = 3600;  // seconds; the satellites' logging interval
+const uint16_t firstSlot = 90;  // seconds into the cycle
+const uint16_t slotWidth = 60;  // seconds
+
+// A station that relays messages for stations before it in the stationNames array has to have its radio
+// on for their slots too, so its slot opens with the first one. Set its entry to true.
+bool relays[numStations] = {false, false, false, false, false};
+
 // Possible character messages to send to a satellite station
 // DO NOT CHANGE THESE
 // The satellite stations are listening for these specific messages
@@ -144,82 +204,130 @@ char ready[] = "R";   // "Are you ready to start communicating?"
 char time[] = "T";    // "Could I get the timestamp?"
 char var[] = "V";     // "How many variables did you measure?"
 char number[] = "N";  // "Can I get the measurement made for the variable number I just sent you?"
+char bulk[] = "B";    // "Could I get everything you measured in one go?"
+char ack[] = "A";     // "I got all of it, you can stop sending."
+char compact[] = "C"; // "Could I get everything you measured in one go, packed as numbers?"
+char schema[] = "S";  // "Could I get the names that go with those numbers?"
+char catchUp[] = "K"; // "Could I get the oldest reading you have that I missed?"
 
 // This is a place to store any information the XBee reads into the Mayfly's
 // serial port. This is usually referred to as a buffer in serial communication.
-byte rx[64];
-
-/* 
-This function calculates the most signifcant byte (MSB).
-It assumes that the message includes a null terminator at the end which should make it easy
-to just use the sizeof() function as the size parameter. The 13 is there because
-this function is solely used for making a Transmit Request frame type on the XBee, and the amount
-of other bytes that it cares about when checking the frame is a fixed value aside from the
-actual message being sent.
-*/
-byte lengthMSB(int size) {
-  return byte((13 + size) / 255);
+// It is sized to hold a whole bulk dump fragment along with its XBee framing.
+byte rx[128];
+
+// This is where transmit request frames are put together before they go out to the XBee.
+// The base station only ever sends one-byte messages, so it doesn't need to be big.
+byte tx[32];
+
+// The encoder builds transmit request frames in tx, and the decoder puts the frames the XBee
+// sends us back together in rx one byte at a time, checking the length and checksum as it goes
+XBeeFrameEncoder encoder(tx, sizeof(tx));
+XBeeFrameDecoder decoder(rx, sizeof(rx));
+
+// The scheduler keeps track of which stations have a request out, when each one is due to be asked
+// again, and which station each incoming frame came from. It also hands out the frame IDs, so the XBee
+// tells us whether each message made it to the other XBee. It keeps track of how long each answer
+// took as well (scheduler.lastLatencyMs, averageLatencyMs(), maxLatencyMs, timeouts, etc.)
+stationSlot slots[numStations];
+StationScheduler scheduler(slots, numStations, maxInFlight, firstBackoff, maxBackoff);
+
+// The steps of the conversation with a station. Each step is one message to the station and the
+// answer we expect back. Compact dump stations go ready (-> catch up on missed readings) -> compact
+// (-> schema if we don't have it),
+// bulk dump stations go ready -> bulk, and the rest (or any station whose dumps didn't come through)
+// go ready -> time -> variable count -> name -> value -> name -> ...
+enum collectionStep { askReady, askCatchUp, askCompact, askSchema, askBulk, askTime, askVarCount, askName, askValue };
+
+// Where each station is in its conversation
+collectionStep step[numStations];
+String bulkBody[numStations];  // The text from the bulk dump fragments that have come in so far
+uint8_t expectedSeq[numStations];  // The sequence number of the next bulk dump fragment we expect
+uint8_t varCount[numStations];  // How many variables the station said it measured
+uint8_t varIndex[numStations];  // The variable we are asking about
+bool ackOnRelease[numStations];  // Whether to tell the station we got its bulk dump ('A') when we let it go
+
+// Each station's compact dump, kept as it came in until the station is let go. It is turned back into
+// text on the way out to the CR800 using the station's schema.
+byte record[numStations][maxRecordSize];
+uint8_t recordLength[numStations];  // How many bytes of the compact dump have come in
+bool recordReady[numStations];  // Whether the station's data is in its compact dump rather than its String
+
+// Each station's schema (its variable names and how its values are packed), kept between logging
+// intervals so it is only sent again when the station's schemaID changes
+char schemaCodes[numStations][schemaCodesSize];
+RecordSchema schemas[numStations];
+
+// The schemaID each station sent along with its 'R' this time around. A station's schemaID changes by
+// itself whenever its variables do, so if it matches the schema we have, we already know the names of
+// its variables and only need to ask for the values, even in the step-by-step handshake.
+uint16_t advertisedSchema[numStations];
+bool hasAdvert[numStations];  // Whether the station sent a schemaID at all (older satellite sketches don't)
+bool namesKnown[numStations];  // Whether the step-by-step handshake is getting the names from the schema
+
+// Satellites keep each reading on their SD card until we have it, and tell us along with their 'R' how
+// many older readings we missed (while the base station was down, or the radio link was). Before asking
+// for the current reading, we ask for those with a 'K', one at a time, and send each one out as its own
+// line once collection is over. The satellite limits how many it sends each logging interval, so a long
+// outage is caught up on over a few hours rather than keeping everything awake.
+uint8_t backlog[numStations];  // How many missed readings the station said it has
+uint32_t lastCatchUp[numStations];  // The sequence number of the last missed reading we got (0 for none yet)
+
+// The missed readings that came in this time around, kept as they came in until collection is over. Once
+// these are full, a station's next missed reading is left with it (we don't tell it we have it) until the
+// next logging interval.
+const uint8_t maxCaughtUp = 4;
+byte caughtUp[maxCaughtUp][maxRecordSize];
+uint8_t caughtUpLength[maxCaughtUp];
+uint8_t caughtUpStation[maxCaughtUp];  // Which station each one came from
+uint8_t caughtUpCount = 0;
+
+// When each station's slot closes, by millis(). We stop asking a station if it is ready after that.
+uint32_t slotCloseMs[numStations];
+// The start of the cycle we are collecting in, by the RTC and by millis()
+uint32_t cycleStartEpoch;
+uint32_t cycleStartMs;
+
+// Each 'R' also carries the time on our clock to the millisecond, so the satellites can set their clocks to
+// ours. To make up for the time the 'R' takes to get there, it carries the round trip to the station too:
+// the time from sending the station its last 'R' to hearing back, less the time the station says it took
+// to answer. It is measured each logging interval and sent the next, and kept at 0 (not known) until then.
+uint32_t readySentMs[numStations];  // When we last sent the station an 'R', by millis()
+uint16_t roundTrip[numStations];  // The last round trip to the station, in milliseconds
+
+// When a station's slot opens, in seconds into the cycle
+uint16_t slotOpens(int stationIndex) {
+  return relays[stationIndex] ? firstSlot : firstSlot + stationIndex * slotWidth;
 }
 
-/*
-This function calculates the least signifcant byte (LSB).
-It assumes that message includes a null terminator at the end which should make it easy
-to just use the sizeof() function as the size parameter. The 13 is there because
-this function is solely used for making a Transmit Request frame type on the XBee, and the amount
-of other bytes that it cares about when checking the frame is a fixed value aside from the
-actual message being sent.
-*/
-byte lengthLSB(int size) {
-  return byte((13 + size) % 255);
+// When a station's slot closes, in seconds into the cycle
+uint16_t slotCloses(int stationIndex) {
+  return firstSlot + (stationIndex + 1) * slotWidth;
 }
 
 /*
-This function calculates the checksum of a transmit request frame that is about to be sent to the XBee. This
-function is only useful for sending strings of characters (char[]). The size parameter is just
-the output using the sizeof(rfData[]) function. There is no need to try and account for it using sizeof(). 
-The station index refers to the placement order of each station in the stationNames array.
-The last three variables are described in the XBee manual section about transmit request frames.
-I leave them as 0x00 for each. I would suggest not changing those last three, especially frameID and options. 
+This function pushes a transmit request to the XBee through the Mayfly's serial port.
+The XBee then attempts to send the message to the station specified with the stationIndex parameter.
+The payload can be any bytes, not just characters, so it also works for sending a variable number.
+The encoder from the SnowRadio library works out the length and checksum while it builds the frame.
+Use the frame ID from scheduler.sent() so the XBee tells us if the message made it to the other XBee;
+the station is asked again right away if it didn't. A frameID of 0x00 means no transmit status comes back.
+The broadcast radius and options are described in the XBee manual section about transmit request frames.
+I leave them as 0x00.
 */
-byte checksum(char rfData[], int size, int stationIndex, byte frameID, byte broadcastRadius, byte options) {
-  sum = 0;
-  sum += 0x10;
-  sum += frameID;
-  
-  for (int p = 0; p <= sizeof(satellites[stationIndex]) - 1; p++) {
-    sum += satellites[stationIndex][p];
-  }
-
-  sum += options;
-  sum += broadcastRadius;
-  for (int i = 0; i < size - 1; i++) {
-    sum += byte(rfData[i]);
+void transmitBytes(const byte payload[], int payloadSize, byte frameID, int stationIndex, byte broadcastRadius, byte options) {
+  // The first 8 bytes of a satellite address are the serial number, and the last 2 are the optional address
+  if (encoder.transmitRequest(satellites[stationIndex], &satellites[stationIndex][8], payload, payloadSize, frameID, broadcastRadius, options) > 0) {
+    Serial1.write(encoder.frame(), encoder.length());  // Send the whole frame to the XBee in one go
   }
-  
-  return byte(255 - (sum % 256));
 }
 
 /*
-This function pushes a transmit request to the XBee through the Mayfly's serial port.
-The XBee then attempts to send the message to the station specified with the stationIndex parameter.
-The parameters are all the same for this as the checksum function (message[] and messageSize are rfData[] 
-and size respectively). I chose to have checksum be its own separate function so I could debug more easily 
-and to illustrate clearly how the transmit request works. I leave the frameID parameter as 0x00 because 
-then the XBee won't try and tell me if it made contact with the other XBee. I'll know if I have contact 
-if I receive data back. Changing this to any other value you want will kick messages back to the Mayfly 
-which can be helpful for debugging but will derail the code as it is currently setup in an actual deployment.
+This function sends one of the character messages listed above (ready, time, etc.) to a station.
+It assumes the message includes a null terminator at the end, which should make it easy
+to just use the sizeof() function as the messageSize parameter. The null terminator itself isn't sent.
 */
 void transmitRequest(char message[], int messageSize, byte frameID, int stationIndex, byte broadcastRadius, byte options) {
-  Serial1.write(0x7E);  // Starting delimeter
-  Serial1.write(lengthMSB(messageSize));  // Most significant byte
-  Serial1.write(lengthLSB(messageSize));  // Least significant byte
-  Serial1.write(0x10);  // Frame type (10 for transmit requests)
-  Serial1.write(frameID);  // Set to 0x00, in which case it will stop the XBee from telling the Mayfly if it made contact (which is what we want)
-  Serial1.write(satellites[stationIndex], 10);  // The destination address of the station the message is intended for
-  Serial1.write(broadcastRadius);  // Set to the default 0x00 because that will give the maximum broadcast hops (no need to change really)
-  Serial1.write(options);  // Just set to 0x00, otherwise you may change the programming of your XBee
-  Serial1.write(message);  // The message being sent. The Serial1.write() method will take care of sending the string as hexidecimals
-  Serial1.write(checksum(message, messageSize, stationIndex, frameID, broadcastRadius, options));  // Final checksum for quality control
+  transmitBytes((const byte*)message, messageSize - 1, frameID, stationIndex, broadcastRadius, options);
 }
 
 /*
@@ -240,16 +348,500 @@ void serialPrintBuffer(byte buffer[], int bufferSize) {
   }
 }
 
-// This function will wait for a specified amount of time or until bytes appear in the Serial1 buffer
-void waitForReceive(uint32_t secondsWait) {
-  uint32_t start_ts = rtc.now().getEpoch();  // Start a timer
-  delay(1000);
-  while (Serial1.available() == 0) {  // While we don't have anything in the buffer
-    if (rtc.now().getEpoch() - start_ts > secondsWait) {  // If we have waited longer than wanted
-      break;  // Leave the while loop
+// This function adds the message the decoder just put together onto a station's String, one character at a time
+void appendPayload(int stationIndex) {
+  for (uint16_t c = 0; c < decoder.rfDataLength(); c++) {
+    stationData[stationIndex] += (char)decoder.rfData()[c];
+  }
+}
+
+/*
+This function turns the text of a bulk dump ("timestamp;varCount;code;value;code;value;...;")
+into the same framing the step-by-step handshake builds ("@timestamp=...;@code=value;...") and
+adds it to the station's String. If the number of code/value pairs doesn't match the variable
+count the satellite gave, the String is left alone and false is returned.
+*/
+bool appendBulkData(int stationIndex) {
+  const String& body = bulkBody[stationIndex];
+  int fieldEnd = body.indexOf(';');  // The end of the timestamp
+  if (fieldEnd == -1) return false;
+  String timestamp = body.substring(0, fieldEnd);
+  int fieldStart = fieldEnd + 1;
+  fieldEnd = body.indexOf(';', fieldStart);  // The end of the variable count
+  if (fieldEnd == -1) return false;
+  int varCount = body.substring(fieldStart, fieldEnd).toInt();
+  fieldStart = fieldEnd + 1;
+
+  String data = "@timestamp=" + timestamp + ";";
+  int pairs = 0;  // Count up the code/value pairs as we go
+  while (fieldStart < (int)body.length()) {
+    int codeEnd = body.indexOf(';', fieldStart);
+    if (codeEnd == -1) return false;
+    int valueEnd = body.indexOf(';', codeEnd + 1);
+    if (valueEnd == -1) return false;
+    data += "@" + body.substring(fieldStart, codeEnd) + "=" + body.substring(codeEnd + 1, valueEnd) + ";";
+    pairs++;
+    fieldStart = valueEnd + 1;
+  }
+
+  if (pairs != varCount) return false;  // Something went missing along the way
+  stationData[stationIndex] += data;
+  return true;
+}
+
+/*
+This function finishes off a station's String once there is nothing more to get from it. The
+String ends with "@endofstation=1;", with a semicolon before it if addSeparator is true (a
+measurement is missing or we never made contact). The station is then held until every station
+before it is finished.
+*/
+void endStation(int stationIndex, bool addSeparator) {
+  stationData[stationIndex] += addSeparator ? ";@endofstation=1;" : "@endofstation=1;";  // Properly end the String
+  scheduler.hold(stationIndex);
+}
+
+/*
+This function marks a station's compact dump as complete. It is kept as it is (packed numbers) until
+the station is let go, and the station is told we got it then.
+*/
+void recordDone(int stationIndex, uint32_t now) {
+  scheduler.answered(stationIndex, now);
+  recordReady[stationIndex] = true;
+  ackOnRelease[stationIndex] = true;  // The station is told it can stop once it is let go
+  scheduler.hold(stationIndex);
+}
+
+/*
+This function turns a station's compact dump back into the same framing a bulk dump gives
+("@timestamp=...;@code=value;...@endofstation=1;") and sends it straight out to the CR800.
+*/
+void printRecord(int stationIndex, const byte data[], uint8_t length) {
+  RecordReader reader(data, length);
+  String timestamp;
+  DateTime(reader.timestamp() - 946684800).addToString(timestamp);  // DateTime counts from 2000 rather than 1970
+  Serial.print("@timestamp=");
+  Serial.print(timestamp);
+  Serial.print(';');
+  char value[RECORD_VALUE_TEXT_SIZE];
+  for (uint8_t v = 0; v < reader.varCount(); v++) {
+    reader.nextValue(schemas[stationIndex].format(v), value, sizeof(value));
+    Serial.print('@');
+    Serial.print(schemas[stationIndex].code(v));
+    Serial.print('=');
+    Serial.print(value);
+    Serial.print(';');
+  }
+  Serial.print("@endofstation=1;");  // Properly end the String
+}
+
+/*
+This function sends a station the message for the step it is on. The scheduler starts the station's
+timer and gives us the frame ID to send the message with.
+*/
+void sendStep(int stationIndex) {
+  byte frameID = scheduler.sent(stationIndex, millis(), wait * 1000UL);
+  switch (step[stationIndex]) {
+    case askReady: {
+      // Ask if the station is ready, telling it its slot and the time on our clock along the way
+      byte request[1 + SLOT_SCHEDULE_SIZE + CLOCK_SYNC_SIZE] = {(byte)ready[0]};
+      readySentMs[stationIndex] = millis();
+      uint32_t intoCycleMs = readySentMs[stationIndex] - cycleStartMs;
+      slotPutSchedule(request + 1, cycleStartEpoch + intoCycleMs / 1000, slotOpens(stationIndex), slotCloses(stationIndex));
+      clockPutTime(request + 1 + SLOT_SCHEDULE_SIZE, intoCycleMs % 1000, roundTrip[stationIndex]);
+      transmitBytes(request, sizeof(request), frameID, stationIndex, 0x00, 0x00);
+      break;
+    }
+    case askCatchUp:
+      recordLength[stationIndex] = 0;  // Start over with nothing collected
+      expectedSeq[stationIndex] = 0;
+      if (lastCatchUp[stationIndex] == 0) {
+        transmitRequest(catchUp, sizeof(catchUp), frameID, stationIndex, 0x00, 0x00);  // Ask for the oldest missed reading
+      } else {
+        // 'K' followed by the sequence number of the reading we just got tells the station it can let go of it
+        byte request[5] = {(byte)catchUp[0]};
+        for (uint8_t b = 0; b < 4; b++) request[1 + b] = (lastCatchUp[stationIndex] >> (8 * b)) & 0xFF;
+        transmitBytes(request, sizeof(request), frameID, stationIndex, 0x00, 0x00);
+      }
+      break;
+    case askCompact:
+      recordLength[stationIndex] = 0;  // Start over with nothing collected
+      expectedSeq[stationIndex] = 0;
+      transmitRequest(compact, sizeof(compact), frameID, stationIndex, 0x00, 0x00);  // Ask for the compact dump
+      break;
+    case askSchema:
+      bulkBody[stationIndex] = "";  // Start over with nothing collected
+      expectedSeq[stationIndex] = 0;
+      transmitRequest(schema, sizeof(schema), frameID, stationIndex, 0x00, 0x00);  // Ask for the schema
+      break;
+    case askBulk:
+      bulkBody[stationIndex] = "";  // Start over with nothing collected
+      expectedSeq[stationIndex] = 0;
+      transmitRequest(bulk, sizeof(bulk), frameID, stationIndex, 0x00, 0x00);  // Ask for the bulk dump
+      break;
+    case askTime:
+      transmitRequest(time, sizeof(time), frameID, stationIndex, 0x00, 0x00);  // Ask for a timestamp
+      break;
+    case askVarCount:
+      transmitRequest(var, sizeof(var), frameID, stationIndex, 0x00, 0x00);  // Ask for the amount of variables measured
+      break;
+    case askName: {
+      /*
+      The satellite station interprets a number as: "the central station wants the name of variable number __",
+      so here we send the number itself as a one-byte message with transmitBytes
+      */
+      byte index = varIndex[stationIndex];
+      transmitBytes(&index, 1, frameID, stationIndex, 0x00, 0x00);  // Ask for the variable name of this number
+      break;
     }
+    case askValue:
+      if (namesKnown[stationIndex]) {
+        // 'N' followed by the variable number asks for just that measurement, without the name first
+        byte request[2] = {(byte)number[0], varIndex[stationIndex]};
+        transmitBytes(request, sizeof(request), frameID, stationIndex, 0x00, 0x00);
+      } else {
+        transmitRequest(number, sizeof(number), frameID, stationIndex, 0x00, 0x00);  // Ask for the recorded measurement
+      }
+      break;
+  }
+}
+
+/*
+This function is called when a dump (or a schema, or a missed reading) didn't come through. It is asked
+for again, up to bulkAttempts times. After that catching up is left for next time, a
+compact dump falls back to the text bulk dump, and
+a bulk dump falls back to the step-by-step handshake. The satellite station goes to sleep once it has
+sent its last measurement that way, so the handshake waits its turn (every station before this one
+finished) in case this station relays for them.
+*/
+void dumpFailed(int stationIndex, uint32_t now) {
+  if (scheduler.retry(stationIndex, now, bulkAttempts)) return;  // Ask for it again
+  if (step[stationIndex] == askCatchUp) {  // If catching up didn't work
+    step[stationIndex] = askCompact;  // then leave the rest on the station for next time
+  } else if (step[stationIndex] != askBulk && useBulk[stationIndex]) {  // If the compact dump didn't work
+    step[stationIndex] = askBulk;  // then try the text bulk dump
+  } else {
+    step[stationIndex] = askTime;  // otherwise ask for each piece step by step
+    scheduler.setInOrder(stationIndex, true);
+  }
+}
+
+/*
+This function adds a dump fragment that just came in from a station to what we have so far. The
+satellite splits each dump across as few messages (fragments) as it can. Each fragment starts with
+the kind of dump ('B', 'C', or 'S') and a sequence number, and the high bit of the sequence number is
+set on the last fragment. A compact dump (or a missed reading) is binary, so it goes in the station's
+record; the others are text and go in its bulkBody. Returns 1 once the last fragment is in, 0 if there's more to come (or the
+message wasn't a fragment we were waiting for), and -1 if a fragment went missing.
+*/
+int8_t addFragment(int stationIndex, byte kind, uint32_t now) {
+  const byte* message = decoder.rfData();
+  int messageSize = decoder.rfDataLength();
+  if (messageSize < 2 || message[0] != kind) return 0;  // Skip anything that isn't a fragment of this dump
+  if ((message[1] & 0x7F) != expectedSeq[stationIndex]) {  // If a fragment went missing
+    if (expectedSeq[stationIndex] == 0) return 0;  // (or this is left over from a dump we already gave up on)
+    dumpFailed(stationIndex, now);
+    return -1;
+  }
+  for (int c = 2; c < messageSize; c++) {  // For each byte in the fragment
+    if (kind == 0x43 || kind == 0x4B) {  // 'C' or 'K'
+      if (recordLength[stationIndex] == maxRecordSize) {  // If it won't fit, we can't use it
+        dumpFailed(stationIndex, now);
+        return -1;
+      }
+      record[stationIndex][recordLength[stationIndex]++] = message[c];
+    } else {
+      bulkBody[stationIndex] += (char)message[c];  // add it to what we have so far
+    }
+  }
+  expectedSeq[stationIndex]++;
+  if (!(message[1] & 0x80)) {  // If there are more fragments on the way
+    scheduler.extend(stationIndex, now, wait * 1000UL);  // then give them time to come in
+    return 0;
+  }
+  return 1;
+}
+
+/*
+This function checks that a compact record from a station can be read with the schema we have for it: the
+schema IDs match, and every value is there.
+*/
+bool recordFitsSchema(int stationIndex, const byte data[], uint8_t length) {
+  RecordReader reader(data, length);
+  if (!reader.isValid() || !schemas[stationIndex].matches(reader.schemaId())) return false;
+  if (reader.varCount() != schemas[stationIndex].varCount()) return false;
+  char value[RECORD_VALUE_TEXT_SIZE];
+  for (uint8_t v = 0; v < reader.varCount(); v++) {
+    if (!reader.nextValue(schemas[stationIndex].format(v), value, sizeof(value))) return false;
+  }
+  return reader.atEnd();
+}
+
+/*
+This function deals with a message that came in from a station, depending on the step it is on.
+*/
+void handleMessage(int stationIndex, uint32_t now) {
+  if (scheduler.status(stationIndex) != StationScheduler::stationWaiting) return;  // We didn't ask this station anything
+  const byte* message = decoder.rfData();
+  int messageSize = decoder.rfDataLength();
+  if (messageSize == 0) return;
+
+  switch (step[stationIndex]) {
+    case askReady:
+      if (message[0] == 0x52) {  // Check if the message was an 'R' (the satellites station's response that it is ready)
+        digitalWrite(greenLED, HIGH);  // Visual cue that contact has been made
+        stationData[stationIndex] += ";";  // Add the semicolon seperator to finish the station framing
+        if (messageSize >= 3) {  // If the station told us which schema its data follows
+          hasAdvert[stationIndex] = true;
+          advertisedSchema[stationIndex] = message[1] | (message[2] << 8);
+        }
+        if (messageSize >= 4) {  // and how many readings we missed
+          backlog[stationIndex] = message[3];
+        }
+        if (messageSize >= 6) {  // and how long it took to answer, work out the round trip
+          uint32_t answeredIn = message[4] | (message[5] << 8);
+          uint32_t sinceSent = millis() - readySentMs[stationIndex];
+          // An answer to an earlier 'R' that was slow to get here would make it look far longer than it is
+          if (sinceSent >= answeredIn && sinceSent - answeredIn < firstBackoff) {
+            roundTrip[stationIndex] = sinceSent - answeredIn;
+          }
+        }
+        // Ask for everything in a single dump first. Only if the station doesn't
+        // answer it do we fall back to asking for each piece step by step
+        bool schemaKnown = hasAdvert[stationIndex] && schemas[stationIndex].matches(advertisedSchema[stationIndex]);
+        if (useCompact[stationIndex] && backlog[stationIndex] > 0) {
+          // Catch up on the missed readings first, getting the names that go with them if we need to
+          step[stationIndex] = schemaKnown ? askCatchUp : askSchema;
+        } else if (useCompact[stationIndex]) {
+          step[stationIndex] = askCompact;
+        } else if (useBulk[stationIndex]) {
+          step[stationIndex] = askBulk;
+        } else if (hasAdvert[stationIndex] && !schemaKnown) {
+          step[stationIndex] = askSchema;  // Get the variable names once, so the handshake only needs the values
+        } else {
+          step[stationIndex] = askTime;
+        }
+        scheduler.answered(stationIndex, now);
+      } else {  // If we received something other than an 'R'
+        endStation(stationIndex, true);
+      }
+      break;
+
+    case askCatchUp:
+      // A missed reading comes as its sequence number followed by its compact record, and an empty
+      // answer means the station has nothing more to send this time
+      if (addFragment(stationIndex, 0x4B, now) != 1) break;  // Wait until the whole reading is in
+      if (recordLength[stationIndex] < 4) {  // If that's all for now
+        step[stationIndex] = askCompact;  // then ask for the current reading
+      } else {
+        uint32_t seq = 0;
+        for (uint8_t b = 0; b < 4; b++) seq |= (uint32_t)record[stationIndex][b] << (8 * b);
+        if (seq == lastCatchUp[stationIndex]) {
+          // It's one we already have (our last 'K' got lost), so just ask again
+        } else if (caughtUpCount == maxCaughtUp) {  // If there's no room left to keep it
+          step[stationIndex] = askCompact;  // then leave it with the station and ask for the current reading
+        } else {
+          // Keep it to send out as its own line, unless it is from before the station's variables changed,
+          // which we can't put names to
+          if (recordFitsSchema(stationIndex, record[stationIndex] + 4, recordLength[stationIndex] - 4)) {
+            memcpy(caughtUp[caughtUpCount], record[stationIndex] + 4, recordLength[stationIndex] - 4);
+            caughtUpLength[caughtUpCount] = recordLength[stationIndex] - 4;
+            caughtUpStation[caughtUpCount] = stationIndex;
+            caughtUpCount++;
+          }
+          lastCatchUp[stationIndex] = seq;  // The next 'K' tells the station we have it
+        }
+      }
+      scheduler.answered(stationIndex, now);
+      break;
+
+    case askCompact:
+      if (addFragment(stationIndex, 0x43, now) != 1) break;  // Wait until the whole compact dump is in
+      if (recordFitsSchema(stationIndex, record[stationIndex], recordLength[stationIndex])) {  // If we already have the schema that goes with it
+        recordDone(stationIndex, now);
+      } else {  // otherwise ask for the variable names that go with the numbers
+        step[stationIndex] = askSchema;
+        scheduler.answered(stationIndex, now);
+      }
+      break;
+
+    case askSchema:
+      if (addFragment(stationIndex, 0x53, now) != 1) break;  // Wait until the whole schema is in
+      schemas[stationIndex].load(bulkBody[stationIndex].c_str(), bulkBody[stationIndex].length());
+      bulkBody[stationIndex] = "";  // We don't need the raw text anymore
+      if (recordLength[stationIndex] == 0) {  // If we asked for it before catching up or the step-by-step handshake
+        if (useCompact[stationIndex]) {  // then catch up if we can read the missed readings now
+          step[stationIndex] = schemas[stationIndex].matches(advertisedSchema[stationIndex]) ? askCatchUp : askCompact;
+        } else {  // or start the handshake, with or without the names
+          step[stationIndex] = askTime;
+        }
+        scheduler.answered(stationIndex, now);
+      } else if (recordFitsSchema(stationIndex, record[stationIndex], recordLength[stationIndex])) {
+        recordDone(stationIndex, now);
+      } else {
+        dumpFailed(stationIndex, now);
+      }
+      break;
+
+    case askBulk:
+      // The satellite packs its data as "timestamp;varCount;code;value;code;value;...;"
+      if (addFragment(stationIndex, 0x42, now) != 1) break;  // Wait until the whole bulk dump is in
+      if (appendBulkData(stationIndex)) {  // If we got it all
+        scheduler.answered(stationIndex, now);
+        bulkBody[stationIndex] = "";  // We don't need the raw text anymore
+        ackOnRelease[stationIndex] = true;  // The station is told it can stop once it is let go
+        endStation(stationIndex, false);
+      } else {
+        dumpFailed(stationIndex, now);
+      }
+      break;
+
+    case askTime:
+      stationData[stationIndex] += "@timestamp=";  // Add the variable name "timestamp" to the String, properly framed
+      appendPayload(stationIndex);  // Add the timestamp in the message to the String we'll be sending
+      stationData[stationIndex] += ";";  // then add on the semicolon seperator
+      step[stationIndex] = askVarCount;
+      scheduler.answered(stationIndex, now);
+      break;
+
+    case askVarCount:
+      varCount[stationIndex] = message[0];  // Store number given in the payload (first byte)
+      varIndex[stationIndex] = 0;
+      if (varCount[stationIndex] == 0) {  // If the station didn't measure anything, there's nothing more to ask
+        scheduler.answered(stationIndex, now);
+        endStation(stationIndex, false);
+        break;
+      }
+      // If the station's schema is the one we have, we already know every variable's name
+      namesKnown[stationIndex] = hasAdvert[stationIndex] &&
+                                 schemas[stationIndex].matches(advertisedSchema[stationIndex]) &&
+                                 schemas[stationIndex].varCount() == varCount[stationIndex];
+      step[stationIndex] = namesKnown[stationIndex] ? askValue : askName;
+      scheduler.answered(stationIndex, now);
+      break;
+
+    case askName:
+      stationData[stationIndex] += "@";  // Record the payload to our String, properly framed
+      appendPayload(stationIndex);
+      stationData[stationIndex] += "=";
+      step[stationIndex] = askValue;  // We will now ask for the actual measurement for this variable
+      scheduler.answered(stationIndex, now);
+      break;
+
+    case askValue:
+      if (namesKnown[stationIndex]) {  // If we didn't ask for the name, add it from the schema
+        stationData[stationIndex] += "@";
+        stationData[stationIndex] += schemas[stationIndex].code(varIndex[stationIndex]);
+        stationData[stationIndex] += "=";
+      }
+      appendPayload(stationIndex);  // Record the payload
+      scheduler.answered(stationIndex, now);
+      if (varIndex[stationIndex] < varCount[stationIndex] - 1) {  // If it's not the last variable sampled
+        stationData[stationIndex] += ";";  // add on the semicolon seperator
+        varIndex[stationIndex]++;  // and ask for the next one
+        step[stationIndex] = namesKnown[stationIndex] ? askValue : askName;
+      } else {  // If it is the last measurement
+        endStation(stationIndex, true);
+      }
+      break;
+  }
+}
+
+/*
+This function deals with a station that didn't answer in time, or whose message the XBee couldn't
+deliver. Asking if it is ready is retried up to totalTries times (until the station's slot closes), and asking for a dump up to
+bulkAttempts times. Once contact has been made the step-by-step handshake isn't retried (the satellite
+station doesn't start over), so we just send what we have.
+*/
+void handleTimeout(int stationIndex, uint32_t now) {
+  switch (step[stationIndex]) {
+    case askReady:
+      // If the station's slot is over (it isn't listening anymore) or we've tried as much as we'd like
+      if ((int32_t)(now - slotCloseMs[stationIndex]) >= 0 || !scheduler.retry(stationIndex, now, totalTries)) {
+        endStation(stationIndex, true);  // then send an empty String for this station
+      }
+      break;
+    case askCatchUp:
+    case askCompact:
+    case askSchema:
+    case askBulk:
+      dumpFailed(stationIndex, now);
+      break;
+    default:
+      scheduler.failed(stationIndex, now);
+      endStation(stationIndex, step[stationIndex] == askValue);  // A missing value still gets its semicolon
+      break;
+  }
+}
+
+/*
+This function lets go of every held station whose turn has come (every station before it is finished).
+A station that sent a bulk dump is told we got it ('A'), after which it goes to sleep. Holding on to a
+station until then keeps it awake in case it relays for the stations farther out. Its data stays where
+it is until sendStations() sends it out once collection is over.
+*/
+void releaseStations() {
+  for (int i = 0; i < numStations; i++) {
+    if (scheduler.status(i) != StationScheduler::stationHeld || !scheduler.canRelease(i)) continue;
+    if (ackOnRelease[i]) {
+      transmitRequest(ack, sizeof(ack), 0x00, i, 0x00, 0x00);  // Let the station know it can stop
+    }
+    scheduler.finish(i);
+  }
+}
+
+/*
+This function sends every station's data to the CR800 once collection is over, farthest station first,
+each station's missed readings ahead of its current one. At 9600 baud a station's line takes about a
+second to go out, and Serial.print() waits for it, so doing this while collecting would leave UART-1's
+64 byte buffer to overflow with whatever the other stations sent in the meantime.
+*/
+void sendStations() {
+  for (int i = 0; i < numStations; i++) {
+    for (uint8_t k = 0; k < caughtUpCount; k++) {
+      if (caughtUpStation[k] != i) continue;
+      Serial.print(stationData[i]);
+      printRecord(i, caughtUp[k], caughtUpLength[k]);
+      Serial.println();
+    }
+    Serial.print(stationData[i]);  // Send out the string over the Serial UART-0 port to the CR800
+    if (recordReady[i]) {  // along with the compact dump, turned back into text
+      printRecord(i, record[i], recordLength[i]);
+    }
+    Serial.println();
+    stationData[i] = "";  // Free up the memory for the next cycle
+  }
+}
+
+/*
+This function keeps the conversations with every station going. It hands everything in UART-1 to the
+decoder and each whole frame to the station it came from, deals with stations that have run out of time,
+lets go of finished stations, and sends out the next message to any station that is due one. It never
+waits on a station, so it should be called over and over until every station is finished.
+*/
+void serviceStations() {
+  uint32_t now = millis();
+  int8_t s;
+
+  while (Serial1.available() > 0) {  // For each byte the XBee has sent us
+    if (decoder.feed(Serial1.read()) != XBeeFrameDecoder::frameReady) continue;  // Wait for a whole frame
+    s = scheduler.stationFor(decoder);  // Work out which station it belongs to
+    if (s < 0) continue;  // Not one of ours (or a transmit status we aren't waiting on)
+    if (decoder.isReceivePacket()) {
+      handleMessage(s, now);
+    } else if (scheduler.deliveryFailed(s, decoder)) {  // The XBee couldn't get our message there
+      handleTimeout(s, now);  // so there's no point waiting for an answer
+    }
+  }
+
+  while ((s = scheduler.nextExpired(now)) >= 0) {  // For each station that took too long to answer
+    handleTimeout(s, now);
+  }
+
+  releaseStations();
+
+  while ((s = scheduler.nextDue(now)) >= 0) {  // For each station that is due a message
+    sendStep(s);
   }
-  delay(100);
 }
 
 // ==========================================================================
@@ -268,16 +860,19 @@ void setup() {
 
   // Waking up the XBee momentarily to clear out anything that could potentially be in the buffer
   digitalWrite(xbeeSleepPin, LOW);  // Driving the sleep pin low wakes the XBee
-  memset(rx, 0x00, sizeof(rx));  // Make sure where we are going to store these potenetial bytes is empty by setting everything to zero
   delay(100);
-  int count = Serial1.available();  // Count how many bytes there are in the UART-1
-  Serial1.readBytes(rx, count);  // Read that many into the buffer (read everything that's there)
-  memset(rx, 0x00, sizeof(rx));  // Clear it out
+  while (Serial1.available() > 0) Serial1.read();  // Throw away everything that's there
   digitalWrite(xbeeSleepPin, HIGH);  // Driving the sleep pin high puts the XBee back to sleep
 
   // Start up the real-time clock (RTC)
   rtc.begin();
 
+  // Let the scheduler know the address of each station so it can tell who each message is from
+  for (int i = 0; i < numStations; i++) {
+    scheduler.setAddress(i, satellites[i]);
+    schemas[i].begin(schemaCodes[i], schemaCodesSize);  // and give it somewhere to keep each station's schema
+  }
+
   // Set the baud (communication) rate between the Mayfly and the CR800 datalogger connected over UART-0
   // Make sure this is compatible with what the CR800 datalogger is expecting (i.e. not too fast for it)
   Serial.begin(9600);
@@ -291,216 +886,65 @@ void setup() {
 // Arduino loop function that continuously runs unless the board shuts off
 // ==========================================================================
 void loop() {
-  if (rtc.now().minute() == 1) {  // If the current minute is on the one
+  uint32_t nowEpoch = rtc.now().getEpoch();
+  uint32_t intoCycle = nowEpoch % cycleLength;  // How many seconds we are into the cycle
+  // If the first slot is about to open, the last one hasn't closed, and we haven't collected this cycle
+  if (intoCycle + 2 >= firstSlot && intoCycle < slotCloses(numStations - 1) && nowEpoch - intoCycle != prevCycle) {
     timeToLog = true;  // then it's time to log and collect new data
   }
 
   if (timeToLog) {  // If it's time to log
+    prevCycle = nowEpoch - intoCycle;  // Keep track of the cycle since we are now logging
     digitalWrite(xbeeSleepPin, LOW);  // Wake the XBee up
     digitalWrite(redLED, HIGH);  // Turn on the red LED as a visually cue that radio communication has started
     delay(1000);  // Let the XBee's stomach settle
 
     // Clear out the UART-1 received storage so there is no confusion
-    memset(rx, 0x00, sizeof(rx));  // Make sure where we are going to store things is empty
-    Serial1.readBytes(rx, Serial1.available());  // Read in everything in UART-1
-    memset(rx, 0x00, sizeof(rx));  // Wipe it out
-
-    /*
-    // Set the dataSent boolean array to all falses to start out because no data has been sent
-    for (int i = 0; i < sizeof(dataSent); i++) {
-      dataSent[i] = false;
+    while (Serial1.available() > 0) Serial1.read();  // Throw away everything in UART-1
+    decoder.reset();  // along with anything the decoder had started putting together
+
+    // Line millis() up with the start of a second on the RTC, so the slots and the time we send the
+    // stations are as close to our clock as we can get them. Reading it once a millisecond is close
+    // enough, and leaves the I2C bus alone the rest of the time.
+    uint32_t epoch = rtc.now().getEpoch();
+    while (rtc.now().getEpoch() == epoch) delay(1);
+    cycleStartEpoch = prevCycle;
+    cycleStartMs = millis() - (epoch + 1 - prevCycle) * 1000UL;
+
+    // Get every station ready for a new round of collection
+    for (int i = 0; i < numStations; i++) {
+      stationData[i] = "@station=" + stationNames[i];  // Start the String with the station's name, properly framed
+      step[i] = askReady;
+      ackOnRelease[i] = false;
+      recordReady[i] = false;
+      recordLength[i] = 0;
+      hasAdvert[i] = false;
+      namesKnown[i] = false;
+      backlog[i] = 0;
+      lastCatchUp[i] = 0;
+      // A station that can't do a bulk dump goes through the whole step-by-step handshake in one go
+      // and then goes to sleep, so it waits its turn behind every station before it
+      scheduler.setInOrder(i, !useBulk[i]);
     }
-    */ 
-
-    // This boolean array helps keep track of which stations got to have their maximum attempts at communication
-    // much like the dataSent array.
-    bool didTotalTries[numStations];
-
-    // Set the boolean array to all falses since no tries have been attempted yet
-    for (int u = 0; u < numStations; u++) {
-      didTotalTries[u] = false;
+    caughtUpCount = 0;
+    scheduler.begin(millis());
+    // Each station is asked if it is ready once its slot opens
+    for (int i = 0; i < numStations; i++) {
+      scheduler.startAt(i, cycleStartMs + slotOpens(i) * 1000UL);
+      slotCloseMs[i] = cycleStartMs + slotCloses(i) * 1000UL;
     }
-    
-    // We will now attempt to collect data from each station
-    for (int i = 0; i < numStations; i++) {  // For each station
-      delay(1000);
-      int tries = 0;  // start off with a clean slate of no tries attempted yet
-      while (!didTotalTries[i]) {  // While we haven't used up all the tries we specified
-        greenredflash(i);  // Visual cue that we are attempting contact with station "i"
-        digitalWrite(redLED, HIGH);  // Make sure the red LED stays on
-        tries++;  // Add a try to our count
-        stringToSend = "";  // Prep an empty String that will contain all the data
-        transmitRequest(ready, sizeof(ready), 0x00, i, 0x00, 0x00);  // Ask if station "i" is ready
-        waitForReceive(wait);  // Give a chance for the satellite to respond (the XBees take care of retries)
-
-        if (Serial1.available() > 0) {  // If there is something in the UART-1, that means we've received a message, because we cleared it out a few lines ago
-          // We have established contact, and even if something happens and we can't get everything or communications goes down, we don't want to try and reach out again from the beginning. We'll just abandon mission
-          // More robust communication protocols could be established. That would require changing the coding on the satellite station end of things as well
-          // From this point on, we will not try to reach out to the station again if something happens in the middle of collecting its data, hence setting didTotalTries[i] to true
-          didTotalTries[i] = true;
-          delay(100);  // Give a chance for everything to come in
-		      int count = Serial1.available();  // Count up how many bytes are there
-          Serial1.readBytes(rx, count);  // Read in everything that was there
-		  
-          if (rx[15] == 0x52) {  // Check if byte 15 was an 'R' (the satellites station's response that it is ready)
-            digitalWrite(greenLED, HIGH);  // Visual cue that contact has been made
-            memset(rx, 0x00, sizeof(rx));  // If so, clear out the buffer
-            stringToSend += "@station=";  // Add the variable name "station" to the String, properly framed
-            stringToSend += stationNames[i];  // Add the station's name to the String
-            stringToSend += ";";  // Add the semicolon seperator to finish the framing
-            delay(500);
-
-            transmitRequest(time, sizeof(time), 0x00, i, 0x00, 0x00);  // Ask for a timestamp
-
-            delay(500);
-            digitalWrite(greenLED, LOW);  // Turn the green LED off
-            waitForReceive(wait);  // Give a chance for the satellite to respond
-			
-            if (Serial1.available() > 0) {  // If we received something
-			        delay(100);  // Give a chance for everything to come in
-              count = Serial1.available();  // Count up the bytes received
-              Serial1.readBytes(rx, count);  // then read in the new message to our buffer
-			  
-			        // Adding the timestamp data
-              stringToSend += "@timestamp=";  // Add the variable name "timestamp" to the String, properly framed
-              for (int z = 15; z < count - 1; z++) {  // For every byte in the message portion of the received XBee frame (bytes 15 to the second-to-last byte)
-                stringToSend += (char)rx[z];  // Convert each byte to a char and tack it onto the String we'll be sending
-                if (z == count - 2) {  // If we've come to the last byte of interest
-                  stringToSend += ";";  // then add on the semicolon seperator
-                }
-              }
-			  
-              memset(rx, 0x00, sizeof(rx));  // Clear out the buffer
-			  
-              transmitRequest(var, sizeof(var), 0x00, i, 0x00, 0x00);  // Ask for the amount of variables measured
-              waitForReceive(wait);  // Wait for a response
-			  
-              if (Serial1.available() > 0) {  // If we got a response
-			          delay(100);  // Give a chance for every byte to come in
-                int count = Serial1.available();  // Count up how many bytes came in
-                Serial1.readBytes(rx, count);  // Read in the bytes to our buffer
-                int varCount = rx[15];  // Store number given in the payload (15th byte) in the varCount variable
-
-                // I'm not certain the while (gettingDataVaules) loop is necessary
-                //bool gettingDataValues = true;
-                //while (gettingDataValues) {
-                for (int b = 0; b < varCount; b++) {  // For each variable measured by the satellite station
-                  memset(rx, 0x00, sizeof(rx));  // Make space for the variable name we anticipate receiving first in the buffer
-
-                  /*
-                  The transmitRequest function takes in a char array as the message, not a number value,
-                  and we want to send over an actual number that the satellite station will interepret as: 
-                  "the central station wants the name of variable number __",
-                  so here we will just customize a transmit request frame to request that
-                  */
-                  int sum = 0;  // Checksum value
-                  sum += 0x10;  // Add the byte value of the frame type
-                  sum += 0x00;  // Add the byte value of the frame ID
-                  
-                  // Add the byte values of the address
-                  for (int x = 0; x <= sizeof(satellites[i]) - 1; x++) {
-                    sum += satellites[i][x];
-                  }
-                  
-                  sum += 0x00;  // Add the broadcast radius
-                  sum += 0x00;  // Add the options
-                  sum += b;  // Add the payload (the variable number being requested)
-
-                  sum = (255 - (sum % 256));  // Calculate the checksum
-
-                  // Send the transmit request frame to the XBee asking for the variable name of this number "b"
-                  Serial1.write(0x7E);  // Starting delimeter
-                  Serial1.write(0x00);  // Length MSB
-                  Serial1.write(0x0F);  // Length LSB
-                  Serial1.write(0x10);  // Frame type (transmit request)
-                  Serial1.write(0x00);  // Frame ID (0x00 means we don't want a response frame that tells us if a connection was made)
-                  Serial1.write(satellites[i], 10);  // Destination address of the satellite station
-                  Serial1.write(0x00);  // Broadcast radius
-                  Serial1.write(0x00);  // Options
-                  Serial1.write(byte(b));  // Message (here it is just the variable number we are requesting)
-                  Serial1.write(byte(sum));  // Checksum
-
-                  waitForReceive(wait);  // Wait for a response
-
-                  if (Serial1.available() == 0) {  // If we didn't hear anything
-                    //gettingDataValues = false;
-                    stringToSend += "@endofstation=1;";  // Properly end the String
-                    Serial.println(stringToSend);  // Send what we have to the CR800
-                    break;  // Stop what we're doing in this for loop
-                  } else {  // If we did hear something
-                    int count = Serial1.available();  // Count up what's waiting
-                    Serial1.readBytes(rx, count);  // Read in the XBee frame
-                    
-                    // Record the payload to our String
-                    stringToSend += "@";
-                    for (int c = 15; c < count - 1; c++) {  // For each byte in the payload section of the received message
-                      stringToSend += (char)rx[c];  // convert the byte into a character and add it to the String
-                      if (c == count - 2) {  // If this is the last byte
-                        stringToSend += "=";  // then add the semicolon separator
-                      }
-                    }
-
-                    // We will now ask for the actual measurement sampled for variable "b"
-                    memset(rx, 0x00, sizeof(rx));  // Make some space for a new message
-
-                    transmitRequest(number, sizeof(number), 0x00, i, 0x00, 0x00);  // Ask for the recorded measurement
-
-                    waitForReceive(wait);  // Wait for a response
-
-                    if (Serial1.available() == 0) {  // If we didn't receive anything
-                      //gettingDataValues = false;
-                      stringToSend += ";@endofstation=1;";  // Properly end the String
-                      Serial.println(stringToSend);  // Send what we have to the CR800
-                      break;  // Stop asking for the next variable "b" by breakin the current for loop
-                    } else {  // If we did hear something
-                      count = Serial1.available();  // Count up what's waiting
-                      Serial1.readBytes(rx, count);  // Read in the XBee frame
-
-                      // Record the payload
-                      for (int d = 15; d < count - 1; d++) {  // For each byte in the payload portion of the frame
-                        stringToSend += (char)rx[d];  // convert the byte to a character and add it to the String
-                      }
-
-                      if (b != varCount - 1) {  // If it's not the last variable sampled
-                        stringToSend += ";";  // add on the semicolon seperator
-                      } else {  // If it is the last measurement
-                        stringToSend += ";@endofstation=1;";  // Properly end the String
-                        Serial.println(stringToSend);  // Send out the string over the Serial UART-0 port to the CR800
-                        //gettingDataValues = false;  // We no longer need to collect data values
-                        //dataSent[i] = true;  // and we can mark that this station has sent all its data.
-                        greenredflash(10);  // Visual cue that a successful transmission was made
-                        digitalWrite(redLED, HIGH);  // Make sure the red LED stays on
-                      }
-                    }
-                  }
-                }
-                //}
-              } else {  // If we didn't receive a variable count
-                stringToSend += "@endofstation=1;";  // Properly end the String
-                Serial.println(stringToSend);  // Send what we have to the CR800
-              }
-            } else {  // If we didn't receive a timestamp
-              stringToSend += "@endofstation=1;";  // Properly end the String
-              Serial.println(stringToSend);  // Send what we have to the CR800
-            }
-          } else {  // If we received something other than an 'R'
-            memset(rx, 0x00, sizeof(rx));  // then get rid of it
-            stringToSend += "@station=";  // Add the variable name "station" to the String, properly framed
-            stringToSend += stationNames[i];  // Add the station's name to the String
-            stringToSend += ";@endofstation=1;";  // Properly end the String
-            Serial.println(stringToSend);  // Send over to CR800
-          }
-        }
-        if (tries == totalTries && didTotalTries[i] != true) {  // If we've tried as much as we'd like and we haven't successfully made contact
-          didTotalTries[i] = true;  // then take note of it for this station so it doesn't try again
-          stringToSend += "@station=";  // Add the variable name "station" to the String, properly framed
-          stringToSend += stationNames[i];  // Add the station's name to the String
-          stringToSend += ";@endofstation=1;";  // Properly end the String
-          Serial.println(stringToSend);  // Send over to CR800
-        }
-      }
+
+    // We will now collect data from every station at once, farthest first. Nothing in here waits on a
+    // single station, so one that is slow to answer doesn't hold up the others. The XBee only has a small
+    // buffer in the Mayfly, so keep anything slow (like delay() or Serial.print()) out of this loop.
+    while (!scheduler.allFinished()) {
+      serviceStations();
     }
+    sendStations();  // Now that the radio can wait, send everything we got to the CR800
+
     // At this point, we have made contact or made every attempt to contact each station
+    digitalWrite(greenLED, LOW);  // Turn the green LED off
+    greenredflash(10);  // Visual cue that collection is over
     digitalWrite(xbeeSleepPin, HIGH);  // Put the XBee back to sleep
     timeToLog = false;  // We don't want to log until the right conditions again
     digitalWrite(redLED, LOW);  // Turn off the red LED
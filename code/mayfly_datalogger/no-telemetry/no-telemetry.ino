@@ -51,6 +51,10 @@
 // We can create a serial port on one of the digital pins using this software
 #include <AltSoftSerial.h> 
 
+// The binary log keeps a compact copy of every measurement on the microSD card
+#include <BinaryLog.h>
+#include <SdRecordStore.h>
+
 
 // ==========================================================================
 // Defines for the Arduino IDE
@@ -141,19 +145,19 @@ MaximDS3231 ds3231(1);
  * consult the wiring guide on the GitHub page before including this 
  * measurement; otherwise, it is best to remove it
 */
-# include <Adafruit_ADS1015.h>
+#include <sensors/ADS1x15Manager.h>
+
+const uint8_t batteryI2CAddress = 0x49;  // Hexidecimal address of ADC that is taking the measurement
+const uint8_t posBatChannel = 3;  // Channel on ADC the battery is connected to
+// The battery's channel is registered in setup() along with the Apogee sensors' channels, so it is
+// converted in the same sweep as theirs
+uint8_t batteryChannel = ADS1X15_NO_CHANNEL;
 
 float calculateBatteryVoltage(void) {
   float res1 = 100;  // resistor value in kOhms that comes directly off the battery
   float res2 = 22;   // resistor value in kOhms that connects directly into ground
-  uint8_t i2cAddress = 0x49;  // Hexidecimal address of ADC that is taking the measurement
-  uint8_t posBatChannel = 3;  // Channel on ADC the battery is connected to
-  float inputVar1 = -9999;
+  float inputVar1 = ADS1x15Manager::shared.readVoltage(batteryChannel);
   float calculatedResult = -9999;
-  Adafruit_ADS1115 ads(i2cAddress);
-  ads.setGain(GAIN_ONE);
-  ads.begin();
-  inputVar1 = ads.readADC_SingleEnded_V(posBatChannel);
   if (inputVar1 < 4.096 && inputVar1 > 0) {
     calculatedResult = inputVar1 / (res2 / (res2 + res1));
   } else {
@@ -213,6 +217,10 @@ const uint8_t sonarNumReadings = 3;
 // Construct the sensor
 MaxBotixSonar sonar(sonarSerial, sonarHeight, sonarPower, sonarTrigger, sonarNumReadings);
 
+// Record the median of the readings rather than their mean, so one spurious
+// echo can't skew the recorded range
+SampleReducer<sonarNumReadings> sonarMedian(MS_REDUCE_MEDIAN);
+
 // Each variable that we want to report needs to be "constructed" as well.
 // For this sensor it will include the range the sonar detected (in millimeters)
 // and the calculated snow depth (based on the sonar height and the range measured).
@@ -221,14 +229,18 @@ MaxBotixSonar sonar(sonarSerial, sonarHeight, sonarPower, sonarTrigger, sonarNum
 Variable* sonarRange =
     new MaxBotixSonar_Range(&sonar, "12345678-abcd-1234-ef00-1234567890ab");
 
+// The variables the snow depth is calculated from, in the order they are
+// handed to the calculation
+Variable* snowDepthInputs[] = {sonarRange};
+
 // This function calculates the depth of snow
-float calculateSnowDepth(void) {
+float calculateSnowDepth(const float* inputs) {
     // Set a NoData value for reporting errors
     float calculatedResult = -9999;
     // The first variable input is the sonar height  
     float inputVar1 = sonarHeight;  
     // The second variable input is the sonar range measured
-    float inputVar2 = sonarRange->getValue();  
+    float inputVar2 = inputs[0];  
     // Make sure both inputs are good
     // A reading of 5000 is an error for the sensor as well
     // It may seem odd to check if the first input variable isn't -9999 because it is 
@@ -254,8 +266,9 @@ const char* calculatedSnowDepthCode = "snowDepth";
 const char* calculatedSnowDepthUUID = "12345678-abcd-1234-ef00-1234567890ab";
 
 Variable* calculatedSnowDepth = new Variable(
-    calculateSnowDepth, calculatedSnowDepthResolution, calculatedSnowDepthName,
-    calculatedSnowDepthUnit, calculatedSnowDepthCode, calculatedSnowDepthUUID);
+    calculateSnowDepth, snowDepthInputs, 1, calculatedSnowDepthResolution,
+    calculatedSnowDepthName, calculatedSnowDepthUnit, calculatedSnowDepthCode,
+    calculatedSnowDepthUUID);
 
 
 /* ** IMPORTANT ** 
@@ -592,6 +605,26 @@ VariableArray varArray(variableCount, variableList);
 Logger dataLogger;
 
 
+// ==========================================================================
+// The Binary Log
+// ==========================================================================
+/*
+Alongside the usual CSV file, the station can keep each measurement in a binary log file (see
+BinaryLog.h in the SnowRadio library). A record there takes 4 bytes per value instead of a line of
+text, and each logging interval costs the card a single sector write. The file is named for the logger
+and the schema ID, which changes whenever the variables do, so changing the variables starts a new file.
+Copy the file off the card and turn it into CSV with utilities/binlog_to_csv, which can also pull out
+just a range of dates without reading the whole file. Set this to false to only keep the CSV file.
+*/
+const bool binaryLogging = true;
+
+char binaryLogName[32];  // Filled in by beginBinaryLog()
+SdRecordStore binaryLogFile(binaryLogName);
+BinaryLog binaryLog(binaryLogFile);
+bool binaryLogReady = false;
+uint8_t binaryLogUpdate;  // The variable array's update count when the last record was logged
+
+
 // ==========================================================================
 // Working Functions
 // ==========================================================================
@@ -613,6 +646,57 @@ void greenredflash(uint8_t numFlash = 4, uint8_t rate = 75) {
 }
 
 
+// Starts the binary log, writing its header if the file is new
+void beginBinaryLog() {
+  uint8_t varCount = dataLogger.getArrayVarCount();
+  SchemaHash hash;
+  for (uint8_t i = 0; i < varCount; i++) {
+    hash.add(dataLogger.getVarCodeCharAtI(i));
+    hash.add(dataLogger.getVarUnitAtI(i).c_str());
+    hash.add(dataLogger.getVarResolutionAtI(i));
+    hash.add(binaryLogFormat(dataLogger.getVarResolutionAtI(i)));
+  }
+  // The schema text, "schemaID;varCount;code;format;code;format;...;"
+  String schema;
+  schema += hash.value();
+  schema += ';';
+  schema += varCount;
+  schema += ';';
+  for (uint8_t i = 0; i < varCount; i++) {
+    schema += dataLogger.getVarCodeCharAtI(i);
+    schema += ';';
+    schema += binaryLogFormat(dataLogger.getVarResolutionAtI(i));
+    schema += ';';
+  }
+  snprintf(binaryLogName, sizeof(binaryLogName), "%s_%04X.bin", LoggerID, hash.value());
+
+  binaryLogReady = dataLogger.beginSDCard() && binaryLogFile.begin(0) &&
+                   binaryLog.begin(hash.value(), schema.c_str(), schema.length(), varCount,
+                                   Logger::getLoggerTimeZone());
+  dataLogger.turnOffSDcard(true);
+  binaryLogUpdate = varArray.getUpdateCount();
+  if (binaryLogReady) {
+    Serial.print(F("Keeping a binary log in "));
+    Serial.println(binaryLogName);
+  } else {
+    Serial.println(F("Unable to start the binary log!"));
+  }
+}
+
+// Adds the latest measurements to the binary log once each time the sensors finish an update
+void logBinaryRecord() {
+  if (!binaryLogReady || varArray.getUpdateCount() == binaryLogUpdate) return;
+  binaryLogUpdate = varArray.getUpdateCount();
+  if (!dataLogger.beginSDCard()) return;
+  binaryLog.beginRecord(Logger::markedLocalEpochTime);
+  for (uint8_t i = 0; i < dataLogger.getArrayVarCount(); i++) {
+    binaryLog.addValue(dataLogger.getValueAtI(i));
+  }
+  if (!binaryLog.endRecord()) Serial.println(F("Unable to write to the binary log!"));
+  dataLogger.turnOffSDcard(true);
+}
+
+
 // ==========================================================================
 // Arduino Setup Function
 // ==========================================================================
@@ -662,15 +746,20 @@ void setup() {
   // Set up the sensors
   Serial.println(F("Setting up sensors..."));
   varArray.setupSensors();
+  batteryChannel = ADS1x15Manager::shared.addSingleEnded(batteryI2CAddress, posBatChannel, GAIN_ONE);
 
   // Create the log file, adding the default header to it
   // Do this last so we have the best chance of getting the time correct and
   // all sensor names correct
   dataLogger.createLogFile(true);  // true = write a new header
+  if (binaryLogging) beginBinaryLog();
 
   // Call the processor sleep
   dataLogger.systemSleep();
 
+  // Have the sonar report the median of its readings
+  sonar.setReducer(HRXL_VAR_NUM, &sonarMedian);
+
   // Begin the MaxBotix's serial communication
   sonarSerial.begin(9600);
 }
@@ -703,4 +792,6 @@ void loop() {
   }
   // During logData, the marked time will update when a new measurement is taken
   dataLogger.logData();  
+  // Copy a new measurement into the binary log (this runs once the logger wakes back up)
+  logBinaryRecord();
 }
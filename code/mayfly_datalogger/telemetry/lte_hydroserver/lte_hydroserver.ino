@@ -197,19 +197,19 @@ MaximDS3231 ds3231(1);
  * consult the wiring guide on the GitHub page before including this 
  * measurement; otherwise, it is best to remove it
 */
-# include <Adafruit_ADS1015.h>
+#include <sensors/ADS1x15Manager.h>
+
+const uint8_t batteryI2CAddress = 0x49;  // Hexidecimal address of ADC that is taking the measurement
+const uint8_t posBatChannel = 3;  // Channel on ADC the battery is connected to
+// The battery's channel is registered in setup() along with the Apogee sensors' channels, so it is
+// converted in the same sweep as theirs
+uint8_t batteryChannel = ADS1X15_NO_CHANNEL;
 
 float calculateBatteryVoltage(void) {
   float res1 = 100;  // resistor value in kOhms that comes directly off the battery
   float res2 = 22;  // resistor value in kOhms that connects directly into ground
-  uint8_t i2cAddress = 0x49;  // Hexidecimal address of ADC that is taking the measurement
-  uint8_t posBatChannel = 3;  // Channel on ADC the battery is connected to
-  float inputVar1 = -9999;
+  float inputVar1 = ADS1x15Manager::shared.readVoltage(batteryChannel);
   float calculatedResult = -9999;
-  Adafruit_ADS1115 ads(i2cAddress);
-  ads.setGain(GAIN_ONE);
-  ads.begin();
-  inputVar1 = ads.readADC_SingleEnded_V(posBatChannel);
   if (inputVar1 < 4.096 && inputVar1 > 0) {
     calculatedResult = inputVar1 / (res2 / (res2 + res1));
   } else {
@@ -269,6 +269,10 @@ const uint8_t sonarNumReadings = 3;
 // Construct the sensor
 MaxBotixSonar sonar(sonarSerial, sonarHeight, sonarPower, sonarTrigger, sonarNumReadings);
 
+// Record the median of the readings rather than their mean, so one spurious
+// echo can't skew the recorded range
+SampleReducer<sonarNumReadings> sonarMedian(MS_REDUCE_MEDIAN);
+
 // Each variable that we want to report needs to be "constructed" as well.
 // For this sensor it will include the range the sonar detected (in millimeters)
 // and the snow depth (calculated based on the sonar height and the range measured).
@@ -277,14 +281,18 @@ MaxBotixSonar sonar(sonarSerial, sonarHeight, sonarPower, sonarTrigger, sonarNum
 Variable* sonarRange =
     new MaxBotixSonar_Range(&sonar, "12345678-abcd-1234-ef00-1234567890ab");
 
+// The variables the snow depth is calculated from, in the order they are
+// handed to the calculation
+Variable* snowDepthInputs[] = {sonarRange};
+
 // This function calculates the depth of snow
-float calculateSnowDepth(void) {
+float calculateSnowDepth(const float* inputs) {
     // Set a NoData value for reporting errors
     float calculatedResult = -9999;
     // The first variable input is the sonar height
     float inputVar1 = sonarHeight;
     // The second variable input is the sonar range measured
-    float inputVar2 = sonarRange->getValue();
+    float inputVar2 = inputs[0];
     // Make sure both inputs are good
     // A reading of 5000 is an error for the sensor as well
     // It may seem odd to check if the first input variable isn't -9999 because it is 
@@ -310,8 +318,9 @@ const char* calculatedSnowDepthCode = "snowDepth";
 const char* calculatedSnowDepthUUID = "12345678-abcd-1234-ef00-1234567890ab";
 
 Variable* calculatedSnowDepth = new Variable(
-    calculateSnowDepth, calculatedSnowDepthResolution, calculatedSnowDepthName,
-    calculatedSnowDepthUnit, calculatedSnowDepthCode, calculatedSnowDepthUUID);
+    calculateSnowDepth, snowDepthInputs, 1, calculatedSnowDepthResolution,
+    calculatedSnowDepthName, calculatedSnowDepthUnit, calculatedSnowDepthCode,
+    calculatedSnowDepthUUID);
 
 
 /* ** IMPORTANT ** 
@@ -655,10 +664,20 @@ Logger dataLogger;
 // You can get this encoding at https://www.base64encode.org/
 const char* base64Authorization = "YOUR_ENCODED_CREDENTIALS_HERE";  
 
+// Only wake the modem to send every few logging intervals. The intervals in
+// between are held in memory and all sent together in one session, which saves
+// most of the power the modem would use attaching to the network each time.
+// sendOffset picks which interval of each group is sent on (0 is the first),
+// so stations sharing a tower can be spread out. If the held intervals fill
+// up, they are sent right away instead. The default MS_HYDROSERVER_CACHE_SIZE
+// holds 5 intervals of the 31 variables below; raise it to send less often.
+const uint8_t sendEveryX = 5;  // With 3-minute logging, send every 15 minutes
+const uint8_t sendOffset = 0;
+
 // Create a data publisher for the HydroServer POST endpoint
 #include <publishers/HydroServer.h>
 HydroServerPublisher HydroServerPOST(dataLogger, &modem.gsmClient,
-                                 base64Authorization);
+                                 base64Authorization, sendEveryX, sendOffset);
 
 
 // ==========================================================================
@@ -740,6 +759,7 @@ void setup() {
   // Set up the sensors, except at lowest battery level
   Serial.println(F("Setting up sensors..."));
   varArray.setupSensors();
+  batteryChannel = ADS1x15Manager::shared.addSingleEnded(batteryI2CAddress, posBatChannel, GAIN_ONE);
 
   // Set up the cellular modem
   modem.setModemWakeLevel(HIGH);   // ModuleFun Bee inverts the signal
@@ -777,6 +797,9 @@ void setup() {
   Serial.println(F("Putting processor to sleep\n"));
   dataLogger.systemSleep();
 
+  // Have the sonar report the median of its readings
+  sonar.setReducer(HRXL_VAR_NUM, &sonarMedian);
+
   // Begin the MaxBotix's serial communication
   sonarSerial.begin(9600);
 }
@@ -62,6 +62,15 @@
 // We can create a serial port on one of the digital pins using this software
 #include <AltSoftSerial.h> 
 
+// Builds and reads the XBee API frames (found in the SnowRadio library folder)
+#include <XBeeFrame.h>
+#include <XBeeReceiver.h>
+#include <MeasurementRecord.h>
+#include <RecordQueue.h>
+#include <SdRecordStore.h>
+#include <SlotSchedule.h>
+#include <ClockSync.h>
+
 
 // ==========================================================================
 // Defines for the Arduino IDE
@@ -158,19 +167,19 @@ MaximDS3231 ds3231(1);
  * consult the wiring guide on the GitHub page before including this 
  * measurement; otherwise, it is best to remove it
 */
-# include <Adafruit_ADS1015.h>
+#include <sensors/ADS1x15Manager.h>
+
+const uint8_t batteryI2CAddress = 0x49;  // Hexidecimal address of ADC that is taking the measurement
+const uint8_t posBatChannel = 3;  // Channel on ADC the battery is connected to
+// The battery's channel is registered in setup() along with the Apogee sensors' channels, so it is
+// converted in the same sweep as theirs
+uint8_t batteryChannel = ADS1X15_NO_CHANNEL;
 
 float calculateBatteryVoltage(void) {
   float res1 = 100;  // resistor value in kOhms that comes directly off the battery
   float res2 = 22;  // resistor value in kOhms that connects directly into ground
-  uint8_t i2cAddress = 0x49;  // Hexidecimal address of ADC that is taking the measurement
-  uint8_t posBatChannel = 3;  // Channel on ADC the battery is connected to
-  float inputVar1 = -9999;
+  float inputVar1 = ADS1x15Manager::shared.readVoltage(batteryChannel);
   float calculatedResult = -9999;
-  Adafruit_ADS1115 ads(i2cAddress);
-  ads.setGain(GAIN_ONE);
-  ads.begin();
-  inputVar1 = ads.readADC_SingleEnded_V(posBatChannel);
   if (inputVar1 < 4.096 && inputVar1 > 0) {
     calculatedResult = inputVar1 / (res2 / (res2 + res1));
   } else {
@@ -226,6 +235,10 @@ const uint8_t sonarNumReadings = 3;
 // Construct the sensor
 MaxBotixSonar sonar(sonarSerial, sonarHeight, sonarPower, sonarTrigger, sonarNumReadings);
 
+// Record the median of the readings rather than their mean, so one spurious
+// echo can't skew the recorded range
+SampleReducer<sonarNumReadings> sonarMedian(MS_REDUCE_MEDIAN);
+
 // Each variable that we want to report needs to be "constructed" as well.
 // For this sensor it will include the range the sonar detected (in millimeters)
 // and the snow depth (calculated based on the sonar height and the range measured).
@@ -234,14 +247,18 @@ MaxBotixSonar sonar(sonarSerial, sonarHeight, sonarPower, sonarTrigger, sonarNum
 Variable* sonarRange =
     new MaxBotixSonar_Range(&sonar, "12345678-abcd-1234-ef00-1234567890ab");
 
+// The variables the snow depth is calculated from, in the order they are
+// handed to the calculation
+Variable* snowDepthInputs[] = {sonarRange};
+
 // This function calculates the depth of snow
-float calculateSnowDepth(void) {
+float calculateSnowDepth(const float* inputs) {
     // Set a NoData value for reporting errors
     float calculatedResult = -9999;
     // The first variable input is the sonar height
     float inputVar1 = sonarHeight;
     // The second variable input is the sonar range measured
-    float inputVar2 = sonarRange->getValue();
+    float inputVar2 = inputs[0];
     // Make sure both inputs are good
     // A reading of 5000 is an error for the sensor as well
     // It may seem odd to check if the first input variable isn't -9999 because it is 
@@ -267,8 +284,9 @@ const char* calculatedSnowDepthCode = "snowDepth";
 const char* calculatedSnowDepthUUID = "12345678-abcd-1234-ef00-1234567890ab";
 
 Variable* calculatedSnowDepth = new Variable(
-    calculateSnowDepth, calculatedSnowDepthResolution, calculatedSnowDepthName,
-    calculatedSnowDepthUnit, calculatedSnowDepthCode, calculatedSnowDepthUUID);
+    calculateSnowDepth, snowDepthInputs, 1, calculatedSnowDepthResolution,
+    calculatedSnowDepthName, calculatedSnowDepthUnit, calculatedSnowDepthCode,
+    calculatedSnowDepthUUID);
 
 
 /* ** IMPORTANT ** 
@@ -661,14 +679,111 @@ byte lowAddress[] = {0xFF, 0xFE};
 char ready[] = "R";
 char error[] = "E";
 
+// The number of message bytes we have sent the base station this session, to keep an eye on airtime
+uint32_t radioBytesSent = 0;
+
+// The base station may ask for all of our data in a single bulk dump ('B') rather than step by step.
+// The dump is split into fragments, and this is the number of payload bytes in each one. It
+// is well under what the XBee can send in one transmission and small enough for the base station's buffer.
+const uint8_t bulkFragmentSize = 64;
+
+// The most dumps we will send in one session if the base station keeps asking for more. A compact
+// dump followed by its schema counts as two, so this leaves room for a retry and a text dump.
+const uint8_t maxBulkDumps = 5;
+
+// The ID of this station's schema (the list of variables and how their values are packed in a compact
+// dump). It is worked out in setup() from the UUID, unit, and resolution of every variable, so it changes
+// by itself whenever the variables do. We tell the base station our schema ID each time it makes contact,
+// and it keeps a copy of each station's schema so the variable UUIDs are only sent again when this changes.
+uint16_t schemaID;
+
+// How long to wait (in seconds) for the base station's reply after sending a bulk dump. The base
+// station collects from several stations at once, and it holds off on telling us we're done ('A')
+// until every station farther out than us has finished, in case we are relaying their messages.
+const uint32_t bulkReplyWait = 600;
+
+// Each logging interval's reading is also saved in a queue file on the SD card until the base station tells
+// us it has it, so nothing is lost if the base station misses us for a while (or is down for a few days).
+// This is the number of readings the queue holds (a week of hourly readings); once it is full, the oldest
+// reading the base station never got is written over. It is still in the log file either way.
+const uint16_t queueSlots = 168;
+
+// The most missed readings we will send in one session. After an outage the base station catches up a few
+// readings each logging interval, so we aren't kept awake for hours the first time it hears from us again.
+const uint8_t maxCatchUp = 6;
+
+/*
+The base station contacts each station in a slot of its own every logging interval, and tells us our slot
+and the time on its clock every time it does. We only turn the radio on for our slot, with a guard time on
+either side that covers how far our clock could have drifted from the base station's since we last heard
+it. The drift between the clocks is measured each time we hear the base station, so the guard time
+narrows over the first few days. Until we know our slot (after a restart, or after missing the base
+station maxMissedSlots logging intervals in a row, in case our slot changed), we listen from listenFrom
+seconds after the reading for up to listenFor seconds.
+*/
+const uint16_t listenFrom = 60;  // seconds into the logging interval
+const uint16_t listenFor = 600;  // seconds
+const uint8_t minGuard = 2;  // The least guard time on either side of the slot (seconds)
+const uint16_t maxDriftPpm = 100;  // The most our clock could drift from the base station's before it's measured (parts per million)
+const uint8_t maxMissedSlots = 3;
+
+SlotTimer slotTimer(loggingInterval * 60UL, listenFrom, listenFrom + listenFor, minGuard, maxDriftPpm, maxMissedSlots);
+bool slotPending = false;  // Whether there is a reading waiting for our next slot
+uint32_t slotOpen;  // When to turn the radio on for the slot (local epoch time)
+uint32_t slotClose;  // When to turn it off again if we don't hear the base station
+uint32_t radioOnMs;  // How long the radio was on for this session
+
+/*
+The base station also sends the time on its clock to the millisecond with each 'R', so we can keep our clock
+set to it and every station's readings line up. It sends how long the last round trip to us took too, and we
+take the 'R' to have been on its way for half of that. Once our clock is clockStepMs or more off, we step
+it to the base station's at the end of the session. A step of more than clockMaxStep seconds is only made
+once it has been measured twice in a row, so one bad time can't throw our clock out. Smaller offsets are
+used to measure how fast our clock drifts from the base station's, and once that has been measured across
+clockTrimAfter seconds, the clock's rate is trimmed with the DS3231's aging offset (about 0.1 ppm a step,
+up to clockMaxTrim steps either way). The trim takes out the drift and slowly slews out whatever offset is
+left, so the clock needs stepping less and less often. Only the minutes and
+seconds are set, so the two clocks can be in different time zones. Set syncClock to false to leave our
+clock alone.
+*/
+const bool syncClock = true;
+const uint16_t clockStepMs = 250;  // milliseconds
+const uint16_t clockMaxStep = 60;  // seconds
+const uint32_t clockTrimAfter = 86400;  // seconds
+const uint8_t clockMaxTrim = 50;
+
+ClockSync clockSync(loggingInterval * 60UL, clockStepMs, clockMaxStep, clockTrimAfter, clockMaxTrim);
+uint8_t clockActions;  // What to do with our clock at the end of this session
+uint32_t tickEpoch;  // A second on our clock (UTC), to tell the time to the millisecond from
+uint32_t tickMs;  // and when it started, by millis()
+
+SdRecordStore queueFile("radioq.bin");  // The queue's file on the SD card
+RecordQueue queue(queueFile, queueSlots);
+bool queueReady = false;  // Whether the queue's file could be set up
+uint32_t currentSeq = 0;  // The sequence number of this logging interval's reading in the queue (0 if it isn't in it)
+uint8_t catchUpSent;  // How many missed readings we have sent this session
+
 // Variable declarations that will help later
 uint32_t previousEpoch;  // A variable for tracking what the last time was when data was logged
 String dataToSend;  // A String object that will contain the final CSV message to be sent
 byte rx[64];  // Buffer (or a place to store received serial data) on the Mayfly for incoming messages from its attached XBee
+byte tx[bulkFragmentSize + 32];  // Buffer where transmit request frames are built before they go out to the XBee
+byte fragment[bulkFragmentSize];  // The dump fragment being filled
+uint8_t fragmentUsed;  // How many bytes of the fragment are filled, counting the kind and sequence number
+uint8_t fragmentSeq;  // The sequence number of the fragment being filled
+
+// The encoder builds transmit request frames in tx, and the decoder puts the frames the XBee sends
+// us back together in rx one byte at a time, checking the length and checksum as it goes
+XBeeFrameEncoder encoder(tx, sizeof(tx));
+XBeeFrameDecoder decoder(rx, sizeof(rx));
+
+// The receiver feeds the decoder from UART-1 while we wait for the base station, and keeps track of
+// how long each message took to arrive so the radio link can be checked from the serial monitor
+XBeeReceiver receiver(decoder);
 
 // This is a function that prints out over the main serial port (Serial0, not Serial1) whatever is in a buffer
 // It is mainly a debugging function for visually noting what bytes are in a buffer at a time when the function is called
-void serialPrintBuffer(byte buffer[], int bufferSize) {
+void serialPrintBuffer(const byte buffer[], int bufferSize) {
   for (int i = 0; i < bufferSize; i++) {  // for each byte in the buffer
     Serial.print(buffer[i], HEX);  // print out that byte as a hexidecimal over the serial line
     if (i == bufferSize - 1) {  // if it is the last byte
@@ -680,137 +795,351 @@ void serialPrintBuffer(byte buffer[], int bufferSize) {
 }
 
 /* 
-This function prints out a string message over the Serial0 line in the framing of what the XBee modules
-require. This is mainly a debugging function. This is only for transmit frame types (See XBee documentation).
-Each of the byte parameters are essential XBee framing parameters that the XBee requires for a transmit request.
+This function prints out the last transmit request frame built for the XBee over the Serial0 line.
+This is mainly a debugging function. Call it right after one of the transmit functions below to see
+exactly what bytes were sent, from the starting delimeter through the checksum.
+*/
+void serialPrintTransmit() {
+  serialPrintBuffer(encoder.frame(), encoder.length());
+}
+
+/*
+Sends a transmit request frame with any number of bytes as the payload to the XBee over the Serial1
+communication line. The payload may contain zeros, since its size is given rather than found by
+looking for a null terminator. The encoder from the SnowRadio library works out the length and the
+checksum while it builds the frame. A checksum is a method of quality-control in XBee radio
+communication: the XBee does its own checksum on the frame and only sends the message if they match.
+frameID can be whatever hexidecimal byte you wish (0x00 means the XBee won't send back a transmit status)
+broadcastRadius should be 0x00 for the largest radius
+options should be left as 0x00 unless you want to do very specific, nuanced transmissions, such as encrypted payloads,
+trace routes, disabling route discoveries. If, for some reason, you wish to use these, consult the documentation on 
+transmit request frames for how to construct a byte (literally bit by bit) for the options field.
+*/
+void transmitBytes(const byte payload[], int payloadSize, byte frameID, byte broadcastRadius, byte options) {
+  // Writing to Serial1 means sending a byte over Serial1 to whatever is connected on that line. If the XBee
+  // is attached to the Bee header on the Mayfly, then it will be the XBee
+  if (encoder.transmitRequest(highAddress, lowAddress, payload, payloadSize, frameID, broadcastRadius, options) > 0) {
+    Serial1.write(encoder.frame(), encoder.length());  // Send the whole frame in one go
+    radioBytesSent += payloadSize;
+  }
+}
+
+// Sends a transmit request frame with a string payload
+// It assumes that the message includes a null terminator, so make sure to use
+// sizeof(*string message*) as the entry for messageSize. The null terminator itself isn't sent.
+void transmitString(const char message[], int messageSize, byte frameID, byte broadcastRadius, byte options) {
+  transmitBytes((const byte*)message, messageSize - 1, frameID, broadcastRadius, options);
+}
+
+// Sends a transmit request frame with the text in a String object as the payload
+// This saves copying the String into a separate array of characters first
+void transmitText(const String& message, byte frameID, byte broadcastRadius, byte options) {
+  transmitBytes((const byte*)message.c_str(), message.length(), frameID, broadcastRadius, options);
+}
+
+// Sends a transmit request frame with a singular byte payload
+// This is nice for when numbers need to be sent rather than strings
+void transmitByte(uint8_t byteMessage, byte frameID, byte broadcastRadius, byte options) {
+  transmitBytes(&byteMessage, 1, frameID, broadcastRadius, options);
+}
+
+/*
+Waits up to secondsWait seconds for a message from the base station. The receiver hands every byte
+the XBee sends to the decoder, which only reports back once a whole receive packet with a good
+checksum has come in, so there's no need to pause and hope the message made it into the buffer in
+one piece. Transmit status frames and anything garbled are skipped over. The timing is done with
+millis() so the RTC isn't asked for the time over and over while we wait. Returns true if a message
+came in, which can then be found in decoder.rfData(); the first byte is the command from the base station.
 */
-void serialPrintTransmit(char mess[], int messSize, byte frameID, byte destAddress64[], byte destAddress16[], byte broadcastRadius, byte options) {
-  Serial.print(0x7E, HEX);  // Print the starting delimeter
-  Serial.print(" ");
-  Serial.print(lengthMSB(messSize), HEX);  // Print the MSB
-  Serial.print(" ");
-  Serial.print(lengthLSB(messSize), HEX);  // Print the LSB
-  Serial.print(" ");
-  Serial.print(0x10, HEX);  // Print the frame type (0x10 frame type is a transmit request)
-  Serial.print(" ");
-  Serial.print(frameID, HEX);  // Print the frame ID
-  Serial.print(" ");
-  for (int i = 0; i < 8; i++) {  // For each byte in the address of the XBee you want to send the message to
-    Serial.print(destAddress64[i], HEX);  // Print the byte
-    Serial.print(" ");
+bool waitForMessage(uint32_t secondsWait) {
+  receiver.expect(NULL, 0x00, secondsWait * 1000UL, millis());  // Start the timer
+  XBeeReceiver::receiveStatus status = XBeeReceiver::waiting;
+  while (status == XBeeReceiver::waiting) {  // Until a message comes in or time runs out
+    status = receiver.poll(Serial1, millis());
   }
-  for (int i = 0; i < 2; i++) {  // Print out the two low address bytes
-    Serial.print(destAddress16[i], HEX);
-    Serial.print(" ");
+  return status == XBeeReceiver::received;
+}
+
+// Prints how quickly the base station's messages came in during this session over the main serial port
+void serialPrintRadioStats() {
+  Serial.print(F("Radio messages received: "));
+  Serial.print(receiver.exchanges);
+  Serial.print(F(", timeouts: "));
+  Serial.print(receiver.timeouts);
+  Serial.print(F(", wait (ms) min/avg/max: "));
+  Serial.print(receiver.minLatencyMs);
+  Serial.print(F("/"));
+  Serial.print(receiver.averageLatencyMs());
+  Serial.print(F("/"));
+  Serial.print(receiver.maxLatencyMs);
+  Serial.print(F(", bytes sent: "));
+  Serial.print(radioBytesSent);
+  Serial.print(F(", readings waiting: "));
+  Serial.print(queueReady ? queue.pending() : 0);
+  Serial.print(F(", written over: "));
+  Serial.println(queue.dropped);
+  Serial.print(F("Radio on (ms): "));
+  Serial.print(radioOnMs);
+  Serial.print(F(", slot (s into the interval): "));
+  if (slotTimer.isSynced()) {
+    Serial.print(slotTimer.openS());
+    Serial.print(F("-"));
+    Serial.print(slotTimer.closeS());
+    Serial.print(F(", clock offset (s): "));
+    Serial.print(slotTimer.offsetAt(dataLogger.getNowLocalEpoch()));
+    Serial.print(F(", drift (ppm): "));
+    Serial.print(slotTimer.driftPpm());
+    Serial.print(F(" +/- "));
+    Serial.println(slotTimer.driftUncertaintyPpm());
+  } else {
+    Serial.println(F("not known yet"));
   }
-  Serial.print(broadcastRadius, HEX);  // Print the broadcast radius
-  Serial.print(" ");
-  Serial.print(options, HEX);  // Print the options
-  Serial.print(" ");
-  for (int i = 0; i < messSize; i++) {  // For each byte in the message
-    Serial.print(mess[i], HEX);  // Print the byte
-    Serial.print(" ");
+  if (syncClock) {
+    Serial.print(F("Clock offset (ms): "));
+    Serial.print(clockSync.offsetMs());
+    Serial.print(F(", steps: "));
+    Serial.print(clockSync.steps());
+    Serial.print(F(", drift (ppm): "));
+    Serial.print(clockSync.driftPpm());
+    Serial.print(F(", aging offset: "));
+    Serial.println(clockSync.trim());
   }
-  Serial.println(checksumString(mess, messSize, frameID, broadcastRadius, options), HEX);  // Print the checksum
 }
 
-// This function calculates the most signifcant byte of a message's size
-// It assumes that the message includes a null terminator, so makes sure to 
-// use sizeof(*string message*) function as the entry for size
-byte lengthMSB(int size) {
-  return byte((13 + size) / 255);
+/*
+Waits for the next second to start on our clock, so the time can be told to the millisecond with millis().
+The clock is read once a millisecond rather than as fast as the I2C bus goes, which would keep it busy for
+up to a second.
+*/
+void waitForTick() {
+  uint32_t epoch = Logger::getNowUTCEpoch();
+  while ((tickEpoch = Logger::getNowUTCEpoch()) == epoch) {
+    dataLogger.watchDogTimer.resetWatchDog();
+    delay(1);
+  }
+  tickMs = millis();
 }
 
-// Calculates the least significant byte. Follow directions of lengthMSB for sizing input
-byte lengthLSB(int size) {
-  return byte((13 + size) % 255);
+/*
+This function works out how far our clock is from the base station's, from the time that came with its 'R'
+and the time it came in (heardMs, by millis()). The base station sketches from before the clocks were
+synced don't send the time to the millisecond, so nothing is done with theirs.
+*/
+void checkClock(uint32_t heardMs) {
+  const byte* message = decoder.rfData() + 1;  // What came after the 'R'
+  uint8_t length = decoder.rfDataLength() - 1;
+  uint32_t baseEpoch;
+  uint16_t openS, closeS, baseMs, roundTripMs;
+  if (!slotGetSchedule(message, length, &baseEpoch, &openS, &closeS) ||
+      !clockGetTime(message + SLOT_SCHEDULE_SIZE, length - SLOT_SCHEDULE_SIZE, &baseMs, &roundTripMs)) {
+    return;
+  }
+  uint32_t sinceTick = heardMs - tickMs;
+  clockActions = clockSync.measured(baseEpoch, baseMs, roundTripMs, tickEpoch + sinceTick / 1000, sinceTick % 1000);
 }
 
 /*
-Checksum of a transmit request frame whose payload is a string
-A checksum is a method of quality-control in XBee radio communication. The Mayfly will send a
-bunch of bytes that say its a transmit request along with a checksum byte at the end. The XBee
-module will do its own checksum on the frame and check it with what the Mayfly gave. If they match
-the XBee sends the message. A checksum calculation in this scenario works by adding up all the 
-bytes in the frame (not including the message and the checksum byte itself), calculating the remainder
-of the summed value and the largest hexidecimal number and finding the difference between that value and 
-the largest hexidecimal number. It's confusing, but it works. It makes more sense in the code.
+This function moves our clock forward by stepMs milliseconds (back if it is negative). The DS3231 only
+takes whole seconds, and starts a second over when it is set, so we wait until the base station's clock
+starts a second and set ours to that second.
 */
-byte checksumString(char rfData[], int size, byte frameID, byte broadcastRadius, byte options) {
-  int sum;  // Initialize the variable storing the sum of the bytes
-  sum = 0;
-  sum += 0x10;  // Add the frame type byte (0x10 for transmit requests)
-  sum += frameID;
-  for (int i = 0; i <= sizeof(highAddress) - 1; i++) {
-    sum += highAddress[i];
+void stepClock(int32_t stepMs) {
+  // Milliseconds past tickEpoch by the base station's clock, and the next whole second after that
+  int32_t baseMs = (int32_t)(millis() - tickMs) + stepMs;
+  int32_t nextSecond = (baseMs >= 0 ? baseMs / 1000 : (baseMs - 999) / 1000) + 1;
+  uint32_t setAt = tickMs + (uint32_t)(nextSecond * 1000L - stepMs);
+  while ((int32_t)(setAt - millis()) > 0) {
+    dataLogger.watchDogTimer.resetWatchDog();
   }
-  for (int i = 0; i <= sizeof(lowAddress) - 1; i++) {
-    sum += lowAddress[i];
+  Logger::setNowUTCEpoch(tickEpoch + nextSecond);
+}
+
+/*
+The next three functions split a dump into as few fragments as bulkFragmentSize allows. Each fragment
+starts with the kind of dump ('B', 'C', or 'S') and a sequence number counting up from zero, and the
+high bit of the sequence number is set on the last fragment so the base station knows when it has everything.
+*/
+void beginFragments(byte kind) {
+  fragment[0] = kind;
+  fragmentSeq = 0;
+  fragmentUsed = 2;  // The first two bytes are saved for the kind and the sequence number
+}
+
+// Adds bytes to the dump, sending each fragment as it fills up
+void addToFragments(const byte data[], int dataSize) {
+  for (int c = 0; c < dataSize; c++) {
+    if (fragmentUsed == bulkFragmentSize) {  // If the fragment is full, send it and start the next one
+      fragment[1] = fragmentSeq++;
+      transmitBytes(fragment, fragmentUsed, 0x00, 0x00, 0x00);
+      fragmentUsed = 2;
+    }
+    fragment[fragmentUsed++] = data[c];
   }
-  sum += options;
-  sum += broadcastRadius;
-  for (int i = 0; i < size - 1; i++) {
-    sum += byte(rfData[i]);
+}
+
+// Sends the last fragment of the dump and returns the number of fragments sent
+uint8_t endFragments() {
+  fragment[1] = fragmentSeq | 0x80;  // Mark the last fragment
+  transmitBytes(fragment, fragmentUsed, 0x00, 0x00, 0x00);
+  return fragmentSeq + 1;
+}
+
+/*
+Sends everything the base station would otherwise ask for one piece at a time in a single bulk dump ('B').
+The data is written out as text, "timestamp;varCount;UUID;value;UUID;value;...;". Returns the number of
+fragments sent.
+*/
+uint8_t transmitBulkDump() {
+  uint8_t varCount = dataLogger.getArrayVarCount();
+  String field;  // The piece of text currently being added
+
+  beginFragments('B');
+  // Field -2 is the timestamp, field -1 the variable count, then a UUID and a value for each variable
+  for (int f = -2; f < 2 * varCount; f++) {
+    field = "";
+    if (f == -2) {
+      dataLogger.dtFromEpoch(dataLogger.markedLocalEpochTime).addToString(field);
+    } else if (f == -1) {
+      field += varCount;
+    } else {
+      // UUIDs and values go straight from the logger into the fragments, without copying them into a String
+      const char* text = f % 2 == 0 ? dataLogger.getVarUUIDCharAtI(f / 2) : dataLogger.getValueCharAtI(f / 2);
+      addToFragments((const byte*)text, strlen(text));
+    }
+    field += ';';
+    addToFragments((const byte*)field.c_str(), field.length());
   }
-  return byte(255 - (sum % 256));  // The 256 is because there are 256 total numbers (inclduing zero), but 255 is the highest possible number
+  return endFragments();
 }
 
-// Checksum of a transmit request frame whose payload is a singular byte rather than a string message
-byte checksumByte(uint8_t byteMessage, byte frameID, byte broadcastRadius, byte options) {
-  uint8_t sum;
-  sum = 0;
-  sum += 0x10;
-  sum += frameID;
-  for (int i = 0; i <= sizeof(highAddress) - 1; i++) {
-    sum += highAddress[i];
+/*
+Sends the compact dump ('C'): the schema ID, the timestamp, and the values packed as binary numbers
+instead of text (see MeasurementRecord.h in the SnowRadio library). Each value takes two bytes when it
+can be scaled to a whole number using its resolution, a missing value (-9999) is marked as missing
+rather than sent as a number, and no variable UUIDs are sent at all. The base station asks for those
+with an 'S' if it doesn't already have our schema. Returns the number of fragments sent.
+*/
+uint8_t transmitCompactDump() {
+  byte packed[RECORD_QUEUE_MAX_RECORD];
+
+  beginFragments('C');
+  addToFragments(packed, packRecord(packed, sizeof(packed)));
+  return endFragments();
+}
+
+/*
+Packs the latest measurements into a compact record in out, which has room for size bytes. Returns the
+number of bytes in the record, or 0 if it didn't fit.
+*/
+uint8_t packRecord(byte out[], uint8_t size) {
+  uint8_t varCount = dataLogger.getArrayVarCount();
+  uint8_t length = recordPutHeader(out, schemaID, dataLogger.markedLocalEpochTime, varCount);
+  for (uint8_t i = 0; i < varCount; i++) {
+    if (length + RECORD_MAX_VALUE_SIZE > size) return 0;  // Make sure the biggest value would fit
+    uint8_t format = recordFormat(dataLogger.getVarResolutionAtI(i));  // How the value is packed
+    // Packed from the value's text so the base station prints the same digits the bulk dump would
+    length += recordPutValue(out + length, dataLogger.getValueAtI(i), format,
+                             dataLogger.getValueCharAtI(i));
+  }
+  return length;
+}
+
+// Saves this logging interval's reading in the queue and returns its sequence number (0 if it couldn't be)
+uint32_t queueReading() {
+  if (!queueReady || !dataLogger.beginSDCard()) return 0;
+  byte packed[RECORD_QUEUE_MAX_RECORD];
+  uint8_t length = packRecord(packed, sizeof(packed));
+  return length > 0 ? queue.push(packed, length) : 0;
+}
+
+// Lets go of a reading in the queue once the base station has it
+void ackReading(uint32_t seq) {
+  if (queueReady && seq != 0 && dataLogger.beginSDCard()) queue.ack(seq);
+}
+
+// The number of older readings the base station missed (not counting this logging interval's), up to 255
+uint8_t missedReadings() {
+  if (!queueReady) return 0;
+  uint16_t missed = queue.pending();
+  if (queue.isPending(currentSeq)) missed--;
+  return missed > 255 ? 255 : missed;
+}
+
+/*
+Sends the oldest reading the base station missed ('K'): its sequence number in the queue (4 bytes, least
+significant first) followed by its compact record. If the request has a sequence number after the 'K',
+the base station got that reading, so we let go of it first. An empty answer means there is nothing
+more to send this session, either because the base station has everything or because we have already
+sent maxCatchUp readings. Returns the number of fragments sent.
+*/
+uint8_t transmitCatchUp() {
+  if (decoder.rfDataLength() >= 5) {  // If the base station is telling us it got the last one
+    uint32_t seq = 0;
+    for (uint8_t b = 0; b < 4; b++) seq |= (uint32_t)decoder.rfData()[1 + b] << (8 * b);
+    ackReading(seq);
   }
-  for (int i = 0; i <= sizeof(lowAddress) - 1; i++) {
-    sum += lowAddress[i];
+
+  beginFragments('K');
+  if (catchUpSent < maxCatchUp && queueReady && dataLogger.beginSDCard()) {
+    byte packed[4 + RECORD_QUEUE_MAX_RECORD];
+    for (uint32_t seq = queue.nextPending(); seq != 0; seq = queue.nextPending(seq)) {
+      if (seq == currentSeq) continue;  // This logging interval's reading is sent in its own dump
+      uint8_t length = queue.read(seq, packed + 4, RECORD_QUEUE_MAX_RECORD);
+      if (length == 0) {  // A reading that can't be read back is let go of; it is still in the log file
+        queue.ack(seq);
+        continue;
+      }
+      for (uint8_t b = 0; b < 4; b++) packed[b] = (seq >> (8 * b)) & 0xFF;
+      addToFragments(packed, 4 + length);
+      catchUpSent++;
+      break;
+    }
   }
-  sum += options;
-  sum += broadcastRadius;
-  sum += byteMessage;
-  return 255 - (sum % 256);
+  return endFragments();
 }
 
 /*
-Sends a transmit request frame to the XBee with a string payload over the Serial1 communication line
-frameID can be whatever hexidecimal byte you wish
-broadcastRadius should be 0x00 for the largest radius
-options should be left as 0x00 unless you want to do very specific, nuanced transmissions, such as encrypted payloads,
-trace routes, disabling route discoveries. If, for some reason, you wish to use these, consult the documentation on 
-transmit request frames for how to construct a byte (literally bit by bit) for the options field.
-*/  
-void transmitString(char message[], int messageSize, byte frameID, byte broadcastRadius, byte options) {
-  // Writing to Serial1 means sending a byte over Serial1 to whatever is connected on that line. If the XBee
-  // is attached to the Bee header on the Mayfly, then it will be the XBee
-  Serial1.write(0x7E);  // Starting delimeter never changes
-  Serial1.write(lengthMSB(messageSize));
-  Serial1.write(lengthLSB(messageSize));
-  Serial1.write(0x10);  // Frame type is always 0x10 for a transmit request
-  Serial1.write(frameID);
-  Serial1.write(highAddress, 8);
-  Serial1.write(lowAddress, 2);
-  Serial1.write(broadcastRadius);
-  Serial1.write(options);
-  Serial1.write(message);
-  Serial1.write(checksumString(message, messageSize, frameID, broadcastRadius, options));
+Sends this station's schema ('S') as text, "schemaID;varCount;UUID;format;UUID;format;...;", so the
+base station can turn the compact dump back into UUIDs and values. Returns the number of fragments sent.
+*/
+uint8_t transmitSchema() {
+  uint8_t varCount = dataLogger.getArrayVarCount();
+  String field;  // The piece of text currently being added
+
+  beginFragments('S');
+  // Field -2 is the schema ID, field -1 the variable count, then a UUID and a format for each variable
+  for (int f = -2; f < 2 * varCount; f++) {
+    field = "";
+    if (f == -2) {
+      field += schemaID;
+    } else if (f == -1) {
+      field += varCount;
+    } else if (f % 2 == 0) {
+      field += dataLogger.getVarUUIDAtI(f / 2);
+    } else {
+      field += recordFormat(dataLogger.getVarResolutionAtI(f / 2));
+    }
+    field += ';';
+    addToFragments((const byte*)field.c_str(), field.length());
+  }
+  return endFragments();
 }
 
-// Sends a transmit request frame with a singular byte payload
-// This is nice for when numbers need to be sent rather than strings
-void transmitByte(uint8_t byteMessage, byte frameID, byte broadcastRadius, byte options) {
-  Serial1.write(0x7E);  // Starting delimeter
-  Serial.write(0x00);  // Most significant byte length (this is a fixed value when doing a transmit request with only one byte for the payload)
-  Serial.write(0x0F);  // Least significant byte length (this is a fixed value when doing a transmit request with only one byte for the payload)
-  Serial1.write(0x10);  // Frame type (0x10 is used to identify a transmit request)
-  Serial1.write(frameID);  // Frame ID set to 0x00 so we don't get a transmit status frame in the buffer
-  Serial1.write(highAddress, 8);  // 64-bit address
-  Serial1.write(lowAddress, 2);  // 16-bit address
-  Serial1.write(broadcastRadius);  // Broadcast radius
-  Serial1.write(options);  // Options
-  Serial1.write(byteMessage);
-  Serial1.write(byte(checksumByte(byteMessage, frameID, broadcastRadius, options)));
+// Whether a message from the base station is asking for one of the dumps: 'B', 'C', 'S', or 'K'
+bool isDumpRequest(byte message) {
+  return message == 0x42 || message == 0x43 || message == 0x53 || message == 0x4B;
+}
+
+// Works out this station's schema ID from the UUID, unit, resolution, and packing of every variable
+uint16_t computeSchemaID() {
+  SchemaHash hash;
+  for (uint8_t i = 0; i < dataLogger.getArrayVarCount(); i++) {
+    hash.add(dataLogger.getVarUUIDCharAtI(i));
+    hash.add(dataLogger.getVarUnitAtI(i).c_str());
+    hash.add(dataLogger.getVarResolutionAtI(i));
+    hash.add(recordFormat(dataLogger.getVarResolutionAtI(i)));
+  }
+  return hash.value();
 }
 
 
@@ -838,15 +1167,9 @@ void setup() {
 	  Serial1.begin(xbeeBaud);
     // Waking up the XBee momentarily to clear out anything that could potentially be in the buffer
 	  digitalWrite(xbeeSleepPin, LOW);
-    // Clear out the buffer where we'll store incoming data from the XBee on the Mayfly
-	  memset(rx, 0x00, sizeof(rx));
 	  delay(100);
-    // Count up the bytes waiting to come in
-	  int count = Serial1.available();
-    // Read in that many bytes
-	  Serial1.readBytes(rx, count);
-    // Erase them  
-	  memset(rx, 0x00, sizeof(rx));
+    // Throw away any bytes waiting to come in
+	  while (Serial1.available() > 0) Serial1.read();
     // Put the XBee back to sleep
 	  digitalWrite(xbeeSleepPin, HIGH);
   }
@@ -882,19 +1205,37 @@ void setup() {
   // Begin the variable array[s], logger[s], and publisher[s]
   varArray.begin(variableCount, variableList);
   dataLogger.begin(LoggerID, loggingInterval, &varArray);
+  // Carry on trimming our clock's rate from wherever it was left
+  clockSync.begin(rtc.getAgingOffset());
+
+  // Work out our schema ID now that the variables are set
+  schemaID = computeSchemaID();
+  Serial.print(F("Schema ID: "));
+  Serial.println(schemaID);
 
   // Set up the sensors
   Serial.println(F("Setting up sensors..."));
   varArray.setupSensors();
+  batteryChannel = ADS1x15Manager::shared.addSingleEnded(batteryI2CAddress, posBatChannel, GAIN_ONE);
 
   // Create the log file, adding the default header to it
   // Do this last so we have the best chance of getting the time correct and
   // all sensor names correct
   dataLogger.createLogFile(true);  // true = write a new header
 
+  // Set up the queue of readings waiting for the base station, picking up where we left off
+  if (networking && dataLogger.beginSDCard() && queueFile.begin(queue.fileSize())) {
+    queueReady = queue.begin();
+  }
+  Serial.print(F("Readings waiting for the base station: "));
+  Serial.println(queueReady ? queue.pending() : 0);
+
   // Call the processor sleep
   dataLogger.systemSleep();
 
+  // Have the sonar report the median of its readings
+  sonar.setReducer(HRXL_VAR_NUM, &sonarMedian);
+
   // Begin the MaxBotix's serial communication
   sonarSerial.begin(9600);
 }
@@ -942,6 +1283,30 @@ void loop() {
   */
   // If conditions are right for radio communication
   if (previousEpoch != dataLogger.markedLocalEpochTime && networking) {  
+    // Save the new reading in the queue until the base station tells us it has it
+    currentSeq = queueReading();
+    catchUpSent = 0;
+    // and work out when our slot is
+    slotTimer.window(dataLogger.markedLocalEpochTime, dataLogger.getNowLocalEpoch(), &slotOpen, &slotClose);
+    slotPending = true;
+  }
+
+  // The Mayfly wakes up every minute, so if our slot opens before the next time it does
+  if (slotPending && (int32_t)(slotOpen - dataLogger.getNowLocalEpoch()) < 60) {
+    slotPending = false;
+    // then sleep until the second before it opens, with the RTC set to wake us when its seconds get there
+    // (unless that's too close to set it in time). The last second is waited out awake, lining millis() up
+    // with the start of a second on our clock so we can tell the time to the millisecond.
+    uint32_t now = dataLogger.getNowLocalEpoch();
+    if ((int32_t)(slotOpen - now) > 2) {
+      dataLogger.systemSleep((slotOpen - 1) % 60);
+    } else if ((int32_t)(slotOpen - now) > 1) {
+      delay(1000);
+    }
+    waitForTick();
+    clockActions = ClockSync::clockKeep;
+    uint32_t radioOnStart = millis();
+
     // Turn on the red LED. This is just a nice visual aid when monitoring
     // these loggers to let you know they have started radio communications
     digitalWrite(redLED, HIGH);
@@ -954,12 +1319,11 @@ void loop() {
 
     // Clear out the Mayfly's buffer upon wake up in case the XBee has sent 
     // any rogue or unanticipated messages upon power up
-    // Count how many bytes are waiting to be read into the buffer
-    uint8_t wakeUpCount = Serial1.available();
-    // Read the bytes into the buffer
-    Serial1.readBytes(rx, wakeUpCount);
-    // Clear out where we just stored those bytes by setting everything to zero
-    memset(rx, 0x00, sizeof(rx));  
+    while (Serial1.available() > 0) Serial1.read();
+    // and start the decoder fresh
+    decoder.reset();
+    receiver.resetStats();  // Start counting this session's message times from scratch
+    radioBytesSent = 0;  // and the bytes we send
 
     // Assume the host station (central station where all data is aggregated) 
     // is not ready to get data
@@ -968,219 +1332,187 @@ void loop() {
     // if we really don't hear anything
     bool heardNothing = false;  
 	
-    uint32_t starttime = dataLogger.getNowLocalEpoch();  // Start a timer
-
-    // Stay in this loop until more bytes enter the buffer from the XBee
-    while (Serial1.available() == 0) {
-      // If we've waited for at least ten minutes (600 seconds)
-      if (dataLogger.getNowLocalEpoch() - starttime > 600) {  
-        heardNothing = true;  // then we haven't heard anything
-        break;  // Leave the loop
-      } 
+
+    // Wait until our slot is over for a message from the host station
+    now = dataLogger.getNowLocalEpoch();
+    if ((int32_t)(slotClose - now) <= 0 || !waitForMessage(slotClose - now)) {
+      heardNothing = true;  // If nothing came, then we haven't heard anything
     }
-    delay(100);  // Give a chance for the full message to come through
+    uint32_t heardMs = millis();  // When it came in, to compare our clock with the host's
 	
     if (heardNothing) {  // If we didn't hear anything from the XBee
+      slotTimer.missed();  // If this keeps up, we go back to listening for longer
       digitalWrite(redLED, LOW);  // Turn off the red LED
       digitalWrite(xbeeSleepPin, HIGH);  // Put the XBee back to sleep
     } else {  // If we did hear something from the XBee
-      int newCount = Serial1.available();  // Count how many bytes are in the buffer
-      Serial1.readBytes(rx, newCount);  // Read in all those bytes
-      if (rx[15] == 0x52) {  // If the message we received was 'R' (ASCII character for 0x52)
+      if (decoder.rfData()[0] == 0x52) {  // If the message we received was 'R' (ASCII character for 0x52)
         hostReady = true;  // Then the host station is ready to collect this station's data
-        transmitString(ready, sizeof(ready), 0x00, 0x00, 0x00);  // Let the host know we are ready
+        // Take our slot from the rest of the message, and see how far our clock is from the host's
+        slotTimer.heard(decoder.rfData() + 1, decoder.rfDataLength() - 1, dataLogger.getNowLocalEpoch());
+        if (syncClock) checkClock(heardMs);
+        // Let the host know we are ready, which schema our data follows, how many readings it missed, and
+        // how long we took to answer, so it can work out the round trip
+        byte missed = missedReadings();
+        uint16_t answeredIn = millis() - heardMs;
+        byte readyReply[6] = {(byte)ready[0], lowByte(schemaID), highByte(schemaID), missed, lowByte(answeredIn), highByte(answeredIn)};
+        transmitBytes(readyReply, sizeof(readyReply), 0x00, 0x00, 0x00);
       } else {  // If it wasn't an 'R' that came through, send an error message 'E'
         transmitString(error, sizeof(error), 0x00, 0x00, 0x00);  // Let the host know there was an error
       }
-	  
-      memset(rx, 0x00, sizeof(rx));  // Clear out the buffer for incoming messages
-	  
+
       if (hostReady) {  // If the host station is ready for the data
         greenredflash(10);  // Give a visual cue
 
         // Assume a timestamp has not been requested by the host station
         bool timeRequested = false;  
+        // Assume a dump has not been requested either. This holds the kind of dump if one is asked for:
+        // 'C' for the compact dump, 'S' for the schema that goes with it, 'B' for the text bulk dump, or
+        // 'K' for a reading the host missed
+        byte dumpRequested = 0x00;
         
-        uint32_t starttime = dataLogger.getNowLocalEpoch();  // Set a timer
-        // Wait for a message from the XBee
-        while (Serial1.available() == 0) {
-          // If we wait more than a minute for a message
-          if (dataLogger.getNowLocalEpoch() - starttime > 60) {
-            break;  // Leave the while loop
+        // Wait up to a minute for a message from the XBee
+        if (waitForMessage(60)) {  // If something came through
+          // Check if the message is 'T' (0x54)
+          if (decoder.rfData()[0] == 0x54) {  
+            timeRequested = true;  // If so, a timestamp has been requested
+          } else if (isDumpRequest(decoder.rfData()[0])) {  // Or if the message is asking for everything in one dump
+            dumpRequested = decoder.rfData()[0];
           }
         }
 		
-        delay(100);  // Give a chance for all the bytes to come in
-		
-        if (Serial1.available() != 0) {  // If something came through
-          Serial1.readBytes(rx, Serial1.available());  // Read the bytes in
-          // Check if it was a receive packet (3rd byte is 0x90) and that the message is 'T' (0x54)
-          if (rx[3] == 0x90 && rx[15] == 0x54) {
-            timeRequested = true;  // If so, a timestamp has been requested
+        /*
+        If the host station asked for a dump, send it and wait for the reply. The host either
+        acknowledges it with an 'A', asks for another dump (the same one again if a fragment went
+        missing, or the schema after a compact dump it can't read yet), or gives up on dumps and
+        starts the step-by-step handshake with a 'T'. Before any of that, it may catch up on the
+        readings it missed with a 'K' for each one.
+        */
+        uint8_t dumpsSent = 0;  // Count how many dumps we have sent this session
+        uint8_t catchUpAnswers = 0;  // and how many answers to a 'K', which have their own limit
+        byte lastDump = 0x00;  // The last dump we sent, so we know what an 'A' is for
+        while (dumpRequested != 0x00 && dumpsSent < maxBulkDumps && catchUpAnswers < 2 * maxCatchUp + 1) {
+          if (dumpRequested == 0x4B) {  // 'K'
+            transmitCatchUp();  // Send the oldest reading the host missed
+            catchUpAnswers++;
+          } else {
+            if (dumpRequested == 0x43) {  // 'C'
+              transmitCompactDump();  // Send our values packed as numbers
+            } else if (dumpRequested == 0x53) {  // 'S'
+              transmitSchema();  // Send our variable UUIDs and how the values are packed
+            } else {  // 'B'
+              transmitBulkDump();  // Send all of our data as text
+            }
+            dumpsSent++;
+          }
+          lastDump = dumpRequested;
+          dumpRequested = 0x00;  // Assume the host station will not ask again
+
+          if (waitForMessage(bulkReplyWait)) {  // Wait for the reply. If something came through
+            if (isDumpRequest(decoder.rfData()[0])) {  // Another dump
+              dumpRequested = decoder.rfData()[0];
+            } else if (decoder.rfData()[0] == 0x54) {  // A 'T' means go step by step instead
+              timeRequested = true;
+            } else if (decoder.rfData()[0] == 0x41 && (lastDump == 0x43 || lastDump == 0x42)) {
+              ackReading(currentSeq);  // The host has this logging interval's reading
+            }
+            // An 'A', or anything else, means the host station is done with us
           }
         }
-		
-        if (timeRequested) {  // If a timestamp was requested
+
+        if (timeRequested) {  // If a timestamp was requested (the step-by-step handshake)
           String datetime = "";  // Create an empty String object for the datetime
 		  
 		      // Retrieve the datetime from the datalogger and store it in the String we just made
           dataLogger.dtFromEpoch(dataLogger.markedLocalEpochTime).addToString(datetime);
 
-          // Create a string variable that is compatible with transmit requests
-          char timestamp[datetime.length() + 1];
-          // Turn the timestamp String object into a string of characters
-          datetime.toCharArray(timestamp, sizeof(timestamp));
           // Send the timestamp to the host
-          transmitString(timestamp, sizeof(timestamp), 0x00, 0x00, 0x00);   
-        }
-		
-        memset(rx, 0x00, sizeof(rx));  // Clear out the buffer
+          transmitText(datetime, 0x00, 0x00, 0x00);
 
-        // Assume the host station has not requested a variable count
-        bool varCountRequested = false;
+          // Assume the host station has not requested a variable count
+          bool varCountRequested = false;
 		
-        starttime = dataLogger.getNowLocalEpoch();  // Start a timer
-        while (Serial1.available() == 0) {  // Wait for a message
-          // If we waited more than a minute
-          if (dataLogger.getNowLocalEpoch() - starttime > 60) {  
-            break;  // Then break the while loop
+          // Wait up to a minute for a message
+          // If something came through and we didn't miss the timestamp request
+          if (waitForMessage(60) && timeRequested) {
+            // Check if the message is 'V' (0x56)
+            if (decoder.rfData()[0] == 0x56) {  
+              varCountRequested = true;  // If so, the variable count has been requested
+            }
           }
-        }
 		
-        delay(100);  // Give a chance for all bytes to come in if something was received
-
-        // If something came through and we didn't miss the timestamp request
-        if (Serial1.available() != 0 && timeRequested) {  
-          Serial1.readBytes(rx, Serial1.available());  // Read the bytes in
-          // Check if it was a receive packet (3rd byte is 0x90) and that the message is 'V' (0x56)
-          if (rx[3] == 0x90 && rx[15] == 0x56) {
-            varCountRequested = true;  // If so, the variable count has been requested
+          if (varCountRequested) {  // If the variable count has been requested
+            // We will send that number as a single byte
+            varCount = dataLogger.getArrayVarCount();
+            transmitByte(varCount, 0x00, 0x00, 0x00);
           }
-        }
 		
-        if (varCountRequested) {  // If the variable count has been requested
-          // We will send that number
-          // Here I have elected to create the frame myself, as I had trouble implementing
-          // the transmitByte function. Further debugging could clean this up to just use
-          // that function rather than construct a frame ourselves
-
-		      // Start of checksum
-          int sum = 0;  // Sum for checksum at end of transmit request frame
-          sum += 0x10;
-          sum += 0x00;
-          for (int i = 0; i < 8; i++) {
-            sum += highAddress[i];
-          }
-          for (int i = 0; i < 2; i++) {
-            sum += lowAddress[i];
-          }
-          sum += 0x00;
-          sum += 0x00;
-          
-          // Get the variable count while doing the checksum
-          varCount = dataLogger.getArrayVarCount();  
-
-          sum += varCount;
-          sum = 255 - (sum % 256);
-		      // End of checksum
-
-          Serial1.write(0x7E);  // Send the XBee the starting delimeter
-          Serial1.write(0x00);  // Send the XBee the message's MSB
-          Serial1.write(0x0F);  // Send the XBee the message's LSB
-          Serial1.write(0x10);  // Send the XBee the frame type (0x10 is transmit request)
-          Serial1.write(0x00);  // Send the XBee the frame ID
-          Serial1.write(highAddress, 8);  // Send the XBee the address of the message's final destination
-          Serial1.write(lowAddress, 2);  // Send the XBee the default low address settings
-          Serial1.write(0x00);  // Send the XBee the broadcast radius
-          Serial1.write(0x00);  // Send the XBee the options
-          Serial1.write(byte(varCount));  // Send the variable count
-          Serial1.write(byte(sum));  // Send the checksum
-        }
+          bool allDataSent = false;  // Assume that not all the data has been sent
 		
-        memset(rx, 0x00, sizeof(rx));  // Clear out the buffer
-
-        bool allDataSent = false;  // Assume that not all the data has been sent
-		
-		    // While loop for sending all the data to the host station
-        while (!allDataSent) {  // While all the data has not been sent
-          memset(rx, 0x00, sizeof(rx));  // Clear the buffer
-          bool breakWhile = false;  // Assume that we are going to break out of this while loop, unless something changes
+  		    // While loop for sending all the data to the host station
+          while (!allDataSent) {  // While all the data has not been sent
+            bool breakWhile = false;  // Assume that we are going to break out of this while loop, unless something changes
 		  
-          starttime = dataLogger.getNowLocalEpoch();  // Start a timer
-          while (Serial1.available() == 0) {  // Wait for a message
-            if (dataLogger.getNowLocalEpoch() - starttime > 60) {  // If we waited more than a minute
+            if (!waitForMessage(60)) {  // Wait up to a minute for a message. If nothing came
               // Flag that we want to break the larger while loop where we try to send all our data
-              breakWhile = true;  
-              break;  // Break the current while loop where we are just waiting for a message
+              breakWhile = true;
             }
-          }
 		  
-          delay(100);  // Give a chance for every byte to come in from the message
-		  
-          if (breakWhile) {  // If we want to break this while loop where we send the data
-            // Break the overarching while loop where we send all the data, effectively ending all
-            // communication until the next logging interval
-            break;  
-          }
-		  
-		      // In this part, we will check which variable number the host station is interested in 
-		      // and supply the name of that variable
-          Serial1.readBytes(rx, Serial1.available());  // Move what was received into the buffer
-          // If the message was a receive packet and a number less than the varCount
-          if (rx[3] == 0x90 && rx[15] < varCount) {
-            delay(20);
-            varNum = rx[15];  // Record which variable number the host is interested in
-            memset(rx, 0x00, sizeof(rx));  // Clear the buffer
-            String varUUID = "";  // Create a String object to store the UUID of this variable number
-            varUUID += dataLogger.getVarUUIDAtI(varNum);  // Retrieve the variable UUID
-            char uuid[varUUID.length() + 1];  // Create a string of characters to store this in
-            varUUID.toCharArray(uuid, sizeof(uuid));  // Store the String in the string
-            transmitString(uuid, sizeof(uuid), 0x00, 0x00, 0x00);  // Transmit the variable name to the host
-            memset(rx, 0x00, sizeof(rx));  // Clear the buffer
-          } else {  // If what was received is not a valid number request
-            // Break the overarching while loop where we send all the data, effectively ending
-            // all communication until the next logging interval
-            break;  
-          }       
-
-          // In this section, we will supply the measurement of the current variable of interest upon request
-          starttime = dataLogger.getNowLocalEpoch();  // Start a timer
-          while (Serial1.available() == 0) {  // Wait for a message
-            if (dataLogger.getNowLocalEpoch() - starttime > 60) {  // If we waited for more than a minute
-              breakWhile = true;  // Mark that we want to stop communication by breaking the overarching while loop
-              break;  // Break this current while loop
+            if (breakWhile) {  // If we want to break this while loop where we send the data
+              // Break the overarching while loop where we send all the data, effectively ending all
+              // communication until the next logging interval
+              break;  
             }
-          }
 		  
-          if (breakWhile) {  // If we noted that we want to stop trying to send data
-            // Break the overarching while loop where we send all the data, effectively ending
-            // all communication until the next logging interval
-            break;  
-          }
-		  
-          delay(100);  // Give a chance for all bytes to come in
+            // A two-byte message, 'N' followed by a variable number, asks for just the measurement of that
+            // variable. The base station sends this instead of asking for the UUID first when it already
+            // has our UUIDs from our schema.
+            if (decoder.rfDataLength() == 2 && decoder.rfData()[0] == 0x4E && decoder.rfData()[1] < varCount) {
+              varNum = decoder.rfData()[1];  // Record which variable number the host is interested in
+              // Send the measurement, which was written out as text once when it was taken
+              transmitBytes((const byte*)dataLogger.getValueCharAtI(varNum), dataLogger.getValueLengthAtI(varNum), 0x00, 0x00, 0x00);
+            } else {
+    		      // In this part, we will check which variable number the host station is interested in 
+    		      // and supply the name of that variable
+              // If the message was a number less than the varCount
+              if (decoder.rfData()[0] < varCount) {  
+                varNum = decoder.rfData()[0];  // Record which variable number the host is interested in
+                const char* varUUID = dataLogger.getVarUUIDCharAtI(varNum);  // Retrieve the variable UUID
+                transmitBytes((const byte*)varUUID, strlen(varUUID), 0x00, 0x00, 0x00);  // Transmit it to the host
+              } else {  // If what was received is not a valid number request
+                // Break the overarching while loop where we send all the data, effectively ending
+                // all communication until the next logging interval
+                break;  
+              }       
+
+              // In this section, we will supply the measurement of the current variable of interest upon request
+              if (!waitForMessage(60)) {  // Wait up to a minute for a message. If nothing came
+                breakWhile = true;  // Mark that we want to stop communication by breaking the overarching while loop
+              }
 		  
-          Serial1.readBytes(rx, Serial1.available());  // Read in the bytes
-          if (rx[15] == 0x4E) {  // If the payload was an 'N'
-            delay(20);
-            String dataValue = "";  // Create a String object where the measurement can be stored
-            dataValue += dataLogger.getValueStringAtI(varNum);  // Grab the measurement and put it in the String
-            char val[dataValue.length() + 1];  // Create a string of characters that will actually send
-            dataValue.toCharArray(val, sizeof(val));  // Turn the String into a string
-            transmitString(val, sizeof(val), 0x00, 0x00, 0x00);  // Send the data value to the host
-            memset(rx, 0x00, sizeof(rx));  // Clear the buffer
-          }
+              if (breakWhile) {  // If we noted that we want to stop trying to send data
+                // Break the overarching while loop where we send all the data, effectively ending
+                // all communication until the next logging interval
+                break;  
+              }
 		  
-          if (varNum == varCount - 1) {  // If that was our last variable
-            allDataSent = true;  // Then all the data has been sent
-
-            // for some reason, it will not send the last variable measured until the XBee is 
-            // powered off then powered on again, so this catches that
-			      // some debugging is likely needed to fix this
-            digitalWrite(xbeeSleepPin, HIGH);  // Put the XBee to sleep
-            delay(100);  // Let its stomach settle
-            digitalWrite(xbeeSleepPin, LOW);  // Wake the XBee
-            delay(100);  // Let it make its last transmission
+              if (decoder.rfData()[0] == 0x4E) {  // If the payload was an 'N'
+                // Send the measurement, which was written out as text once when it was taken
+                transmitBytes((const byte*)dataLogger.getValueCharAtI(varNum), dataLogger.getValueLengthAtI(varNum), 0x00, 0x00, 0x00);
+              }
+            }
+
+            if (varNum == varCount - 1) {  // If that was our last variable
+              allDataSent = true;  // Then all the data has been sent
+              ackReading(currentSeq);  // and the host has this logging interval's reading
+
+              // for some reason, it will not send the last variable measured until the XBee is 
+              // powered off then powered on again, so this catches that
+  			      // some debugging is likely needed to fix this
+              digitalWrite(xbeeSleepPin, HIGH);  // Put the XBee to sleep
+              delay(100);  // Let its stomach settle
+              digitalWrite(xbeeSleepPin, LOW);  // Wake the XBee
+              delay(100);  // Let it make its last transmission
+            }
           }
         }
       }
@@ -1188,6 +1520,19 @@ void loop() {
 	
 	// We are all done with radio communications
     digitalWrite(xbeeSleepPin, HIGH);  // Put the XBee to sleep
+    radioOnMs = millis() - radioOnStart;
+    // Set our clock to the base station's if it is too far off, and trim its rate if it drifts
+    if (clockActions & ClockSync::clockStep) {
+      int32_t stepMs = clockSync.stepMs();
+      stepClock(stepMs);
+      clockSync.stepped();
+      slotTimer.clockStepped((stepMs + (stepMs < 0 ? -500 : 500)) / 1000);  // Keep what it learned about the clocks
+    }
+    if (clockActions & ClockSync::clockTrim) {
+      rtc.setAgingOffset(clockSync.trim());
+    }
+    serialPrintRadioStats();  // Let anyone watching know how the radio link did
+    dataLogger.turnOffSDcard(true);  // We are done with the queue file too
 	digitalWrite(redLED, LOW);  // Turn off the red LED
   }
 }
@@ -0,0 +1,572 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the ADS1x15Manager in the ModularSensors
+library, which takes the readings for every sensor sharing the ADS1115 converters, against stand-in chips
+on a stand-in I2C bus. It also takes the sketches' readings the way they were taken before the manager,
+with an Adafruit_ADS1115 for each one, and says how the two compare.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -std=c++17 -O2 -D ARDUINO=10819 -I ../host_arduino \
+      -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -I ../../arduino_libraries/Adafruit_ADS1X15 -o ads1x15_test ads1x15_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/sensors/ADS1x15Manager.cpp \
+      ../../arduino_libraries/Adafruit_ADS1X15/Adafruit_ADS1015.cpp
+
+and run it:
+
+  ads1x15_test [--plans 2000] [--seed 1]
+
+The stand-in chips keep their registers and take as long to convert as a real ADS1115, with their clocks
+running up to 10% fast or slow as the datasheet allows. The bus takes as long as it would at 100 kHz.
+
+First the readings the sketches take (the SP-510 and SP-610 on 0x48, the SL-510 and SL-610 thermistors
+and the battery on 0x49, and the SL-510 and SL-610 thermopiles on 0x4A) are taken both ways over many
+logging intervals, and the time and I2C transactions each way takes are printed.
+
+Then it registers random sets of single-ended and differential channels, with random gains and data
+rates, on one to four chips and reads them over and over with new voltages on the inputs each time.
+Some sets have a chip missing from the bus or a bus that now and then drops a transaction. It checks:
+
+- each reading is the one its chip gives for that channel's inputs, gain and voltages right now, never
+  another channel's reading or an old one; a reading that couldn't be taken is -9999
+- a conversion is never read before it's finished, and a chip is never given a new conversion while
+  it's still converting
+- the chips convert at the same time: a sweep takes little longer than the busiest chip's conversions
+- registering a channel twice gives back the same channel, and a ninth channel is turned away
+- each reading is handed out once, and a reading too old to use is taken again
+- a burst reads every conversion at most once, its statistics are the conversions it read, and the chip
+  goes back to single-shot mode after it
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sensors/ADS1x15Manager.h"
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+static double randomBetween(double low, double high) {
+    return low + (high - low) * randomNumber(1000001) / 1000000.0;
+}
+
+
+static long problems = 0;
+
+static void problem(const char* what, long plan, int channel) {
+    if (problems++ < 10) printf("PROBLEM: %s (set %ld, channel %d)\n", what, plan, channel);
+}
+
+
+// What the config register's bits mean on an ADS1115
+static const uint16_t samplesPerSecond[8] = {8, 16, 32, 64, 128, 250, 475, 860};
+static const double   fullScale[8]        = {6.144, 4.096, 2.048, 1.024, 0.512, 0.256, 0.256, 0.256};
+
+static double voltsPerCount(uint16_t config) {
+    return fullScale[(config >> 9) & 0x07] / 32768;
+}
+
+
+/*
+An ADS1115. A single-shot conversion starts when the config register is written with the OS bit set and
+takes a data rate period after the chip wakes up; in continuous mode a new conversion is finished every
+period from when the config register was written. The conversion register holds the last one finished.
+*/
+class FakeADS1115 : public HostI2CDevice {
+ public:
+    double inputs[4];   // The voltage on each input
+    double noise;       // Each conversion is off by up to this many volts either way
+    double clockSpeed;  // How fast its clock runs, from 0.9 to 1.1
+    double dropChance;  // How often a transaction isn't acknowledged
+
+    // What the chip was asked to do
+    long   starts, configReads, busyReads, earlyReads, restarts, twiceReads;
+    long   handedOut;  // The conversions read in continuous mode, and what they were in volts
+    double handedSum, handedSumSq, handedMin, handedMax;
+
+    void reset(void) {
+        noise       = 0;
+        clockSpeed  = 1;
+        dropChance  = 0;
+        _config     = 0x8583;
+        _pointer    = 0;
+        _conversion = 0;
+        _converting = false;
+        _continuous = false;
+        starts = configReads = busyReads = earlyReads = restarts = twiceReads = 0;
+        clearHandedOut();
+        for (int i = 0; i < 4; i++) inputs[i] = 0;
+    }
+    void clearHandedOut(void) {
+        handedOut = 0;
+        handedSum = handedSumSq = handedMin = handedMax = 0;
+    }
+    bool continuous(void) {
+        return _continuous;
+    }
+
+    // The counts the chip converts a channel's inputs to, leaving out the noise
+    int16_t convert(uint16_t config, bool noisy = false) {
+        static const int8_t positive[8] = {0, 0, 1, 2, 0, 1, 2, 3};
+        static const int8_t negative[8] = {1, 3, 3, 3, -1, -1, -1, -1};
+        uint8_t             mux         = (config >> 12) & 0x07;
+        double volts = inputs[positive[mux]] - (negative[mux] < 0 ? 0 : inputs[negative[mux]]);
+        if (noisy && noise > 0) volts += randomBetween(-noise, noise);
+        double counts = floor(volts / voltsPerCount(config));
+        if (counts > 32767) counts = 32767;
+        if (counts < -32768) counts = -32768;
+        return static_cast<int16_t>(counts);
+    }
+
+    bool received(const uint8_t* data, uint8_t length) override {
+        if (length == 0 || dropped()) return false;
+        catchUp();
+        _pointer = data[0] & 0x03;
+        if (length < 3 || _pointer != 1) return true;
+
+        uint16_t value = (static_cast<uint16_t>(data[1]) << 8) | data[2];
+        if (_converting) restarts++;
+        _config     = value & 0x7FFF;
+        _startedAt  = micros();
+        _continuous = !(value & 0x0100);
+        _done       = 0;
+        _lastRead   = 0;
+        _converting = !_continuous && (value & 0x8000);
+        if (_converting) starts++;
+        return true;
+    }
+
+    bool requested(uint8_t* data, uint8_t length) override {
+        if (dropped()) return false;
+        catchUp();
+        uint16_t value;
+        if (_pointer == 1) {
+            configReads++;
+            if (_converting) busyReads++;
+            value = _config | (_converting ? 0 : 0x8000);
+        } else {
+            if (_converting || (_continuous && _done == 0)) earlyReads++;
+            if (_continuous && _done > 0) {
+                if (_done == _lastRead) twiceReads++;
+                _lastRead  = _done;
+                double got = _conversion * voltsPerCount(_config);
+                if (handedOut == 0 || got < handedMin) handedMin = got;
+                if (handedOut == 0 || got > handedMax) handedMax = got;
+                handedOut++;
+                handedSum += got;
+                handedSumSq += got * got;
+            }
+            value = static_cast<uint16_t>(_conversion);
+        }
+        for (uint8_t i = 0; i < length; i++) data[i] = i == 0 ? value >> 8 : i == 1 ? value & 0xFF : 0;
+        return true;
+    }
+
+ private:
+    bool dropped(void) {
+        return dropChance > 0 && randomNumber(1000000) < dropChance * 1000000;
+    }
+
+    // Finishes whatever conversions should have finished by now
+    void catchUp(void) {
+        static const double wake_us = 25;
+        double period_us = 1000000.0 / (samplesPerSecond[(_config >> 5) & 0x07] * clockSpeed);
+        double elapsed   = micros() - _startedAt;
+        if (_converting && elapsed >= wake_us + period_us) {
+            _conversion = convert(_config, true);
+            _converting = false;
+        }
+        if (_continuous && elapsed >= wake_us + period_us) {
+            uint32_t done = static_cast<uint32_t>((elapsed - wake_us) / period_us);
+            if (done > _done) {
+                _done       = done;
+                _conversion = convert(_config, true);
+            }
+        }
+    }
+
+    uint16_t _config;
+    uint8_t  _pointer;
+    int16_t  _conversion;
+    bool     _converting;
+    bool     _continuous;
+    uint32_t _startedAt;
+    uint32_t _done;      // The conversions finished in continuous mode
+    uint32_t _lastRead;  // Which of them was read last
+};
+
+static const uint8_t firstAddress = 0x48;
+static const int     chipCount    = 4;
+static FakeADS1115   chips[chipCount];
+
+static FakeADS1115& chipAt(uint8_t address) {
+    return chips[address - firstAddress];
+}
+
+
+/*
+The readings the sketches take, with what each sensor did before there was a manager
+*/
+struct SketchReading {
+    const char* what;
+    uint8_t     address;
+    int         input;  // 0 to 3 for a single-ended input, or -1 for inputs 0 and 1 and -2 for 2 and 3
+    adsGain_t   gain;
+};
+
+static const SketchReading sketchReadings[] = {
+    {"SP-510", 0x48, -2, GAIN_SIXTEEN},
+    {"SP-610", 0x48, -1, GAIN_SIXTEEN},
+    {"SL-510 thermistor", 0x49, 1, GAIN_ONE},
+    {"SL-510 thermopile", 0x4A, -1, GAIN_SIXTEEN},
+    {"SL-610 thermistor", 0x49, 2, GAIN_ONE},
+    {"SL-610 thermopile", 0x4A, -2, GAIN_SIXTEEN},
+    {"battery", 0x49, 3, GAIN_ONE},
+};
+static const int sketchReadingCount = sizeof(sketchReadings) / sizeof(sketchReadings[0]);
+
+static uint16_t sketchConfig(const SketchReading& reading) {
+    uint16_t mux = reading.input == -1 ? DIFF_MUX_0_1
+        : reading.input == -2          ? DIFF_MUX_2_3
+                                       : ADS1X15_REG_CONFIG_MUX_SINGLE_0 | (reading.input << 12);
+    return mux | reading.gain | DR_DEFAULT_SPS;
+}
+
+static float readTheOldWay(const SketchReading& reading) {
+    Adafruit_ADS1115 ads(reading.address);
+    ads.setGain(reading.gain);
+    ads.begin();
+    if (reading.input == -1) return ads.readADC_Differential_0_1_V();
+    if (reading.input == -2) return ads.readADC_Differential_2_3_V();
+    return ads.readADC_SingleEnded_V(reading.input);
+}
+
+static void sketchVoltages(void) {
+    for (int c = 0; c < chipCount; c++) {
+        for (int i = 0; i < 4; i++) chips[c].inputs[i] = randomBetween(0.01, 0.2);
+    }
+    // The thermistors and the battery's divider
+    for (int i = 1; i < 4; i++) chipAt(0x49).inputs[i] = randomBetween(0.3, 3.0);
+}
+
+static void checkSketchReading(const SketchReading& reading, float got, int channel) {
+    uint16_t config   = sketchConfig(reading);
+    double   expected = chipAt(reading.address).convert(config) * voltsPerCount(config);
+    if (fabs(got - expected) > 1e-6) problem("a sketch reading came back wrong", 0, channel);
+}
+
+static void compareWithTheOldWay(int intervals) {
+    ADS1x15Manager manager(&Wire);
+    manager.begin();
+    uint8_t channels[sketchReadingCount];
+    for (int r = 0; r < sketchReadingCount; r++) {
+        const SketchReading& reading = sketchReadings[r];
+        uint16_t             mux     = sketchConfig(reading) & ADS1X15_REG_CONFIG_MUX_MASK;
+        channels[r] = reading.input >= 0
+            ? manager.addSingleEnded(reading.address, reading.input, reading.gain)
+            : manager.addDifferential(reading.address, static_cast<adsDiffMux_t>(mux), reading.gain);
+    }
+
+    double oldTime = 0, newTime = 0, oldTransactions = 0, newTransactions = 0;
+    for (int interval = 0; interval < intervals; interval++) {
+        sketchVoltages();
+        uint32_t started      = micros();
+        uint32_t transactions = Wire.transactions;
+        for (int r = 0; r < sketchReadingCount; r++) {
+            checkSketchReading(sketchReadings[r], readTheOldWay(sketchReadings[r]), r);
+        }
+        oldTime += micros() - started;
+        oldTransactions += Wire.transactions - transactions;
+
+        // A logging interval later
+        delay(5UL * 60 * 1000);
+        started      = micros();
+        transactions = Wire.transactions;
+        for (int r = 0; r < sketchReadingCount; r++) {
+            checkSketchReading(sketchReadings[r], manager.readVoltage(channels[r]), r);
+        }
+        newTime += micros() - started;
+        newTransactions += Wire.transactions - transactions;
+        delay(5UL * 60 * 1000);
+    }
+    printf("The sketches' %d readings at 128 samples per second, each logging interval:\n",
+           sketchReadingCount);
+    printf("  an Adafruit_ADS1115 for each: %5.1f ms and %5.1f I2C transactions\n",
+           oldTime / intervals / 1000, oldTransactions / intervals);
+    printf("  the ADS1x15Manager:           %5.1f ms and %5.1f I2C transactions\n",
+           newTime / intervals / 1000, newTransactions / intervals);
+}
+
+
+/*
+A random set of channels
+*/
+struct Channel {
+    uint8_t  address;
+    uint16_t config;  // The mux, gain and data rate bits
+    uint8_t  given;   // The channel the manager gave back
+};
+
+// The time a conversion should take, as the manager works it out
+static double conversionTime_us(uint16_t config) {
+    return 1000000.0 / samplesPerSecond[(config >> 5) & 0x07] * 10 / 9;
+}
+
+static void randomVoltages(int usedChips) {
+    for (int c = 0; c < usedChips; c++) {
+        // Mostly small voltages, so the high gains aren't always at full scale
+        double top = randomNumber(2) == 0 ? 0.25 : 3.3;
+        for (int i = 0; i < 4; i++) chips[c].inputs[i] = randomBetween(0, top);
+    }
+}
+
+static long   sweeps = 0, bursts = 0, burstReadings = 0, conversions = 0, sweepTransactions = 0;
+static double sweepTime = 0, oneAfterAnotherTime = 0;
+
+static void runPlan(long plan) {
+    int  usedChips = 1 + randomNumber(chipCount);
+    bool dropping  = randomNumber(4) == 0;
+    int  missing   = randomNumber(8) == 0 ? randomNumber(usedChips) : -1;
+    for (int c = 0; c < chipCount; c++) {
+        chips[c].reset();
+        chips[c].clockSpeed = randomBetween(0.9, 1.1);
+        chips[c].dropChance = dropping ? 0.02 : 0;
+        Wire.devices[firstAddress + c] = c < usedChips && c != missing ? &chips[c] : nullptr;
+    }
+    bool failing = dropping || missing >= 0;
+
+    // Register the channels
+    ADS1x15Manager manager(&Wire);
+    manager.begin();
+    Channel channels[MS_ADS1X15_MAX_CHANNELS];
+    int     channelCount = 0;
+    int     wanted       = 1 + randomNumber(MS_ADS1X15_MAX_CHANNELS);
+    while (channelCount < wanted) {
+        Channel& channel = channels[channelCount];
+        channel.address  = firstAddress + randomNumber(usedChips);
+        adsGain_t gain   = static_cast<adsGain_t>(randomNumber(6) << 9);
+        adsSPS_t  rate   = static_cast<adsSPS_t>(randomNumber(8) << 5);
+        if (randomNumber(2) == 0) {
+            uint8_t input  = randomNumber(4);
+            channel.config = (ADS1X15_REG_CONFIG_MUX_SINGLE_0 | (input << 12)) | gain | rate;
+            channel.given  = manager.addSingleEnded(channel.address, input, gain, rate);
+        } else {
+            adsDiffMux_t pair = static_cast<adsDiffMux_t>(randomNumber(4) << 12);
+            channel.config    = pair | gain | rate;
+            channel.given     = manager.addDifferential(channel.address, pair, gain, rate);
+        }
+        bool again = false;
+        for (int c = 0; c < channelCount; c++) {
+            if (channels[c].address == channel.address && channels[c].config == channel.config) {
+                if (channel.given != channels[c].given) {
+                    problem("a channel registered twice came back new", plan, c);
+                }
+                again = true;
+            }
+        }
+        if (again) continue;
+        if (channel.given != channelCount) {
+            problem("a channel wasn't given the next number", plan, channelCount);
+        }
+        channelCount++;
+    }
+    if (manager.getChannelCount() != channelCount) {
+        problem("the manager has the wrong channel count", plan, -1);
+    }
+    if (channelCount == MS_ADS1X15_MAX_CHANNELS) {
+        // Any single-ended input on the last chip not already registered
+        for (uint8_t input = 0; input < 4; input++) {
+            uint16_t config =
+                (ADS1X15_REG_CONFIG_MUX_SINGLE_0 | (input << 12)) | GAIN_SIXTEEN | DR_DEFAULT_SPS;
+            bool     taken  = false;
+            for (int c = 0; c < channelCount; c++) {
+                taken |= channels[c].address == firstAddress + chipCount - 1 && channels[c].config == config;
+            }
+            if (taken) continue;
+            uint8_t given = manager.addSingleEnded(firstAddress + chipCount - 1, input, GAIN_SIXTEEN);
+            if (given != ADS1X15_NO_CHANNEL) {
+                problem("a channel past the most there's room for was taken", plan, given);
+            }
+            break;
+        }
+    }
+
+    // The busiest chip's conversions one after another, and everyone's
+    double busiest = 0, all = 0;
+    for (int c = 0; c < chipCount; c++) {
+        double chipTime = 0;
+        for (int i = 0; i < channelCount; i++) {
+            if (channels[i].address == firstAddress + c) chipTime += conversionTime_us(channels[i].config);
+        }
+        if (chipTime > busiest) busiest = chipTime;
+        all += chipTime;
+    }
+
+    for (int round = 0; round < 4; round++) {
+        // A sweep
+        randomVoltages(usedChips);
+        long startsBefore = 0;
+        for (int c = 0; c < chipCount; c++) startsBefore += chips[c].starts;
+        uint32_t started      = micros();
+        uint32_t transactions = Wire.transactions;
+        bool     success      = manager.update();
+        double   took         = micros() - started;
+        if (!failing) {
+            if (!success) problem("a sweep failed with every chip answering", plan, -1);
+            // Each conversion takes a write and two reads of about half a millisecond at 100 kHz
+            if (took > busiest + channelCount * 2000.0) problem("a sweep took too long", plan, -1);
+            sweeps++;
+            if (usedChips > 1) {
+                sweepTime += took;
+                oneAfterAnotherTime += all;
+            }
+            conversions += channelCount;
+            sweepTransactions += Wire.transactions - transactions;
+        }
+
+        // Hand out each reading, in any order, without converting again
+        int order[MS_ADS1X15_MAX_CHANNELS];
+        for (int i = 0; i < channelCount; i++) order[i] = i;
+        for (int i = channelCount - 1; i > 0; i--) {
+            int j    = randomNumber(i + 1);
+            int swap = order[i];
+            order[i] = order[j];
+            order[j] = swap;
+        }
+        long startsAfter = 0;
+        for (int c = 0; c < chipCount; c++) startsAfter += chips[c].starts;
+        for (int k = 0; k < channelCount; k++) {
+            const Channel& channel  = channels[order[k]];
+            FakeADS1115&   chip     = chipAt(channel.address);
+            float          got      = manager.readVoltage(channel.given);
+            double         expected = chip.convert(channel.config) * voltsPerCount(channel.config);
+            bool           gone     = Wire.devices[channel.address] == nullptr;
+            if (got == -9999) {
+                if (!failing) {
+                    problem("a reading couldn't be taken with every chip answering", plan, order[k]);
+                }
+            } else if (gone) {
+                problem("a chip that isn't there gave a reading", plan, order[k]);
+            } else if (fabs(got - expected) > 1e-6) {
+                problem("a reading isn't the one its chip gives for it", plan, order[k]);
+            }
+        }
+        long startsNow = 0;
+        for (int c = 0; c < chipCount; c++) startsNow += chips[c].starts;
+        if (!failing && startsNow != startsAfter) {
+            problem("handing out the readings converted again", plan, -1);
+        }
+        if (!failing && startsAfter - startsBefore != channelCount) {
+            problem("a sweep didn't convert each channel once", plan, -1);
+        }
+
+        // A reading already handed out is taken again, and so is one too old to use
+        int again = randomNumber(channelCount);
+        if (randomNumber(2) == 0) delay(ADS1X15_MAX_READING_AGE_MS + 1);
+        randomVoltages(usedChips);
+        float  got      = manager.readVoltage(channels[again].given);
+        double expected = chipAt(channels[again].address).convert(channels[again].config) *
+            voltsPerCount(channels[again].config);
+        if (!failing && fabs(got - expected) > 1e-6) {
+            problem("a reading asked for again wasn't taken again", plan, again);
+        }
+        // Leave the rest handed out, so the next sweep starts fresh
+        for (int i = 0; i < channelCount; i++) {
+            if (i != again) manager.readVoltage(channels[i].given);
+        }
+        delay(ADS1X15_MAX_READING_AGE_MS + 1);
+
+        // A burst on one of the channels, long enough for a few conversions at its data rate
+        if (randomNumber(2) == 0) {
+            int            b       = randomNumber(channelCount);
+            const Channel& channel = channels[b];
+            FakeADS1115&   chip    = chipAt(channel.address);
+            double         period  = conversionTime_us(channel.config);
+            uint16_t       window  = 1 + static_cast<uint16_t>(period * (2 + randomNumber(200)) / 1000);
+            if (window > 2000) window = 2000;
+            chip.noise = randomBetween(0, 30) * voltsPerCount(channel.config);
+            chip.clearHandedOut();
+            ADS1x15Stats stats;
+            bool         success = manager.burst(channel.given, window, stats);
+            chip.noise           = 0;
+            if (!failing) {
+                bursts++;
+                burstReadings += stats.count;
+                if (!success || stats.count == 0) problem("a burst read nothing", plan, b);
+                if (chip.continuous()) problem("a burst left its chip converting", plan, b);
+            }
+            if (success) {
+                double n      = chip.handedOut;
+                double mean   = chip.handedSum / n;
+                double spread = n > 1 ? sqrt(fmax(0, (chip.handedSumSq - n * mean * mean) / (n - 1))) : 0;
+                double close  = 1e-4 * fullScale[(channel.config >> 9) & 0x07];
+                if (stats.count != chip.handedOut) problem("a burst's count isn't what it read", plan, b);
+                if (fabs(stats.mean - mean) > close || fabs(stats.min - chip.handedMin) > close ||
+                    fabs(stats.max - chip.handedMax) > close || fabs(stats.stdDev - spread) > 10 * close) {
+                    problem("a burst's statistics aren't what it read", plan, b);
+                }
+            }
+        }
+    }
+
+    for (int c = 0; c < chipCount; c++) {
+        if (chips[c].earlyReads > 0) problem("a conversion was read before it was finished", plan, -1);
+        if (chips[c].restarts > 0) problem("a chip was given a conversion while converting", plan, -1);
+        if (chips[c].twiceReads > 0) problem("a burst read the same conversion twice", plan, -1);
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    long plans = 2000;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--plans") == 0 && hasValue) {
+            plans = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: ads1x15_test [--plans 2000] [--seed 1]\n");
+            return 1;
+        }
+    }
+
+    for (int c = 0; c < chipCount; c++) {
+        chips[c].reset();
+        chips[c].clockSpeed            = randomBetween(0.9, 1.1);
+        Wire.devices[firstAddress + c] = &chips[c];
+    }
+    compareWithTheOldWay(100);
+
+    long busyReads = 0;
+    for (long plan = 1; plan <= plans; plan++) {
+        runPlan(plan);
+        for (int c = 0; c < chipCount; c++) busyReads += chips[c].busyReads;
+    }
+    printf("%ld sets of channels, %ld sweeps of %ld conversions:\n", plans, sweeps, conversions);
+    printf("  %.2f I2C transactions for each conversion, %ld config reads found a chip still converting\n",
+           conversions > 0 ? double(sweepTransactions) / conversions : 0.0, busyReads);
+    printf("  on more than one chip, the sweeps took %.0f%% of the time the conversions would take one\n"
+           "  after another\n",
+           oneAfterAnotherTime > 0 ? 100 * sweepTime / oneAfterAnotherTime : 0.0);
+    printf("  %ld bursts read %ld conversions\n", bursts, burstReadings);
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("Every reading was the right one, taken once, and no conversion was read before it was done\n");
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*
+This program runs on your computer, not on the Mayfly. It turns the binary log files a station keeps
+on its microSD card (see BinaryLog.h in the SnowRadio library) back into the same CSV rows the
+station would have written to its text log file.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o binlog_to_csv binlog_to_csv.cpp \
+      ../../arduino_libraries/SnowRadio/src/BinaryLog.cpp \
+      ../../arduino_libraries/SnowRadio/src/MeasurementRecord.cpp
+
+and run it on a file copied off the card (or straight off the card in a card reader):
+
+  binlog_to_csv [--from "YYYY-MM-DD HH:MM:SS"] [--to "YYYY-MM-DD HH:MM:SS"] [--index] log.bin [out.csv]
+
+The CSV goes to out.csv, or to the screen if no output file is given. --from and --to limit the rows
+to a time range, given in the logger's time zone like the timestamps in the file. The blocks are
+found with a binary search over the block headers, so only the blocks in the range are read, however
+big the file is. --index lists the blocks instead: each block's number, its first and last
+timestamp, how many records it holds, and whether its CRC is good.
+
+A block that fails its CRC (which can only be the one being written when the power went out) is
+skipped, and a note about it is printed on the screen.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BinaryLog.h"
+#include "MeasurementRecord.h"
+
+
+// A RecordStore that reads an ordinary file on the computer
+class FileStore : public RecordStore {
+ public:
+    explicit FileStore(FILE* file) : _file(file) {}
+
+    bool read(uint32_t position, uint8_t* data, uint16_t length) override {
+        return fseek(_file, position, SEEK_SET) == 0 &&
+            fread(data, 1, length, _file) == length;
+    }
+
+    // The converter never changes the log
+    bool write(uint32_t, const uint8_t*, uint16_t) override {
+        return false;
+    }
+
+ private:
+    FILE* _file;
+};
+
+
+// Days since 1970-01-01 of a date, and back again (proleptic Gregorian)
+static int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    int64_t  era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(year - era * 400);
+    unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static void civilFromDays(int64_t days, int* year, int* month, int* day) {
+    days += 719468;
+    int64_t  era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = static_cast<unsigned>(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp  = (5 * doy + 2) / 153;
+    *day         = doy - (153 * mp + 2) / 5 + 1;
+    *month       = mp < 10 ? mp + 3 : mp - 9;
+    *year        = static_cast<int>(yoe + era * 400 + (*month <= 2));
+}
+
+// Writes a timestamp the way the logger's DateTime::addToString() does
+static int formatTime(uint32_t timestamp, char* text) {
+    int year, month, day;
+    civilFromDays(timestamp / 86400, &year, &month, &day);
+    uint32_t second = timestamp % 86400;
+    return sprintf(text, "%04d-%02d-%02d %02u:%02u:%02u", year, month, day,
+                   second / 3600, (second / 60) % 60, second % 60);
+}
+
+// Reads a "YYYY-MM-DD HH:MM:SS" time; the seconds, or the whole time of day,
+// can be left off
+static bool parseTime(const char* text, uint32_t* timestamp) {
+    int year, month, day, hour = 0, minute = 0, second = 0;
+    int fields = sscanf(text, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour,
+                        &minute, &second);
+    if (fields != 3 && fields != 5 && fields != 6) return false;
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+    int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 +
+        minute * 60 + second;
+    if (seconds < 0 || seconds > 0xFFFFFFFFLL) return false;
+    *timestamp = static_cast<uint32_t>(seconds);
+    return true;
+}
+
+
+static void printUsage(void) {
+    fprintf(stderr,
+            "Usage: binlog_to_csv [--from \"YYYY-MM-DD HH:MM:SS\"] "
+            "[--to \"YYYY-MM-DD HH:MM:SS\"] [--index] log.bin [out.csv]\n");
+}
+
+
+int main(int argc, char* argv[]) {
+    const char* inName  = NULL;
+    const char* outName = NULL;
+    uint32_t    from    = 0;
+    uint32_t    to      = 0xFFFFFFFFUL;
+    bool        index   = false;
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--from") == 0 && a + 1 < argc) {
+            if (!parseTime(argv[++a], &from)) {
+                fprintf(stderr, "Can't read the time %s\n", argv[a]);
+                return 1;
+            }
+        } else if (strcmp(argv[a], "--to") == 0 && a + 1 < argc) {
+            if (!parseTime(argv[++a], &to)) {
+                fprintf(stderr, "Can't read the time %s\n", argv[a]);
+                return 1;
+            }
+        } else if (strcmp(argv[a], "--index") == 0) {
+            index = true;
+        } else if (argv[a][0] == '-' && argv[a][1] != '\0') {
+            printUsage();
+            return 1;
+        } else if (inName == NULL) {
+            inName = argv[a];
+        } else if (outName == NULL) {
+            outName = argv[a];
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (inName == NULL) {
+        printUsage();
+        return 1;
+    }
+
+    FILE* in = fopen(inName, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Can't open %s\n", inName);
+        return 1;
+    }
+    FileStore store(in);
+    BinaryLog log(store);
+    if (!log.open()) {
+        fprintf(stderr, "%s isn't a binary log this can read\n", inName);
+        fclose(in);
+        return 1;
+    }
+
+    // The schema gives each value its code and its number of decimal places
+    static char    schemaText[65535];
+    static char    codes[65535];
+    RecordSchema   schema;
+    schema.begin(codes, sizeof(codes));
+    uint16_t schemaLength = log.readSchema(schemaText, sizeof(schemaText));
+    if (schemaLength == 0 || !schema.load(schemaText, schemaLength) ||
+        schema.varCount() != log.varCount()) {
+        fprintf(stderr, "The schema in %s can't be read\n", inName);
+        fclose(in);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (outName != NULL) {
+        out = fopen(outName, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Can't create %s\n", outName);
+            fclose(in);
+            return 1;
+        }
+    }
+    static char outBuffer[1 << 16];
+    setvbuf(out, outBuffer, _IOFBF, sizeof(outBuffer));
+
+    uint32_t blocks = log.blockCount();
+    uint8_t  block[BINARY_LOG_BLOCK_SIZE];
+    char     text[RECORD_VALUE_TEXT_SIZE];
+    uint32_t badBlocks = 0;
+
+    if (index) {
+        fprintf(out, "Block,First,Last,Records,CRC\n");
+        for (uint32_t b = 0; b < blocks; b++) {
+            bool good = log.readBlock(b, block);
+            char first[24];
+            char last[24];
+            formatTime(BinaryLog::blockFirst(block), first);
+            formatTime(BinaryLog::blockLast(block), last);
+            fprintf(out, "%lu,%s,%s,%u,%s\n", static_cast<unsigned long>(b),
+                    first, last, BinaryLog::blockRecords(block),
+                    good ? "good" : "bad");
+        }
+    } else {
+        // The same header row the logger writes above its values
+        fprintf(out, "Date and Time in UTC");
+        if (log.timeZone() != 0) fprintf(out, "%+d", log.timeZone());
+        for (uint8_t i = 0; i < schema.varCount(); i++) {
+            fprintf(out, ",%s", schema.code(i));
+        }
+        fputc('\n', out);
+
+        for (uint32_t b = log.findBlock(from, blocks); b < blocks; b++) {
+            if (!log.readBlock(b, block)) {
+                badBlocks++;
+                continue;
+            }
+            if (BinaryLog::blockFirst(block) > to) break;
+            for (uint16_t r = 0; r < BinaryLog::blockRecords(block); r++) {
+                const uint8_t* record    = log.blockRecord(block, r);
+                uint32_t       timestamp = BinaryLog::recordTimestamp(record);
+                if (timestamp < from || timestamp > to) continue;
+
+                char line[24];
+                fwrite(line, 1, formatTime(timestamp, line), out);
+                RecordReader reader(record, log.recordSize(),
+                                    BINARY_LOG_TIMESTAMP_SIZE);
+                for (uint8_t i = 0; i < schema.varCount(); i++) {
+                    fputc(',', out);
+                    if (reader.nextValue(schema.format(i), text,
+                                         sizeof(text))) {
+                        fputs(text, out);
+                    }
+                }
+                fputc('\n', out);
+            }
+        }
+    }
+
+    bool written = fflush(out) == 0;
+    if (out != stdout) written = fclose(out) == 0 && written;
+    fclose(in);
+    if (badBlocks > 0) {
+        fprintf(stderr, "Skipped %lu block(s) that failed their CRC\n",
+                static_cast<unsigned long>(badBlocks));
+    }
+    if (!written) {
+        fprintf(stderr, "Couldn't write all of the CSV\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,345 @@
+/*
+This program runs on your computer, not on the Mayfly. It simulates satellite stations keeping their clocks
+set to the base station's over the radio (see ClockSync.h in the SnowRadio library), to show how closely the
+clocks agree with each other for how far they drift and how long the radio takes to carry a message.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o clock_sim clock_sim.cpp \
+      ../../arduino_libraries/SnowRadio/src/ClockSync.cpp
+
+and run it:
+
+  clock_sim [--stations 5] [--days 60] [--drifts 2,5,20] [--jitters 0,20,100] [--latency 40]
+            [--asymmetry 0] [--loss 0.1] [--wander 2] [--offset 20] [--step 250] [--max-step 60]
+            [--trim-after 86400] [--max-trim 50] [--seed 1]
+
+Each station's DS3231 starts up to --offset seconds from the base station's and runs fast or slow by up to
+each of the --drifts (in parts per million), plus a daily swing of up to --wander ppm with the temperature.
+Its aging offset slows it by 0.1 to 0.13 ppm a step, since that changes with the temperature too. Its
+Mayfly's millis() runs up to 30 ppm off. Once an hour, the base station sends it an 'R' with the time on
+its clock, which takes --latency milliseconds plus up to the --jitters to get there (--asymmetry more
+than the way back). The station takes 5 to 40 milliseconds to answer, and the base station works out the
+round trip from the answer for the next hour. Each 'R' and each answer is lost with the chance given in
+--loss. The same ClockSync the satellite sketches use says when to step the clock and how to trim its rate,
+and the clock is stepped the way the sketches do it, at the start of one of the base station's seconds.
+--step, --max-step, --trim-after and --max-trim are clockStepMs, clockMaxStep, clockTrimAfter and
+clockMaxTrim in the satellite sketches.
+
+For each combination it prints how far the stations' clocks were from the base station's just before
+each 'R' (on average, 95% of the time, and at most, leaving out the first day), how often each clock was
+stepped, how fast the clocks drifted by the end once their rates were trimmed, and how far they would
+have been off by the end without any of it.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ClockSync.h"
+
+
+// The satellite settings the sketches ship with
+static const uint32_t cycleS        = 3600;
+static const double   slotOpenS     = 90;
+static const double   exchangeS     = 10;
+static const uint32_t firstBackoff  = 2000;
+
+// The time the simulation starts at, the start of a cycle
+static const double startEpoch = 1700000000.0 - fmod(1700000000.0, cycleS);
+
+static const int maxStations = 32;
+static const int maxList     = 16;
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static double randomUnit(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (rngState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double randomBetween(double low, double high) {
+    return low + (high - low) * randomUnit();
+}
+
+
+// A satellite station's DS3231, and its Mayfly's millis()
+struct StationClock {
+    double offset;  // Seconds ahead of the base station's clock at lastT
+    double lastT;  // The base station's time offset was worked out at
+    double ratePpm;  // How much faster it runs
+    double wanderPpm;  // How far its rate swings over a day
+    double phase;  // When in the day the swing peaks
+    double ppmPerTrim;  // How much a step of the aging offset slows it
+    int8_t trim;  // Its aging offset
+    double millisPpm;  // How much faster millis() runs than the base station's clock
+
+    // Moves offset on to a time on the base station's clock
+    void advance(double t) {
+        const double w = 2 * M_PI / 86400.0;
+        double swing = wanderPpm / w *
+            (cos(w * (lastT - startEpoch) + phase) - cos(w * (t - startEpoch) + phase));
+        offset += 1e-6 * ((ratePpm - trim * ppmPerTrim) * (t - lastT) + swing);
+        lastT = t;
+    }
+
+    // The time on the station's clock at a time on the base station's clock, to a fraction of a second
+    double local(double t) {
+        advance(t);
+        return t + offset;
+    }
+
+    // The base station's time when the station's clock reaches a time
+    double when(double local) {
+        double t = local - offset;
+        for (int i = 0; i < 3; i++) t += local - this->local(t);
+        return t;
+    }
+
+    // Sets the clock to a whole second at a time on the base station's clock
+    void set(double t, uint32_t seconds) {
+        advance(t);
+        offset = seconds - t;
+    }
+
+    // The station's millis() at a time on the base station's clock
+    uint32_t millisAt(double t) const {
+        return static_cast<uint32_t>(fmod((t - startEpoch) * 1000.0 * (1 + 1e-6 * millisPpm), 4294967296.0));
+    }
+
+    // The base station's time when millis() reaches a value, near a time
+    double whenMillis(uint32_t ms, double near) const {
+        int32_t ahead = static_cast<int32_t>(ms - millisAt(near));
+        return near + ahead / (1000.0 * (1 + 1e-6 * millisPpm));
+    }
+};
+
+
+struct Results {
+    double*  errors;  // The offsets just before each 'R' after the first day, in milliseconds
+    uint32_t count;
+    uint32_t steps;
+    double   residualTotal;  // How fast the clocks drift at the end, in ppm
+    double   freeTotal;  // How far off the clocks would be at the end without syncing, in seconds
+};
+
+
+static int readList(const char* text, double* list) {
+    int count = 0;
+    while (*text != '\0' && count < maxList) {
+        char* end;
+        list[count++] = strtod(text, &end);
+        if (end == text) return 0;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *static_cast<const double*>(a);
+    double y = *static_cast<const double*>(b);
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+
+// One way across the radio, in seconds
+static double oneWay(double latency, double jitter) {
+    return (latency + randomBetween(0, jitter)) / 1000.0;
+}
+
+
+static void simulate(int stations, int cycles, double drift, double jitter,
+                     double latency, double asymmetry, double loss,
+                     double wander, double maxOffset, uint16_t stepMs,
+                     uint16_t maxStepS, uint32_t trimAfterS, uint8_t maxTrim,
+                     Results* results) {
+    results->count         = 0;
+    results->steps         = 0;
+    results->residualTotal = 0;
+    results->freeTotal     = 0;
+
+    for (int s = 0; s < stations; s++) {
+        StationClock clock;
+        clock.offset     = randomBetween(-maxOffset, maxOffset);
+        clock.lastT      = startEpoch;
+        clock.ratePpm    = randomBetween(-drift, drift);
+        clock.wanderPpm  = randomBetween(0, wander);
+        clock.phase      = randomBetween(0, 2 * M_PI);
+        clock.ppmPerTrim = randomBetween(0.1, 0.13);
+        clock.trim       = 0;
+        clock.millisPpm  = randomBetween(-30, 30);
+        StationClock freeClock = clock;  // The same clock left alone
+
+        ClockSync sync(cycleS, stepMs, maxStepS, trimAfterS, maxTrim);
+        sync.begin(clock.trim);
+        uint16_t roundTrip = 0;  // Kept by the base station
+
+        for (int k = 0; k < cycles; k++) {
+            // The station wakes up for its slot by its own clock, and lines millis() up with its next second,
+            // which it sees up to a couple of milliseconds late reading the clock once a millisecond
+            double   cycleBase = startEpoch + static_cast<double>(k) * cycleS;
+            double   wake      = clock.when(floor(clock.local(cycleBase)) + slotOpenS - 1);
+            uint32_t tickEpoch = static_cast<uint32_t>(floor(clock.local(wake))) + 1;
+            double   tickT     = clock.when(tickEpoch) + randomBetween(0, 0.002);
+            uint32_t tickMs    = clock.millisAt(tickT);
+
+            // The base station asks when the slot opens by its clock, a little later if the station is behind
+            double sent = cycleBase + slotOpenS + randomBetween(0, 0.5);
+            if (sent < tickT) sent = tickT + randomBetween(0, 2);
+            double error = clock.local(sent) - sent;
+            if (k >= static_cast<int>(86400 / cycleS)) {
+                results->errors[results->count++] = fabs(error) * 1000.0;
+            }
+            if (randomUnit() < loss) continue;  // The station doesn't hear it this time
+
+            // The station hears the 'R' and compares the clocks, the way the satellite sketches do
+            double   heard     = sent + oneWay(latency + asymmetry, jitter);
+            uint32_t baseS     = static_cast<uint32_t>(floor(sent));
+            uint16_t baseMs    = static_cast<uint16_t>((sent - baseS) * 1000.0);
+            uint32_t sinceTick = clock.millisAt(heard) - tickMs;
+            uint8_t  actions   = sync.measured(baseS, baseMs, roundTrip, tickEpoch + sinceTick / 1000,
+                                               sinceTick % 1000);
+
+            // It answers, and the base station works out the round trip for next time
+            double   answeredIn = randomBetween(0.005, 0.040);
+            double   back       = heard + answeredIn + oneWay(latency, jitter);
+            uint32_t trip       = static_cast<uint32_t>((back - sent - answeredIn) * 1000.0);
+            if (randomUnit() >= loss && trip < firstBackoff) roundTrip = trip;
+
+            // At the end of the session the clock is stepped at the start of one of the base station's
+            // seconds, like stepClock() in the satellite sketches
+            double done = back + exchangeS;
+            if (actions & ClockSync::clockStep) {
+                int32_t  step       = sync.stepMs();
+                int32_t  baseSince  = static_cast<int32_t>(clock.millisAt(done) - tickMs) + step;
+                int32_t  nextSecond = (baseSince >= 0 ? baseSince / 1000 : (baseSince - 999) / 1000) + 1;
+                uint32_t setAt      = tickMs + static_cast<uint32_t>(nextSecond * 1000L - step);
+                clock.set(clock.whenMillis(setAt, done), tickEpoch + nextSecond);
+                sync.stepped();
+                results->steps++;
+            }
+            if (actions & ClockSync::clockTrim) clock.trim = sync.trim();
+        }
+
+        double end = startEpoch + static_cast<double>(cycles) * cycleS;
+        results->residualTotal += fabs(clock.ratePpm - clock.trim * clock.ppmPerTrim);
+        results->freeTotal += fabs(freeClock.local(end) - end);
+    }
+}
+
+
+static void printUsage(void) {
+    fprintf(stderr,
+            "Usage: clock_sim [--stations N] [--days N] [--drifts ppm,ppm,...] "
+            "[--jitters ms,ms,...] [--latency ms] [--asymmetry ms] [--loss p] "
+            "[--wander ppm] [--offset s] [--step ms] [--max-step s] "
+            "[--trim-after s] [--max-trim N] [--seed N]\n");
+}
+
+
+int main(int argc, char* argv[]) {
+    int    stations = 5;
+    int    days     = 60;
+    double drifts[maxList]  = {2, 5, 20};
+    double jitters[maxList] = {0, 20, 100};
+    int    driftCount       = 3;
+    int    jitterCount      = 3;
+    double latency          = 40;
+    double asymmetry        = 0;
+    double loss             = 0.1;
+    double wander           = 2;
+    double maxOffset        = 20;
+    int    stepMs           = 250;
+    int    maxStepS         = 60;
+    long   trimAfterS       = 86400;
+    int    maxTrim          = 50;
+    unsigned long seed      = 1;
+
+    for (int a = 1; a < argc; a++) {
+        const char* value = a + 1 < argc ? argv[a + 1] : NULL;
+        if (value == NULL) {
+            printUsage();
+            return 1;
+        }
+        if (strcmp(argv[a], "--stations") == 0) {
+            stations = atoi(value);
+        } else if (strcmp(argv[a], "--days") == 0) {
+            days = atoi(value);
+        } else if (strcmp(argv[a], "--drifts") == 0) {
+            driftCount = readList(value, drifts);
+        } else if (strcmp(argv[a], "--jitters") == 0) {
+            jitterCount = readList(value, jitters);
+        } else if (strcmp(argv[a], "--latency") == 0) {
+            latency = atof(value);
+        } else if (strcmp(argv[a], "--asymmetry") == 0) {
+            asymmetry = atof(value);
+        } else if (strcmp(argv[a], "--loss") == 0) {
+            loss = atof(value);
+        } else if (strcmp(argv[a], "--wander") == 0) {
+            wander = atof(value);
+        } else if (strcmp(argv[a], "--offset") == 0) {
+            maxOffset = atof(value);
+        } else if (strcmp(argv[a], "--step") == 0) {
+            stepMs = atoi(value);
+        } else if (strcmp(argv[a], "--max-step") == 0) {
+            maxStepS = atoi(value);
+        } else if (strcmp(argv[a], "--trim-after") == 0) {
+            trimAfterS = atol(value);
+        } else if (strcmp(argv[a], "--max-trim") == 0) {
+            maxTrim = atoi(value);
+        } else if (strcmp(argv[a], "--seed") == 0) {
+            seed = strtoul(value, NULL, 10);
+        } else {
+            printUsage();
+            return 1;
+        }
+        a++;
+    }
+    if (stations < 1 || stations > maxStations || days < 2 ||
+        driftCount == 0 || jitterCount == 0 || loss < 0 || loss >= 1 ||
+        stepMs < 1 || stepMs > 65535 || maxStepS < 0 || maxStepS > 65535 ||
+        trimAfterS < 0 || maxTrim < 0 || maxTrim > 127) {
+        printUsage();
+        return 1;
+    }
+
+    int     cycles = days * static_cast<int>(86400 / cycleS);
+    double* errors = static_cast<double*>(malloc(sizeof(double) * stations * cycles));
+    if (errors == NULL) {
+        fprintf(stderr, "Not enough memory\n");
+        return 1;
+    }
+
+    printf("%d stations, %d days, clocks up to %g s off, %g ppm daily wander, %g ms latency "
+           "(%g ms more on the way out), %.0f%% lost\n\n",
+           stations, days, maxOffset, wander, latency, asymmetry, 100 * loss);
+    printf("drift(ppm) jitter(ms)  off avg(ms)  off 95%%(ms)  off max(ms)  steps/day  "
+           "drift at end(ppm)  off without syncing(s)\n");
+
+    for (int d = 0; d < driftCount; d++) {
+        for (int j = 0; j < jitterCount; j++) {
+            rngState = seed * 2654435761UL + 1;
+            Results r;
+            r.errors = errors;
+            simulate(stations, cycles, drifts[d], jitters[j], latency, asymmetry, loss, wander,
+                     maxOffset, static_cast<uint16_t>(stepMs), static_cast<uint16_t>(maxStepS),
+                     static_cast<uint32_t>(trimAfterS), static_cast<uint8_t>(maxTrim), &r);
+            double total = 0;
+            for (uint32_t e = 0; e < r.count; e++) total += r.errors[e];
+            qsort(r.errors, r.count, sizeof(double), compareDoubles);
+            printf("%10g %10g %12.1f %12.1f %12.1f %10.2f %18.2f %23.1f\n",
+                   drifts[d], jitters[j], total / r.count, r.errors[r.count * 95 / 100],
+                   r.errors[r.count - 1], static_cast<double>(r.steps) / stations / days,
+                   r.residualTotal / stations, r.freeTotal / stations);
+        }
+    }
+    free(errors);
+    return 0;
+}
@@ -0,0 +1,421 @@
+/*
+This is a stand-in for the Arduino core, so parts of the libraries in arduino_libraries can be built and
+tested on your computer by the programs in the utilities folder. It only has what those programs need.
+
+Time doesn't pass on its own: millis() returns hostMillis, which the test programs move along, and delay()
+and delayMicroseconds() move it along by the delay. micros() counts the microseconds past hostMillis too.
+Anything printed to Serial goes to the screen only if hostSerialEcho is set. hostStringsMade counts every
+String made, copies included, so a test can check that something makes none.
+*/
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t*>(address))
+
+
+// The time, in milliseconds and the microseconds past the last millisecond
+inline uint32_t hostMillis     = 0;
+inline uint16_t hostMicrosPast = 0;
+
+inline uint32_t millis(void) {
+    return hostMillis;
+}
+inline uint32_t micros(void) {
+    return hostMillis * 1000UL + hostMicrosPast;
+}
+inline void delay(uint32_t ms) {
+    hostMillis += ms;
+}
+inline void delayMicroseconds(uint32_t us) {
+    us += hostMicrosPast;
+    hostMillis += us / 1000;
+    hostMicrosPast = us % 1000;
+}
+inline void yield(void) {}
+inline void noInterrupts(void) {}
+inline void interrupts(void) {}
+
+
+// The core has these as macros, which would clash with the standard library here
+template <typename A, typename B>
+inline auto min(A a, B b) {
+    return b < a ? b : a;
+}
+template <typename A, typename B>
+inline auto max(A a, B b) {
+    return a < b ? b : a;
+}
+// The core's abs() macro gives back an unsigned number as it is
+inline uint32_t abs(uint32_t value) {
+    return value;
+}
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitValue) ((bitValue) ? bitSet(value, bit) : bitClear(value, bit))
+
+
+// The pins, which remember what they were set to, eight to a port as on the Mayfly
+inline uint8_t hostPinMode[256];
+inline uint8_t hostPortLevel[32];
+
+#define digitalPinToBitMask(pin) (1 << ((pin) % 8))
+#define digitalPinToPort(pin) ((pin) / 8)
+#define portInputRegister(port) (&hostPortLevel[port])
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+    hostPinMode[pin] = mode;
+}
+inline void digitalWrite(uint8_t pin, uint8_t level) {
+    bitWrite(hostPortLevel[pin / 8], pin % 8, level);
+}
+inline int digitalRead(uint8_t pin) {
+    return bitRead(hostPortLevel[pin / 8], pin % 8);
+}
+
+
+// The number conversions from avr-libc
+inline char* itoa(int value, char* out, int base) {
+    if (base == 16) {
+        snprintf(out, 12, "%x", static_cast<unsigned>(value));
+    } else {
+        snprintf(out, 12, "%d", value);
+    }
+    return out;
+}
+inline char* ltoa(long value, char* out, int base) {
+    if (base == 16) {
+        snprintf(out, 24, "%lx", static_cast<unsigned long>(value));
+    } else {
+        snprintf(out, 24, "%ld", value);
+    }
+    return out;
+}
+inline char* ultoa(unsigned long value, char* out, int base) {
+    snprintf(out, 24, base == 16 ? "%lx" : "%lu", value);
+    return out;
+}
+inline char* dtostrf(double value, signed char width, unsigned char precision, char* out) {
+    sprintf(out, "%*.*f", width, precision, value);
+    return out;
+}
+
+
+// Text kept in flash on the Mayfly is just text here
+class __FlashStringHelper;
+#define F(text) (reinterpret_cast<const __FlashStringHelper*>(text))
+
+
+inline long hostStringsMade = 0;
+
+class String {
+ public:
+    String(const char* text = "") : _text(text != nullptr ? text : "") {
+        hostStringsMade++;
+    }
+    String(const __FlashStringHelper* text) : _text(reinterpret_cast<const char*>(text)) {
+        hostStringsMade++;
+    }
+    String(const String& other) : _text(other._text) {
+        hostStringsMade++;
+    }
+    String(String&& other) : _text(std::move(other._text)) {
+        hostStringsMade++;
+    }
+    String& operator=(const String& other) = default;
+    String& operator=(String&& other)      = default;
+    explicit String(char c) : _text(1, c) {
+        hostStringsMade++;
+    }
+    explicit String(int value, unsigned char base = DEC) {
+        char text[24];
+        _text = itoa(value, text, base);
+        hostStringsMade++;
+    }
+    explicit String(unsigned int value, unsigned char base = DEC) {
+        char text[24];
+        _text = ultoa(value, text, base);
+        hostStringsMade++;
+    }
+    explicit String(long value, unsigned char base = DEC) {
+        char text[24];
+        _text = ltoa(value, text, base);
+        hostStringsMade++;
+    }
+    explicit String(unsigned long value, unsigned char base = DEC) {
+        char text[24];
+        _text = ultoa(value, text, base);
+        hostStringsMade++;
+    }
+    // The Arduino core writes floats out this way too
+    explicit String(double value, unsigned char decimals = 2) {
+        char text[64];
+        _text = dtostrf(value, decimals + 2, decimals, text);
+        hostStringsMade++;
+    }
+
+    unsigned int length(void) const {
+        return _text.length();
+    }
+    const char* c_str(void) const {
+        return _text.c_str();
+    }
+    char charAt(unsigned int i) const {
+        return i < _text.length() ? _text[i] : 0;
+    }
+    char operator[](unsigned int i) const {
+        return charAt(i);
+    }
+    void toCharArray(char* out, unsigned int size, unsigned int start = 0) const {
+        if (size == 0) return;
+        unsigned int n = start < _text.length() ? _text.length() - start : 0;
+        if (n > size - 1) n = size - 1;
+        memcpy(out, _text.c_str() + start, n);
+        out[n] = '\0';
+    }
+    String substring(unsigned int from, unsigned int to = 0xFFFF) const {
+        if (from > _text.length()) return String();
+        if (to > _text.length()) to = _text.length();
+        return String(_text.substr(from, to > from ? to - from : 0).c_str());
+    }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t at = _text.find(c, from);
+        return at == std::string::npos ? -1 : static_cast<int>(at);
+    }
+    int indexOf(const String& text, unsigned int from = 0) const {
+        size_t at = _text.find(text._text, from);
+        return at == std::string::npos ? -1 : static_cast<int>(at);
+    }
+    void replace(const String& from, const String& to) {
+        if (from._text.empty()) return;
+        size_t at = 0;
+        while ((at = _text.find(from._text, at)) != std::string::npos) {
+            _text.replace(at, from._text.length(), to._text);
+            at += to._text.length();
+        }
+    }
+    String& operator=(char c) {
+        _text.assign(1, c);
+        return *this;
+    }
+
+    long toInt(void) const {
+        return atol(_text.c_str());
+    }
+    float toFloat(void) const {
+        return atof(_text.c_str());
+    }
+    bool equals(const String& other) const {
+        return _text == other._text;
+    }
+    bool operator==(const String& other) const {
+        return _text == other._text;
+    }
+    bool operator!=(const String& other) const {
+        return _text != other._text;
+    }
+
+    String& operator+=(const String& other) {
+        _text += other._text;
+        return *this;
+    }
+    String& operator+=(const char* text) {
+        _text += text;
+        return *this;
+    }
+    String& operator+=(char c) {
+        _text += c;
+        return *this;
+    }
+    String& operator+=(int value) {
+        return *this += String(value);
+    }
+    String& operator+=(unsigned int value) {
+        return *this += String(value);
+    }
+    String& operator+=(long value) {
+        return *this += String(value);
+    }
+    String& operator+=(unsigned long value) {
+        return *this += String(value);
+    }
+    String& operator+=(double value) {
+        return *this += String(value);
+    }
+    String& operator+=(const __FlashStringHelper* text) {
+        return *this += reinterpret_cast<const char*>(text);
+    }
+    template <typename T>
+    String& concat(T value) {
+        return *this += value;
+    }
+
+    template <typename T>
+    friend String operator+(const String& left, T right) {
+        String sum(left);
+        sum += right;
+        return sum;
+    }
+    friend String operator+(const char* left, const String& right) {
+        String sum(left);
+        sum += right;
+        return sum;
+    }
+    friend String operator+(char left, const String& right) {
+        String sum(left);
+        sum += right;
+        return sum;
+    }
+
+ private:
+    std::string _text;
+};
+
+
+class Print {
+ public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t length) {
+        size_t n = 0;
+        while (length-- > 0) n += write(*data++);
+        return n;
+    }
+    size_t write(const char* data, size_t length) {
+        return write(reinterpret_cast<const uint8_t*>(data), length);
+    }
+    size_t write(const char* text) {
+        return text == nullptr ? 0 : write(text, strlen(text));
+    }
+    virtual void flush(void) {}
+
+    int getWriteError(void) {
+        return _writeError;
+    }
+    void clearWriteError(void) {
+        _writeError = 0;
+    }
+
+    size_t print(const char* text) {
+        return write(text);
+    }
+    size_t print(const __FlashStringHelper* text) {
+        return write(reinterpret_cast<const char*>(text));
+    }
+    size_t print(const String& text) {
+        return write(text.c_str(), text.length());
+    }
+    size_t print(char c) {
+        return write(static_cast<uint8_t>(c));
+    }
+    size_t print(int value, int base = DEC) {
+        return print(String(value, base));
+    }
+    size_t print(unsigned int value, int base = DEC) {
+        return print(String(value, base));
+    }
+    size_t print(long value, int base = DEC) {
+        return print(String(value, base));
+    }
+    size_t print(unsigned long value, int base = DEC) {
+        return print(String(value, base));
+    }
+    size_t print(unsigned char value, int base = DEC) {
+        return print(String(static_cast<unsigned int>(value), base));
+    }
+    size_t print(double value, int decimals = 2) {
+        return print(String(value, decimals));
+    }
+    size_t println(void) {
+        return write("\r\n");
+    }
+    template <typename T>
+    size_t println(T value) {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(T value, int format) {
+        size_t n = print(value, format);
+        return n + println();
+    }
+
+ protected:
+    void setWriteError(int error = 1) {
+        _writeError = error;
+    }
+
+ private:
+    int _writeError = 0;
+};
+
+
+class Stream : public Print {
+ public:
+    virtual int available(void) = 0;
+    virtual int read(void)      = 0;
+    virtual int peek(void)      = 0;
+    void        setTimeout(uint32_t timeout) {
+        _timeout = timeout;
+    }
+
+ protected:
+    uint32_t _timeout = 1000;
+};
+
+
+// The serial port, which only prints to the screen if asked to
+inline bool hostSerialEcho = false;
+
+class HostSerial : public Stream {
+ public:
+    void begin(uint32_t) {}
+    size_t write(uint8_t c) override {
+        if (hostSerialEcho) putchar(c);
+        return 1;
+    }
+    using Print::write;
+    int available(void) override {
+        return 0;
+    }
+    int read(void) override {
+        return -1;
+    }
+    int peek(void) override {
+        return -1;
+    }
+    operator bool(void) const {
+        return true;
+    }
+};
+inline HostSerial Serial;
+
+#define STANDARD_SERIAL_OUTPUT Serial
+
+#endif  // HOST_ARDUINO_H_
@@ -0,0 +1,46 @@
+/*
+This is a stand-in for the Arduino core's Client, the interface the libraries send and receive over the
+internet with. The test programs make their own servers out of it.
+*/
+
+#ifndef HOST_CLIENT_H_
+#define HOST_CLIENT_H_
+
+#include "Arduino.h"
+
+
+class IPAddress {
+ public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) {
+        _bytes[0] = a;
+        _bytes[1] = b;
+        _bytes[2] = c;
+        _bytes[3] = d;
+    }
+    uint8_t operator[](int i) const {
+        return _bytes[i];
+    }
+
+ private:
+    uint8_t _bytes[4];
+};
+
+
+class Client : public Stream {
+ public:
+    virtual int    connect(IPAddress ip, uint16_t port)    = 0;
+    virtual int    connect(const char* host, uint16_t port) = 0;
+    virtual size_t write(uint8_t c)                         = 0;
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+    using Print::write;
+    virtual int     available(void)                    = 0;
+    virtual int     read(void)                         = 0;
+    virtual int     read(uint8_t* data, size_t length) = 0;
+    virtual int     peek(void)                         = 0;
+    virtual void    flush(void)                        = 0;
+    virtual void    stop(void)                         = 0;
+    virtual uint8_t connected(void)                    = 0;
+    virtual operator bool(void)                        = 0;
+};
+
+#endif  // HOST_CLIENT_H_
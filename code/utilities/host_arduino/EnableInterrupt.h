@@ -0,0 +1,25 @@
+/*
+This is a stand-in for the EnableInterrupt library. Nothing interrupts on your computer, so the test
+programs only see which pins have a function attached.
+*/
+
+#ifndef HOST_ENABLE_INTERRUPT_H_
+#define HOST_ENABLE_INTERRUPT_H_
+
+#include "Arduino.h"
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+inline void (*hostInterrupts[256])(void);
+
+inline void enableInterrupt(uint8_t pin, void (*userFunction)(void), uint8_t mode) {
+    (void)mode;
+    hostInterrupts[pin] = userFunction;
+}
+inline void disableInterrupt(uint8_t pin) {
+    hostInterrupts[pin] = nullptr;
+}
+
+#endif  // HOST_ENABLE_INTERRUPT_H_
@@ -0,0 +1,84 @@
+/*
+This is a stand-in DS3231 real time clock chip, for test programs that build the real Sodaq_DS3231 library
+and what uses it. Attach it to the Wire stand-in at address 0x68. It keeps the time the library last set,
+or setEpoch() here, and counts on from it with hostMillis.
+*/
+
+#ifndef HOST_DS3231_H_
+#define HOST_DS3231_H_
+
+#include <time.h>
+
+#include "Wire.h"
+
+
+class HostDS3231 : public HostI2CDevice {
+ public:
+    static const uint8_t address = 0x68;
+
+    // Seconds since 1970
+    void setEpoch(uint32_t epoch) {
+        _epoch = epoch;
+        _setAt = hostMillis;
+    }
+    uint32_t getEpoch(void) {
+        return _epoch + (hostMillis - _setAt) / 1000;
+    }
+
+    bool received(const uint8_t* data, uint8_t length) override {
+        if (length == 0) return true;
+        _pointer = data[0];
+        if (length == 1) return true;
+        // Writes to the time registers set the time
+        readTime();
+        for (uint8_t i = 1; i < length; i++) _registers[_pointer++ % registerCount] = data[i];
+        if (data[0] < 7) writeTime();
+        return true;
+    }
+    bool requested(uint8_t* data, uint8_t length) override {
+        readTime();
+        for (uint8_t i = 0; i < length; i++) data[i] = _registers[_pointer++ % registerCount];
+        return true;
+    }
+
+ private:
+    static const uint8_t registerCount = 0x13;
+
+    static uint8_t toBCD(int n) {
+        return static_cast<uint8_t>((n / 10) * 16 + n % 10);
+    }
+    static int fromBCD(uint8_t n) {
+        return (n >> 4) * 10 + (n & 0x0F);
+    }
+
+    // Puts the time into registers 0 to 6
+    void readTime(void) {
+        time_t    seconds = getEpoch();
+        struct tm when;
+        gmtime_r(&seconds, &when);
+        _registers[0] = toBCD(when.tm_sec);
+        _registers[1] = toBCD(when.tm_min);
+        _registers[2] = toBCD(when.tm_hour);
+        _registers[3] = static_cast<uint8_t>(when.tm_wday + 1);
+        _registers[4] = toBCD(when.tm_mday);
+        _registers[5] = toBCD(when.tm_mon + 1);
+        _registers[6] = toBCD(when.tm_year - 100);
+    }
+    void writeTime(void) {
+        struct tm when = {};
+        when.tm_sec    = fromBCD(_registers[0]);
+        when.tm_min    = fromBCD(_registers[1]);
+        when.tm_hour   = fromBCD(_registers[2] & 0x3F);
+        when.tm_mday   = fromBCD(_registers[4]);
+        when.tm_mon    = fromBCD(_registers[5] & 0x1F) - 1;
+        when.tm_year   = fromBCD(_registers[6]) + 100;
+        setEpoch(static_cast<uint32_t>(timegm(&when)));
+    }
+
+    uint32_t _epoch   = 946684800;
+    uint32_t _setAt   = 0;
+    uint8_t  _pointer = 0;
+    uint8_t  _registers[registerCount] = {};
+};
+
+#endif  // HOST_DS3231_H_
@@ -0,0 +1,93 @@
+/*
+This is a stand-in for the ModularSensors Logger, for test programs that build the data publishers on your
+computer. The real Logger needs the SD card, the clock and the sleep modes, so this one only keeps a list of
+variables whose UUIDs, values and resolutions the test sets, and the publishers registered with it.
+
+Build with "-include HostLogger.h", so this comes first and the real LoggerBase.h is skipped when the
+publishers include it.
+*/
+
+#ifndef HOST_LOGGER_H_
+#define HOST_LOGGER_H_
+
+// Stands in for LoggerBase.h
+#define SRC_LOGGERBASE_H_
+
+#include <time.h>
+
+#include "Arduino.h"
+#include "VariableBase.h"
+
+#define MAX_NUMBER_SENDERS 4
+
+class dataPublisher;
+
+
+class Logger {
+ public:
+    static const uint8_t maxVariables = 200;
+
+    // The variables, which the test fills in
+    uint8_t     varCount        = 0;
+    const char* uuids[maxVariables];
+    float       values[maxVariables];
+    uint8_t     resolutions[maxVariables];
+    uint16_t    loggingInterval = 5;  // minutes
+
+    dataPublisher* dataPublishers[MAX_NUMBER_SENDERS] = {};
+
+    static inline uint32_t markedLocalEpochTime = 0;
+    static inline int8_t   timeZone             = -7;
+
+    uint16_t getLoggingInterval(void) {
+        return loggingInterval;
+    }
+    uint8_t getArrayVarCount(void) {
+        return varCount;
+    }
+    const char* getVarUUIDCharAtI(uint8_t i) {
+        return uuids[i];
+    }
+    float getValueAtI(uint8_t i) {
+        return values[i];
+    }
+    uint8_t getVarResolutionAtI(uint8_t i) {
+        return resolutions[i];
+    }
+    const char* getValueCharAtI(uint8_t i) {
+        getValueLengthAtI(i);
+        return _text;
+    }
+    uint8_t getValueLengthAtI(uint8_t i) {
+        return Variable::formatValue(values[i], resolutions[i], _text);
+    }
+
+    void registerDataPublisher(dataPublisher* publisher) {
+        for (uint8_t i = 0; i < MAX_NUMBER_SENDERS; i++) {
+            if (dataPublishers[i] == nullptr || dataPublishers[i] == publisher) {
+                dataPublishers[i] = publisher;
+                return;
+            }
+        }
+    }
+
+    // Like the real one, "2025-01-01T00:00:00-07:00" in the logger's time zone
+    static String formatDateTime_ISO8601(uint32_t epochTime) {
+        time_t    seconds = epochTime;
+        struct tm when;
+        gmtime_r(&seconds, &when);
+        char text[40];
+        strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &when);
+        if (timeZone == 0) {
+            strcat(text, "Z");
+        } else {
+            snprintf(text + strlen(text), 8, "%c%02d:00", timeZone < 0 ? '-' : '+', abs(timeZone));
+        }
+        return String(text);
+    }
+
+ private:
+    char _text[MS_VALUE_TEXT_SIZE];
+};
+
+#endif  // HOST_LOGGER_H_
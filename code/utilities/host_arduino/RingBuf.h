@@ -0,0 +1,70 @@
+/*
+This is a stand-in for SdFat's RingBuf, for test programs that build what uses it on your computer. As
+in the real one, a write that doesn't fit copies nothing and sets the write error.
+*/
+
+#ifndef HOST_RINGBUF_H_
+#define HOST_RINGBUF_H_
+
+#include "Arduino.h"
+
+
+template <class F, size_t Size>
+class RingBuf : public Print {
+ public:
+    RingBuf() {
+        begin(nullptr);
+    }
+    void begin(F* file) {
+        _file  = file;
+        _count = _head = _tail = 0;
+        clearWriteError();
+    }
+    size_t bytesFree(void) const {
+        return Size - _count;
+    }
+    size_t bytesUsed(void) const {
+        return _count;
+    }
+
+    size_t write(const uint8_t* data, size_t length) override {
+        if (bytesFree() < length) {
+            setWriteError();
+            return 0;
+        }
+        for (size_t i = 0; i < length; i++) {
+            _buffer[_head] = data[i];
+            _head          = (_head + 1) % Size;
+        }
+        _count += length;
+        return length;
+    }
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    using Print::write;
+
+    // Writes the oldest bytes to the file, in at most two pieces
+    size_t writeOut(size_t count) {
+        if (count > _count) count = _count;
+        size_t n       = Size - _tail < count ? Size - _tail : count;
+        size_t written = _file->write(_buffer + _tail, n);
+        if (written == n && n < count) written += _file->write(_buffer, count - n);
+        _tail = (_tail + written) % Size;
+        _count -= written;
+        return written;
+    }
+    bool sync(void) {
+        size_t n = _count;
+        return n == 0 || writeOut(n) == n;
+    }
+
+ private:
+    uint8_t _buffer[Size];
+    F*      _file;
+    size_t  _count;
+    size_t  _head;
+    size_t  _tail;
+};
+
+#endif  // HOST_RINGBUF_H_
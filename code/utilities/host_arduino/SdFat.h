@@ -0,0 +1,429 @@
+/*
+This is a stand-in for the SdFat library: an SD card kept in memory, so the test programs can see what the
+libraries write to it, count the sector writes, and cut the power part way through.
+
+The card is 512 byte sectors in 32 KB clusters. Sectors never written read as whatever was on the card
+before, which here is old records made up from the sector number. As SdFat does on the Mayfly, the volume
+caches one sector: writes of less than a whole sector go to the cache, and the cache is written to the
+card when another sector is needed or the file is synced. Whole sectors are written straight to the card.
+A file's directory entry, with its size, only reaches the card when the file is synced, closed, truncated
+or stamped. The FAT is written as soon as clusters are added to a file or freed.
+
+Setting hostSdCard.writesUntilCut cuts the power after that many more sector writes. The next one is
+torn after tornBytes bytes, and nothing more reaches the card. Whatever was cached is lost. Call
+restorePower() and start over with a new SdFat and File, as the logger does when it restarts.
+*/
+
+#ifndef HOST_SDFAT_H_
+#define HOST_SDFAT_H_
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+#define O_RDONLY 0X00
+#define O_WRONLY 0X01
+#define O_RDWR 0X02
+#define O_AT_END 0X04
+#define O_APPEND 0X08
+#define O_CREAT 0x10
+#define O_TRUNC 0x20
+#define O_EXCL 0x40
+#define O_READ O_RDONLY
+#define O_WRITE O_WRONLY
+
+const uint8_t T_ACCESS = 1;
+const uint8_t T_CREATE = 2;
+const uint8_t T_WRITE  = 4;
+
+#define SD_SCK_MHZ(maxMhz) (1000000UL * (maxMhz))
+#define SPI_FULL_SPEED SD_SCK_MHZ(50)
+
+
+class HostSdCard {
+ public:
+    static const uint16_t sectorSize        = 512;
+    static const uint16_t sectorsPerCluster = 64;
+    static const uint32_t clusterSize       = 32768UL;
+    // The sectors before the first cluster hold the FATs and the root directory
+    static const uint32_t firstDataSector = 16384;
+
+    // What the test can change
+    bool     present        = true;
+    bool     canErase       = true;
+    uint8_t  erasedValue    = 0xFF;
+    long     writesUntilCut = -1;
+    uint16_t tornBytes      = 0;
+
+    bool powerCut = false;
+
+    // The sector writes to each part of the card, and the erase commands
+    uint32_t dataWrites      = 0;
+    uint32_t fatWrites       = 0;
+    uint32_t directoryWrites = 0;
+    uint32_t erases          = 0;
+
+    uint32_t sectorWrites(void) const {
+        return dataWrites + fatWrites + directoryWrites;
+    }
+
+    // What the directory and the FAT on the card say about a file
+    struct Entry {
+        std::vector<uint32_t> clusters;
+        uint32_t              size = 0;
+    };
+    std::map<std::string, Entry> directory;
+
+    void restorePower(void) {
+        powerCut       = false;
+        writesUntilCut = -1;
+        unmount();
+    }
+    // Forgets the cache, as starting SdFat again does
+    void unmount(void) {
+        _cacheSector = noSector;
+        _cacheDirty  = false;
+    }
+
+    // The file as it is on the card, not counting anything still cached
+    std::string fileText(const char* name) {
+        auto entry = directory.find(name);
+        if (entry == directory.end()) return "";
+        std::string text;
+        uint8_t     data[sectorSize];
+        for (uint32_t at = 0; at < entry->second.size; at += sectorSize) {
+            uint32_t cluster = at / clusterSize;
+            if (cluster >= entry->second.clusters.size()) break;
+            readSector(clusterSector(entry->second.clusters[cluster]) + at / sectorSize % sectorsPerCluster,
+                       data);
+            uint32_t n = entry->second.size - at < sectorSize ? entry->second.size - at : sectorSize;
+            text.append(reinterpret_cast<char*>(data), n);
+        }
+        return text;
+    }
+
+    // Used by SdFat.card(), as on a real card
+    bool erase(uint32_t firstSector, uint32_t lastSector) {
+        if (!canErase || powerCut) return false;
+        erases++;
+        for (uint32_t s = firstSector; s <= lastSector; s++) _sectors[s].fill(erasedValue);
+        return true;
+    }
+
+    // The rest is for the File stand-in
+    uint32_t clusterSector(uint32_t cluster) const {
+        return firstDataSector + cluster * sectorsPerCluster;
+    }
+
+    void readSector(uint32_t sector, uint8_t* data) {
+        auto found = _sectors.find(sector);
+        if (found != _sectors.end()) {
+            memcpy(data, found->second.data(), sectorSize);
+            return;
+        }
+        // Old records, never erased
+        char line[48];
+        uint16_t n = 0;
+        for (uint32_t i = 0; n < sectorSize; i++) {
+            int length = snprintf(line, sizeof(line), "2019-%02lu-%02lu 0%lu:00:00,%lu.%lu,-9999\n",
+                                  (unsigned long)(sector % 12 + 1), (unsigned long)(i % 28 + 1),
+                                  (unsigned long)(i % 10), (unsigned long)(sector % 997),
+                                  (unsigned long)(i % 10));
+            for (int c = 0; c < length && n < sectorSize; c++) data[n++] = line[c];
+        }
+    }
+    bool writeSector(uint32_t sector, const uint8_t* data) {
+        if (!spendWrite()) {
+            if (_tearing) memcpy(_sectors[sector].data(), data, tornBytes);
+            _tearing = false;
+            return false;
+        }
+        dataWrites++;
+        memcpy(_sectors[sector].data(), data, sectorSize);
+        return true;
+    }
+
+    // The volume's one-sector cache
+    uint8_t* cacheFor(uint32_t sector, bool readIt) {
+        if (_cacheSector == sector) return _cache;
+        if (!flushCache()) return nullptr;
+        if (readIt) {
+            readSector(sector, _cache);
+        } else {
+            memset(_cache, 0, sectorSize);
+        }
+        _cacheSector = sector;
+        return _cache;
+    }
+    void markCacheDirty(void) {
+        _cacheDirty = true;
+    }
+    void dropCachedSector(uint32_t sector) {
+        if (_cacheSector == sector) unmount();
+    }
+    bool flushCache(void) {
+        if (!_cacheDirty) return true;
+        if (!writeSector(_cacheSector, _cache)) return false;
+        _cacheDirty = false;
+        return true;
+    }
+
+    bool writeDirectory(Entry& entry, uint32_t size) {
+        if (!spendWrite()) return false;
+        directoryWrites++;
+        entry.size = size;
+        return true;
+    }
+
+    // Adds clusters to a file, in one piece if asked; each FAT sector changed is written to both FATs
+    bool allocate(Entry& entry, uint32_t count, bool contiguous) {
+        std::vector<uint32_t> added;
+        for (uint32_t c = 0; added.size() < count; c++) {
+            if (c >= _clusterUsed.size()) _clusterUsed.resize(c + count + 64);
+            if (!_clusterUsed[c]) {
+                added.push_back(c);
+            } else if (contiguous) {
+                added.clear();
+            }
+        }
+        std::vector<uint32_t> changed = added;
+        if (!entry.clusters.empty()) changed.push_back(entry.clusters.back());
+        if (!writeFat(changed)) return false;
+        for (uint32_t c : added) {
+            _clusterUsed[c] = true;
+            entry.clusters.push_back(c);
+        }
+        return true;
+    }
+    bool freeClusters(Entry& entry, uint32_t keep) {
+        if (keep >= entry.clusters.size()) return true;
+        // The cluster kept last gets the end of the chain
+        std::vector<uint32_t> changed(entry.clusters.begin() + (keep > 0 ? keep - 1 : 0),
+                                      entry.clusters.end());
+        if (!writeFat(changed)) return false;
+        for (uint32_t i = keep; i < entry.clusters.size(); i++) _clusterUsed[entry.clusters[i]] = false;
+        entry.clusters.resize(keep);
+        return true;
+    }
+
+ private:
+    static const uint32_t noSector = 0xFFFFFFFF;
+
+    // Whether the power lasts for another sector write
+    bool spendWrite(void) {
+        if (powerCut) return false;
+        if (writesUntilCut == 0) {
+            powerCut = true;
+            _tearing = true;
+            return false;
+        }
+        if (writesUntilCut > 0) writesUntilCut--;
+        return true;
+    }
+    bool writeFat(const std::vector<uint32_t>& clusters) {
+        std::vector<uint32_t> fatSectors;
+        for (uint32_t c : clusters) {
+            bool seen = false;
+            for (uint32_t s : fatSectors) seen |= s == c / 128;
+            if (!seen) fatSectors.push_back(c / 128);
+        }
+        for (size_t i = 0; i < 2 * fatSectors.size(); i++) {
+            if (!spendWrite()) {
+                _tearing = false;
+                return false;
+            }
+            fatWrites++;
+        }
+        return true;
+    }
+
+    std::map<uint32_t, std::array<uint8_t, sectorSize>> _sectors;
+    std::vector<bool>                                    _clusterUsed;
+    uint32_t _cacheSector = noSector;
+    bool     _cacheDirty  = false;
+    bool     _tearing     = false;
+    uint8_t  _cache[sectorSize];
+};
+inline HostSdCard hostSdCard;
+
+
+// Like SdFat's, a copy of a File has its own position and size, but they share the card's cache
+class File : public Stream {
+ public:
+    bool open(const char* name, uint8_t flags) {
+        if (_entry != nullptr || hostSdCard.powerCut) return false;
+        auto found = hostSdCard.directory.find(name);
+        if (found == hostSdCard.directory.end()) {
+            if (!(flags & O_CREAT)) return false;
+            // The new directory entry is written at once
+            HostSdCard::Entry created;
+            if (!hostSdCard.writeDirectory(created, 0)) return false;
+            found = hostSdCard.directory.emplace(name, created).first;
+        } else if ((flags & O_CREAT) && (flags & O_EXCL)) {
+            return false;
+        }
+        _entry    = &found->second;
+        _writable = (flags & (O_WRONLY | O_RDWR)) != 0;
+        _size     = _entry->size;
+        _position = (flags & O_AT_END) ? _size : 0;
+        _dirDirty = false;
+        return true;
+    }
+    bool isOpen(void) const {
+        return _entry != nullptr;
+    }
+    explicit operator bool(void) const {
+        return isOpen();
+    }
+    bool close(void) {
+        bool ok = sync();
+        _entry  = nullptr;
+        return ok;
+    }
+
+    bool sync(void) {
+        if (_entry == nullptr || !hostSdCard.flushCache()) return false;
+        if (_dirDirty) {
+            if (!hostSdCard.writeDirectory(*_entry, _size)) return false;
+            _dirDirty = false;
+        }
+        return true;
+    }
+    bool timestamp(uint8_t flags, uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute,
+                   uint8_t second) {
+        (void)flags, (void)year, (void)month, (void)day, (void)hour, (void)minute, (void)second;
+        return sync() && hostSdCard.writeDirectory(*_entry, _size);
+    }
+
+    uint32_t fileSize(void) const {
+        return _size;
+    }
+    uint32_t curPosition(void) const {
+        return _position;
+    }
+    bool seekSet(uint32_t position) {
+        if (_entry == nullptr || position > _size) return false;
+        _position = position;
+        return true;
+    }
+    bool seekEnd(int32_t offset = 0) {
+        return seekSet(_size + offset);
+    }
+
+    // Only into an empty file, in one piece
+    bool preAllocate(uint32_t length) {
+        if (_entry == nullptr || length == 0 || !_writable || !_entry->clusters.empty()) return false;
+        uint32_t need = 1 + (length - 1) / HostSdCard::clusterSize;
+        if (!hostSdCard.allocate(*_entry, need, true)) return false;
+        _size     = length;
+        _dirDirty = true;
+        return sync();
+    }
+    bool contiguousRange(uint32_t* firstSector, uint32_t* lastSector) {
+        if (_entry == nullptr || _entry->clusters.empty()) return false;
+        for (size_t i = 1; i < _entry->clusters.size(); i++) {
+            if (_entry->clusters[i] != _entry->clusters[i - 1] + 1) return false;
+        }
+        *firstSector = hostSdCard.clusterSector(_entry->clusters.front());
+        *lastSector  = hostSdCard.clusterSector(_entry->clusters.back()) + HostSdCard::sectorsPerCluster - 1;
+        return true;
+    }
+    // Cuts the file off at the current position
+    bool truncate(void) {
+        if (_entry == nullptr || !_writable) return false;
+        uint32_t keep = (_position + HostSdCard::clusterSize - 1) / HostSdCard::clusterSize;
+        if (!hostSdCard.freeClusters(*_entry, keep)) return false;
+        _size     = _position;
+        _dirDirty = true;
+        return sync();
+    }
+    bool truncate(uint32_t length) {
+        return seekSet(length) && truncate();
+    }
+
+    size_t write(const uint8_t* data, size_t length) override {
+        if (_entry == nullptr || !_writable) return 0;
+        size_t done = 0;
+        while (done < length) {
+            uint32_t offset = _position % HostSdCard::sectorSize;
+            uint32_t n      = HostSdCard::sectorSize - offset;
+            if (n > length - done) n = length - done;
+            uint32_t sector;
+            if (!sectorAt(_position, &sector)) break;
+            if (n == HostSdCard::sectorSize) {
+                hostSdCard.dropCachedSector(sector);
+                if (!hostSdCard.writeSector(sector, data + done)) break;
+            } else {
+                // Past the end of the file, there's nothing there to keep
+                uint8_t* cached = hostSdCard.cacheFor(sector, offset != 0 || _position < _size);
+                if (cached == nullptr) break;
+                memcpy(cached + offset, data + done, n);
+                hostSdCard.markCacheDirty();
+            }
+            done += n;
+            _position += n;
+            if (_position > _size) {
+                _size     = _position;
+                _dirDirty = true;
+            }
+        }
+        if (done < length) setWriteError();
+        return done;
+    }
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    using Print::write;
+
+    int read(void) override {
+        int c = peek();
+        if (c >= 0) _position++;
+        return c;
+    }
+    int peek(void) override {
+        if (_entry == nullptr || _position >= _size) return -1;
+        uint32_t sector;
+        if (!sectorAt(_position, &sector, false)) return -1;
+        uint8_t* cached = hostSdCard.cacheFor(sector, true);
+        return cached == nullptr ? -1 : cached[_position % HostSdCard::sectorSize];
+    }
+    int available(void) override {
+        return _entry == nullptr ? 0 : static_cast<int>(_size - _position);
+    }
+
+ private:
+    // The sector holding a byte of the file, adding a cluster if the file needs another
+    bool sectorAt(uint32_t position, uint32_t* sector, bool grow = true) {
+        uint32_t cluster = position / HostSdCard::clusterSize;
+        if (cluster >= _entry->clusters.size()) {
+            if (!grow || !hostSdCard.allocate(*_entry, 1, false)) return false;
+        }
+        *sector = hostSdCard.clusterSector(_entry->clusters[cluster]) +
+            position / HostSdCard::sectorSize % HostSdCard::sectorsPerCluster;
+        return true;
+    }
+
+    HostSdCard::Entry* _entry    = nullptr;
+    bool               _writable = false;
+    bool               _dirDirty = false;
+    uint32_t           _size     = 0;
+    uint32_t           _position = 0;
+};
+
+
+class SdFat {
+ public:
+    bool begin(uint8_t csPin, uint32_t maxSck) {
+        (void)csPin, (void)maxSck;
+        hostSdCard.unmount();
+        return hostSdCard.present && !hostSdCard.powerCut;
+    }
+    HostSdCard* card(void) {
+        return &hostSdCard;
+    }
+};
+
+#endif  // HOST_SDFAT_H_
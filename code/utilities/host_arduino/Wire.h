@@ -0,0 +1,101 @@
+/*
+This is a stand-in for the Arduino Wire library. The test programs attach their own chips to it at their
+I2C addresses; nothing answers at an address with no chip attached. Each transaction takes as long as it
+would at the bus's clock speed, and the bus counts them.
+*/
+
+#ifndef HOST_WIRE_H_
+#define HOST_WIRE_H_
+
+#include "Arduino.h"
+
+
+class HostI2CDevice {
+ public:
+    virtual ~HostI2CDevice() {}
+    // The bytes of one transmission to the chip; false if the chip doesn't acknowledge them
+    virtual bool received(const uint8_t* data, uint8_t length) = 0;
+    // Fills in the bytes read from the chip; false if the chip doesn't acknowledge
+    virtual bool requested(uint8_t* data, uint8_t length) = 0;
+};
+
+
+class TwoWire : public Stream {
+ public:
+    static const uint8_t bufferSize = 32;
+
+    HostI2CDevice* devices[128] = {};
+    uint32_t       transactions = 0;
+    uint32_t       clock_Hz     = 100000;
+
+    void begin(void) {}
+    void end(void) {}
+    void setClock(uint32_t frequency) {
+        clock_Hz = frequency;
+    }
+
+    void beginTransmission(uint8_t address) {
+        _address = address & 0x7F;
+        _length  = 0;
+    }
+    size_t write(uint8_t c) override {
+        if (_length >= bufferSize) return 0;
+        _buffer[_length++] = c;
+        return 1;
+    }
+    using Print::write;
+    // As in the real one, so a literal 0 isn't taken for a pointer
+    size_t write(int n) {
+        return write(static_cast<uint8_t>(n));
+    }
+    size_t write(unsigned int n) {
+        return write(static_cast<uint8_t>(n));
+    }
+    // 0 when the chip took everything, 2 when nothing answered at the address and 3 when the chip
+    // didn't take the data, as the real one does
+    uint8_t endTransmission(bool stop = true) {
+        (void)stop;
+        transactions++;
+        busTime(2 + 9 * (1 + _length));
+        if (devices[_address] == nullptr) return 2;
+        return devices[_address]->received(_buffer, _length) ? 0 : 3;
+    }
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool stop = true) {
+        (void)stop;
+        address &= 0x7F;
+        _length = _position = 0;
+        if (quantity > bufferSize) quantity = bufferSize;
+        // The chip hands over its register once its address has gone out
+        transactions++;
+        busTime(1 + 9);
+        bool answered = devices[address] != nullptr && devices[address]->requested(_buffer, quantity);
+        busTime(1 + (answered ? 9 * quantity : 0));
+        if (!answered) return 0;
+        _length = quantity;
+        return quantity;
+    }
+    int available(void) override {
+        return _length - _position;
+    }
+    int read(void) override {
+        return _position < _length ? _buffer[_position++] : -1;
+    }
+    int peek(void) override {
+        return _position < _length ? _buffer[_position] : -1;
+    }
+
+ private:
+    // Each byte is 9 bits with its acknowledge; a start and a stop come to about 2 more
+    void busTime(uint32_t bits) {
+        delayMicroseconds(bits * 1000000UL / clock_Hz);
+    }
+
+    uint8_t _address  = 0;
+    uint8_t _buffer[bufferSize];
+    uint8_t _length   = 0;
+    uint8_t _position = 0;
+};
+
+inline TwoWire Wire;
+
+#endif  // HOST_WIRE_H_
@@ -0,0 +1,5 @@
+/*
+A stand-in for avr-libc's pgmspace.h. The Arduino.h stand-in already has what's used of it.
+*/
+
+#include "Arduino.h"
@@ -0,0 +1,3 @@
+/*
+This is a stand-in for the Arduino core's pin definitions, which the test programs don't need.
+*/
@@ -0,0 +1,422 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the HttpResponseReader in the
+ModularSensors library, which reads an HTTP/1.1 response off a Client as it arrives and returns as soon as
+all of it is in, against a stand-in server that sends its responses a few bytes at a time.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -std=c++17 -O2 -I ../host_arduino -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -o http_reader_test http_reader_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/HttpResponseReader.cpp
+
+and run it:
+
+  http_reader_test [--trials 20000] [--seed 1]
+
+Each trial sends up to four responses on one connection, as a server keeping it alive would, sometimes
+all at once before the first is read. Each response has a random status, sometimes after interim 1xx
+responses, from an HTTP/1.1 or HTTP/1.0 server that may say it will close the connection. Its headers
+come in any case, some longer than the reader keeps. Its body has a Content-Length, comes in chunks with
+extensions and trailers, runs until the server closes the connection, or isn't there for a 204 or 304.
+The bytes arrive in pieces with pauses between them, and now and then the server stalls past the deadline
+or closes the connection part way through.
+
+For each response, read() has to give the status code, or 504 if the final status line didn't come, and
+return within one 10 ms poll of the last byte, or of the connection closing, or at the deadline. It must
+not read any of the next response. The body kept has to be the start of the body, with the chunks put
+back together, and keepAlive() has to say whether another request can go on the connection. The same
+bytes handed one at a time to parse() have to finish on the last one.
+
+Then it prints how long the modem waited for each response, against the fixed 10 second wait this
+replaced.
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "HttpResponseReader.h"
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+
+static long problems = 0;
+
+static void problem(const char* what, long trial, int response) {
+    if (problems++ < 10) printf("PROBLEM: %s (trial %ld, response %d)\n", what, trial, response);
+}
+
+
+static const uint32_t never = 0xFFFFFFFF;
+
+/*
+A stand-in server, reached through the Client the reader is handed. Every byte it sends arrives at its own
+time, and it may close the connection at a set time.
+*/
+class StandInServer : public Client {
+ public:
+    std::string           sent;
+    std::vector<uint32_t> arrives;
+    size_t                readTo   = 0;
+    uint32_t              closesAt = never;
+
+    // Sends text a piece at a time, starting at firstMs from now, and returns when the last byte arrives.
+    // With stallAt under the text's length, the bytes from there on come a minute late.
+    uint32_t send(const std::string& text, uint32_t firstMs, size_t stallAt) {
+        uint32_t at = millis() + firstMs;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (i > 0 && randomNumber(20) == 0) at += randomNumber(200);
+            if (i == stallAt) at += 60000;
+            sent += text[i];
+            arrives.push_back(at);
+        }
+        return at;
+    }
+
+    int connect(IPAddress, uint16_t) override {
+        return 1;
+    }
+    int connect(const char*, uint16_t) override {
+        return 1;
+    }
+    size_t write(uint8_t) override {
+        return 1;
+    }
+    size_t write(const uint8_t*, size_t length) override {
+        return length;
+    }
+    int available(void) override {
+        size_t n = readTo;
+        while (n < sent.size() && arrives[n] <= millis()) n++;
+        return n - readTo;
+    }
+    int read(void) override {
+        if (available() == 0) return -1;
+        return static_cast<uint8_t>(sent[readTo++]);
+    }
+    int read(uint8_t* data, size_t length) override {
+        size_t n = 0;
+        while (n < length && available() > 0) data[n++] = read();
+        return n;
+    }
+    int peek(void) override {
+        return available() > 0 ? static_cast<uint8_t>(sent[readTo]) : -1;
+    }
+    void flush(void) override {}
+    void stop(void) override {
+        closesAt = millis();
+    }
+    uint8_t connected(void) override {
+        return millis() < closesAt;
+    }
+    operator bool(void) override {
+        return connected();
+    }
+};
+
+
+// A response, and what the reader should make of it
+struct Response {
+    std::string text;
+    int16_t     status;
+    size_t      statusEnd;  // The length of the text up to the end of the final status line
+    int32_t     contentLength;
+    std::string body;
+    bool        untilClose;  // Whether the body runs until the server closes the connection
+    bool        keepAlive;
+};
+
+// A header's name in any case
+static std::string headerName(const char* name) {
+    std::string text = name;
+    switch (randomNumber(3)) {
+        case 0:
+            for (char& c : text) c = tolower(c);
+            break;
+        case 1:
+            for (char& c : text) c = toupper(c);
+            break;
+        default: break;
+    }
+    return text;
+}
+
+static std::string randomBody(void) {
+    size_t      length = randomNumber(6) == 0 ? randomNumber(3000) : randomNumber(200);
+    std::string body;
+    for (size_t i = 0; i < length; i++) {
+        // Mostly printable, with some line breaks
+        if (randomNumber(30) == 0) {
+            body += randomNumber(2) ? '\n' : '\r';
+        } else {
+            body += static_cast<char>(32 + randomNumber(95));
+        }
+    }
+    return body;
+}
+
+static Response makeResponse(bool mayRunUntilClose) {
+    static const int16_t statuses[] = {200, 201, 202, 204, 304, 400, 401, 404, 500, 503};
+    std::string          eol        = randomNumber(10) == 0 ? "\n" : "\r\n";
+    Response             r;
+
+    // Interim responses first, now and then
+    int interims = randomNumber(5) == 0 ? 1 + randomNumber(2) : 0;
+    for (int i = 0; i < interims; i++) {
+        if (randomNumber(2)) {
+            r.text += "HTTP/1.1 100 Continue" + eol + eol;
+        } else {
+            r.text += "HTTP/1.1 103 Early Hints" + eol + headerName("Link") + ": </style.css>; rel=preload" +
+                eol + eol;
+        }
+    }
+
+    bool http11 = randomNumber(5) != 0;
+    r.status    = statuses[randomNumber(10)];
+    r.text += http11 ? "HTTP/1.1 " : "HTTP/1.0 ";
+    r.text += std::to_string(r.status);
+    if (randomNumber(4) != 0) r.text += r.status < 300 ? " OK" : " Something Went Wrong";
+    r.text += eol;
+    r.statusEnd = r.text.size();
+
+    // Headers the reader doesn't look at, some too long for it to keep
+    if (randomNumber(2)) r.text += headerName("Date") + ": Wed, 01 Jan 2025 12:00:00 GMT" + eol;
+    if (randomNumber(2)) r.text += headerName("Server") + ": nginx/1.24.0 (Ubuntu)" + eol;
+    if (randomNumber(2)) {
+        r.text += headerName("Set-Cookie") + ": session=0123456789abcdef0123456789abcdef; Path=/; HttpOnly" +
+            eol;
+    }
+
+    // Whether the server says it will close the connection or keep it open
+    bool close = false, keepAliveHeader = false;
+    switch (randomNumber(4)) {
+        case 0:
+            r.text += headerName("Connection") + ": " + (randomNumber(2) ? "close" : "Close") + eol;
+            close = true;
+            break;
+        case 1:
+            r.text += headerName("Connection") + ": " + (randomNumber(2) ? "keep-alive" : "Keep-Alive") + eol;
+            keepAliveHeader = true;
+            break;
+        default: break;
+    }
+
+    r.contentLength = -1;
+    r.untilClose    = false;
+    std::string body;
+    if (r.status == 204 || r.status == 304) {
+        // No body, though a 304 may give the length of what didn't change
+        if (r.status == 304 && randomNumber(2)) {
+            r.contentLength = 1 + randomNumber(5000);
+            r.text += headerName("Content-Length") + ": " + std::to_string(r.contentLength) + eol;
+        }
+        r.text += eol;
+    } else {
+        body     = randomBody();
+        int kind = randomNumber(mayRunUntilClose ? 3 : 2);
+        if (kind == 0) {
+            r.contentLength = body.size();
+            r.text += headerName("Content-Length") + ":" + (randomNumber(2) ? " " : "  ") +
+                std::to_string(r.contentLength) + eol + eol + body;
+        } else if (kind == 1) {
+            const char* coding = randomNumber(4) ? "chunked" : "gzip, chunked";
+            r.text += headerName("Transfer-Encoding") + ": " + coding + eol + eol;
+            for (size_t at = 0; at < body.size();) {
+                size_t size = 1 + randomNumber(body.size() - at < 700 ? body.size() - at : 700);
+                char   hex[16];
+                snprintf(hex, sizeof(hex), randomNumber(2) ? "%zx" : "%zX", size);
+                r.text += hex;
+                if (randomNumber(5) == 0) r.text += ";name=value";
+                r.text += eol + body.substr(at, size) + eol;
+                at += size;
+            }
+            r.text += "0" + eol;
+            if (randomNumber(4) == 0) r.text += headerName("X-Checksum") + ": 0123abcd" + eol;
+            r.text += eol;
+        } else {
+            // Neither a length nor chunks
+            r.text += eol + body;
+            r.untilClose = true;
+        }
+    }
+    r.body      = body;
+    r.keepAlive = !r.untilClose && !close && (http11 || keepAliveHeader);
+    return r;
+}
+
+
+// The poll the reader takes a byte in on: it looks at start and every 10 ms after while nothing is there
+static uint32_t pollAt(uint32_t start, uint32_t time) {
+    if (time <= start) return start;
+    return start + (time - start + 9) / 10 * 10;
+}
+
+static long   responsesRead = 0;
+static double waitedMs      = 0;
+
+static void runTrial(long trial) {
+    static const uint32_t timeouts[] = {2000, 5000, 10000};
+    uint32_t              timeout    = timeouts[randomNumber(3)];
+    int                   count      = 1 + randomNumber(4);
+    bool                  pipelined  = randomNumber(3) == 0;
+    StandInServer         server;
+    std::vector<Response> responses;
+    for (int r = 0; r < count; r++) responses.push_back(makeResponse(r == count - 1));
+
+    // Where each response starts and ends in what the server sent, and when its last byte arrives
+    std::vector<size_t>   starts(count), ends(count);
+    std::vector<uint32_t> lastArrives(count);
+    for (int r = 0; r < count; r++) {
+        const Response& response = responses[r];
+
+        // The same bytes, handed over one at a time
+        HttpResponseReader parser;
+        char               kept[64];
+        parser.begin(kept, sizeof(kept));
+        for (size_t i = 0; i < response.text.size(); i++) {
+            if (parser.parse(response.text[i]) != (i + 1 == response.text.size() && !response.untilClose)) {
+                problem("parse() didn't finish on the last byte", trial, r);
+                break;
+            }
+        }
+        if (parser.getStatusCode() != response.status) problem("parse() got the wrong status", trial, r);
+        if (response.body.compare(0, sizeof(kept) - 1, kept) != 0) {
+            problem("parse() kept the wrong body", trial, r);
+        }
+
+        // The request goes out as the last response is read; the answer takes a while
+        uint32_t start = millis();
+        bool     sending = r == 0 || !pipelined;
+        size_t   stall   = sending && randomNumber(10) == 0 ? randomNumber(response.text.size()) : never;
+        uint32_t first   = randomNumber(8) == 0 ? randomNumber(timeout + 2000) : 100 + randomNumber(1500);
+        if (sending) {
+            for (int q = r; q < (pipelined ? count : r + 1); q++) {
+                starts[q]      = server.sent.size();
+                lastArrives[q] = server.send(responses[q].text, first, q == r ? stall : never);
+                ends[q]        = server.sent.size();
+                if (!pipelined) break;
+            }
+        }
+
+        // The last response, or one the server cuts off, ends with the connection. Cutting off a body that
+        // runs until the connection closes only makes it shorter.
+        bool cutOff = r == count - 1 && randomNumber(8) == 0 && !response.untilClose;
+        if (r == count - 1 && (response.untilClose || cutOff || !response.keepAlive)) {
+            if (cutOff) {
+                size_t keep = starts[r] + randomNumber(response.text.size());
+                server.sent.resize(keep);
+                server.arrives.resize(keep);
+                lastArrives[r] = keep > 0 ? server.arrives[keep - 1] : start;
+            }
+            server.closesAt = (lastArrives[r] > start ? lastArrives[r] : start) + randomNumber(500);
+        }
+
+        char     body[40];
+        uint16_t bodySize = randomNumber(4) == 0 ? 0 : sizeof(body);
+        HttpResponseReader reader;
+        reader.begin(bodySize > 0 ? body : nullptr, bodySize);
+        int16_t  status   = reader.read(&server, timeout);
+        uint32_t returned = millis();
+        responsesRead++;
+        waitedMs += returned - start;
+
+        // When the reader should have returned, and whether with the whole response
+        bool     stalled  = stall != never || (cutOff && server.sent.size() < ends[r]);
+        uint32_t deadline = start + timeout;
+        uint32_t done     = pollAt(start, lastArrives[r]);
+        if (response.untilClose || stalled) {
+            uint32_t closes = server.closesAt > lastArrives[r] ? server.closesAt : lastArrives[r];
+            done            = server.closesAt == never ? never : pollAt(start, closes);
+        }
+        // Too close to the deadline to say which comes first
+        if (done != never && done + 10 >= deadline && done <= deadline + 10) break;
+
+        bool complete = done < deadline && !stalled;
+        if (reader.isComplete() != complete) {
+            if (problems < 10) {
+                printf("  %s, should%s be; returned after %lu ms, the deadline %lu ms\n",
+                       reader.isComplete() ? "complete" : "incomplete", complete ? "" : "n't",
+                       static_cast<unsigned long>(returned - start), static_cast<unsigned long>(timeout));
+            }
+            problem("the response was read wrong", trial, r);
+            break;
+        }
+        uint32_t expectedReturn = done < deadline ? done : deadline;
+        if (returned != expectedReturn) {
+            if (problems < 10) {
+                printf("  returned after %lu ms, should have after %lu ms\n",
+                       static_cast<unsigned long>(returned - start),
+                       static_cast<unsigned long>(expectedReturn - start));
+            }
+            problem("the reader didn't return as soon as it should", trial, r);
+        }
+
+        // The status, if the final status line came in time
+        // The last poll before a deadline is 10 ms before it
+        uint32_t lastPoll       = returned >= deadline ? deadline - 10 : returned;
+        size_t   statusAt       = starts[r] + response.statusEnd - 1;
+        bool     statusCame     = statusAt < server.sent.size() && server.arrives[statusAt] <= lastPoll;
+        int16_t  expectedStatus = statusCame ? response.status : 504;
+        if (status != expectedStatus) {
+            if (problems < 10) printf("  status %d, should be %d\n", status, expectedStatus);
+            problem("read() gave the wrong status", trial, r);
+        }
+        if (!complete) break;
+
+        if (server.readTo != ends[r]) problem("the reader didn't stop at the end of the response", trial, r);
+        if (reader.getContentLength() != response.contentLength) {
+            problem("the Content-Length is wrong", trial, r);
+        }
+        if (bodySize > 0) {
+            std::string expected = response.body.substr(0, bodySize - 1);
+            if (reader.getBodyLength() != expected.size() || expected != body) {
+                problem("the body kept is wrong", trial, r);
+            }
+        }
+        if (reader.keepAlive() != response.keepAlive) problem("keepAlive() is wrong", trial, r);
+        if (!reader.keepAlive()) break;
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    long trials = 20000;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--trials") == 0 && hasValue) {
+            trials = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: http_reader_test [--trials 20000] [--seed 1]\n");
+            return 1;
+        }
+    }
+
+    for (long trial = 1; trial <= trials; trial++) runTrial(trial);
+
+    printf("%ld trials, %ld responses read\n", trials, responsesRead);
+    printf("The modem waited %.0f ms for each response on average, against 10000 ms before\n",
+           waitedMs / responsesRead);
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("Every response was read to its end and no further, and returned as soon as it was in\n");
+    return 0;
+}
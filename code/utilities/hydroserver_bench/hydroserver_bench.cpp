@@ -0,0 +1,508 @@
+/*
+This program runs on your computer, not on the Mayfly. It compares how the HydroServerPublisher in the
+ModularSensors library builds a request now, writing it through the length-tracking send buffer from
+values formatted once, with how it used to, finding the end of the send buffer with strlen() before every
+piece and turning each value into a String once for the Content-Length and again for the body.
+
+Build it with any C++ compiler from this folder (the host_arduino folder stands in for the Arduino core
+and the Logger):
+
+  g++ -std=c++17 -O2 -I ../host_arduino -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -DMS_HYDROSERVER_MAX_BODY_SIZE=8000 -include HostLogger.h -o hydroserver_bench hydroserver_bench.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/publishers/HydroServer.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/dataPublisherBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/HttpResponseReader.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/SensorBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/ResultReducer.cpp
+
+and run it:
+
+  hydroserver_bench [--vars 40] [--requests 2000] [--seed 1]
+
+Each request is one logging interval of --vars variables with different resolutions, sent with a
+sendEveryX of 1. MS_HYDROSERVER_MAX_BODY_SIZE is raised so they all go in one request, as they used to.
+The old way is the publisher's request building from before the send buffer kept its length, copied
+here along with the old String getters it used; the 10 second wait it then made for every answer is
+left out. The new way is the publisher's publishData(), answered at once by a stand-in server, so it
+also includes reading the answer.
+
+Each request is checked against one put together here piece by piece, headers, body, and a
+Content-Length that is the length of that body, which is what HydroServer would check. The new way has
+to get every one exactly right. The old way gets some of them wrong: it checked for one byte too little
+room before some of the pieces it added, so a piece that came right at the end of the send buffer lost
+its last character. It prints how many the old way got right, which are byte for byte what the new way
+sent, and shows where one went wrong.
+
+For each way it prints the time a request takes to build on this computer, the Strings made (with the
+String in ../host_arduino), the writes to the client and the bytes sent, and for the old way the bytes
+strlen() read over again. The times are only a guide to the Mayfly's, which are far longer, but the
+counts are the same there.
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#include "publishers/HydroServer.h"
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static double randomUnit(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (rngState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+static int problems = 0;
+
+static void problem(const char* what, const char* detail) {
+    if (problems++ < 10) printf("PROBLEM: %s (%s)\n", what, detail);
+}
+
+
+static const char*    authorization = "dXNlcjpwYXNzd29yZA==";
+static const uint32_t startEpoch    = 1735689600UL;  // 2025-01-01 00:00 in the logger's time zone
+
+static Logger logger;
+static char   uuidText[Logger::maxVariables][40];
+
+
+/*
+A stand-in for HydroServer that keeps everything written to it, and answers each request as soon as all
+of it is in.
+*/
+class RecordingServer : public Client {
+ public:
+    std::string sent;
+    long        writes = 0;
+
+    int connect(IPAddress, uint16_t) override {
+        return 0;
+    }
+    int connect(const char*, uint16_t) override {
+        _open       = true;
+        _answerRead = 0;
+        _answered   = false;
+        return 1;
+    }
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    size_t write(const uint8_t* data, size_t length) override {
+        if (!_open) return 0;
+        sent.append(reinterpret_cast<const char*>(data), length);
+        writes++;
+        size_t headerEnd = sent.find("\r\n\r\n");
+        size_t lengthAt  = sent.find("\r\nContent-Length: ");
+        if (headerEnd != std::string::npos && lengthAt != std::string::npos &&
+            sent.size() >= headerEnd + 4 + atol(sent.c_str() + lengthAt + 18)) {
+            _answered = true;
+        }
+        return length;
+    }
+    int available(void) override {
+        return _open && _answered ? static_cast<int>(strlen(_answer)) - _answerRead : 0;
+    }
+    int read(void) override {
+        if (available() == 0) return -1;
+        return static_cast<uint8_t>(_answer[_answerRead++]);
+    }
+    int read(uint8_t* data, size_t length) override {
+        size_t n = 0;
+        while (n < length && available() > 0) data[n++] = read();
+        return n;
+    }
+    int peek(void) override {
+        return available() > 0 ? static_cast<uint8_t>(_answer[_answerRead]) : -1;
+    }
+    void flush(void) override {}
+    void stop(void) override {
+        _open = false;
+    }
+    uint8_t connected(void) override {
+        return _open;
+    }
+    operator bool(void) override {
+        return _open;
+    }
+
+ private:
+    const char* _answer = "HTTP/1.1 201 Created\r\nContent-Type: application/json\r\n"
+                          "Content-Length: 6\r\n\r\n[\"ok\"]";
+    bool        _open       = false;
+    bool        _answered   = false;
+    int         _answerRead = 0;
+};
+
+
+// The bytes the old way read over again to find the end of the send buffer
+static long rescanned = 0;
+
+
+// The String getters the old way used, as the Logger and Variable had them
+static String getVarUUIDAtI(uint8_t i) {
+    return String(logger.uuids[i]);
+}
+
+static String getValueStringAtI(uint8_t i) {
+    if (logger.resolutions[i] == 0) return String(static_cast<int16_t>(logger.values[i]));
+    return String(logger.values[i], logger.resolutions[i]);
+}
+
+
+/*
+The HydroServerPublisher's request as it used to be built, with strlen() counted. It only builds and
+sends the request; the old publishData() went on to wait 10 seconds for the answer.
+*/
+class OldHydroServer : public HydroServerPublisher {
+ public:
+    void sendRequest(Client* outClient);
+
+ private:
+    static size_t countedStrlen(const char* text);
+    static int    oldBufferFree(void);
+    static void   oldPrintTxBuffer(Stream* stream, bool addNewLine = false);
+    uint16_t      oldCalculateJsonSize(void);
+};
+
+// The old way could put a character in the last byte of the send buffer, leaving no '\0' for strlen() to
+// stop at. On the Mayfly it went on reading whatever came after; here it stops at the end of the buffer.
+size_t OldHydroServer::countedStrlen(const char* text) {
+    size_t length = text == txBuffer ? strnlen(text, MS_SEND_BUFFER_SIZE) : strlen(text);
+    rescanned += length + 1;
+    return length;
+}
+
+int OldHydroServer::oldBufferFree(void) {
+    return MS_SEND_BUFFER_SIZE - countedStrlen(txBuffer);
+}
+
+void OldHydroServer::oldPrintTxBuffer(Stream* stream, bool addNewLine) {
+    STANDARD_SERIAL_OUTPUT.write(txBuffer, countedStrlen(txBuffer));
+    if (addNewLine) { PRINTOUT('\n'); }
+    STANDARD_SERIAL_OUTPUT.flush();
+    stream->write(txBuffer, countedStrlen(txBuffer));
+    if (addNewLine) { stream->print("\r\n"); }
+    stream->flush();
+    for (int i = 0; i < MS_SEND_BUFFER_SIZE; i++) { txBuffer[i] = '\0'; }
+}
+
+uint16_t OldHydroServer::oldCalculateJsonSize(void) {
+    uint16_t jsonLength = 1;   // [
+    for (uint8_t i = 0; i < logger.getArrayVarCount(); i++) {
+        jsonLength += 15;          // {"Datastream":{
+        jsonLength += 10;          // "@iot.id":
+        jsonLength += 1;           // "
+        jsonLength += 36;          // *Datastream ID*
+        jsonLength += 3;           // "},
+        jsonLength += 41;          // "components":["phenomenonTime","result"],
+        jsonLength += 13;          // "dataArray":[
+        jsonLength += 29;          // ["*phenomenonTime*",
+        jsonLength += getValueStringAtI(i).length(); // *result*
+        if (i == logger.getArrayVarCount() - 1) {
+            jsonLength += 3;       // ]]}
+        }
+        else {
+            jsonLength += 4;       // ]]},
+        }
+    }
+    jsonLength += 1;               // ]
+
+    return jsonLength;
+}
+
+#define strlen countedStrlen
+#define bufferFree oldBufferFree
+#define printTxBuffer oldPrintTxBuffer
+void OldHydroServer::sendRequest(Client* outClient) {
+    char     tempBuffer[37] = "";
+    char     jsonSizeBuffer[5] = "";
+
+    // The old send buffer was always left all '\0' after being sent, and this
+    // relies on it
+    for (int i = 0; i < MS_SEND_BUFFER_SIZE; i++) { txBuffer[i] = '\0'; }
+
+    if (outClient->connect(hydroServerHost, hydroServerPort)) {
+        // copy the initial post header into the tx buffer
+        snprintf(txBuffer, sizeof(txBuffer), "%s", postHeader);
+        snprintf(txBuffer + strlen(txBuffer),
+                sizeof(txBuffer) - strlen(txBuffer), "%s", postEndpoint);
+        snprintf(txBuffer + strlen(txBuffer),
+                sizeof(txBuffer) - strlen(txBuffer), "%s", HTTPtag);
+
+        // add the rest of the HTTP POST headers to the outgoing buffer
+        // before adding each line/chunk to the outgoing buffer, we make sure
+        // there is space for that line, sending out buffer if not
+        if (bufferFree() < 37) printTxBuffer(outClient);
+        snprintf(txBuffer + strlen(txBuffer),
+                 sizeof(txBuffer) - strlen(txBuffer), "%s", hostHeader);
+        snprintf(txBuffer + strlen(txBuffer),
+                 sizeof(txBuffer) - strlen(txBuffer), "%s", hydroServerHost);
+
+        if (bufferFree() < 47) printTxBuffer(outClient);
+        snprintf(txBuffer + strlen(txBuffer),
+                 sizeof(txBuffer) - strlen(txBuffer), "%s", acceptHeader);
+
+        if (bufferFree() < 26) printTxBuffer(outClient);
+        snprintf(txBuffer + strlen(txBuffer),
+                 sizeof(txBuffer) - strlen(txBuffer), "%s", authorizationHeader);
+        snprintf(txBuffer + strlen(txBuffer),
+                 sizeof(txBuffer) - strlen(txBuffer), "%s", authorization);
+
+        if (bufferFree() < 25) printTxBuffer(outClient);
+        snprintf(txBuffer + strlen(txBuffer),
+                 sizeof(txBuffer) - strlen(txBuffer), "%s", contentLengthHeader);
+
+        if (bufferFree() < 5) printTxBuffer(outClient);
+        itoa(oldCalculateJsonSize(), jsonSizeBuffer, 10);
+        snprintf(txBuffer + strlen(txBuffer),
+                 sizeof(txBuffer) - strlen(txBuffer), "%s", jsonSizeBuffer);
+
+        if (bufferFree() < 42) printTxBuffer(outClient);
+        snprintf(txBuffer + strlen(txBuffer),
+                 sizeof(txBuffer) - strlen(txBuffer), "%s", contentTypeHeader);
+
+        // put the start of the JSON into the outgoing response_buffer
+        if (bufferFree() < 1) printTxBuffer(outClient);
+        txBuffer[strlen(txBuffer)] = '[';
+        for (uint8_t y = 0; y < logger.getArrayVarCount(); y++) {
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '{';
+
+            if (bufferFree() < 13) printTxBuffer(outClient);
+            snprintf(txBuffer + strlen(txBuffer),
+                    sizeof(txBuffer) - strlen(txBuffer), "%s", datastreamTag);
+
+            if (bufferFree() < 10) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '{';
+            snprintf(txBuffer + strlen(txBuffer),
+                sizeof(txBuffer) - strlen(txBuffer), "%s", iotTag);
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '"';
+
+            if (bufferFree() < 37) printTxBuffer(outClient);
+            getVarUUIDAtI(y).toCharArray(tempBuffer, 37);
+            snprintf(txBuffer + strlen(txBuffer),
+                sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '"';
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '}';
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = ',';
+
+            if (bufferFree() < 42) printTxBuffer(outClient);
+            snprintf(txBuffer + strlen(txBuffer),
+                sizeof(txBuffer) - strlen(txBuffer), "%s", componentsTag);
+
+            if (bufferFree() < 12) printTxBuffer(outClient);
+            snprintf(txBuffer + strlen(txBuffer),
+                sizeof(txBuffer) - strlen(txBuffer), "%s", dataArrayTag);
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '[';
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '[';
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '"';
+
+            if (bufferFree() < 37) printTxBuffer(outClient);
+            Logger::formatDateTime_ISO8601(Logger::markedLocalEpochTime).toCharArray(tempBuffer, 37);
+            snprintf(txBuffer + strlen(txBuffer),
+                sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '"';
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = ',';
+
+            if (bufferFree() < 37) printTxBuffer(outClient);
+            getValueStringAtI(y).toCharArray(tempBuffer, 37);
+            snprintf(txBuffer + strlen(txBuffer),
+                sizeof(txBuffer) - strlen(txBuffer), "%s", tempBuffer);
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = ']';
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = ']';
+
+            if (bufferFree() < 1) printTxBuffer(outClient);
+            txBuffer[strlen(txBuffer)] = '}';
+
+            // If this is not the last variable
+            if (y != logger.getArrayVarCount() - 1) {
+                if (bufferFree() < 1) printTxBuffer(outClient);
+                txBuffer[strlen(txBuffer)] = ',';
+            }
+        }
+
+        if (bufferFree() < 1) printTxBuffer(outClient);
+        txBuffer[strlen(txBuffer)] = ']';
+
+        // Send out the finished request (or the last unsent section of it)
+        printTxBuffer(outClient, true);
+
+        outClient->stop();
+    }
+}
+#undef strlen
+#undef bufferFree
+#undef printTxBuffer
+
+
+// The request both ways should send, put together piece by piece from the Logger's values
+static std::string expectedRequest(void) {
+    std::string timestamp = Logger::formatDateTime_ISO8601(Logger::markedLocalEpochTime).c_str();
+    std::string body      = "[";
+    for (int v = 0; v < logger.varCount; v++) {
+        if (v > 0) body += ",";
+        body += std::string("{\"Datastream\":{\"@iot.id\":\"") + logger.uuids[v] +
+            "\"},\"components\":[\"phenomenonTime\",\"result\"],\"dataArray\":[[\"" + timestamp + "\"," +
+            getValueStringAtI(v).c_str() + "]]}";
+    }
+    body += "]";
+    return std::string("POST /api/sensorthings/v1.1/CreateObservations HTTP/1.1\r\n"
+                       "Host: lro.hydroserver.org\r\nAccept: application/json\r\nAuthorization: Basic ") +
+        authorization + "\r\nContent-Length: " + std::to_string(body.size()) +
+        "\r\nContent-Type: application/json\r\n\r\n" + body;
+}
+
+
+// What was sent around where it first differs from what was expected
+static std::string whereWrong(const std::string& sent, const std::string& expected) {
+    size_t at = 0;
+    while (at < expected.size() && at < sent.size() && expected[at] == sent[at]) at++;
+    at = at > 40 ? at - 40 : 0;
+    return "..." + sent.substr(at, 60) + "...";
+}
+
+
+struct Tally {
+    double seconds = 0;
+    long   strings = 0, writes = 0, bytes = 0;
+};
+
+
+int main(int argc, char* argv[]) {
+    int  varCount = 40;
+    long requests = 2000;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--vars") == 0 && hasValue) {
+            varCount = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--requests") == 0 && hasValue) {
+            requests = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: hydroserver_bench [--vars 40] [--requests 2000] [--seed 1]\n");
+            return 1;
+        }
+    }
+    if (varCount < 1 || varCount > MS_HYDROSERVER_CACHE_SIZE || requests < 1) {
+        printf("The variables have to be from 1 to %d, and the requests at least 1\n",
+               MS_HYDROSERVER_CACHE_SIZE);
+        return 1;
+    }
+
+    // The variables, with different resolutions and UUIDs
+    logger.varCount = varCount;
+    for (int v = 0; v < varCount; v++) {
+        snprintf(uuidText[v], sizeof(uuidText[v]), "%08x-abcd-1234-ef00-1234567890ab",
+                 static_cast<unsigned>(randomUnit() * 0xFFFFFFFFU));
+        logger.uuids[v]       = uuidText[v];
+        logger.resolutions[v] = v % 4;
+    }
+
+    HydroServerPublisher publisher(logger, authorization, 1, 0);
+    OldHydroServer       old;
+    RecordingServer      oldServer, newServer;
+    Tally                oldTally, newTally;
+    long                 rescannedPerRequest = 0, oldRight = 0;
+    std::string          oldGarbled, oldMeant;
+    for (long r = 0; r < requests; r++) {
+        Logger::markedLocalEpochTime = startEpoch + r * logger.loggingInterval * 60UL;
+        for (int v = 0; v < varCount; v++) logger.values[v] = (randomUnit() - 0.3) * 2000;
+
+        oldServer.sent.clear();
+        oldServer.writes = 0;
+        rescanned        = 0;
+        long strings     = hostStringsMade;
+        auto start       = std::chrono::steady_clock::now();
+        old.sendRequest(&oldServer);
+        oldTally.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        oldTally.strings += hostStringsMade - strings;
+        oldTally.writes += oldServer.writes;
+        oldTally.bytes += oldServer.sent.size();
+        rescannedPerRequest = rescanned;
+
+        newServer.sent.clear();
+        newServer.writes = 0;
+        strings          = hostStringsMade;
+        start            = std::chrono::steady_clock::now();
+        int16_t code     = publisher.publishData(&newServer);
+        newTally.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        newTally.strings += hostStringsMade - strings;
+        newTally.writes += newServer.writes;
+        newTally.bytes += newServer.sent.size();
+        if (code != 201) problem("the request didn't go through", "new");
+
+        // The old way ended each request with an extra "\r\n" after the body
+        std::string expected = expectedRequest();
+        if (oldServer.sent == expected + "\r\n") {
+            oldRight++;
+        } else if (oldGarbled.empty()) {
+            oldGarbled = whereWrong(oldServer.sent, expected + "\r\n");
+            oldMeant   = whereWrong(expected + "\r\n", oldServer.sent);
+        }
+        if (newServer.sent != expected) {
+            problem("the new request wasn't the one expected", whereWrong(newServer.sent, expected).c_str());
+        }
+    }
+
+    printf("%d variables, one interval in each of %ld requests\n\n", varCount, requests);
+    printf("         microseconds   Strings   writes to    bytes\n");
+    printf("         per request    made      the client   sent\n");
+    Tally* tallies[2] = {&oldTally, &newTally};
+    for (int t = 0; t < 2; t++) {
+        printf("%-8s %8.2f      %7.1f   %7.1f    %7.1f\n", t == 0 ? "old" : "new",
+               tallies[t]->seconds * 1e6 / requests, double(tallies[t]->strings) / requests,
+               double(tallies[t]->writes) / requests, double(tallies[t]->bytes) / requests);
+    }
+    printf("\nThe old way read %ld bytes over again with strlen() for each request\n", rescannedPerRequest);
+
+    // The old way checked for too little room before some of the pieces it added, and so cut a character
+    // off the ones that came right at the end of the send buffer
+    printf("The old way sent %ld of the %ld requests right\n", oldRight, requests);
+    if (!oldGarbled.empty()) {
+        printf("For example it sent  %s\n", oldGarbled.c_str());
+        printf("where it should have %s\n", oldMeant.c_str());
+    }
+    if (oldRight == 0) problem("the old way never sent a request right", "");
+
+    if (problems > 0) {
+        printf("FAILED: %d problems\n", problems);
+        return 1;
+    }
+    printf("The new way sent every request right: the headers, the body, and its Content-Length\n");
+    return 0;
+}
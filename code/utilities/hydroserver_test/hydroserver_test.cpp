@@ -0,0 +1,467 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the HydroServerPublisher in the
+ModularSensors library against a stand-in for HydroServer's CreateObservations endpoint, and shows how
+many connections and requests gathering several logging intervals into each request saves.
+
+Build it with any C++ compiler from this folder (the host_arduino folder stands in for the Arduino core
+and the Logger):
+
+  g++ -std=c++17 -O2 -I ../host_arduino -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -include HostLogger.h -o hydroserver_test hydroserver_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/publishers/HydroServer.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/dataPublisherBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/HttpResponseReader.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/SensorBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/ResultReducer.cpp
+
+and run it:
+
+  hydroserver_test [--vars 31] [--interval 3] [--days 2] [--seed 1]
+
+The defaults are the lte_hydroserver sketch's: 31 variables logged every 3 minutes. Each interval the
+variables get new values and the publisher is handed them the way the Logger does, sending whenever
+isDueToSend() says so, for sendEveryX of 1 (one row per datastream in each request, as before), 2 and 5.
+The stand-in server takes a couple of seconds to connect to and half a second to answer, like a cell
+connection. It answers some requests with an error, or loses them without an answer, and may close the
+connection after each answer instead of keeping it open.
+
+The server reads every request the way HydroServer would: the request line and headers, a body exactly
+as long as its Content-Length, and the JSON, which has to be exactly the CreateObservations layout. It
+keeps the observations of every request it accepts. Afterwards the program checks that every
+observation got to the server exactly once with the value's text unchanged, including when a request
+failed after earlier ones for the same intervals went through. The only ones allowed to be missing are
+the intervals the publisher had to drop because it had no room left while the server was failing. It
+also checks that no request's body is over MS_HYDROSERVER_MAX_BODY_SIZE unless it holds a single
+datastream.
+
+For each case it prints the modem sessions, requests and connections per day, the kilobytes sent per
+day, the seconds the modem spent connecting and waiting for answers per day, and the intervals dropped.
+It prints each thing that went wrong and exits with an error if anything did.
+
+With the sketch's sendEveryX of 5, its 31 variables fill the 160 values of MS_HYDROSERVER_CACHE_SIZE
+by the time each send is due, so a single failed send drops an interval. Build with
+-DMS_HYDROSERVER_CACHE_SIZE=320 to see what more room would keep.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "publishers/HydroServer.h"
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static double randomUnit(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (rngState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+static int problems = 0;
+
+static void problem(const char* what, const char* detail) {
+    if (problems++ < 10) printf("PROBLEM: %s (%s)\n", what, detail);
+}
+
+
+static const char*    authorization = "dXNlcjpwYXNzd29yZA==";
+static const uint32_t startEpoch    = 1735689600UL;  // 2025-01-01 00:00 in the logger's time zone
+
+// What the stations logged, and what the server got
+static const int maxIntervals = 3000;
+static const int maxVars      = MS_HYDROSERVER_CACHE_SIZE;
+static const int valueSize    = 16;
+
+static Logger  logger;
+static char    uuidText[maxVars][40];
+static char    expected[maxIntervals][maxVars][valueSize];
+static uint8_t received[maxIntervals][maxVars];
+static bool    dropped[maxIntervals];
+static int     intervalCount;
+
+
+/*
+A stand-in for HydroServer, reached through the Client the publisher is handed. Requests are answered
+once they have come in completely, after answerMs.
+*/
+class StandInServer : public Client {
+ public:
+    // How the server behaves
+    double   failChance = 0;     // The chance a request is answered with an error
+    double   loseChance = 0;     // The chance a request is lost, and the connection with it
+    bool     keepAlive  = true;  // Whether the connection is kept open after an answer
+    uint32_t connectMs  = 2000;
+    uint32_t answerMs   = 500;
+
+    // What happened
+    long connects = 0, requests = 0, bytesIn = 0;
+
+    int connect(IPAddress, uint16_t) override {
+        problem("the publisher connected by address", "not by name");
+        return 0;
+    }
+    int connect(const char* host, uint16_t port) override {
+        delay(connectMs);
+        if (strcmp(host, "lro.hydroserver.org") != 0 || port != 80) {
+            problem("the publisher connected to the wrong place", host);
+        }
+        connects++;
+        _open          = true;
+        _requestSize   = 0;
+        _answerSize    = 0;
+        _answerRead    = 0;
+        _closeAnswered = false;
+        return 1;
+    }
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    size_t write(const uint8_t* data, size_t length) override {
+        if (!_open) return 0;
+        if (_requestSize + length >= sizeof(_request)) {
+            problem("a request was far too big", "over 32 kB");
+            _requestSize = 0;
+            return 0;
+        }
+        memcpy(_request + _requestSize, data, length);
+        _requestSize += length;
+        bytesIn += length;
+        takeRequests();
+        return length;
+    }
+    int available(void) override {
+        if (!_open || millis() < _answerAt) return 0;
+        return _answerSize - _answerRead;
+    }
+    int read(void) override {
+        if (available() == 0) return -1;
+        return static_cast<uint8_t>(_answer[_answerRead++]);
+    }
+    int read(uint8_t* data, size_t length) override {
+        size_t n = 0;
+        while (n < length && available() > 0) data[n++] = read();
+        return n;
+    }
+    int peek(void) override {
+        return available() > 0 ? static_cast<uint8_t>(_answer[_answerRead]) : -1;
+    }
+    void flush(void) override {}
+    void stop(void) override {
+        _open = false;
+    }
+    uint8_t connected(void) override {
+        // The server hangs up once a "Connection: close" answer has been read
+        if (_closeAnswered && millis() >= _answerAt && _answerRead == _answerSize) _open = false;
+        return _open;
+    }
+    operator bool(void) override {
+        return _open;
+    }
+
+ private:
+    void takeRequests(void);
+    void answer(int status, const char* reason);
+    bool parseBody(const char* body, int length, int* datastreams);
+
+    bool     _open = false;
+    char     _request[32768];
+    size_t   _requestSize = 0;
+    char     _answer[512];
+    int      _answerSize    = 0;
+    int      _answerRead    = 0;
+    uint32_t _answerAt      = 0;
+    bool     _closeAnswered = false;
+};
+
+
+// Finds a header's value in the request's headers, returning NULL if it isn't there
+static const char* findHeader(const char* headers, const char* name) {
+    const char* at = strstr(headers, name);
+    return at != NULL ? at + strlen(name) : NULL;
+}
+
+
+void StandInServer::takeRequests(void) {
+    while (true) {
+        _request[_requestSize] = '\0';
+        char* end = strstr(_request, "\r\n\r\n");
+        if (end == NULL) return;
+        const char* lengthText = findHeader(_request, "\r\nContent-Length: ");
+        if (lengthText == NULL || lengthText > end) {
+            problem("a request had no Content-Length", "");
+            _requestSize = 0;
+            return;
+        }
+        size_t headerSize = end + 4 - _request;
+        size_t bodySize   = atol(lengthText);
+        if (_requestSize < headerSize + bodySize) return;  // The rest of the body is still coming
+
+        requests++;
+        char* body = _request + headerSize;
+        static const char* requestLine = "POST /api/sensorthings/v1.1/CreateObservations HTTP/1.1\r\n";
+        if (strncmp(_request, requestLine, strlen(requestLine)) != 0) {
+            problem("a request line was wrong", "");
+        }
+        const char* host = findHeader(_request, "\r\nHost: ");
+        if (host == NULL || strncmp(host, "lro.hydroserver.org\r\n", 21) != 0) {
+            problem("a request's Host header was wrong", "");
+        }
+        const char* basic = findHeader(_request, "\r\nAuthorization: Basic ");
+        if (basic == NULL || strncmp(basic, authorization, strlen(authorization)) != 0) {
+            problem("a request's Authorization header was wrong", "");
+        }
+
+        if (randomUnit() < loseChance) {
+            // Lost on the way, along with the connection
+            _open        = false;
+            _requestSize = 0;
+            return;
+        }
+        if (randomUnit() < failChance) {
+            answer(500, "Internal Server Error");
+        } else {
+            // The observations are only kept if the whole request is good
+            int datastreams = 0;
+            if (!parseBody(body, bodySize, &datastreams)) {
+                answer(400, "Bad Request");
+            } else {
+                if (bodySize > MS_HYDROSERVER_MAX_BODY_SIZE && datastreams > 1) {
+                    problem("a request was bigger than MS_HYDROSERVER_MAX_BODY_SIZE", "");
+                }
+                parseBody(body, bodySize, NULL);
+                answer(201, "Created");
+            }
+        }
+
+        // Anything after this request is the start of the next one
+        size_t used = headerSize + bodySize;
+        memmove(_request, _request + used, _requestSize - used);
+        _requestSize -= used;
+    }
+}
+
+
+void StandInServer::answer(int status, const char* reason) {
+    const char* body = status == 201 ? "[\"ok\"]" : "{\"detail\":\"try again\"}";
+    _answerSize = snprintf(_answer, sizeof(_answer),
+                           "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                           "Content-Length: %d\r\n%s\r\n%s",
+                           status, reason, static_cast<int>(strlen(body)),
+                           keepAlive ? "" : "Connection: close\r\n", body);
+    _answerRead    = 0;
+    _answerAt      = millis() + answerMs;
+    _closeAnswered = !keepAlive;
+}
+
+
+// Matches text at the reader, moving past it
+static bool take(const char*& at, const char* end, const char* text) {
+    size_t length = strlen(text);
+    if (static_cast<size_t>(end - at) < length || strncmp(at, text, length) != 0) return false;
+    at += length;
+    return true;
+}
+
+
+/*
+Reads a CreateObservations body, which has to be laid out exactly as
+  [{"Datastream":{"@iot.id":"UUID"},"components":["phenomenonTime","result"],
+    "dataArray":[["time",value],...]},...]
+all on one line.
+If datastreams isn't NULL it only checks the body and counts the datastreams in it; otherwise it keeps
+the observations, checking each against what was logged.
+*/
+bool StandInServer::parseBody(const char* body, int length, int* datastreams) {
+    const char* at  = body;
+    const char* end = body + length;
+    if (!take(at, end, "[")) return false;
+    do {
+        if (!take(at, end, "{\"Datastream\":{\"@iot.id\":\"")) return false;
+        const char* uuidEnd = static_cast<const char*>(memchr(at, '"', end - at));
+        if (uuidEnd == NULL) return false;
+        int var = -1;
+        for (int v = 0; v < logger.varCount; v++) {
+            if (uuidEnd - at == static_cast<int>(strlen(uuidText[v])) &&
+                strncmp(at, uuidText[v], uuidEnd - at) == 0) {
+                var = v;
+            }
+        }
+        if (var < 0) return false;
+        at = uuidEnd;
+        if (!take(at, end, "\"},\"components\":[\"phenomenonTime\",\"result\"],")) return false;
+        if (!take(at, end, "\"dataArray\":[")) return false;
+        do {
+            if (!take(at, end, "[\"")) return false;
+            struct tm when;
+            memset(&when, 0, sizeof(when));
+            int  zone;
+            char timeText[32];
+            const char* timeEnd = static_cast<const char*>(memchr(at, '"', end - at));
+            if (timeEnd == NULL || timeEnd - at >= static_cast<int>(sizeof(timeText))) return false;
+            memcpy(timeText, at, timeEnd - at);
+            timeText[timeEnd - at] = '\0';
+            if (sscanf(timeText, "%d-%d-%dT%d:%d:%d%d:00", &when.tm_year, &when.tm_mon, &when.tm_mday,
+                       &when.tm_hour, &when.tm_min, &when.tm_sec, &zone) != 7 ||
+                zone != Logger::timeZone) {
+                return false;
+            }
+            when.tm_year -= 1900;
+            when.tm_mon -= 1;
+            uint32_t epoch    = timegm(&when);
+            uint32_t seconds  = logger.loggingInterval * 60UL;
+            int      interval = (epoch - startEpoch) / seconds;
+            if (epoch < startEpoch || (epoch - startEpoch) % seconds != 0 || interval >= intervalCount) {
+                return false;
+            }
+            at = timeEnd;
+            if (!take(at, end, "\",")) return false;
+            const char* valueEnd = static_cast<const char*>(memchr(at, ']', end - at));
+            if (valueEnd == NULL || valueEnd == at || valueEnd - at >= valueSize) return false;
+            char  valueText[valueSize];
+            char* numberEnd;
+            memcpy(valueText, at, valueEnd - at);
+            valueText[valueEnd - at] = '\0';
+            strtod(valueText, &numberEnd);
+            if (*numberEnd != '\0') return false;
+            at = valueEnd + 1;
+
+            if (datastreams == NULL) {
+                if (received[interval][var]++ > 0) problem("an observation was posted twice", timeText);
+                if (strcmp(valueText, expected[interval][var]) != 0) {
+                    problem("an observation's value changed on the way", valueText);
+                }
+            }
+        } while (take(at, end, ","));
+        if (!take(at, end, "]}")) return false;
+        if (datastreams != NULL) (*datastreams)++;
+    } while (take(at, end, ","));
+    return take(at, end, "]") && at == end;
+}
+
+
+static void runCase(StandInServer& server, int varCount, uint8_t sendEveryX, int days) {
+    // The variables, with different resolutions and UUIDs
+    logger.varCount = varCount;
+    for (int v = 0; v < varCount; v++) {
+        snprintf(uuidText[v], sizeof(uuidText[v]), "%08x-abcd-1234-ef00-1234567890ab",
+                 static_cast<unsigned>(randomUnit() * 0xFFFFFFFFU));
+        logger.uuids[v]       = uuidText[v];
+        logger.resolutions[v] = v % 4;
+    }
+    memset(received, 0, sizeof(received));
+    memset(dropped, 0, sizeof(dropped));
+    intervalCount = days * 24 * 60 / logger.loggingInterval;
+    if (intervalCount > maxIntervals) intervalCount = maxIntervals;
+
+    HydroServerPublisher publisher(logger, &server, authorization, sendEveryX, 0);
+    server.connects = server.requests = server.bytesIn = 0;
+
+    // The intervals the publisher is holding, oldest first
+    int  held[MS_HYDROSERVER_MAX_ROWS + 1];
+    int  heldCount = 0;
+    long sessions  = 0, droppedCount = 0;
+    long onlineMs  = 0;
+    for (int i = 0; i < intervalCount; i++) {
+        Logger::markedLocalEpochTime = startEpoch + i * logger.loggingInterval * 60UL;
+        for (int v = 0; v < varCount; v++) {
+            logger.values[v] = (randomUnit() - 0.3) * 2000;
+            Variable::formatValue(logger.values[v], logger.resolutions[v], expected[i][v]);
+        }
+
+        // The publisher drops the oldest interval if it has no room for this one
+        if (publisher.cacheRoom() == 0) {
+            dropped[held[0]] = true;
+            droppedCount++;
+            heldCount--;
+            memmove(held, held + 1, heldCount * sizeof(held[0]));
+        }
+        held[heldCount++] = i;
+
+        // As Logger::logDataAndPublish() does it
+        publisher.cacheData();
+        if (publisher.isDueToSend()) {
+            sessions++;
+            uint32_t before = millis();
+            int16_t  code   = publisher.publishData(&server);
+            onlineMs += millis() - before;
+            if (code >= 200 && code <= 299) heldCount = 0;
+        }
+    }
+
+    // Send whatever is left while the server is working
+    double failChance = server.failChance, loseChance = server.loseChance;
+    server.failChance = server.loseChance = 0;
+    if (heldCount > 0) publisher.publishData(&server);
+    server.failChance = failChance;
+    server.loseChance = loseChance;
+
+    for (int i = 0; i < intervalCount; i++) {
+        for (int v = 0; v < varCount; v++) {
+            if (received[i][v] == 0 && !dropped[i]) {
+                problem("an observation never got to the server", expected[i][v]);
+            }
+        }
+    }
+
+    printf("%5d  %4.0f%% %4.0f%%  %-5s  %9.1f %9.1f %9.1f %9.1f %9.1f %8ld\n", sendEveryX,
+           server.failChance * 100, server.loseChance * 100, server.keepAlive ? "yes" : "no",
+           double(sessions) / days, double(server.requests) / days, double(server.connects) / days,
+           server.bytesIn / 1024.0 / days, onlineMs / 1000.0 / days, droppedCount);
+}
+
+
+int main(int argc, char* argv[]) {
+    int varCount           = 31;
+    int days               = 2;
+    logger.loggingInterval = 3;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--vars") == 0 && hasValue) {
+            varCount = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--interval") == 0 && hasValue) {
+            logger.loggingInterval = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--days") == 0 && hasValue) {
+            days = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: hydroserver_test [--vars 31] [--interval 3] [--days 2] [--seed 1]\n");
+            return 1;
+        }
+    }
+    if (varCount < 1 || varCount > maxVars || logger.loggingInterval < 1 || days < 1) {
+        printf("--vars must be from 1 to %d, and --interval and --days at least 1\n", maxVars);
+        return 1;
+    }
+
+    printf("%d variables logged every %d minutes for %d days\n\n", varCount, logger.loggingInterval, days);
+    printf("every  fail lost  keep   sessions  requests  connects   kB sent  s online  dropped\n"
+           "                  open    per day   per day   per day   per day   per day intervals\n");
+    static const uint8_t everys[] = {1, 2, 5};
+    static const double  fails[]  = {0, 0.1, 0.3};
+    for (unsigned e = 0; e < sizeof(everys) / sizeof(everys[0]); e++) {
+        for (unsigned f = 0; f < sizeof(fails) / sizeof(fails[0]); f++) {
+            for (int keepAlive = 1; keepAlive >= 0; keepAlive--) {
+                StandInServer server;
+                server.failChance = fails[f];
+                server.loseChance = fails[f] / 3;
+                server.keepAlive  = keepAlive;
+                runCase(server, varCount, everys[e], days);
+            }
+        }
+    }
+
+    if (problems > 0) {
+        printf("\nFAILED: %d problems\n", problems);
+        return 1;
+    }
+    printf("\nEvery observation got to the server once, unchanged, except the dropped intervals\n");
+    return 0;
+}
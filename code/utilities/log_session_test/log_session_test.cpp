@@ -0,0 +1,356 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the log session in the ModularSensors
+library, which keeps the log file open between intervals, stages the records in RAM and writes them to
+the SD card a sector at a time, against a stand-in SD card that counts every sector written and can lose
+its power at any of them.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -std=c++17 -O2 -D ARDUINO=10819 -I ../host_arduino \
+      -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -I ../../arduino_libraries/EnviroDIY_DS3231/src \
+      -include WatchDogs/WatchDogAVR.h -o log_session_test log_session_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LoggerBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LogSession.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LoggerModem.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/dataPublisherBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableArray.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/SensorBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/ResultReducer.cpp \
+      ../../arduino_libraries/EnviroDIY_DS3231/src/Sodaq_DS3231.cpp
+
+and run it:
+
+  log_session_test [--trials 2000] [--seed 1]
+
+First it logs a day of records both ways, opening and closing the file for each record as logToSD() does
+without a session and through a session, and prints the sector writes and the time the logger is awake
+with the SD card for each record.
+
+Then each trial logs records through one session after another, on a card that erases to 0xFF, to 0x00,
+or can't erase at all, with the power cut at a random sector write, part way through it. After the power
+comes back a new logger opens the file again. What's in it has to be the header and the records, in
+order and unchanged, up to some whole record: at least every record there was before the last sync, and
+nothing the logger didn't write. A file whose header never all reached the card has to be started over
+with just the header. Records logged after that have to follow on from there.
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "LogSession.h"
+#include "HostDS3231.h"
+
+
+// The sleep code isn't built here, so neither is the watchdog
+extendedWatchDogAVR::extendedWatchDogAVR() {}
+extendedWatchDogAVR::~extendedWatchDogAVR() {}
+void extendedWatchDogAVR::setupWatchDog(uint32_t) {}
+void extendedWatchDogAVR::enableWatchDog() {}
+void extendedWatchDogAVR::disableWatchDog() {}
+void extendedWatchDogAVR::resetWatchDog() {}
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+
+static long problems = 0;
+
+static void problem(const char* what, long trial) {
+    if (problems++ < 10) printf("PROBLEM: %s (trial %ld)\n", what, trial);
+}
+
+
+// A sensor whose every result is whatever the test says
+class FakeSensor : public Sensor {
+ public:
+    FakeSensor() : Sensor("FakeSensor", MAX_NUMBER_VARS, 0, 0, 0, -1, -1, 1) {}
+
+    float next[MAX_NUMBER_VARS];
+
+    bool addSingleMeasurementResult(void) override {
+        for (uint8_t i = 0; i < MAX_NUMBER_VARS; i++) verifyAndAddMeasurementResult(i, next[i]);
+        // Unset the measurement request bits, as the real sensors do
+        _sensorStatus &= 0b10011111;
+        return true;
+    }
+
+    // Nothing to wait for
+    bool isWarmedUp(bool) override {
+        return true;
+    }
+    bool isStable(bool) override {
+        return true;
+    }
+    bool isMeasurementComplete(bool) override {
+        return true;
+    }
+};
+
+// Writes into a string, to know what the logger should have written
+class TextStream : public Stream {
+ public:
+    std::string text;
+    size_t      write(uint8_t c) override {
+        text += static_cast<char>(c);
+        return 1;
+    }
+    using Print::write;
+    int available(void) override {
+        return 0;
+    }
+    int read(void) override {
+        return -1;
+    }
+    int peek(void) override {
+        return -1;
+    }
+};
+
+
+static const char*   fileName    = "log_session_test.csv";
+static const int8_t  sdSSPin     = 12;
+static const int8_t  sdPowerPin  = 22;
+static const uint8_t maxVariables = MAX_NUMBER_VARS;
+
+static FakeSensor                sensor;
+static std::unique_ptr<Variable> variables[maxVariables];
+static Variable*                 variableList[maxVariables];
+static VariableArray             array;
+static HostDS3231                clock3231;
+
+// Variables from 1 to 8, so the records come in different lengths
+static void newVariables(uint8_t count) {
+    static const char* codes[maxVariables] = {"Depth", "Temp", "RH", "Batt", "Solar", "Wind", "Dir", "SWE"};
+    for (uint8_t i = 0; i < maxVariables; i++) {
+        variables[i].reset(new Variable(&sensor, i, randomNumber(4), "name", "unit", codes[i], ""));
+        variableList[i] = variables[i].get();
+    }
+    array.begin(count, variableList);
+    array.setupSensors();
+}
+
+// The next interval's values
+static void newValues(void) {
+    for (uint8_t i = 0; i < maxVariables; i++) {
+        sensor.next[i] = randomNumber(10) == 0 ? -9999
+                                               : (static_cast<int>(randomNumber(200001)) - 100000) / 100.0f;
+    }
+    array.completeUpdate();
+}
+
+// A logger starting up, with nothing left from the last one but what's on the card
+static std::unique_ptr<Logger> newLogger(void) {
+    std::unique_ptr<Logger> logger(new Logger("test", 1, sdSSPin, -1, &array));
+    logger->setSDCardPwr(sdPowerPin);
+    logger->setFileName(fileName);
+    // The header reads it, and the sketches always set it
+    logger->setSamplingFeatureUUID("");
+    return logger;
+}
+
+static std::string headerText(Logger& logger) {
+    TextStream header;
+    logger.printFileHeader(&header);
+    return header.text;
+}
+static std::string recordText(Logger& logger) {
+    TextStream record;
+    logger.printSensorDataCSV(&record);
+    return record.text;
+}
+
+// The next interval: its time, its values, and the record it should make
+static std::string nextRecord(Logger& logger, uint16_t interval_min) {
+    Logger::markedLocalEpochTime += 60 * interval_min;
+    newValues();
+    return recordText(logger);
+}
+
+// Saves the interval the way logData() does: power the card, save the record, cut the card's power
+static bool saveRecord(Logger& logger) {
+    logger.turnOnSDcard(false);
+    bool saved = logger.logToSD();
+    logger.turnOffSDcard(true);
+    return saved;
+}
+
+
+// The sector writes and awake time of a day of records, with and without a session
+static void compareWrites(void) {
+    static const uint16_t intervals[] = {1, 5, 15};
+    printf("A day of records, per record:      sector writes    data    FAT    directory   awake (ms)\n");
+    for (uint16_t interval : intervals) {
+        for (int withSession = 0; withSession < 2; withSession++) {
+            hostSdCard = HostSdCard();
+            newVariables(6);
+            std::unique_ptr<Logger> logger = newLogger();
+            Logger::markedLocalEpochTime = 1700000000UL;
+            LogSession session(*logger);
+            uint32_t records = 24 * 60 / interval;
+            // The file is made the first time, either way
+            if (withSession) {
+                session.begin();
+            } else {
+                logger->createLogFile(true);
+            }
+            HostSdCard before = hostSdCard;
+            uint32_t   awake  = 0;
+            for (uint32_t r = 0; r < records; r++) {
+                nextRecord(*logger, interval);
+                uint32_t start = millis();
+                if (!saveRecord(*logger)) problem("a record wasn't saved", 0);
+                awake += millis() - start;
+            }
+            if (withSession) session.end();
+            printf("  every %2u min, %-18s %9.2f %10.2f %6.2f %10.2f %10.1f\n", interval,
+                   withSession ? "with a session" : "opening the file",
+                   double(hostSdCard.sectorWrites() - before.sectorWrites()) / records,
+                   double(hostSdCard.dataWrites - before.dataWrites) / records,
+                   double(hostSdCard.fatWrites - before.fatWrites) / records,
+                   double(hostSdCard.directoryWrites - before.directoryWrites) / records,
+                   double(awake) / records);
+        }
+    }
+}
+
+
+// Logs through sessions until the power is cut, then starts again and checks what was kept
+static void testPowerCuts(long trials) {
+    static const uint32_t extents[]       = {32768UL, 65536UL, MS_LOG_SESSION_EXTENT};
+    static const uint16_t syncIntervals[] = {60, 300, 900, 3600};
+    long cuts = 0, unsynced = 0, recovered = 0;
+
+    for (long trial = 1; trial <= trials; trial++) {
+        hostSdCard = HostSdCard();
+        uint8_t kind = randomNumber(3);
+        hostSdCard.canErase    = kind != 2;
+        hostSdCard.erasedValue = kind == 1 ? 0x00 : 0xFF;
+        newVariables(1 + randomNumber(maxVariables));
+        uint32_t extent       = extents[randomNumber(3)];
+        uint16_t syncInterval = syncIntervals[randomNumber(4)];
+        Logger::markedLocalEpochTime = 1700000000UL + randomNumber(10000000);
+
+        // Cut the power somewhere in the first few hundred sector writes, or not at all
+        hostSdCard.writesUntilCut = randomNumber(10) == 0 ? -1 : static_cast<long>(randomNumber(400));
+        hostSdCard.tornBytes      = randomNumber(HostSdCard::sectorSize);
+
+        std::string written;     // Everything the logger wrote, header and records
+        size_t      synced = 0;  // How much of it was synced
+        for (int s = 0; s < 4 && !hostSdCard.powerCut; s++) {
+            std::unique_ptr<Logger> logger = newLogger();
+            LogSession              session(*logger, extent, syncInterval);
+            if (written.empty()) written = headerText(*logger);
+            if (!session.begin() || hostSdCard.powerCut) break;
+            synced          = written.size();
+            uint32_t lastSync = Logger::markedLocalEpochTime;
+            int      records  = randomNumber(400);
+            for (int r = 0; r < records && !hostSdCard.powerCut; r++) {
+                written += nextRecord(*logger, 1);
+                saveRecord(*logger);
+                // The session syncs once the sync interval has passed
+                if (Logger::markedLocalEpochTime - lastSync >= syncInterval && !hostSdCard.powerCut) {
+                    synced   = written.size();
+                    lastSync = Logger::markedLocalEpochTime;
+                }
+            }
+            if (session.end() && !hostSdCard.powerCut) synced = written.size();
+        }
+        if (!hostSdCard.powerCut) continue;
+        cuts++;
+
+        // A new logger after the power comes back
+        hostSdCard.restorePower();
+        std::unique_ptr<Logger> logger = newLogger();
+        LogSession              session(*logger, extent, syncInterval);
+        if (!session.begin()) {
+            problem("the session couldn't start again after the power cut", trial);
+            continue;
+        }
+        std::string kept   = hostSdCard.fileText(fileName);
+        std::string header = headerText(*logger);
+        if (kept.compare(0, std::string::npos, written, 0, kept.size()) == 0) {
+            // What was written, up to some point at least as far as the last sync
+            if (kept.size() < synced) problem("records from before the last sync were lost", trial);
+            if (kept.empty() || kept.back() != '\n') {
+                problem("the file doesn't end with a whole record", trial);
+            }
+        } else if (kept.size() == extent && kept.compare(0, header.size(), header) == 0) {
+            // The file's header never all made it to the card, so it was started over. Until the session
+            // ends it holds its whole extent.
+            if (synced > 0) problem("a file that was synced was started over", trial);
+            kept = header;
+        } else {
+            problem("what was kept isn't what the logger wrote", trial);
+            if (problems <= 10) {
+                size_t at = 0;
+                while (at < kept.size() && at < written.size() && kept[at] == written[at]) at++;
+                printf("  %zu of %zu bytes kept, %zu synced; the first difference is at %zu: %d\n",
+                       kept.size(), written.size(), synced, at,
+                       at < kept.size() ? static_cast<uint8_t>(kept[at]) : -1);
+            }
+        }
+        for (size_t at = synced; at < written.size(); at++) unsynced += written[at] == '\n';
+        for (size_t at = synced; at < kept.size() && at < written.size(); at++) {
+            recovered += kept[at] == '\n';
+        }
+
+        // Records after the restart follow on from what was kept
+        std::string more = kept;
+        for (int r = 0; r < 5; r++) {
+            more += nextRecord(*logger, 1);
+            saveRecord(*logger);
+        }
+        session.end();
+        if (hostSdCard.fileText(fileName) != more) problem("the records after the restart are wrong", trial);
+    }
+
+    printf("%ld trials, %ld with a power cut\n", trials, cuts);
+    printf("Of %ld records not yet synced when the power was cut, %ld were recovered\n", unsynced, recovered);
+}
+
+
+int main(int argc, char* argv[]) {
+    long trials = 2000;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--trials") == 0 && hasValue) {
+            trials = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: log_session_test [--trials 2000] [--seed 1]\n");
+            return 1;
+        }
+    }
+
+    // The clock the file times come from
+    Wire.devices[HostDS3231::address] = &clock3231;
+    clock3231.setEpoch(1700000000UL);
+
+    compareWrites();
+    testPowerCuts(trials);
+
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("Every power cut kept the records up to the last sync, and nothing but whole records\n");
+    return 0;
+}
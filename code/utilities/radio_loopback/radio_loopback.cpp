@@ -0,0 +1,700 @@
+/*
+This program runs on your computer, not on the Mayfly. It plays both ends of the radio conversation
+between the base station and a satellite station, to count the round trips and bytes each way of
+collecting a station's data takes: the step-by-step handshake ('R', 'T', 'V', then the name and value of
+each variable one at a time), the text bulk dump ('R', 'B', 'A'), and the compact dump ('R', 'C', 'S' the
+first time, 'A').
+
+Build it with any C++ compiler from this folder:
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o radio_loopback radio_loopback.cpp \
+      ../../arduino_libraries/SnowRadio/src/XBeeFrame.cpp \
+      ../../arduino_libraries/SnowRadio/src/MeasurementRecord.cpp
+
+and run it:
+
+  radio_loopback [--vars 10,20,30,40] [--uuids] [--loss 0] [--cycles 100] [--latency 40] [--escaped]
+                 [--seed 1]
+
+Each message goes through the same XBee frame encoder and decoder the sketches use. The sender's
+transmit request is built byte for byte, and the receiver decodes the receive packet its XBee would hand
+it one byte at a time, so the bytes counted are the ones on the Mayflies' serial ports. --escaped builds
+the frames for API mode 2. A station has each of the --vars variable counts in turn, named with short
+variable codes (satellite_varCode) or with UUIDs if --uuids is given (satellite_varUUID). Its values are
+random, with a few of them missing (-9999).
+
+Every way of asking has to give the base station exactly the same text for the station
+("timestamp;code;value;...;*"). If one doesn't, the program says so and exits with an error, so it also
+checks that the dumps carry everything the handshake did.
+
+Halfway through the cycles a variable is renamed, as if the station were given a new sketch, which
+changes its schema ID. With nothing lost, the compact dump has to fetch the names ('S') in the first
+cycle and again in the cycle the schema changes, and in no other. Every other cycle carries only the
+values, so it has to take fewer bytes over the air and on the serial ports than the last cycle that
+fetched the names did. It prints the bytes each way for both kinds of cycle.
+
+Each message is lost with the chance given in --loss, in which case the base station waits out its
+10 second timeout and asks again the way the base station sketches do. Dumps are asked for bulkAttempts
+times before falling back to the next way of asking, and the step-by-step handshake isn't asked again.
+--cycles logging intervals are run for each case. The time each way takes is worked out from
+--latency milliseconds for each message over the air, plus the serial bytes at 9600 baud, plus the
+timeouts.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "XBeeFrame.h"
+#include "MeasurementRecord.h"
+
+
+// The base station and satellite settings the sketches ship with
+static const uint8_t  bulkFragmentSize = 64;
+static const int      bulkAttempts     = 2;
+static const int      totalTries       = 7;
+static const uint32_t waitMs           = 10000;
+static const double   serialBaud       = 9600;
+
+static const int maxVars = 40;
+static const int maxText = 4096;
+
+// The ways of collecting a station's data
+enum collectMode { handshakeMode = 0, bulkMode, compactMode, modeCount };
+static const char* modeNames[modeCount] = {"step-by-step", "bulk (B)", "compact (C)"};
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static double randomUnit(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (rngState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+// The satellite station's variables and this interval's values
+struct Station {
+    int      varCount;
+    char     codes[maxVars][40];
+    uint8_t  resolution[maxVars];
+    float    values[maxVars];
+    uint32_t timestamp;
+    uint16_t schemaId;
+};
+
+// What one way of collecting took, added up across the cycles
+struct Tally {
+    long   roundTrips;  // Requests the base station sent that were answered
+    long   messages;  // Messages over the air, both ways
+    long   rfBytes;  // Payload bytes over the air
+    long   serialBytes;  // Bytes on the two Mayflies' serial ports
+    long   timeouts;
+    double seconds;
+    long   complete;  // Cycles the base station got everything in
+    long   cycles;
+};
+
+// What one cycle of collecting took, to check that the names only come over when they're needed
+struct Cycle {
+    long rfBytes;
+    long serialBytes;
+    bool names;  // Whether the station's schema ('S') came over
+};
+
+// What the base station has heard back from the station
+struct Inbox {
+    int     count;
+    uint8_t messages[64][bulkFragmentSize + 8];
+    uint8_t lengths[64];
+};
+
+
+// Writes a value out as text the way Variable::formatValue() does on the Mayfly
+static void formatValue(float value, uint8_t resolution, char* out) {
+    if (resolution == 0) {
+        sprintf(out, "%d", static_cast<int16_t>(value));
+    } else {
+        sprintf(out, "%*.*f", resolution + 2, resolution, value);
+    }
+}
+
+// Writes a timestamp out the way DateTime::addToString() does
+static void formatTime(uint32_t epoch, char* out) {
+    uint32_t days = epoch / 86400, rest = epoch % 86400;
+    int      year = 1970;
+    while (true) {
+        int length = (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) ? 366 : 365;
+        if (days < static_cast<uint32_t>(length)) break;
+        days -= length;
+        year++;
+    }
+    static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int month = 0;
+    while (true) {
+        int length = monthDays[month] + (month == 1 && year % 4 == 0 ? 1 : 0);
+        if (days < static_cast<uint32_t>(length)) break;
+        days -= length;
+        month++;
+    }
+    sprintf(out, "%04d-%02d-%02d %02u:%02u:%02u", year, month + 1, (int)days + 1, rest / 3600,
+            rest / 60 % 60, rest % 60);
+}
+
+// Works out the station's schema ID the way the satellite sketches do
+static void hashSchema(Station& station) {
+    SchemaHash hash;
+    for (int i = 0; i < station.varCount; i++) {
+        hash.add(station.codes[i]);
+        hash.add(station.resolution[i]);
+        hash.add(recordFormat(station.resolution[i]));
+    }
+    station.schemaId = hash.value();
+}
+
+static void makeStation(Station& station, int varCount, bool uuids) {
+    station.varCount = varCount;
+    for (int i = 0; i < varCount; i++) {
+        if (uuids) {
+            sprintf(station.codes[i], "%08x-abcd-1234-ef00-%012x", 0x12345678 + i, 0x1234567 * (i + 1));
+        } else {
+            sprintf(station.codes[i], "Var%02d_%s", i, i % 3 == 0 ? "Depth" : "Temp");
+        }
+        station.resolution[i] = i % 4;
+    }
+    hashSchema(station);
+}
+
+// Gives the first variable a new name, as a new sketch on the station might
+static void renameVariable(Station& station) {
+    station.codes[0][0] = station.codes[0][0] == 'W' ? 'V' : 'W';
+    hashSchema(station);
+}
+
+static void newReading(Station& station, uint32_t timestamp) {
+    station.timestamp = timestamp;
+    for (int i = 0; i < station.varCount; i++) {
+        station.values[i] = randomUnit() < 0.05 ? -9999 : (randomUnit() - 0.3) * 500;
+    }
+}
+
+// The text the base station should end up with for the station
+static void expectedText(const Station& station, char* out) {
+    char value[RECORD_VALUE_TEXT_SIZE];
+    formatTime(station.timestamp, out);
+    strcat(out, ";");
+    for (int i = 0; i < station.varCount; i++) {
+        formatValue(station.values[i], station.resolution[i], value);
+        strcat(out, station.codes[i]);
+        strcat(out, ";");
+        strcat(out, value);
+        strcat(out, ";");
+    }
+    strcat(out, "*");
+}
+
+
+/*
+The radio link. send() builds the sender's transmit request and the receive packet the other XBee hands
+over, and decodes the receive packet the way the other Mayfly would. It returns false if the message
+was lost on the way.
+*/
+static bool    escapedFrames = false;
+static double  lossChance    = 0;
+static double  latencyMs     = 40;
+static uint8_t baseAddress[8] = {0x00, 0x13, 0xA2, 0x00, 0x41, 0x00, 0x00, 0x01};
+static uint8_t satAddress[8]  = {0x00, 0x13, 0xA2, 0x00, 0x42, 0x00, 0x00, 0x02};
+static uint8_t network16[2]   = {0xFF, 0xFE};
+
+static bool send(const uint8_t* payload, uint16_t length, bool fromBase, Tally& tally,
+                 uint8_t* received, uint16_t* receivedLength) {
+    uint8_t          txBuffer[2 * (bulkFragmentSize + 32)];
+    XBeeFrameEncoder encoder(txBuffer, sizeof(txBuffer), escapedFrames);
+    uint16_t         sent = encoder.transmitRequest(fromBase ? satAddress : baseAddress, network16,
+                                                    payload, length, fromBase ? 1 : 0);
+    tally.serialBytes += sent;
+    // The base station asks for a transmit status, which its XBee sends back whether or not it got there
+    if (fromBase) {
+        uint8_t          statusBuffer[32];
+        uint8_t          status[6] = {1, network16[0], network16[1], 0, 0, 0};
+        XBeeFrameEncoder statusEncoder(statusBuffer, sizeof(statusBuffer), escapedFrames);
+        statusEncoder.beginFrame(XBEE_TRANSMIT_STATUS, sizeof(status));
+        statusEncoder.append(status, sizeof(status));
+        tally.serialBytes += statusEncoder.endFrame();
+    }
+    tally.messages++;
+    tally.rfBytes += length;
+    tally.seconds += latencyMs / 1000.0 + sent * 10 / serialBaud;
+    if (randomUnit() < lossChance) return false;
+
+    // Build the receive packet the other XBee hands over, and decode it one byte at a time
+    uint8_t rxBuffer[2 * (bulkFragmentSize + 32)];
+    encoder = XBeeFrameEncoder(rxBuffer, sizeof(rxBuffer), escapedFrames);
+    encoder.beginFrame(XBEE_RECEIVE_PACKET, XBEE_RECEIVE_HEADER_SIZE - 1 + length);
+    encoder.append(fromBase ? baseAddress : satAddress, 8);
+    encoder.append(network16, 2);
+    encoder.append(0x01);  // Acknowledged
+    encoder.append(payload, length);
+    uint16_t frameLength = encoder.endFrame();
+    tally.serialBytes += frameLength;
+
+    uint8_t          decodeBuffer[bulkFragmentSize + 32];
+    XBeeFrameDecoder decoder(decodeBuffer, sizeof(decodeBuffer), escapedFrames);
+    for (uint16_t b = 0; b < frameLength; b++) {
+        if (decoder.feed(rxBuffer[b]) != XBeeFrameDecoder::frameReady) continue;
+        if (!decoder.isReceivePacket()) return false;
+        *receivedLength = decoder.rfDataLength();
+        memcpy(received, decoder.rfData(), *receivedLength);
+        return true;
+    }
+    fprintf(stderr, "A frame didn't decode!\n");
+    exit(1);
+}
+
+
+/*
+The satellite station's side. It answers a request the way satellite_varCode.ino does, sending each
+message back over the link into the base station's inbox.
+*/
+struct Fragments {
+    uint8_t fragment[bulkFragmentSize];
+    uint8_t used;
+    uint8_t seq;
+    Inbox*  inbox;
+    Tally*  tally;
+};
+
+static void reply(const uint8_t* payload, uint16_t length, Inbox& inbox, Tally& tally) {
+    uint16_t got;
+    if (send(payload, length, false, tally, inbox.messages[inbox.count], &got)) {
+        inbox.lengths[inbox.count++] = got;
+    }
+}
+
+static void beginFragments(Fragments& f, uint8_t kind) {
+    f.fragment[0] = kind;
+    f.seq         = 0;
+    f.used        = 2;
+}
+
+static void addToFragments(Fragments& f, const uint8_t* data, int length) {
+    for (int c = 0; c < length; c++) {
+        if (f.used == bulkFragmentSize) {
+            f.fragment[1] = f.seq++;
+            reply(f.fragment, f.used, *f.inbox, *f.tally);
+            f.used = 2;
+        }
+        f.fragment[f.used++] = data[c];
+    }
+}
+
+static void addTextToFragments(Fragments& f, const char* text) {
+    addToFragments(f, reinterpret_cast<const uint8_t*>(text), strlen(text));
+}
+
+static void endFragments(Fragments& f) {
+    f.fragment[1] = f.seq | 0x80;
+    reply(f.fragment, f.used, *f.inbox, *f.tally);
+}
+
+static void satelliteAnswer(const Station& station, const uint8_t* request, uint16_t length,
+                            Inbox& inbox, Tally& tally) {
+    char      text[64];
+    Fragments f;
+    f.inbox = &inbox;
+    f.tally = &tally;
+    switch (request[0]) {
+        case 'R': {
+            uint8_t readyReply[6] = {'R', static_cast<uint8_t>(station.schemaId & 0xFF),
+                                     static_cast<uint8_t>(station.schemaId >> 8), 0, 5, 0};
+            reply(readyReply, sizeof(readyReply), inbox, tally);
+            break;
+        }
+        case 'T':
+            formatTime(station.timestamp, text);
+            reply(reinterpret_cast<uint8_t*>(text), strlen(text), inbox, tally);
+            break;
+        case 'V': {
+            uint8_t count = station.varCount;
+            reply(&count, 1, inbox, tally);
+            break;
+        }
+        case 'N':
+            formatValue(station.values[request[1]], station.resolution[request[1]], text);
+            reply(reinterpret_cast<uint8_t*>(text), strlen(text), inbox, tally);
+            break;
+        case 'B':
+            beginFragments(f, 'B');
+            formatTime(station.timestamp, text);
+            addTextToFragments(f, text);
+            sprintf(text, ";%d;", station.varCount);
+            addTextToFragments(f, text);
+            for (int i = 0; i < station.varCount; i++) {
+                addTextToFragments(f, station.codes[i]);
+                addTextToFragments(f, ";");
+                formatValue(station.values[i], station.resolution[i], text);
+                addTextToFragments(f, text);
+                addTextToFragments(f, ";");
+            }
+            endFragments(f);
+            break;
+        case 'C': {
+            uint8_t packed[RECORD_HEADER_SIZE + maxVars * RECORD_MAX_VALUE_SIZE];
+            uint8_t used = recordPutHeader(packed, station.schemaId, station.timestamp,
+                                           station.varCount);
+            for (int i = 0; i < station.varCount; i++) {
+                // Packed from the value's text, like packRecord() does
+                formatValue(station.values[i], station.resolution[i], text);
+                used += recordPutValue(packed + used, station.values[i],
+                                       recordFormat(station.resolution[i]), text);
+            }
+            beginFragments(f, 'C');
+            addToFragments(f, packed, used);
+            endFragments(f);
+            break;
+        }
+        case 'S':
+            beginFragments(f, 'S');
+            sprintf(text, "%u;%d;", station.schemaId, station.varCount);
+            addTextToFragments(f, text);
+            for (int i = 0; i < station.varCount; i++) {
+                addTextToFragments(f, station.codes[i]);
+                sprintf(text, ";%u;", recordFormat(station.resolution[i]));
+                addTextToFragments(f, text);
+            }
+            endFragments(f);
+            break;
+        default:
+            // A number on its own asks for the name of that variable
+            if (length == 1 && request[0] < station.varCount) {
+                reply(reinterpret_cast<const uint8_t*>(station.codes[request[0]]),
+                      strlen(station.codes[request[0]]), inbox, tally);
+            }
+            break;
+    }
+}
+
+
+/*
+The base station's side. ask() sends a request and returns what came back, or false if nothing did
+before the base station's timeout.
+*/
+static bool ask(const Station& station, const uint8_t* request, uint16_t length, Inbox& inbox,
+                Tally& tally) {
+    uint8_t  received[16];
+    uint16_t got;
+    inbox.count = 0;
+    if (send(request, length, true, tally, received, &got)) {
+        satelliteAnswer(station, received, got, inbox, tally);
+    }
+    if (inbox.count == 0) {
+        tally.timeouts++;
+        tally.seconds += waitMs / 1000.0;
+        return false;
+    }
+    tally.roundTrips++;
+    return true;
+}
+
+// Puts a dump's fragments back together; false if one went missing
+static bool collectFragments(const Inbox& inbox, uint8_t kind, uint8_t* out, int* outLength,
+                             Tally& tally) {
+    *outLength = 0;
+    for (int m = 0; m < inbox.count; m++) {
+        if (inbox.lengths[m] < 2 || inbox.messages[m][0] != kind) return false;
+        if ((inbox.messages[m][1] & 0x7F) != m) return false;
+        memcpy(out + *outLength, inbox.messages[m] + 2, inbox.lengths[m] - 2);
+        *outLength += inbox.lengths[m] - 2;
+        if (inbox.messages[m][1] & 0x80) return true;
+    }
+    // The last fragment didn't come, so the base station waits it out
+    tally.timeouts++;
+    tally.seconds += waitMs / 1000.0;
+    return false;
+}
+
+// Turns a bulk dump's text into the station's text the way appendBulkData() does
+static bool bulkToText(const char* body, char* out) {
+    const char* field = strchr(body, ';');
+    if (field == NULL) return false;
+    strncat(out, body, field - body + 1);
+    const char* countEnd = strchr(field + 1, ';');
+    if (countEnd == NULL) return false;
+    int varCount = atoi(field + 1);
+    int pairs    = 0;
+    const char* next = countEnd + 1;
+    while (*next != '\0') {
+        const char* codeEnd = strchr(next, ';');
+        if (codeEnd == NULL) return false;
+        const char* valueEnd = strchr(codeEnd + 1, ';');
+        if (valueEnd == NULL) return false;
+        strncat(out, next, valueEnd - next + 1);
+        pairs++;
+        next = valueEnd + 1;
+    }
+    if (pairs != varCount) return false;
+    strcat(out, "*");
+    return true;
+}
+
+// Turns a compact dump back into the station's text the way printRecord() does
+static bool recordToText(const uint8_t* data, int length, const RecordSchema& schema, char* out) {
+    RecordReader reader(data, length);
+    if (!reader.isValid() || !schema.matches(reader.schemaId())) return false;
+    if (reader.varCount() != schema.varCount()) return false;
+    formatTime(reader.timestamp(), out + strlen(out));
+    strcat(out, ";");
+    char value[RECORD_VALUE_TEXT_SIZE];
+    for (uint8_t v = 0; v < reader.varCount(); v++) {
+        if (!reader.nextValue(schema.format(v), value, sizeof(value))) return false;
+        strcat(out, schema.code(v));
+        strcat(out, ";");
+        strcat(out, value);
+        strcat(out, ";");
+    }
+    strcat(out, "*");
+    return reader.atEnd();
+}
+
+// Collects a station's data one way, falling back the way the sketches do. The base station's copy of
+// the schema is kept across cycles.
+static void askStation(const Station& station, collectMode mode, RecordSchema& schema, Tally& tally,
+                       char* text, Cycle& cycle) {
+    Inbox*  inbox = new Inbox;
+    uint8_t request[2];
+    text[0] = '\0';
+
+    // Ask if the station is ready, up to totalTries times
+    bool ready = false;
+    request[0] = 'R';
+    for (int t = 0; t < totalTries && !ready; t++) ready = ask(station, request, 1, *inbox, tally);
+    if (!ready) {
+        strcpy(text, ";*");
+        delete inbox;
+        return;
+    }
+    uint16_t advertised = inbox->messages[0][1] | (inbox->messages[0][2] << 8);
+
+    // Ask for the dumps, falling back from compact to bulk to the handshake
+    uint8_t body[maxText];
+    int     bodyLength;
+    int     step = mode;
+    while (step != handshakeMode) {
+        bool done = false;
+        for (int t = 0; t < bulkAttempts && !done; t++) {
+            if (step == compactMode && !schema.matches(advertised)) {
+                request[0] = 'S';
+                if (!ask(station, request, 1, *inbox, tally)) continue;
+                if (!collectFragments(*inbox, 'S', body, &bodyLength, tally)) continue;
+                schema.load(reinterpret_cast<char*>(body), bodyLength);
+                cycle.names = true;
+            }
+            request[0] = step == compactMode ? 'C' : 'B';
+            if (!ask(station, request, 1, *inbox, tally)) continue;
+            if (!collectFragments(*inbox, request[0], body, &bodyLength, tally)) continue;
+            body[bodyLength] = '\0';
+            if (step == compactMode) {
+                done = recordToText(body, bodyLength, schema, text);
+            } else {
+                done = bulkToText(reinterpret_cast<char*>(body), text);
+            }
+            if (!done) text[0] = '\0';
+        }
+        if (done) {
+            // Let the station know it can stop; nothing comes back
+            request[0] = 'A';
+            uint8_t  ignored[4];
+            uint16_t got;
+            send(request, 1, true, tally, ignored, &got);
+            delete inbox;
+            return;
+        }
+        step = step == compactMode ? bulkMode : handshakeMode;
+    }
+
+    // The step-by-step handshake. Nothing is asked twice, so whatever didn't come is left out.
+    request[0] = 'T';
+    if (ask(station, request, 1, *inbox, tally)) {
+        strncat(text, reinterpret_cast<char*>(inbox->messages[0]), inbox->lengths[0]);
+    }
+    strcat(text, ";");
+    request[0] = 'V';
+    int varCount = 0;
+    if (ask(station, request, 1, *inbox, tally)) varCount = inbox->messages[0][0];
+    for (int i = 0; i < varCount; i++) {
+        request[0] = static_cast<uint8_t>(i);
+        if (ask(station, request, 1, *inbox, tally)) {
+            strncat(text, reinterpret_cast<char*>(inbox->messages[0]), inbox->lengths[0]);
+        }
+        strcat(text, ";");
+        request[0] = 'N';
+        request[1] = static_cast<uint8_t>(i);
+        if (ask(station, request, 2, *inbox, tally)) {
+            strncat(text, reinterpret_cast<char*>(inbox->messages[0]), inbox->lengths[0]);
+        }
+        strcat(text, ";");
+    }
+    strcat(text, "*");
+    delete inbox;
+}
+
+// Collects a station's data once, keeping track of the bytes it took
+static void collect(const Station& station, collectMode mode, RecordSchema& schema, Tally& tally,
+                    char* text, Cycle& cycle) {
+    long rfBytes     = tally.rfBytes;
+    long serialBytes = tally.serialBytes;
+    cycle.names      = false;
+    askStation(station, mode, schema, tally, text, cycle);
+    cycle.rfBytes     = tally.rfBytes - rfBytes;
+    cycle.serialBytes = tally.serialBytes - serialBytes;
+}
+
+
+static int problems = 0;
+
+static void problem(const char* what, int varCount, int cycle) {
+    if (problems++ < 5) printf("PROBLEM: %s (%d variables, cycle %d)\n", what, varCount, cycle + 1);
+}
+
+
+static int readList(const char* text, int* list) {
+    int count = 0;
+    while (*text != '\0' && count < 16) {
+        list[count++] = atoi(text);
+        const char* comma = strchr(text, ',');
+        if (comma == NULL) break;
+        text = comma + 1;
+    }
+    return count;
+}
+
+static void printUsage(void) {
+    printf("usage: radio_loopback [--vars 10,20,30,40] [--uuids] [--loss 0] [--cycles 100]\n"
+           "                      [--latency 40] [--escaped] [--seed 1]\n");
+}
+
+int main(int argc, char* argv[]) {
+    int  varList[16] = {10, 20, 30, 40};
+    int  varLists    = 4;
+    bool uuids       = false;
+    int  cycles      = 100;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--vars") == 0 && hasValue) {
+            varLists = readList(argv[++a], varList);
+        } else if (strcmp(argv[a], "--uuids") == 0) {
+            uuids = true;
+        } else if (strcmp(argv[a], "--loss") == 0 && hasValue) {
+            lossChance = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--cycles") == 0 && hasValue) {
+            cycles = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--latency") == 0 && hasValue) {
+            latencyMs = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--escaped") == 0) {
+            escapedFrames = true;
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    printf("%d cycles for each case, %.0f%% of messages lost, codes are %s\n\n", cycles,
+           lossChance * 100, uuids ? "UUIDs" : "variable codes");
+    printf("vars  way of asking   round trips  messages  RF bytes  serial bytes  timeouts  seconds"
+           "  complete\n");
+
+    int   mismatches = 0;
+    char* expected   = new char[maxText];
+    char* got        = new char[maxText];
+    // The compact dump's bytes over the air and on the serial ports, with and without the names
+    long  namesBytes[16][2] = {}, valuesBytes[16][2] = {};
+    for (int v = 0; v < varLists; v++) {
+        if (varList[v] < 1 || varList[v] > maxVars) {
+            printf("--vars must be from 1 to %d\n", maxVars);
+            return 1;
+        }
+        for (int mode = 0; mode < modeCount; mode++) {
+            Station station;
+            makeStation(station, varList[v], uuids);
+            Tally        tally = {};
+            char         codes[maxVars * 40];
+            RecordSchema schema;  // The base station starts out without the station's schema
+            schema.begin(codes, sizeof(codes));
+            Cycle lastNames = {};
+            for (int c = 0; c < cycles; c++) {
+                uint16_t schemaId = station.schemaId;
+                if (c > 0 && c == cycles / 2) renameVariable(station);
+                newReading(station, 1735689600UL + c * 3600UL);
+                expectedText(station, expected);
+                Cycle cycle;
+                collect(station, static_cast<collectMode>(mode), schema, tally, got, cycle);
+                tally.cycles++;
+
+                // With nothing lost, the compact dump fetches the names only when the schema is new to
+                // the base station, and every other cycle takes fewer bytes
+                if (mode == compactMode && lossChance == 0) {
+                    bool changed = c == 0 || station.schemaId != schemaId;
+                    if (changed && !cycle.names) {
+                        problem("the names weren't fetched for a new schema", varList[v], c);
+                    } else if (!changed && cycle.names) {
+                        problem("the names were fetched again", varList[v], c);
+                    }
+                    if (cycle.names) {
+                        lastNames = cycle;
+                        namesBytes[v][0] += cycle.rfBytes;
+                        namesBytes[v][1] += cycle.serialBytes;
+                    } else {
+                        if (cycle.rfBytes >= lastNames.rfBytes ||
+                            cycle.serialBytes >= lastNames.serialBytes) {
+                            problem("a cycle without the names took as many bytes", varList[v], c);
+                        }
+                        valuesBytes[v][0] += cycle.rfBytes;
+                        valuesBytes[v][1] += cycle.serialBytes;
+                    }
+                }
+                if (strcmp(expected, got) == 0) {
+                    tally.complete++;
+                } else if (lossChance == 0) {
+                    // With nothing lost, every way of asking has to give the same text
+                    if (mismatches++ < 3) {
+                        printf("\n%s gave:\n  %s\ninstead of:\n  %s\n\n", modeNames[mode], got,
+                               expected);
+                    }
+                }
+            }
+            printf("%4d  %-14s  %11.1f  %8.1f  %8.0f  %12.0f  %8.2f  %7.2f  %7.1f%%\n", varList[v],
+                   modeNames[mode], double(tally.roundTrips) / cycles,
+                   double(tally.messages) / cycles, double(tally.rfBytes) / cycles,
+                   double(tally.serialBytes) / cycles, double(tally.timeouts) / cycles,
+                   tally.seconds / cycles, 100.0 * tally.complete / cycles);
+        }
+    }
+    delete[] expected;
+    delete[] got;
+
+    if (lossChance == 0 && cycles > 2) {
+        printf("\nvars  compact dump bytes, with the names (RF / serial)  values only (RF / serial)\n");
+        for (int v = 0; v < varLists; v++) {
+            // The names come over in the first cycle and the one the schema changes in
+            printf("%4d  %38.0f / %-6.0f%14.0f / %.0f\n", varList[v], namesBytes[v][0] / 2.0,
+                   namesBytes[v][1] / 2.0, double(valuesBytes[v][0]) / (cycles - 2),
+                   double(valuesBytes[v][1]) / (cycles - 2));
+        }
+    }
+
+    if (mismatches > 0) printf("\n%d collections didn't give the station's text\n", mismatches);
+    if (mismatches > 0 || problems > 0) {
+        printf("FAILED: %d problems\n", mismatches + problems);
+        return 1;
+    }
+    printf("\nEvery way of asking gave the same text for each station\n");
+    if (lossChance == 0) {
+        printf("The compact dump fetched the names only for a new schema, and took fewer bytes otherwise\n");
+    }
+    return 0;
+}
@@ -0,0 +1,297 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the RecordQueue in the SnowRadio library,
+which keeps a satellite station's readings on its SD card until the base station has them, by cutting
+the power partway through its writes over and over.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o record_queue_test record_queue_test.cpp \
+      ../../arduino_libraries/SnowRadio/src/RecordQueue.cpp \
+      ../../arduino_libraries/SnowRadio/src/MeasurementRecord.cpp
+
+and run it:
+
+  record_queue_test [--cuts 20000] [--slots 24] [--seed 1]
+
+The queue's file is kept in memory. The station pushes a reading each logging interval and the base
+station acknowledges most of them, sometimes a few at once after missing some. At a random point the
+power goes out in the middle of a write: the bytes up to there are written, the rest of the write is
+left as it was or filled with garbage (as an SD card can leave a sector it was writing), and nothing
+more is written or read until the station starts back up and reads the queue back from the file.
+
+After every restart it checks that:
+
+- every reading that was saved and not acknowledged is still waiting, and reads back byte for byte
+- no reading that was acknowledged is waiting again, unless the write that was cut off was putting a
+  new reading in its slot (the queue marks a slot as waiting before writing it, so a reading can be
+  sent twice but never lost)
+- any reading that is waiting reads back as exactly what was saved, never as a torn or garbled record
+- sequence numbers are never handed out twice, even with --slots 1, where a cut-off write takes out the
+  only record there was
+
+A reading whose acknowledgement was cut off may or may not still be waiting, so it isn't checked after
+that. Once in a while a torn write still passes its 16 bit CRC (about one in 65536); the readings it
+could affect aren't checked either, and the program says how many times that happened.
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MeasurementRecord.h"
+#include "RecordQueue.h"
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+
+static long problems = 0;
+
+static void problem(const char* what, uint32_t seq) {
+    if (problems++ < 10) printf("PROBLEM after a power cut: %s (reading %u)\n", what, seq);
+}
+
+
+/*
+The queue's file, kept in memory. The power goes out once writeBudget more bytes have been written.
+*/
+static bool endsInItsCrc(const uint8_t* data, uint16_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i + 2 < length; i++) crc = crc16Add(crc, data[i]);
+    return length > 2 && data[length - 2] == (crc & 0xFF) && data[length - 1] == (crc >> 8);
+}
+
+class PowerCutStore : public RecordStore {
+ public:
+    explicit PowerCutStore(uint32_t size)
+        : powered(true), fooledCrc(false), writeBudget(0xFFFFFFFFUL), bytesWritten(0) {
+        _size = size;
+        _data = new uint8_t[size];
+        memset(_data, 0, size);
+    }
+    ~PowerCutStore() {
+        delete[] _data;
+    }
+
+    bool read(uint32_t position, uint8_t* data, uint16_t length) override {
+        if (!powered || position + length > _size) return false;
+        memcpy(data, _data + position, length);
+        return true;
+    }
+
+    bool write(uint32_t position, const uint8_t* data, uint16_t length) override {
+        if (!powered || position + length > _size) return false;
+        if (length <= writeBudget) {
+            memcpy(_data + position, data, length);
+            writeBudget -= length;
+            bytesWritten += length;
+            return true;
+        }
+        // The power goes out partway through. What was being written past that point is left as it
+        // was, or garbled.
+        uint8_t* piece = _data + position;
+        uint8_t  before[RECORD_QUEUE_SLOT_SIZE];
+        memcpy(before, piece, length);
+        memcpy(piece, data, writeBudget);
+        if (randomNumber(2) == 0) {
+            for (uint16_t b = writeBudget; b < length; b++) piece[b] = randomNumber(256);
+        }
+        // A 16 bit CRC lets about one torn piece in 65536 through, which is a limit of the CRC and not
+        // something the queue can do anything about. A header copy is the whole write; a slot is as
+        // long as the length byte it now has says.
+        uint16_t checked = length;
+        if (position >= 2UL * RECORD_QUEUE_HEADER_SIZE) checked = 5 + piece[4] + 2;
+        fooledCrc = checked <= RECORD_QUEUE_SLOT_SIZE && position + checked <= _size &&
+            endsInItsCrc(piece, checked) && memcmp(piece, data, length) != 0 &&
+            memcmp(piece, before, length) != 0;
+        bytesWritten += writeBudget;
+        writeBudget = 0;
+        powered     = false;
+        return false;
+    }
+
+    bool     powered;
+    bool     fooledCrc;  // The last write torn by the power going out still passes its CRC
+    uint32_t writeBudget;
+    uint32_t bytesWritten;
+
+ private:
+    uint8_t* _data;
+    uint32_t _size;
+};
+
+
+// What the station has been told about each reading
+static const uint32_t maxSeq = 2000000;
+struct Reading {
+    uint8_t length;
+    uint8_t data[RECORD_QUEUE_MAX_RECORD];
+};
+
+static Reading* saved;  // The readings the queue said it saved, by sequence number
+static bool*    acked;  // The readings the queue said were acknowledged
+
+static void makeReading(Reading& reading, uint32_t seq) {
+    reading.length = 7 + 2 * (1 + randomNumber(40));
+    if (reading.length > RECORD_QUEUE_MAX_RECORD) reading.length = RECORD_QUEUE_MAX_RECORD;
+    for (uint8_t b = 0; b < reading.length; b++) reading.data[b] = randomNumber(256);
+    reading.data[0] = seq & 0xFF;
+}
+
+
+int main(int argc, char* argv[]) {
+    int      cuts      = 20000;
+    uint16_t slotCount = 24;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--cuts") == 0 && hasValue) {
+            cuts = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--slots") == 0 && hasValue) {
+            slotCount = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: record_queue_test [--cuts 20000] [--slots 24] [--seed 1]\n");
+            return 1;
+        }
+    }
+    if (slotCount < 1 || slotCount > RECORD_QUEUE_MAX_SLOTS) {
+        printf("--slots must be from 1 to %d\n", RECORD_QUEUE_MAX_SLOTS);
+        return 1;
+    }
+
+    saved = new Reading[maxSeq];
+    acked = new bool[maxSeq];
+    memset(acked, 0, maxSeq);
+    for (uint32_t s = 0; s < maxSeq; s++) saved[s].length = 0;
+
+    PowerCutStore store(2UL * RECORD_QUEUE_HEADER_SIZE + RECORD_QUEUE_MAX_SLOTS * RECORD_QUEUE_SLOT_SIZE);
+    uint32_t      newestSaved = 0;  // The newest sequence number the queue handed out
+    uint32_t      writing     = 0;  // The reading being saved when the power went out, if it was
+    long          pushes = 0, acks = 0, resends = 0, pushWrites = 0, fooled = 0;
+
+    for (int cut = 0; cut <= cuts && newestSaved + 100 < maxSeq; cut++) {
+        if (store.fooledCrc) {
+            // Whatever the torn piece now says goes, so stop checking the readings it could cover
+            for (uint32_t s = newestSaved > slotCount ? newestSaved - slotCount + 1 : 1; s <= newestSaved;
+                 s++) {
+                saved[s].length = 0;
+            }
+            store.fooledCrc = false;
+            fooled++;
+        }
+
+        // Start up, which may be cut off too
+        store.powered     = true;
+        store.writeBudget = randomNumber(8) == 0 ? randomNumber(200) : 0xFFFFFFFFUL;
+        RecordQueue queue(store, slotCount);
+        if (!queue.begin()) continue;
+
+        // The power stays on for a while this time
+        store.writeBudget = randomNumber(4000);
+        if (cut > 0) {
+            // Check the queue came back the way it should have
+            for (uint32_t s = newestSaved > slotCount ? newestSaved - slotCount + 1 : 1; s <= newestSaved;
+                 s++) {
+                if (saved[s].length == 0) continue;
+                if (!acked[s] && !queue.isPending(s)) problem("a reading that wasn't sent was lost", s);
+            }
+        }
+        if (queue.newest() < newestSaved) problem("the sequence numbers went backward", queue.newest());
+        for (uint32_t s = queue.nextPending(); s != 0; s = queue.nextPending(s)) {
+            uint8_t data[RECORD_QUEUE_MAX_RECORD];
+            uint8_t length = queue.read(s, data, sizeof(data));
+            if (length == 0) {
+                if (store.powered) problem("a reading waiting to be sent can't be read", s);
+                break;
+            }
+            if (s <= newestSaved && saved[s].length > 0 &&
+                (length != saved[s].length || memcmp(data, saved[s].data, length) != 0)) {
+                problem("a reading came back different", s);
+            }
+            // It was allowed back by the check after the last cut, and waits to be acknowledged again
+            if (s <= newestSaved && acked[s]) {
+                acked[s] = false;
+                resends++;
+            }
+        }
+
+        // Run the station until the power goes out
+        writing = 0;
+        while (store.powered) {
+            if (randomNumber(10) < 6) {
+                Reading  reading;
+                uint32_t seq = queue.newest() + 1;
+                makeReading(reading, seq);
+                uint32_t before = store.bytesWritten;
+                writing         = seq;
+                uint32_t got    = queue.push(reading.data, reading.length);
+                if (got == 0) {
+                    // It may have written over the oldest reading in its slot, which is gone for good
+                    if (seq > slotCount) saved[seq - slotCount].length = 0;
+                    break;
+                }
+                writing = 0;
+                if (got != seq || got <= newestSaved) problem("a sequence number was handed out twice", got);
+                saved[got]  = reading;
+                acked[got]  = false;
+                newestSaved = got;
+                pushes++;
+                pushWrites += store.bytesWritten - before;
+            } else {
+                // The base station acknowledges the oldest few readings waiting
+                int count = 1 + (randomNumber(4) == 0 ? randomNumber(5) : 0);
+                for (int c = 0; c < count && store.powered; c++) {
+                    uint32_t seq = queue.nextPending();
+                    if (seq == 0) break;
+                    if (queue.ack(seq)) {
+                        acked[seq] = true;
+                        acks++;
+                    } else if (!store.powered) {
+                        // The header may or may not have made it to the card, so either way is right
+                        saved[seq].length = 0;
+                    }
+                }
+            }
+        }
+
+        // An acknowledged reading may only come back if the reading cut off was going in its slot
+        if (store.fooledCrc) continue;
+        store.powered     = true;
+        store.writeBudget = 0xFFFFFFFFUL;
+        RecordQueue check(store, slotCount);
+        if (!check.begin()) continue;
+        for (uint32_t s = check.nextPending(); s != 0; s = check.nextPending(s)) {
+            if (s <= newestSaved && acked[s] && !(writing != 0 && s % slotCount == writing % slotCount)) {
+                problem("a reading that was acknowledged is waiting again", s);
+            }
+        }
+        // Throw this check away so the next start up sees the file as the power cut left it; begin()
+        // may have tidied the header, which a real start up would do too
+    }
+
+    printf("%d power cuts: %ld readings saved, %ld acknowledged, %ld sent again after a cut\n", cuts, pushes,
+           acks, resends);
+    printf("%.1f bytes written to the card for each reading saved\n",
+           pushes > 0 ? double(pushWrites) / pushes : 0.0);
+    printf("%ld torn writes got past their CRC and weren't checked\n", fooled);
+    delete[] saved;
+    delete[] acked;
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("No reading was lost, garbled, or had its sequence number handed out twice\n");
+    return 0;
+}
@@ -0,0 +1,267 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the result reducers in the ModularSensors
+library, which let a sensor report the median, a trimmed mean, the minimum, the maximum or the last good
+measurement of each result instead of the average.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -std=c++17 -O2 -I ../host_arduino -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -o reducer_test reducer_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/ResultReducer.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/SensorBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableBase.cpp
+
+and run it:
+
+  reducer_test [--trials 20000] [--seed 1]
+
+First each kind of reducer is given random measurements, with buffers of every size from none to 20, up
+to 255 measurements (the most a sensor averages) and every trim from 0 to 60 percent. Its value is
+checked against the statistic worked out from scratch: for the median and trimmed mean, of the newest
+measurements that fit in the buffer, and the mean without a buffer. With no measurements it has to give
+-9999, asking twice has to give the same value, and clear() has to start it over.
+
+Then a stand-in snow depth sonar is read through Sensor::update(), with the depth reported through a
+median reducer and the same depth through the plain average. Now and then the sonar hears a stray echo
+or gives no reading at all. It checks that the average is still the average of the good readings and
+the median their median, and then prints how often each is more than 10 mm off the real depth.
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "SensorBase.h"
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+static float randomBetween(float low, float high) {
+    return low + (high - low) * randomNumber(1000001) / 1000000.0f;
+}
+
+
+static long problems = 0;
+
+static void problem(const char* what, const char* type, long trial) {
+    if (problems++ < 10) printf("PROBLEM: %s (%s, trial %ld)\n", what, type, trial);
+}
+
+static const char* typeNames[] = {"mean", "median", "trimmed mean", "minimum", "maximum", "last"};
+
+
+// The statistic worked out from scratch
+static float median(float* values, int n) {
+    std::sort(values, values + n);
+    if (n % 2) return values[n / 2];
+    return (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+static double trimmedMean(float* values, int n, int trimPercent) {
+    std::sort(values, values + n);
+    int drop = n * trimPercent / 100;
+    if (2 * drop >= n) drop = (n - 1) / 2;
+    double sum = 0;
+    for (int i = drop; i < n - drop; i++) sum += values[i];
+    return sum / (n - 2 * drop);
+}
+
+static double expectedValue(reducerType type, const float* values, int count, int capacity,
+                            int trimPercent) {
+    if (count == 0) return -9999;
+    if ((type == MS_REDUCE_MEDIAN || type == MS_REDUCE_TRIMMED_MEAN) && capacity > 0) {
+        // The newest measurements that fit in the buffer
+        int   n = count < capacity ? count : capacity;
+        float kept[255];
+        memcpy(kept, values + count - n, n * sizeof(float));
+        if (type == MS_REDUCE_MEDIAN) return median(kept, n);
+        return trimmedMean(kept, n, trimPercent);
+    }
+    double sum = 0, low = values[0], high = values[0];
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+        low  = std::min(low, double(values[i]));
+        high = std::max(high, double(values[i]));
+    }
+    if (type == MS_REDUCE_MIN) return low;
+    if (type == MS_REDUCE_MAX) return high;
+    if (type == MS_REDUCE_LAST) return values[count - 1];
+    return sum / count;
+}
+
+// Sums in float drift a little from sums in double; everything else has to be exact. The median without
+// a buffer is the mean.
+static bool closeEnough(reducerType type, int capacity, float got, double expected, float largest) {
+    bool summed = type == MS_REDUCE_MEAN || type == MS_REDUCE_TRIMMED_MEAN ||
+        (type == MS_REDUCE_MEDIAN && capacity == 0);
+    if (!summed) return got == static_cast<float>(expected);
+    return fabs(got - expected) <= 1e-5 * largest + 1e-6;
+}
+
+
+static void testReducers(long trials) {
+    static float buffer[20];
+    static float values[255];
+    for (long trial = 1; trial <= trials; trial++) {
+        reducerType type        = static_cast<reducerType>(randomNumber(6));
+        int         capacity    = randomNumber(21);
+        int         trimPercent = randomNumber(61);
+        ResultReducer reducer(type, capacity > 0 ? buffer : nullptr, capacity, trimPercent);
+        const char*   name = typeNames[type];
+
+        // A few update cycles, to see that clear() starts it over
+        for (int cycle = 0; cycle < 3; cycle++) {
+            reducer.clear();
+            int count = randomNumber(4) == 0 ? randomNumber(256) : randomNumber(12);
+            // Sometimes with a lot of ties, and sometimes with measurements far from the rest
+            float largest = 1;
+            for (int i = 0; i < count; i++) {
+                values[i] = randomNumber(3) == 0 ? float(randomNumber(4)) : randomBetween(-50, 50);
+                if (randomNumber(20) == 0) values[i] = randomBetween(-1e4f, 1e4f);
+                largest = std::max(largest, fabsf(values[i]));
+                reducer.add(values[i]);
+            }
+            if (reducer.getCount() != count) problem("the count is wrong", name, trial);
+
+            double expected = expectedValue(type, values, count, capacity, trimPercent);
+            float  got      = reducer.reduce();
+            if (!closeEnough(type, capacity, got, expected, largest)) {
+                if (problems < 10) {
+                    printf("  %d measurements, a buffer of %d, trim %d%%: %.6g, should be %.6g\n", count,
+                           capacity, trimPercent, got, expected);
+                }
+                problem("the value is wrong", name, trial);
+            }
+            if (reducer.reduce() != got) problem("asking again gives a different value", name, trial);
+        }
+    }
+}
+
+
+/*
+A snow depth sonar that reads the same depth each time, give or take a few millimeters, except when it
+hears a stray echo or gives nothing at all
+*/
+class FakeSonar : public Sensor {
+ public:
+    FakeSonar(uint8_t readings) : Sensor("FakeSonar", 2, 0, 0, 0, -1, -1, readings) {}
+
+    float depth;            // The real depth, in mm
+    float strayChance;      // How often a reading is a stray echo
+    float missingChance;    // How often there's no reading at all
+    float readings[255];    // The good readings this update
+    int   readingCount;
+
+    bool addSingleMeasurementResult(void) override {
+        float reading = -9999;
+        if (randomBetween(0, 1) >= missingChance) {
+            reading = depth + randomBetween(-3, 3);
+            // A stray echo is anywhere from close up to the sonar's longest range
+            if (randomBetween(0, 1) < strayChance) reading = randomBetween(300, 5000);
+            readings[readingCount++] = reading;
+        }
+        // The same reading goes to a result with a median reducer and one with the plain average
+        verifyAndAddMeasurementResult(0, reading);
+        verifyAndAddMeasurementResult(1, reading);
+        // Unset the measurement request bits, as the real sensors do
+        _sensorStatus &= 0b10011111;
+        return true;
+    }
+
+    // Nothing to wait for
+    bool isWarmedUp(bool) override {
+        return true;
+    }
+    bool isStable(bool) override {
+        return true;
+    }
+    bool isMeasurementComplete(bool) override {
+        return true;
+    }
+};
+
+static void testSonar(long updates) {
+    static const int     sizes[]   = {3, 5, 9};
+    static const float   strays[]  = {0, 0.05f, 0.1f, 0.2f, 0.3f};
+    static const uint8_t largest   = 9;
+
+    printf("How often a sonar's hourly depth is more than 10 mm off, with stray echoes:\n");
+    printf("  readings   strays    average   median\n");
+    for (int size : sizes) {
+        FakeSonar sonar(size);
+        SampleReducer<largest> reducer(MS_REDUCE_MEDIAN);
+        sonar.setReducer(0, &reducer);
+        sonar.setup();
+        for (float stray : strays) {
+            long offAverage = 0, offMedian = 0;
+            sonar.strayChance   = stray;
+            sonar.missingChance = 0.05f;
+            for (long u = 1; u <= updates; u++) {
+                sonar.depth        = randomBetween(500, 4000);
+                sonar.readingCount = 0;
+                sonar.update();
+                float gotMedian  = sonar.sensorValues[0];
+                float gotAverage = sonar.sensorValues[1];
+                if (sonar.readingCount == 0) {
+                    if (gotMedian != -9999 || gotAverage != -9999) {
+                        problem("no good readings didn't give -9999", "sonar", u);
+                    }
+                    continue;
+                }
+                double sum = 0;
+                for (int i = 0; i < sonar.readingCount; i++) sum += sonar.readings[i];
+                if (fabs(gotAverage - sum / sonar.readingCount) > 1e-3) {
+                    problem("the plain average isn't the average of the good readings", "sonar", u);
+                }
+                if (gotMedian != median(sonar.readings, sonar.readingCount)) {
+                    problem("the median isn't the median of the good readings", "sonar", u);
+                }
+                if (fabs(gotAverage - sonar.depth) > 10) offAverage++;
+                if (fabs(gotMedian - sonar.depth) > 10) offMedian++;
+            }
+            printf("  %8d %7.0f%% %9.2f%% %7.2f%%\n", size, 100 * stray, 100.0 * offAverage / updates,
+                   100.0 * offMedian / updates);
+        }
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    long trials = 20000;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--trials") == 0 && hasValue) {
+            trials = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: reducer_test [--trials 20000] [--seed 1]\n");
+            return 1;
+        }
+    }
+
+    testReducers(trials);
+    printf("%ld reducers checked\n", trials);
+    testSonar(trials / 2);
+
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("Every reducer gave the statistic it should\n");
+    return 0;
+}
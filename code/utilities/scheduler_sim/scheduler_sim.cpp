@@ -0,0 +1,312 @@
+/*
+This program runs on your computer, not on the Mayfly. It simulates the base station collecting from a
+network of satellite stations with the StationScheduler in the SnowRadio library, which keeps requests
+out to several stations at once, and compares how long that takes with asking one station at a time the
+way the base station sketches used to.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o scheduler_sim scheduler_sim.cpp \
+      ../../arduino_libraries/SnowRadio/src/StationScheduler.cpp \
+      ../../arduino_libraries/SnowRadio/src/XBeeFrame.cpp
+
+and run it:
+
+  scheduler_sim [--stations 5] [--latency 60] [--fragments 2] [--status 0]
+                [--first-backoff 2000] [--max-backoff 60000] [--cycles 200] [--seed 1]
+
+Each station is asked if it is ready ('R'), up to totalTries times, and then for its compact dump ('C'),
+up to bulkAttempts times, using the base station sketches' settings. A station that answers is held
+until every station before it in the list is finished, as if it relayed for them, and then let go. The
+answers take --latency milliseconds plus a little random time for each of their --fragments messages
+to come back. Every message is lost with the chance in the table, and the dead stations never answer
+at all. If --status is given, the base station's XBee reports that a message to a dead station wasn't
+delivered that many milliseconds after sending it, as DigiMesh does once it gives up on a route, and the
+scheduler backs off before trying again. Otherwise it waits out its 10 second timeout every time. Asking
+one at a time always waits out the timeout, since the old sketches sent with frame ID 0 and so were
+never told.
+
+For each case, from no dead stations to all of them, it prints how long collecting took, on average and
+at worst, each way, and how many stations were collected. It checks that the scheduler never has more
+than maxInFlight requests out, never has two requests out to one station, lets the stations go farthest
+first, and that with any dead stations collecting takes no longer on average than asking one at a time,
+and exits with an error if it didn't.
+
+Every station is due as soon as collecting starts, as if the slots in the base station sketches were
+0 seconds wide, so only the scheduler sets the pace. With the scheduler, collecting takes as long as the
+slowest station, so it no longer grows with each dead station. --first-backoff and --max-backoff try
+other settings.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "StationScheduler.h"
+
+
+// The base station sketches' settings
+static const uint8_t  maxInFlight  = 3;
+static uint32_t       firstBackoff = 2000;
+static uint32_t       maxBackoff   = 60000;
+static const uint32_t waitMs       = 10000;
+static const uint8_t  totalTries   = 7;
+static const uint8_t  bulkAttempts = 2;
+
+static const int maxStations = 20;
+
+// What the base station asks each station for, in order
+enum stationStep { askReady = 0, askCompact, doneAsking };
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static double randomUnit(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (rngState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+// The network being simulated
+static int      stationCount = 5;
+static double   latencyMs    = 60;
+static int      fragments    = 2;
+static uint32_t statusMs     = 0;
+static double   lossChance   = 0;
+static bool     dead[maxStations];
+
+static int problems = 0;
+
+static void problem(const char* what) {
+    if (problems++ < 5) printf("PROBLEM: %s\n", what);
+}
+
+
+/*
+Works out how a request to a station goes: whether the whole answer makes it back, and how long it takes
+to come in. A dump's fragments each take a little longer.
+*/
+static bool answerArrives(int station, int step, uint32_t* tookMs) {
+    int messages = step == askReady ? 1 : fragments;
+    *tookMs      = static_cast<uint32_t>(latencyMs * (0.8 + 0.4 * randomUnit()));
+    for (int m = 1; m < messages; m++) {
+        *tookMs += static_cast<uint32_t>(latencyMs * 0.3 * (1 + randomUnit()));
+    }
+    if (dead[station]) return false;
+    // The request and every message of the answer have to make it
+    for (int m = 0; m <= messages; m++) {
+        if (randomUnit() < lossChance) return false;
+    }
+    return true;
+}
+
+
+/*
+The old way: each station in turn, each request tried until it is answered or has been tried as many
+times as it's allowed, waiting out the whole timeout each time it isn't answered.
+*/
+static uint32_t collectOneAtATime(int* collected) {
+    uint32_t elapsed = 0;
+    *collected       = 0;
+    for (int s = 0; s < stationCount; s++) {
+        bool answered = true;
+        for (int step = askReady; step < doneAsking && answered; step++) {
+            int tries = step == askReady ? totalTries : bulkAttempts;
+            answered  = false;
+            for (int t = 0; t < tries && !answered; t++) {
+                uint32_t took;
+                answered = answerArrives(s, step, &took);
+                elapsed += answered ? took : waitMs;
+            }
+        }
+        if (answered) (*collected)++;
+    }
+    return elapsed;
+}
+
+
+/*
+The new way, run the way the base station sketches run it: every millisecond, whatever came in is
+handed to the scheduler, the stations that took too long are retried, the stations whose turn has come
+are let go, and the stations that are due are sent their next request.
+*/
+static uint32_t collectWithScheduler(int* collected) {
+    stationSlot      slots[maxStations];
+    StationScheduler scheduler(slots, stationCount, maxInFlight, firstBackoff, maxBackoff);
+    int              step[maxStations];
+    uint32_t         answerAt[maxStations];
+    bool             answerComing[maxStations];
+    bool             statusComing[maxStations];
+    bool             gotData[maxStations];
+    int              lastFinished = -1;
+
+    uint32_t nowMs = 0;
+    scheduler.begin(nowMs);
+    for (int s = 0; s < stationCount; s++) {
+        step[s]         = askReady;
+        answerComing[s] = statusComing[s] = gotData[s] = false;
+    }
+
+    while (!scheduler.allFinished()) {
+        for (int s = 0; s < stationCount; s++) {
+            // An answer (or a report that the request didn't get there) came in
+            if (answerComing[s] && answerAt[s] == nowMs) {
+                answerComing[s] = false;
+                if (scheduler.status(s) != StationScheduler::stationWaiting) {
+                    problem("an answer came from a station that wasn't asked anything");
+                    continue;
+                }
+                if (statusComing[s]) {
+                    statusComing[s] = false;
+                    if (!scheduler.retry(s, nowMs, step[s] == askReady ? totalTries : bulkAttempts)) {
+                        scheduler.hold(s);
+                    }
+                    continue;
+                }
+                scheduler.answered(s, nowMs);
+                if (++step[s] == doneAsking) {
+                    gotData[s] = true;
+                    scheduler.hold(s);
+                }
+            }
+        }
+
+        int8_t s;
+        while ((s = scheduler.nextExpired(nowMs)) >= 0) {
+            answerComing[s] = false;  // Anything still coming is too late now
+            if (!scheduler.retry(s, nowMs, step[s] == askReady ? totalTries : bulkAttempts)) {
+                scheduler.hold(s);  // Give up on this station for this cycle
+            }
+        }
+
+        for (int i = 0; i < stationCount; i++) {
+            if (scheduler.status(i) != StationScheduler::stationHeld || !scheduler.canRelease(i)) continue;
+            if (i <= lastFinished) problem("a station was let go out of order");
+            lastFinished = i;
+            scheduler.finish(i);
+        }
+
+        while ((s = scheduler.nextDue(nowMs)) >= 0) {
+            if (scheduler.inFlight() >= maxInFlight) problem("too many requests were out at once");
+            if (answerComing[s]) problem("a station was asked again with an answer on the way");
+            uint8_t frameId = scheduler.sent(s, nowMs, waitMs);
+            if (frameId == 0) problem("a request was sent with frame ID 0");
+            uint32_t took;
+            if (answerArrives(s, step[s], &took)) {
+                answerComing[s] = true;
+                answerAt[s]     = nowMs + (took > 0 ? took : 1);
+            } else if (dead[s] && statusMs > 0) {
+                answerComing[s] = statusComing[s] = true;
+                answerAt[s]     = nowMs + statusMs;
+            }
+        }
+        if (scheduler.inFlight() > maxInFlight) problem("too many requests were out at once");
+        if (scheduler.allFinished()) break;
+
+        // Skip ahead to the next time anything happens: an answer coming in, or a request coming due
+        // or running out of time
+        uint32_t next = nowMs + 60000;
+        for (int i = 0; i < stationCount; i++) {
+            if (answerComing[i] && answerAt[i] < next) next = answerAt[i];
+            if ((scheduler.status(i) == StationScheduler::stationDue ||
+                 scheduler.status(i) == StationScheduler::stationWaiting) &&
+                slots[i].dueMs < next) {
+                next = slots[i].dueMs;
+            }
+        }
+        nowMs = next > nowMs ? next : nowMs + 1;
+    }
+
+    *collected = 0;
+    for (int s = 0; s < stationCount; s++) {
+        if (gotData[s]) (*collected)++;
+    }
+    return nowMs;
+}
+
+
+static void runCase(int deadCount, double loss, int cycles) {
+    for (int s = 0; s < stationCount; s++) dead[s] = s < deadCount;
+    lossChance = loss;
+
+    double   totalOld = 0, totalNew = 0;
+    uint32_t worstOld = 0, worstNew = 0;
+    long     collectedOld = 0, collectedNew = 0;
+    for (int c = 0; c < cycles; c++) {
+        int      collected;
+        uint32_t took = collectOneAtATime(&collected);
+        totalOld += took;
+        if (took > worstOld) worstOld = took;
+        collectedOld += collected;
+
+        took = collectWithScheduler(&collected);
+        totalNew += took;
+        if (took > worstNew) worstNew = took;
+        collectedNew += collected;
+    }
+    printf("%4d  %4.0f%%  %14.1f / %-7.1f  %14.1f / %-7.1f  %9.1f%%  %9.1f%%\n", deadCount, loss * 100,
+           totalOld / cycles / 1000, worstOld / 1000.0, totalNew / cycles / 1000, worstNew / 1000.0,
+           100.0 * collectedOld / (cycles * stationCount), 100.0 * collectedNew / (cycles * stationCount));
+    // The dead stations were what made collecting take so long, so they mustn't make it any longer
+    if (deadCount > 0 && totalNew > totalOld) problem("dead stations held collecting up longer than before");
+}
+
+
+static void printUsage(void) {
+    printf("usage: scheduler_sim [--stations 5] [--latency 60] [--fragments 2] [--status 0]\n"
+           "                     [--first-backoff 2000] [--max-backoff 60000] [--cycles 200] [--seed 1]\n");
+}
+
+int main(int argc, char* argv[]) {
+    int cycles = 200;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--stations") == 0 && hasValue) {
+            stationCount = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--latency") == 0 && hasValue) {
+            latencyMs = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--fragments") == 0 && hasValue) {
+            fragments = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--status") == 0 && hasValue) {
+            statusMs = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--first-backoff") == 0 && hasValue) {
+            firstBackoff = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--max-backoff") == 0 && hasValue) {
+            maxBackoff = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--cycles") == 0 && hasValue) {
+            cycles = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (stationCount < 1 || stationCount > maxStations || fragments < 1 || cycles < 1) {
+        printUsage();
+        return 1;
+    }
+
+    printf("%d stations, %.0f ms latency, %d fragments per dump, %d cycles for each case\n\n",
+           stationCount, latencyMs, fragments, cycles);
+    printf("dead  loss  one at a time (avg/max s)  scheduler (avg/max s)  collected (one at a time"
+           " / scheduler)\n");
+    static const double losses[] = {0, 0.05, 0.2};
+    for (int deadCount = 0; deadCount <= stationCount; deadCount++) {
+        for (unsigned l = 0; l < sizeof(losses) / sizeof(losses[0]); l++) {
+            runCase(deadCount, losses[l], cycles);
+        }
+    }
+
+    if (problems > 0) {
+        printf("\nFAILED: %d problems\n", problems);
+        return 1;
+    }
+    printf("\nThe scheduler kept to maxInFlight, one request per station, and farthest first throughout,\n"
+           "and dead stations never held collecting up longer than asking one at a time\n");
+    return 0;
+}
@@ -17,10 +17,29 @@ which is likely 9600.
 
 This sketch has not been tested with other boards besides the Mayfly, and you will likely need to make adjustments
 if you are not using the Mayfly.
+
+Copying a whole season of data through the serial monitor at 9600 baud can take hours, so the sketch also
+has a dump mode for the sd_receive program in the utilities folder, which runs on your computer. Instead of
+a character, sd_receive sends "DUMP <baud>", and the sketch switches to that (much faster) baud and answers
+its commands:
+
+  L                 List the files in the root folder, one "name,size,YYYY-MM-DD HH:MM:SS" line each, and
+                    then "END <number of files>"
+  R <offset> <name> Send a file, starting <offset> bytes in, as a series of chunks
+
+Each chunk is a 0xA5 byte, the chunk's offset in the file (4 bytes), the number of bytes in it (2 bytes),
+the bytes themselves, and a CRC-16 (CCITT, 2 bytes) of everything after the 0xA5, all least significant
+byte first. The last chunk has no bytes and the file's size as its offset, and a chunk with no bytes and
+an offset of 0xFFFFFFFF means the file couldn't be opened. Anything sent while a file is going out stops
+it, so sd_receive can ask again from the last good chunk whenever one is lost or garbled. Unplugging the
+Mayfly partway through is fine too: the sketch starts over and sd_receive picks up where it left off.
 */
 
 #include "SdFat.h"
 
+// The CRC-16 shared with the snow sensing stations' radio records
+#include <MeasurementRecord.h>
+
 // SD_FAT_TYPE = 0 for SdFat/File as defined in SdFatConfig.h,
 // 1 for FAT16/FAT32, 2 for exFAT, 3 for FAT16/FAT32 and exFAT.
 #define SD_FAT_TYPE 1
@@ -71,6 +90,13 @@ FsFile file;
 
 char line[300];
 
+// The bytes of a file sent in each dump mode chunk; one SD card sector
+const uint16_t dumpChunkSize = 512;
+// Marks the start of each chunk
+const uint8_t dumpSync = 0xA5;
+// The offset of the chunk sent when a file can't be opened
+const uint32_t dumpNoFile = 0xFFFFFFFF;
+
 //------------------------------------------------------------------------------
 // Store error strings in flash to save RAM.
 #define error(s) sd.errorHalt(&Serial, F(s))
@@ -129,6 +155,112 @@ bool parseLine(char* str) {
   return strtok(nullptr, ",") == nullptr;
 }
 //------------------------------------------------------------------------------
+// Dump mode: answers the commands from sd_receive until the Mayfly is reset.
+void dumpMode(uint32_t baud) {
+  Serial.print(F("OK "));
+  Serial.println(baud);
+  Serial.flush();
+  Serial.begin(baud);
+  if (!sd.begin(SD_CONFIG)) {
+    // Keep answering, so sd_receive finds out rather than waiting
+    while (true) {
+      if (Serial.available()) {
+        Serial.readStringUntil('\n');
+        Serial.println(F("ERR no SD card"));
+      }
+    }
+  }
+  Serial.setTimeout(2000);
+
+  while (true) {
+    if (!Serial.available()) continue;
+    String command = Serial.readStringUntil('\n');
+    command.trim();
+    if (command == "L") {
+      dumpList();
+    } else if (command.startsWith("R ")) {
+      int nameStart = command.indexOf(' ', 2);
+      if (nameStart < 0) {
+        Serial.println(F("ERR"));
+        continue;
+      }
+      uint32_t offset = strtoul(command.c_str() + 2, nullptr, 10);
+      dumpFile(command.c_str() + nameStart + 1, offset);
+    } else if (command.length() > 0 && command != "X") {  // X is only ever sent to stop a file
+      Serial.println(F("ERR"));
+    }
+  }
+}
+
+// Lists the files in the root folder with their sizes and when they were last changed
+void dumpList() {
+  decltype(file) root;  // The same kind of file as SD_FAT_TYPE picked
+  uint16_t count = 0;
+  if (root.open("/")) {
+    decltype(file) entry;
+    while (entry.openNext(&root, O_RDONLY)) {
+      if (!entry.isDir() && !entry.isHidden()) {
+        char name[64];
+        char modified[20] = "0000-00-00 00:00:00";
+        uint16_t date, time;
+        entry.getName(name, sizeof(name));
+        if (entry.getModifyDateTime(&date, &time)) {
+          sprintf(modified, "%04u-%02u-%02u %02u:%02u:%02u", FS_YEAR(date), FS_MONTH(date),
+                  FS_DAY(date), FS_HOUR(time), FS_MINUTE(time), FS_SECOND(time));
+        }
+        Serial.print(name);
+        Serial.print(',');
+        Serial.print(entry.fileSize());
+        Serial.print(',');
+        Serial.println(modified);
+        count++;
+      }
+      entry.close();
+    }
+    root.close();
+  }
+  Serial.print(F("END "));
+  Serial.println(count);
+}
+
+// Sends one chunk: the sync byte, the offset, the length, the bytes, and the CRC of all but the sync byte
+void sendChunk(uint32_t offset, const uint8_t* data, uint16_t length) {
+  uint8_t head[6];
+  for (uint8_t i = 0; i < 4; i++) head[i] = (offset >> (8 * i)) & 0xFF;
+  head[4] = length & 0xFF;
+  head[5] = length >> 8;
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < sizeof(head); i++) crc = crc16Add(crc, head[i]);
+  for (uint16_t i = 0; i < length; i++) crc = crc16Add(crc, data[i]);
+
+  Serial.write(dumpSync);
+  Serial.write(head, sizeof(head));
+  Serial.write(data, length);
+  Serial.write(crc & 0xFF);
+  Serial.write(crc >> 8);
+}
+
+// Sends a file from an offset to its end, or until sd_receive sends something to stop it
+void dumpFile(const char* name, uint32_t offset) {
+  uint8_t chunk[dumpChunkSize];
+  // Open the file read-only so dumping it never changes it or its dates
+  if (!file.open(name, O_RDONLY) || !file.seekSet(offset)) {
+    file.close();
+    sendChunk(dumpNoFile, chunk, 0);
+    return;
+  }
+  while (!Serial.available()) {
+    int length = file.read(chunk, sizeof(chunk));
+    if (length <= 0) {
+      sendChunk(file.fileSize(), chunk, 0);  // The end of the file
+      break;
+    }
+    sendChunk(offset, chunk, length);
+    offset += length;
+  }
+  file.close();
+}
+//------------------------------------------------------------------------------
 void setup() {
   Serial.begin(9600);
 
@@ -140,7 +272,12 @@ void setup() {
   while (!Serial.available()) {
     yield();
   }
-  Serial.read();
+  // sd_receive starts dump mode instead, with the baud it wants
+  String start = Serial.readStringUntil('\n');
+  if (start.startsWith("DUMP")) {
+    uint32_t baud = start.substring(4).toInt();
+    dumpMode(baud > 0 ? baud : 9600);
+  }
   // Initialize the SD.
   if (!sd.begin(SD_CONFIG)) {
     sd.initErrorHalt(&Serial);
@@ -0,0 +1,501 @@
+/*
+This program runs on your computer, not on the Mayfly. It copies files off a Mayfly's microSD card
+over the USB cable, using the dump mode of the sd_readfile sketch, which needs to be uploaded to the
+Mayfly first. It is much faster than copying a file out of the serial monitor: the files are sent in
+raw 512-byte chunks at 250000 baud (a baud the Mayfly's 8 MHz clock can make exactly) instead of as
+text at 9600, so a season of data takes minutes instead of hours.
+
+Every chunk carries its place in the file and a CRC, so a garbled or lost chunk is simply asked for
+again. If the cable is unplugged (or the Mayfly resets) partway through, this waits for it to come
+back and carries on from the last good chunk. Running it again later also picks up where a file left
+off, so a file that has grown since it was last copied only has its new part sent.
+
+Build it from this folder (Linux or macOS; on Windows, use WSL):
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o sd_receive sd_receive.cpp \
+      ../../arduino_libraries/SnowRadio/src/MeasurementRecord.cpp
+
+and run it with the Mayfly's serial port (the one the Arduino IDE uses):
+
+  sd_receive /dev/ttyUSB0                  Lists the files on the card, with sizes and dates
+  sd_receive /dev/ttyUSB0 file1.csv ...    Copies the named files
+  sd_receive --all /dev/ttyUSB0            Copies every file on the card
+
+Options: --dir <folder> puts the copies in that folder instead of the current one, and --baud <baud>
+picks a different dump mode baud (500000 and 1000000 are also exact on the Mayfly, but not every USB
+adapter or cable keeps up). Each copy is given the date the file was last changed on the card.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+// termios2 takes any baud, where the usual termios only takes a fixed list
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#else
+#include <sys/ioctl.h>
+#include <termios.h>
+#if defined(__APPLE__)
+#include <IOKit/serial/ioss.h>
+#endif
+#endif
+
+#include "MeasurementRecord.h"
+
+
+// Has to match sd_readfile.ino
+#define DUMP_SYNC 0xA5
+#define DUMP_CHUNK_SIZE 512
+#define DUMP_NO_FILE 0xFFFFFFFFUL
+
+// How long to wait for the Mayfly to restart after the port is opened
+#define RESET_WAIT_MS 2500
+// How long a chunk can take to arrive before it is asked for again
+#define CHUNK_TIMEOUT_MS 2000
+// How many times in a row a chunk can be asked for before reconnecting
+#define CHUNK_RETRIES 10
+// How many times to try reconnecting before giving up
+#define CONNECT_RETRIES 30
+
+
+struct CardFile {
+    std::string name;
+    uint32_t    size;
+    std::string modified;  // "YYYY-MM-DD HH:MM:SS"
+};
+
+
+static int      port = -1;
+static uint32_t dumpBaud = 250000;
+
+
+static uint64_t nowMs(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<uint64_t>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+
+// Sets the port to raw 8N1 at a baud
+static bool setBaud(uint32_t baud) {
+#if defined(__linux__)
+    struct termios2 tio;
+    if (ioctl(port, TCGETS2, &tio) != 0) return false;
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_lflag = 0;
+    tio.c_cflag = CS8 | CREAD | CLOCAL | BOTHER;
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+    return ioctl(port, TCSETS2, &tio) == 0;
+#else
+    struct termios tio;
+    if (tcgetattr(port, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    tio.c_cflag |= CREAD | CLOCAL;
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+#if defined(__APPLE__)
+    cfsetspeed(&tio, B9600);
+    if (tcsetattr(port, TCSANOW, &tio) != 0) return false;
+    speed_t speed = baud;
+    return ioctl(port, IOSSIOSPEED, &speed) == 0;
+#else
+    if (baud != 9600) return false;
+    cfsetspeed(&tio, B9600);
+    return tcsetattr(port, TCSANOW, &tio) == 0;
+#endif
+#endif
+}
+
+
+// Reads up to length bytes, waiting at most timeoutMs for the first of them.
+// Returns the number read, 0 on a timeout, or -1 if the port has gone away.
+static int readSome(uint8_t* data, int length, int timeoutMs) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(port, &readable);
+    struct timeval tv;
+    tv.tv_sec  = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    int ready  = select(port + 1, &readable, NULL, NULL, &tv);
+    if (ready < 0) return errno == EINTR ? 0 : -1;
+    if (ready == 0) return 0;
+    int got = read(port, data, length);
+    // A port that is ready but has nothing to read has been unplugged
+    if (got <= 0) return -1;
+    return got;
+}
+
+// Reads exactly length bytes, unless timeoutMs passes first
+static int readAll(uint8_t* data, int length, int timeoutMs) {
+    uint64_t deadline = nowMs() + timeoutMs;
+    int      have     = 0;
+    while (have < length) {
+        uint64_t now = nowMs();
+        if (now >= deadline) return have;
+        int got = readSome(data + have, length - have,
+                           static_cast<int>(deadline - now));
+        if (got < 0) return -1;
+        have += got;
+    }
+    return have;
+}
+
+// Reads a line of text, without its line ending
+static int readLine(std::string& line, int timeoutMs) {
+    line.clear();
+    uint64_t deadline = nowMs() + timeoutMs;
+    uint64_t now;
+    while ((now = nowMs()) < deadline) {
+        uint8_t c;
+        int     got = readSome(&c, 1, static_cast<int>(deadline - now));
+        if (got < 0) return -1;
+        if (got == 0) continue;
+        if (c == '\n') return 1;
+        if (c != '\r') line += static_cast<char>(c);
+    }
+    return 0;
+}
+
+static bool sendText(const std::string& text) {
+    return write(port, text.data(), text.size()) ==
+        static_cast<ssize_t>(text.size());
+}
+
+// Throws away anything that arrives until the port has been quiet a while
+static bool drain(int quietMs) {
+    uint8_t junk[256];
+    int     got;
+    while ((got = readSome(junk, sizeof(junk), quietMs)) > 0) {}
+    return got == 0;
+}
+
+
+static void disconnect(void) {
+    if (port >= 0) close(port);
+    port = -1;
+}
+
+// Opens the port, lets the Mayfly restart, and starts its dump mode
+static bool connect(const char* portName) {
+    disconnect();
+    port = open(portName, O_RDWR | O_NOCTTY);
+    if (port < 0) return false;
+    if (!setBaud(9600)) {
+        disconnect();
+        return false;
+    }
+    // Opening the port restarts the Mayfly, which then waits for a character
+    usleep(RESET_WAIT_MS * 1000);
+    drain(100);
+    char start[32];
+    snprintf(start, sizeof(start), "DUMP %lu\n",
+             static_cast<unsigned long>(dumpBaud));
+    if (!sendText(start)) {
+        disconnect();
+        return false;
+    }
+    std::string line;
+    uint64_t    deadline = nowMs() + 3000;
+    while (nowMs() < deadline) {
+        if (readLine(line, 3000) < 0) break;
+        if (line.compare(0, 3, "OK ") == 0) {
+            // Give the Mayfly a moment to switch before following it
+            usleep(50000);
+            if (!setBaud(dumpBaud)) {
+                fprintf(stderr, "This computer can't set %s to %lu baud\n",
+                        portName, static_cast<unsigned long>(dumpBaud));
+                disconnect();
+                return false;
+            }
+            drain(100);
+            return true;
+        }
+    }
+    disconnect();
+    return false;
+}
+
+// Keeps trying to connect until it works or it is time to give up
+static bool reconnect(const char* portName) {
+    for (int attempt = 0; attempt < CONNECT_RETRIES; attempt++) {
+        if (attempt > 0) {
+            fprintf(stderr, "Waiting for the Mayfly on %s...\n", portName);
+            sleep(2);
+        }
+        if (connect(portName)) return true;
+    }
+    fprintf(stderr, "Couldn't start dump mode on %s.  Is sd_readfile uploaded "
+                    "to the Mayfly?\n", portName);
+    return false;
+}
+
+
+// Asks for the list of files; false if it didn't come back whole
+static bool listFiles(std::vector<CardFile>& files) {
+    files.clear();
+    if (!sendText("L\n")) return false;
+    std::string line;
+    while (readLine(line, CHUNK_TIMEOUT_MS) > 0) {
+        if (line.compare(0, 4, "END ") == 0) {
+            return strtoul(line.c_str() + 4, NULL, 10) == files.size();
+        }
+        if (line.compare(0, 3, "ERR") == 0) {
+            fprintf(stderr, "The Mayfly says: %s\n", line.c_str());
+            return false;
+        }
+        // name,size,date; the name is everything before the last two commas
+        size_t dateComma = line.rfind(',');
+        if (dateComma == std::string::npos || dateComma == 0) return false;
+        size_t sizeComma = line.rfind(',', dateComma - 1);
+        if (sizeComma == std::string::npos) return false;
+        CardFile file;
+        file.name     = line.substr(0, sizeComma);
+        file.size     = strtoul(line.c_str() + sizeComma + 1, NULL, 10);
+        file.modified = line.substr(dateComma + 1);
+        files.push_back(file);
+    }
+    return false;
+}
+
+
+// Gives a copy the card's date for the file, read as local time
+static void setModified(const std::string& path, const std::string& modified) {
+    struct tm when;
+    memset(&when, 0, sizeof(when));
+    if (sscanf(modified.c_str(), "%d-%d-%d %d:%d:%d", &when.tm_year,
+               &when.tm_mon, &when.tm_mday, &when.tm_hour, &when.tm_min,
+               &when.tm_sec) != 6 ||
+        when.tm_year < 1980) {
+        return;
+    }
+    when.tm_year -= 1900;
+    when.tm_mon -= 1;
+    when.tm_isdst = -1;
+    struct utimbuf times;
+    times.actime  = mktime(&when);
+    times.modtime = times.actime;
+    utime(path.c_str(), &times);
+}
+
+
+// The result of asking for a file
+enum FetchResult { FETCH_DONE, FETCH_RETRY, FETCH_RECONNECT, FETCH_FAILED };
+
+// Asks for a file from where the copy leaves off and adds each good chunk to
+// it, until the end of the file or something goes wrong
+static FetchResult fetchFrom(const CardFile& file, FILE* copy,
+                             uint32_t& offset) {
+    char request[300];
+    snprintf(request, sizeof(request), "R %lu %s\n",
+             static_cast<unsigned long>(offset), file.name.c_str());
+    if (!sendText(request)) return FETCH_RECONNECT;
+
+    uint8_t  chunk[6 + DUMP_CHUNK_SIZE + 2];
+    uint64_t lastReport = 0;
+    while (true) {
+        // Find the start of the next chunk
+        uint8_t sync = 0;
+        int     got;
+        do {
+            got = readSome(&sync, 1, CHUNK_TIMEOUT_MS);
+        } while (got > 0 && sync != DUMP_SYNC);
+        if (got < 0) return FETCH_RECONNECT;
+        if (got == 0) return FETCH_RETRY;
+
+        got = readAll(chunk, 6, CHUNK_TIMEOUT_MS);
+        if (got < 0) return FETCH_RECONNECT;
+        if (got < 6) return FETCH_RETRY;
+        uint32_t chunkOffset = 0;
+        for (int i = 0; i < 4; i++) {
+            chunkOffset |= static_cast<uint32_t>(chunk[i]) << (8 * i);
+        }
+        uint16_t length = chunk[4] | (chunk[5] << 8);
+        if (length > DUMP_CHUNK_SIZE) return FETCH_RETRY;
+        got = readAll(chunk + 6, length + 2, CHUNK_TIMEOUT_MS);
+        if (got < 0) return FETCH_RECONNECT;
+        if (got < length + 2) return FETCH_RETRY;
+
+        uint16_t crc = 0xFFFF;
+        for (int i = 0; i < 6 + length; i++) crc = crc16Add(crc, chunk[i]);
+        if (crc != (chunk[6 + length] | (chunk[7 + length] << 8))) {
+            return FETCH_RETRY;
+        }
+
+        if (length == 0) {
+            if (chunkOffset == DUMP_NO_FILE) return FETCH_FAILED;
+            // The end of the file; it has all arrived if this is where it is
+            return chunkOffset == offset ? FETCH_DONE : FETCH_RETRY;
+        }
+        if (chunkOffset != offset) return FETCH_RETRY;
+        if (fwrite(chunk + 6, 1, length, copy) != length ||
+            fflush(copy) != 0) {
+            return FETCH_FAILED;
+        }
+        offset += length;
+
+        if (nowMs() - lastReport > 500) {
+            lastReport = nowMs();
+            fprintf(stderr, "\r%s: %lu of %lu bytes", file.name.c_str(),
+                    static_cast<unsigned long>(offset),
+                    static_cast<unsigned long>(file.size));
+        }
+    }
+}
+
+// Copies a file off the card, carrying on from whatever is already copied
+static bool fetchFile(const char* portName, const CardFile& file,
+                      const std::string& folder) {
+    std::string path = folder + "/" + file.name;
+    struct stat info;
+    uint32_t    offset = 0;
+    if (stat(path.c_str(), &info) == 0) {
+        offset = static_cast<uint32_t>(info.st_size);
+        // A copy bigger than the file is of some other file; start over
+        if (offset > file.size) offset = 0;
+    }
+    FILE* copy = fopen(path.c_str(), offset > 0 ? "r+b" : "wb");
+    if (copy == NULL || fseek(copy, offset, SEEK_SET) != 0) {
+        fprintf(stderr, "Can't write %s\n", path.c_str());
+        if (copy != NULL) fclose(copy);
+        return false;
+    }
+    if (offset > 0) {
+        fprintf(stderr, "%s: carrying on from %lu bytes\n", file.name.c_str(),
+                static_cast<unsigned long>(offset));
+    }
+
+    uint64_t    started = nowMs();
+    uint32_t    first   = offset;
+    int         retries = 0;
+    FetchResult result;
+    while ((result = fetchFrom(file, copy, offset)) != FETCH_DONE) {
+        if (result == FETCH_FAILED) break;
+        if (result == FETCH_RETRY && ++retries <= CHUNK_RETRIES) {
+            // Stop the file and ask again from the last good chunk
+            if (sendText("X\n") && drain(200)) continue;
+        }
+        fprintf(stderr, "\nLost the connection; reconnecting\n");
+        if (!reconnect(portName)) break;
+        retries = 0;
+    }
+    fclose(copy);
+    fprintf(stderr, "\r%s: %lu of %lu bytes", file.name.c_str(),
+            static_cast<unsigned long>(offset),
+            static_cast<unsigned long>(file.size));
+    if (result != FETCH_DONE) {
+        fprintf(stderr, " - failed\n");
+        return false;
+    }
+
+    // Cut off anything left from an older, longer copy
+    if (truncate(path.c_str(), offset) != 0) return false;
+    setModified(path, file.modified);
+    double seconds = (nowMs() - started) / 1000.0;
+    fprintf(stderr, " - done in %.1f s", seconds);
+    if (seconds > 0) {
+        fprintf(stderr, " (%.0f bytes/s)", (offset - first) / seconds);
+    }
+    fputc('\n', stderr);
+    return true;
+}
+
+
+static void printUsage(void) {
+    fprintf(stderr,
+            "Usage: sd_receive [--baud <baud>] [--dir <folder>] [--all] "
+            "<port> [file ...]\n");
+}
+
+
+int main(int argc, char* argv[]) {
+    const char*              portName = NULL;
+    std::string              folder   = ".";
+    bool                     all      = false;
+    std::vector<std::string> wanted;
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--baud") == 0 && a + 1 < argc) {
+            dumpBaud = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--dir") == 0 && a + 1 < argc) {
+            folder = argv[++a];
+        } else if (strcmp(argv[a], "--all") == 0) {
+            all = true;
+        } else if (argv[a][0] == '-') {
+            printUsage();
+            return 1;
+        } else if (portName == NULL) {
+            portName = argv[a];
+        } else {
+            wanted.push_back(argv[a]);
+        }
+    }
+    if (portName == NULL || dumpBaud == 0) {
+        printUsage();
+        return 1;
+    }
+
+    if (!reconnect(portName)) return 1;
+    std::vector<CardFile> files;
+    bool                  listed = false;
+    for (int attempt = 0; attempt < CHUNK_RETRIES && !listed; attempt++) {
+        listed = listFiles(files);
+        if (!listed) {
+            sendText("X\n");
+            drain(200);
+        }
+    }
+    if (!listed) {
+        fprintf(stderr, "Couldn't get the list of files\n");
+        disconnect();
+        return 1;
+    }
+
+    if (!all && wanted.empty()) {
+        for (size_t f = 0; f < files.size(); f++) {
+            printf("%-40s %10lu  %s\n", files[f].name.c_str(),
+                   static_cast<unsigned long>(files[f].size),
+                   files[f].modified.c_str());
+        }
+        disconnect();
+        return 0;
+    }
+
+    int failed = 0;
+    for (size_t w = 0; w < wanted.size(); w++) {
+        bool found = false;
+        for (size_t f = 0; f < files.size(); f++) {
+            found = found || files[f].name == wanted[w];
+        }
+        if (!found) {
+            fprintf(stderr, "%s isn't on the card\n", wanted[w].c_str());
+            failed++;
+        }
+    }
+    for (size_t f = 0; f < files.size(); f++) {
+        bool fetch = all;
+        for (size_t w = 0; w < wanted.size(); w++) {
+            fetch = fetch || files[f].name == wanted[w];
+        }
+        if (fetch && !fetchFile(portName, files[f], folder)) failed++;
+    }
+    disconnect();
+    return failed == 0 ? 0 : 1;
+}
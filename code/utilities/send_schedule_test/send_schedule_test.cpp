@@ -0,0 +1,557 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests how the ModularSensors Logger decides
+when to wake the modem: each interval logDataAndPublish() hands the values to the data publishers, and
+only wakes the modem when one of them is due to send by its sendEveryX and sendOffset, when one has no
+room left to hold another interval, or for the daily clock sync at noon.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -std=c++17 -O2 -D ARDUINO=10819 -I ../host_arduino \
+      -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -I ../../arduino_libraries/EnviroDIY_DS3231/src \
+      -include WatchDogs/WatchDogAVR.h -o send_schedule_test send_schedule_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LoggerBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LogSession.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LoggerModem.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/dataPublisherBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableArray.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/SensorBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/ResultReducer.cpp \
+      ../../arduino_libraries/EnviroDIY_DS3231/src/Sodaq_DS3231.cpp
+
+and run it:
+
+  send_schedule_test [--trials 2000] [--seed 1]
+
+The real Logger is woken at each logging interval by a stand-in DS3231 clock, with a stand-in modem and
+stand-in publishers. A publisher holds up to a set number of intervals and sends them all, one line each,
+through a stand-in server reached through the Client it is handed. A publisher that holds nothing sends
+each interval as it comes.
+
+First it prints the modem sessions per day and the intervals sent in each, for the lte_hydroserver
+sketch's 3-minute interval and several sendEveryX.
+
+Then each trial runs a day with a random logging interval and up to three publishers, each with a random
+sendEveryX, sendOffset and room, and sometimes one that holds nothing. The modem sometimes can't connect
+and the server sometimes turns a request away. Every interval the test works out on its own whether each
+publisher is due, and the modem has to be woken exactly when one is or it's noon. At the end of the day,
+every interval has to have reached the server exactly once and in order, except the ones a publisher had
+to drop when it had no room left. When nothing fails, none may wait more than sendEveryX intervals.
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "LoggerBase.h"
+#include "LoggerModem.h"
+#include "dataPublisherBase.h"
+#include "HostDS3231.h"
+
+
+// The sleep code isn't built here, so neither is the watchdog
+extendedWatchDogAVR::extendedWatchDogAVR() {}
+extendedWatchDogAVR::~extendedWatchDogAVR() {}
+void extendedWatchDogAVR::setupWatchDog(uint32_t) {}
+void extendedWatchDogAVR::enableWatchDog() {}
+void extendedWatchDogAVR::disableWatchDog() {}
+void extendedWatchDogAVR::resetWatchDog() {}
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+static bool chance(double odds) {
+    return randomNumber(1000000) < odds * 1000000;
+}
+
+
+static long problems = 0;
+
+static void problem(const char* what, long trial) {
+    if (problems++ < 10) printf("PROBLEM: %s (trial %ld)\n", what, trial);
+}
+
+
+static const uint32_t startEpoch = 1735689600UL;  // 2025-01-01 00:00, with the clock and logger in UTC
+
+// The logging interval being run, counting from startEpoch, and its time
+static long     intervalNumber;
+static uint32_t intervalEpoch;
+
+
+// A sensor with one result that's always there
+class FakeSensor : public Sensor {
+ public:
+    FakeSensor() : Sensor("FakeSensor", 1, 0, 0, 0, -1, -1, 1) {}
+
+    bool addSingleMeasurementResult(void) override {
+        verifyAndAddMeasurementResult(0, 12.5f);
+        // Unset the measurement request bits, as the real sensors do
+        _sensorStatus &= 0b10011111;
+        return true;
+    }
+
+    // Nothing to wait for
+    bool isWarmedUp(bool) override {
+        return true;
+    }
+    bool isStable(bool) override {
+        return true;
+    }
+    bool isMeasurementComplete(bool) override {
+        return true;
+    }
+};
+
+
+// A modem that's awake and connected at once, unless it can't find the network
+class StandInModem : public loggerModem {
+ public:
+    StandInModem() : loggerModem(-1, -1, HIGH, -1, LOW, 0, -1, HIGH, 0, 0, 0, 0, 0) {}
+
+    double failChance = 0;  // The chance it can't connect
+
+    // What happened
+    long wakes = 0, connects = 0, clockSyncs = 0;
+    bool connected = false;
+
+    bool modemWake(void) override {
+        wakes++;
+        return true;
+    }
+    bool connectInternet(uint32_t) override {
+        if (chance(failChance)) return false;
+        connects++;
+        connected = true;
+        return true;
+    }
+    void disconnectInternet(void) override {
+        connected = false;
+    }
+    // The clock is right already, so setting it changes nothing
+    uint32_t getNISTTime(void) override {
+        clockSyncs++;
+        return intervalEpoch;
+    }
+    bool getModemSignalQuality(int16_t& rssi, int16_t& percent) override {
+        rssi    = -70;
+        percent = 60;
+        return true;
+    }
+    bool getModemBatteryStats(uint8_t& chargeState, int8_t& percent, uint16_t& milliVolts) override {
+        chargeState = 0;
+        percent     = 90;
+        milliVolts  = 4000;
+        return true;
+    }
+    float getModemChipTemperature(void) override {
+        return 25;
+    }
+
+ protected:
+    bool isInternetAvailable(void) override {
+        return connected;
+    }
+    bool modemSleepFxn(void) override {
+        return true;
+    }
+    bool modemWakeFxn(void) override {
+        return true;
+    }
+    bool extraModemSetup(void) override {
+        return true;
+    }
+    bool isModemAwake(void) override {
+        return true;
+    }
+};
+
+
+/*
+A stand-in server, reached through the Client a publisher is handed. It takes one interval number per
+line, and answers '1' once it has kept them or '0' when it turns the request away.
+*/
+class StandInServer : public Client {
+ public:
+    double failChance = 0;  // The chance a request is turned away
+
+    // The intervals kept, in the order they came, and the interval each came in
+    std::vector<long> received, receivedAt;
+    long              connects = 0, requests = 0, accepted = 0;
+
+    int connect(IPAddress, uint16_t) override {
+        return 0;
+    }
+    int connect(const char*, uint16_t) override {
+        connects++;
+        _open = true;
+        _line.clear();
+        _lines.clear();
+        _answer = -1;
+        return 1;
+    }
+    size_t write(uint8_t c) override {
+        if (!_open) return 0;
+        if (c == '\r') return 1;
+        if (c != '\n') {
+            _line += static_cast<char>(c);
+            return 1;
+        }
+        if (_line.empty()) {
+            // A blank line ends the request
+            requests++;
+            bool accepted = !chance(failChance);
+            if (accepted) {
+                this->accepted++;
+                for (long i : _lines) {
+                    received.push_back(i);
+                    receivedAt.push_back(intervalNumber);
+                }
+            }
+            _lines.clear();
+            _answer = accepted ? '1' : '0';
+        } else {
+            _lines.push_back(atol(_line.c_str()));
+            _line.clear();
+        }
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t length) override {
+        for (size_t i = 0; i < length; i++) write(data[i]);
+        return length;
+    }
+    int available(void) override {
+        return _answer >= 0 ? 1 : 0;
+    }
+    int read(void) override {
+        int c   = _answer;
+        _answer = -1;
+        return c;
+    }
+    int read(uint8_t* data, size_t length) override {
+        if (length == 0 || _answer < 0) return 0;
+        data[0] = read();
+        return 1;
+    }
+    int peek(void) override {
+        return _answer;
+    }
+    void flush(void) override {}
+    void stop(void) override {
+        _open = false;
+    }
+    uint8_t connected(void) override {
+        return _open;
+    }
+    operator bool(void) override {
+        return _open;
+    }
+
+ private:
+    bool              _open   = false;
+    int               _answer = -1;
+    std::string       _line;
+    std::vector<long> _lines;
+};
+
+
+// Holds up to room intervals, or none, and sends everything it holds in one request
+class StandInPublisher : public dataPublisher {
+ public:
+    StandInPublisher(Logger& logger, Client* client, uint8_t sendEveryX, uint8_t sendOffset, uint8_t room)
+        : dataPublisher(logger, client, sendEveryX, sendOffset), _room(room) {}
+
+    long dropped = 0;
+
+    String getEndpoint(void) override {
+        return String("standin.example.org");
+    }
+
+    void cacheData(void) override {
+        if (_room == 0) return;
+        // With no room left, the oldest interval goes
+        if (_held.size() == _room) {
+            _held.erase(_held.begin());
+            dropped++;
+        }
+        _held.push_back(intervalNumber);
+    }
+    uint8_t cacheRoom(void) override {
+        return _room - _held.size();
+    }
+
+    using dataPublisher::publishData;
+    int16_t publishData(Client* client) override {
+        // One that holds nothing sends just this interval
+        std::vector<long> sending = _room == 0 ? std::vector<long>{intervalNumber} : _held;
+        if (!client->connect("standin.example.org", 80)) return -1;
+        for (long i : sending) client->println(i);
+        client->println();
+        int answer = client->read();
+        client->stop();
+        if (answer != '1') return 503;
+        _held.clear();
+        return 201;
+    }
+
+ private:
+    uint8_t           _room;
+    std::vector<long> _held;
+};
+
+
+// What the test expects of each publisher, worked out without the library
+struct Expected {
+    uint8_t sendEveryX, sendOffset, room;
+    long    held = 0;
+    std::vector<bool> dropped;
+};
+
+// Whether a publisher is due this interval, counting the interval about to be added
+static bool expectDue(const Expected& e, long interval, uint16_t loggingInterval) {
+    if (e.sendEveryX <= 1 || e.room == 0 || e.room - e.held <= 1) return true;
+    long number = (startEpoch + interval * loggingInterval * 60L) / (loggingInterval * 60L);
+    return number % e.sendEveryX == e.sendOffset % e.sendEveryX;
+}
+
+
+static FakeSensor    sensor;
+static Variable      variable(&sensor, 0, 1, "name", "unit", "Code", "");
+static Variable*     variableList[] = {&variable};
+static VariableArray array(1, variableList);
+static HostDS3231    clock3231;
+
+struct DayResult {
+    long sessions  = 0;
+    long intervals = 0;
+    long requests  = 0;
+    long sent      = 0;
+};
+
+/*
+Runs a day of logDataAndPublish() with the publishers described, checking every interval that the modem
+is woken exactly when it should be, and afterwards that every interval got to the server once
+*/
+static DayResult runDay(uint16_t loggingInterval, std::vector<Expected>& expected, double modemFails,
+                        double serverFails, long trial) {
+    Logger logger("test", loggingInterval, 12, -1, &array);
+    logger.setSamplingFeatureUUID("");
+    StandInModem modem;
+    modem.failChance = modemFails;
+    logger.attachModem(modem);
+
+    size_t                                         count = expected.size();
+    std::vector<std::unique_ptr<StandInServer>>    servers;
+    std::vector<std::unique_ptr<StandInPublisher>> publishers;
+    for (Expected& e : expected) {
+        servers.emplace_back(new StandInServer());
+        servers.back()->failChance = serverFails;
+        publishers.emplace_back(
+            new StandInPublisher(logger, servers.back().get(), e.sendEveryX, e.sendOffset, e.room));
+        e.held = 0;
+        e.dropped.clear();
+    }
+
+    DayResult result;
+    long      intervals = 24L * 60 / loggingInterval;
+    long      syncs     = 0;
+    for (intervalNumber = 0; intervalNumber < intervals; intervalNumber++) {
+        uint32_t now  = startEpoch + intervalNumber * loggingInterval * 60UL;
+        intervalEpoch = now;
+        clock3231.setEpoch(now);
+
+        bool noon = now % 86400 == 43200;
+        bool due  = noon;
+        for (Expected& e : expected) due |= expectDue(e, intervalNumber, loggingInterval);
+
+        long wakes    = modem.wakes;
+        long connects = modem.connects;
+        std::vector<long> requests(count), accepted(count);
+        for (size_t p = 0; p < count; p++) {
+            requests[p] = servers[p]->requests;
+            accepted[p] = servers[p]->accepted;
+        }
+        logger.logDataAndPublish();
+        if (Logger::markedLocalEpochTime != now) problem("the logger didn't log on the interval", trial);
+
+        bool woke = modem.wakes != wakes;
+        if (woke != due) {
+            if (problems < 10) {
+                printf("  interval %ld at %02lu:%02lu, the modem %s\n", intervalNumber,
+                       static_cast<unsigned long>(now % 86400 / 3600),
+                       static_cast<unsigned long>(now % 3600 / 60),
+                       woke ? "was woken when nothing was due" : "wasn't woken when it was due");
+            }
+            problem("the modem was woken on the wrong interval", trial);
+        }
+        result.sessions += woke;
+
+        // What each publisher should be holding now
+        bool online = modem.connects != connects;
+        if (noon && online) syncs++;
+        for (size_t p = 0; p < count; p++) {
+            Expected& e = expected[p];
+            e.dropped.push_back(false);
+            if (e.room > 0 && e.held == e.room) {
+                // The oldest interval held is dropped
+                e.dropped[intervalNumber - e.held] = true;
+                e.held--;
+            }
+            e.held++;
+            bool sent = servers[p]->requests != requests[p];
+            if (sent != online) problem("a publisher didn't send while the modem was online", trial);
+            // A request that was turned away leaves the intervals held, except by one that holds nothing
+            if (servers[p]->accepted != accepted[p]) {
+                e.held = 0;
+            } else if (e.room == 0) {
+                e.dropped[intervalNumber] = true;
+                e.held                    = 0;
+            }
+        }
+    }
+    if (modem.connected) problem("the modem was left connected", trial);
+    if (modem.clockSyncs != syncs) problem("the clock wasn't synced at noon", trial);
+
+    // Everything still held goes out while nothing fails
+    for (size_t p = 0; p < count; p++) {
+        servers[p]->failChance = 0;
+        if (expected[p].held > 0) publishers[p]->publishData();
+    }
+
+    for (size_t p = 0; p < count; p++) {
+        const Expected&      e      = expected[p];
+        const StandInServer& server = *servers[p];
+        long                 next   = 0;
+        for (size_t r = 0; r < server.received.size(); r++) {
+            long i = server.received[r];
+            while (next < intervals && e.dropped[next]) next++;
+            if (i != next) {
+                if (problems < 10) {
+                    printf("  publisher %zu: interval %ld came when %ld should have\n", p, i, next);
+                }
+                problem("the intervals didn't get to the server once each, in order", trial);
+                break;
+            }
+            next++;
+            // Without failures, nothing waits longer than its publisher's schedule allows, except what
+            // was still held at the end of the day
+            long waited = server.receivedAt[r] - i;
+            if (modemFails == 0 && serverFails == 0 && server.receivedAt[r] < intervals &&
+                waited >= (e.sendEveryX > 1 ? e.sendEveryX : 1)) {
+                problem("an interval waited longer than sendEveryX to be sent", trial);
+            }
+        }
+        while (next < intervals && e.dropped[next]) next++;
+        if (next != intervals) problem("some intervals never got to the server", trial);
+
+        long droppedCount = 0;
+        for (bool d : e.dropped) droppedCount += d;
+        if (e.room > 0 && publishers[p]->dropped != droppedCount) {
+            problem("the publisher dropped different intervals", trial);
+        }
+        if (droppedCount > 0 && modemFails == 0 && serverFails == 0) {
+            problem("an interval was dropped while nothing failed", trial);
+        }
+        result.sent += server.received.size();
+        result.requests += server.accepted;
+    }
+    result.intervals = intervals;
+    return result;
+}
+
+
+// Sessions per day for the lte_hydroserver sketch's 3-minute interval
+static void compareSchedules(void) {
+    printf("Every 3 minutes, for a day:                modem sessions  intervals per request\n");
+    static const uint8_t everys[] = {1, 2, 5, 10, 20};
+    for (uint8_t every : everys) {
+        std::vector<Expected> one = {{every, 0, 20, 0, {}}};
+        DayResult             day = runDay(3, one, 0, 0, 0);
+        printf("  sendEveryX %2d, room for 20                %6ld %15.1f\n", every, day.sessions,
+               double(day.sent) / day.requests);
+    }
+    std::vector<Expected> roomy = {{10, 0, 5, 0, {}}};
+    DayResult             day   = runDay(3, roomy, 0, 0, 0);
+    printf("  sendEveryX 10, room for 5                 %6ld %15.1f\n", day.sessions,
+           double(day.sent) / day.requests);
+    std::vector<Expected> apart = {{5, 0, 20, 0, {}}, {5, 2, 20, 0, {}}};
+    day                         = runDay(3, apart, 0, 0, 0);
+    printf("  two with sendEveryX 5, offsets 0 and 2    %6ld %15.1f\n", day.sessions,
+           double(day.sent) / day.requests);
+    std::vector<Expected> alongside = {{5, 0, 20, 0, {}}, {1, 0, 0, 0, {}}};
+    day                             = runDay(3, alongside, 0, 0, 0);
+    printf("  sendEveryX 5, and one that holds nothing  %6ld %15.1f\n\n", day.sessions,
+           double(day.sent) / day.requests);
+}
+
+
+static void testSchedules(long trials) {
+    static const uint16_t loggingIntervals[] = {1, 2, 3, 5, 10, 15, 30, 60};
+    long                  sessions = 0, intervals = 0;
+    for (long trial = 1; trial <= trials; trial++) {
+        uint16_t              loggingInterval = loggingIntervals[randomNumber(8)];
+        std::vector<Expected> expected;
+        int                   count = 1 + randomNumber(3);
+        for (int p = 0; p < count; p++) {
+            Expected e;
+            e.sendEveryX = randomNumber(13);
+            e.sendOffset = randomNumber(16);
+            e.room       = randomNumber(5) == 0 ? 0 : 1 + randomNumber(20);
+            expected.push_back(e);
+        }
+        double fails      = randomNumber(3) == 0 ? 0 : 0.3 * randomNumber(3);
+        double modemFails = randomNumber(2) ? fails : 0;
+        DayResult day     = runDay(loggingInterval, expected, modemFails, fails, trial);
+        sessions += day.sessions;
+        intervals += day.intervals;
+    }
+    printf("%ld trials, the modem woken for %ld of %ld intervals\n", trials, sessions, intervals);
+}
+
+
+int main(int argc, char* argv[]) {
+    long trials = 2000;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--trials") == 0 && hasValue) {
+            trials = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: send_schedule_test [--trials 2000] [--seed 1]\n");
+            return 1;
+        }
+    }
+
+    // The records aren't what's tested here, so there's no SD card to write them to
+    hostSdCard.present = false;
+    Wire.devices[HostDS3231::address] = &clock3231;
+    Logger::setLoggerTimeZone(0);
+    Logger::setRTCTimeZone(0);
+    array.setupSensors();
+
+    compareSchedules();
+    testSchedules(trials);
+
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("The modem was woken exactly when a publisher was due, and every interval got sent once\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests that the ModularSensors library's
+VariableArray works out its list of sensors once, when it is made, instead of telling the sensors apart by
+comparing a String of each one's name and location every time through setting up and updating.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -std=c++17 -O2 -I ../host_arduino -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -o sensor_list_test sensor_list_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableArray.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/SensorBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/ResultReducer.cpp
+
+and run it:
+
+  sensor_list_test [--updates 100]
+
+The array has 34 variables from 11 stand-in sensors, with some sensors sharing a power pin and one
+sensor's variables split up across the array. It checks that the array finds the 11 sensors and sets them
+up in the order of each one's last variable, as it always has. Then it counts the Strings made (with the
+String in ../host_arduino) while the array is made, its sensors are set up, and it runs --updates complete
+updates. There have to be none.
+
+For comparison it counts the Strings the old way of telling the sensors apart made in one pass over the
+array. The old setupSensors() made one pass to find the sensors already set up and another each time it
+went through them, and completeUpdate() made one each time it ran.
+
+It prints what it counted and exits with an error if anything was wrong.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "VariableArray.h"
+
+
+static long problems = 0;
+
+static void problem(const char* what) {
+    if (problems++ < 10) printf("PROBLEM: %s\n", what);
+}
+
+
+static Sensor* setupOrder[32];
+static int     setups = 0;
+
+// A sensor with nothing to wait for, whose results count up with each measurement
+class FakeSensor : public Sensor {
+ public:
+    FakeSensor(uint8_t variables, int8_t powerPin, int8_t dataPin)
+        : Sensor("FakeSensor", variables, 0, 0, 0, powerPin, dataPin, 1) {}
+
+    // The array sets its sensors up in the order of its list
+    bool setup(void) override {
+        if (setups < 32) setupOrder[setups++] = this;
+        return Sensor::setup();
+    }
+
+    bool addSingleMeasurementResult(void) override {
+        measurements++;
+        for (uint8_t i = 0; i < _numReturnedValues; i++) {
+            verifyAndAddMeasurementResult(i, static_cast<float>(measurements + i));
+        }
+        // Unset the measurement request bits, as the real sensors do
+        _sensorStatus &= 0b10011111;
+        return true;
+    }
+
+    bool isWarmedUp(bool) override {
+        return true;
+    }
+    bool isStable(bool) override {
+        return true;
+    }
+    bool isMeasurementComplete(bool) override {
+        return true;
+    }
+
+    long measurements = 0;
+};
+
+
+static const int sensorCount   = 11;
+static const int variableCount = 34;
+
+// Each sensor's variables, and the power pin it is on; the first three share one, as do the next two
+static const uint8_t sensorVariables[sensorCount] = {4, 4, 3, 3, 3, 3, 3, 3, 3, 3, 2};
+static const int8_t  sensorPowerPins[sensorCount] = {22, 22, 22, 10, 10, 11, 12, 13, 14, -1, -1};
+
+
+// Whether a variable is the last one from its sensor, the way the old VariableArray worked it out
+static bool oldIsLastVarFromSensor(Variable* variables[], int index) {
+    if (variables[index]->isCalculated) return false;
+    String nameLocation = variables[index]->getParentSensorNameAndLocation();
+    for (int j = index + 1; j < variableCount; j++) {
+        if (nameLocation == variables[j]->getParentSensorNameAndLocation()) return false;
+    }
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+    long updates = 100;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--updates") == 0 && a + 1 < argc) {
+            updates = atol(argv[++a]);
+        } else {
+            printf("usage: sensor_list_test [--updates 100]\n");
+            return 1;
+        }
+    }
+
+    // Each sensor on its own data pin, so the old way could tell them apart by their locations
+    FakeSensor* sensors[sensorCount];
+    for (int s = 0; s < sensorCount; s++) {
+        sensors[s] = new FakeSensor(sensorVariables[s], sensorPowerPins[s], 30 + s);
+    }
+
+    // The variables in sensor order, except the first sensor's last one comes at the very end
+    Variable* variables[variableCount];
+    Sensor*   expectedOrder[sensorCount];
+    int       count = 0;
+    for (int s = 0; s < sensorCount; s++) {
+        for (uint8_t i = 0; i < sensorVariables[s]; i++) {
+            if (s == 0 && i + 1 == sensorVariables[s]) continue;
+            variables[count++] = new Variable(sensors[s], i, 1, "name", "unit", "Code", "");
+        }
+    }
+    variables[count++] = new Variable(sensors[0], sensorVariables[0] - 1, 1, "name", "unit", "Code", "");
+    if (count != variableCount) problem("the array wasn't filled");
+    for (int s = 0; s < sensorCount - 1; s++) expectedOrder[s] = sensors[s + 1];
+    expectedOrder[sensorCount - 1] = sensors[0];
+
+    // The old way of telling the sensors apart, once over the array
+    long before = hostStringsMade;
+    int  found  = 0;
+    for (int i = 0; i < variableCount; i++) {
+        if (oldIsLastVarFromSensor(variables, i)) found++;
+    }
+    long oldStrings = hostStringsMade - before;
+    if (found != sensorCount) problem("the old way didn't find every sensor");
+
+    // The new way, counting from when the array is made
+    before = hostStringsMade;
+    VariableArray array(variableCount, variables);
+    if (array.getSensorCount() != sensorCount) problem("the array didn't find every sensor");
+    if (!array.setupSensors()) problem("setting the sensors up failed");
+    long setupStrings = hostStringsMade - before;
+    if (setups != sensorCount) problem("the sensors weren't each set up once");
+    for (int s = 0; s < sensorCount && s < setups; s++) {
+        if (setupOrder[s] != expectedOrder[s]) {
+            problem("the sensors aren't in the order of their last variables");
+            break;
+        }
+    }
+
+    before = hostStringsMade;
+    for (long u = 0; u < updates; u++) {
+        if (!array.completeUpdate()) problem("an update failed");
+    }
+    long updateStrings = hostStringsMade - before;
+    for (int s = 0; s < sensorCount; s++) {
+        if (sensors[s]->measurements != updates) problem("a sensor wasn't measured once per update");
+    }
+
+    printf("%d variables from %d sensors\n", variableCount, sensorCount);
+    printf("Strings made telling the sensors apart the old way, once over the array: %ld\n", oldStrings);
+    printf("Strings made making the array and setting up the sensors:                %ld\n", setupStrings);
+    printf("Strings made in %ld complete updates:                                    %ld\n", updates,
+           updateStrings);
+    if (setupStrings != 0) problem("making the array or setting up the sensors made Strings");
+    if (updateStrings != 0) problem("updating the sensors made Strings");
+
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("The array found every sensor in order without making a single String\n");
+    return 0;
+}
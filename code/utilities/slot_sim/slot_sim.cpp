@@ -0,0 +1,311 @@
+/*
+This program runs on your computer, not on the Mayfly. It simulates a network of satellite stations
+that only turn their radios on for their slots (see SlotSchedule.h in the SnowRadio library), to show how
+the width of the slots trades off against the drift of the stations' clocks and against lost messages.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o slot_sim slot_sim.cpp \
+      ../../arduino_libraries/SnowRadio/src/SlotSchedule.cpp
+
+and run it:
+
+  slot_sim [--stations 5] [--days 30] [--widths 15,30,60,120] [--drifts 2,20,100] [--losses 0,0.1,0.3]
+           [--wander 2] [--offset 20] [--exchange 10] [--guard 2] [--outage 0] [--seed 1]
+
+Each station's clock starts up to --offset seconds from the base station's and runs fast or slow by up
+to each of the --drifts (in parts per million), plus a daily swing of up to --wander ppm like a DS3231
+sees with the temperature. The base station asks each station if it is ready ('R') starting when its slot
+opens, and tries again the way the base station sketches do (after 2 s, doubling up to 60 s, 7 tries at
+most) until the slot closes. Each 'R' is lost with the chance given in --losses. Once a station hears an
+'R', it keeps its radio on for --exchange seconds to send its reading. The same SlotTimer the satellite
+sketches use works out when each station turns its radio on, so the guard times are the real ones.
+--guard sets its least guard time (minGuard in the satellite sketches), and --outage turns the base
+station off for that many hours halfway through, to see how the stations find their slots again.
+
+For each combination it prints the share of cycles each station was reached in, how long its radio was
+on each cycle on average and at most, the average guard time on either side of the slot, the share of
+cycles it didn't know its slot (listening from minute 1 for ten minutes instead), and how long the
+radio would have been on each cycle listening from minute 1 until it was reached, the way the satellites
+did before the slots.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SlotSchedule.h"
+
+
+// The base station and satellite settings the sketches ship with
+static const uint32_t cycleS         = 3600;
+static const uint16_t firstSlot      = 90;
+static const uint16_t listenFrom     = 60;
+static const uint16_t listenFor      = 600;
+static const uint16_t maxDriftPpm    = 100;
+static const uint8_t  maxMissedSlots = 3;
+static const int      totalTries     = 7;
+static const double   firstBackoff   = 2;
+static const double   maxBackoff     = 60;
+
+// The time the simulation starts at, the start of a cycle
+static const double startEpoch = 1700000000.0 - fmod(1700000000.0, cycleS);
+
+static const int maxStations = 32;
+static const int maxList     = 16;
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static double randomUnit(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (rngState >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double randomBetween(double low, double high) {
+    return low + (high - low) * randomUnit();
+}
+
+
+// A satellite station's clock
+struct StationClock {
+    double offset;  // Seconds ahead of the base station's clock at the start
+    double ratePpm;  // How much faster it runs
+    double wanderPpm;  // How far its rate swings over a day
+    double phase;  // When in the day the swing peaks
+
+    // The time on the station's clock at a time on the base station's clock
+    double local(double base) const {
+        double t     = base - startEpoch;
+        double swing = wanderPpm * 86400.0 / (2 * M_PI) *
+            (cos(phase) - cos(2 * M_PI * t / 86400.0 + phase));
+        return base + offset + 1e-6 * (ratePpm * t + swing);
+    }
+
+    // The time on the base station's clock at a time on the station's clock
+    double base(double local) const {
+        double base = local - offset;
+        for (int i = 0; i < 4; i++) base += local - this->local(base);
+        return base;
+    }
+};
+
+
+struct Results {
+    uint32_t windows;
+    uint32_t contacts;
+    uint32_t fallbacks;
+    double   onTotal;
+    double   onMax;
+    double   guardTotal;
+    uint32_t guards;
+    double   legacyTotal;
+};
+
+
+static int readList(const char* text, double* list) {
+    int count = 0;
+    while (*text != '\0' && count < maxList) {
+        char* end;
+        list[count++] = strtod(text, &end);
+        if (end == text) return 0;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+
+static void simulate(int stations, int cycles, double width, double drift,
+                     double loss, double wander, double maxOffset,
+                     double exchange, uint8_t minGuard, int outage,
+                     Results* results) {
+    memset(results, 0, sizeof(*results));
+
+    StationClock clocks[maxStations];
+    SlotTimer*   timers[maxStations];
+    for (int s = 0; s < stations; s++) {
+        clocks[s].offset    = randomBetween(-maxOffset, maxOffset);
+        clocks[s].ratePpm   = randomBetween(-drift, drift);
+        clocks[s].wanderPpm = randomBetween(0, wander);
+        clocks[s].phase     = randomBetween(0, 2 * M_PI);
+        timers[s] = new SlotTimer(cycleS, listenFrom, listenFrom + listenFor,
+                                  minGuard, maxDriftPpm, maxMissedSlots);
+    }
+
+    for (int k = 0; k < cycles; k++) {
+        double cycleBase = startEpoch + static_cast<double>(k) * cycleS;
+        bool   baseOff   = k >= cycles / 2 && k < cycles / 2 + outage;
+        for (int s = 0; s < stations; s++) {
+            const StationClock& clock = clocks[s];
+            SlotTimer&          timer = *timers[s];
+
+            // The station logs when its own clock reaches the cycle, and
+            // works out its window when it wakes up a minute later
+            uint32_t cycleStart = static_cast<uint32_t>(cycleBase);
+            uint32_t open, close;
+            bool     synced = timer.isSynced();
+            timer.window(cycleStart, cycleStart + 60, &open, &close);
+            double onFrom = clock.base(open);
+            double onTo   = clock.base(close);
+            if (synced) {
+                results->guardTotal += timer.guardAt(open);
+                results->guards++;
+            } else {
+                results->fallbacks++;
+            }
+            // Before the slots, the station listened from minute 1
+            double legacyFrom = clock.base(cycleStart + listenFrom);
+            double legacyTo   = legacyFrom + listenFor;
+
+            // The base station asks this cycle and the next, in case the
+            // window was moved on to the next
+            double heard       = -1;
+            double legacyHeard = -1;
+            for (int c = 0; c < 2 && heard < 0 && !baseOff; c++) {
+                double slotBase  = cycleBase + static_cast<double>(c) * cycleS;
+                double slotOpen  = slotBase + firstSlot + s * width;
+                double slotClose = slotOpen + width;
+                double attempt   = slotOpen;
+                double backoff   = firstBackoff;
+                for (int t = 0; t < totalTries && attempt < slotClose; t++) {
+                    bool arrived = randomUnit() >= loss;
+                    if (arrived && heard < 0 && attempt >= onFrom &&
+                        attempt <= onTo) {
+                        heard = attempt;
+                    }
+                    if (arrived && legacyHeard < 0 && c == 0 &&
+                        attempt >= legacyFrom && attempt <= legacyTo) {
+                        legacyHeard = attempt;
+                    }
+                    if (heard >= 0 && (legacyHeard >= 0 || c > 0)) break;
+                    attempt += backoff;
+                    backoff = backoff * 2 > maxBackoff ? maxBackoff
+                                                        : backoff * 2;
+                }
+            }
+
+            double on;
+            results->windows++;
+            if (heard >= 0) {
+                results->contacts++;
+                on = heard + exchange - onFrom;
+                uint8_t schedule[SLOT_SCHEDULE_SIZE];
+                slotPutSchedule(schedule, static_cast<uint32_t>(heard),
+                                firstSlot + s * width,
+                                firstSlot + (s + 1) * width);
+                timer.heard(schedule, sizeof(schedule),
+                            static_cast<uint32_t>(floor(clock.local(heard))));
+            } else {
+                on = onTo - onFrom;
+                timer.missed();
+            }
+            results->onTotal += on;
+            if (on > results->onMax) results->onMax = on;
+            results->legacyTotal += legacyHeard >= 0
+                ? legacyHeard + exchange - legacyFrom
+                : listenFor;
+        }
+    }
+
+    for (int s = 0; s < stations; s++) delete timers[s];
+}
+
+
+static void printUsage(void) {
+    fprintf(stderr,
+            "Usage: slot_sim [--stations N] [--days N] [--widths s,s,...] "
+            "[--drifts ppm,ppm,...] [--losses p,p,...] [--wander ppm] "
+            "[--offset s] [--exchange s] [--guard s] [--outage hours] "
+            "[--seed N]\n");
+}
+
+
+int main(int argc, char* argv[]) {
+    int    stations = 5;
+    int    days     = 30;
+    double widths[maxList]  = {15, 30, 60, 120};
+    double drifts[maxList]  = {2, 20, 100};
+    double losses[maxList]  = {0, 0.1, 0.3};
+    int    widthCount       = 4;
+    int    driftCount       = 3;
+    int    lossCount        = 3;
+    double wander           = 2;
+    double maxOffset        = 20;
+    double exchange         = 10;
+    int    guard            = 2;
+    int    outage           = 0;
+    unsigned long seed      = 1;
+
+    for (int a = 1; a < argc; a++) {
+        const char* value = a + 1 < argc ? argv[a + 1] : NULL;
+        if (value == NULL) {
+            printUsage();
+            return 1;
+        }
+        if (strcmp(argv[a], "--stations") == 0) {
+            stations = atoi(value);
+        } else if (strcmp(argv[a], "--days") == 0) {
+            days = atoi(value);
+        } else if (strcmp(argv[a], "--widths") == 0) {
+            widthCount = readList(value, widths);
+        } else if (strcmp(argv[a], "--drifts") == 0) {
+            driftCount = readList(value, drifts);
+        } else if (strcmp(argv[a], "--losses") == 0) {
+            lossCount = readList(value, losses);
+        } else if (strcmp(argv[a], "--wander") == 0) {
+            wander = atof(value);
+        } else if (strcmp(argv[a], "--offset") == 0) {
+            maxOffset = atof(value);
+        } else if (strcmp(argv[a], "--exchange") == 0) {
+            exchange = atof(value);
+        } else if (strcmp(argv[a], "--guard") == 0) {
+            guard = atoi(value);
+        } else if (strcmp(argv[a], "--outage") == 0) {
+            outage = atoi(value);
+        } else if (strcmp(argv[a], "--seed") == 0) {
+            seed = strtoul(value, NULL, 10);
+        } else {
+            printUsage();
+            return 1;
+        }
+        a++;
+    }
+    if (stations < 1 || stations > maxStations || days < 1 ||
+        widthCount == 0 || driftCount == 0 || lossCount == 0 || guard < 0 ||
+        guard > 255 || outage < 0) {
+        printUsage();
+        return 1;
+    }
+
+    int cycles = days * static_cast<int>(86400 / cycleS);
+    printf("%d stations, %d hourly cycles, clocks up to %g s off, %g ppm "
+           "daily wander, %g s exchanges, %d s least guard, %d hour outage\n\n",
+           stations, cycles, maxOffset, wander, exchange, guard, outage);
+    printf("width(s) drift(ppm)  loss  reached(%%)  on avg(s)  on max(s)  "
+           "guard(s)  no slot(%%)  listening from minute 1(s)\n");
+
+    for (int w = 0; w < widthCount; w++) {
+        for (int d = 0; d < driftCount; d++) {
+            for (int l = 0; l < lossCount; l++) {
+                rngState = seed * 2654435761UL + 1;
+                Results r;
+                simulate(stations, cycles, widths[w], drifts[d], losses[l],
+                         wander, maxOffset, exchange,
+                         static_cast<uint8_t>(guard), outage, &r);
+                printf("%8g %10g %5.2f %11.1f %10.1f %10.1f %9.2f %11.1f "
+                       "%27.1f\n",
+                       widths[w], drifts[d], losses[l],
+                       100.0 * r.contacts / r.windows, r.onTotal / r.windows,
+                       r.onMax, r.guards ? r.guardTotal / r.guards : 0.0,
+                       100.0 * r.fallbacks / r.windows,
+                       r.legacyTotal / r.windows);
+            }
+        }
+    }
+    return 0;
+}
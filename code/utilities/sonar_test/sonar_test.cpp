@@ -0,0 +1,379 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests how the ModularSensors library's
+MaxBotixSonar reads ranges: it picks the 'R####\r' frames out of whatever the sonar sends a character at a
+time, and finishes a measurement as soon as HRXL_RANGES_TO_AGREE good ranges in a row agree, after
+HRXL_MAX_RANGES good ranges, or after HRXL_ACQUISITION_TIMEOUT_MS.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -std=c++17 -O2 -I ../host_arduino -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -o sonar_test sonar_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/sensors/MaxBotixSonar.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableArray.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/SensorBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/ResultReducer.cpp
+
+and run it:
+
+  sonar_test [--trials 2000] [--seed 1]
+
+A stand-in serial port plays back what a free-ranging HRXL sends after it is powered up, one character a
+millisecond: its header lines, then a range frame every 166 ms. The sonar is read the way the logger reads
+it, with its range and acquisition time variables in a variable array that runs a complete update, and the
+time moves on a millisecond between passes. First come streams written out by hand: a sonar settling on a
+snow surface, one with spurious echoes and garbled frames, one that never settles, one read by a logger too
+busy to look more than every 40 ms, and ones with no target or no sonar at all. Then come --trials random
+ones, with some of everything.
+
+Each range, and the time the measurement took, has to be what working through the frames by the rules
+gives: the median of the last agreeing good ranges, or -9999 after the timeout if there were none. A
+measurement that ends early has to end on the frame that made the ranges agree, without reading past it.
+The sonar mustn't make a single String (with the String in ../host_arduino) while it does all this.
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "VariableArray.h"
+#include "sensors/MaxBotixSonar.h"
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+
+static long problems = 0;
+
+static void problem(const char* what, const char* stream) {
+    if (problems++ < 10) printf("PROBLEM: %s (%s)\n", what, stream);
+}
+
+
+// The sonar's settings in the satellite sketches
+static const int32_t sonarHeight = 2787;
+static const int     frameMs     = 166;
+
+
+/*
+The serial port the sonar is on. Each character arrives at its own time after the sonar is powered up, and
+can only be read once it has.
+*/
+class SonarStream : public Stream {
+ public:
+    std::string           text;
+    std::vector<uint32_t> arrives;
+    size_t                next = 0;
+
+    void clear(void) {
+        text.clear();
+        arrives.clear();
+        next = 0;
+    }
+    // Adds characters one a millisecond, starting at the given time
+    void add(const char* characters, uint32_t atMs) {
+        for (const char* c = characters; *c != '\0'; c++) {
+            text += *c;
+            arrives.push_back(atMs++);
+        }
+    }
+    // Moves the times on from when the sonar was powered up to the time on the clock
+    void poweredAt(uint32_t nowMs) {
+        for (uint32_t& at : arrives) at += nowMs;
+    }
+
+    int available(void) override {
+        size_t count = 0;
+        while (next + count < text.size() && arrives[next + count] <= millis()) count++;
+        return static_cast<int>(count);
+    }
+    int read(void) override {
+        if (available() == 0) return -1;
+        return static_cast<uint8_t>(text[next++]);
+    }
+    int peek(void) override {
+        if (available() == 0) return -1;
+        return static_cast<uint8_t>(text[next]);
+    }
+    size_t write(uint8_t) override {
+        return 1;
+    }
+    using Print::write;
+};
+
+
+// The sonar, noting when each measurement is started
+class WatchedSonar : public MaxBotixSonar {
+ public:
+    explicit WatchedSonar(Stream& stream) : MaxBotixSonar(stream, sonarHeight, -1, -1, 1) {}
+    bool startSingleMeasurement(void) override {
+        startedAt = millis();
+        return MaxBotixSonar::startSingleMeasurement();
+    }
+    uint32_t startedAt = 0;
+};
+
+
+// The header an HRXL sends when it is powered up, from about 65 ms on
+static const char* header = "HRXL-MaxSonar-WRL\rPN:MB7386\rCopyright 2011-2013\rMaxBotix Inc.\r"
+                            "RoHS 1.8b090  0713\rTempI\r";
+
+// Adds the header, then a frame for each line, one every frameMs from firstMs on. An empty line is a
+// frame the sonar didn't send.
+static void addFrames(SonarStream& stream, uint32_t headerMs, uint32_t firstMs,
+                      const std::vector<const char*>& frames) {
+    stream.add(header, headerMs);
+    for (size_t f = 0; f < frames.size(); f++) stream.add(frames[f], firstMs + f * frameMs);
+}
+
+
+/*
+What the measurement should give, worked out from the characters that came in after it started. A frame
+is an 'R' that arrives after the measurement was started, four digits, and '\r', with nothing in between.
+The measurement ends at the first millisecond the last agreeing range, or the last good range allowed, is
+in, or once the timeout has passed.
+*/
+struct Expected {
+    int      range;
+    uint32_t tookMs;
+    size_t   readTo;  // How far into the stream the sonar should have read, if it ended early
+    bool     early;
+};
+
+static bool isGood(int range) {
+    return !(range <= 300 || range == 500 || range == 5000 || range == 9999 || range > sonarHeight);
+}
+
+static Expected expect(const SonarStream& stream, uint32_t startedAt) {
+    std::vector<int> good;
+    Expected         e        = {-9999, HRXL_ACQUISITION_TIMEOUT_MS + 1, 0, false};
+    const char*      text     = stream.text.c_str();
+    uint32_t         deadline = startedAt + HRXL_ACQUISITION_TIMEOUT_MS + 1;
+    for (size_t i = 0; i + 5 < stream.text.size(); i++) {
+        if (text[i] != 'R' || stream.arrives[i] <= startedAt || stream.arrives[i + 5] > deadline) continue;
+        bool digits = true;
+        for (int d = 1; d <= 4; d++) digits &= text[i + d] >= '0' && text[i + d] <= '9';
+        if (!digits || text[i + 5] != '\r') continue;
+        int range = atoi(std::string(text + i + 1, 4).c_str());
+        if (!isGood(range)) continue;
+        good.push_back(range);
+
+        size_t n       = good.size();
+        bool   agree   = false;
+        if (n >= HRXL_RANGES_TO_AGREE) {
+            int low = good[n - 1], high = good[n - 1];
+            for (size_t k = n - HRXL_RANGES_TO_AGREE; k < n; k++) {
+                if (good[k] < low) low = good[k];
+                if (good[k] > high) high = good[k];
+            }
+            agree = high - low <= HRXL_AGREEMENT_MM;
+        }
+        if (agree || n >= HRXL_MAX_RANGES) {
+            e.tookMs = stream.arrives[i + 5] - startedAt;
+            e.readTo = i + 6;
+            e.early  = true;
+            break;
+        }
+    }
+
+    // The median of the last ranges kept
+    size_t n = good.size() < HRXL_RANGES_TO_AGREE ? good.size() : HRXL_RANGES_TO_AGREE;
+    if (n > 0) {
+        std::vector<int> last(good.end() - n, good.end());
+        for (size_t a = 1; a < n; a++) {
+            for (size_t b = a; b > 0 && last[b - 1] > last[b]; b--) std::swap(last[b - 1], last[b]);
+        }
+        e.range = n % 2 ? last[n / 2] : (last[n / 2 - 1] + last[n / 2]) / 2;
+    }
+    return e;
+}
+
+
+static SonarStream                    stream;
+static WatchedSonar                   sonar(stream);
+static MaxBotixSonar_Range            range(&sonar, "", "range");
+static MaxBotixSonar_AcquisitionTime  took(&sonar, "", "took");
+static Variable*                      variableList[] = {&range, &took};
+static VariableArray                  array(2, variableList);
+
+// Time moves on between the variable array's passes, a millisecond unless the logger is kept busy
+static uint32_t tickMs = 1;
+
+static void tick(void*) {
+    hostMillis += tickMs;
+}
+
+// Reads the sonar once through the variable array and checks what it gave
+static void measure(const char* name, long* agreed, long* timedOut, double* totalMs) {
+    stream.poweredAt(millis());
+    long strings = hostStringsMade;
+    array.completeUpdate(tick, nullptr);
+    if (hostStringsMade != strings) problem("a String was made", name);
+
+    Expected e = expect(stream, sonar.startedAt);
+    if (range.getValue() != e.range) {
+        if (problems < 10) printf("  %.0f mm, should be %d mm\n", range.getValue(), e.range);
+        problem("the range is wrong", name);
+    }
+    // The array takes a pass or so to see the measurement is done
+    double tookMs = took.getValue();
+    if (tookMs < e.tookMs || tookMs > e.tookMs + tickMs + 1) {
+        if (problems < 10) printf("  took %.0f ms, should be %u ms\n", tookMs, e.tookMs);
+        problem("the acquisition time is wrong", name);
+    }
+    if (e.early && stream.next != e.readTo) problem("the sonar read past the frame it finished on", name);
+    if (e.early) {
+        (*agreed)++;
+    } else {
+        (*timedOut)++;
+    }
+    *totalMs += tookMs;
+    // Leave it a while before the next measurement
+    delay(60000);
+}
+
+
+// A random range frame, good or bad, sometimes garbled
+static void randomFrame(char* out, int surface, int spread) {
+    int value;
+    switch (randomNumber(12)) {
+        case 0: value = 500; break;
+        case 1: value = randomNumber(2) ? 9999 : 5000; break;
+        case 2: value = randomNumber(301); break;
+        case 3: value = sonarHeight + 1 + randomNumber(2000); break;
+        default: value = surface + static_cast<int>(randomNumber(2 * spread + 1)) - spread; break;
+    }
+    if (value < 0) value = 0;
+    if (value > 9999) value = 9999;
+    sprintf(out, "R%04d\r", value);
+    switch (randomNumber(16)) {
+        case 0: out[1 + randomNumber(4)] = 'O'; break;  // A character garbled on the way
+        case 1: out[5] = '\n'; break;  // The carriage return lost
+        case 2: memmove(out + 2, out + 3, 4); break;  // A digit dropped
+        case 3: strcpy(out, ""); break;  // Nothing sent at all
+        case 4: strcat(out, "R2"); break;  // The start of a frame cut off
+        default: break;
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    long trials = 2000;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--trials") == 0 && hasValue) {
+            trials = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: sonar_test [--trials 2000] [--seed 1]\n");
+            return 1;
+        }
+    }
+
+    sonar.setup();
+    hostMillis = 1000;
+    long   agreed = 0, timedOut = 0;
+    double totalMs = 0;
+
+    // A sonar settling on the snow: the first ranges are off, then 2019, 2011 and 2012 agree
+    stream.clear();
+    addFrames(stream, 65, 200,
+              {"R2034\r", "R2019\r", "R2011\r", "R2012\r", "R2010\r", "R2011\r", "R2012\r", "R2010\r"});
+    measure("settling", &agreed, &timedOut, &totalMs);
+    if (range.getValue() != 2012) problem("the settling sonar didn't give 2012 mm", "settling");
+
+    // Spurious echoes, the blanking distance, no reading, and garbled frames in among the good ranges
+    stream.clear();
+    addFrames(stream, 65, 200,
+              {"R0500\r", "R2010\r", "R9999\r", "R2O11\r", "R0300\r", "R2009\r", "R201\r", "R20111\r",
+               "R2011\r", "R2012\r", "R2010\r"});
+    measure("spurious", &agreed, &timedOut, &totalMs);
+    if (range.getValue() != 2010) problem("the spurious echoes weren't skipped", "spurious");
+
+    // The header still coming in when the measurement starts
+    stream.clear();
+    addFrames(stream, 150, 280, {"R1500\r", "R1502\r", "R1501\r"});
+    measure("late header", &agreed, &timedOut, &totalMs);
+
+    // Blowing snow: the ranges never agree, so it stops after HRXL_MAX_RANGES of them
+    stream.clear();
+    std::vector<std::string> jumpy;
+    for (int f = 0; f < 40; f++) jumpy.push_back("R" + std::to_string(1800 + (f % 2) * 150 + f * 3) + "\r");
+    std::vector<const char*> jumpyFrames;
+    for (const std::string& f : jumpy) jumpyFrames.push_back(f.c_str());
+    addFrames(stream, 65, 200, jumpyFrames);
+    measure("never agrees", &agreed, &timedOut, &totalMs);
+
+    // A logger too busy to look more than every 40 ms, with frames coming in back to back: it has to
+    // stop on the third, even with more already waiting
+    stream.clear();
+    stream.add(header, 65);
+    stream.add("R2011\rR2012\rR2010\rR2500\rR2600\rR2700\r", 300);
+    tickMs = 40;
+    measure("busy logger", &agreed, &timedOut, &totalMs);
+    tickMs = 1;
+    if (range.getValue() != 2011) problem("the busy logger didn't give 2011 mm", "busy logger");
+
+    // Nothing under the sonar: it only sends its no-target range
+    stream.clear();
+    std::vector<const char*> nothing(40, "R9999\r");
+    addFrames(stream, 65, 200, nothing);
+    measure("no target", &agreed, &timedOut, &totalMs);
+    if (range.getValue() != -9999) problem("no target didn't give -9999", "no target");
+    if (took.getValue() < HRXL_ACQUISITION_TIMEOUT_MS) problem("it gave up too soon", "no target");
+
+    // Two good ranges before it goes quiet
+    stream.clear();
+    addFrames(stream, 65, 200, {"R2100\r", "R2140\r"});
+    measure("goes quiet", &agreed, &timedOut, &totalMs);
+    if (range.getValue() != 2120) problem("two ranges didn't give their middle", "goes quiet");
+
+    // No sonar on the port at all
+    stream.clear();
+    measure("no sonar", &agreed, &timedOut, &totalMs);
+
+    long handWritten = agreed + timedOut;
+    for (long trial = 1; trial <= trials; trial++) {
+        stream.clear();
+        int      surface = 400 + randomNumber(2400);
+        int      spread  = randomNumber(4) == 0 ? 100 : 1 + randomNumber(8);
+        uint32_t at      = 200 + randomNumber(300);
+        stream.add(header, 60 + randomNumber(120));
+        int frames = randomNumber(10) == 0 ? randomNumber(5) : 40;
+        for (int f = 0; f < frames; f++) {
+            char frame[16];
+            randomFrame(frame, surface, spread);
+            stream.add(frame, at);
+            at += frameMs - 5 + randomNumber(11);
+            if (randomNumber(30) == 0) at += 1000;  // The sonar stops for a while
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "trial %ld", trial);
+        measure(name, &agreed, &timedOut, &totalMs);
+    }
+
+    printf("%ld streams written out, %ld random ones; %ld measurements ended early and %ld timed out\n",
+           handWritten, trials, agreed, timedOut);
+    printf("Each measurement took %.0f ms on average\n", totalMs / (agreed + timedOut));
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("Every range and acquisition time was right, and no String was made\n");
+    return 0;
+}
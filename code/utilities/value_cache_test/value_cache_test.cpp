@@ -0,0 +1,276 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the logger's value cache in the
+ModularSensors library, which writes each value out as text once per update for the SD card, the
+publishers and the radio to share, instead of each of them making a String of it every time.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -std=c++17 -O2 -D ARDUINO=10819 -I ../host_arduino \
+      -I ../../arduino_libraries/EnviroDIY_ModularSensors/src \
+      -I ../../arduino_libraries/EnviroDIY_DS3231/src \
+      -include WatchDogs/WatchDogAVR.h -o value_cache_test value_cache_test.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LoggerBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LogSession.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/LoggerModem.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/dataPublisherBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableArray.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/VariableBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/SensorBase.cpp \
+      ../../arduino_libraries/EnviroDIY_ModularSensors/src/ResultReducer.cpp \
+      ../../arduino_libraries/EnviroDIY_DS3231/src/Sodaq_DS3231.cpp
+
+and run it:
+
+  value_cache_test [--trials 20000] [--seed 1]
+
+Each trial builds a variable array of stand-in sensors, from 1 to 48 variables with random resolutions,
+and gives the real Logger random values through complete updates: -9999s, whole numbers, values right on
+a rounding step, and ones long enough that they don't all fit in the cache. Every value's text and
+length, getValueStringAtI() and the CSV row printSensorDataCSV() writes have to be byte for byte what the
+old String(int16_t) and String(float, decimals) formatting made. So do the variable codes and UUIDs.
+
+Sometimes the values are read without cacheValueStrings(), as something outside the logging functions
+would, and sometimes after a second update with new values; either way the text has to be the new values.
+The text of a cached value has to stay put while values that didn't fit are asked for.
+
+It prints each thing that went wrong and exits with an error if anything did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+
+#include "LoggerBase.h"
+
+
+// The sleep code isn't built here, so neither is the watchdog
+extendedWatchDogAVR::extendedWatchDogAVR() {}
+extendedWatchDogAVR::~extendedWatchDogAVR() {}
+void extendedWatchDogAVR::setupWatchDog(uint32_t) {}
+void extendedWatchDogAVR::enableWatchDog() {}
+void extendedWatchDogAVR::disableWatchDog() {}
+void extendedWatchDogAVR::resetWatchDog() {}
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+
+static long problems = 0;
+
+static void problem(const char* what, long trial, int variable) {
+    if (problems++ < 10) printf("PROBLEM: %s (trial %ld, variable %d)\n", what, trial, variable);
+}
+
+
+// A sensor whose every result is whatever the test says
+class FakeSensor : public Sensor {
+ public:
+    FakeSensor() : Sensor("FakeSensor", MAX_NUMBER_VARS, 0, 0, 0, -1, -1, 1) {}
+
+    float next[MAX_NUMBER_VARS];
+
+    bool addSingleMeasurementResult(void) override {
+        for (uint8_t i = 0; i < MAX_NUMBER_VARS; i++) verifyAndAddMeasurementResult(i, next[i]);
+        // Unset the measurement request bits, as the real sensors do
+        _sensorStatus &= 0b10011111;
+        return true;
+    }
+
+    // Nothing to wait for
+    bool isWarmedUp(bool) override {
+        return true;
+    }
+    bool isStable(bool) override {
+        return true;
+    }
+    bool isMeasurementComplete(bool) override {
+        return true;
+    }
+};
+
+// Writes into a string, to compare the CSV row
+class TextPrint : public Print {
+ public:
+    std::string text;
+    size_t      write(uint8_t c) override {
+        text += static_cast<char>(c);
+        return 1;
+    }
+    using Print::write;
+};
+
+
+static const int maxVariables = 48;
+static const int sensorCount  = maxVariables / MAX_NUMBER_VARS;
+
+static FakeSensor                sensors[sensorCount];
+static std::unique_ptr<Variable> variables[maxVariables];
+static Variable*                 variableList[maxVariables];
+static uint8_t                   resolutions[maxVariables];
+static char                      codes[maxVariables][12];
+static char                      uuids[maxVariables][40];
+
+
+// A value a sensor might give, or one to make the text long or land on a rounding step
+static float randomValue(uint8_t resolution) {
+    switch (randomNumber(8)) {
+        case 0: return -9999;
+        case 1: return static_cast<float>(static_cast<int>(randomNumber(65535)) - 32767);
+        case 2: {
+            // Halfway between two steps of the resolution
+            float step = 1;
+            for (uint8_t i = 0; i < resolution; i++) step /= 10;
+            return (static_cast<int>(randomNumber(20001)) - 10000 + 0.5f) * step;
+        }
+        case 3: return (static_cast<int>(randomNumber(2001)) - 1000) / 1e6f;
+        case 4:
+            // Long text, but a whole-number value still has to fit in an int16_t
+            if (resolution == 0) return static_cast<float>(randomNumber(32767));
+            return (static_cast<int>(randomNumber(2000001)) - 1000000) * 10.0f;
+        default: return (static_cast<int>(randomNumber(2000001)) - 1000000) / 1000.0f;
+    }
+}
+
+// Gives every sensor result new values, and makes the array's update take them up
+static void newValues(VariableArray& array) {
+    for (int s = 0; s < sensorCount; s++) {
+        for (int i = 0; i < MAX_NUMBER_VARS; i++) {
+            sensors[s].next[i] = randomValue(resolutions[s * MAX_NUMBER_VARS + i]);
+        }
+    }
+    array.completeUpdate();
+}
+
+
+// The text of a value the way it was written out before the cache
+static String oldValueString(int i) {
+    float value = variableList[i]->getValue();
+    if (resolutions[i] == 0) return String(static_cast<int16_t>(value));
+    return String(value, resolutions[i]);
+}
+
+static void checkValues(Logger& logger, int count, long trial) {
+    for (int i = 0; i < count; i++) {
+        String      expected = oldValueString(i);
+        const char* text     = logger.getValueCharAtI(i);
+        if (strcmp(text, expected.c_str()) != 0) {
+            if (problems < 10) printf("  \"%s\", should be \"%s\"\n", text, expected.c_str());
+            problem("the value's text isn't what String() made", trial, i);
+        }
+        if (logger.getValueLengthAtI(i) != expected.length()) problem("the length is wrong", trial, i);
+        if (logger.getValueStringAtI(i) != expected) problem("getValueStringAtI() is wrong", trial, i);
+        if (strcmp(logger.getVarCodeCharAtI(i), logger.getVarCodeAtI(i).c_str()) != 0) {
+            problem("the variable code differs from getVarCodeAtI()", trial, i);
+        }
+        if (strcmp(logger.getVarUUIDCharAtI(i), logger.getVarUUIDAtI(i).c_str()) != 0) {
+            problem("the UUID differs from getVarUUIDAtI()", trial, i);
+        }
+    }
+
+    // The CSV row, as printSensorDataCSV() wrote it before
+    String expected = "";
+    Logger::dtFromEpoch(Logger::markedLocalEpochTime).addToString(expected);
+    expected += ',';
+    for (int i = 0; i < count; i++) {
+        expected += oldValueString(i);
+        if (i + 1 != count) expected += ',';
+    }
+    expected += "\r\n";
+    TextPrint row;
+    logger.printSensorDataCSV(&row);
+    if (row.text != expected.c_str()) {
+        if (problems < 10) printf("  %s  should be\n  %s", row.text.c_str(), expected.c_str());
+        problem("the CSV row isn't what it was", trial, -1);
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    long trials = 20000;
+    for (int a = 1; a < argc; a++) {
+        bool hasValue = a + 1 < argc;
+        if (strcmp(argv[a], "--trials") == 0 && hasValue) {
+            trials = atol(argv[++a]);
+        } else if (strcmp(argv[a], "--seed") == 0 && hasValue) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: value_cache_test [--trials 20000] [--seed 1]\n");
+            return 1;
+        }
+    }
+
+    Logger logger;
+    long   overflowed = 0, values = 0;
+    for (long trial = 1; trial <= trials; trial++) {
+        // A new array each time, with new resolutions. Every sensor result gets a new variable, so none
+        // is left pointing at one that's gone.
+        int count = 1 + randomNumber(randomNumber(4) == 0 ? maxVariables : 16);
+        for (int i = 0; i < maxVariables; i++) {
+            resolutions[i] = randomNumber(7);
+            snprintf(codes[i], sizeof(codes[i]), "Var%d", i);
+            snprintf(uuids[i], sizeof(uuids[i]), "12345678-abcd-1234-ef00-1234567890%02d", i);
+            variables[i].reset(new Variable(&sensors[i / MAX_NUMBER_VARS], i % MAX_NUMBER_VARS,
+                                            resolutions[i], "name", "unit",
+                                            randomNumber(10) ? codes[i] : nullptr,
+                                            randomNumber(10) ? uuids[i] : nullptr));
+            variableList[i] = variables[i].get();
+        }
+        VariableArray array(count, variableList);
+        array.setupSensors();
+        logger.setVariableArray(&array);
+        Logger::markedLocalEpochTime = 1600000000UL + randomNumber(300000000);
+
+        newValues(array);
+        switch (randomNumber(3)) {
+            case 0:
+                // As the logging functions do
+                logger.cacheValueStrings();
+                break;
+            case 1:
+                // Read once, then update again; the next read has to see the new values
+                logger.getValueCharAtI(0);
+                newValues(array);
+                break;
+            default:
+                // Nothing asks for the cache to be filled
+                break;
+        }
+        checkValues(logger, count, trial);
+
+        // A value in the cache has to stay put while the others are written out
+        const char* first = logger.getValueCharAtI(0);
+        std::string kept(first);
+        for (int i = count - 1; i > 0; i--) logger.getValueCharAtI(i);
+        if (kept != first) problem("a cached value changed when others were asked for", trial, 0);
+
+        String row = "";
+        for (int i = 0; i < count; i++) row += oldValueString(i);
+        values += count;
+        // Each value takes its text and a null
+        if (count > MS_LOGGER_VALUE_CACHE_VARIABLES ||
+            row.length() + count > MS_LOGGER_VALUE_CACHE_SIZE) {
+            overflowed++;
+        }
+    }
+
+    printf("%ld trials, %ld values checked; in %ld trials not every value fit in the cache\n", trials,
+           values, overflowed);
+    if (problems > 0) {
+        printf("FAILED: %ld problems\n", problems);
+        return 1;
+    }
+    printf("Every value, length and CSV row was byte for byte what the old formatting made\n");
+    return 0;
+}
@@ -0,0 +1,404 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the XBee frame encoder and decoder in
+the SnowRadio library against byte streams recorded from the radios, so a change to the library can be
+checked before it goes out to the stations.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o xbee_frame_test xbee_frame_test.cpp \
+      ../../arduino_libraries/SnowRadio/src/XBeeFrame.cpp
+
+and run it:
+
+  xbee_frame_test [--seed 1]
+
+It builds and reads the example frames from Digi's XBee manual byte for byte, in API mode 1 and in
+API mode 2 (escaped, AP=2), then feeds the decoder streams with junk between the frames, frames with
+a bad checksum, frames too big for its buffer, and frames cut short by the start of the next one. Last
+it sends thousands of random frames through the encoder and the decoder and checks each comes out
+the same, with random junk and broken frames mixed in. It prints each check that failed and exits
+with an error if any did.
+
+It can also read the bytes a Mayfly got from its XBee, recorded to a file with a serial terminal or
+a logic analyzer, and list the frames in them:
+
+  xbee_frame_test --file capture.bin [--escaped]
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "XBeeFrame.h"
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+
+static int checks   = 0;
+static int failures = 0;
+
+static void check(bool passed, const char* what) {
+    checks++;
+    if (!passed) {
+        failures++;
+        printf("FAILED: %s\n", what);
+    }
+}
+
+
+/*
+The example frames from Digi's XBee 3 manual: a transmit request to 0013A200400A0127 carrying "TxData0A",
+the receive packet the other XBee hands over for "RxData", and a transmit status saying frame ID 1 was
+delivered. Each is given as it appears on the serial port in API mode 1 and in API mode 2, where bytes
+that would be mistaken for a delimiter or an escape (7E, 7D, 11 and 13) go out as 7D followed by the
+byte xor 20.
+*/
+static const uint8_t destination[8] = {0x00, 0x13, 0xA2, 0x00, 0x40, 0x0A, 0x01, 0x27};
+static const uint8_t network16[2]   = {0xFF, 0xFE};
+
+static const uint8_t transmitFrame[] = {0x7E, 0x00, 0x16, 0x10, 0x01, 0x00, 0x13, 0xA2, 0x00, 0x40,
+                                        0x0A, 0x01, 0x27, 0xFF, 0xFE, 0x00, 0x00, 0x54, 0x78, 0x44,
+                                        0x61, 0x74, 0x61, 0x30, 0x41, 0x13};
+static const uint8_t transmitEscaped[] = {0x7E, 0x00, 0x16, 0x10, 0x01, 0x00, 0x7D, 0x33, 0xA2, 0x00,
+                                          0x40, 0x0A, 0x01, 0x27, 0xFF, 0xFE, 0x00, 0x00, 0x54, 0x78,
+                                          0x44, 0x61, 0x74, 0x61, 0x30, 0x41, 0x7D, 0x33};
+
+static const uint8_t source[8] = {0x00, 0x13, 0xA2, 0x00, 0x40, 0x52, 0x2B, 0xAA};
+
+static const uint8_t receiveFrame[] = {0x7E, 0x00, 0x12, 0x90, 0x00, 0x13, 0xA2, 0x00, 0x40, 0x52,
+                                       0x2B, 0xAA, 0x7D, 0x84, 0x01, 0x52, 0x78, 0x44, 0x61, 0x74,
+                                       0x61, 0x0D};
+static const uint8_t receiveEscaped[] = {0x7E, 0x00, 0x12, 0x90, 0x00, 0x7D, 0x33, 0xA2, 0x00, 0x40,
+                                         0x52, 0x2B, 0xAA, 0x7D, 0x5D, 0x84, 0x01, 0x52, 0x78, 0x44,
+                                         0x61, 0x74, 0x61, 0x0D};
+
+static const uint8_t statusFrame[] = {0x7E, 0x00, 0x07, 0x8B, 0x01, 0x7D, 0x84, 0x00, 0x00,
+                                      0x01, 0x71};
+static const uint8_t statusEscaped[] = {0x7E, 0x00, 0x07, 0x8B, 0x01, 0x7D, 0x5D, 0x84, 0x00,
+                                        0x00, 0x01, 0x71};
+
+
+// Feeds a stream to the decoder, counting what it said about each byte
+struct FeedResult {
+    int      ready;
+    int      checksumErrors;
+    int      overflows;
+    uint8_t  lastFrame[300];
+    uint16_t lastLength;
+};
+
+static FeedResult feedStream(XBeeFrameDecoder& decoder, const uint8_t* stream, int length) {
+    FeedResult result = {};
+    for (int b = 0; b < length; b++) {
+        switch (decoder.feed(stream[b])) {
+            case XBeeFrameDecoder::frameReady:
+                result.ready++;
+                result.lastLength = decoder.frameLength();
+                memcpy(result.lastFrame, decoder.frameData(), result.lastLength);
+                break;
+            case XBeeFrameDecoder::checksumError: result.checksumErrors++; break;
+            case XBeeFrameDecoder::frameOverflow: result.overflows++; break;
+            default: break;
+        }
+    }
+    return result;
+}
+
+
+// The encoder has to build Digi's transmit request byte for byte
+static void testEncoder(void) {
+    uint8_t  buffer[64];
+    uint8_t  payload[] = {'T', 'x', 'D', 'a', 't', 'a', '0', 'A'};
+    for (int escaped = 0; escaped < 2; escaped++) {
+        XBeeFrameEncoder encoder(buffer, sizeof(buffer), escaped);
+        uint16_t length = encoder.transmitRequest(destination, network16, payload, sizeof(payload), 1);
+        const uint8_t* expected     = escaped ? transmitEscaped : transmitFrame;
+        uint16_t       expectedSize = escaped ? sizeof(transmitEscaped) : sizeof(transmitFrame);
+        check(length == expectedSize && memcmp(encoder.frame(), expected, length) == 0,
+              escaped ? "escaped transmit request matches the manual"
+                      : "transmit request matches the manual");
+
+        // The same frame built a piece at a time
+        encoder.beginTransmitRequest(destination, network16, sizeof(payload), 1);
+        encoder.append(payload, 3);
+        for (unsigned c = 3; c < sizeof(payload); c++) encoder.append(payload[c]);
+        check(encoder.endFrame() == expectedSize && memcmp(encoder.frame(), expected, expectedSize) == 0,
+              "transmit request built with append() matches");
+
+        // Too few or too many bytes for the length promised has to fail
+        encoder.beginTransmitRequest(destination, network16, sizeof(payload), 1);
+        encoder.append(payload, sizeof(payload) - 1);
+        check(encoder.endFrame() == 0 && encoder.length() == 0, "a short frame isn't finished");
+        encoder.beginTransmitRequest(destination, network16, sizeof(payload), 1);
+        encoder.append(payload, sizeof(payload));
+        check(!encoder.append(0x00) || encoder.endFrame() == 0, "a long frame isn't finished");
+
+        // A frame that doesn't fit in the buffer has to fail rather than overrun it
+        XBeeFrameEncoder small(buffer, 20, escaped);
+        check(small.transmitRequest(destination, network16, payload, sizeof(payload), 1) == 0,
+              "a frame too big for the buffer isn't built");
+    }
+}
+
+// The decoder has to read Digi's receive packet and transmit status
+static void testDecoder(void) {
+    uint8_t buffer[128];
+    for (int escaped = 0; escaped < 2; escaped++) {
+        XBeeFrameDecoder decoder(buffer, sizeof(buffer), escaped);
+        const uint8_t*   stream = escaped ? receiveEscaped : receiveFrame;
+        int              length = escaped ? sizeof(receiveEscaped) : sizeof(receiveFrame);
+        bool             ready  = false;
+        for (int b = 0; b < length; b++) {
+            XBeeFrameDecoder::decodeStatus status = decoder.feed(stream[b]);
+            // Nothing is ready until the checksum
+            if (b < length - 1) {
+                check(status == XBeeFrameDecoder::incomplete, "no frame before the checksum");
+            }
+            ready = status == XBeeFrameDecoder::frameReady;
+        }
+        check(ready, escaped ? "escaped receive packet decodes" : "receive packet decodes");
+        check(decoder.isReceivePacket() && !decoder.isTransmitStatus(), "it's a receive packet");
+        check(decoder.isFrom(source) && !decoder.isFrom(destination), "it's from the right address");
+        check(decoder.rfDataLength() == 6 && memcmp(decoder.rfData(), "RxData", 6) == 0,
+              "its payload is RxData");
+        // The frame is only there until the next byte
+        decoder.feed(0x00);
+        check(decoder.frameLength() == 0 && !decoder.isReceivePacket(), "the frame goes with the next byte");
+
+        stream = escaped ? statusEscaped : statusFrame;
+        length = escaped ? sizeof(statusEscaped) : sizeof(statusFrame);
+        FeedResult result = feedStream(decoder, stream, length);
+        check(result.ready == 1 && decoder.isTransmitStatus() && !decoder.isReceivePacket(),
+              escaped ? "escaped transmit status decodes" : "transmit status decodes");
+        check(decoder.statusFrameId() == 1 && decoder.deliveryStatus() == 0 &&
+                  decoder.transmitRetryCount() == 0,
+              "transmit status says frame 1 was delivered the first time");
+        check(decoder.framesDecoded == 2 && decoder.checksumErrors == 0, "two frames counted");
+    }
+}
+
+// Junk, broken frames and frames that don't fit have to be skipped without losing the good ones
+static void testBrokenStreams(void) {
+    uint8_t buffer[128];
+    uint8_t stream[512];
+    for (int escaped = 0; escaped < 2; escaped++) {
+        const uint8_t* good       = escaped ? receiveEscaped : receiveFrame;
+        int            goodLength = escaped ? sizeof(receiveEscaped) : sizeof(receiveFrame);
+
+        // Junk before and after a frame, as when a Mayfly starts listening partway through one
+        XBeeFrameDecoder decoder(buffer, sizeof(buffer), escaped);
+        int              used = 0;
+        const uint8_t    junk[] = {0x00, 0x12, 0xFF, 0x90, 0x55, 0x13, 0xA2};
+        memcpy(stream + used, junk, sizeof(junk));
+        used += sizeof(junk);
+        memcpy(stream + used, good, goodLength);
+        used += goodLength;
+        memcpy(stream + used, junk, sizeof(junk));
+        used += sizeof(junk);
+        FeedResult result = feedStream(decoder, stream, used);
+        check(result.ready == 1 && result.checksumErrors == 0, "junk around a frame is skipped");
+
+        // A bad checksum is dropped and counted, and the next frame still decodes
+        decoder = XBeeFrameDecoder(buffer, sizeof(buffer), escaped);
+        used    = 0;
+        memcpy(stream + used, good, goodLength);
+        stream[used + goodLength - 1] ^= 0x01;
+        used += goodLength;
+        memcpy(stream + used, good, goodLength);
+        used += goodLength;
+        result = feedStream(decoder, stream, used);
+        check(result.ready == 1 && result.checksumErrors == 1 && decoder.checksumErrors == 1,
+              "a bad checksum is dropped and counted");
+        check(result.lastLength == 0x12 && result.lastFrame[0] == XBEE_RECEIVE_PACKET,
+              "the frame after a bad checksum decodes");
+
+        // A frame bigger than the buffer is dropped and counted
+        XBeeFrameDecoder small(buffer, 10, escaped);
+        result = feedStream(small, good, goodLength);
+        check(result.ready == 0 && result.overflows == 1 && small.overflows == 1,
+              "a frame too big for the buffer is dropped");
+        result = feedStream(small, escaped ? statusEscaped : statusFrame,
+                            escaped ? sizeof(statusEscaped) : sizeof(statusFrame));
+        check(result.ready == 1, "a frame that fits decodes after one that didn't");
+
+        // A frame with a length of zero is noise
+        decoder = XBeeFrameDecoder(buffer, sizeof(buffer), escaped);
+        const uint8_t empty[] = {0x7E, 0x00, 0x00, 0xFF};
+        result = feedStream(decoder, empty, sizeof(empty));
+        check(result.ready == 0 && result.checksumErrors == 0 && result.overflows == 0,
+              "a frame with no data is skipped");
+
+        // A frame cut short by the next one. In API mode 2 the delimiter starts over; in mode 1 the
+        // broken frame swallows the start of the next one and fails its checksum.
+        decoder = XBeeFrameDecoder(buffer, sizeof(buffer), escaped);
+        used    = 0;
+        memcpy(stream + used, good, goodLength / 2);
+        used += goodLength / 2;
+        for (int copy = 0; copy < 3; copy++) {
+            memcpy(stream + used, good, goodLength);
+            used += goodLength;
+        }
+        result = feedStream(decoder, stream, used);
+        if (escaped) {
+            check(result.ready == 3 && result.checksumErrors == 0,
+                  "escaped mode starts over at a delimiter in a broken frame");
+        } else {
+            check(result.ready >= 1 && result.ready + result.checksumErrors <= 3,
+                  "a broken frame costs at most the frame after it");
+        }
+
+        // The decoder can be reset in the middle of a frame
+        decoder = XBeeFrameDecoder(buffer, sizeof(buffer), escaped);
+        feedStream(decoder, good, goodLength - 3);
+        decoder.reset();
+        result = feedStream(decoder, good, goodLength);
+        check(result.ready == 1 && result.checksumErrors == 0, "reset() drops a partial frame");
+    }
+}
+
+// Random frames through the encoder and decoder, with junk and broken frames between them
+static void testRandomFrames(int rounds) {
+    static uint8_t stream[2000];
+    uint8_t        payload[256];
+    uint8_t        txBuffer[600];
+    uint8_t        rxBuffer[300];
+    int            lost = 0, wrong = 0;
+    for (int escaped = 0; escaped < 2; escaped++) {
+        XBeeFrameDecoder decoder(rxBuffer, sizeof(rxBuffer), escaped);
+        for (int round = 0; round < rounds; round++) {
+            // Lots of bytes that need escaping
+            uint16_t payloadLength = 1 + randomNumber(250);
+            for (int c = 0; c < payloadLength; c++) {
+                static const uint8_t special[] = {0x7E, 0x7D, 0x11, 0x13, 0x00, 0xFF};
+                payload[c] = randomNumber(4) == 0 ? special[randomNumber(6)] : randomNumber(256);
+            }
+            XBeeFrameEncoder encoder(txBuffer, sizeof(txBuffer), escaped);
+            uint8_t          frameId = randomNumber(256);
+            uint16_t         length  = encoder.transmitRequest(destination, network16, payload,
+                                                               payloadLength, frameId);
+            if (length == 0) {
+                wrong++;
+                continue;
+            }
+
+            // Sometimes junk first, or a copy of the frame cut short and garbled
+            int used = 0;
+            if (randomNumber(3) == 0) {
+                int junk = randomNumber(20);
+                for (int c = 0; c < junk; c++) {
+                    // No delimiters, which would start a frame that eats the next one in mode 1
+                    uint8_t noise = randomNumber(256);
+                    stream[used++] = noise == 0x7E ? 0x00 : noise;
+                }
+            }
+            bool broken = randomNumber(4) == 0;
+            if (broken) {
+                memcpy(stream + used, txBuffer, length);
+                stream[used + 3 + randomNumber(length - 4)] ^= 0x40;
+                used += length;
+            }
+            memcpy(stream + used, txBuffer, length);
+            used += length;
+
+            FeedResult result = feedStream(decoder, stream, used);
+            if (result.ready == 0) {
+                // A garbled length in mode 1 can eat the good copy; that's the one allowed loss
+                if (!(broken && !escaped)) lost++;
+                decoder.reset();
+                continue;
+            }
+            if (result.lastLength != XBEE_TRANSMIT_HEADER_SIZE + payloadLength ||
+                result.lastFrame[0] != XBEE_TRANSMIT_REQUEST || result.lastFrame[1] != frameId ||
+                memcmp(result.lastFrame + XBEE_TRANSMIT_HEADER_SIZE, payload, payloadLength) != 0) {
+                wrong++;
+            }
+        }
+    }
+    check(wrong == 0, "random frames come out the same as they went in");
+    check(lost == 0, "no random frame is lost");
+    printf("%d random frames in each mode: %d lost, %d wrong\n", rounds, lost, wrong);
+}
+
+
+// Lists the frames in a recorded stream
+static int listFile(const char* path, bool escaped) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Couldn't open %s\n", path);
+        return 1;
+    }
+    uint8_t          buffer[300];
+    XBeeFrameDecoder decoder(buffer, sizeof(buffer), escaped);
+    long             offset = 0;
+    int              c;
+    while ((c = fgetc(file)) != EOF) {
+        XBeeFrameDecoder::decodeStatus status = decoder.feed(static_cast<uint8_t>(c));
+        if (status == XBeeFrameDecoder::checksumError) {
+            printf("%8ld  bad checksum\n", offset);
+        } else if (status == XBeeFrameDecoder::frameOverflow) {
+            printf("%8ld  frame too big for a %u byte buffer\n", offset, (unsigned)sizeof(buffer));
+        } else if (status == XBeeFrameDecoder::frameReady) {
+            printf("%8ld  type %02X, %3u bytes", offset, decoder.frameType(), decoder.frameLength());
+            if (decoder.isReceivePacket()) {
+                printf("  from ");
+                for (int i = 0; i < 8; i++) printf("%02X", decoder.sourceAddress64()[i]);
+                printf(": ");
+                for (uint16_t i = 0; i < decoder.rfDataLength() && i < 40; i++) {
+                    uint8_t data = decoder.rfData()[i];
+                    putchar(data >= 32 && data < 127 ? data : '.');
+                }
+            } else if (decoder.isTransmitStatus()) {
+                printf("  frame %u, status %02X after %u retries", decoder.statusFrameId(),
+                       decoder.deliveryStatus(), decoder.transmitRetryCount());
+            }
+            printf("\n");
+        }
+        offset++;
+    }
+    fclose(file);
+    printf("%u frames, %u bad checksums, %u too big\n", decoder.framesDecoded, decoder.checksumErrors,
+           decoder.overflows);
+    return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+    const char* path    = NULL;
+    bool        escaped = false;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--file") == 0 && a + 1 < argc) {
+            path = argv[++a];
+        } else if (strcmp(argv[a], "--escaped") == 0) {
+            escaped = true;
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: xbee_frame_test [--seed 1]\n"
+                   "       xbee_frame_test --file capture.bin [--escaped]\n");
+            return 1;
+        }
+    }
+    if (path != NULL) return listFile(path, escaped);
+
+    testEncoder();
+    testDecoder();
+    testBrokenStreams();
+    testRandomFrames(5000);
+
+    if (failures > 0) {
+        printf("%d of %d checks FAILED\n", failures, checks);
+        return 1;
+    }
+    printf("All %d checks passed\n", checks);
+    return 0;
+}
@@ -0,0 +1,373 @@
+/*
+This program runs on your computer, not on the Mayfly. It tests the XBeeReceiver in the SnowRadio
+library against a simulated serial port, checking when each exchange finishes and what its latency
+counters say.
+
+Build it with any C++ compiler from this folder:
+
+  g++ -O2 -I ../../arduino_libraries/SnowRadio/src -o xbee_receiver_test xbee_receiver_test.cpp \
+      ../../arduino_libraries/SnowRadio/src/XBeeFrame.cpp \
+      ../../arduino_libraries/SnowRadio/src/XBeeReceiver.cpp
+
+and run it:
+
+  xbee_receiver_test [--seed 1]
+
+The simulated port hands over each byte of a frame when it would have finished arriving at 9600 baud,
+and like the Mayfly's Serial1 it only holds 64 bytes, dropping any that come in while it is full. The
+clock is simulated too, so the program runs in no time and the same way every time.
+
+It checks that an answer finishes the exchange as soon as its last byte is read, that answers from
+the wrong station and transmit statuses for other frames are passed over, that a failed transmit status
+ends the exchange early, that the deadline is kept across a millis() rollover, that bytes after the
+answer are left in the port for the next exchange, and that the counters add up. Then it runs a few
+thousand exchanges with random latencies for several polling intervals and prints how far the measured
+latency was from the real one and how many bytes were dropped, which shows how often a sketch has to
+poll. It prints each check that failed and exits with an error if any did.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "XBeeFrame.h"
+#include "XBeeReceiver.h"
+
+
+static const double   serialBaud = 9600;
+static const uint16_t portSize   = 64;  // The size of Serial1's receive buffer on the Mayfly
+
+
+// A small random number generator, so the runs are the same everywhere
+static uint64_t rngState = 1;
+
+static uint32_t randomNumber(uint32_t limit) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return static_cast<uint32_t>((rngState >> 11) % limit);
+}
+
+
+static int checks   = 0;
+static int failures = 0;
+
+static void check(bool passed, const char* what) {
+    checks++;
+    if (!passed) {
+        failures++;
+        printf("FAILED: %s\n", what);
+    }
+}
+
+
+// The simulated clock; millis() on the Mayfly
+static uint32_t nowMs = 0;
+
+/*
+A serial port fed from a list of bytes and the times they finish arriving. Bytes that arrive while the
+port's buffer is full are dropped, as they are on the Mayfly.
+*/
+class SimulatedPort {
+ public:
+    SimulatedPort() : _count(0), _next(0), _dropped(0), _bufferHead(0), _bufferCount(0) {}
+
+    // Queues bytes to start arriving at the given time
+    uint32_t send(const uint8_t* data, uint16_t length, uint32_t startMs) {
+        double byteMs = 10 * 1000.0 / serialBaud;
+        for (uint16_t b = 0; b < length && _count < maxBytes; b++) {
+            _bytes[_count]   = data[b];
+            _arrives[_count] = startMs + static_cast<uint32_t>((b + 1) * byteMs + 0.5);
+            _count++;
+        }
+        return _arrives[_count - 1];
+    }
+
+    int available(void) {
+        arrive();
+        return _bufferCount;
+    }
+
+    int read(void) {
+        arrive();
+        if (_bufferCount == 0) return -1;
+        uint8_t data = _buffer[_bufferHead];
+        _bufferHead  = (_bufferHead + 1) % portSize;
+        _bufferCount--;
+        return data;
+    }
+
+    uint32_t dropped(void) const {
+        return _dropped;
+    }
+
+    void clear(void) {
+        _count = _next = _bufferHead = _bufferCount = 0;
+        _dropped = 0;
+    }
+
+ private:
+    // Moves the bytes that have arrived by now into the buffer
+    void arrive(void) {
+        while (_next < _count && static_cast<int32_t>(nowMs - _arrives[_next]) >= 0) {
+            if (_bufferCount < portSize) {
+                _buffer[(_bufferHead + _bufferCount) % portSize] = _bytes[_next];
+                _bufferCount++;
+            } else {
+                _dropped++;
+            }
+            _next++;
+        }
+    }
+
+    static const uint16_t maxBytes = 2000;
+    uint8_t               _bytes[maxBytes];
+    uint32_t              _arrives[maxBytes];
+    uint16_t              _count;
+    uint16_t              _next;
+    uint32_t              _dropped;
+    uint8_t               _buffer[portSize];
+    uint16_t              _bufferHead;
+    uint16_t              _bufferCount;
+};
+
+
+static const uint8_t satellite[8] = {0x00, 0x13, 0xA2, 0x00, 0x41, 0x00, 0x00, 0x01};
+static const uint8_t stranger[8]  = {0x00, 0x13, 0xA2, 0x00, 0x41, 0x00, 0x00, 0x02};
+
+// Builds the receive packet an XBee hands over for a message from the given address
+static uint16_t receivePacket(uint8_t* out, uint16_t size, const uint8_t* from, const uint8_t* payload,
+                              uint16_t length) {
+    static const uint8_t network16[2] = {0xFF, 0xFE};
+    XBeeFrameEncoder     encoder(out, size, false);
+    encoder.beginFrame(XBEE_RECEIVE_PACKET, XBEE_RECEIVE_HEADER_SIZE - 1 + length);
+    encoder.append(from, 8);
+    encoder.append(network16, 2);
+    encoder.append(0x01);
+    encoder.append(payload, length);
+    return encoder.endFrame();
+}
+
+// Builds the transmit status an XBee sends back for a transmit request
+static uint16_t transmitStatus(uint8_t* out, uint16_t size, uint8_t frameId, uint8_t delivery) {
+    uint8_t          status[6] = {frameId, 0xFF, 0xFE, 0, delivery, 0};
+    XBeeFrameEncoder encoder(out, size, false);
+    encoder.beginFrame(XBEE_TRANSMIT_STATUS, sizeof(status));
+    encoder.append(status, sizeof(status));
+    return encoder.endFrame();
+}
+
+// Polls every intervalMs until the exchange is over, returning what it ended with
+static XBeeReceiver::receiveStatus pollUntilDone(XBeeReceiver& receiver, SimulatedPort& port,
+                                                 uint32_t intervalMs) {
+    XBeeReceiver::receiveStatus status;
+    while ((status = receiver.poll(port, nowMs)) == XBeeReceiver::waiting) nowMs += intervalMs;
+    return status;
+}
+
+
+static void testExchanges(void) {
+    uint8_t          frame[128];
+    uint8_t          decodeBuffer[128];
+    XBeeFrameDecoder decoder(decodeBuffer, sizeof(decodeBuffer));
+    XBeeReceiver     receiver(decoder);
+    SimulatedPort    port;
+    const uint8_t    answer[] = {'R', 0x34, 0x12, 0x00, 0x05, 0x00};
+
+    check(receiver.status() == XBeeReceiver::idle, "a new receiver is idle");
+    SimulatedPort empty;
+    check(receiver.poll(empty, nowMs) == XBeeReceiver::idle, "polling an idle receiver does nothing");
+
+    // The answer finishes the exchange as soon as its last byte is read
+    nowMs = 1000;
+    port.clear();
+    receiver.expect(satellite, 1, 10000, nowMs);
+    uint16_t length = receivePacket(frame, sizeof(frame), satellite, answer, sizeof(answer));
+    uint32_t done   = port.send(frame, length, nowMs + 40);
+    check(pollUntilDone(receiver, port, 1) == XBeeReceiver::received, "the answer is received");
+    check(nowMs == done, "the exchange finishes when the last byte arrives");
+    check(receiver.lastLatencyMs == done - 1000, "the latency is the time to the last byte");
+    check(decoder.rfDataLength() == sizeof(answer) && memcmp(decoder.rfData(), answer, sizeof(answer)) == 0,
+          "the answer is in the decoder");
+    check(receiver.poll(port, nowMs + 5) == XBeeReceiver::received,
+          "the exchange stays received until the next one starts");
+
+    // An answer from another station and a good transmit status are passed over
+    nowMs = 20000;
+    port.clear();
+    receiver.expect(satellite, 2, 10000, nowMs);
+    length = receivePacket(frame, sizeof(frame), stranger, answer, sizeof(answer));
+    port.send(frame, length, nowMs + 10);
+    length = transmitStatus(frame, sizeof(frame), 2, 0x00);
+    port.send(frame, length, nowMs + 30);
+    length = transmitStatus(frame, sizeof(frame), 7, 0x21);
+    port.send(frame, length, nowMs + 50);
+    length = receivePacket(frame, sizeof(frame), satellite, answer, sizeof(answer));
+    done   = port.send(frame, length, nowMs + 200);
+    check(pollUntilDone(receiver, port, 1) == XBeeReceiver::received && nowMs == done,
+          "other stations and other frames' statuses are passed over");
+    check(decoder.isFrom(satellite), "the answer that finished it is from the station");
+
+    // Anyone's answer will do when no address is given
+    nowMs = 30000;
+    port.clear();
+    receiver.expect(NULL, 0, 10000, nowMs);
+    length = receivePacket(frame, sizeof(frame), stranger, answer, sizeof(answer));
+    port.send(frame, length, nowMs + 10);
+    check(pollUntilDone(receiver, port, 1) == XBeeReceiver::received, "any station's answer will do");
+
+    // A failed transmit status ends the exchange early
+    nowMs = 40000;
+    port.clear();
+    receiver.expect(satellite, 3, 10000, nowMs);
+    length = transmitStatus(frame, sizeof(frame), 3, 0x24);
+    done   = port.send(frame, length, nowMs + 300);
+    check(pollUntilDone(receiver, port, 1) == XBeeReceiver::deliveryFailed && nowMs == done,
+          "a failed transmit status ends the exchange when it arrives");
+    check(receiver.deliveryFailures == 1, "the failure is counted");
+
+    // The deadline, with nothing coming
+    nowMs = 50000;
+    port.clear();
+    receiver.expect(satellite, 4, 10000, nowMs);
+    check(pollUntilDone(receiver, port, 7) == XBeeReceiver::timedOut, "nothing coming times out");
+    check(nowMs >= 60000 && nowMs < 60007, "it times out at the deadline");
+    check(receiver.timeouts == 1, "the timeout is counted");
+
+    // The deadline across millis() rolling over
+    nowMs = 0xFFFFFFFFUL - 3000;
+    port.clear();
+    receiver.expect(satellite, 5, 10000, nowMs);
+    check(pollUntilDone(receiver, port, 1) == XBeeReceiver::timedOut && nowMs == 10000 - 3001,
+          "the deadline is kept across a millis() rollover");
+    uint32_t start = 0xFFFFFFFFUL - 20;
+    nowMs          = start;
+    port.clear();
+    receiver.expect(satellite, 6, 10000, nowMs);
+    length = receivePacket(frame, sizeof(frame), satellite, answer, sizeof(answer));
+    done   = port.send(frame, length, nowMs);
+    check(pollUntilDone(receiver, port, 1) == XBeeReceiver::received &&
+              receiver.lastLatencyMs == done - start,
+          "the latency is right across a millis() rollover");
+
+    // Bytes after the answer stay in the port for the next exchange
+    nowMs = 70000;
+    port.clear();
+    receiver.expect(satellite, 7, 10000, nowMs);
+    length = receivePacket(frame, sizeof(frame), satellite, answer, sizeof(answer));
+    port.send(frame, length, nowMs);
+    port.send(frame, length, nowMs);
+    nowMs += 200;  // Both have arrived before the first poll
+    check(receiver.poll(port, nowMs) == XBeeReceiver::received, "the first answer finishes the exchange");
+    check(port.available() == length, "the second answer is left in the port");
+    receiver.expect(satellite, 8, 10000, nowMs);
+    check(receiver.poll(port, nowMs) == XBeeReceiver::received && receiver.lastLatencyMs == 0,
+          "the next exchange reads it");
+
+    // A frame split across many polls
+    nowMs = 80000;
+    port.clear();
+    receiver.expect(satellite, 9, 10000, nowMs);
+    uint8_t big[60];
+    for (unsigned c = 0; c < sizeof(big); c++) big[c] = c;
+    length = receivePacket(frame, sizeof(frame), satellite, big, sizeof(big));
+    done   = port.send(frame, length, nowMs + 5);
+    int polls = 0;
+    while (receiver.poll(port, nowMs) == XBeeReceiver::waiting) {
+        nowMs += 3;
+        polls++;
+    }
+    check(polls > 20 && nowMs >= done && nowMs < done + 3, "a frame read a few bytes at a time finishes");
+    check(decoder.rfDataLength() == sizeof(big) && memcmp(decoder.rfData(), big, sizeof(big)) == 0,
+          "a frame read a few bytes at a time comes out whole");
+
+    // A canceled exchange stops reading
+    nowMs = 90000;
+    port.clear();
+    receiver.expect(satellite, 10, 10000, nowMs);
+    receiver.cancel();
+    length = receivePacket(frame, sizeof(frame), satellite, answer, sizeof(answer));
+    port.send(frame, length, nowMs);
+    nowMs += 100;
+    check(receiver.poll(port, nowMs) == XBeeReceiver::idle && port.available() == length,
+          "a canceled exchange leaves the port alone");
+
+    // The counters
+    check(receiver.exchanges == 7, "the exchanges are counted");
+    check(receiver.minLatencyMs == 0 && receiver.maxLatencyMs >= receiver.averageLatencyMs() &&
+              receiver.averageLatencyMs() == receiver.totalLatencyMs / receiver.exchanges,
+          "the latency counters add up");
+    receiver.resetStats();
+    check(receiver.exchanges == 0 && receiver.timeouts == 0 && receiver.averageLatencyMs() == 0,
+          "resetStats() clears the counters");
+}
+
+
+/*
+Thousands of exchanges with random latencies and answer sizes, polled at each interval. Polling less
+often adds to the latency measured, and once the gap between polls is long enough for 64 bytes to
+arrive, bytes of the bigger answers are dropped and those exchanges time out.
+*/
+static void comparePollIntervals(int rounds) {
+    static const uint32_t intervals[] = {1, 5, 20, 50, 100};
+    printf("\npoll every  exchanges  received  timed out  latency error (avg/max ms)  bytes dropped\n");
+    for (unsigned i = 0; i < sizeof(intervals) / sizeof(intervals[0]); i++) {
+        uint8_t          frame[128];
+        uint8_t          decodeBuffer[128];
+        XBeeFrameDecoder decoder(decodeBuffer, sizeof(decodeBuffer));
+        XBeeReceiver     receiver(decoder);
+        SimulatedPort    port;
+        uint8_t          answer[66];
+        double           totalError = 0;
+        uint32_t         maxError = 0, dropped = 0;
+        nowMs = 5000;
+        for (int round = 0; round < rounds; round++) {
+            port.clear();
+            uint16_t size = 1 + randomNumber(sizeof(answer));
+            for (uint16_t c = 0; c < size; c++) answer[c] = randomNumber(256);
+            decoder.reset();  // Each round is its own session, like a new logging interval
+            uint32_t start  = nowMs;
+            uint16_t length = receivePacket(frame, sizeof(frame), satellite, answer, size);
+            uint32_t done   = port.send(frame, length, start + 20 + randomNumber(200));
+            receiver.expect(satellite, 1, 1000, start);
+            if (pollUntilDone(receiver, port, intervals[i]) == XBeeReceiver::received) {
+                uint32_t error = receiver.lastLatencyMs - (done - start);
+                totalError += error;
+                if (error > maxError) maxError = error;
+            }
+            dropped += port.dropped();
+            nowMs += 1000;
+        }
+        printf("%7u ms  %9d  %8u  %9u  %13.1f / %-10u  %13u\n", intervals[i], rounds, receiver.exchanges,
+               receiver.timeouts, receiver.exchanges > 0 ? totalError / receiver.exchanges : 0.0,
+               maxError, dropped);
+        if (intervals[i] == 1) {
+            check(receiver.exchanges == rounds && maxError == 0,
+                  "polling every millisecond measures every latency exactly");
+        }
+        check(receiver.exchanges + receiver.timeouts == rounds, "every exchange ends one way or the other");
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            rngState = strtoull(argv[++a], NULL, 10) | 1;
+        } else {
+            printf("usage: xbee_receiver_test [--seed 1]\n");
+            return 1;
+        }
+    }
+
+    testExchanges();
+    comparePollIntervals(2000);
+
+    if (failures > 0) {
+        printf("\n%d of %d checks FAILED\n", failures, checks);
+        return 1;
+    }
+    printf("\nAll %d checks passed\n", checks);
+    return 0;
+}